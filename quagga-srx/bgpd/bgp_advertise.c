@@ -35,6 +35,9 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_packet.h"
 #include "bgpd/bgp_fsm.h"
 #include "bgpd/bgp_mplsvpn.h"
+#ifdef USE_SRX
+#include "bgpd/bgp_sign.h"
+#endif /* USE_SRX */
 
 /* BGP advertise attribute is used for pack same attribute update into
    one packet.  To do that we maintain attribute hash in struct
@@ -95,6 +98,9 @@ bgp_advertise_free (struct bgp_advertise *adv)
 {
   if (adv->binfo)
     bgp_info_unlock (adv->binfo); /* bgp_advertise bgp_info reference */
+#ifdef USE_SRX
+  bgp_sign_advertise_free (adv);
+#endif /* USE_SRX */
   XFREE (MTYPE_BGP_ADVERTISE, adv);
 }
 
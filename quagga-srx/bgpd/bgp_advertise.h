@@ -61,6 +61,14 @@ struct bgp_advertise
 
   /* BGP info.  */
   struct bgp_info *binfo;
+
+#ifdef USE_SRX
+  /* BGPSEC signing state (BGP_SIGN_...).  */
+  u_char sign_state;
+
+  /* The signing job requested for this advertisement.  */
+  struct bgp_sign_job *sign_job;
+#endif /* USE_SRX */
 };
 
 /* BGP adjacency out.  */
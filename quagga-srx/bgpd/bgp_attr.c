@@ -40,6 +40,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_ecommunity.h"
 //#ifdef USE_SRX
 #include "bgpd/bgp_validate.h"
+#include "bgpd/bgp_sign.h"
 #include <srx/srxcryptoapi.h>
 //#endif
 
@@ -2364,6 +2365,122 @@ bgp_attr_check (struct peer *peer, struct attr *attr)
 
 int stream_put_prefix (struct stream *, struct prefix *);
 
+#ifdef USE_SRX
+/**
+ * Determine if the update can be send to the peer using a BGPSEC path. This
+ * requires BGPSEC to be negotiated with the peer as well as with the peer the
+ * update was received from and forbids any aggregation.
+ *
+ * @param peer The peer the update will be send to.
+ * @param attr The attribute of the update.
+ * @param from The peer the update was received from (can be NULL).
+ * @param hasASpath Indicates if an AS path would be send to the peer.
+ *
+ * @return true if a BGPSEC path can be send, otherwise false.
+ */
+static bool bgp_attr_bgpsec_possible (struct peer *peer, struct attr *attr,
+                                      struct peer *from, bool hasASpath)
+{
+  // use AS path if we did not receive this path as bgpsec path and
+  // we have an as path stored. In this case we will have it received
+  // vie eBGP as AS_PATH
+  if (hasASpath && (attr->bgpsecPathAttr == NULL))
+  {
+    return false;
+  }
+
+ /* if and only if, the peer's recv capability set and this node's send capability set,
+  * BGPSec Update message can be sent to the peer
+  *
+  * Added the case prefix aggregation is chosen, only generate a BGP4 AS_PATH
+  */
+  return !(   (   !CHECK_FLAG (peer->flags, PEER_FLAG_BGPSEC_CAPABILITY_SEND)
+               || !CHECK_FLAG (peer->cap, PEER_CAP_BGPSEC_ADV)
+              )
+           || ( from && from->as && from->as != peer->as
+                && (   !CHECK_FLAG (from->flags, PEER_FLAG_BGPSEC_CAPABILITY_RECV)
+                    || !CHECK_FLAG (from->cap, PEER_CAP_BGPSEC_ADV_SEND)
+                   )
+              )
+           // No Aggregation allowed in BGPSEC - 4.1
+           || (attr->flag & ATTR_FLAG_BIT (BGP_ATTR_AGGREGATOR))
+           || (attr->flag & ATTR_FLAG_BIT (BGP_ATTR_ATOMIC_AGGREGATE))
+          );
+}
+
+/**
+ * Determine the pCount and flags of the secure path segment this router adds
+ * when signing the update to the given eBGP or confederation peer.
+ *
+ * @param peer The peer the update will be send to.
+ * @param pCount OUT: The pCount of the segment.
+ * @param flags OUT: The flags of the segment.
+ */
+static void bgp_attr_bgpsec_segment (struct peer *peer, u_int8_t *pCount,
+                                     u_int8_t *flags)
+{
+  // @TODO: set the confed flag here
+  *flags  = peer->sort == BGP_PEER_CONFED ? 0x80 : 0;
+  *pCount = (CHECK_FLAG (peer->flags, PEER_FLAG_BGPSEC_MIGRATE))
+            ? 0
+            : peer->sort == BGP_PEER_CONFED ? 0 : 1;
+}
+
+/**
+ * Determine if the update send to the peer requires this router to sign the
+ * BGPSEC path. This performs the same decision as bgp_packet_attribute without
+ * generating the AS path which allows to request the signature ahead of time.
+ *
+ * @param peer The peer the update will be send to.
+ * @param attr The attribute of the update.
+ * @param afi The address family.
+ * @param safi The subsequent address family.
+ * @param from The peer the update was received from (can be NULL).
+ * @param pCount OUT: The pCount of the segment to be signed.
+ * @param flags OUT: The flags of the segment to be signed.
+ *
+ * @return true if a signature is needed, otherwise false.
+ *
+ * @since 0.4.3.0
+ */
+bool bgp_attr_bgpsec_sign_needed (struct peer *peer, struct attr *attr,
+                                  afi_t afi, safi_t safi, struct peer *from,
+                                  u_int8_t *pCount, u_int8_t *flags)
+{
+  struct aspath *aspath;
+  bool hasASpath;
+
+  if ((peer->sort != BGP_PEER_EBGP) && (peer->sort != BGP_PEER_CONFED))
+  {
+    return false;
+  }
+
+  // bgp_packet_attribute tests the string length of the AS path it generates.
+  // Prepending an AS does not update the string, only removing confederation
+  // segments does.
+  hasASpath = attr->aspath->str_len > 0;
+  if (peer->sort == BGP_PEER_EBGP
+      && CHECK_FLAG (peer->bgp->config, BGP_CONFIG_CONFEDERATION)
+      && (   ! CHECK_FLAG (peer->af_flags[afi][safi],
+                           PEER_FLAG_AS_PATH_UNCHANGED)
+          || attr->aspath->segments == NULL)
+      && (! CHECK_FLAG (peer->af_flags[afi][safi], PEER_FLAG_RSERVER_CLIENT)))
+  {
+    aspath = aspath_delete_confed_seq (aspath_dup (attr->aspath));
+    hasASpath = aspath->str_len > 0;
+    aspath_free (aspath);
+  }
+
+  if (!bgp_attr_bgpsec_possible (peer, attr, from, hasASpath))
+  {
+    return false;
+  }
+
+  bgp_attr_bgpsec_segment (peer, pCount, flags);
+  return true;
+}
+#endif // USE_SRX
+
 /* Make attribute packet. */
 #ifdef USE_SRX
 // This method is changed that much that it makes sense to copy the original
@@ -2451,33 +2568,8 @@ bgp_packet_attribute (struct bgp *bgp, struct peer *peer,
     aspath = attr->aspath;
 
 #ifdef USE_SRX
-  if (!*useASpath)
-  {
-    // use AS path if we did not receive this path as bgpsec path and
-    // we have an as path stored. In this case we will have it received
-    // vie eBGP as AS_PATH
-    *useASpath = (aspath->str_len > 0) && (attr->bgpsecPathAttr == NULL);
-  }
-
- /* if and only if, the peer's recv capability set and this node's send capability set,
-  * BGPSec Update message can be sent to the peer
-  *
-  * Added the case prefix aggregation is chosen, only generate a BGP4 AS_PATH
-  */
   if (!*useASpath
-      && (   (   !CHECK_FLAG (peer->flags, PEER_FLAG_BGPSEC_CAPABILITY_SEND)
-              || !CHECK_FLAG (peer->cap, PEER_CAP_BGPSEC_ADV)
-             )
-          || ( from && from->as && from->as != peer->as
-               && (   !CHECK_FLAG (from->flags, PEER_FLAG_BGPSEC_CAPABILITY_RECV)
-                   || !CHECK_FLAG (from->cap, PEER_CAP_BGPSEC_ADV_SEND)
-                  )
-             )
-          // No Aggregation allowed in BGPSEC - 4.1
-          || (attr->flag & ATTR_FLAG_BIT (BGP_ATTR_AGGREGATOR))
-          || (attr->flag & ATTR_FLAG_BIT (BGP_ATTR_ATOMIC_AGGREGATE))
-         )
-     )
+      && !bgp_attr_bgpsec_possible (peer, attr, from, aspath->str_len > 0))
   {
     // We determined that for this peer no bgpsec path can be made.
     *useASpath = true;
@@ -2496,12 +2588,13 @@ bgp_packet_attribute (struct bgp *bgp, struct peer *peer,
     // First check if we do bgpsec:
     if ((peer->sort == BGP_PEER_EBGP) || (peer->sort == BGP_PEER_CONFED))
     {
-      // @TODO: set the confed flag here
-      flags  = peer->sort == BGP_PEER_CONFED ? 0x80 : 0;
-      pCount = (CHECK_FLAG (peer->flags, PEER_FLAG_BGPSEC_MIGRATE))
-               ? 0
-               : peer->sort == BGP_PEER_CONFED ? 0 : 1;
-      signature = signBGPSecPathAttr(bgp, peer, p, attr, pCount, flags);
+      bgp_attr_bgpsec_segment (peer, &pCount, &flags);
+      // Use the signature prepared by the signing pipeline. Only sign here
+      // if the pipeline was not involved (e.g. default route origination).
+      if (!bgp_sign_fetch (peer, p, attr, pCount, flags, &signature))
+      {
+        signature = signBGPSecPathAttr(bgp, peer, p, attr, pCount, flags);
+      }
 
       // Now if we were unable to generate a signature, fall back to the BGP4
       // AS_PATH
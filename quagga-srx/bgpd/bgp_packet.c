@@ -50,6 +50,9 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_vty.h"
+#ifdef USE_SRX
+#include "bgpd/bgp_sign.h"
+#endif /* USE_SRX */
 
 int stream_put_prefix (struct stream *, struct prefix *);
 
@@ -738,6 +741,12 @@ bgp_write_packet (struct peer *peer)
     for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
       {
 	adv = FIFO_HEAD (&peer->sync[afi][safi]->update);
+#ifdef USE_SRX
+	/* Wait for the signature of the next BGPSEC update, the signing
+	   pipeline schedules the write thread once it is available. */
+	if (adv && ! bgp_sign_update_ready (peer, afi, safi))
+	  continue;
+#endif /* USE_SRX */
 	if (adv)
 	  {
             if (adv->binfo && adv->binfo->uptime < peer->synctime)
@@ -796,6 +805,9 @@ bgp_write_proceed (struct peer *peer)
     for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++)
       if ((adv = FIFO_HEAD (&peer->sync[afi][safi]->update)) != NULL)
 	if (adv->binfo->uptime < peer->synctime)
+#ifdef USE_SRX
+	  if (bgp_sign_update_ready (peer, afi, safi))
+#endif /* USE_SRX */
 	  return 1;
 
   return 0;
@@ -1904,6 +1916,11 @@ bgp_update_receive (struct peer *peer, bgp_size_t size)
       stream_forward_getp (s, update_len);
     }
 
+#ifdef USE_SRX
+  /* Send all validation requests of this UPDATE in one batch. */
+  beginVerifyBatch (peer->bgp->srxProxy);
+#endif
+
   /* NLRI is processed only when the peer is configured specific
      Address Family and Subsequent Address Family. */
   if (peer->afc[AFI_IP][SAFI_UNICAST])
@@ -1918,6 +1935,9 @@ bgp_update_receive (struct peer *peer, bgp_size_t size)
 	  ret = bgp_attr_check (peer, &attr);
 	  if (ret < 0)
 	    {
+#ifdef USE_SRX
+	      flushVerifyBatch (peer->bgp->srxProxy);
+#endif
 	      bgp_attr_unintern_sub (&attr);
 	      return -1;
             }
@@ -2062,6 +2082,10 @@ bgp_update_receive (struct peer *peer, bgp_size_t size)
 	}
     }
 
+#ifdef USE_SRX
+  flushVerifyBatch (peer->bgp->srxProxy);
+#endif
+
   /* Everything is done.  We unintern temporary structures which
      interned in bgp_attr_parse(). */
   bgp_attr_unintern_sub (&attr);
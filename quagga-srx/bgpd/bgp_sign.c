@@ -0,0 +1,673 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * Signing pipeline for BGPSEC updates. Each signature is a job identified by
+ * peer, attribute, prefix, pCount and flags. Jobs are created and finished by
+ * the bgpd thread only, the worker threads only call the SrxCryptoAPI sign
+ * function. Each job carries its own copy of the hash message, the sign
+ * function writes the target AS into it and therefore the hash message of the
+ * attribute cannot be shared between the workers. The SrxCryptoAPI does not
+ * guarantee a thread safe sign function, the workers call it one at a time.
+ * Each advertisement keeps its signing state, the bgpd thread marks it ready
+ * once its job is finished.
+ *
+ * @version 0.4.3.0
+ *
+ * Changelog:
+ * -----------------------------------------------------------------------------
+ * 0.4.3.0 - File created
+ * -----------------------------------------------------------------------------
+ */
+#include <zebra.h>
+
+#ifdef USE_SRX
+
+#include <pthread.h>
+#include <uthash.h>
+
+#include "thread.h"
+#include "vty.h"
+#include "log.h"
+#include "prefix.h"
+#include "network.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_advertise.h"
+#include "bgpd/bgp_debug.h"
+#include "bgpd/bgp_fsm.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_validate.h"
+#include "bgpd/bgp_sign.h"
+
+/* Identifies the signature of one update send to one peer. */
+struct bgp_sign_key
+{
+  struct peer   *peer;
+  struct attr   *attr;
+  struct prefix  prefix;
+  u_int8_t       pCount;
+  u_int8_t       flags;
+};
+
+/* One requested signature. */
+struct bgp_sign_job
+{
+  /* The update (MUST be the first element, it is the hash key). */
+  struct bgp_sign_key key;
+  /* The API used for signing. */
+  SRxCryptoAPI *capi;
+  /* The advertisement waiting for this job or NULL (bgpd thread only). */
+  struct bgp_advertise *adv;
+  /* Set once the signing is finished (bgpd thread only). */
+  bool done;
+  /* Time the signing was finished. */
+  time_t done_time;
+  /* The attribute has no validation data, this is an origination. */
+  bool tmp;
+  /* No hash message was available, the API generates it. */
+  bool origin;
+  /* Distributed evaluation is configured. */
+  bool distr;
+  /* The data handed to the API, all memory is owned by the job. */
+  SCA_BGPSecSignData signData;
+  SCA_BGPSEC_SecurePathSegment spSeg;
+  SCA_Prefix nlri;
+  u_int8_t ski[BGPSEC_SKI_LENGTH];
+  /* Next job in the work or done queue. */
+  struct bgp_sign_job *next;
+  UT_hash_handle hh;
+};
+
+/* The pipeline. */
+struct bgp_sign_pipeline
+{
+  /* All jobs not fetched yet (bgpd thread only). */
+  struct bgp_sign_job *jobs;
+  /* Guards the queues and the shutdown flag. */
+  pthread_mutex_t mutex;
+  /* Signals the workers that jobs are queued. */
+  pthread_cond_t cond;
+  /* Serializes the calls of the SrxCryptoAPI sign function. */
+  pthread_mutex_t sign_mutex;
+  /* Jobs waiting for a worker. */
+  struct bgp_sign_job *queue;
+  struct bgp_sign_job *queue_tail;
+  /* Jobs signed by the workers, waiting for the bgpd thread. */
+  struct bgp_sign_job *done;
+  /* The worker threads. */
+  pthread_t threads[BGP_SIGN_THREADS];
+  int no_threads;
+  bool shutdown;
+  /* Wakes up the bgpd thread once signed jobs are available. */
+  int fd[2];
+  struct thread *t_read;
+  /* Removes signatures that were not fetched. */
+  struct thread *t_expire;
+};
+
+static struct bgp_sign_pipeline bgp_sign =
+{
+  .mutex = PTHREAD_MUTEX_INITIALIZER,
+  .cond  = PTHREAD_COND_INITIALIZER,
+  .sign_mutex = PTHREAD_MUTEX_INITIALIZER,
+  .fd    = { -1, -1 }
+};
+
+/* Fill the SrxCryptoAPI prefix. */
+static void
+bgp_sign_set_nlri (SCA_Prefix *nlri, struct prefix *p)
+{
+  memset (nlri, 0, sizeof (SCA_Prefix));
+  nlri->afi    = htons (family2afi (p->family));
+  nlri->safi   = SAFI_UNICAST;
+  nlri->length = (u_int8_t)p->prefixlen;
+  memcpy (nlri->addr.ip, p->u.val, (p->prefixlen + 7) / 8);
+}
+
+/* Move a pointer into the buffer of one hash message into the buffer of the
+   copy. */
+static u_int8_t *
+bgp_sign_rebase (u_int8_t *ptr, SCA_HashMessage *from, SCA_HashMessage *to)
+{
+  if (ptr >= from->buffer && ptr <= from->buffer + from->bufferSize)
+    return to->buffer + (ptr - from->buffer);
+  return ptr;
+}
+
+/* Return a copy of the hash message owned by the caller or NULL if not enough
+   memory is available. */
+static SCA_HashMessage *
+bgp_sign_copy_hash_message (SCA_HashMessage *hashMessage)
+{
+  SCA_HashMessage *copy = calloc (1, sizeof (SCA_HashMessage));
+  SCA_HashMessagePtr *valPtr;
+  int idx;
+
+  if (copy == NULL)
+    return NULL;
+
+  copy->ownedByAPI        = false;
+  copy->segmentCount      = hashMessage->segmentCount;
+  copy->hashMessageValPtr = calloc (hashMessage->segmentCount,
+                                    sizeof (SCA_HashMessagePtr *));
+  copy->buffer            = malloc (hashMessage->bufferSize);
+  if (copy->hashMessageValPtr == NULL || copy->buffer == NULL)
+    {
+      freeSCA_HashMessage (copy);
+      return NULL;
+    }
+  copy->bufferSize = hashMessage->bufferSize;
+  memcpy (copy->buffer, hashMessage->buffer, hashMessage->bufferSize);
+
+  for (idx = 0; idx < hashMessage->segmentCount; idx++)
+    {
+      valPtr = malloc (sizeof (SCA_HashMessagePtr));
+      if (valPtr == NULL)
+        {
+          freeSCA_HashMessage (copy);
+          return NULL;
+        }
+      *valPtr = *hashMessage->hashMessageValPtr[idx];
+      valPtr->signaturePtr   = bgp_sign_rebase (valPtr->signaturePtr,
+                                                hashMessage, copy);
+      valPtr->hashMessagePtr = bgp_sign_rebase (valPtr->hashMessagePtr,
+                                                hashMessage, copy);
+      copy->hashMessageValPtr[idx] = valPtr;
+    }
+
+  return copy;
+}
+
+/* Create the job for the given update. This prepares the data the same way
+   signBGPSecPathAttr does. Returns NULL if not enough memory is available. */
+static struct bgp_sign_job *
+bgp_sign_job_new (struct bgp_sign_key *key)
+{
+  struct bgp *bgp = key->peer->bgp;
+  SCA_BGPSecValidationData *valData = key->attr->bgpsec_validationData;
+  BGPSecKey *privKey = &bgp->srx_bgpsec_key[bgp->srx_bgpsec_active_key];
+  struct bgp_sign_job *job = calloc (1, sizeof (struct bgp_sign_job));
+
+  if (job == NULL)
+    return NULL;
+
+  job->key   = *key;
+  job->capi  = bgp->srxCAPI;
+  job->distr = CHECK_FLAG (bgp->srx_config, SRX_CONFIG_EVAL_DISTR);
+
+  if (valData == NULL)
+    {
+      // An origination, the API generates the hash message from the NLRI.
+      job->tmp = true;
+      bgp_sign_set_nlri (&job->nlri, &key->prefix);
+      job->signData.nlri = &job->nlri;
+    }
+  else
+    {
+      if (valData->hashMessage[0] == NULL && valData->bgpsec_path_attr == NULL
+          && valData->nlri == NULL)
+        {
+          valData->nlri = malloc (sizeof (SCA_Prefix));
+          if (valData->nlri == NULL)
+            {
+              free (job);
+              return NULL;
+            }
+          bgp_sign_set_nlri (valData->nlri, &key->prefix);
+        }
+      if (job->distr)
+        sca_generateHashMessage (valData, SCA_ECDSA_ALGORITHM,
+                                 &valData->status);
+      if (valData->hashMessage[0] != NULL)
+        {
+          job->signData.hashMessage =
+                          bgp_sign_copy_hash_message (valData->hashMessage[0]);
+          if (job->signData.hashMessage == NULL)
+            {
+              free (job);
+              return NULL;
+            }
+        }
+      else if (valData->nlri != NULL)
+        {
+          job->nlri = *valData->nlri;
+          job->signData.nlri = &job->nlri;
+        }
+    }
+  job->origin = job->signData.hashMessage == NULL;
+
+  job->spSeg.pCount = key->pCount;
+  job->spSeg.flags  = key->flags;
+  job->spSeg.asn    = htonl (bgp->as);
+  memcpy (job->ski, privKey->ski, BGPSEC_SKI_LENGTH);
+
+  job->signData.algorithmID = privKey->algoID;
+  job->signData.myHost      = &job->spSeg;
+  job->signData.peerAS      = htonl (key->peer->as);
+  job->signData.ski         = job->ski;
+  job->signData.status      = API_STATUS_OK;
+  job->signData.signature   = NULL;
+
+  // The job keeps the peer and the attribute alive until it is freed.
+  peer_lock (key->peer);
+  job->key.attr = bgp_attr_intern (key->attr);
+
+  return job;
+}
+
+/* Free the job. It MUST NOT be stored in the hash table anymore. */
+static void
+bgp_sign_job_free (struct bgp_sign_job *job)
+{
+  SCA_Signature *signature = job->signData.signature;
+
+  if (signature != NULL)
+    {
+      if (job->capi->freeSignature (signature) == API_FAILURE)
+        {
+          free (signature->sigBuff);
+          free (signature);
+        }
+    }
+  if (job->signData.hashMessage != NULL)
+    freeSCA_HashMessage (job->signData.hashMessage);
+
+  // The advertisement is evaluated again the next time it is checked.
+  if (job->adv != NULL)
+    {
+      job->adv->sign_job   = NULL;
+      job->adv->sign_state = 0;
+    }
+
+  bgp_attr_unintern (&job->key.attr);
+  peer_unlock (job->key.peer);
+  free (job);
+}
+
+/* Process the result of the signing (bgpd thread). */
+static void
+bgp_sign_job_finish (struct bgp_sign_job *job)
+{
+  SCA_BGPSecValidationData *valData = job->key.attr->bgpsec_validationData;
+
+  if (job->signData.signature == NULL)
+    {
+      zlog_err ("[BGPSEC] Signing the bgpsec path to peer %u failed status "
+                "(0x%X)\n", job->key.peer->as, job->signData.status);
+    }
+  else if (!job->tmp && !job->distr && job->origin && valData != NULL
+           && valData->hashMessage[0] == NULL)
+    {
+      // Keep the hash message generated by the API for further signatures of
+      // this attribute.
+      valData->hashMessage[0] = job->signData.hashMessage;
+      job->signData.hashMessage = NULL;
+    }
+
+  job->done      = true;
+  job->done_time = bgp_clock ();
+  if (job->adv != NULL)
+    SET_FLAG (job->adv->sign_state, BGP_SIGN_READY);
+}
+
+/* Sign the queued jobs in batches until the pipeline is shut down. */
+static void *
+bgp_sign_worker (void *arg)
+{
+  struct bgp_sign_job *batch[BGP_SIGN_BATCH];
+  SCA_BGPSecSignData *signData[BGP_SIGN_BATCH + 1];
+  int count, idx;
+  bool wakeup;
+
+  pthread_mutex_lock (&bgp_sign.mutex);
+  while (!bgp_sign.shutdown)
+    {
+      if (bgp_sign.queue == NULL)
+        {
+          pthread_cond_wait (&bgp_sign.cond, &bgp_sign.mutex);
+          continue;
+        }
+
+      // Take as many jobs as allowed that use the same API.
+      count = 0;
+      while (bgp_sign.queue != NULL && count < BGP_SIGN_BATCH
+             && (count == 0 || bgp_sign.queue->capi == batch[0]->capi))
+        {
+          batch[count++] = bgp_sign.queue;
+          bgp_sign.queue = bgp_sign.queue->next;
+        }
+      if (bgp_sign.queue == NULL)
+        bgp_sign.queue_tail = NULL;
+      pthread_mutex_unlock (&bgp_sign.mutex);
+
+      for (idx = 0; idx < count; idx++)
+        signData[idx] = &batch[idx]->signData;
+      signData[count] = NULL;
+      // The result reports if any of the signatures failed, the failed ones
+      // do not have a signature.
+      pthread_mutex_lock (&bgp_sign.sign_mutex);
+      batch[0]->capi->sign (count, signData);
+      pthread_mutex_unlock (&bgp_sign.sign_mutex);
+
+      pthread_mutex_lock (&bgp_sign.mutex);
+      wakeup = bgp_sign.done == NULL;
+      for (idx = 0; idx < count; idx++)
+        {
+          batch[idx]->next = bgp_sign.done;
+          bgp_sign.done = batch[idx];
+        }
+      pthread_mutex_unlock (&bgp_sign.mutex);
+
+      // A write can only fail if the pipe is full which wakes up bgpd anyway.
+      if (wakeup && write (bgp_sign.fd[1], "s", 1) < 0)
+        wakeup = false;
+      pthread_mutex_lock (&bgp_sign.mutex);
+    }
+  pthread_mutex_unlock (&bgp_sign.mutex);
+
+  return NULL;
+}
+
+/* Remove the signatures that were not fetched in time, e.g. because the
+   update was replaced or the session went down. */
+static int
+bgp_sign_expire (struct thread *thread)
+{
+  struct bgp_sign_job *job, *tmp;
+  time_t now = bgp_clock ();
+
+  bgp_sign.t_expire = NULL;
+
+  HASH_ITER (hh, bgp_sign.jobs, job, tmp)
+    {
+      if (job->done && job->done_time + BGP_SIGN_TIMEOUT <= now)
+        {
+          HASH_DEL (bgp_sign.jobs, job);
+          bgp_sign_job_free (job);
+        }
+    }
+
+  if (bgp_sign.jobs != NULL)
+    bgp_sign.t_expire = thread_add_timer (bm->master, bgp_sign_expire, NULL,
+                                          BGP_SIGN_TIMEOUT);
+  return 0;
+}
+
+/* Finish the jobs signed by the workers and schedule the write thread of
+   their peers. */
+static int
+bgp_sign_done (struct thread *thread)
+{
+  struct bgp_sign_job *job, *next;
+  struct peer *peer;
+  char buf[64];
+  int count = 0;
+
+  bgp_sign.t_read = NULL;
+  while (read (bgp_sign.fd[0], buf, sizeof (buf)) > 0);
+
+  pthread_mutex_lock (&bgp_sign.mutex);
+  job = bgp_sign.done;
+  bgp_sign.done = NULL;
+  pthread_mutex_unlock (&bgp_sign.mutex);
+
+  for (; job != NULL; job = next, count++)
+    {
+      next = job->next;
+      job->next = NULL;
+      bgp_sign_job_finish (job);
+
+      peer = job->key.peer;
+      if (peer->status == Established)
+        BGP_WRITE_ON (peer->t_write, bgp_write, peer->fd);
+    }
+
+  if (BGP_DEBUG (bgpsec, BGPSEC_DETAIL))
+    zlog_debug ("[BGPSEC] %d signatures generated", count);
+
+  bgp_sign.t_read = thread_add_read (bm->master, bgp_sign_done, NULL,
+                                     bgp_sign.fd[0]);
+  return 0;
+}
+
+/* Start the workers if not running yet. Returns false if the pipeline is not
+   available. */
+static bool
+bgp_sign_start (void)
+{
+  int idx;
+
+  if (bgp_sign.no_threads > 0)
+    return true;
+
+  if (pipe (bgp_sign.fd) != 0)
+    {
+      zlog_err ("[BGPSEC] Could not create the signing pipeline: %s",
+                safe_strerror (errno));
+      bgp_sign.fd[0] = bgp_sign.fd[1] = -1;
+      return false;
+    }
+  set_nonblocking (bgp_sign.fd[0]);
+  set_nonblocking (bgp_sign.fd[1]);
+
+  bgp_sign.shutdown = false;
+  for (idx = 0; idx < BGP_SIGN_THREADS; idx++)
+    {
+      if (pthread_create (&bgp_sign.threads[idx], NULL, bgp_sign_worker,
+                          NULL) != 0)
+        break;
+      bgp_sign.no_threads++;
+    }
+
+  if (bgp_sign.no_threads == 0)
+    {
+      zlog_err ("[BGPSEC] Could not start the signing threads, signing "
+                "inline");
+      close (bgp_sign.fd[0]);
+      close (bgp_sign.fd[1]);
+      bgp_sign.fd[0] = bgp_sign.fd[1] = -1;
+      return false;
+    }
+
+  bgp_sign.t_read = thread_add_read (bm->master, bgp_sign_done, NULL,
+                                     bgp_sign.fd[0]);
+  return true;
+}
+
+/* Fill the hash key of the given update. */
+static void
+bgp_sign_set_key (struct bgp_sign_key *key, struct peer *peer,
+                  struct attr *attr, struct prefix *p, u_int8_t pCount,
+                  u_int8_t flags)
+{
+  // Zero the padding, the whole structure is used as hash key.
+  memset (key, 0, sizeof (struct bgp_sign_key));
+  key->peer   = peer;
+  key->attr   = attr;
+  prefix_copy (&key->prefix, p);
+  key->pCount = pCount;
+  key->flags  = flags;
+}
+
+bool
+bgp_sign_update_ready (struct peer *peer, afi_t afi, safi_t safi)
+{
+  struct bgp_advertise_fifo *fifo = &peer->sync[afi][safi]->update;
+  struct bgp_advertise *adv = FIFO_HEAD (fifo);
+  struct bgp_sign_job *job, *head = NULL, *tail = NULL;
+  struct bgp_sign_key key;
+  struct peer *from;
+  u_int8_t pCount, flags;
+  bool ready = true;
+  int idx;
+
+  if (adv == NULL || peer->bgp->srxCAPI == NULL)
+    return true;
+
+  // The window is only walked again once its refill mark is the head.
+  if (CHECK_FLAG (adv->sign_state, BGP_SIGN_CHECKED)
+      && ! CHECK_FLAG (adv->sign_state, BGP_SIGN_REFILL))
+    return CHECK_FLAG (adv->sign_state, BGP_SIGN_READY);
+  UNSET_FLAG (adv->sign_state, BGP_SIGN_REFILL);
+
+  for (idx = 0; adv != NULL && idx < BGP_SIGN_WINDOW; idx++)
+    {
+      job = NULL;
+      from = adv->binfo ? adv->binfo->peer : NULL;
+      if (CHECK_FLAG (adv->sign_state, BGP_SIGN_CHECKED))
+        ; // Already requested or no signature needed.
+      else if (bgp_attr_bgpsec_sign_needed (peer, adv->baa->attr, afi, safi,
+                                            from, &pCount, &flags))
+        {
+          if (!bgp_sign_start ())
+            return true;
+
+          bgp_sign_set_key (&key, peer, adv->baa->attr, &adv->rn->p, pCount,
+                            flags);
+          HASH_FIND (hh, bgp_sign.jobs, &key, sizeof (key), job);
+          if (job == NULL)
+            {
+              // If no job can be created the update is signed when written.
+              job = bgp_sign_job_new (&key);
+              if (job != NULL)
+                {
+                  HASH_ADD (hh, bgp_sign.jobs, key, sizeof (key), job);
+                  if (tail == NULL)
+                    head = job;
+                  else
+                    tail->next = job;
+                  tail = job;
+                }
+            }
+          // A job shared with another advertisement is not cached, this
+          // advertisement is evaluated again the next time.
+          if (job != NULL && job->adv == NULL)
+            {
+              job->adv      = adv;
+              adv->sign_job = job;
+              SET_FLAG (adv->sign_state, BGP_SIGN_CHECKED);
+              if (job->done)
+                SET_FLAG (adv->sign_state, BGP_SIGN_READY);
+            }
+        }
+      else
+        SET_FLAG (adv->sign_state, BGP_SIGN_CHECKED | BGP_SIGN_READY);
+
+      if (idx == 0)
+        ready = CHECK_FLAG (adv->sign_state, BGP_SIGN_CHECKED)
+                ? CHECK_FLAG (adv->sign_state, BGP_SIGN_READY)
+                : (job == NULL || job->done);
+      else if (idx == BGP_SIGN_WINDOW / 2)
+        SET_FLAG (adv->sign_state, BGP_SIGN_REFILL);
+
+      adv = (adv->fifo.next == (struct bgp_advertise *)fifo)
+            ? NULL : adv->fifo.next;
+    }
+
+  if (head != NULL)
+    {
+      pthread_mutex_lock (&bgp_sign.mutex);
+      if (bgp_sign.queue_tail == NULL)
+        bgp_sign.queue = head;
+      else
+        bgp_sign.queue_tail->next = head;
+      bgp_sign.queue_tail = tail;
+      pthread_cond_broadcast (&bgp_sign.cond);
+      pthread_mutex_unlock (&bgp_sign.mutex);
+
+      if (bgp_sign.t_expire == NULL)
+        bgp_sign.t_expire = thread_add_timer (bm->master, bgp_sign_expire,
+                                              NULL, BGP_SIGN_TIMEOUT);
+    }
+
+  return ready;
+}
+
+void
+bgp_sign_advertise_free (struct bgp_advertise *adv)
+{
+  if (adv->sign_job != NULL)
+    {
+      adv->sign_job->adv = NULL;
+      adv->sign_job = NULL;
+    }
+}
+
+bool
+bgp_sign_fetch (struct peer *peer, struct prefix *p, struct attr *attr,
+                u_int8_t pCount, u_int8_t flags, SCA_Signature **signature)
+{
+  struct bgp_sign_job *job;
+  struct bgp_sign_key key;
+
+  if (bgp_sign.jobs == NULL)
+    return false;
+
+  bgp_sign_set_key (&key, peer, attr, p, pCount, flags);
+  HASH_FIND (hh, bgp_sign.jobs, &key, sizeof (key), job);
+  if (job == NULL || !job->done)
+    return false;
+
+  *signature = job->signData.signature;
+  job->signData.signature = NULL;
+  HASH_DEL (bgp_sign.jobs, job);
+  bgp_sign_job_free (job);
+
+  return true;
+}
+
+void
+bgp_sign_terminate (void)
+{
+  struct bgp_sign_job *job, *tmp;
+  int idx;
+
+  if (bgp_sign.no_threads == 0)
+    return;
+
+  pthread_mutex_lock (&bgp_sign.mutex);
+  bgp_sign.shutdown = true;
+  pthread_cond_broadcast (&bgp_sign.cond);
+  pthread_mutex_unlock (&bgp_sign.mutex);
+
+  for (idx = 0; idx < bgp_sign.no_threads; idx++)
+    pthread_join (bgp_sign.threads[idx], NULL);
+  bgp_sign.no_threads = 0;
+
+  THREAD_OFF (bgp_sign.t_read);
+  THREAD_OFF (bgp_sign.t_expire);
+  close (bgp_sign.fd[0]);
+  close (bgp_sign.fd[1]);
+  bgp_sign.fd[0] = bgp_sign.fd[1] = -1;
+
+  // Each job is in the hash table, regardless of its state.
+  bgp_sign.queue = bgp_sign.queue_tail = bgp_sign.done = NULL;
+  HASH_ITER (hh, bgp_sign.jobs, job, tmp)
+    {
+      HASH_DEL (bgp_sign.jobs, job);
+      bgp_sign_job_free (job);
+    }
+}
+
+#endif /* USE_SRX */
@@ -0,0 +1,115 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * Signing pipeline for BGPSEC updates. Signatures for the updates queued for
+ * a peer are requested ahead of time and generated in batches by worker
+ * threads. The update is written once its signature is available, in the
+ * meantime the peer's other packets (e.g. keepalives) are written as usual.
+ *
+ * @version 0.4.3.0
+ *
+ * Changelog:
+ * -----------------------------------------------------------------------------
+ * 0.4.3.0 - File created
+ * -----------------------------------------------------------------------------
+ */
+#ifndef _QUAGGA_BGP_SIGN_H
+#define _QUAGGA_BGP_SIGN_H
+
+#include "config.h"
+
+#ifdef USE_SRX
+
+#include <zebra.h>
+#include <srx/srxcryptoapi.h>
+
+/** Number of worker threads generating signatures. */
+#define BGP_SIGN_THREADS  2
+/** Maximum number of signatures generated by one call of the SrxCryptoAPI. */
+#define BGP_SIGN_BATCH    32
+/** Number of queued updates of a peer's address family for which signatures
+ * are requested ahead of time. */
+#define BGP_SIGN_WINDOW   64
+/** Seconds a signature is kept if its update is not send (e.g. withdrawn). */
+#define BGP_SIGN_TIMEOUT  60
+
+/** Advertisement state: The need for a signature was determined. */
+#define BGP_SIGN_CHECKED  0x01
+/** Advertisement state: The update needs no signature or it is available. */
+#define BGP_SIGN_READY    0x02
+/** Advertisement state: Request the signatures of the next window once this
+ * advertisement is the first one queued. */
+#define BGP_SIGN_REFILL   0x04
+
+struct peer;
+struct attr;
+struct prefix;
+struct bgp_advertise;
+
+/**
+ * Determine if the first update queued for the peer can be written. If the
+ * update needs a signature that is not yet available it is requested,
+ * together with the signatures of the updates queued behind it. The peer's
+ * write thread is scheduled once the signatures are available. The result
+ * is kept in the advertisement, the queue is only walked again once half of
+ * the requested window is written.
+ *
+ * @param peer The peer.
+ * @param afi The address family of the update queue.
+ * @param safi The subsequent address family of the update queue.
+ *
+ * @return true if the update can be written now, otherwise false.
+ */
+extern bool bgp_sign_update_ready (struct peer *peer, afi_t afi, safi_t safi);
+
+/**
+ * Take the signature generated by the pipeline for the given update.
+ *
+ * @param peer The peer the update is send to.
+ * @param p The prefix of the update.
+ * @param attr The attribute of the update.
+ * @param pCount The pCount of the secure path segment.
+ * @param flags The flags of the secure path segment.
+ * @param signature OUT: The signature or NULL if signing failed. The caller
+ *                  is responsible to free the signature.
+ *
+ * @return false if the pipeline did not generate a signature for the update.
+ */
+extern bool bgp_sign_fetch (struct peer *peer, struct prefix *p,
+                            struct attr *attr, u_int8_t pCount,
+                            u_int8_t flags, SCA_Signature **signature);
+
+/**
+ * Detach the advertisement from its signing job, it is about to be freed.
+ *
+ * @param adv The advertisement.
+ */
+extern void bgp_sign_advertise_free (struct bgp_advertise *adv);
+
+/**
+ * Stop the worker threads and drop all signatures not fetched yet. The
+ * pipeline restarts with the next signature request.
+ */
+extern void bgp_sign_terminate (void);
+
+#endif /* USE_SRX */
+
+#endif /* !_QUAGGA_BGP_SIGN_H */
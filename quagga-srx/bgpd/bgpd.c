@@ -65,6 +65,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #ifdef USE_SRX
 #include "bgpd/bgp_info_hash.h"
 #include "bgpd/bgp_validate.h"
+#include "bgpd/bgp_sign.h"
 
 
 // Forward Declaration
@@ -72,6 +73,8 @@ bool handleSRxValidationResult (SRxUpdateID updateID, uint32_t localID,
                                 ValidationResultType valType,
                                 uint8_t roaResult, uint8_t bgpsecResult,
                                 uint8_t aspaResult, void* bgpRouter);
+void handleSRxValidationResults (uint32_t noResults, SRxUpdateResult* results,
+                                 void* bgpRouter);
 void handleSRxSignatures(SRxUpdateID updateID, BGPSecCallbackData* data,
                                        void* bgpRouter);
 void handleSRxSynchRequest(void* bgpRouter);
@@ -2509,6 +2512,48 @@ bool handleSRxValidationResult (SRxUpdateID updateID, uint32_t localID,
   return retVal;
 }
 
+/**
+ * Called by proxy once a batch of changed validation results is received. The
+ * results are stored in one pass; the affected route nodes are scheduled in
+ * the process queue which evaluates each node only once, even if several of
+ * its paths changed.
+ *
+ * @param noResults The number of results
+ * @param results The changed validation results
+ * @param bgpRouter A pointer to the bgp router instance
+ */
+void handleSRxValidationResults (uint32_t noResults, SRxUpdateResult* results,
+                                 void* bgpRouter)
+{
+  struct bgp_info* info;
+  struct bgp*      bgp = (struct bgp*)bgpRouter;
+  uint32_t         idx;
+
+  if (BGP_DEBUG (aspa, ASPA))
+  {
+    zlog_debug ("[ ASPA ] %s notified %u validation results", __FUNCTION__,
+                noResults);
+  }
+
+  for (idx = 0; idx < noResults; idx++)
+  {
+    info = bgp_info_fetch(bgp->info_uid_hash, results[idx].updateID);
+    if (info)
+    {
+      bgp_info_set_validation_result (info, results[idx].valType,
+                                      results[idx].roaResult,
+                                      results[idx].bgpsecResult,
+                                      results[idx].aspaResult);
+    }
+    else
+    {
+      zlog_warn("update [0x%08X] is not known, send a delete to the server!",
+                 results[idx].updateID);
+      deleteUpdate(bgp->srxProxy, bgp->srx_keepWindow, results[idx].updateID);
+    }
+  }
+}
+
 /* Called by proxy once notifications are received. */
 void handleSRxSignatures(SRxUpdateID updateID, BGPSecCallbackData* data,
                                 void* bgpRouter)
@@ -2535,6 +2580,9 @@ static void _handleSRxSynchRequest_processTable(struct bgp* bgp,
 
   SRxDefaultResult defResult;
 
+  // Send the validation requests of the table walk in batches.
+  beginVerifyBatch(bgp->srxProxy);
+
   /* Start processing of routes. */
   for (bnode = bgp_table_top(table); bnode; bnode = bgp_route_next(bnode))
   {
@@ -2552,6 +2600,8 @@ static void _handleSRxSynchRequest_processTable(struct bgp* bgp,
       srxUnLockUpdate(binfo);
     }
   }
+
+  flushVerifyBatch(bgp->srxProxy);
 }
 
 
@@ -2620,6 +2670,7 @@ void srx_set_default(struct bgp *bgp)
   bgp->srxProxy = createSRxProxy(handleSRxValidationResult, handleSRxSignatures,
                                  handleSRxSynchRequest, handleSRxMessages,
                                  bgp->srx_proxyID, bgp->as, bgp);
+  setValidationsReadyCallback(bgp->srxProxy, handleSRxValidationResults);
 
   // @TODO: REvisit this portion.
   // The following line should be replaced by the commented code. The CAPI is
@@ -6424,4 +6475,7 @@ bgp_terminate (void)
       work_queue_free (bm->process_rsclient_queue);
       bm->process_rsclient_queue = NULL;
     }
+#ifdef USE_SRX
+  bgp_sign_terminate ();
+#endif /* USE_SRX */
 }
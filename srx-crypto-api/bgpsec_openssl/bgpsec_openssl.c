@@ -108,6 +108,8 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <setjmp.h>
+#include <pthread.h>
+#include <unistd.h>
 
 
 /* general API header which will be public to the customer side */
@@ -115,9 +117,19 @@
 #include "key_storage.h"
 
 /** This define is used in init() to specify if configured keys should
- * immediately be converted into EC_KEYs*/
-#define DO_CONVERT true
+ * immediately be converted into EC_KEYs. They are converted in parallel by
+ * ks_warmUp once all key files are read. */
+#define DO_CONVERT false
 #define DEBUG_TBD
+/** The init value token that enables the parallel validation worker pool:
+ * THREADS:<number of worker threads> */
+#define BOSSL_INIT_THREADS "THREADS:"
+/** The maximum number of validation worker threads. */
+#define BOSSL_MAX_VAL_THREADS 64
+/** Paths with fewer signatures than this are always validated serially. */
+#define BOSSL_MIN_PARALLEL_SEGMENTS 2
+/** Paths up to this number of signatures are prepared on the stack. */
+#define BOSSL_STACK_SEGMENTS 32
 
 /** indicates if the library is initialized */
 static bool BOSSL_initialized = false;
@@ -127,6 +139,99 @@ static KeyStorage* BOSSL_pubKeys = NULL;
 static KeyStorage* BOSSL_privKeys = NULL;
 inline void printHex(int , unsigned char* );
 
+/** One signature segment of a path, prepared for verification. */
+typedef struct {
+  /** The hash message (input of the digest) of this segment. */
+  u_int8_t*  hashMessage;
+  /** The length of the hash message. */
+  u_int16_t  hashMessageLength;
+  /** The signature of this segment. */
+  u_int8_t*  signature;
+  /** The length of the signature. */
+  u_int16_t  sigLength;
+  /** The signature segment header, used for logging only. */
+  SCA_BGPSEC_SignatureSegment* sigSeg;
+  /** The keys registered for the ASN / SKI of this segment. */
+  EC_KEY**   ecdsa_key;
+  /** The number of keys. */
+  u_int16_t  noKeys;
+} BOSSL_ValSegment;
+
+/** A single path validation processed by the worker pool. The job lives on
+ * the stack of the validate() caller which also processes segments. */
+typedef struct _BOSSL_ValJob {
+  /** The segments to be verified. */
+  BOSSL_ValSegment*     segments;
+  /** Number of segments. */
+  int                   noSegments;
+  /** The next segment to be claimed (atomic). */
+  int                   next;
+  /** Set to true by the first segment that fails; cancels the job. */
+  bool                  failed;
+  /** Collected status flags of all verifications (atomic). */
+  sca_status_t          status;
+  /** Number of threads (including the caller) working on this job. */
+  int                   users;
+  /** The next job in the pool queue. */
+  struct _BOSSL_ValJob* nextJob;
+} BOSSL_ValJob;
+
+/** The validation worker pool. */
+typedef struct {
+  /** The worker threads. */
+  pthread_t*    threads;
+  /** The number of worker threads, 0 if the pool is not running. */
+  int           noThreads;
+  /** Protects the job queue and the users counters of the jobs. */
+  pthread_mutex_t mutex;
+  /** Signals workers that new jobs are queued. */
+  pthread_cond_t  jobCond;
+  /** Signals callers that a worker left its job. */
+  pthread_cond_t  doneCond;
+  /** Head of the job queue. */
+  BOSSL_ValJob* head;
+  /** Tail of the job queue. */
+  BOSSL_ValJob* tail;
+  /** Tells the workers to stop. */
+  bool          shutdown;
+} BOSSL_ValPool;
+
+/** A key lookup result shared by all validations of one batch. */
+typedef struct {
+  /** The SKI of the key, NULL for an unused entry. Points into the data of
+   * the batch. */
+  u_int8_t*    ski;
+  /** The ASN of the key (network format). */
+  u_int32_t    asn;
+  /** The keys found in the key storage or NULL. */
+  EC_KEY**     keys;
+  /** The number of keys. */
+  u_int16_t    noKeys;
+  /** The status of the key storage lookup. */
+  sca_status_t status;
+} BOSSL_KeyCacheEntry;
+
+/** The key lookup cache of one batch validation (open addressing). */
+typedef struct {
+  /** The entries, (mask + 1) elements. */
+  BOSSL_KeyCacheEntry* entries;
+  /** The size of the entries array - 1, the size is a power of 2. */
+  u_int32_t            mask;
+  /** The number of key storage lookups performed. */
+  u_int32_t            lookups;
+} BOSSL_KeyCache;
+
+/** The number of validation worker threads configured in the init value. */
+static int BOSSL_valThreads = 0;
+/** The validation worker pool. */
+static BOSSL_ValPool BOSSL_pool;
+
+static bool _startValPool(int noThreads);
+static void _stopValPool();
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static void _setupSSLLocks();
+#endif
+
 /**
  * Read the given file and pre-load all keys. The following non error status
  * can be set:
@@ -297,6 +402,10 @@ static void _readKeyFile(char* fName, bool isPrivate, sca_status_t* status,
  * This values are parsed and used to load the keys using the srxcryptoapi
  * function sca_loadKeys.
  *
+ * Additionally the value can contain the token THREADS:<number> which starts
+ * a pool of worker threads that verify the signatures of one BGPsec path in
+ * parallel (0..64, 0 = serial validation which is the default).
+ *
  * @param value Allows to pass a filenames containing private / public keys.
  * @param logLevel Ignored - Uses the loglevel of srxcryptoapi!
  * @param status An out parameter that will contain information in case of
@@ -343,6 +452,34 @@ int init(const char* value, int logLevel, sca_status_t* status)
 
     while (strLen > 0 && ((myStatus & API_STATUS_ERROR_MASK) == 0 ))
     {
+      // Check for the number of validation worker threads.
+      if (strncmp(tmpValue, BOSSL_INIT_THREADS, 
+                  strlen(BOSSL_INIT_THREADS)) == 0)
+      {
+        tmpValue += strlen(BOSSL_INIT_THREADS);
+        strLen   -= strlen(BOSSL_INIT_THREADS);
+
+        int   numLength = strcspn(tmpValue, ";");
+        char* endPtr    = NULL;
+        long  threads   = strtol(tmpValue, &endPtr, 10);
+        if (   (numLength == 0) || (endPtr != tmpValue + numLength)
+            || (threads < 0) || (threads > BOSSL_MAX_VAL_THREADS))
+        {
+          myStatus |= API_STATUS_ERR_USER2;
+          continue;
+        }
+        BOSSL_valThreads = (int)threads;
+        tmpValue += numLength;
+        strLen   -= numLength;
+        if (strLen > 0)
+        {
+          // Jump over the ';'
+          tmpValue++;
+          strLen--;
+        }
+        continue;
+      }
+
       // Check for either value, PUB: or PRIV:
       int typeLen = strspn(tmpValue, "PUBRIV:");
       if (typeLen != 0)
@@ -430,9 +567,27 @@ int init(const char* value, int logLevel, sca_status_t* status)
   if ((myStatus & API_STATUS_ERROR_MASK) == API_STATUS_OK)
   {
     BOSSL_initialized = true;
+    // Convert all loaded keys now to not delay the first validations.
+    long warmUpThreads = (BOSSL_valThreads > 0) 
+                         ? BOSSL_valThreads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (warmUpThreads < 1 || warmUpThreads > BOSSL_MAX_VAL_THREADS)
+    {
+      warmUpThreads = (warmUpThreads < 1) ? 1 : BOSSL_MAX_VAL_THREADS;
+    }
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    _setupSSLLocks();
+#endif
+    ks_warmUp(BOSSL_pubKeys,  (int)warmUpThreads);
+    ks_warmUp(BOSSL_privKeys, (int)warmUpThreads);
     sca_debugLog(LOG_INFO, "The internal key initialized storage holds (%u "
                            "private and %u public keys)!\n",
                            BOSSL_privKeys->size, BOSSL_pubKeys->size);
+    if (BOSSL_valThreads > 0)
+    {
+      // Not being able to start the pool is not fatal, validation will be
+      // performed serially.
+      _startValPool(BOSSL_valThreads);
+    }
   }
   else
   {
@@ -479,16 +634,11 @@ int release(sca_status_t* status)
 {
   if (BOSSL_initialized)
   {
-    ks_empty(BOSSL_pubKeys);
-    free(BOSSL_pubKeys->head);
-    BOSSL_pubKeys->head = NULL;
-    free(BOSSL_pubKeys);
+    _stopValPool();
+    ks_release(BOSSL_pubKeys);
     BOSSL_pubKeys = NULL;
 
-    ks_empty(BOSSL_privKeys);
-    free(BOSSL_privKeys->head);
-    BOSSL_privKeys->head = NULL;
-    free(BOSSL_privKeys);
+    ks_release(BOSSL_privKeys);
     BOSSL_privKeys = NULL;
 
     BOSSL_initialized = false;
@@ -581,28 +731,427 @@ static unsigned char* _createSha256Digest(const unsigned char* message,
 }
 
 /**
- * Perform BGPSEC path validation. This function required the keys to be
- * pre-registered to perform the validation.
- * The caller manages the memory and MUST assure the memory is intact until
- * the function returns.
+ * Verify the signature of one segment using the keys registered for it.
+ * This function is called concurrently by the validation workers and
+ * therefore only uses the given data and its own stack.
  *
- * The following error status codes can be set:
+ * @param seg The prepared segment.
+ * @param idx The index of the segment within the path (used for logging).
+ * @param status The status flags will be added to this value.
  *
- * API_STATUS_ERR_USER1: The hash input could not be generated
- * API_STATUS_ERR_INVALID_KEY: The hex key retrieved from the storage is NULL.
- * API_STATUS_NO_DATA: No data to validate passed.
- * API_STATUS_INFO_KEY_NOTFOUND: One or more of the keys could not be found.
- * API_STATUS_INFO_SIGNATURE: One or more signatures could not be validated.
+ * @return API_VALRESULT_VALID or API_VALRESULT_INVALID
+ *
+ * @since 0.3.1.0
+ */
+static int _verifySegment(BOSSL_ValSegment* seg, int idx, sca_status_t* status)
+{
+  int retVal = API_VALRESULT_INVALID;
+  int ecIdx  = 0;
+  // Temporary space for the generated message digest (hash)
+  u_int8_t hashDigest[SHA256_DIGEST_LENGTH];
+
+  // Generate the hash (messageDigest that will be signed.)
+  _createSha256Digest (seg->hashMessage, seg->hashMessageLength,
+                       (u_int8_t*)&hashDigest);
+
+  if (sca_getCurrentLogLevel() >= LOG_DEBUG)
+  {
+    sca_debugLog(LOG_DEBUG, "\nHash(validate):");
+    printHex(seg->hashMessageLength, seg->hashMessage);
+    sca_debugLog(LOG_DEBUG, "\nDigest(validate):");
+    printHex(SHA256_DIGEST_LENGTH, (u_int8_t*)hashDigest);
+  }
+
+  for (ecIdx=0; ecIdx < seg->noKeys && retVal==API_VALRESULT_INVALID; ecIdx++)
+  {
+    if (seg->ecdsa_key[ecIdx] != NULL)
+    { // Toggle through the keys
+      /* verify the signature */
+      if (ECDSA_verify(0, hashDigest, SHA256_DIGEST_LENGTH,
+                       seg->signature, seg->sigLength, seg->ecdsa_key[ecIdx])
+         == 1)
+      {
+        retVal = API_VALRESULT_VALID;
+        sca_debugLog(LOG_DEBUG, "\033[92m""stack[%d] VERIFY SUCCESS""\033[0m \n", idx+1);
+      }
+      else
+      {
+        retVal = API_VALRESULT_INVALID;
+        sca_debugLog(LOG_DEBUG,
+            "\033[91m""stack[%d] VERIFY FAILED (SKI: %02X%02X%02X%02X)""\033[0m \n",
+            idx+1, seg->sigSeg->ski[0], seg->sigSeg->ski[1],
+            seg->sigSeg->ski[2], seg->sigSeg->ski[3]);
+        break;
+      }
+    }
+    else
+    {
+      // Most likely a registration error!
+      *status |= API_STATUS_ERR_INVLID_KEY;
+      sca_debugLog(LOG_WARNING, "The key storage returned a NULL eckey\n");
+    }
+  }
+
+  if (retVal == API_VALRESULT_INVALID)
+  {
+    *status |= API_STATUS_INFO_SIGNATURE;
+    sca_debugLog(LOG_DEBUG, "[%s:%d] verify failed and quit: ret:%d idx:%d, ecIdx:%d\n",
+        __FUNCTION__, __LINE__, retVal, idx, ecIdx );
+  }
+
+  return retVal;
+}
+
+/**
+ * Remove the given job from the pool queue if it is still queued. The caller
+ * MUST hold the pool mutex.
  *
+ * @param job The job to be removed.
  *
- * @param data This structure contains all necessary information to perform
- *             the path validation. The status flag will contain more
- *             information
+ * @since 0.3.1.0
+ */
+static void _dequeueValJob(BOSSL_ValJob* job)
+{
+  BOSSL_ValJob* prev = NULL;
+  BOSSL_ValJob* curr = BOSSL_pool.head;
+
+  while (curr != NULL && curr != job)
+  {
+    prev = curr;
+    curr = curr->nextJob;
+  }
+
+  if (curr != NULL)
+  {
+    if (prev == NULL)
+    {
+      BOSSL_pool.head = curr->nextJob;
+    }
+    else
+    {
+      prev->nextJob = curr->nextJob;
+    }
+    if (BOSSL_pool.tail == curr)
+    {
+      BOSSL_pool.tail = prev;
+    }
+    curr->nextJob = NULL;
+  }
+}
+
+/**
+ * Claim and verify segments of the given job until all segments are claimed
+ * or one of the segments failed. Once a segment fails no further segments
+ * are claimed by any thread (early cancel).
  *
- * @return API_VALRESULT_VALID(1) or API_VALRESULT_INVALID(0). For 0 refer to
- *          the status code. Internal errors result in invalid.
+ * @param job The job to work on.
+ *
+ * @since 0.3.1.0
  */
-int validate(SCA_BGPSecValidationData* data)
+static void _runValJob(BOSSL_ValJob* job)
+{
+  sca_status_t status = API_STATUS_OK;
+  int idx;
+
+  pthread_mutex_lock(&BOSSL_pool.mutex);
+  while (!job->failed && job->next < job->noSegments)
+  {
+    idx = job->next++;
+    pthread_mutex_unlock(&BOSSL_pool.mutex);
+
+    status = API_STATUS_OK;
+    int result = _verifySegment(&job->segments[idx], idx, &status);
+
+    pthread_mutex_lock(&BOSSL_pool.mutex);
+    job->status |= status;
+    if (result != API_VALRESULT_VALID)
+    {
+      job->failed = true;
+    }
+  }
+  pthread_mutex_unlock(&BOSSL_pool.mutex);
+}
+
+/**
+ * The validation worker thread. It joins the first queued job and removes it
+ * from the queue once no more segments can be claimed.
+ *
+ * @param arg not used.
+ *
+ * @return NULL
+ *
+ * @since 0.3.1.0
+ */
+static void* _valWorker(void* arg)
+{
+  BOSSL_ValJob* job = NULL;
+
+  pthread_mutex_lock(&BOSSL_pool.mutex);
+  while (!BOSSL_pool.shutdown)
+  {
+    if (BOSSL_pool.head == NULL)
+    {
+      pthread_cond_wait(&BOSSL_pool.jobCond, &BOSSL_pool.mutex);
+      continue;
+    }
+
+    job = BOSSL_pool.head;
+    job->users++;
+    pthread_mutex_unlock(&BOSSL_pool.mutex);
+
+    _runValJob(job);
+
+    pthread_mutex_lock(&BOSSL_pool.mutex);
+    // The job is either finished or cancelled, no other worker needs to join.
+    _dequeueValJob(job);
+    job->users--;
+    if (job->users == 0)
+    {
+      pthread_cond_broadcast(&BOSSL_pool.doneCond);
+    }
+  }
+  pthread_mutex_unlock(&BOSSL_pool.mutex);
+
+  return NULL;
+}
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+/** The OpenSSL locks, OpenSSL prior 1.1.0 is only thread safe if the
+ * application provides locking callbacks. */
+static pthread_mutex_t* BOSSL_sslLocks = NULL;
+
+/**
+ * OpenSSL locking callback.
+ *
+ * @since 0.3.1.0
+ */
+static void _sslLockCallback(int mode, int type, const char* file, int line)
+{
+  if (mode & CRYPTO_LOCK)
+  {
+    pthread_mutex_lock(&BOSSL_sslLocks[type]);
+  }
+  else
+  {
+    pthread_mutex_unlock(&BOSSL_sslLocks[type]);
+  }
+}
+
+/**
+ * OpenSSL thread id callback.
+ *
+ * @since 0.3.1.0
+ */
+static void _sslThreadIdCallback(CRYPTO_THREADID* tid)
+{
+  CRYPTO_THREADID_set_numeric(tid, (unsigned long)pthread_self());
+}
+
+/**
+ * Install the OpenSSL locking callbacks unless the application did so
+ * already.
+ *
+ * @since 0.3.1.0
+ */
+static void _setupSSLLocks()
+{
+  int idx;
+
+  if (CRYPTO_get_locking_callback() == NULL && BOSSL_sslLocks == NULL)
+  {
+    BOSSL_sslLocks = malloc(sizeof(pthread_mutex_t) * CRYPTO_num_locks());
+    if (BOSSL_sslLocks != NULL)
+    {
+      for (idx = 0; idx < CRYPTO_num_locks(); idx++)
+      {
+        pthread_mutex_init(&BOSSL_sslLocks[idx], NULL);
+      }
+      CRYPTO_THREADID_set_callback(_sslThreadIdCallback);
+      CRYPTO_set_locking_callback(_sslLockCallback);
+    }
+  }
+}
+#endif
+
+/**
+ * Start the validation worker pool.
+ *
+ * @param noThreads The number of worker threads.
+ *
+ * @return true if at least one worker thread could be started.
+ *
+ * @since 0.3.1.0
+ */
+static bool _startValPool(int noThreads)
+{
+  int idx;
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+  _setupSSLLocks();
+#endif
+  memset(&BOSSL_pool, 0, sizeof(BOSSL_ValPool));
+  pthread_mutex_init(&BOSSL_pool.mutex, NULL);
+  pthread_cond_init(&BOSSL_pool.jobCond, NULL);
+  pthread_cond_init(&BOSSL_pool.doneCond, NULL);
+  BOSSL_pool.threads = malloc(sizeof(pthread_t) * noThreads);
+
+  for (idx = 0; BOSSL_pool.threads != NULL && idx < noThreads; idx++)
+  {
+    if (pthread_create(&BOSSL_pool.threads[idx], NULL, _valWorker, NULL) != 0)
+    {
+      sca_debugLog(LOG_WARNING, "Could only start %d of %d validation "
+                                "threads!\n", idx, noThreads);
+      break;
+    }
+    BOSSL_pool.noThreads++;
+  }
+
+  if (BOSSL_pool.noThreads == 0)
+  {
+    sca_debugLog(LOG_WARNING, "Validation worker pool could not be started, "
+                              "validation is performed serially!\n");
+    _stopValPool();
+  }
+  else
+  {
+    sca_debugLog(LOG_INFO, "Started %d validation worker threads.\n",
+                 BOSSL_pool.noThreads);
+  }
+
+  return BOSSL_pool.noThreads > 0;
+}
+
+/**
+ * Stop all validation worker threads and release the pool resources. This
+ * function MUST NOT be called while validations are in progress.
+ *
+ * @since 0.3.1.0
+ */
+static void _stopValPool()
+{
+  int idx;
+
+  if (BOSSL_pool.threads != NULL)
+  {
+    pthread_mutex_lock(&BOSSL_pool.mutex);
+    BOSSL_pool.shutdown = true;
+    pthread_cond_broadcast(&BOSSL_pool.jobCond);
+    pthread_mutex_unlock(&BOSSL_pool.mutex);
+
+    for (idx = 0; idx < BOSSL_pool.noThreads; idx++)
+    {
+      pthread_join(BOSSL_pool.threads[idx], NULL);
+    }
+
+    free(BOSSL_pool.threads);
+    pthread_cond_destroy(&BOSSL_pool.doneCond);
+    pthread_cond_destroy(&BOSSL_pool.jobCond);
+    pthread_mutex_destroy(&BOSSL_pool.mutex);
+    memset(&BOSSL_pool, 0, sizeof(BOSSL_ValPool));
+  }
+}
+
+/**
+ * Queue the given job in the worker pool. The job MUST stay intact until
+ * _completeValJob returns.
+ *
+ * @param job The job, the segments must be set.
+ *
+ * @since 0.3.1.0
+ */
+static void _submitValJob(BOSSL_ValJob* job)
+{
+  job->next    = 0;
+  job->failed  = false;
+  job->status  = API_STATUS_OK;
+  job->users   = 1;
+  job->nextJob = NULL;
+
+  pthread_mutex_lock(&BOSSL_pool.mutex);
+  if (BOSSL_pool.tail == NULL)
+  {
+    BOSSL_pool.head = job;
+  }
+  else
+  {
+    BOSSL_pool.tail->nextJob = job;
+  }
+  BOSSL_pool.tail = job;
+  pthread_cond_broadcast(&BOSSL_pool.jobCond);
+  pthread_mutex_unlock(&BOSSL_pool.mutex);
+}
+
+/**
+ * Work on the given job until all its segments are claimed and wait until
+ * all workers left the job.
+ *
+ * @param job The submitted job.
+ * @param status The status flags will be added to this value.
+ *
+ * @return API_VALRESULT_VALID or API_VALRESULT_INVALID
+ *
+ * @since 0.3.1.0
+ */
+static int _completeValJob(BOSSL_ValJob* job, sca_status_t* status)
+{
+  _runValJob(job);
+
+  pthread_mutex_lock(&BOSSL_pool.mutex);
+  _dequeueValJob(job);
+  job->users--;
+  // The job is owned by the caller, wait until all workers are done with it.
+  while (job->users > 0)
+  {
+    pthread_cond_wait(&BOSSL_pool.doneCond, &BOSSL_pool.mutex);
+  }
+  pthread_mutex_unlock(&BOSSL_pool.mutex);
+
+  *status |= job->status;
+
+  return job->failed ? API_VALRESULT_INVALID : API_VALRESULT_VALID;
+}
+
+/**
+ * Verify all segments one after the other.
+ *
+ * @param segments The prepared segments.
+ * @param noSegments The number of segments.
+ * @param status The status flags will be added to this value.
+ *
+ * @return API_VALRESULT_VALID or API_VALRESULT_INVALID
+ *
+ * @since 0.3.1.0
+ */
+static int _validateSerial(BOSSL_ValSegment* segments, int noSegments,
+                           sca_status_t* status)
+{
+  int retVal = API_VALRESULT_VALID;
+  int idx;
+
+  for (idx = 0; idx < noSegments; idx++)
+  {
+    retVal = _verifySegment(&segments[idx], idx, status);
+    if (retVal == API_VALRESULT_INVALID)
+    {
+      break; // No further validation needed
+    }
+  }
+
+  return retVal;
+}
+
+/**
+ * Check the given data and generate the hash message if none was generated
+ * prior.
+ *
+ * @param data The validation data.
+ *
+ * @return API_VALRESULT_VALID if the signatures can be verified, otherwise
+ *         API_VALRESULT_INVALID (check status)
+ *
+ * @since 0.3.1.0
+ */
+static int _prepareValidation(SCA_BGPSecValidationData* data)
 {
   // @TODO: Currently we only deal with the first validation data result.
   //       It needs to be modified in such that it uses both results [0] and [1]
@@ -640,116 +1189,322 @@ int validate(SCA_BGPSecValidationData* data)
     }
   }
 
+  return retVal;
+}
+
+/**
+ * Retrieve the EC keys for the given ASN and SKI. If a key cache is given,
+ * the storage is only asked once per ASN / SKI (also for missing keys).
+ *
+ * @param cache The key cache of a batch validation or NULL.
+ * @param ski The SKI of the key.
+ * @param asn The ASN of the key (network format).
+ * @param noKeys OUT - the number of keys.
+ * @param status OUT - the status of the key storage lookup.
+ *
+ * @return the keys or NULL if not found.
+ *
+ * @since 0.3.1.0
+ */
+static EC_KEY** _getKeys(BOSSL_KeyCache* cache, u_int8_t* ski, u_int32_t asn,
+                         u_int16_t* noKeys, sca_status_t* status)
+{
+  BOSSL_KeyCacheEntry* entry = NULL;
+  u_int32_t hash;
+  u_int32_t skiPart;
+
+  if (cache == NULL)
+  {
+    return (EC_KEY**)ks_getKey(BOSSL_pubKeys, ski, asn, noKeys, ks_eckey_e,
+                               status);
+  }
+
+  memcpy(&skiPart, ski, sizeof(u_int32_t));
+  hash = ((asn ^ skiPart) * 0x9E3779B1) >> 7;
+  for (;; hash++)
+  {
+    entry = &cache->entries[hash & cache->mask];
+    if (entry->ski == NULL)
+    {
+      // Not yet looked up.
+      entry->ski    = ski;
+      entry->asn    = asn;
+      entry->noKeys = 0;
+      entry->keys   = (EC_KEY**)ks_getKey(BOSSL_pubKeys, ski, asn,
+                                          &entry->noKeys, ks_eckey_e,
+                                          &entry->status);
+      cache->lookups++;
+      break;
+    }
+    if (entry->asn == asn && memcmp(entry->ski, ski, SKI_LENGTH) == 0)
+    {
+      break;
+    }
+  }
+
+  *noKeys = entry->noKeys;
+  *status = entry->status;
+  return entry->keys;
+}
+
+/**
+ * Fill the segments with the signature information and the keys of the
+ * signers. A missing key invalidates the path without doing any crypto. The
+ * caller holds the read lock of the public key storage until the signatures
+ * are verified, the keys are owned by the storage.
+ *
+ * @param data The prepared validation data.
+ * @param segments The segments to be filled, one per signature.
+ * @param cache The key cache of a batch validation or NULL.
+ *
+ * @return API_VALRESULT_VALID if all keys are found, otherwise
+ *         API_VALRESULT_INVALID.
+ *
+ * @since 0.3.1.0
+ */
+static int _prepareSegments(SCA_BGPSecValidationData* data,
+                            BOSSL_ValSegment* segments, BOSSL_KeyCache* cache)
+{
+  int retVal = API_VALRESULT_VALID;
+  u_int32_t* asn        = NULL;
+  u_int16_t  noSegments = data->hashMessage[0]->segmentCount;
+  SCA_HashMessagePtr* hmPtr = NULL;
+  sca_status_t keyStatus;
+  int idx = 0;
+
+  for (; idx < noSegments; idx++)
+  {
+    hmPtr = data->hashMessage[0]->hashMessageValPtr[idx];
+    // We want to have the signer key, This will be found in the next
+    // path segment.
+    if (idx+1 < noSegments)
+    {
+      asn = (u_int32_t*)data->hashMessage[0]->hashMessageValPtr[idx+1]->hashMessagePtr;
+    }
+    else
+    {
+      // Jump to the origin AS
+      asn = (u_int32_t*)(hmPtr->hashMessagePtr+6);
+    }
+    segments[idx].sigSeg = (SCA_BGPSEC_SignatureSegment*)hmPtr->signaturePtr;
+    segments[idx].hashMessage       = hmPtr->hashMessagePtr;
+    segments[idx].hashMessageLength = hmPtr->hashMessageLength;
+    segments[idx].signature = hmPtr->signaturePtr
+                              + sizeof(SCA_BGPSEC_SignatureSegment);
+    segments[idx].sigLength = ntohs(segments[idx].sigSeg->siglen);
+    segments[idx].noKeys    = 0;
+
+    /* The OpenSSL encoded key. */
+    keyStatus = API_STATUS_OK;
+    segments[idx].ecdsa_key = _getKeys(cache, segments[idx].sigSeg->ski, *asn,
+                                       &segments[idx].noKeys, &keyStatus);
+    data->status |= keyStatus;
+    if (segments[idx].ecdsa_key == NULL)
+    {
+      retVal = API_VALRESULT_INVALID;
+      data->status |= API_STATUS_INFO_KEY_NOTFOUND;
+      sca_debugLog(LOG_DEBUG,
+          "\033[91m""NO KEY -> VERIFY FAILED (SKI: %02X%02X%02X%02X)""\033[0m \n",
+                segments[idx].sigSeg->ski[0], segments[idx].sigSeg->ski[1],
+                segments[idx].sigSeg->ski[2], segments[idx].sigSeg->ski[3]);
+      break; // No further validation needed
+    }
+  }
+
+  return retVal;
+}
+
+/**
+ * Perform BGPSEC path validation. This function required the keys to be
+ * pre-registered to perform the validation.
+ * The caller manages the memory and MUST assure the memory is intact until
+ * the function returns.
+ *
+ * The following error status codes can be set:
+ *
+ * API_STATUS_ERR_USER1: The hash input could not be generated
+ * API_STATUS_ERR_INVALID_KEY: The hex key retrieved from the storage is NULL.
+ * API_STATUS_NO_DATA: No data to validate passed.
+ * API_STATUS_INFO_KEY_NOTFOUND: One or more of the keys could not be found.
+ * API_STATUS_INFO_SIGNATURE: One or more signatures could not be validated.
+ *
+ *
+ * @param data This structure contains all necessary information to perform
+ *             the path validation. The status flag will contain more
+ *             information
+ *
+ * @return API_VALRESULT_VALID(1) or API_VALRESULT_INVALID(0). For 0 refer to
+ *          the status code. Internal errors result in invalid.
+ */
+int validate(SCA_BGPSecValidationData* data)
+{
+  int retVal = _prepareValidation(data);
+
   // Now perform validation
   if (retVal == API_VALRESULT_VALID)
   {
-    // Now we can validate each signature -> This can be multi threaded
-    // in this case the variables below need to be declared in each thread
-    // separately.
-    u_int32_t* asn       = NULL;
-    EC_KEY**   ecdsa_key = NULL;
-    u_int8_t*  signature = NULL;
-    u_int16_t  sigLength = 0;
-    SCA_BGPSEC_SignatureSegment* sigSeg = NULL;
-    int idx = 0;
+    u_int16_t  noSegments = data->hashMessage[0]->segmentCount;
+    BOSSL_ValSegment  stackSegments[BOSSL_STACK_SEGMENTS];
+    BOSSL_ValSegment* segments = stackSegments;
+    BOSSL_ValJob      job;
 
-    u_int16_t noKeys = 0;
-    int ecIdx = 0;
-
-    // Temporary space for the generated message digest (hash)
-    u_int8_t hashDigest[SHA256_DIGEST_LENGTH];
+    if (noSegments > BOSSL_STACK_SEGMENTS)
+    {
+      segments = malloc(sizeof(BOSSL_ValSegment) * noSegments);
+      if (segments == NULL)
+      {
+        data->status |= API_STATUS_ERR_INSUF_BUFFER;
+        return API_VALRESULT_INVALID;
+      }
+    }
 
-    for (; idx < data->hashMessage[0]->segmentCount; idx++)
+    ks_readLock(BOSSL_pubKeys);
+    retVal = _prepareSegments(data, segments, NULL);
+    if (retVal == API_VALRESULT_VALID)
     {
-      // We want to have the signer key, This will be found in the next
-      // path segment.
-      if (idx+1 < data->hashMessage[0]->segmentCount)
+      if (   (BOSSL_pool.noThreads > 0)
+          && (noSegments >= BOSSL_MIN_PARALLEL_SEGMENTS))
       {
-        asn = (u_int32_t*)data->hashMessage[0]->hashMessageValPtr[idx+1]->hashMessagePtr;
+        job.segments   = segments;
+        job.noSegments = noSegments;
+        _submitValJob(&job);
+        retVal = _completeValJob(&job, &data->status);
       }
       else
       {
-        // Jump to the origin AS
-        asn = (u_int32_t*)(data->hashMessage[0]->hashMessageValPtr[idx]->hashMessagePtr+6);
+        retVal = _validateSerial(segments, noSegments, &data->status);
       }
-      sigSeg = (SCA_BGPSEC_SignatureSegment*)data->hashMessage[0]->hashMessageValPtr[idx]->signaturePtr;
+    }
+    ks_unlock(BOSSL_pubKeys);
 
-      /* The OpenSSL encoded key. */
-      ecdsa_key = (EC_KEY**)ks_getKey(BOSSL_pubKeys, sigSeg->ski, *asn,
-                            &noKeys, ks_eckey_e, &data->status);
-      if (ecdsa_key != NULL)
-      {
-        // Generate the hash (messageDigest that will be signed.)
-        _createSha256Digest (
-                 data->hashMessage[0]->hashMessageValPtr[idx]->hashMessagePtr,
-                 data->hashMessage[0]->hashMessageValPtr[idx]->hashMessageLength,
-                 (u_int8_t*)&hashDigest);
+    if (segments != stackSegments)
+    {
+      free(segments);
+    }
+  }
 
-        if (sca_getCurrentLogLevel() >= LOG_DEBUG)
-        {
-          sca_debugLog(LOG_DEBUG, "\nHash(validate):");
-          printHex(data->hashMessage[0]->hashMessageValPtr[idx]->hashMessageLength,
-              data->hashMessage[0]->hashMessageValPtr[idx]->hashMessagePtr);
-          sca_debugLog(LOG_DEBUG, "\nDigest(validate):");
-          printHex(SHA256_DIGEST_LENGTH, (u_int8_t*)hashDigest);
-        }
+  return retVal;
+}
 
-        signature = data->hashMessage[0]->hashMessageValPtr[idx]->signaturePtr
-                    + sizeof(SCA_BGPSEC_SignatureSegment);
-        // find the signature:
-        sigLength = ntohs(sigSeg->siglen);
+/**
+ * Perform BGPSEC path validation of multiple updates. First the hash
+ * messages of all updates are generated and the keys of all signers are
+ * retrieved, each ASN / SKI only once per batch. Then all signatures are
+ * verified in bulk - using the worker pool if configured. Each update is
+ * cancelled individually at its first invalid signature.
+ *
+ * @param count The number of data elements in the given array
+ * @param data Array containing the data objects to be validated.
+ * @param results Array that will contain the validation result of each data
+ *                object (see validate).
+ *
+ * @return API_SUCCESS or API_FAILURE if at least one data object has an
+ *         error bit set in its status.
+ *
+ * @since 0.3.1.0
+ */
+int validateBatch(int count, SCA_BGPSecValidationData** data, int* results)
+{
+  int               retVal     = API_SUCCESS;
+  int               idx        = 0;
+  int               noSegments = 0;
+  BOSSL_ValSegment* segments   = NULL;
+  BOSSL_ValJob*     jobs       = NULL;
+  BOSSL_KeyCache    cache;
+  bool              usePool    = BOSSL_pool.noThreads > 0;
+
+  memset(&cache, 0, sizeof(BOSSL_KeyCache));
+
+  // Generate all hash messages and count the segments
+  for (idx = 0; idx < count; idx++)
+  {
+    results[idx] = _prepareValidation(data[idx]);
+    if (results[idx] == API_VALRESULT_VALID)
+    {
+      noSegments += data[idx]->hashMessage[0]->segmentCount;
+    }
+  }
 
-        retVal = API_VALRESULT_INVALID;
-        for (ecIdx=0; ecIdx < noKeys && retVal==API_VALRESULT_INVALID; ecIdx++)
+  if (noSegments > 0)
+  {
+    // The key cache is at most half full.
+    cache.mask = 15;
+    while (cache.mask < noSegments * 2)
+    {
+      cache.mask = (cache.mask << 1) | 1;
+    }
+    cache.entries = calloc(cache.mask + 1, sizeof(BOSSL_KeyCacheEntry));
+    segments      = malloc(sizeof(BOSSL_ValSegment) * noSegments);
+    jobs          = malloc(sizeof(BOSSL_ValJob) * count);
+    if (cache.entries == NULL || segments == NULL || jobs == NULL)
+    {
+      for (idx = 0; idx < count; idx++)
+      {
+        if (results[idx] == API_VALRESULT_VALID)
         {
-          if (ecdsa_key[ecIdx] != NULL)
-          { // Toggle through the keys
-            /* verify the signature */
-            if (ECDSA_verify(0, hashDigest, SHA256_DIGEST_LENGTH,
-                             signature, sigLength, ecdsa_key[ecIdx])
-               == 1)
-            {
-              retVal = API_VALRESULT_VALID;
-              sca_debugLog(LOG_DEBUG, "\033[92m""stack[%d] VERIFY SUCCESS""\033[0m \n", idx+1);
-            }
-            else
-            {
-              retVal = API_VALRESULT_INVALID;
-              sca_debugLog(LOG_DEBUG,
-                  "\033[91m""stack[%d] VERIFY FAILED (SKI: %02X%02X%02X%02X)""\033[0m \n",
-                  idx+1,
-                  sigSeg->ski[0], sigSeg->ski[1], sigSeg->ski[2], sigSeg->ski[3]);
-              break;
-            }
-          }
-          else
-          {
-            // Most likely a registration error!
-            data->status |= API_STATUS_ERR_INVLID_KEY;
-            sca_debugLog(LOG_WARNING, "The key storage returned a NULL eckey\n");
-          }
+          data[idx]->status |= API_STATUS_ERR_INSUF_BUFFER;
+          results[idx] = API_VALRESULT_INVALID;
         }
+      }
+      noSegments = 0;
+    }
+  }
 
-        if (retVal == API_VALRESULT_INVALID)
-        {
-          data->status |= API_STATUS_INFO_SIGNATURE;
-          sca_debugLog(LOG_DEBUG, "[%s:%d] verify failed and quit: ret:%d idx:%d, ecIdx:%d\n",
-              __FUNCTION__, __LINE__, retVal, idx, ecIdx );
-          break; // No further validation needed
-        }
+  if (noSegments > 0)
+  {
+    // Retrieve all keys, they are kept until all signatures are verified.
+    ks_readLock(BOSSL_pubKeys);
+    noSegments = 0;
+    for (idx = 0; idx < count; idx++)
+    {
+      jobs[idx].segments   = NULL;
+      jobs[idx].noSegments = 0;
+      if (results[idx] == API_VALRESULT_VALID)
+      {
+        jobs[idx].segments   = segments + noSegments;
+        jobs[idx].noSegments = data[idx]->hashMessage[0]->segmentCount;
+        noSegments          += jobs[idx].noSegments;
+        results[idx] = _prepareSegments(data[idx], jobs[idx].segments, &cache);
       }
-      else
+    }
+    sca_debugLog(LOG_DEBUG, "Batch of %d updates with %d signatures required "
+                            "%u key lookups\n", count, noSegments,
+                            cache.lookups);
+
+    // Verify the signatures, first hand all jobs to the pool, then help
+    // processing them in the same order.
+    for (idx = 0; usePool && idx < count; idx++)
+    {
+      if (results[idx] == API_VALRESULT_VALID)
       {
-        retVal = API_VALRESULT_INVALID;
-        data->status |= API_STATUS_INFO_KEY_NOTFOUND;
-        sca_debugLog(LOG_DEBUG,
-            "\033[91m""NO KEY -> VERIFY FAILED (SKI: %02X%02X%02X%02X)""\033[0m \n",
-                  sigSeg->ski[0], sigSeg->ski[1], sigSeg->ski[2], sigSeg->ski[3]);
-        break; // No further validation needed
+        _submitValJob(&jobs[idx]);
       }
     }
+    for (idx = 0; idx < count; idx++)
+    {
+      if (results[idx] == API_VALRESULT_VALID)
+      {
+        results[idx] = usePool
+             ? _completeValJob(&jobs[idx], &data[idx]->status)
+             : _validateSerial(jobs[idx].segments, jobs[idx].noSegments,
+                               &data[idx]->status);
+      }
+    }
+    ks_unlock(BOSSL_pubKeys);
+  }
+
+  for (idx = 0; idx < count; idx++)
+  {
+    if (data[idx] == NULL || (data[idx]->status & API_STATUS_ERROR_MASK) != 0)
+    {
+      retVal = API_FAILURE;
+    }
   }
 
+  free(cache.entries);
+  free(segments);
+  free(jobs);
+
   return retVal;
 }
 
@@ -830,6 +1585,8 @@ static int _sign(SCA_BGPSecSignData* bgpsec_data)
     // First find the key
     u_int16_t noKeys = 0;
     bgpsec_data->status = API_STATUS_OK;
+    // The key stays owned by the storage, keep it until the signing is done.
+    ks_readLock(BOSSL_privKeys);
     EC_KEY** ec_keys = (EC_KEY**)ks_getKey(BOSSL_privKeys, bgpsec_data->ski,
         bgpsec_data->myHost->asn, &noKeys,
         ks_eckey_e, &bgpsec_data->status);
@@ -936,6 +1693,7 @@ static int _sign(SCA_BGPSecSignData* bgpsec_data)
         retVal = API_SUCCESS;
       }
     }
+    ks_unlock(BOSSL_privKeys);
   }
 
   if (bgpsec_data != NULL)
@@ -1192,6 +1950,7 @@ bool isAlgorithmSupported(u_int8_t algoID)
 
   compAPI.sign                 = sign;
   compAPI.validate             = validate;
+  compAPI.validateBatch        = validateBatch;
 
   compAPI.freeHashMessage      = freeHashMessage;
   compAPI.freeSignature        = freeSignature;
@@ -55,30 +55,124 @@
  */
 #include <stdbool.h>
 #include <syslog.h>
-#include <uthash.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <openssl/ec.h>
 #include <openssl/x509.h>
 #include "../srx/srxcryptoapi.h"
 #include "key_storage.h"
 
-#define KS_BUCKETS 256
-
 /**
- * REturn the bucket of the given ASN
+ * Calculate the hash value of the given key identifier. The SKI is a SHA-1 
+ * value but the ASN is not, therefore all values are mixed (murmur3 
+ * finalizer) to spread ASN ranges over the complete table.
  * 
  * @param asn The AS number - format not important.
+ * @param ski The SKI of the key (SKI_LENGTH bytes)
+ * @param algoID The algorithm ID of the key.
+ * 
+ * @return The hash value.
  * 
- * @return The bucket number of the ASN
+ * @since 0.3.1.0
  */
-static u_int8_t _ks_getBucket(u_int32_t asn)
-{      
-  u_int8_t bucket = (asn >> 24) + ((asn >> 16) & 0xFF) + ((asn >> 8) & 0xFF)
-                    + (asn & 0xFF);
-  bucket = bucket & 255;
-  return bucket;
+static u_int32_t _ks_hash(u_int32_t asn, u_int8_t* ski, u_int8_t algoID)
+{
+  u_int64_t hash = ((u_int64_t)algoID << 32) | asn;
+  u_int32_t word = 0;
+  int idx;
+  
+  for (idx = 0; idx + sizeof(u_int32_t) <= SKI_LENGTH; 
+       idx += sizeof(u_int32_t))
+  {
+    memcpy(&word, ski + idx, sizeof(u_int32_t));
+    hash ^= word;
+    hash *= 0x9E3779B97F4A7C15ULL;
+    hash ^= hash >> 29;
+  }
+  
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53ULL;
+  hash ^= hash >> 33;
+  
+  return (u_int32_t)hash;
+}
+
+/**
+ * Find the element of the given key identifier.
+ * 
+ * @param storage The key storage.
+ * @param asn The AS number (network format).
+ * @param ski The SKI of the key (SKI_LENGTH bytes)
+ * @param algoID The algorithm ID of the key.
+ * @param hash The hash value of the key identifier (see _ks_hash)
+ * @param link OUT - if not NULL it receives the pointer that points to the 
+ *             found element (used for unlinking).
+ * 
+ * @return The element or NULL if not found.
+ * 
+ * @since 0.3.1.0
+ */
+static KS_Key_Element* _ks_find(KeyStorage* storage, u_int32_t asn, 
+                                u_int8_t* ski, u_int8_t algoID, u_int32_t hash,
+                                KS_Key_Element*** link)
+{
+  KS_Key_Element** ptr = &storage->table[hash & (storage->tableSize - 1)];
+  
+  while (*ptr != NULL)
+  {
+    if (   ((*ptr)->hash == hash) && ((*ptr)->asn == asn) 
+        && ((*ptr)->algoID == algoID) 
+        && (memcmp((*ptr)->ski, ski, SKI_LENGTH) == 0))
+    {
+      break;
+    }
+    ptr = &(*ptr)->next;
+  }
+  
+  if (link != NULL)
+  {
+    *link = ptr;
+  }
+  
+  return *ptr;
 }
 
+/**
+ * Double the size of the hash table. If no memory is available the table 
+ * keeps its size (the chains just get longer).
+ * 
+ * @param storage The key storage.
+ * 
+ * @since 0.3.1.0
+ */
+static void _ks_grow(KeyStorage* storage)
+{
+  u_int32_t        newSize  = storage->tableSize << 1;
+  KS_Key_Element** newTable = calloc(newSize, sizeof(KS_Key_Element*));
+  KS_Key_Element*  elem     = NULL;
+  u_int32_t        idx;
+  
+  if (newTable != NULL)
+  {
+    for (idx = 0; idx < storage->tableSize; idx++)
+    {
+      while (storage->table[idx] != NULL)
+      {
+        elem = storage->table[idx];
+        storage->table[idx] = elem->next;
+        elem->next = newTable[elem->hash & (newSize - 1)];
+        newTable[elem->hash & (newSize - 1)] = elem;
+      }
+    }
+    free(storage->table);
+    storage->table     = newTable;
+    storage->tableSize = newSize;
+  }
+}
 
 /**
  * Create a clone of the provided key.
@@ -90,9 +184,9 @@ static u_int8_t _ks_getBucket(u_int32_t asn)
 static BGPSecKey* _ks_clone(BGPSecKey* key)
 {
   BGPSecKey* clone = malloc(sizeof(BGPSecKey));
-  memset (clone, 0, sizeof(BGPSecKey));
   if (clone != NULL)
   {
+    memset (clone, 0, sizeof(BGPSecKey));
     clone->algoID    = key->algoID;
     clone->asn       = key->asn;
     memcpy(&clone->ski, &key->ski, SKI_LENGTH);
@@ -165,9 +259,43 @@ static EC_KEY* _ks_convertKey(u_int8_t* keyData, u_int16_t keyLength,
   return ec_key;
 }
 
+/**
+ * Acquire the read lock of the storage. It is required for ks_getKey and the
+ * returned keys stay valid as long as the caller holds it. The lock is not
+ * recursive and functions modifying the storage MUST NOT be called while
+ * holding it.
+ * 
+ * @param storage The key storage.
+ * 
+ * @since 0.3.1.0
+ */
+void ks_readLock(KeyStorage* storage)
+{
+  if (storage != NULL)
+  {
+    pthread_rwlock_rdlock(&storage->lock);
+  }
+}
+
+/**
+ * Release the read lock acquired with ks_readLock.
+ * 
+ * @param storage The key storage.
+ * 
+ * @since 0.3.1.0
+ */
+void ks_unlock(KeyStorage* storage)
+{
+  if (storage != NULL)
+  {
+    pthread_rwlock_unlock(&storage->lock);
+  }
+}
+
 /**
  * Retrieve the EC_KEY associated to the given ski and asn. Here the source is
- * ignored.
+ * ignored. The caller MUST hold the read lock (ks_readLock) while calling this
+ * function and using the returned array, the array is owned by the storage.
  * 
  * Possible USER return values:
  * 
@@ -197,72 +325,54 @@ void** ks_getKey(KeyStorage* storage, u_int8_t* ski, u_int32_t asn,
   
   if (myStatus == API_STATUS_OK)
   {
-    // find the correct elem list
-    u_int8_t bucket = _ks_getBucket(asn);    
-    KS_Key_Element* elem = storage->head[bucket];
-    
-    while (elem != NULL)
+    KS_Key_Element* elem = _ks_find(storage, asn, ski, storage->algorithmID,
+                                    _ks_hash(asn, ski, storage->algorithmID),
+                                    NULL);
+    if (elem != NULL)
     {
-      if (elem->asn < asn)
-      {
-        // Move forward in the list
-        elem = elem->next;
-        continue;
-      }
-      if (elem->asn > asn)
-      {
-        // Key Not found
-        myStatus = API_STATUS_INFO_KEY_NOTFOUND;
-        elem = NULL;
-        break;
-      }
-      // ASN Element found - check ski
-      if (memcmp(elem->ski, ski, SKI_LENGTH) != 0)
-      {
-        // No match, move on
-        elem = elem->next;
-        continue;
-      }
-      
       // ASN and ski match
       int idx = 0;
       if (kType == ks_eckey_e) 
       {
         keys = (void**)elem->ec_key;
-      }
-      else
-      {
-        keys = (void**)elem->derKey;
-      }
-
-      if (kType == ks_eckey_e)
-      {
-        for(; idx < elem->noKeys; idx++)
+        // Normally the keys are converted during storing or warm up. Convert
+        // the ones that are still missing, only once and by one thread.
+        if (!__atomic_load_n(&elem->converted, __ATOMIC_ACQUIRE))
         {
-          if (elem->ec_key[idx] != NULL)
+          pthread_mutex_lock(&storage->convLock);
+          for(; !elem->converted && idx < elem->noKeys; idx++)
           {
-            continue;
-          }
-          // Load the key
-          if (elem->derKey[idx] != NULL)
-          {
-            elem->ec_key[idx] = _ks_convertKey(elem->derKey[idx]->keyData,
-                                               elem->derKey[idx]->keyLength,
-                                               storage->isPrivate, &myStatus);
-            if (myStatus & API_STATUS_ERR_NO_DATA)
+            if (elem->ec_key[idx] != NULL)
+            {
+              continue;
+            }
+            // Load the key
+            if (elem->derKey[idx] != NULL)
             {
-              myStatus |= API_STATUS_ERR_USER1;
+              elem->ec_key[idx] = _ks_convertKey(elem->derKey[idx]->keyData,
+                                                 elem->derKey[idx]->keyLength,
+                                                 storage->isPrivate, &myStatus);
+              if (myStatus & API_STATUS_ERR_NO_DATA)
+              {
+                myStatus |= API_STATUS_ERR_USER1;
+              }
+              continue;
             }
-            continue;
+            // DER Key not found
+            myStatus |= API_STATUS_ERR_USER1;
           }
-          // DER Key not found
-          myStatus |= API_STATUS_ERR_USER1;
-        }      
+          // A key that could not be converted will not convert the next time.
+          __atomic_store_n(&elem->converted, true, __ATOMIC_RELEASE);
+          pthread_mutex_unlock(&storage->convLock);
+        }
+      }
+      else
+      {
+        keys = (void**)elem->derKey;
       }
       // Found the key
       *noKeys = elem->noKeys;
-      break;
-    }     
+    }
   }
   
   if (status != NULL)
@@ -295,6 +405,8 @@ static void _ks_freeKey(BGPSecKey* key)
  * Generate a KeyStorage element. All internal memory is allocated using malloc!
  * 
  * @param key The key to be added. Here a copy of the Key will be stored!
+ * @param convert if true then convert the DER key into the EC_KEY
+ * @param isPrivate indicates if the key is a private key.
  * @param status The status of the generation.
  *              API_STATUS_ERR_NO_DATA if the conversion would not be performed.
  * 
@@ -310,8 +422,11 @@ static KS_Key_Element* _ks_createKS_Element(BGPSecKey* key, bool convert,
   {
     memset(elem, 0, sizeof(KS_Key_Element));    
     // Store the minimal information.
-    elem->asn = key->asn;
+    elem->asn    = key->asn;
+    elem->algoID = key->algoID;
     memcpy(elem->ski, key->ski, SKI_LENGTH);
+    elem->hash   = _ks_hash(elem->asn, elem->ski, elem->algoID);
+    elem->converted = convert;
     
     //Currently the key array only will contain one single element.
     elem->noKeys = 1;
@@ -406,33 +521,20 @@ static KS_Key_Element* _ks_createKS_Element(BGPSecKey* key, bool convert,
 }
 
 /**
- * Remove the element from the storage
+ * Remove the element from the storage and free it.
  * 
  * @param storage The key storage
- * @param head The head index.
- * @param elem The element to be removed
+ * @param link The pointer that points to the element to be removed.
  */
-static void _ks_freeKS_Elem(KeyStorage* storage, int head,
-                            KS_Key_Element* elem)
+static void _ks_freeKS_Elem(KeyStorage* storage, KS_Key_Element** link)
 {  
-  storage->size -= elem->noKeys;
- 
-  // Take element out of the element list
-  if (elem->prev != NULL) 
-  {     
-    elem->prev->next = elem->next;
-    elem->prev = NULL;
-  }
-  else
-  { // elem MUST be the head, otherwise it would have a previous 'prev' element
-    storage->head[head] = elem->next; // move head to the next one
-  }
+  KS_Key_Element* elem = *link;
   
-  if (elem->next != NULL)
-  {
-    elem->next->prev = elem->prev;
-    elem->next = NULL;
-  }
+  // Take element out of the hash chain
+  *link = elem->next;
+  elem->next = NULL;
+  storage->size -= elem->noKeys;
+  storage->noElements--;
   
   // Now free the allocated memory
   int kIdx = 0;
@@ -465,10 +567,22 @@ void ks_init(KeyStorage* storage, u_int8_t algoID, bool isPrivate)
   if (storage != NULL)
   {
     storage->algorithmID = algoID;
-    storage->isPrivate = isPrivate;
-    storage->size = 0;
-    storage->head = malloc(sizeof(KS_Key_Element*) * KS_BUCKETS);
-    memset (storage->head, 0, sizeof(KS_Key_Element*) * KS_BUCKETS);
+    storage->isPrivate   = isPrivate;
+    storage->size        = 0;
+    storage->noElements  = 0;
+    storage->table       = calloc(KS_INIT_SIZE, sizeof(KS_Key_Element*));
+    storage->tableSize   = storage->table != NULL ? KS_INIT_SIZE : 0;
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+    // Validation threads hold the read lock most of the time, do not let them
+    // starve key updates.
+    pthread_rwlockattr_setkind_np(&attr,
+                                  PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    pthread_rwlock_init(&storage->lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    pthread_mutex_init(&storage->convLock, NULL);
   }
 }
 
@@ -482,10 +596,13 @@ void ks_release(KeyStorage* storage)
   if (storage != NULL)
   {
     ks_empty(storage);
-    if (storage->head != NULL)
+    if (storage->table != NULL)
     {
-      free (storage->head);
+      free (storage->table);
+      storage->table = NULL;
     }      
+    pthread_mutex_destroy(&storage->convLock);
+    pthread_rwlock_destroy(&storage->lock);
     free(storage);
   }
 }
@@ -502,7 +619,7 @@ void ks_release(KeyStorage* storage)
  * the following USER status can be returned:
  * 
  * API_STATUS_ERR_USER1: Key algorithm ID does not match the storage Algorithm ID
- * API_STATUS_INFO_USER1: Given key was not registered!
+ * API_STATUS_INFO_KEY_NOTFOUND: Given key was not registered!
  * API_STATUS_ERR_NO_DATA: One of the provided parameter was NULL
  * 
  * @param storage The storage where the key is stored in
@@ -519,15 +636,21 @@ int ks_delKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source,
 {
   int retVal = API_SUCCESS; 
   int myStatus = API_STATUS_OK;
-  int             bucket = 0;
-  KS_Key_Element* elem   = NULL;
+  KS_Key_Element** link = NULL;
+  KS_Key_Element*  elem = NULL;
   
   if (storage != NULL && key != NULL)
   {
+    pthread_rwlock_wrlock(&storage->lock);
     if (key->algoID == storage->algorithmID)
     {
-      bucket = _ks_getBucket(key->asn);
-      elem = storage->head[bucket];
+      elem = _ks_find(storage, key->asn, key->ski, key->algoID,
+                      _ks_hash(key->asn, key->ski, key->algoID), &link);
+      if (elem == NULL)
+      {
+        // Key Not found
+        myStatus = API_STATUS_INFO_KEY_NOTFOUND;
+      }
     }
     else
     {
@@ -543,108 +666,83 @@ int ks_delKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source,
     
   if (elem != NULL)
   {
-    bool deleted = false;
-    while (elem != NULL)
+    // ASN and ski match
+    // Now if key has a DER key delete only the DER portion, otherwise delete 
+    // the complete element.
+    if (key->keyData != NULL)
     {
-      if (elem->asn < key->asn)
-      {
-        // Move forward in the list
-        elem = elem->next;
-        continue;
-      }
-      if (elem->asn > key->asn)
-      {
-        // Key Not found
-        myStatus = API_STATUS_INFO_KEY_NOTFOUND;
-        elem = NULL;
-        break;
-      }
-
-      // ASN Element found - check ski
-      if (memcmp(elem->ski, key->ski, SKI_LENGTH) != 0)
+      bool deleted = false;
+      int  idx = 0;
+      //Find the correct key version to delete.
+      for (; idx < elem->noKeys; idx++)
       {
-        // No match, move on
-        elem = elem->next;
-        continue;
-      }
-      
-      // ASN and ski match
-      // Now if key has a DER key delete only the DER portion, otherwise delete 
-      // the complete element.
-      int idx = 0;
-      if (key->keyData != NULL)
-      {
-        //Find the correct key version to delete.
-        for (; idx < elem->noKeys; idx++)
+        if (deleted)
+        {
+          // move the current key to the previous emptied position
+          // This results in no empty place within the array and the last
+          // element entry is empty. Good for later rezising
+          elem->derKey[idx-1] = elem->derKey[idx];
+          elem->ec_key[idx-1] = elem->ec_key[idx];
+          elem->derKey[idx] = NULL;
+          elem->ec_key[idx] = NULL;
+        }
+        else if (   (elem->derKey[idx]->keyLength == key->keyLength)
+                 && (memcmp(elem->derKey[idx]->keyData, key->keyData, 
+                            key->keyLength) == 0))
         {
-          if (deleted)
+          // Now delete this version of the ec_key
+          if (elem->ec_key[idx] != NULL)
           {
-            // move the current key to the previous emptied position
-            // This results in no empty place within the array and the last
-            // element entry is empty. Good for later rezising
-            elem->derKey[idx-1] = elem->derKey[idx];
-            elem->ec_key[idx-1] = elem->ec_key[idx];
-            elem->derKey[idx] = NULL;
+            // This array is is OpenSSL malloc'ed
+            EC_KEY_free(elem->ec_key[idx]);
             elem->ec_key[idx] = NULL;
           }
-          else
-          {  
-            if (elem->derKey[idx]->keyLength == key->keyLength)
-            {
-              if (memcmp(elem->derKey[idx]->keyData, key->keyData, 
-                         key->keyLength) == 0)
-              {
-                // Now delete this version of the ec_key
-                if (elem->ec_key[idx] != NULL)
-                {
-                  // This array is is OpenSSL malloc'ed
-                  EC_KEY_free(elem->ec_key[idx]);
-                  elem->ec_key[idx] = NULL;
-                }
-                // Now free the der_key
-                _ks_freeKey(elem->derKey[idx]);
-                elem->derKey[idx] = NULL;
-                deleted = true;
-                elem->noKeys--;
-                storage->size--;
-              }
-            }
-          }
+          // Now free the der_key
+          _ks_freeKey(elem->derKey[idx]);
+          elem->derKey[idx] = NULL;
+          deleted = true;
         }
-        if (deleted)
+      }
+      if (deleted)
+      {
+        elem->noKeys--;
+        storage->size--;
+        if (elem->noKeys == 0)
         {
-          if (elem->noKeys == 0)
+          // This was the only key, remove the complete element
+          _ks_freeKS_Elem(storage, link);
+        }
+        else
+        {
+          // some more duplicate keys exist. 
+          // Now resize
+          void** dk = realloc(elem->derKey, sizeof(BGPSecKey*) * elem->noKeys);
+          if (dk != NULL)
           {
-            // This was the only key, remove the complete element
-            _ks_freeKS_Elem(storage, bucket, elem);
+            elem->derKey = (BGPSecKey**)dk;
           }
-          else
+          void** ek = realloc(elem->ec_key, sizeof(EC_KEY*) * elem->noKeys);
+          if (ek != NULL)
           {
-            // some more duplicate keys exist. 
-            // Now resize
-            void** dk = realloc(elem->derKey, sizeof(BGPSecKey*) + elem->noKeys);
-            if (dk != NULL)
-            {
-              elem->derKey = (BGPSecKey**)dk;
-            }
-            void** ek = realloc(elem->ec_key, sizeof(EC_KEY*) + elem->noKeys);
-            if (ek != NULL)
-            {
-              elem->ec_key = (EC_KEY**)ek;
-            }
+            elem->ec_key = (EC_KEY**)ek;
           }
         }
       }
       else
       {
-        // DER is NULL so delete the complete element.
-        storage->size -= elem->noKeys;
-        _ks_freeKS_Elem(storage, bucket, elem);
-        deleted = true;
+        myStatus = API_STATUS_INFO_KEY_NOTFOUND;
       }
-      elem = NULL;
+    }
+    else
+    {
+      // DER is NULL so delete the complete element.
+      _ks_freeKS_Elem(storage, link);
     }
   }
+  if (storage != NULL && key != NULL)
+  {
+    pthread_rwlock_unlock(&storage->lock);
+  }
   
   if (status != NULL)
   {
@@ -663,22 +761,24 @@ void ks_empty(KeyStorage* storage)
 {
   if (storage != NULL)
   {
-    if (storage->head != NULL)
+    pthread_rwlock_wrlock(&storage->lock);
+    if (storage->table != NULL)
     { // Should NOT be NULL
-      int idx = 0;
-      for (; idx < KS_BUCKETS; idx++)
+      u_int32_t idx = 0;
+      for (; idx < storage->tableSize; idx++)
       {
-        while (storage->head[idx] != NULL)
+        while (storage->table[idx] != NULL)
         {
-          _ks_freeKS_Elem(storage, idx, storage->head[idx]);
+          _ks_freeKS_Elem(storage, &storage->table[idx]);
         }
       }
     }
-  }
-  if (storage->size != 0)
-  {
-    sca_debugLog(LOG_WARNING, "Key storage could not be emptied! [%p]\n", 
-                 storage);
+    if (storage->size != 0)
+    {
+      sca_debugLog(LOG_WARNING, "Key storage could not be emptied! [%p]\n", 
+                   storage);
+    }
+    pthread_rwlock_unlock(&storage->lock);
   }
 }
 
@@ -699,25 +799,23 @@ void ks_empty(KeyStorage* storage)
  * @param key The BGPSecKey to be stored.
  * @param source The source where the ley came from.
  * @param status an OUT value that provides more information.
- * @param convert if true then convert the DER key into the EC_KEY
+ * @param convert if true then convert the DER key into the EC_KEY, otherwise
+ *                the conversion is done by ks_warmUp or the first ks_getKey.
  * 
  * @return API_SUCESS if it could be stored, otherwise API_FAILED. 
  */
 int ks_storeKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source, 
                 sca_status_t* status, bool convert)
 {
-  sca_status_t myStatus = API_STATUS_OK;
-  int  retVal   = API_SUCCESS;
-  int  bucket   = 0;
+  sca_status_t     myStatus = API_STATUS_OK;
+  int              retVal   = API_SUCCESS;
+  u_int32_t        hash     = 0;
+  KS_Key_Element*  elem     = NULL;
+  KS_Key_Element** link     = NULL;
          
-  if (storage != NULL && key != NULL)
+  if (storage != NULL && key != NULL && storage->table != NULL)
   {
-    if (key->algoID == storage->algorithmID)
-    {
-      // The asn is in big endian format, 
-      bucket = _ks_getBucket(key->asn);    
-    }
-    else
+    if (key->algoID != storage->algorithmID)
     {
       // Algorithm ID does not match.
       myStatus = API_STATUS_ERR_USER1;
@@ -729,139 +827,90 @@ int ks_storeKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source,
     myStatus = API_STATUS_ERR_NO_DATA;
   }
   
-  if (storage->head[bucket] != NULL)
+  if (myStatus == API_STATUS_OK)
   {
-    // we have to find the position to insert the new key
-    KS_Key_Element* elem = storage->head[bucket];
-    while (elem != NULL)
+    pthread_rwlock_wrlock(&storage->lock);
+    // The asn is in big endian format, 
+    hash = _ks_hash(key->asn, key->ski, key->algoID);
+    elem = _ks_find(storage, key->asn, key->ski, key->algoID, hash, &link);
+    
+    if (elem == NULL)
     {
-      if (elem->asn < key->asn)
+      // A new ASN / SKI, add it as the first element of the slot
+      elem = _ks_createKS_Element(key, convert, storage->isPrivate, &myStatus);
+      if (elem != NULL)
       {
-        if (elem->next != NULL)
+        elem->source = source;
+        elem->next   = storage->table[hash & (storage->tableSize - 1)];
+        storage->table[hash & (storage->tableSize - 1)] = elem;
+        storage->noElements++;
+        storage->size++;
+        if (  ((u_int64_t)storage->noElements * 100)
+            > ((u_int64_t)storage->tableSize * KS_MAX_LOAD))
         {
-          elem = elem->next;
-          continue;
+          _ks_grow(storage);
         }
-        // add as last element          
-        storage->size++;
-        elem->next = _ks_createKS_Element(key, convert, storage->isPrivate, 
-                                          &myStatus);
-        elem->next->prev = elem;
-        break;
       }
+    }
+    else
+    {
+      // check if the key already exist.
+      int  kIdx = 0;
+      bool inserted = false;
 
-      if (elem->asn > key->asn)
+      // Go through all internal keys (most likely only one) and check if it 
+      // is already stored.
+      for (; kIdx < elem->noKeys && !inserted; kIdx++)
       {
-        // insert before the element
-        KS_Key_Element* newElem = _ks_createKS_Element(key, convert, 
-                                                 storage->isPrivate, &myStatus);
-        storage->size++;
-        newElem->next = elem;
-        newElem->prev = elem->prev;
-        elem->prev    = newElem;
-        if (newElem->prev != NULL)
-        {
-          newElem->prev->next = newElem;
-        }
-        else
+        if (elem->derKey[kIdx]->keyLength == key->keyLength)
         {
-          // new head
-          storage->head[bucket] = newElem;
+          // check if the key is already stored
+          if (memcmp(elem->derKey[kIdx]->keyData, key->keyData, key->keyLength) == 0)
+          {
+            // duplicate key
+            inserted = true; // stop the for loop
+            myStatus |= API_STATUS_INFO_USER1;
+          }
         }
-        break;
       }
 
-      // as numbers are a match. check ski
-      if (memcmp(elem->ski, key->ski, SKI_LENGTH) == 0)
+      // If not inserted then we have an SKI collision and we need to add it
+      if (!inserted)
       {
-        // check if the key already exist.
-        int  kIdx = 0;
-        bool inserted = false;
-
-        // Go through all internal keys (most likely only one) and check if it 
-        // is already stored.
-        for (; kIdx < elem->noKeys && !inserted; kIdx++)
+        // add one more key / ec_key
+        elem->noKeys++;
+        // Re-allocate the internal arrays.
+        BGPSecKey** dk = realloc(elem->derKey, sizeof(BGPSecKey*) * elem->noKeys);
+        if (dk != NULL)
         {
-          if (elem->derKey[kIdx]->keyLength == key->keyLength)
-          {
-            // check if the key is already stored
-            if (memcmp(elem->derKey[kIdx]->keyData, key->keyData, key->keyLength) == 0)
-            {
-              // duplicate key
-              inserted = true; // stop the for loop
-              myStatus |= API_STATUS_INFO_USER1;
-            }
-          }
+          elem->derKey = dk;
         }
-
-        // If not inserted then we have an SKI collision and we need to add it
-        if (!inserted)
+        EC_KEY** ek = realloc(elem->ec_key, sizeof(EC_KEY*) * elem->noKeys);
+        if (ek != NULL)
         {
-          // add one more key / ec_key
-          elem->noKeys++;
-          // Re-allocate the internal arrays.
-          BGPSecKey** dk = realloc(elem->derKey, sizeof(BGPSecKey*) * elem->noKeys);
-          EC_KEY** ek = realloc(elem->ec_key, sizeof(EC_KEY*) * elem->noKeys);
-                    
-          if (dk != NULL && ek != NULL)
-          {
-            storage->size++;
-            elem->derKey = dk;
-            elem->ec_key = ek;
-            elem->derKey[elem->noKeys-1] = _ks_clone(key);
-            elem->ec_key[elem->noKeys-1] = _ks_convertKey(key->keyData, 
-                                 key->keyLength, storage->isPrivate, &myStatus);
-            inserted = true;
-          }
-          else
-          {
-            // not enough memory for the ec_key, shrink the key back
-            myStatus |= API_STATUS_ERR_INSUF_KEYSTORAGE;
-            elem->noKeys--;
-            if (dk != NULL)
-            {
-              elem->derKey = realloc(dk, sizeof(BGPSecKey*) * elem->noKeys);
-            }
-            if (ek != NULL)
-            {
-              elem->ec_key = realloc(ek, sizeof(EC_KEY*) * elem->noKeys);
-            }
-          }
+          elem->ec_key = ek;
         }
-        break; // The while (elem != NULL) loop.
-      }
-      else
-      {
-        // ASN matches but not SKI
-        // move to the next or add as last.
-        if (elem->next != NULL)
+        
+        if (dk != NULL && ek != NULL)
         {
-          elem = elem->next;
+          elem->derKey[elem->noKeys-1] = _ks_clone(key);
+          elem->ec_key[elem->noKeys-1] = convert 
+                               ? _ks_convertKey(key->keyData, key->keyLength, 
+                                                storage->isPrivate, &myStatus)
+                               : NULL;
+          elem->converted = elem->converted && convert;
+          storage->size++;
         }
         else
         {
-          elem->next = _ks_createKS_Element(key, convert, storage->isPrivate, 
-                                            &myStatus);
-          if (elem->next != NULL)
-          {
-            storage->size++;            
-          }
-         // else set some status and return API_FAILURE ?????
-          break; // The while (elem != NULL) loop.
+          // not enough memory for the ec_key, the arrays stay one larger
+          // than needed.
+          myStatus |= API_STATUS_ERR_INSUF_KEYSTORAGE;
+          elem->noKeys--;
         }
       }
     }
-  }
-  else
-  {
-    // we have a new head
-    storage->head[bucket] = _ks_createKS_Element(key, convert, 
-                                                 storage->isPrivate, &myStatus);
-    if (storage->head[bucket] != NULL)
-    {
-      storage->size++;      
-    }
-    // else set some status and return API_FAILURE ?????
+    pthread_rwlock_unlock(&storage->lock);
   }
   
   if (status != NULL)
@@ -885,49 +934,212 @@ int ks_storeKey(KeyStorage* storage, BGPSecKey* key, sca_key_source_t source,
  */
 int ks_removeSource(KeyStorage* storage, sca_key_source_t source)
 {
-  printf ("KEYSTORAGE: ks_removeSource not implemented yet.");
-  int idx = 0;
-  KS_Key_Element* keyElem  = NULL;
+  int              count = 0;
+  u_int32_t        idx   = 0;
+  KS_Key_Element** link  = NULL;
   
-  // Walk through all buckets
-  for (; idx < KS_BUCKETS; idx++)
+  if (storage == NULL)
   {
-    // set element to kead and check from here
-    keyElem  = storage->head[idx];
-    if (keyElem != NULL)
+    return 0;
+  }
+  
+  pthread_rwlock_wrlock(&storage->lock);
+  // Walk through all slots
+  for (; idx < storage->tableSize; idx++)
+  {
+    link = &storage->table[idx];
+    while (*link != NULL)
     {
-      // This bucket contains keys, walk the list.
-      while (keyElem != NULL)
+      if ((*link)->source == source)
       {
-        if (keyElem->source == source)
-        {
-          if (keyElem->next != NULL)
-          {
-            // Move to the next already and then remove the element
-            keyElem = keyElem->next;
-            _ks_freeKS_Elem(storage, idx, keyElem->prev);  
-          }
-          else if (keyElem->prev != NULL)
-          {
-            // No next available, goto the previous and then remove it.
-            keyElem = keyElem->prev;
-            _ks_freeKS_Elem(storage, idx, keyElem->next);  
-          }
-          else
-          {
-            // It seams only this element is available, remove it
-            _ks_freeKS_Elem(storage, idx, keyElem);  
-            keyElem = NULL;
-          }
-        }
-        else
+        count += (*link)->noKeys;
+        // link points to the next element afterwards.
+        _ks_freeKS_Elem(storage, link);
+      }
+      else
+      {
+        link = &(*link)->next;
+      }
+    }
+  }
+  pthread_rwlock_unlock(&storage->lock);
+  
+  return count;
+}
+
+/** A DER key to be converted during the warm up. */
+typedef struct {
+  /** The DER key. */
+  BGPSecKey* derKey;
+  /** The location where the EC_KEY will be stored. */
+  EC_KEY**   ecKey;
+} KS_WarmUpItem;
+
+/** The work of one warm up thread. */
+typedef struct {
+  /** All items. */
+  KS_WarmUpItem* items;
+  /** The number of items. */
+  int            noItems;
+  /** The first item of this thread. */
+  int            offset;
+  /** The distance between the items of this thread. */
+  int            step;
+  /** Indicates if the keys are private keys. */
+  bool           isPrivate;
+  /** The number of converted keys. */
+  int            converted;
+} KS_WarmUpTask;
+
+/**
+ * Convert every step'th key of the task beginning with offset. Each item 
+ * is only touched by one thread.
+ * 
+ * @param arg The KS_WarmUpTask.
+ * 
+ * @return NULL
+ * 
+ * @since 0.3.1.0
+ */
+static void* _ks_warmUpThread(void* arg)
+{
+  KS_WarmUpTask* task = (KS_WarmUpTask*)arg;
+  sca_status_t   status;
+  int            idx;
+  
+  for (idx = task->offset; idx < task->noItems; idx += task->step)
+  {
+    status = API_STATUS_OK;
+    *task->items[idx].ecKey = _ks_convertKey(task->items[idx].derKey->keyData,
+                                             task->items[idx].derKey->keyLength,
+                                             task->isPrivate, &status);
+    if (*task->items[idx].ecKey != NULL)
+    {
+      task->converted++;
+    }
+  }
+  
+  return NULL;
+}
+
+/**
+ * Convert all stored DER keys that are not converted yet into EC_KEYs using 
+ * the given number of threads. This allows to load many keys without 
+ * converting them and to pay the conversion once, in parallel, instead of 
+ * during the first validation. The storage is write locked meanwhile.
+ * 
+ * @param storage The storage containing the keys.
+ * @param noThreads The number of threads to use (1 = no additional thread).
+ * 
+ * @return The number of keys that were converted.
+ * 
+ * @since 0.3.1.0
+ */
+int ks_warmUp(KeyStorage* storage, int noThreads)
+{
+  KS_WarmUpItem*   items    = NULL;
+  KS_WarmUpTask*   tasks    = NULL;
+  pthread_t*       threads  = NULL;
+  bool*            started  = NULL;
+  KS_Key_Element*  elem     = NULL;
+  int              noItems  = 0;
+  int              converted = 0;
+  u_int32_t        idx;
+  int              kIdx;
+  
+  if (storage == NULL)
+  {
+    return 0;
+  }
+  
+  pthread_rwlock_wrlock(&storage->lock);
+  // Collect all DER keys that still need to be converted.
+  items = (storage->size > 0) ? malloc(sizeof(KS_WarmUpItem) * storage->size)
+                              : NULL;
+  for (idx = 0; items != NULL && idx < storage->tableSize; idx++)
+  {
+    for (elem = storage->table[idx]; elem != NULL; elem = elem->next)
+    {
+      // All keys of the element are converted below.
+      elem->converted = true;
+      for (kIdx = 0; kIdx < elem->noKeys; kIdx++)
+      {
+        if (   (elem->ec_key[kIdx] == NULL) && (elem->derKey[kIdx] != NULL)
+            && (elem->derKey[kIdx]->keyData != NULL) 
+            && (noItems < storage->size))
         {
-          keyElem = keyElem->next;
+          items[noItems].derKey = elem->derKey[kIdx];
+          items[noItems].ecKey  = &elem->ec_key[kIdx];
+          noItems++;
         }
       }
     }
   }
   
+  if (noItems > 0)
+  {
+    if (noThreads > noItems)
+    {
+      noThreads = noItems;
+    }
+    if (noThreads < 1)
+    {
+      noThreads = 1;
+    }
+    tasks   = calloc(noThreads, sizeof(KS_WarmUpTask));
+    threads = calloc(noThreads, sizeof(pthread_t));
+    started = calloc(noThreads, sizeof(bool));
+    if (tasks == NULL || threads == NULL || started == NULL)
+    {
+      free(tasks);
+      tasks     = NULL;
+      noThreads = 0;
+    }
+    
+    for (kIdx = 0; kIdx < noThreads; kIdx++)
+    {
+      tasks[kIdx].items     = items;
+      tasks[kIdx].noItems   = noItems;
+      tasks[kIdx].offset    = kIdx;
+      tasks[kIdx].step      = noThreads;
+      tasks[kIdx].isPrivate = storage->isPrivate;
+      // The calling thread processes the first share itself.
+      started[kIdx] = (kIdx > 0) 
+                      && (pthread_create(&threads[kIdx], NULL, 
+                                         _ks_warmUpThread, &tasks[kIdx]) == 0);
+    }
+    for (kIdx = 0; kIdx < noThreads; kIdx++)
+    {
+      if (started[kIdx])
+      {
+        pthread_join(threads[kIdx], NULL);
+      }
+      else
+      {
+        _ks_warmUpThread(&tasks[kIdx]);
+      }
+      converted += tasks[kIdx].converted;
+    }
+    
+    if (tasks == NULL)
+    {
+      // Not enough memory for the threads, do it here.
+      KS_WarmUpTask task = { items, noItems, 0, 1, storage->isPrivate, 0 };
+      _ks_warmUpThread(&task);
+      converted = task.converted;
+    }
+    
+    sca_debugLog(LOG_DEBUG, "Key storage warm up converted %d of %d keys "
+                            "using %d threads\n", converted, noItems, 
+                            noThreads);
+  }
+  
+  pthread_rwlock_unlock(&storage->lock);
+  
+  free(started);
+  free(threads);
+  free(tasks);
+  free(items);
   
-  return 0;
+  return converted;
 }
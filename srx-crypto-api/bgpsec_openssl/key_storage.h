@@ -53,6 +53,7 @@
 #define KEY_STORAGE_H
 
 #include <sys/types.h>
+#include <pthread.h>
 #include <openssl/ec.h>
 #include "../srx/srxcryptoapi.h"
 
@@ -69,15 +70,23 @@ typedef enum {
   ks_derkey_e = 1       
 } KS_Key_Type;
 
+/** The initial number of hash table slots, MUST be a power of 2. */
+#define KS_INIT_SIZE 256
+/** The table doubles once the number of elements exceeds KS_MAX_LOAD percent
+ * of the number of slots. */
+#define KS_MAX_LOAD  75
+
 typedef struct _KS_Key_Element
 {
-  /** Pointer to previous element */
-  struct _KS_Key_Element* prev;
-  /** Pointer to next element */
+  /** Pointer to the next element within the same hash slot */
   struct _KS_Key_Element* next;
+  /** The hash value of (asn, ski, algoID) */
+  u_int32_t   hash;
   
   /** The ASN of all the keys. */
   u_int32_t   asn;
+  /** The algorithm ID of all the keys. */
+  u_int8_t    algoID;
   /** The key source. */
   sca_key_source_t source;
   /** The array containing the ASKI of the key. */
@@ -96,6 +105,9 @@ typedef struct _KS_Key_Element
   /** Indicates how many different DER keys are stored. Normally 1 but > 1 in 
    * case of an SKI / ASN collision */
   u_int16_t  noKeys;
+  /** Indicates that the conversion of all DER keys into EC_KEYs was done. 
+   * Once set the ec_key array is only modified under the write lock. */
+  bool       converted;
 } KS_Key_Element;
 
 typedef struct 
@@ -104,10 +116,19 @@ typedef struct
   u_int8_t algorithmID;
   /** indicates if the keys are private or not. */
   bool isPrivate;
-  /** The bucket head elements of the storage. */
-  KS_Key_Element** head;  
+  /** The hash table of the storage, keyed by (asn, ski, algoID). */
+  KS_Key_Element** table;
+  /** The number of slots of the hash table, always a power of 2. */
+  u_int32_t tableSize;
+  /** The number of elements (ASN / SKI pairs) stored. */
+  u_int32_t noElements;
   /** The number of keys stored in the storage. */
   u_int32_t size;
+  /** Lookups hold the read lock, all modifications of the table and the 
+   * elements hold the write lock. */
+  pthread_rwlock_t lock;
+  /** Serializes the conversion of DER keys during lookups. */
+  pthread_mutex_t  convLock;
 } KeyStorage;
 
 /**
@@ -120,7 +141,30 @@ typedef struct
 void ks_init(KeyStorage* storage, u_int8_t algoID, bool isPrivate);
 
 /**
- * Retrieve the EC_KEY associated to the given ski and asn
+ * Acquire the read lock of the storage. It is required for ks_getKey and the
+ * returned keys stay valid as long as the caller holds it. The lock is not
+ * recursive and functions modifying the storage MUST NOT be called while
+ * holding it.
+ * 
+ * @param storage The key storage.
+ * 
+ * @since 0.3.1.0
+ */
+void ks_readLock(KeyStorage* storage);
+
+/**
+ * Release the read lock acquired with ks_readLock.
+ * 
+ * @param storage The key storage.
+ * 
+ * @since 0.3.1.0
+ */
+void ks_unlock(KeyStorage* storage);
+
+/**
+ * Retrieve the EC_KEY associated to the given ski and asn. The caller MUST
+ * hold the read lock (ks_readLock) while calling this function and using the
+ * returned array, the array is owned by the storage.
  * 
  * Possible USER return values:
  * 
@@ -192,6 +236,21 @@ void ks_empty(KeyStorage* storage);
  */
 int ks_removeSource(KeyStorage* storage, sca_key_source_t source);
 
+/**
+ * Convert all stored DER keys that are not converted yet into EC_KEYs using 
+ * the given number of threads. This allows to load many keys without 
+ * converting them and to pay the conversion once, in parallel, instead of 
+ * during the first validation. The storage is write locked meanwhile.
+ * 
+ * @param storage The storage containing the keys.
+ * @param noThreads The number of threads to use (1 = no additional thread).
+ * 
+ * @return The number of keys that were converted.
+ * 
+ * @since 0.3.1.0
+ */
+int ks_warmUp(KeyStorage* storage, int noThreads);
+
 /**
  * Empty the storage if necessary and free the allocated memory.
  * 
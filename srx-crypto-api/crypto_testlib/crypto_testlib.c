@@ -228,6 +228,39 @@ int validate(SCA_BGPSecValidationData* data)
                                    : API_VALRESULT_INVALID;
 }
 
+/**
+ * Perform BGPSEC path validation for each of the given data objects by calling
+ * validate.
+ *
+ * @param count The number of data elements in the given array
+ * @param data Array containing the data objects to be validated.
+ * @param results Array that will contain the validation result of each data
+ *                object.
+ *
+ * @return API_SUCCESS or API_FAILURE if one of the data objects has an error
+ *         bit set.
+ *
+ * @since 0.3.1.0
+ */
+int validateBatch(int count, SCA_BGPSecValidationData** data, int* results)
+{
+  sca_debugLog (LOG_DEBUG, "CryptoTestLib: Called 'validateBatch'\n");
+  int idx    = 0;
+  int retVal = API_SUCCESS;
+
+  for (; idx < count; idx++)
+  {
+    results[idx] = validate(data[idx]);
+    if (   (data[idx] == NULL)
+        || ((data[idx]->status & API_STATUS_ERROR_MASK) != 0))
+    {
+      retVal = API_FAILURE;
+    }
+  }
+
+  return retVal;
+}
+
 /**
  * Sign the given BGPSecSign data using the given key. This method fills the
  * key into the BGPSecSignData object.
@@ -620,6 +653,7 @@ __attribute__((unused)) static void comptest()
 
   compAPI.sign                 = sign;
   compAPI.validate             = validate;
+  compAPI.validateBatch        = validateBatch;
 
   compAPI.freeHashMessage      = freeHashMessage;
   compAPI.freeSignature        = freeSignature;
@@ -597,6 +597,7 @@ typedef struct
    *         contains further information - including errors.
    */
   int (*validate)(SCA_BGPSecValidationData* data);
+
    
   /**
    * Sign the given BGPsec data using the key information (ski, algo-id, asn)
@@ -777,6 +778,34 @@ typedef struct
    * @since 0.3.0.0
    */
   bool (*isAlgorithmSupported)(u_int8_t algoID);
+
+  /**
+   * Perform BGPSEC path validation of multiple updates at once. This function 
+   * behaves as if validate was called for each data object in the given 
+   * order but allows the plug-in to share work between the validations 
+   * (e.g. key lookups) and to verify the signatures in bulk.
+   * 
+   * The validation result of each data object is stored in the results 
+   * array, the status flag of each data object contains the same information 
+   * validate would provide.
+   * 
+   * @param count The number of data elements in the given array
+   * @param data Array containing the data objects to be validated.
+   * @param results Array of count elements that will contain the validation 
+   *                result of each data object (API_VALRESULT_VALID, 
+   *                API_VALRESULT_INVALID, or API_VALIDATION_ERROR).
+   * 
+   * @return API_SUCCESS or API_FAILURE if at least one data object has an 
+   *         error bit set in its status.
+   * 
+   * This member is NULL if the plug-in does not provide a batch validation,
+   * the caller then calls validate for each data object. It is the last 
+   * member to keep the layout of the previous members.
+   * 
+   * @since 0.3.1.0
+   */
+  int (*validateBatch)(int count, SCA_BGPSecValidationData** data, 
+                       int* results);
   
 } SRxCryptoAPI;
 
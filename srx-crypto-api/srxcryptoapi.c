@@ -147,6 +147,7 @@
 
 #define SCA_SIGN                   "method_sign"
 #define SCA_VALIDATE               "method_validate"
+#define SCA_VALIDATE_BATCH         "method_validateBatch"
 
 #define SCA_REGISTER_PRIVATE_KEY   "method_registerPrivateKey"
 #define SCA_UNREGISTER_PRIVATE_KEY "method_unregisterPrivateKey"
@@ -172,6 +173,7 @@
 
 #define SCA_DEF_SIGN                   "sign"
 #define SCA_DEF_VALIDATE               "validate"
+#define SCA_DEF_VALIDATE_BATCH         "validateBatch"
 
 #define SCA_DEF_REGISTER_PRIVATE_KEY   "registerPrivateKey"
 #define SCA_DEF_UNREGISTER_PRIVATE_KEY "unregisterPrivateKey"
@@ -206,6 +208,7 @@ typedef struct {
   
   const char* str_method_sign;
   const char* str_method_validate;
+  const char* str_method_validateBatch;
 
   const char* str_method_registerPrivateKey;
   const char* str_method_unregisterPrivateKey;
@@ -399,6 +402,36 @@ int wrap_validate(SCA_BGPSecValidationData* data)
   return API_VALRESULT_INVALID;
 }
 
+/**
+ * This is the internal wrapper function. It calls the validate wrapper for 
+ * each data object and provides a debug log.
+ * 
+ * @param count The number of data elements in the given array
+ * @param data Array containing the data objects to be validated.
+ * @param results Array that will contain API_VALRESULT_INVALID for each 
+ *                data object.
+ *
+ * @return API_FAILURE
+ * 
+ * @since 0.3.1.0
+ */
+int wrap_validateBatch(int count, SCA_BGPSecValidationData** data, 
+                       int* results)
+{
+  // Return an error for missing implementation.
+  sca_debugLog (LOG_DEBUG, "Called local test wrapper 'validateBatch'\n");
+  int idx = 0;
+  for (idx = 0; idx < count; idx++)
+  {
+    if (results != NULL)
+    {
+      results[idx] = wrap_validate(data != NULL ? data[idx] : NULL);
+    }
+  }
+  
+  return API_FAILURE;
+}
+
 /**
  * This is the internal wrapper function. Currently it does return only the
  * error code and provides a debug log.
@@ -763,6 +796,8 @@ static void _loadMapping(config_setting_t *set, SCA_Mappings* mappings)
   //////////////////////////////////////////////////////////////////////////////
   __readMapping(set, SCA_SIGN, &mappings->str_method_sign);
   __readMapping(set, SCA_VALIDATE, &mappings->str_method_validate);  
+  __readMapping(set, SCA_VALIDATE_BATCH, 
+                     &mappings->str_method_validateBatch);
   
   //////////////////////////////////////////////////////////////////////////////
   // KEY STORAGE
@@ -911,6 +946,17 @@ static int _mapAPI(SCA_Mappings* mappings, SRxCryptoAPI* api)
                     mappings->str_method_sign, SCA_DEF_SIGN);
     __doMapFunction(api->libHandle, (void**)&api->validate,
                     mappings->str_method_validate, SCA_DEF_VALIDATE);
+    __doMapFunction(api->libHandle, (void**)&api->validateBatch,
+                    mappings->str_method_validateBatch, 
+                    SCA_DEF_VALIDATE_BATCH);
+    if (api->validateBatch == wrap_validateBatch)
+    {
+      // The plug-in does not provide batch validation, the caller validates
+      // each update using the plug-in's validate instead.
+      sca_debugLog(LOG_INFO, "No batch validation provided, validateBatch is "
+                             "not set!\n");
+      api->validateBatch = NULL;
+    }
     
     __doMapFunction(api->libHandle, (void**)&api->registerPublicKey,
                     mappings->str_method_registerPublicKey,
@@ -1006,6 +1052,7 @@ int srxCryptoInit(SRxCryptoAPI* api, sca_status_t* status)
   
   api->sign                 = wrap_sign;
   api->validate             = wrap_validate;
+  api->validateBatch        = wrap_validateBatch;
 
   api->registerPublicKey    = wrap_registerPublicKey;
   api->unregisterPublicKey  = wrap_unregisterPublicKey;
@@ -73,6 +73,7 @@
 #include "util/log.h"
 #include "util/mutex.h"
 #include "util/socket.h"
+#include "util/timer.h"
 
 /** Seconds between reconnect attempts */
 #define RECONNECT_DELAY 2
@@ -95,10 +96,17 @@
 ////////////////////////////////////////////////////////////////////////////////
 // Status variables for handshake timeout - since 0.3.0
 ////////////////////////////////////////////////////////////////////////////////
+/** Guards the handshake status variables, the timeout fires within the timer
+ * thread. */
+static pthread_mutex_t _handshakeMutex=PTHREAD_MUTEX_INITIALIZER;
+/** Indicates that a handshake waits for the answer of the server. */
+static bool _handshakeRunning=false;
 /** Used to determine if a handshake timeout occured. */
-volatile int _handshakeAlarm=0;
+static bool _handshakeAlarm=false;
 /** used to close a handshake-timed out socket  */
-volatile int* _handshakeSocket=NULL;
+static int* _handshakeSocket=NULL;
+/** The timer of the handshake timeout or -1 if not set up yet. */
+static int _handshakeTimer=-1;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Implementation of header file
@@ -126,6 +134,7 @@ ClientConnectionHandler* createClientConnectionHandler(SRxProxy* proxy)
     self->initialized = false;
     self->established = false;
     self->keepWindow  = SRX_DEFAULT_KEEP_WINDOW;
+    self->capabilities = 0;
     // The connHandler->cond and connHandler->rcvMonitor are created, initialized
     // and released in the connection handlers init and release method
     self->cond        = NULL;
@@ -451,17 +460,70 @@ bool sendPacketToServer(ClientConnectionHandler* self, void* data,
 }
 
 /**
- * Handler to catch the timeout alarm for handshake.
+ * Handler to catch the timeout timer for handshake. It runs within the timer
+ * thread, the socket is shut down to unblock the read and closed once the
+ * handshake loop ends. A timeout that fires after the handshake ended is
+ * ignored.
  * 
- * @param sig The signal
+ * @param id The timer identifier
+ * @param now The current time
  * 
  * @since 0.3.0 
  */
-void _catch_handshakeTimeout(int sig)
+void _catch_handshakeTimeout(int id, time_t now)
 {
-  _handshakeAlarm = 1;      // set timeout indicator
-  close(*_handshakeSocket); // unblocks the read
-  *_handshakeSocket = -1;
+  pthread_mutex_lock(&_handshakeMutex);
+  if (_handshakeRunning)
+  {
+    _handshakeAlarm = true;      // set timeout indicator
+    if (_handshakeSocket != NULL)
+    {
+      shutdown(*_handshakeSocket, SHUT_RDWR); // unblocks the read
+    }
+  }
+  pthread_mutex_unlock(&_handshakeMutex);
+}
+
+/**
+ * Determine if the running handshake timed out.
+ * 
+ * @return true if the handshake timed out.
+ * 
+ * @since 0.6.0
+ */
+static bool _isHandshakeTimedOut()
+{
+  bool timedOut;
+
+  pthread_mutex_lock(&_handshakeMutex);
+  timedOut = _handshakeAlarm;
+  pthread_mutex_unlock(&_handshakeMutex);
+
+  return timedOut;
+}
+
+/**
+ * Stop the handshake timer and the timer thread. The timer service of the
+ * proxy is used by the handshake only. A later handshake sets the timer up 
+ * again.
+ * 
+ * @since 0.6.0
+ */
+void releaseHandshakeTimer()
+{
+  int timer;
+
+  pthread_mutex_lock(&_handshakeMutex);
+  timer = _handshakeTimer;
+  _handshakeTimer = -1;
+  pthread_mutex_unlock(&_handshakeMutex);
+
+  if (timer != -1)
+  {
+    deleteTimer(timer);
+    // Joins the timer thread
+    deleteAllTimers();
+  }
 }
 
 /*
@@ -475,6 +537,8 @@ void _catch_handshakeTimeout(int sig)
  */
 bool handshakeWithServer(ClientConnectionHandler* self, SRXPROXY_HELLO* pdu)
 {  
+  // Set by the Hello Response, older servers do not answer any.
+  self->capabilities = 0;
   // Send 'HELLO' to the server
   if (!sendData(&self->clSock, (void*)pdu, ntohl(pdu->length)))
   {
@@ -484,25 +548,36 @@ bool handshakeWithServer(ClientConnectionHandler* self, SRXPROXY_HELLO* pdu)
   LOG(LEVEL_DEBUG, HDR "Wait for Handshake to complete...", pthread_self());
         
   // prepare handshake
-  _handshakeAlarm  = 0;
-  _handshakeSocket = &self->clSock.clientFD;
-  __sighandler_t oldHandler = NULL;
-  int oldAlarmTimer = 0;
+  pthread_mutex_lock(&_handshakeMutex);
+  _handshakeRunning = true;
+  _handshakeAlarm   = false;
+  _handshakeSocket  = &self->clSock.clientFD;
   
+  // The timer thread is only started if the handshake can time out.
   if (self->handshake_timeout)
   {
-    // Retrieve the old settings and set the new ones
-    oldAlarmTimer = alarm(0);
-    oldHandler = signal(SIGALRM, _catch_handshakeTimeout);    
-    // Set the alarm
-    alarm(self->handshake_timeout);    
+    if (_handshakeTimer == -1)
+    {
+      _handshakeTimer = setupTimer(_catch_handshakeTimeout);
+    }
+    if (_handshakeTimer != -1)
+    {
+      startIntervalTimer(_handshakeTimer, self->handshake_timeout, true);
+    }
+    else
+    {
+      LOG(LEVEL_WARNING, "Could not set up the handshake timer, the handshake "
+                         "does not time out!");
+    }
   }
+  pthread_mutex_unlock(&_handshakeMutex);
   
   // The call returns with one packet received. Ideally it is the HelloResponse
   // but it also could be an Error. In this case we need to go back and receive
   // more.
   SRxProxyCommCode mainCode;
-  bool isError = false;
+  bool isError  = false;
+  bool timedOut = false;
   while (!isError && !isConnected(self->srxProxy)) 
   {
     // First clear all previous errors if any
@@ -517,7 +592,7 @@ bool handshakeWithServer(ClientConnectionHandler* self, SRXPROXY_HELLO* pdu)
       LOG(LEVEL_ERROR, "SRx-Server reported Error[%u] with sub code[%i]", 
                        mainCode, self->srxProxy->lastSubCode);
     }
-    if (_handshakeAlarm == 1)
+    if (_isHandshakeTimedOut())
     {
       self->established = false; // timed out
       LOG(LEVEL_NOTICE, "Handshake timed out!!");
@@ -525,14 +600,22 @@ bool handshakeWithServer(ClientConnectionHandler* self, SRXPROXY_HELLO* pdu)
     }
   }
 
-  // Turn off timeout and reset alarm to old settings.
-  if (self->handshake_timeout > 0)
+  // Turn off timeout and close the timed out socket. A timeout firing from
+  // now on does not touch the socket anymore.
+  pthread_mutex_lock(&_handshakeMutex);
+  if (_handshakeTimer != -1)
+  {
+    stopTimer(_handshakeTimer);
+  }
+  timedOut          = _handshakeAlarm;
+  _handshakeRunning = false;
+  _handshakeAlarm   = false;
+  _handshakeSocket  = NULL;
+  pthread_mutex_unlock(&_handshakeMutex);
+  if (timedOut)
   {
-    alarm(0);
-    signal(SIGALRM, oldHandler);
-    alarm(oldAlarmTimer);
-    _handshakeAlarm=0;
-    _handshakeSocket=NULL;
+    close(self->clSock.clientFD);
+    self->clSock.clientFD = -1;
   }
   
   if (!self->established)
@@ -655,6 +738,7 @@ bool reconnectSRX(ClientConnectionHandler* self)
     hdr->proxyIdentifier = htonl(proxy->proxyID);
     hdr->asn             = htonl(proxy->proxyAS);
     hdr->noPeers         = htonl(noPeers);
+    hdr->capabilities    = htonl(SRX_PROXY_CAP_ALL);
 
     peerAS = (uint32_t*)&hdr->peerAS;
     SListNode* node = getRootNodeOfSList(&proxy->peerAS);
@@ -96,6 +96,8 @@ typedef struct {
 
   uint32_t         handshake_timeout; // The time in seconds allowed to wait
                                     // until a handshake timeout occurs.
+  uint32_t         capabilities;  // The capabilities the server answered in
+                                  // the handshake (SRX_PROXY_CAP_...).
 
   // Pointer to the srx proxy
   uint32_t         keepWindow;    // a default keep window value.
@@ -149,6 +151,15 @@ bool initializeClientConnectionHandler(ClientConnectionHandler* self,
  */
 void releaseClientConnectionHandler(ClientConnectionHandler* self);
 
+/**
+ * Stop the handshake timer and the timer thread. The timer service of the
+ * proxy is used by the handshake only. A later handshake sets the timer up 
+ * again.
+ * 
+ * @since 0.6.0
+ */
+void releaseHandshakeTimer();
+
 /**
  * This method waits until data is received. It is expected that the lock is 
  * already set.
@@ -94,6 +94,7 @@ static ProxyLogger _pLogger = NULL;
 // Forward declaration
 ////////////////////////////////////////////////////////////////////////////////
 static void dispatchPackets(SRXPROXY_BasicHeader* packet, void* proxyPtr);
+static bool _flushVerifyBatch(SRxProxy* proxy);
 void callCMgmtHandler(SRxProxy* proxy, SRxProxyCommCode mainCode, int subCode);
 void pLog(LogLevel level, const char* fmt, va_list args);
 
@@ -201,7 +202,10 @@ void releaseSRxProxy(SRxProxy* proxy)
   if (proxy != NULL)
   {
     disconnectFromSRx(proxy, SRX_DEFAULT_KEEP_WINDOW);
+    // Joins the timer thread if the handshake started it
+    releaseHandshakeTimer();
     releaseSList(&proxy->peerAS);
+    free(proxy->verifyBatch.buffer);
     free(proxy->connHandler);
     free(proxy);
   }
@@ -428,6 +432,7 @@ bool connectToSRx(SRxProxy* proxy, const char* host, int port,
   hdr->proxyIdentifier = htonl(proxy->proxyID);
   hdr->asn             = htonl(proxy->proxyAS);
   hdr->noPeers         = htonl(noPeers);
+  hdr->capabilities    = htonl(SRX_PROXY_CAP_ALL);
 
   peerAS = (uint32_t*)&hdr->peerAS;
   SListNode* node = getRootNodeOfSList(&proxy->peerAS);
@@ -502,6 +507,8 @@ bool disconnectFromSRx(SRxProxy* proxy, uint16_t keepWindow)
   // Macro for type casting back to the proxy.
   if (isConnected(proxy))
   {
+    // Send the requests of a pending verify batch prior to leaving.
+    _flushVerifyBatch(proxy);
     sendGoodbye(connHandler, keepWindow);
     connHandler->established = false;
     releaseClientConnectionHandler(connHandler);
@@ -738,72 +745,24 @@ uint8_t* createV6Request(uint8_t* pdu, SRxVerifyFlag method, uint32_t rToken,
 }
 
 /**
- * Verifies the given update data. All parameters except the result parameter
- * are IN parameters, result is an OUT parameter that will be filled within this
- * function. The memory MUST be allocated outside of this function.
+ * Send the given verify request PDU to the SRx server. In case the socket is
+ * temporarily not able to send the PDU, multiple attempts are made as
+ * configured in the socket configuration of the proxy.
  *
  * @param proxy The proxy instance
- * @param localID Specifies the local ID associated to this Update. This is NOT
- *                the updateID and if an update id is known, this value should
- *                be "0" zero. If the value is other than "0" zero the
- *                SRx-server WILL send a notification back, regardless if the
- *                given default result is a correct validation result or not.
- * @param usePrefixOriginVal specify if srx-server should perform a prefix
- *                origin validation.
- * @param usePpathVal specify if srx-server should perform a path validation.
- * @param defaultResult The parameter contains the default information to be
- *                used in case the validation result is not readily available.
- * @param prefix The prefix of the request. (both v4/v6 possible)
- * @param as32 Origin AS (32-bit)
- * @param bgpsec the bgpsec information.
+ * @param pdu The verify request or verify batch PDU
+ * @param length The length of the PDU
+ *
+ * @return true if the PDU could be send.
  *
+ * @since 0.6.0
  */
-void verifyUpdate(SRxProxy* proxy, uint32_t localID,
-                  bool usePrefixOriginVal, bool usePathVal, bool useAspaVal,
-                  SRxDefaultResult* defaultResult,
-                  IPPrefix* prefix, uint32_t as32,
-                  BGPSecData* bgpsec, SRxASPathList asPathList)
+static bool _sendVerifyPDU(SRxProxy* proxy, uint8_t* pdu, uint32_t length)
 {
-  if (!isConnected(proxy))
-  {
-    RAISE_ERROR(HDR "Abort verify, not connected to SRx server!" ,
-                pthread_self());
-    return;
-  }
-  // Specify the verify request method.
-  uint8_t method =   (usePrefixOriginVal ? SRX_FLAG_ROA : 0)
-                   | (usePathVal ? SRX_FLAG_BGPSEC : 0)
-                   | (useAspaVal ? SRX_FLAG_ASPA : 0)
-                   | (localID != 0 ? SRX_FLAG_REQUEST_RECEIPT : 0);
-
-  bool isV4 = prefix->ip.version == 4;
   // The client connection handler
   ClientConnectionHandler* connHandler =
                                    (ClientConnectionHandler*)proxy->connHandler;
 
-  // create data packet.
-  uint16_t bgpsecLength = 0;
-  if (bgpsec != NULL)
-  {
-    bgpsecLength = (bgpsec->numberHops * 4) + bgpsec->attr_length;
-  }
-  uint32_t length = (isV4 ? sizeof(SRXPROXY_VERIFY_V4_REQUEST)
-                          : sizeof(SRXPROXY_VERIFY_V6_REQUEST)) + bgpsecLength;
-  uint8_t  pdu[length];
-  uint32_t requestToken = localID;
-
-  memset(pdu, 0, length);
-
-  // Generate VERIFY PACKET
-  if (isV4)
-  {
-    createV4Request(pdu, method, requestToken, defaultResult, prefix, as32, bgpsec, asPathList);
-  }
-  else
-  {
-    createV6Request(pdu, method, requestToken, defaultResult, prefix, as32, bgpsec);
-  }
-
   // Send Data
   int maxAttempt = proxy->socketConfig.enablePSC
                    ? proxy->socketConfig.maxAttempts : 1;
@@ -899,6 +858,278 @@ void verifyUpdate(SRxProxy* proxy, uint32_t localID,
                   "sending!");
     }
   }
+
+  return transmissionError == 0;
+}
+
+/**
+ * Return true if the SRx server announced in the handshake that it accepts
+ * verify batch PDUs.
+ *
+ * @param proxy The proxy instance
+ *
+ * @return true if verify requests can be send in batches.
+ *
+ * @since 0.6.0
+ */
+static bool _canBatchVerify(SRxProxy* proxy)
+{
+  ClientConnectionHandler* connHandler =
+                                   (ClientConnectionHandler*)proxy->connHandler;
+  return (connHandler->capabilities & SRX_PROXY_CAP_VERIFY_BATCH) != 0;
+}
+
+/**
+ * Send all requests collected in the verify batch of the proxy. A batch
+ * containing one request only is send as a regular verify request. In case
+ * the proxy reconnected meanwhile to a server that does not accept verify
+ * batches, the requests are send one by one.
+ *
+ * @param proxy The proxy instance
+ *
+ * @return false if the collected requests could not be send.
+ *
+ * @since 0.6.0
+ */
+static bool _flushVerifyBatch(SRxProxy* proxy)
+{
+  SRxVerifyBatch*        batch = &proxy->verifyBatch;
+  SRXPROXY_VERIFY_BATCH* hdr   = NULL;
+  SRXRPOXY_BasicHeader_VerifyRequest* request = NULL;
+  uint32_t length = batch->length;
+  uint32_t offset = 0;
+  uint32_t reqLength = 0;
+  bool     retVal = true;
+
+  if (batch->noRequests == 0)
+  {
+    return true;
+  }
+
+  if (!isConnected(proxy))
+  {
+    RAISE_ERROR(HDR "Drop %u batched verify requests, not connected to SRx "
+                "server!", batch->noRequests);
+    retVal = false;
+  }
+  else if (batch->noRequests == 1 || !_canBatchVerify(proxy))
+  {
+    // The requests are complete verify request PDUs.
+    offset = sizeof(SRXPROXY_VERIFY_BATCH);
+    while (retVal && offset < length)
+    {
+      request   = (SRXRPOXY_BasicHeader_VerifyRequest*)(batch->buffer + offset);
+      reqLength = ntohl(request->length);
+      retVal    = _sendVerifyPDU(proxy, batch->buffer + offset, reqLength);
+      offset   += reqLength;
+    }
+  }
+  else
+  {
+    hdr = (SRXPROXY_VERIFY_BATCH*)batch->buffer;
+    memset(hdr, 0, sizeof(SRXPROXY_VERIFY_BATCH));
+    hdr->type       = PDU_SRXPROXY_VERIFY_BATCH;
+    hdr->noRequests = htonl(batch->noRequests);
+    hdr->length     = htonl(length);
+    retVal = _sendVerifyPDU(proxy, batch->buffer, length);
+  }
+
+  batch->length     = sizeof(SRXPROXY_VERIFY_BATCH);
+  batch->noRequests = 0;
+
+  return retVal;
+}
+
+/**
+ * Return the memory within the verify batch where a request of the given
+ * length can be stored. If the batch does not have enough space left, it will
+ * be flushed first.
+ *
+ * @param proxy The proxy instance
+ * @param length The length of the request
+ *
+ * @return The memory for the request or NULL if the request has to be send on
+ *         its own.
+ *
+ * @since 0.6.0
+ */
+static uint8_t* _getVerifyBatchSpace(SRxProxy* proxy, uint32_t length)
+{
+  SRxVerifyBatch* batch = &proxy->verifyBatch;
+
+  if (   !batch->corked || !_canBatchVerify(proxy)
+      || (sizeof(SRXPROXY_VERIFY_BATCH) + length > SRX_PROXY_VERIFY_BATCH_SIZE))
+  {
+    return NULL;
+  }
+  if (batch->length + length > SRX_PROXY_VERIFY_BATCH_SIZE)
+  {
+    _flushVerifyBatch(proxy);
+  }
+
+  return batch->buffer + batch->length;
+}
+
+/**
+ * Verifies the given update data. All parameters except the result parameter
+ * are IN parameters, result is an OUT parameter that will be filled within this
+ * function. The memory MUST be allocated outside of this function.
+ *
+ * @param proxy The proxy instance
+ * @param localID Specifies the local ID associated to this Update. This is NOT
+ *                the updateID and if an update id is known, this value should
+ *                be "0" zero. If the value is other than "0" zero the
+ *                SRx-server WILL send a notification back, regardless if the
+ *                given default result is a correct validation result or not.
+ * @param usePrefixOriginVal specify if srx-server should perform a prefix
+ *                origin validation.
+ * @param usePpathVal specify if srx-server should perform a path validation.
+ * @param defaultResult The parameter contains the default information to be
+ *                used in case the validation result is not readily available.
+ * @param prefix The prefix of the request. (both v4/v6 possible)
+ * @param as32 Origin AS (32-bit)
+ * @param bgpsec the bgpsec information.
+ *
+ */
+void verifyUpdate(SRxProxy* proxy, uint32_t localID,
+                  bool usePrefixOriginVal, bool usePathVal, bool useAspaVal,
+                  SRxDefaultResult* defaultResult,
+                  IPPrefix* prefix, uint32_t as32,
+                  BGPSecData* bgpsec, SRxASPathList asPathList)
+{
+  if (!isConnected(proxy))
+  {
+    RAISE_ERROR(HDR "Abort verify, not connected to SRx server!" ,
+                pthread_self());
+    return;
+  }
+  // Specify the verify request method.
+  uint8_t method =   (usePrefixOriginVal ? SRX_FLAG_ROA : 0)
+                   | (usePathVal ? SRX_FLAG_BGPSEC : 0)
+                   | (useAspaVal ? SRX_FLAG_ASPA : 0)
+                   | (localID != 0 ? SRX_FLAG_REQUEST_RECEIPT : 0);
+
+  bool isV4 = prefix->ip.version == 4;
+
+  // create data packet.
+  uint16_t bgpsecLength = 0;
+  if (bgpsec != NULL)
+  {
+    bgpsecLength = (bgpsec->numberHops * 4) + bgpsec->attr_length;
+  }
+  uint32_t length = (isV4 ? sizeof(SRXPROXY_VERIFY_V4_REQUEST)
+                          : sizeof(SRXPROXY_VERIFY_V6_REQUEST)) + bgpsecLength;
+  uint8_t  stackPDU[length];
+  uint32_t requestToken = localID;
+  // Store the request directly in the verify batch if one is collected.
+  SRxVerifyBatch* batch = &proxy->verifyBatch;
+  uint8_t* pdu     = _getVerifyBatchSpace(proxy, length);
+  bool     batched = pdu != NULL;
+
+  if (!batched)
+  {
+    pdu = stackPDU;
+  }
+  memset(pdu, 0, length);
+
+  // Generate VERIFY PACKET
+  if (isV4)
+  {
+    createV4Request(pdu, method, requestToken, defaultResult, prefix, as32, bgpsec, asPathList);
+  }
+  else
+  {
+    createV6Request(pdu, method, requestToken, defaultResult, prefix, as32, bgpsec);
+  }
+
+  if (batched)
+  {
+    // The request will be send with the next flush of the batch.
+    batch->length += length;
+    batch->noRequests++;
+  }
+  else
+  {
+    _sendVerifyPDU(proxy, pdu, length);
+  }
+}
+
+/**
+ * Register the callback that receives the results of verification notification
+ * batches. Without this callback each result of a batch is reported using the
+ * ValidationReady callback given to createSRxProxy.
+ *
+ * @param proxy The proxy instance
+ * @param validationsReadyCallback The batch callback or NULL.
+ *
+ * @since 0.6.0
+ */
+void setValidationsReadyCallback(SRxProxy* proxy,
+                                 ValidationsReady validationsReadyCallback)
+{
+  if (proxy != NULL)
+  {
+    proxy->resBatchCallback = validationsReadyCallback;
+  }
+}
+
+/**
+ * Start collecting verify requests into one verify batch PDU. All following
+ * calls of verifyUpdate are not send right away, they are send using one
+ * single PDU once flushVerifyBatch is called or the batch is full. This allows
+ * to reduce the number of send operations while processing a complete BGP
+ * UPDATE message or a complete table walk. Batches are only used if the SRx
+ * server announced support for them during the handshake, otherwise each
+ * request is send right away as before.
+ *
+ * The batch MUST be flushed by the same thread that calls verifyUpdate.
+ *
+ * @param proxy The proxy instance (can be NULL)
+ *
+ * @since 0.6.0
+ */
+void beginVerifyBatch(SRxProxy* proxy)
+{
+  if (proxy == NULL)
+  {
+    return;
+  }
+
+  SRxVerifyBatch* batch = &proxy->verifyBatch;
+  if (batch->buffer == NULL)
+  {
+    batch->buffer = malloc(SRX_PROXY_VERIFY_BATCH_SIZE);
+    if (batch->buffer == NULL)
+    {
+      RAISE_ERROR("Not enough memory to create a verify batch, requests will "
+                  "be send one by one!");
+      return;
+    }
+    batch->length     = sizeof(SRXPROXY_VERIFY_BATCH);
+    batch->noRequests = 0;
+  }
+  batch->corked = true;
+}
+
+/**
+ * Send all verify requests collected since beginVerifyBatch was called and
+ * stop collecting further requests.
+ *
+ * @param proxy The proxy instance (can be NULL)
+ *
+ * @return false if the collected requests could not be send.
+ *
+ * @since 0.6.0
+ */
+bool flushVerifyBatch(SRxProxy* proxy)
+{
+  bool retVal = true;
+  if (proxy != NULL)
+  {
+    retVal = _flushVerifyBatch(proxy);
+    proxy->verifyBatch.corked = false;
+  }
+  return retVal;
 }
 
 /**
@@ -1019,7 +1250,8 @@ void processHelloResponse(SRXPROXY_HELLO_RESPONSE* hdr, SRxProxy* proxy)
 
   if (ntohs(hdr->version) == SRX_PROTOCOL_VER)
   {
-    connHandler->established = true;
+    connHandler->capabilities = ntohl(hdr->capabilities) & SRX_PROXY_CAP_ALL;
+    connHandler->established  = true;
   }
   else
   {
@@ -1114,6 +1346,81 @@ void processVerifyNotify(SRXPROXY_VERIFY_NOTIFICATION* hdr, SRxProxy* proxy)
   }
 }
 
+/**
+ * The SRx server send a verification notification batch. The results are
+ * handed to the batch callback of the proxy at once, or one by one to the
+ * validation result callback if no batch callback is registered.
+ *
+ * @param hdr The "Verify Notification Batch" Header
+ * @param proxy The proxy instance.
+ *
+ * @since 0.6.0
+ */
+void processVerifyNotifyBatch(SRXPROXY_VERIFY_NOTIFICATION_BATCH* hdr,
+                              SRxProxy* proxy)
+{
+  SRXPROXY_VERIFY_RESULT* pduRes = (SRXPROXY_VERIFY_RESULT*)(hdr + 1);
+  SRxUpdateResult*        results = NULL;
+  SRxUpdateResult*        result  = NULL;
+  uint32_t noResults = ntohl(hdr->noResults);
+  uint32_t idx;
+
+  if (ntohl(hdr->length) !=   sizeof(SRXPROXY_VERIFY_NOTIFICATION_BATCH)
+                            + (noResults * sizeof(SRXPROXY_VERIFY_RESULT)))
+  {
+    RAISE_ERROR("Verification notification batch with %u results has an "
+                "invalid length of %u bytes!", noResults, ntohl(hdr->length));
+    return;
+  }
+  if ((proxy->resBatchCallback == NULL) && (proxy->resCallback == NULL))
+  {
+    LOG(LEVEL_INFO, "processVerifyNotifyBatch: NO IMPLEMENTATION PROVIDED FOR "
+                    "proxy->resCallback!!!\n");
+    return;
+  }
+
+  results = malloc(noResults * sizeof(SRxUpdateResult));
+  if ((results == NULL) && (noResults > 0))
+  {
+    RAISE_ERROR("Not enough memory to process a verification notification "
+                "batch with %u results!", noResults);
+    return;
+  }
+
+  for (idx = 0; idx < noResults; idx++, pduRes++)
+  {
+    bool useROA    = (pduRes->resultType & SRX_FLAG_ROA) == SRX_FLAG_ROA;
+    bool useBGPSEC = (pduRes->resultType & SRX_FLAG_BGPSEC) == SRX_FLAG_BGPSEC;
+    bool useASPA   = (pduRes->resultType & SRX_FLAG_ASPA) == SRX_FLAG_ASPA;
+
+    result = &results[idx];
+    result->updateID     = ntohl(pduRes->updateID);
+    result->valType      = pduRes->resultType & SRX_FLAG_ROA_BGPSEC_ASPA;
+    result->roaResult    = useROA ? pduRes->roaResult : SRx_RESULT_UNDEFINED;
+    result->bgpsecResult = useBGPSEC ? pduRes->bgpsecResult
+                                     : SRx_RESULT_UNDEFINED;
+    result->aspaResult   = useASPA ? pduRes->aspaResult : SRx_RESULT_UNDEFINED;
+  }
+
+  if (proxy->resBatchCallback != NULL)
+  {
+    proxy->resBatchCallback(noResults, results, proxy->userPtr);
+  }
+  else
+  {
+    // Results of a batch are never a receipt, they do not have a local id.
+    for (idx = 0; idx < noResults; idx++)
+    {
+      result = &results[idx];
+      proxy->resCallback(result->updateID, 0, result->valType,
+                         result->roaResult, result->bgpsecResult,
+                         result->aspaResult, proxy->userPtr);
+    }
+  }
+
+  free(results);
+}
+
 /**
  * Process signature notification.
  * NOT IMPLEMENTED YET
@@ -1276,6 +1583,11 @@ static void dispatchPackets(SRXPROXY_BasicHeader* packet, void* proxyPtr)
       processVerifyNotify((SRXPROXY_VERIFY_NOTIFICATION*)packet, proxy);
       break;
 
+    case PDU_SRXPROXY_VERI_NOTIFICATION_BATCH:
+      processVerifyNotifyBatch((SRXPROXY_VERIFY_NOTIFICATION_BATCH*)packet,
+                               proxy);
+      break;
+
     case PDU_SRXPROXY_SIGN_NOTIFICATION:
       processSignNotify((SRXPROXY_SIGNATURE_NOTIFICATION*)packet, proxy);
       break;
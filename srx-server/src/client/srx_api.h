@@ -181,6 +181,36 @@ typedef bool (*ValidationReady)(SRxUpdateID          updateID,
                                 uint8_t              aspaResult,
                                 void* userPtr);
 
+/**
+ * One validation result of a verification notification batch.
+ *
+ * @since 0.6.0
+ */
+typedef struct {
+  SRxUpdateID          updateID;
+  ValidationResultType valType;
+  uint8_t              roaResult;
+  uint8_t              bgpsecResult;
+  uint8_t              aspaResult;
+} SRxUpdateResult;
+
+/**
+ * Used to report the changed validation results of multiple updates at once.
+ * srx-server sends these batches when a change in the RPKI data affects many
+ * updates. The results are ordered as they occurred, an update might be listed
+ * more than once. If this callback is not registered, each result is reported
+ * using the ValidationReady callback.
+ *
+ * @param noResults The number of results.
+ * @param results  The results, only valid during the call.
+ * @param usrPtr Pointer to SRxProxy.userPtr provided by router / user of the
+ *               API.
+ *
+ * @since 0.6.0
+ */
+typedef void (*ValidationsReady)(uint32_t noResults, SRxUpdateResult* results,
+                                 void* userPtr);
+
 /**
  * Used to return the calculated signatures.
  *
@@ -252,6 +282,24 @@ typedef struct {
   uint16_t succsessSend;
 } ProxySocketConfig;
 
+/** The maximum size of a verify batch PDU in bytes. */
+#define SRX_PROXY_VERIFY_BATCH_SIZE 65536
+
+/** Verify requests collected between beginVerifyBatch and flushVerifyBatch.
+ *
+ * @since 0.6.0
+ */
+typedef struct {
+  // Indicates if verify requests are collected.
+  bool     corked;
+  // The verify batch PDU, allocated with SRX_PROXY_VERIFY_BATCH_SIZE bytes.
+  uint8_t* buffer;
+  // Number of bytes of the buffer in use including the batch header.
+  uint32_t length;
+  // Number of verify requests stored in the buffer.
+  uint32_t noRequests;
+} SRxVerifyBatch;
+
 /** The data structure of the proxy. DO NOT change the settings, this is done
  * within the proxy implementation.
  */
@@ -280,6 +328,12 @@ typedef struct {
     
   // Experimental
   ProxySocketConfig socketConfig;
+
+  // Verify requests waiting to be send as one batch.
+  SRxVerifyBatch    verifyBatch;
+
+  // Optional callback for verification notification batches.
+  ValidationsReady  resBatchCallback;
 } SRxProxy;
 
 
@@ -440,6 +494,48 @@ void verifyUpdate(SRxProxy* proxy, uint32_t localID,
                   IPPrefix* prefix, uint32_t as32,
                   BGPSecData* bgpsec, SRxASPathList asPathList);
 
+/**
+ * Register the callback that receives the results of verification notification
+ * batches. Without this callback each result of a batch is reported using the
+ * ValidationReady callback given to createSRxProxy.
+ *
+ * @param proxy The proxy instance
+ * @param validationsReadyCallback The batch callback or NULL.
+ *
+ * @since 0.6.0
+ */
+void setValidationsReadyCallback(SRxProxy* proxy,
+                                 ValidationsReady validationsReadyCallback);
+
+/**
+ * Start collecting verify requests into one verify batch PDU. All following
+ * calls of verifyUpdate are not send right away, they are send using one
+ * single PDU once flushVerifyBatch is called or the batch is full. This allows
+ * to reduce the number of send operations while processing a complete BGP
+ * UPDATE message or a complete table walk. Batches are only used if the SRx
+ * server announced support for them during the handshake, otherwise each
+ * request is send right away as before.
+ *
+ * The batch MUST be flushed by the same thread that calls verifyUpdate.
+ *
+ * @param proxy The proxy instance (can be NULL)
+ *
+ * @since 0.6.0
+ */
+void beginVerifyBatch(SRxProxy* proxy);
+
+/**
+ * Send all verify requests collected since beginVerifyBatch was called and
+ * stop collecting further requests.
+ *
+ * @param proxy The proxy instance (can be NULL)
+ *
+ * @return false if the collected requests could not be send.
+ *
+ * @since 0.6.0
+ */
+bool flushVerifyBatch(SRxProxy* proxy);
+
 /**
  * This method generates a signature request. The signature will be returned
  * using the signature notification callback.
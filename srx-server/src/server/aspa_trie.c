@@ -1,4 +1,3 @@
-
 #include <stdio.h> /* printf */
 #include <stdlib.h> /* exit */
 #include <string.h>
@@ -9,24 +8,320 @@
 #include "server/rpki_queue.h"
 #include "util/log.h"
 
-static uint32_t countTrieNode =0;
-int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid, uint32_t pid, time_t ct);
+int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid, uint32_t pid, uint32_t seq);
 extern RPKI_QUEUE* getRPKIQueue();
 extern uint8_t validateASPA (PATH_LIST* asPathList, uint8_t length, AS_TYPE asType, 
                     AS_REL_DIR direction, uint8_t afi, ASPA_DBManager* aspaDBManager);
 
+// Calculate the home slot of the given key (fibonacci hashing of ASN and AFI)
+//
+static inline uint32_t _aspaHash(ASPA_DBManager* self, uint32_t customerAsn, 
+                                 uint16_t afi)
+{
+  uint64_t key = ((uint64_t)afi << 32) | customerAsn;
+  return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - self->tableBits));
+}
+
+// Return the slot of the given key or NULL if not found. 
+// The caller MUST hold the table lock.
+//
+static inline ASPA_Object* _findSlot(ASPA_DBManager* self, uint32_t customerAsn,
+                                     uint16_t afi)
+{
+  uint32_t     mask = self->tableSize - 1;
+  uint32_t     idx  = _aspaHash(self, customerAsn, afi);
+  ASPA_Object* slot = &self->table[idx];
+
+  // The table is never full, an empty slot terminates the probe sequence
+  while (slot->afi != 0)
+  {
+    if (slot->customerAsn == customerAsn && slot->afi == afi)
+    {
+      return slot;
+    }
+    idx  = (idx + 1) & mask;
+    slot = &self->table[idx];
+  }
+
+  return NULL;
+}
+
+// Copy the object into the first free slot of its probe sequence. The key MUST
+// NOT exist in the table and the caller MUST hold the write lock.
+//
+static void _putSlot(ASPA_DBManager* self, ASPA_Object* obj)
+{
+  uint32_t mask = self->tableSize - 1;
+  uint32_t idx  = _aspaHash(self, obj->customerAsn, obj->afi);
+
+  while (self->table[idx].afi != 0)
+  {
+    idx = (idx + 1) & mask;
+  }
+  self->table[idx] = *obj;
+}
+
+// Allocate an empty table with 2^bits slots. The caller MUST hold the write 
+// lock or be the only user of the db.
+//
+static bool _allocTable(ASPA_DBManager* self, uint8_t bits)
+{
+  ASPA_Object* table = (ASPA_Object*)calloc((size_t)1 << bits, 
+                                            sizeof(ASPA_Object));
+  if (!table)
+  {
+    RAISE_ERROR("Not enough memory for the aspa object db");
+    return false;
+  }
+  self->table     = table;
+  self->tableBits = bits;
+  self->tableSize = (uint32_t)1 << bits;
+
+  return true;
+}
+
+// Double the size of the table and rehash all objects. The caller MUST hold 
+// the write lock.
+//
+static bool _growTable(ASPA_DBManager* self)
+{
+  ASPA_Object* oldTable = self->table;
+  uint32_t     oldSize  = self->tableSize;
+
+  if (!_allocTable(self, self->tableBits + 1))
+  {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < oldSize; i++)
+  {
+    if (oldTable[i].afi != 0)
+    {
+      _putSlot(self, &oldTable[i]);
+    }
+  }
+  free(oldTable);
+
+  return true;
+}
+
+// Remove the slot from the table. The following entries of the cluster are 
+// shifted back to keep all probe sequences intact (no tomb stones needed).
+// The caller MUST hold the write lock.
+//
+static void _removeSlot(ASPA_DBManager* self, ASPA_Object* slot)
+{
+  uint32_t mask = self->tableSize - 1;
+  uint32_t hole = (uint32_t)(slot - self->table);
+  uint32_t idx  = hole;
+  uint32_t home;
+
+  while (true)
+  {
+    idx = (idx + 1) & mask;
+    if (self->table[idx].afi == 0)
+    {
+      break;
+    }
+    home = _aspaHash(self, self->table[idx].customerAsn, 
+                     self->table[idx].afi);
+    // Leave the entry if its home slot lies cyclically in (hole, idx]
+    if ((hole <= idx) ? ((hole < home) && (home <= idx))
+                      : ((hole < home) || (home <= idx)))
+    {
+      continue;
+    }
+    self->table[hole] = self->table[idx];
+    hole = idx;
+  }
+  memset(&self->table[hole], 0, sizeof(ASPA_Object));
+}
+
+// Remember the customer ASN as changed. The caller MUST hold the write lock.
+//
+static void _markChanged(ASPA_DBManager* self, uint32_t customerAsn)
+{
+  if (self->changedAll)
+  {
+    return;
+  }
+
+  if (self->noChangedAsns == self->changedAsnsSize)
+  {
+    uint32_t  newSize = self->changedAsnsSize == 0 ? 64 
+                                                   : self->changedAsnsSize * 2;
+    uint32_t* newAsns = NULL;
+    if (newSize <= ASPA_DB_MAX_CHANGED)
+    {
+      newAsns = realloc(self->changedAsns, newSize * sizeof(uint32_t));
+    }
+    if (!newAsns)
+    {
+      // Too many changes, fall back to a complete revalidation.
+      self->changedAll    = true;
+      self->noChangedAsns = 0;
+      return;
+    }
+    self->changedAsns     = newAsns;
+    self->changedAsnsSize = newSize;
+  }
+  self->changedAsns[self->noChangedAsns++] = customerAsn;
+}
+
+// sort helper for the provider ASNs
+//
+static int _cmpAsn(const void* a, const void* b)
+{
+  uint32_t asnA = *(const uint32_t*)a;
+  uint32_t asnB = *(const uint32_t*)b;
+  return (asnA > asnB) - (asnA < asnB);
+}
+
+// Return the index of the source of the given validation cache or -1 if the
+// cache does not provide the object.
+//
+static int _findSource(ASPA_Object* slot, uint32_t valCacheID)
+{
+  for (int idx = 0; idx < slot->noSources; idx++)
+  {
+    if (slot->sources[idx].valCacheID == valCacheID)
+    {
+      return idx;
+    }
+  }
+  return -1;
+}
+
+// Replace the provider ASNs of the slot with the union of the provider ASNs 
+// of all its sources and remember the customer ASN as changed if the union 
+// differs. The caller MUST hold the write lock.
+// Returns false if not enough memory is available, the slot keeps its former
+// provider ASNs in this case.
+//
+static bool _mergeSources(ASPA_DBManager* self, ASPA_Object* slot)
+{
+  uint32_t  total = 0;
+  uint32_t  count = 0;
+  uint32_t* asns  = NULL;
+  int       idx;
+
+  for (idx = 0; idx < slot->noSources; idx++)
+  {
+    total += slot->sources[idx].providerAsCount;
+  }
+  if (total > 0)
+  {
+    asns = malloc(total * sizeof(uint32_t));
+    if (!asns)
+    {
+      RAISE_ERROR("Not enough memory to merge the providers of the aspa "
+                  "object of customer ASN %u", slot->customerAsn);
+      return false;
+    }
+    for (idx = 0; idx < slot->noSources; idx++)
+    {
+      if (slot->sources[idx].providerAsCount > 0)
+      {
+        memcpy(asns + count, slot->sources[idx].providerAsns, 
+               slot->sources[idx].providerAsCount * sizeof(uint32_t));
+        count += slot->sources[idx].providerAsCount;
+      }
+    }
+    if (slot->noSources > 1)
+    {
+      qsort(asns, total, sizeof(uint32_t), _cmpAsn);
+      count = 1;
+      for (uint32_t i = 1; i < total; i++)
+      {
+        if (asns[i] != asns[count-1])
+        {
+          asns[count++] = asns[i];
+        }
+      }
+    }
+  }
+
+  if (   count != slot->providerAsCount
+      || (count > 0 && memcmp(asns, slot->providerAsns, 
+                              count * sizeof(uint32_t)) != 0))
+  {
+    _markChanged(self, slot->customerAsn);
+  }
+  if (slot->providerAsns)
+  {
+    free(slot->providerAsns);
+  }
+  slot->providerAsns    = asns;
+  slot->providerAsCount = (uint16_t)count;
+
+  return true;
+}
+
+// Remove the source at the given index from the slot. The slot itself is 
+// removed with its last source. The caller MUST hold the write lock.
+// Returns true if the slot was removed.
+//
+static bool _removeSource(ASPA_DBManager* self, ASPA_Object* slot, int srcIdx)
+{
+  uint32_t customerAsn = slot->customerAsn;
+
+  if (slot->sources[srcIdx].providerAsns)
+  {
+    free(slot->sources[srcIdx].providerAsns);
+  }
+  slot->sources[srcIdx] = slot->sources[--slot->noSources];
+
+  if (slot->noSources == 0)
+  {
+    free(slot->sources);
+    if (slot->providerAsns)
+    {
+      free(slot->providerAsns);
+    }
+    _removeSlot(self, slot);
+    self->countAspaObj--;
+    _markChanged(self, customerAsn);
+    return true;
+  }
+
+  if (!_mergeSources(self, slot))
+  {
+    // The union still contains the removed providers, revalidate anyhow.
+    _markChanged(self, customerAsn);
+  }
+  return false;
+}
+
 // API for initialization
 //
 bool initializeAspaDBManager(ASPA_DBManager* aspaDBManager, Configuration* config) 
 {
-   aspaDBManager->tableRoot = newAspaTrie();
+   uint8_t bits = 0;
+   while (((uint32_t)1 << bits) < ASPA_DB_INIT_SIZE)
+   {
+     bits++;
+   }
+
+   aspaDBManager->table = NULL;
    aspaDBManager->countAspaObj = 0;
+   aspaDBManager->changedAsns = NULL;
+   aspaDBManager->noChangedAsns = 0;
+   aspaDBManager->changedAsnsSize = 0;
+   aspaDBManager->changedAll = false;
+   aspaDBManager->validationSeq = 0;
    aspaDBManager->config = config;
    aspaDBManager->cbProcessEndOfData = process_ASPA_EndOfData_main;
   
+   if (!_allocTable(aspaDBManager, bits))
+   {
+     return false;
+   }
+
    if (!createRWLock(&aspaDBManager->tableLock))
    {
      RAISE_ERROR("Unable to setup the aspa object db r/w lock");
+     free(aspaDBManager->table);
+     aspaDBManager->table = NULL;
      return false;
    }
 
@@ -38,9 +333,31 @@ bool initializeAspaDBManager(ASPA_DBManager* aspaDBManager, Configuration* confi
 static void emptyAspaDB(ASPA_DBManager* self)
 {
   acquireWriteLock(&self->tableLock);
-  free_trienode(self->tableRoot);
-  self->tableRoot = NULL;
+  for (uint32_t i = 0; i < self->tableSize; i++)
+  {
+    if (self->table[i].afi != 0)
+    {
+      for (int idx = 0; idx < self->table[i].noSources; idx++)
+      {
+        if (self->table[i].sources[idx].providerAsns)
+        {
+          free(self->table[i].sources[idx].providerAsns);
+        }
+      }
+      if (self->table[i].sources)
+      {
+        free(self->table[i].sources);
+      }
+      if (self->table[i].providerAsns)
+      {
+        free(self->table[i].providerAsns);
+      }
+    }
+  }
+  memset(self->table, 0, self->tableSize * sizeof(ASPA_Object));
   self->countAspaObj = 0;
+  self->changedAll = true;
+  self->noChangedAsns = 0;
   unlockWriteLock(&self->tableLock);
 }
 
@@ -49,46 +366,64 @@ static void emptyAspaDB(ASPA_DBManager* self)
 //
 void releaseAspaDBManager(ASPA_DBManager* self)
 {
-  if (self != NULL)
+  if (self != NULL && self->table != NULL)
   {
-    releaseRWLock(&self->tableLock);
     emptyAspaDB(self);
+    free(self->table);
+    self->table     = NULL;
+    self->tableSize = 0;
+    if (self->changedAsns)
+    {
+      free(self->changedAsns);
+      self->changedAsns = NULL;
+    }
+    self->noChangedAsns = self->changedAsnsSize = 0;
+    releaseRWLock(&self->tableLock);
   }
 }
 
-
-// generate trie node
-//
-static TrieNode* newAspaTrie(void) 
-{
-  TrieNode *rootNode = make_trienode('\0', NULL, NULL);
-  return rootNode;
-}
-
-
 // external api for creating db object
+// The provider ASNs are stored sorted and without duplicates to allow binary 
+// search during lookup.
 //
 ASPA_Object* newASPAObject(uint32_t cusAsn, uint16_t pAsCount, uint32_t* provAsns, uint16_t afi)
 {
   ASPA_Object *obj = (ASPA_Object*)calloc(1, sizeof(ASPA_Object));
+  if (!obj)
+  {
+    return NULL;
+  }
   obj->customerAsn = cusAsn;
-  obj->providerAsCount = pAsCount;
-  obj->providerAsns = (uint32_t*) calloc(pAsCount, sizeof(uint32_t));
-  
-  if (obj->providerAsns && provAsns)
+  obj->providerAsCount = 0;
+  obj->providerAsns = NULL;
+  obj->afi = afi;
+
+  if (pAsCount > 0 && provAsns)
   {
-    for(int i=0; i< pAsCount; i++)
+    obj->providerAsns = (uint32_t*) calloc(pAsCount, sizeof(uint32_t));
+    if (obj->providerAsns)
     {
-      obj->providerAsns[i] = provAsns[i];
+      memcpy(obj->providerAsns, provAsns, pAsCount * sizeof(uint32_t));
+      qsort(obj->providerAsns, pAsCount, sizeof(uint32_t), _cmpAsn);
+
+      // remove duplicates
+      obj->providerAsCount = 1;
+      for(int i=1; i< pAsCount; i++)
+      {
+        if (obj->providerAsns[i] != obj->providerAsns[obj->providerAsCount-1])
+        {
+          obj->providerAsns[obj->providerAsCount++] = obj->providerAsns[i];
+        }
+      }
     }
   }
-  obj->afi = afi;
 
   return obj;
 
 }
 
-// delete aspa object
+// delete aspa object - only releases the memory, the object MUST NOT be 
+// stored in the db anymore.
 //
 bool deleteASPAObject(ASPA_DBManager* self, ASPA_Object *obj)
 {
@@ -98,48 +433,23 @@ bool deleteASPAObject(ASPA_DBManager* self, ASPA_Object *obj)
     {
       free(obj->providerAsns);
     }
+    for (int idx = 0; idx < obj->noSources; idx++)
+    {
+      if (obj->sources[idx].providerAsns)
+      {
+        free(obj->sources[idx].providerAsns);
+      }
+    }
+    if (obj->sources)
+    {
+      free(obj->sources);
+    }
     free (obj);
-    self->countAspaObj--;
     return true;
   }
   return false;
 }
 
-
-// create trie node
-//
-static TrieNode* make_trienode(char data, char* userData, ASPA_Object* obj) {
-    // Allocate memory for a TrieNode
-    TrieNode* node = (TrieNode*) calloc (1, sizeof(TrieNode));
-    if (!node)
-    {
-      return NULL;
-    }
-
-    for (int i=0; i<N; i++)
-        node->children[i] = NULL;
-    node->is_leaf = 0;
-    node->data = data;
-    node->userData = NULL;
-    node->aspaObjects = NULL;
-    return node;
-}
-
-// free node
-static void free_trienode(TrieNode* node) {
-    // Free the trienode sequence
-    int i=0;
-    for(i=0; i<N; i++) {
-        if (node->children[i] != NULL) {
-            free_trienode(node->children[i]);
-        }
-        else {
-            continue;
-        }
-    }
-    free(node);
-}
-
 bool compareAspaObject(ASPA_Object *obj1, ASPA_Object *obj2)
 {
   if (!obj1 || !obj2)
@@ -154,41 +464,36 @@ bool compareAspaObject(ASPA_Object *obj1, ASPA_Object *obj2)
   if (obj1->afi != obj2->afi)
     return false;
 
-  for(int i=0; i < obj1->providerAsCount; i++)
-  {
-    if(obj1->providerAsns[i] != obj2->providerAsns[i])
-      return false;
-  }
+  // both provider lists are sorted
+  if (obj1->providerAsCount > 0 
+      && memcmp(obj1->providerAsns, obj2->providerAsns, 
+                obj1->providerAsCount * sizeof(uint32_t)) != 0)
+    return false;
+
   return true;
 }
 
 
-
-bool delete_TrieNode_AspaObj (ASPA_DBManager* self, char* word, ASPA_Object* obj)
+// withdraw the provider ASNs the given validation cache announced for the 
+// customer ASN of the object. The object is removed once no validation cache
+// provides it anymore. The given object remains owned by the caller.
+//
+bool deleteAspaObj(ASPA_DBManager* self, ASPA_Object* obj, uint32_t valCacheID)
 {
   bool bRet = false;
 
   acquireWriteLock(&self->tableLock);
-  TrieNode* temp = self->tableRoot; 
-
-  // finding
-  for(int i=0; word[i]!='\0'; i++)
+  ASPA_Object* slot = _findSlot(self, obj->customerAsn, obj->afi);
+  int          idx  = slot ? _findSource(slot, valCacheID) : -1;
+
+  // info compare, both provider lists are sorted
+  if (   idx >= 0
+      && slot->sources[idx].providerAsCount == obj->providerAsCount
+      && (   obj->providerAsCount == 0
+          || memcmp(slot->sources[idx].providerAsns, obj->providerAsns,
+                    obj->providerAsCount * sizeof(uint32_t)) == 0))
   {
-    int position = word[i] - '0';
-    if (temp->children[position] == NULL)
-    {
-      temp = NULL;
-      break;
-    }
-    temp = temp->children[position];
-  }
-
-  // info compare
-  if (temp && temp->is_leaf == 1 && temp->aspaObjects 
-      && compareAspaObject(temp->aspaObjects, obj))
-  {
-    deleteASPAObject(self, temp->aspaObjects);
-    free_trienode(temp);
+    _removeSource(self, slot, idx);
     bRet = true;
   }
 
@@ -198,230 +503,317 @@ bool delete_TrieNode_AspaObj (ASPA_DBManager* self, char* word, ASPA_Object* obj
 }
 
 //  new value insert or substitution according to draft
+//  Each validation cache provides its own provider ASNs for the customer ASN,
+//  a new announcement of the same cache substitutes them. The stored object 
+//  uses the union of the provider ASNs of all validation caches.
+//  On success the provider ASNs are moved into the table, the given object 
+//  itself is released and MUST NOT be used by the caller anymore. On failure
+//  (e.g. the table could not grow) the object remains owned by the caller who
+//  has to release it using deleteASPAObject.
 //
-TrieNode* insertAspaObj (ASPA_DBManager* self, char* word, char* userData, ASPA_Object* obj) {
+bool insertAspaObj(ASPA_DBManager* self, ASPA_Object* obj, uint32_t valCacheID)
+{
+  bool bRet = false;
 
-    TrieNode* temp = self->tableRoot; // start with root node
-    acquireWriteLock(&self->tableLock);
+  if (!obj || obj->afi == 0)
+  {
+    return false;
+  }
 
-    for (int i=0; word[i] != '\0'; i++) {
-        int idx = (int) word[i] - '0';
-        //printf("index: %02x(%d), word[%d]: %c  \n", idx, idx, i, word[i]);
-        if (temp->children[idx] == NULL) {
-            // If the corresponding child doesn't exist, simply create that child!
-            temp->children[idx] = make_trienode(word[i], userData, obj);
-        }
-        else {
-            // Do nothing. The node already exists
-        }
-        // Go down a level, to the child referenced by idx
-        temp = temp->children[idx];
-    }
+  acquireWriteLock(&self->tableLock);
+  ASPA_Object* slot = _findSlot(self, obj->customerAsn, obj->afi);
 
-    if (temp)
+  if (slot)
+  {
+    int idx = _findSource(slot, valCacheID);
+    if (idx < 0)
+    {
+      ASPA_Source* sources = realloc(slot->sources, 
+                               (slot->noSources + 1) * sizeof(ASPA_Source));
+      if (!sources)
+      {
+        unlockWriteLock(&self->tableLock);
+        RAISE_ERROR("Not enough memory to add the aspa object source");
+        return false;
+      }
+      slot->sources = sources;
+      idx = slot->noSources++;
+    }
+    else if (slot->sources[idx].providerAsns)
+    {
+      // substitution of the providers of this validation cache
+      free(slot->sources[idx].providerAsns);
+    }
+    slot->sources[idx].valCacheID      = valCacheID;
+    slot->sources[idx].providerAsCount = obj->providerAsCount;
+    slot->sources[idx].providerAsns    = obj->providerAsns;
+    if (!_mergeSources(self, slot))
     {
-      // At the end of the word, mark this node as the leaf node
-      temp->is_leaf = 1;
-      temp->userData =  userData;
+      // The union misses the new providers, revalidate anyhow.
+      _markChanged(self, obj->customerAsn);
+    }
+    bRet = true;
+  }
+  else
+  {
+    ASPA_Source* source = NULL;
+    ASPA_Object  newObj = *obj;
 
-      // substitution if exist
-      if (temp->aspaObjects && temp->aspaObjects != obj)
+    // keep the fill level low enough for short probe sequences
+    if (   ((self->countAspaObj + 1) * 100 <= self->tableSize * ASPA_DB_MAX_LOAD
+            || _growTable(self))
+        && (source = malloc(sizeof(ASPA_Source))) != NULL)
+    {
+      newObj.providerAsns = NULL;
+      if (obj->providerAsCount > 0)
       {
-        deleteASPAObject(self, temp->aspaObjects);
-        countTrieNode--;
+        newObj.providerAsns = malloc(obj->providerAsCount * sizeof(uint32_t));
       }
-      temp->aspaObjects = obj;
-      countTrieNode++;
-      self->countAspaObj++;
+      if (obj->providerAsCount > 0 && !newObj.providerAsns)
+      {
+        free(source);
+        source = NULL;
+      }
+    }
+    if (!source)
+    {
+      unlockWriteLock(&self->tableLock);
+      RAISE_ERROR("Not enough memory to store the aspa object");
+      return false;
     }
+    if (newObj.providerAsns)
+    {
+      memcpy(newObj.providerAsns, obj->providerAsns, 
+             obj->providerAsCount * sizeof(uint32_t));
+    }
+    source->valCacheID      = valCacheID;
+    source->providerAsCount = obj->providerAsCount;
+    source->providerAsns    = obj->providerAsns;
+    newObj.noSources = 1;
+    newObj.sources   = source;
+    _putSlot(self, &newObj);
+    self->countAspaObj++;
+    _markChanged(self, obj->customerAsn);
+    bRet = true;
+  }
 
-    unlockWriteLock(&self->tableLock);
+  unlockWriteLock(&self->tableLock);
 
-    return temp;
-}
+  if (bRet)
+  {
+    // the provider ASNs are owned by the table now
+    free(obj);
+  }
 
-// get total count
-//
-uint32_t getCountTrieNode(void)
-{
-  return countTrieNode;
+  return bRet;
 }
 
-// search method
+// Remove the provider ASNs of the given validation cache from all objects, 
+// objects not provided by any other validation cache are removed.
+// Returns the number of objects the validation cache provided.
 //
-static int search_trie(TrieNode* root, char* word)
+uint32_t removeAspaObjsOfCache(ASPA_DBManager* self, uint32_t valCacheID)
 {
-    // Searches for word in the Trie
-    TrieNode* temp = root;
-    int i=0;
-    for(i=0; word[i]!='\0'; i++)
+  uint32_t removed = 0;
+  uint32_t idx     = 0;
+  int      srcIdx;
+
+  acquireWriteLock(&self->tableLock);
+  while (idx < self->tableSize)
+  {
+    srcIdx = (self->table[idx].afi != 0) 
+             ? _findSource(&self->table[idx], valCacheID) : -1;
+    if (srcIdx >= 0)
     {
-        int position = word[i] - '0';
-        if (temp->children[position] == NULL)
-            return 0;
-        temp = temp->children[position];
+      removed++;
+      if (_removeSource(self, &self->table[idx], srcIdx))
+      {
+        // A following object might have been shifted into this slot.
+        continue;
+      }
     }
-    if (temp != NULL && temp->is_leaf == 1)
-        return 1;
-    return 0;
+    idx++;
+  }
+  unlockWriteLock(&self->tableLock);
+
+  return removed;
 }
 
-// external api for searching trie
+// external api for searching the db
+// The stored object is copied while the table lock is held, the slots move 
+// once the table grows or an object is removed. The returned copy is owned by
+// the caller and MUST be released using deleteASPAObject.
 //
-ASPA_Object* findAspaObject(ASPA_DBManager* self, char* word)
+ASPA_Object* findAspaObject(ASPA_DBManager* self, uint32_t customerAsn, uint16_t afi)
 {
-    ASPA_Object *obj;
+    ASPA_Object *obj  = NULL;
+    ASPA_Object *slot = NULL;
   
-    acquireWriteLock(&self->tableLock);
-    TrieNode* temp = self->tableRoot; 
-
-    for(int i=0; word[i]!='\0'; i++)
+    acquireReadLock(&self->tableLock);
+    slot = _findSlot(self, customerAsn, afi);
+    if (slot)
     {
-        int position = word[i] - '0';
-        if (temp->children[position] == NULL)
-        {
-          obj = NULL;
-          temp = NULL;
-          break;
-        }
-        temp = temp->children[position];
+      obj = newASPAObject(slot->customerAsn, slot->providerAsCount, 
+                          slot->providerAsns, slot->afi);
+      if (!obj)
+      {
+        RAISE_ERROR("Not enough memory to copy the aspa object");
+      }
     }
+    unlockReadLock(&self->tableLock);
 
-    if (temp != NULL && temp->is_leaf == 1)
+    return obj;
+}
+
+//
+//  print all objects
+//
+void printAllAspaObjects(ASPA_DBManager* self)
+{
+  uint32_t count=0;
+
+  acquireReadLock(&self->tableLock);
+  for (uint32_t idx=0; idx < self->tableSize; idx++) 
+  {
+    ASPA_Object *obj = &self->table[idx];
+    if (obj->afi != 0)
     {
-        obj = temp->aspaObjects;
+      printf("\n++ count: %u, slot: %u, ASPA object:%p \n", 
+          ++count, idx, obj);
+      printf("++ customer ASN: %u\n", obj->customerAsn);
+      printf("++ providerAsCount : %d\n", obj->providerAsCount);
+      printf("++ Address: provider asns : %p\n", obj->providerAsns);
+      if (obj->providerAsns)
+      {
+        for(int i=0; i< obj->providerAsCount; i++)
+          printf("++ providerAsns[%d]: %u\n", i, obj->providerAsns[i]);
+      }
+      printf("++ afi: %d\n", obj->afi);
+      printf("++ validation caches: %d\n", obj->noSources);
     }
-    unlockWriteLock(&self->tableLock);
-
-    return obj;
+  }
+  unlockReadLock(&self->tableLock);
 }
 
 //
-//  print all nodes
+// Hand the customer ASNs changed since the last call over to the caller and 
+// reset the change tracking. The returned array is sorted, free of duplicates,
+// and MUST be freed by the caller. If 'all' is set to true too many changes
+// were recorded (or the db was emptied) and everything must be revalidated.
+// Returns the number of ASNs in the array.
 //
-TrieNode* printAllLeafNode(TrieNode *node)
+uint32_t takeChangedCustomerAsns(ASPA_DBManager* self, uint32_t** asns, bool* all)
 {
-  TrieNode* leaf = NULL;
-  uint8_t count=0;
+  uint32_t count = 0;
 
-  if (node->is_leaf == 1)
+  acquireWriteLock(&self->tableLock);
+  *all  = self->changedAll;
+  *asns = NULL;
+  if (!self->changedAll && self->noChangedAsns > 0)
   {
-    leaf = node;
-    return leaf;
+    *asns = self->changedAsns;
+    count = self->noChangedAsns;
+    self->changedAsns     = NULL;
+    self->changedAsnsSize = 0;
   }
+  self->noChangedAsns = 0;
+  self->changedAll    = false;
+  unlockWriteLock(&self->tableLock);
 
-  for (int i=0; i<N; i++) 
+  if (count > 1)
   {
-    if(node->children[i])
+    uint32_t idx = 0;
+    qsort(*asns, count, sizeof(uint32_t), _cmpAsn);
+    for (uint32_t i = 1; i < count; i++)
     {
-      leaf = printAllLeafNode(node->children[i]);
-      if (leaf)
+      if ((*asns)[i] != (*asns)[idx])
       {
-        //printf("++ count: %d i:%d digit: %c user data: %s\n", ++count, i, leaf->data, leaf->userData);
-        printf("\n++ count: %d, user data: %s, ASPA object:%p \n", 
-            ++count, leaf->userData, leaf->aspaObjects);
-
-        ASPA_Object *obj = leaf->aspaObjects;
-        if (obj)
-        {
-          printf("++ customer ASN: %d\n", obj->customerAsn);
-          printf("++ providerAsCount : %d\n", obj->providerAsCount);
-          printf("++ Address: provider asns : %p\n", obj->providerAsns);
-          if (obj->providerAsns)
-          {
-            for(int i=0; i< obj->providerAsCount; i++)
-              printf("++ providerAsns[%d]: %d\n", i, obj->providerAsns[i]);
-          }
-          printf("++ afi: %d\n", obj->afi);
-        }
+        (*asns)[++idx] = (*asns)[i];
       }
     }
+    count = idx + 1;
   }
 
-  return NULL;
+  return count;
 }
 
-
-
-void print_trie(TrieNode* root) {/*{{{*/
-    // Prints the nodes of the trie
-    if (!root)
-        return;
-    TrieNode* temp = root;
-    printf("%c -> ", temp->data);
-    int i=0;
-    for (i=0; i<N; i++) {
-        print_trie(temp->children[i]);
-    }
+//
+// Start a new End of Data revalidation and return its sequence number. AS 
+// paths validated with a lower sequence number are revalidated, paths that
+// carry the returned number already were validated during this round.
+//
+uint32_t nextAspaValidationSeq(ASPA_DBManager* self)
+{
+  return __sync_add_and_fetch(&self->validationSeq, 1);
 }
 
-void print_search(TrieNode* root, char* word) {
-    printf("Searching for %s: ", word);
-    if (search_trie(root, word) == 0)
-        printf("Not Found\n");
-    else
-        printf("Found!\n");
-}/*}}}*/
+//
+// Return the sequence number of the current End of Data revalidation. It MUST
+// be read before the AS path is validated outside of the End of Data 
+// processing, changes made later are part of the next revalidation.
+//
+uint32_t getAspaValidationSeq(ASPA_DBManager* self)
+{
+  return __sync_fetch_and_add(&self->validationSeq, 0);
+}
 
 // 
 // external API for db loopkup
+// This is called for each hop of the AS path, therefore no logging is done 
+// here and the provider set is searched binary.
 //
 ASPA_ValidationResult ASPA_DB_lookup(ASPA_DBManager* self, uint32_t customerAsn, uint32_t providerAsn, uint8_t afi )
 {
-  LOG(LEVEL_DEBUG, FILE_LINE_INFO " ASPA DB Lookup called");
-
-  char strCusAsn[6] = {};
-  sprintf(strCusAsn, "%d", customerAsn);  
+  ASPA_ValidationResult result = ASPA_RESULT_UNKNOWN;
 
-  ASPA_Object *obj = findAspaObject(self, strCusAsn);
+  acquireReadLock(&self->tableLock);
+  ASPA_Object* obj = _findSlot(self, customerAsn, afi);
 
-  if (!obj) // if there is no object item
-  {
-    LOG(LEVEL_INFO, "[db] No customer ASN exist -- Unknown");
-    return ASPA_RESULT_UNKNOWN;
-  }
-  else // found object
+  if (obj) // found object
   {
-    LOG(LEVEL_INFO, "[db] customer ASN: %d", obj->customerAsn);
-    LOG(LEVEL_INFO, "[db] providerAsCount : %d", obj->providerAsCount);
-    LOG(LEVEL_INFO, "[db] Address: provider asns : %p", obj->providerAsns);
-    LOG(LEVEL_INFO, "[db] afi: %d", obj->afi);
+    int          lower = 0;
+    int          upper = obj->providerAsCount - 1;
 
-    if (obj->providerAsns)
+    result = ASPA_RESULT_INVALID;
+    while (lower <= upper)
     {
-      for(int i=0; i< obj->providerAsCount; i++)
+      int      mid = (lower + upper) >> 1;
+      uint32_t asn = obj->providerAsns[mid];
+      if (asn == providerAsn)
       {
-        LOG(LEVEL_INFO, "[db] providerAsns[%d]: %d", i, obj->providerAsns[i]);
-        if (obj->providerAsns[i] == providerAsn && obj->afi == afi)
-        {
-          LOG(LEVEL_INFO, "[db] Matched -- Valid");
-          return ASPA_RESULT_VALID;
-        }
+        result = ASPA_RESULT_VALID;
+        break;
+      }
+      if (asn < providerAsn)
+      {
+        lower = mid + 1;
+      }
+      else
+      {
+        upper = mid - 1;
       }
-  
-      LOG(LEVEL_INFO, "[db] No Matched -- Invalid");
-      return ASPA_RESULT_INVALID;
     }
   }
-  return ASPA_RESULT_UNDEFINED;
+  unlockReadLock(&self->tableLock);
+
+  return result;
 
 }
 
 
 
-int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid, uint32_t pid, time_t ct)
+int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid, uint32_t pid, uint32_t seq)
 {
   SRxResult        srxRes;
   SRxDefaultResult defaultRes;
-  time_t lastEndOfDataTime = ct;
 
   UpdateCache*  uCache      = (UpdateCache*)uc;
   SRxUpdateID   updateID    = (SRxUpdateID) uid;
   uint32_t      pathId      = 0;
   RPKIHandler*  rpkiHandler = (RPKIHandler*)handler;
 
-  LOG(LEVEL_INFO, "=== main process_main_ASPA_EndOfData UpdateCache:%p rpkiHandler:%p ctime:%u", 
-      (UpdateCache*)uCache, (RPKIHandler*)rpkiHandler, ct);
+  LOG(LEVEL_INFO, "=== main process_main_ASPA_EndOfData UpdateCache:%p rpkiHandler:%p seq:%u", 
+      (UpdateCache*)uCache, (RPKIHandler*)rpkiHandler, seq);
 
 
   if (!getUpdateResult(uCache, &updateID, 0, NULL, &srxRes, &defaultRes, &pathId))
@@ -434,7 +826,6 @@ int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid, uint32_t
     if (defaultRes.result.aspaResult != SRx_RESULT_INVALID)
     {
       ASPA_DBManager* aspaDBManager = rpkiHandler->aspaDBManager;
-      TrieNode *root = aspaDBManager->tableRoot;
 
       LOG(LEVEL_INFO, "Update ID: 0x%08X  Path ID: 0x%08X", updateID, pathId);
 
@@ -448,11 +839,12 @@ int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid, uint32_t
           afi = AFI_IP;                      // set default
 
             
-        LOG(LEVEL_INFO, "Comparison End of Data time(%u) : AS cache entry updated time (%u)",
-            lastEndOfDataTime, aspl->lastModified);
-        // timestamp comparison
+        LOG(LEVEL_INFO, "Comparison End of Data sequence(%u) : AS cache entry "
+            "validation sequence (%u)", seq, aspl->validationSeq);
+        // sequence comparison, a time stamp would miss changes made within
+        // the same second.
         //
-        if (lastEndOfDataTime > aspl->lastModified)
+        if (seq > aspl->validationSeq)
         {
           // call ASPA validation
           //
@@ -462,9 +854,8 @@ int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid, uint32_t
           LOG(LEVEL_INFO, FILE_LINE_INFO "\033[92m"" Validation Result: %d "
               "(0:v, 2:Iv, 3:Ud 4:DNU 5:Uk, 6:Uf)""\033[0m", valResult);
 
-          // update the last validation time regardless of changed or not
-          time_t cTime = time(NULL);
-          aspl->lastModified = cTime;
+          // update the validation sequence regardless of changed or not
+          aspl->validationSeq = seq;
 
           // modify Aspath Cache with the validation result
           modifyAspaValidationResultToAspathCache (rpkiHandler->aspathCache, pathId, valResult, aspl);
@@ -488,7 +879,7 @@ int process_ASPA_EndOfData_main(void* uc, void* handler, uint32_t uid, uint32_t
         // in case there is another update cache entry whose path id is same with the previous
         // This prevents from doing ASPA validation repeatedly with the same AS path list
         //
-        else /* if else time comparison */
+        else /* if else sequence comparison */
         {
           // update cache entry with the new value 
           if (old_aspaResult != aspl->aspaValResult)
@@ -7,57 +7,68 @@
 #include "util/mutex.h"
 #include "util/rwlock.h"
 
-// The number of children for each node
-// We will construct a N-ary tree and make it a Trie
-#define N 10
+// The initial number of slots of the ASPA object table, MUST be a power of 2.
+#define ASPA_DB_INIT_SIZE 1024
+// The table grows once the fill level exceeds ASPA_DB_MAX_LOAD percent.
+#define ASPA_DB_MAX_LOAD  70
+// The maximum number of changed customer ASNs recorded between two EndOfData
+// PDUs. If more ASNs change, all AS paths are revalidated.
+#define ASPA_DB_MAX_CHANGED 65536
 
+// The provider ASNs one validation cache announced for a customer ASN.
 typedef struct {
-  uint32_t customerAsn; 
+  uint32_t valCacheID;
+  uint16_t providerAsCount;
+  uint32_t *providerAsns;   // sorted in ascending order, no duplicates
+} ASPA_Source;
+
+// The ASPA objects are stored by value within the slots of the open 
+// addressing table, an afi of 0 marks an empty slot. The provider ASNs of a
+// stored object are the union of the provider ASNs of all its sources.
+typedef struct {
+  uint32_t customerAsn;
   uint16_t providerAsCount;
-  uint32_t *providerAsns;
   uint16_t afi;
+  uint32_t *providerAsns;   // sorted in ascending order, no duplicates
+  uint16_t noSources;
+  ASPA_Source *sources;     // one per validation cache, NULL if not stored
 } ASPA_Object;
 
-
-typedef struct TrieNode TrieNode;
-struct TrieNode {
-    // The Trie Node Structure
-    // Each node has N children, starting from the root
-    // and a flag to check if it's a leaf node
-    char data; // Storing for printing purposes only
-    TrieNode* children[N];
-    int is_leaf;
-    void *userData;
-    ASPA_Object *aspaObjects;
-};
-
 typedef struct {
-  TrieNode*         tableRoot;
+  ASPA_Object*      table;      // open addressing table using linear probing
+  uint32_t          tableSize;  // number of slots, always a power of 2
+  uint8_t           tableBits;  // log2(tableSize)
   uint32_t          countAspaObj;
+  uint32_t*         changedAsns;      // customer ASNs changed since the last
+                                      // EndOfData (unsorted, can repeat)
+  uint32_t          noChangedAsns;
+  uint32_t          changedAsnsSize;
+  bool              changedAll;       // everything needs revalidation
+  uint32_t          validationSeq;    // incremented with each End of Data
+                                      // revalidation, only modified atomically
   Configuration*    config;  // The system configuration
   RWLock            tableLock;
-  int (*cbProcessEndOfData)(void* uCache, void* rpkiHandler, 
-                            uint32_t uid, uint32_t pid, time_t ct);
+  int (*cbProcessEndOfData)(void* uCache, void* rpkiHandler,
+                            uint32_t uid, uint32_t pid, uint32_t seq);
 } ASPA_DBManager;
 
 
-static TrieNode* newAspaTrie(void);
-static TrieNode* make_trienode(char data, char* userData, ASPA_Object* );
-static void free_trienode(TrieNode* node);
-TrieNode* insertAspaObj(ASPA_DBManager* self, char* word, char* userData, ASPA_Object* obj);
-static int search_trie(TrieNode* root, char* word);
-void print_trie(TrieNode* root);
 bool initializeAspaDBManager(ASPA_DBManager* aspaDBManager, Configuration* config);
-static void emptyAspaDB(ASPA_DBManager* self);
-ASPA_Object* findAspaObject(ASPA_DBManager* self, char* word);
-void print_search(TrieNode* root, char* word);
+void releaseAspaDBManager(ASPA_DBManager* self);
+bool insertAspaObj(ASPA_DBManager* self, ASPA_Object* obj, uint32_t valCacheID);
+bool deleteAspaObj(ASPA_DBManager* self, ASPA_Object* obj, uint32_t valCacheID);
+uint32_t removeAspaObjsOfCache(ASPA_DBManager* self, uint32_t valCacheID);
+ASPA_Object* findAspaObject(ASPA_DBManager* self, uint32_t customerAsn, uint16_t afi);
 bool deleteASPAObject(ASPA_DBManager* self, ASPA_Object *obj);
 ASPA_Object* newASPAObject(uint32_t cusAsn, uint16_t pAsCount, uint32_t* provAsns, uint16_t afi);
+bool compareAspaObject(ASPA_Object *obj1, ASPA_Object *obj2);
 ASPA_ValidationResult ASPA_DB_lookup(ASPA_DBManager* self, uint32_t customerAsn, uint32_t providerAsn, uint8_t afi);
-TrieNode* printAllLeafNode(TrieNode *node);
-bool delete_TrieNode_AspaObj (ASPA_DBManager* self, char* word, ASPA_Object* obj);
+void printAllAspaObjects(ASPA_DBManager* self);
+uint32_t takeChangedCustomerAsns(ASPA_DBManager* self, uint32_t** asns, bool* all);
+uint32_t nextAspaValidationSeq(ASPA_DBManager* self);
+uint32_t getAspaValidationSeq(ASPA_DBManager* self);
 
 
 
 
-#endif // __ASPA_TRIE_H__ 
+#endif // __ASPA_TRIE_H__
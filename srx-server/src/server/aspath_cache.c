@@ -2,6 +2,8 @@
 
 #include <uthash.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include "server/aspath_cache.h"
 #include "shared/crc32.h"
 #include "util/log.h"
@@ -17,9 +19,20 @@ typedef struct {
   AS_TYPE           asType;
   AS_REL_DIR        asRelDir;
   uint16_t          afi;
-  time_t            lastModified;
+  uint32_t          validationSeq; // ASPA validation sequence number
+  time_t            lastUsed;      // last time the path was stored or read
 } PathListCacheTable;
 
+// Reverse index entry, lists all path IDs whose AS path contains the ASN
+typedef struct {
+
+  UT_hash_handle    hh;
+  uint32_t          asn;
+  uint32_t*         pathIds;
+  uint32_t          noPathIds;
+  uint32_t          size;
+} AsnPathIndex;
+
 
 //
 // To let main call this function to generate UT hash
@@ -35,6 +48,7 @@ bool createAspathCache(AspathCache* self, ASPA_DBManager* aspaDBManager)
   // By default keep the hashtable null, it will be initialized with the first
   // element that will be added.
   self->aspathCacheTable = NULL;
+  self->asnIndexTable = NULL;
   self->aspaDBManager = aspaDBManager;
  
   return true;
@@ -54,38 +68,191 @@ void releaseAspathCache(AspathCache* self)
 
 void emptyAspathCache(AspathCache* self)
 {
+  AsnPathIndex *index, *tmp;
+
   acquireWriteLock(&self->tableLock);
   self->aspathCacheTable = NULL;
+  HASH_ITER(hh, (AsnPathIndex*)self->asnIndexTable, index, tmp)
+  {
+    HASH_DEL(*((AsnPathIndex**)&self->asnIndexTable), index);
+    free(index->pathIds);
+    free(index);
+  }
+  self->asnIndexTable = NULL;
   unlockWriteLock(&self->tableLock);
 
 }
 
+// Register the path ID with each ASN of its AS path in the reverse index.
+// The caller MUST hold the write lock.
+//
+static void _indexAspathList (AspathCache *self, PathListCacheTable *cacheTable)
+{
+  AsnPathIndex *index;
+  uint32_t     asn;
+
+  for (int i=0; i < cacheTable->data.hops; i++)
+  {
+    asn = cacheTable->data.asPathList[i];
+    HASH_FIND(hh, (AsnPathIndex*)self->asnIndexTable, &asn, sizeof(uint32_t), 
+              index);
+    if (!index)
+    {
+      index = (AsnPathIndex*)calloc(1, sizeof(AsnPathIndex));
+      if (!index)
+      {
+        RAISE_SYS_ERROR("Not enough memory for the AS path reverse index");
+        return;
+      }
+      index->asn = asn;
+      HASH_ADD(hh, *((AsnPathIndex**)&self->asnIndexTable), asn, 
+               sizeof(uint32_t), index);
+    }
+    // Paths are indexed one after the other, a prepended ASN would show the
+    // same path ID again as last element.
+    if (index->noPathIds > 0 
+        && index->pathIds[index->noPathIds-1] == cacheTable->pathId)
+    {
+      continue;
+    }
+    if (index->noPathIds == index->size)
+    {
+      uint32_t  newSize = index->size == 0 ? 4 : index->size * 2;
+      uint32_t* newIds  = realloc(index->pathIds, newSize * sizeof(uint32_t));
+      if (!newIds)
+      {
+        RAISE_SYS_ERROR("Not enough memory for the AS path reverse index");
+        return;
+      }
+      index->pathIds = newIds;
+      index->size    = newSize;
+    }
+    index->pathIds[index->noPathIds++] = cacheTable->pathId;
+  }
+}
+
 static void add_AspathList (AspathCache *self, PathListCacheTable *cacheTable)
 {
 
   acquireWriteLock(&self->tableLock);
   HASH_ADD (hh, *((PathListCacheTable**)&self->aspathCacheTable), pathId, sizeof(uint32_t), cacheTable);
+  _indexAspathList(self, cacheTable);
   unlockWriteLock(&self->tableLock);
 
 }
 
-static bool find_AspathList (AspathCache* self, uint32_t pathId, PathListCacheTable **p_cacheTable)
+// sort helper for path ids
+//
+static int _cmpPathId(const void* a, const void* b)
+{
+  uint32_t idA = *(const uint32_t*)a;
+  uint32_t idB = *(const uint32_t*)b;
+  return (idA > idB) - (idA < idB);
+}
+
+//
+// Collect the IDs of all AS paths that contain at least one of the given 
+// ASNs. The returned array is sorted, free of duplicates, and MUST be freed 
+// by the caller. Returns the number of path IDs in the array.
+//
+uint32_t getPathIdsOfAsns(AspathCache *self, uint32_t* asns, uint32_t noAsns,
+                          uint32_t** pathIds)
 {
+  AsnPathIndex *index;
+  uint32_t     count = 0;
+  uint32_t     size  = 0;
+  uint32_t*    ids   = NULL;
+
   acquireReadLock(&self->tableLock);
-  HASH_FIND(hh, (PathListCacheTable*)self->aspathCacheTable, &pathId, sizeof(uint32_t), (*p_cacheTable));
+  for (uint32_t i=0; i < noAsns; i++)
+  {
+    HASH_FIND(hh, (AsnPathIndex*)self->asnIndexTable, &asns[i], 
+              sizeof(uint32_t), index);
+    if (!index || index->noPathIds == 0)
+    {
+      continue;
+    }
+    if (count + index->noPathIds > size)
+    {
+      uint32_t  newSize = (count + index->noPathIds) * 2;
+      uint32_t* newIds  = realloc(ids, newSize * sizeof(uint32_t));
+      if (!newIds)
+      {
+        RAISE_SYS_ERROR("Not enough memory to collect the affected AS paths");
+        break;
+      }
+      ids  = newIds;
+      size = newSize;
+    }
+    memcpy(ids + count, index->pathIds, index->noPathIds * sizeof(uint32_t));
+    count += index->noPathIds;
+  }
   unlockReadLock(&self->tableLock);
 
+  if (count > 1)
+  {
+    uint32_t idx = 0;
+    qsort(ids, count, sizeof(uint32_t), _cmpPathId);
+    for (uint32_t i=1; i < count; i++)
+    {
+      if (ids[i] != ids[idx])
+      {
+        ids[++idx] = ids[i];
+      }
+    }
+    count = idx + 1;
+  }
+  *pathIds = ids;
+
+  return count;
+}
+
+// The caller MUST hold the read lock as long as the found entry is accessed,
+// the entry might be deleted otherwise.
+//
+static bool find_AspathList (AspathCache* self, uint32_t pathId, PathListCacheTable **p_cacheTable)
+{
+  HASH_FIND(hh, (PathListCacheTable*)self->aspathCacheTable, &pathId, sizeof(uint32_t), (*p_cacheTable));
+
   return (*p_cacheTable != NULL);
 }
 
 
+// Remove the path from the hash table and the reverse index. The caller MUST
+// hold the write lock.
+//
 static void del_AspathList (AspathCache* self, PathListCacheTable *cacheTable)
 {
-  acquireWriteLock(&self->tableLock);
+  AsnPathIndex *index;
+  uint32_t     asn, idx, keep;
+
   HASH_DEL (*((PathListCacheTable**)&self->aspathCacheTable), cacheTable);
-  unlockWriteLock(&self->tableLock);
-}
 
+  for (int i=0; i < cacheTable->data.hops; i++)
+  {
+    asn = cacheTable->data.asPathList[i];
+    HASH_FIND(hh, (AsnPathIndex*)self->asnIndexTable, &asn, sizeof(uint32_t), 
+              index);
+    if (!index)
+    {
+      continue;
+    }
+    for (idx = 0, keep = 0; idx < index->noPathIds; idx++)
+    {
+      if (index->pathIds[idx] != cacheTable->pathId)
+      {
+        index->pathIds[keep++] = index->pathIds[idx];
+      }
+    }
+    index->noPathIds = keep;
+    if (index->noPathIds == 0)
+    {
+      HASH_DEL(*((AsnPathIndex**)&self->asnIndexTable), index);
+      free(index->pathIds);
+      free(index);
+    }
+  }
+}
 
 AS_PATH_LIST* newAspathListEntry (uint32_t length, uint32_t* pathData, uint32_t pathId, AS_TYPE asType, 
                                   AS_REL_DIR asRelDir, uint16_t afi, bool bBigEndian)
@@ -104,7 +271,7 @@ AS_PATH_LIST* newAspathListEntry (uint32_t length, uint32_t* pathData, uint32_t
   pAspathList->asType       = asType;
   pAspathList->asRelDir     = asRelDir;
   pAspathList->afi          = bBigEndian ? ntohs(afi): afi;
-  pAspathList->lastModified = 0;
+  pAspathList->validationSeq = 0;
 
 
   for (int i=0; i < length; i++)
@@ -171,6 +338,7 @@ bool modifyAspaValidationResultToAspathCache(AspathCache *self, uint32_t pathId,
   bool retVal = true;
   PathListCacheTable *plCacheTable;
 
+  acquireReadLock(&self->tableLock);
   if (!find_AspathList (self, pathId, &plCacheTable))
   {
     RAISE_SYS_ERROR("Does not exist in aspath list cache, can not modify it!");
@@ -180,18 +348,19 @@ bool modifyAspaValidationResultToAspathCache(AspathCache *self, uint32_t pathId,
   {
     if(modAspaResult != SRx_RESULT_DONOTUSE)
     {
-      // access time updated
-      plCacheTable->lastModified = pathlistEntry->lastModified;
-      LOG(LEVEL_INFO, "AspathCache entry for path ID: 0x%08X - last modfied time update: %u", pathId, plCacheTable->lastModified);
+      // validation sequence updated
+      plCacheTable->validationSeq = pathlistEntry->validationSeq;
+      LOG(LEVEL_INFO, "AspathCache entry for path ID: 0x%08X - validation sequence update: %u", pathId, plCacheTable->validationSeq);
 
       if(modAspaResult != plCacheTable->aspaResult)
       {
         plCacheTable->aspaResult   = modAspaResult;
-        LOG(LEVEL_INFO, FILE_LINE_INFO " AS path cache data modified [pathID]:0x%08X [Value]: %d [Time]: %u", 
-            pathId, modAspaResult, plCacheTable->lastModified);
+        LOG(LEVEL_INFO, FILE_LINE_INFO " AS path cache data modified [pathID]:0x%08X [Value]: %d [Seq]: %u", 
+            pathId, modAspaResult, plCacheTable->validationSeq);
       }
     }
   }
+  unlockReadLock(&self->tableLock);
   return retVal;
 }
 
@@ -202,11 +371,18 @@ int storeAspathList (AspathCache* self, SRxDefaultResult* srxRes,
 
   PathListCacheTable *plCacheTable;
   
+  acquireReadLock(&self->tableLock);
   if (find_AspathList (self, pathId, &plCacheTable))
   {
-    LOG(LEVEL_WARNING, "Attempt to store an update that already exists in as path cache!");
+    plCacheTable->lastUsed = time(NULL);
     retVal = 0;
   }
+  unlockReadLock(&self->tableLock);
+
+  if (retVal == 0)
+  {
+    LOG(LEVEL_WARNING, "Attempt to store an update that already exists in as path cache!");
+  }
   else
   {
     plCacheTable = (PathListCacheTable*) calloc(1, sizeof(PathListCacheTable));
@@ -214,7 +390,8 @@ int storeAspathList (AspathCache* self, SRxDefaultResult* srxRes,
     plCacheTable->asType       = asType;
     plCacheTable->asRelDir     = pathlistEntry->asRelDir;
     plCacheTable->afi          = pathlistEntry->afi;
-    plCacheTable->lastModified = pathlistEntry->lastModified;
+    plCacheTable->validationSeq = pathlistEntry->validationSeq;
+    plCacheTable->lastUsed     = time(NULL);
 
     uint8_t length = pathlistEntry->asPathLength;
     plCacheTable->data.hops = length;
@@ -244,11 +421,38 @@ int storeAspathList (AspathCache* self, SRxDefaultResult* srxRes,
 }
 
 
-// TODO: delete function for calling del_AspathList to remove the cache data
 //
-bool deleteAspathCache()
+// Delete the AS path with the given path ID from the cache and release its
+// memory. The path is kept if it was stored or read at or after usedBefore,
+// this keeps paths that are about to be referenced by a new update.
+// Returns true if the path was deleted.
+//
+bool deleteAspathListFromAspathCache (AspathCache* self, uint32_t pathId,
+                                      time_t usedBefore)
 {
-  return false;
+  PathListCacheTable *plCacheTable;
+  bool               deleted = false;
+
+  acquireWriteLock(&self->tableLock);
+  HASH_FIND(hh, (PathListCacheTable*)self->aspathCacheTable, &pathId, 
+            sizeof(uint32_t), plCacheTable);
+  if (plCacheTable && (plCacheTable->lastUsed < usedBefore))
+  {
+    del_AspathList(self, plCacheTable);
+    deleted = true;
+  }
+  unlockWriteLock(&self->tableLock);
+
+  if (deleted)
+  {
+    if (plCacheTable->data.asPathList)
+    {
+      free(plCacheTable->data.asPathList);
+    }
+    free(plCacheTable);
+  }
+
+  return deleted;
 }
 
 
@@ -266,8 +470,10 @@ AS_PATH_LIST* getAspathListFromAspathCache (AspathCache* self, uint32_t pathId,
   AS_PATH_LIST *aspl = NULL;
   PathListCacheTable *plCacheTable;
   
+  acquireReadLock(&self->tableLock);
   if (find_AspathList (self, pathId, &plCacheTable))
   {
+    plCacheTable->lastUsed = time(NULL);
     aspl = (AS_PATH_LIST*)calloc(1, sizeof(AS_PATH_LIST));
     aspl->pathID        = plCacheTable->pathId;
     aspl->asPathLength  = plCacheTable->data.hops;
@@ -275,7 +481,7 @@ AS_PATH_LIST* getAspathListFromAspathCache (AspathCache* self, uint32_t pathId,
     aspl->asType        = plCacheTable->asType;
     aspl->asRelDir      = plCacheTable->asRelDir;
     aspl->afi           = plCacheTable->afi;
-    aspl->lastModified  = plCacheTable->lastModified;
+    aspl->validationSeq = plCacheTable->validationSeq;
 
     uint8_t length     = plCacheTable->data.hops;
     aspl->asPathList   = (uint32_t*)calloc(length, sizeof(uint32_t));
@@ -294,6 +500,7 @@ AS_PATH_LIST* getAspathListFromAspathCache (AspathCache* self, uint32_t pathId,
   {
     srxRes->aspaResult = SRx_RESULT_UNDEFINED;
   }
+  unlockReadLock(&self->tableLock);
 
   return aspl;
 }
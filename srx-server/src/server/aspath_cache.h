@@ -33,6 +33,7 @@
 #define __ASPATH_CACHE_H__ 
 
 #include <stdio.h>
+#include <time.h>
 #include "server/configuration.h"
 #include "shared/srx_defs.h"
 #include "shared/srx_packets.h"
@@ -54,7 +55,8 @@ typedef struct {
   AS_TYPE       asType;
   AS_REL_DIR    asRelDir;
   uint16_t      afi;
-  time_t        lastModified;
+  uint32_t      validationSeq; // ASPA validation sequence number of the last
+                               // validation (see getAspaValidationSeq)
 } AS_PATH_LIST;
 
 
@@ -74,6 +76,7 @@ typedef struct {
 
   UpdateCache       *linkUpdateCache;
   void              *aspathCacheTable;
+  void              *asnIndexTable;   // ASN -> path IDs containing the ASN
   RWLock            tableLock;
   ASPA_DBManager    *aspaDBManager;
 } AspathCache;
@@ -92,7 +95,11 @@ bool modifyAspaValidationResultToAspathCache(AspathCache *self, uint32_t pathId,
                       uint8_t modAspaResult, AS_PATH_LIST* pathlistEntry);
 
 bool deleteAspathListEntry (AS_PATH_LIST* aspl);
+bool deleteAspathListFromAspathCache (AspathCache* self, uint32_t pathId,
+                                      time_t usedBefore);
 void printAllAsPathCache(AspathCache *self);
+uint32_t getPathIdsOfAsns(AspathCache *self, uint32_t* asns, uint32_t noAsns,
+                          uint32_t** pathIds);
 
 
 
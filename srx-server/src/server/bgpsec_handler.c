@@ -40,23 +40,649 @@
  *            * Code created.
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
 #include "server/bgpsec_handler.h"
 #include "server/main.h"
+#include "server/ski_cache.h"
 #include "util/log.h"
+#include "util/mutex.h"
+
+/** A single cached validation result. The key references and the attribute 
+ * bytes are stored in the same memory block right behind the structure. */
+typedef struct _bh_vc_entry {
+  /** The next entry within the same hash bucket. */
+  struct _bh_vc_entry* hNext;
+  /** The more recently used entry. */
+  struct _bh_vc_entry* prev;
+  /** The less recently used entry. */
+  struct _bh_vc_entry* next;
+  /** The hash of myAS, nlri, and the BGPsec_PATH attribute. */
+  u_int64_t  hash;
+  /** The own AS number in network format. */
+  u_int32_t  myAS;
+  /** The announced prefix. */
+  SCA_Prefix nlri;
+  /** The validation result SRx_RESULT_VALID or SRx_RESULT_INVALID */
+  u_int8_t   result;
+  /** Number of keys (signature segments) the result depends on. */
+  u_int16_t  noKeys;
+  /** The key generation bucket of each key. */
+  u_int32_t* keyBucket;
+  /** The generation of each key bucket at the time of the validation. */
+  u_int32_t* keyGen;
+  /** The length of the BGPsec_PATH attribute in bytes. */
+  u_int32_t  attrLength;
+  /** The BGPsec_PATH attribute. */
+  u_int8_t*  attr;
+} _BH_VC_ENTRY;
+
+/** The verification cache. Results are found using a chained hash table and
+ * evicted in least recently used order. Key changes reported by the SKI cache 
+ * increment the generation counter of the key's bucket, this renders all 
+ * results depending on that key stale without having to search for them. */
+typedef struct {
+  /** Protects all members. */
+  Mutex          mutex;
+  /** The hash table. */
+  _BH_VC_ENTRY** table;
+  /** The size of the table - 1, the size is a power of 2. */
+  u_int32_t      tableMask;
+  /** The most recently used entry. */
+  _BH_VC_ENTRY*  head;
+  /** The least recently used entry. */
+  _BH_VC_ENTRY*  tail;
+  /** The generation counter per key bucket. */
+  u_int32_t      keyGen[BH_VC_KEY_BUCKETS];
+  /** The statistics. */
+  BH_VerifyCacheInfo info;
+} _BH_VERIFY_CACHE;
+
+/** The lookup key of a single validation request. */
+typedef struct {
+  /** The hash of myAS, nlri, and the BGPsec_PATH attribute. */
+  u_int64_t   hash;
+  /** The own AS number in network format. */
+  u_int32_t   myAS;
+  /** The announced prefix. */
+  SCA_Prefix* nlri;
+  /** The BGPsec_PATH attribute. */
+  u_int8_t*   attr;
+  /** The length of the BGPsec_PATH attribute in bytes. */
+  u_int32_t   attrLength;
+  /** Indicates if the validation result can be stored. */
+  bool        cacheable;
+  /** Number of keys found in the attribute. */
+  u_int16_t   noKeys;
+  /** The key generation bucket of each key. */
+  u_int32_t   keyBucket[BH_VC_MAX_KEYS];
+  /** The generation of each key bucket at the time of the lookup. */
+  u_int32_t   keyGen[BH_VC_MAX_KEYS];
+} _BH_VC_KEY;
+
+/**
+ * The 64 bit finalizer of MurmurHash3.
+ *
+ * @param value The value to be mixed.
+ *
+ * @return The mixed value.
+ *
+ * @since 0.6.0
+ */
+static u_int64_t _vcMix(u_int64_t value)
+{
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+/**
+ * Hash the given byte stream, eight bytes at a time.
+ *
+ * @param data The data to be hashed.
+ * @param length The length of the data in bytes.
+ * @param seed The start value.
+ *
+ * @return The hash value.
+ *
+ * @since 0.6.0
+ */
+static u_int64_t _vcHash(u_int8_t* data, u_int32_t length, u_int64_t seed)
+{
+  u_int64_t hash = seed ^ (length * 0x9e3779b97f4a7c15ULL);
+  u_int64_t word;
+
+  while (length >= sizeof(u_int64_t))
+  {
+    memcpy(&word, data, sizeof(u_int64_t));
+    hash = (hash ^ _vcMix(word)) * 0x9e3779b97f4a7c15ULL;
+    data   += sizeof(u_int64_t);
+    length -= sizeof(u_int64_t);
+  }
+  word = 0;
+  memcpy(&word, data, length);
+  hash ^= _vcMix(word ^ length);
+
+  return _vcMix(hash);
+}
+
+/**
+ * Return the key generation bucket of the given key.
+ *
+ * @param asn The ASN of the key in host format.
+ * @param ski The 20 byte SKI of the key.
+ * @param algoID The algorithm ID of the key.
+ *
+ * @return The bucket within the key generation array.
+ *
+ * @since 0.6.0
+ */
+static u_int32_t _vcKeyBucket(u_int32_t asn, u_int8_t* ski, u_int8_t algoID)
+{
+  return _vcHash(ski, SKI_LENGTH, ((u_int64_t)algoID << 32) | asn)
+         & (BH_VC_KEY_BUCKETS - 1);
+}
+
+/**
+ * Determine the length of the complete BGPsec_PATH attribute including the 
+ * attribute header.
+ *
+ * @param attr The BGPsec_PATH attribute.
+ *
+ * @return The length in bytes.
+ *
+ * @since 0.6.0
+ */
+static u_int32_t _vcAttrLength(SCA_BGP_PathAttribute* attr)
+{
+  if ((attr->flags & SCA_BGP_UPD_A_FLAGS_EXT_LENGTH) != 0)
+  {
+    return sizeof(SCA_BGPSEC_ExtPathAttribute)
+           + ntohs(((SCA_BGPSEC_ExtPathAttribute*)attr)->attrLength);
+  }
+  return sizeof(SCA_BGPSEC_NormPathAttribute)
+         + ((SCA_BGPSEC_NormPathAttribute*)attr)->attrLength;
+}
+
+/**
+ * Walk through all signature blocks of the BGPsec_PATH attribute and store the
+ * key generation bucket of each signature segment in the given key.
+ *
+ * @param key The lookup key containing the attribute.
+ *
+ * @return false if the attribute is malformed or contains more than 
+ *         BH_VC_MAX_KEYS signature segments.
+ *
+ * @since 0.6.0
+ */
+static bool _vcGetKeys(_BH_VC_KEY* key)
+{
+  SCA_BGP_PathAttribute*        pathAttr = (SCA_BGP_PathAttribute*)key->attr;
+  SCA_BGPSEC_SecurePathSegment* pathSeg  = NULL;
+  SCA_BGPSEC_SignatureBlock*    sigBlock = NULL;
+  SCA_BGPSEC_SignatureSegment*  sigSeg   = NULL;
+  u_int8_t* end      = key->attr + key->attrLength;
+  u_int8_t* blockEnd = NULL;
+  u_int8_t* stream   = key->attr;
+  u_int16_t length   = 0;
+  int noSegments     = 0;
+  int idx;
+
+  key->noKeys = 0;
+  stream += ((pathAttr->flags & SCA_BGP_UPD_A_FLAGS_EXT_LENGTH) != 0)
+            ? sizeof(SCA_BGPSEC_ExtPathAttribute)
+            : sizeof(SCA_BGPSEC_NormPathAttribute);
+
+  // The Secure_Path
+  if ((stream + sizeof(SCA_BGPSEC_SecurePath)) > end)
+  {
+    return false;
+  }
+  length = ntohs(((SCA_BGPSEC_SecurePath*)stream)->length);
+  if (   (length < sizeof(SCA_BGPSEC_SecurePath)) || ((stream + length) > end)
+      || (((length - sizeof(SCA_BGPSEC_SecurePath)) 
+           % sizeof(SCA_BGPSEC_SecurePathSegment)) != 0))
+  {
+    return false;
+  }
+  noSegments = (length - sizeof(SCA_BGPSEC_SecurePath)) 
+               / sizeof(SCA_BGPSEC_SecurePathSegment);
+  pathSeg = (SCA_BGPSEC_SecurePathSegment*)(stream 
+                                             + sizeof(SCA_BGPSEC_SecurePath));
+  stream += length;
+
+  // The Signature_Blocks
+  while (stream < end)
+  {
+    if ((stream + sizeof(SCA_BGPSEC_SignatureBlock)) > end)
+    {
+      return false;
+    }
+    sigBlock = (SCA_BGPSEC_SignatureBlock*)stream;
+    length   = ntohs(sigBlock->length);
+    blockEnd = stream + length;
+    if ((length < sizeof(SCA_BGPSEC_SignatureBlock)) || (blockEnd > end))
+    {
+      return false;
+    }
+    stream += sizeof(SCA_BGPSEC_SignatureBlock);
+    for (idx = 0; idx < noSegments; idx++)
+    {
+      if (   ((stream + sizeof(SCA_BGPSEC_SignatureSegment)) > blockEnd)
+          || (key->noKeys == BH_VC_MAX_KEYS))
+      {
+        return false;
+      }
+      sigSeg = (SCA_BGPSEC_SignatureSegment*)stream;
+      key->keyBucket[key->noKeys++] = _vcKeyBucket(ntohl(pathSeg[idx].asn), 
+                                                   sigSeg->ski, 
+                                                   sigBlock->algoID);
+      stream += sizeof(SCA_BGPSEC_SignatureSegment) + ntohs(sigSeg->siglen);
+    }
+    if (stream != blockEnd)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Find the entry matching the given key. The cache MUST be locked.
+ *
+ * @param vc The verification cache.
+ * @param key The lookup key.
+ *
+ * @return The entry or NULL.
+ *
+ * @since 0.6.0
+ */
+static _BH_VC_ENTRY* _vcFind(_BH_VERIFY_CACHE* vc, _BH_VC_KEY* key)
+{
+  _BH_VC_ENTRY* entry = vc->table[key->hash & vc->tableMask];
+
+  while (entry != NULL)
+  {
+    if (   (entry->hash == key->hash) && (entry->myAS == key->myAS)
+        && (entry->attrLength == key->attrLength)
+        && (memcmp(&entry->nlri, key->nlri, sizeof(SCA_Prefix)) == 0)
+        && (memcmp(entry->attr, key->attr, key->attrLength) == 0))
+    {
+      break;
+    }
+    entry = entry->hNext;
+  }
+
+  return entry;
+}
+
+/**
+ * Unlink the entry from the LRU list. The cache MUST be locked.
+ *
+ * @param vc The verification cache.
+ * @param entry The entry to be unlinked.
+ *
+ * @since 0.6.0
+ */
+static void _vcUnlink(_BH_VERIFY_CACHE* vc, _BH_VC_ENTRY* entry)
+{
+  if (entry->prev != NULL)
+  {
+    entry->prev->next = entry->next;
+  }
+  else
+  {
+    vc->head = entry->next;
+  }
+  if (entry->next != NULL)
+  {
+    entry->next->prev = entry->prev;
+  }
+  else
+  {
+    vc->tail = entry->prev;
+  }
+  entry->prev = NULL;
+  entry->next = NULL;
+}
+
+/**
+ * Add the entry as most recently used entry. The cache MUST be locked.
+ *
+ * @param vc The verification cache.
+ * @param entry The entry to be added.
+ *
+ * @since 0.6.0
+ */
+static void _vcPushFront(_BH_VERIFY_CACHE* vc, _BH_VC_ENTRY* entry)
+{
+  entry->prev = NULL;
+  entry->next = vc->head;
+  if (vc->head != NULL)
+  {
+    vc->head->prev = entry;
+  }
+  else
+  {
+    vc->tail = entry;
+  }
+  vc->head = entry;
+}
+
+/**
+ * Remove the entry from the cache and free its memory. The cache MUST be 
+ * locked.
+ *
+ * @param vc The verification cache.
+ * @param entry The entry to be removed.
+ *
+ * @since 0.6.0
+ */
+static void _vcRemove(_BH_VERIFY_CACHE* vc, _BH_VC_ENTRY* entry)
+{
+  _BH_VC_ENTRY** link = &vc->table[entry->hash & vc->tableMask];
+
+  while (*link != entry)
+  {
+    link = &(*link)->hNext;
+  }
+  *link = entry->hNext;
+  _vcUnlink(vc, entry);
+  vc->info.entries--;
+  free(entry);
+}
+
+/**
+ * Remove all entries from the cache. The cache MUST be locked.
+ *
+ * @param vc The verification cache.
+ *
+ * @return The number of removed entries.
+ *
+ * @since 0.6.0
+ */
+static u_int32_t _vcFlush(_BH_VERIFY_CACHE* vc)
+{
+  u_int32_t removed = vc->info.entries;
+  _BH_VC_ENTRY* entry = vc->head;
+  _BH_VC_ENTRY* next  = NULL;
+
+  while (entry != NULL)
+  {
+    next = entry->next;
+    free(entry);
+    entry = next;
+  }
+  memset(vc->table, 0, (vc->tableMask + 1) * sizeof(_BH_VC_ENTRY*));
+  vc->head = NULL;
+  vc->tail = NULL;
+  vc->info.entries = 0;
+
+  return removed;
+}
+
+/**
+ * Look up the validation result of the given update. In case the result is not
+ * cached (or stale), the key is prepared to store the result of the following 
+ * validation using _vcStore.
+ *
+ * @param vc The verification cache (can be NULL).
+ * @param update The update to be validated.
+ * @param key OUT - The lookup key.
+ * @param result OUT - The cached result in case of a hit.
+ *
+ * @return true if the result was found in the cache.
+ *
+ * @since 0.6.0
+ */
+static bool _vcLookup(_BH_VERIFY_CACHE* vc, UC_UpdateData* update, 
+                      _BH_VC_KEY* key, u_int8_t* result)
+{
+  _BH_VC_ENTRY* entry = NULL;
+  bool found = false;
+  int  idx;
+
+  key->cacheable = false;
+  key->noKeys    = 0;
+  if ((vc == NULL) || (update->bgpsec_path == NULL))
+  {
+    return false;
+  }
+
+  key->attr       = (u_int8_t*)update->bgpsec_path;
+  key->attrLength = _vcAttrLength(update->bgpsec_path);
+  key->myAS       = update->myAS;
+  key->nlri       = &update->nlri;
+  key->hash       = _vcHash(key->attr, key->attrLength, 
+                            _vcHash((u_int8_t*)key->nlri, sizeof(SCA_Prefix), 
+                                    key->myAS));
+
+  lockMutex(&vc->mutex);
+  entry = _vcFind(vc, key);
+  if (entry != NULL)
+  {
+    found = true;
+    for (idx = 0; found && (idx < entry->noKeys); idx++)
+    {
+      found = vc->keyGen[entry->keyBucket[idx]] == entry->keyGen[idx];
+    }
+    if (found)
+    {
+      *result = entry->result;
+      _vcUnlink(vc, entry);
+      _vcPushFront(vc, entry);
+      vc->info.hits++;
+    }
+    else
+    {
+      // At least one of the keys changed since the validation.
+      _vcRemove(vc, entry);
+      vc->info.invalidated++;
+    }
+  }
+  if (!found)
+  {
+    vc->info.misses++;
+    key->cacheable = _vcGetKeys(key);
+    for (idx = 0; idx < key->noKeys; idx++)
+    {
+      key->keyGen[idx] = vc->keyGen[key->keyBucket[idx]];
+    }
+  }
+  unlockMutex(&vc->mutex);
+
+  return found;
+}
+
+/**
+ * Store the validation result for the given lookup key. In case the cache is 
+ * full the least recently used result is removed.
+ *
+ * @param vc The verification cache (can be NULL).
+ * @param key The lookup key prepared by _vcLookup.
+ * @param result The validation result.
+ *
+ * @since 0.6.0
+ */
+static void _vcStore(_BH_VERIFY_CACHE* vc, _BH_VC_KEY* key, u_int8_t result)
+{
+  _BH_VC_ENTRY*  entry = NULL;
+  _BH_VC_ENTRY** link  = NULL;
+  size_t keySize = key->noKeys * sizeof(u_int32_t);
+
+  if ((vc == NULL) || !key->cacheable)
+  {
+    return;
+  }
+
+  entry = malloc(sizeof(_BH_VC_ENTRY) + (2 * keySize) + key->attrLength);
+  if (entry == NULL)
+  {
+    return;
+  }
+  memset(entry, 0, sizeof(_BH_VC_ENTRY));
+  entry->hash       = key->hash;
+  entry->myAS       = key->myAS;
+  entry->result     = result;
+  entry->noKeys     = key->noKeys;
+  entry->attrLength = key->attrLength;
+  entry->keyBucket  = (u_int32_t*)(entry + 1);
+  entry->keyGen     = entry->keyBucket + key->noKeys;
+  entry->attr       = (u_int8_t*)(entry->keyGen + key->noKeys);
+  memcpy(&entry->nlri, key->nlri, sizeof(SCA_Prefix));
+  memcpy(entry->keyBucket, key->keyBucket, keySize);
+  memcpy(entry->keyGen, key->keyGen, keySize);
+  memcpy(entry->attr, key->attr, key->attrLength);
+
+  lockMutex(&vc->mutex);
+  // Another thread might have stored the same attribute meanwhile.
+  _BH_VC_ENTRY* old = _vcFind(vc, key);
+  if (old != NULL)
+  {
+    _vcRemove(vc, old);
+  }
+  else if (vc->info.entries >= vc->info.maxEntries)
+  {
+    _vcRemove(vc, vc->tail);
+    vc->info.evicted++;
+  }
+  link = &vc->table[entry->hash & vc->tableMask];
+  entry->hNext = *link;
+  *link = entry;
+  _vcPushFront(vc, entry);
+  vc->info.entries++;
+  unlockMutex(&vc->mutex);
+}
+
+/**
+ * The SKI cache listener. Each key change increments the generation of the 
+ * key's bucket which invalidates all results that depend on this key.
+ *
+ * @param user The verification cache.
+ * @param asn The ASN of the key in host format.
+ * @param ski The SKI of the key or NULL if all keys were removed.
+ * @param algoID The algorithm ID of the key.
+ * @param status The type of change.
+ *
+ * @since 0.6.0
+ */
+static void _vcKeyChanged(void* user, u_int32_t asn, u_int8_t* ski, 
+                          u_int8_t algoID, e_SKI_status status)
+{
+  _BH_VERIFY_CACHE* vc = (_BH_VERIFY_CACHE*)user;
+
+  lockMutex(&vc->mutex);
+  vc->info.keyChanges++;
+  if (ski != NULL)
+  {
+    // New keys can turn an invalid result into a valid one, removed keys 
+    // the other way around - both invalidate the results.
+    vc->keyGen[_vcKeyBucket(asn, ski, algoID)]++;
+  }
+  else
+  {
+    vc->info.invalidated += _vcFlush(vc);
+  }
+  unlockMutex(&vc->mutex);
+}
+
+/**
+ * Free the verification cache.
+ *
+ * @param vc The verification cache.
+ *
+ * @since 0.6.0
+ */
+static void _vcRelease(_BH_VERIFY_CACHE* vc)
+{
+  if (vc->table != NULL)
+  {
+    _vcFlush(vc);
+    free(vc->table);
+  }
+  releaseMutex(&vc->mutex);
+  free(vc);
+}
+
+/**
+ * Create the verification cache and register it with the SKI cache. Without
+ * the SKI cache results could not be invalidated, in this case no cache will
+ * be created.
+ *
+ * @return The verification cache or NULL.
+ *
+ * @since 0.6.0
+ */
+static _BH_VERIFY_CACHE* _vcCreate()
+{
+  _BH_VERIFY_CACHE* vc = calloc(1, sizeof(_BH_VERIFY_CACHE));
+  u_int32_t tableSize = 1;
+
+  if (vc == NULL)
+  {
+    return NULL;
+  }
+  while (tableSize < BH_VC_MAX_ENTRIES)
+  {
+    tableSize <<= 1;
+  }
+  initMutex(&vc->mutex);
+  vc->tableMask       = tableSize - 1;
+  vc->info.maxEntries = BH_VC_MAX_ENTRIES;
+  vc->table           = calloc(tableSize, sizeof(_BH_VC_ENTRY*));
+  if (   (vc->table == NULL) 
+      || !ski_setKeyListener(getSKICache(), _vcKeyChanged, vc))
+  {
+    LOG(LEVEL_WARNING, "BGPsec verification cache is disabled!");
+    _vcRelease(vc);
+    vc = NULL;
+  }
+
+  return vc;
+}
 
 bool createBGPSecHandler(BGPSecHandler* self, KeyCache* keyCache)
 {
-  LOG(LEVEL_DEBUG, FILE_LINE_INFO
-                 " createBGPSecHandler is not implemented yet - returns true!");
-  self->keyCache = keyCache;
-  self->srxCAPI = getSrxCAPI();
+  self->keyCache    = keyCache;
+  self->srxCAPI     = getSrxCAPI();
+  self->verifyCache = _vcCreate();
   return true;
 }
 
 void releaseBGPSecHandler(BGPSecHandler* self)
 {
-  LOG(LEVEL_DEBUG,
-      FILE_LINE_INFO "releaseBGPSecHandler is not implemented yet!");
+  if (self->verifyCache != NULL)
+  {
+    ski_setKeyListener(getSKICache(), NULL, NULL);
+    _vcRelease((_BH_VERIFY_CACHE*)self->verifyCache);
+    self->verifyCache = NULL;
+  }
+}
+
+/**
+ * Retrieve the statistics of the verification result cache.
+ *
+ * @param self The BGPsec Handler itself
+ * @param info OUT - Receives the statistics.
+ *
+ * @since 0.6.0
+ */
+void getVerifyCacheInfo(BGPSecHandler* self, BH_VerifyCacheInfo* info)
+{
+  _BH_VERIFY_CACHE* vc = (_BH_VERIFY_CACHE*)self->verifyCache;
+
+  memset(info, 0, sizeof(BH_VerifyCacheInfo));
+  if (vc != NULL)
+  {
+    lockMutex(&vc->mutex);
+    memcpy(info, &vc->info, sizeof(BH_VerifyCacheInfo));
+    unlockMutex(&vc->mutex);
+  }
 }
 
 bool loadPrivateKey(BGPSecHandler* self, const char* filename)
@@ -67,7 +693,39 @@ bool loadPrivateKey(BGPSecHandler* self, const char* filename)
 }
 
 /**
- * Validates the given bgpsec update data.
+ * Free the hash messages the crypto API generated during validation.
+ *
+ * @param self The BGPsec Handler itself
+ * @param valdata The validation data.
+ *
+ * @since 0.6.0
+ */
+static void _freeHashMessages(BGPSecHandler* self, 
+                              SCA_BGPSecValidationData* valdata)
+{
+  // Free possible generated hash data
+  if (valdata->hashMessage[0] != NULL)
+  {
+    if (!self->srxCAPI->freeHashMessage(valdata->hashMessage[0]))
+    {
+      free(valdata->hashMessage[0]);
+    }
+    valdata->hashMessage[0] = NULL;
+  }
+  if (valdata->hashMessage[1] != NULL)
+  {
+    if (!self->srxCAPI->freeHashMessage(valdata->hashMessage[1]))
+    {
+      free(valdata->hashMessage[1]);
+    }
+    valdata->hashMessage[1] = NULL;
+  }
+}
+
+/**
+ * Validates the given bgpsec update data. Results of previous validations of
+ * the same BGPsec_PATH attribute, NLRI, and local AS are taken from the 
+ * verification cache as long as none of the involved keys changed.
  *
  * The return value is SRx_RES_VALID or SRx_RES_INVALID
  *
@@ -79,6 +737,14 @@ bool loadPrivateKey(BGPSecHandler* self, const char* filename)
 uint8_t validateSignature(BGPSecHandler* self, UC_UpdateData* update)
 {
   u_int8_t retVal = SRx_RESULT_DONOTUSE;
+  _BH_VC_KEY vcKey;
+  int valResult;
+
+  // Identical attributes are often received from several peers.
+  if (_vcLookup((_BH_VERIFY_CACHE*)self->verifyCache, update, &vcKey, &retVal))
+  {
+    return retVal;
+  }
   
   /* making Validation pdu */
   SCA_BGPSecValidationData valdata;
@@ -89,29 +755,109 @@ uint8_t validateSignature(BGPSecHandler* self, UC_UpdateData* update)
   valdata.nlri             = &update->nlri;
 
   /* call API's validate call */
-  retVal = (self->srxCAPI->validate(&valdata) == API_VALRESULT_VALID)
+  valResult = self->srxCAPI->validate(&valdata);
+  retVal = (valResult == API_VALRESULT_VALID)
             ? SRx_RESULT_VALID
             : SRx_RESULT_INVALID;
+  if (   (valResult != API_VALRESULT_FAILURE)
+      && ((valdata.status & API_STATUS_ERROR_MASK) == 0))
+  {
+    _vcStore((_BH_VERIFY_CACHE*)self->verifyCache, &vcKey, retVal);
+  }
 
-  // Free possible generated hash data
-  if (valdata.hashMessage[0] != NULL)
+  _freeHashMessages(self, &valdata);
+
+  return retVal;
+}
+
+/**
+ * Validates the given bgpsec update data using one batch call into the 
+ * SRxCryptoAPI. This allows the crypto implementation to share key lookups
+ * between the updates and to verify all signatures in bulk. Updates found in
+ * the verification cache are not handed to the SRxCryptoAPI.
+ *
+ * @param self The BGPsec Handler itself
+ * @param count The number of updates
+ * @param updates The updates to be validated
+ * @param results OUT - Receives SRx_RESULT_VALID or SRx_RESULT_INVALID for
+ *                each update.
+ * 
+ * @since 0.6.0
+ */
+void validateSignatures(BGPSecHandler* self, int count, 
+                        UC_UpdateData** updates, uint8_t* results)
+{
+  _BH_VERIFY_CACHE* vc = (_BH_VERIFY_CACHE*)self->verifyCache;
+  SCA_BGPSecValidationData*  valdata = NULL;
+  SCA_BGPSecValidationData** valPtr  = NULL;
+  _BH_VC_KEY* vcKeys  = NULL;
+  int* valResults = NULL;
+  int* valIdx     = NULL;
+  int  noVal = 0;
+  int  idx;
+
+  if (count <= 0)
+  {
+    return;
+  }
+
+  valdata    = calloc(count, sizeof(SCA_BGPSecValidationData));
+  valPtr     = malloc(count * sizeof(SCA_BGPSecValidationData*));
+  valResults = malloc(count * sizeof(int));
+  valIdx     = malloc(count * sizeof(int));
+  vcKeys     = malloc(count * sizeof(_BH_VC_KEY));
+
+  if (   (valdata == NULL) || (valPtr == NULL) || (valResults == NULL)
+      || (valIdx == NULL) || (vcKeys == NULL)
+      || (self->srxCAPI->validateBatch == NULL))
   {
-    if (!self->srxCAPI->freeHashMessage(valdata.hashMessage[0]))
+    // Fall back to one by one validation.
+    for (idx = 0; idx < count; idx++)
     {
-      free(valdata.hashMessage[0]);
+      results[idx] = validateSignature(self, updates[idx]);
     }
-    valdata.hashMessage[0] = NULL;
   }
-  if (valdata.hashMessage[1] != NULL)
+  else
   {
-    if (!self->srxCAPI->freeHashMessage(valdata.hashMessage[1]))
+    // Only hand the updates to the API that are not answered by the cache.
+    for (idx = 0; idx < count; idx++)
+    {
+      if (!_vcLookup(vc, updates[idx], &vcKeys[idx], &results[idx]))
+      {
+        valdata[noVal].myAS             = updates[idx]->myAS;
+        valdata[noVal].status           = API_STATUS_OK;
+        valdata[noVal].bgpsec_path_attr = (u_int8_t*)updates[idx]->bgpsec_path;
+        valdata[noVal].nlri             = &updates[idx]->nlri;
+        valPtr[noVal] = &valdata[noVal];
+        valIdx[noVal] = idx;
+        noVal++;
+      }
+    }
+
+    if (noVal > 0)
     {
-      free(valdata.hashMessage[1]);
+      self->srxCAPI->validateBatch(noVal, valPtr, valResults);
+    }
+
+    for (idx = 0; idx < noVal; idx++)
+    {
+      results[valIdx[idx]] = (valResults[idx] == API_VALRESULT_VALID)
+                             ? SRx_RESULT_VALID
+                             : SRx_RESULT_INVALID;
+      if (   (valResults[idx] != API_VALRESULT_FAILURE)
+          && ((valdata[idx].status & API_STATUS_ERROR_MASK) == 0))
+      {
+        _vcStore(vc, &vcKeys[valIdx[idx]], results[valIdx[idx]]);
+      }
+      _freeHashMessages(self, &valdata[idx]);
     }
-    valdata.hashMessage[1] = NULL;
   }
 
-  return retVal;
+  free(vcKeys);
+  free(valIdx);
+  free(valResults);
+  free(valPtr);
+  free(valdata);
 }
 
 bool createSignature(BGPSecHandler* self)
@@ -43,12 +43,44 @@
 #include "server/update_cache.h"
 #include "shared/srx_defs.h"
 
+/** The maximum number of validation results kept in the verification cache.*/
+#define BH_VC_MAX_ENTRIES 8192
+/** Number of key generation buckets used to invalidate cached results, MUST
+ * be a power of 2. */
+#define BH_VC_KEY_BUCKETS 4096
+/** Results of BGPsec_PATH attributes with more signature segments than this
+ * are not cached. */
+#define BH_VC_MAX_KEYS    64
+
+/** The verification cache type (see bgpsec_handler.c) */
+typedef void BH_VERIFY_CACHE;
+
+/** Statistics of the verification cache. */
+typedef struct {
+  /** Number of results currently stored. */
+  u_int32_t entries;
+  /** Maximum number of results stored. */
+  u_int32_t maxEntries;
+  /** Number of validations answered from the cache. */
+  u_int64_t hits;
+  /** Number of validations that required the SRxCryptoAPI. */
+  u_int64_t misses;
+  /** Number of results dropped because one of their keys changed. */
+  u_int64_t invalidated;
+  /** Number of results dropped to make room for new ones. */
+  u_int64_t evicted;
+  /** Number of key changes reported by the SKI cache. */
+  u_int64_t keyChanges;
+} BH_VerifyCacheInfo;
+
 /**
  * A single BGPSec Handler.
  */
 typedef struct {
   KeyCache* keyCache;
   SRxCryptoAPI* srxCAPI;
+  /** Bounded LRU cache of BGPsec path validation results. */
+  BH_VERIFY_CACHE* verifyCache;
 } BGPSecHandler;
 
 /**
@@ -91,6 +123,31 @@ bool loadPrivateKey(BGPSecHandler* self, const char* filename);
  */
 uint8_t validateSignature(BGPSecHandler* self, UC_UpdateData* update);
 
+/**
+ * Validates the given bgpsec update data using one batch call into the 
+ * SRxCryptoAPI.
+ *
+ * @param self The BGPsec Handler itself
+ * @param count The number of updates
+ * @param updates The updates to be validated
+ * @param results OUT - Receives SRx_RESULT_VALID or SRx_RESULT_INVALID for
+ *                each update.
+ * 
+ * @since 0.6.0
+ */
+void validateSignatures(BGPSecHandler* self, int count, 
+                        UC_UpdateData** updates, uint8_t* results);
+
+/**
+ * Retrieve the statistics of the verification result cache.
+ *
+ * @param self The BGPsec Handler itself
+ * @param info OUT - Receives the statistics.
+ *
+ * @since 0.6.0
+ */
+void getVerifyCacheInfo(BGPSecHandler* self, BH_VerifyCacheInfo* info);
+
 /**
  * Creates a signature for a given Byte-stream.
  *
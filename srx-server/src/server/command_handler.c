@@ -51,6 +51,7 @@
  */
 #include <ctype.h>
 #include "server/command_handler.h"
+#include "server/main.h"
 #include "shared/srx_defs.h"
 #include "shared/srx_identifier.h"
 #include "shared/srx_packets.h"
@@ -65,6 +66,7 @@
 
 // Forward declaration
 static void* handleCommands(void* arg);
+static void _freeResultBatchSet(void* set);
 extern RPKI_QUEUE* getRPKIQueue();
 
 /**
@@ -97,7 +99,14 @@ bool initializeCommandHandler(CommandHandler* self, Configuration* cfg,
   // 'start' has not been called
   self->numThreads = 0;
 
-  return true; // Does not fail
+  // The result batches are created per thread on first use
+  if (pthread_key_create(&self->resBatchKey, _freeResultBatchSet) != 0)
+  {
+    RAISE_SYS_ERROR("Could not create the result batch key!");
+    return false;
+  }
+
+  return true;
 }
 
 /**
@@ -129,8 +138,12 @@ void releaseCommandHandler(CommandHandler* self)
     }
   }
 
+  // Results not flushed by now are not send anymore.
+  _freeResultBatchSet(pthread_getspecific(self->resBatchKey));
+  pthread_setspecific(self->resBatchKey, NULL);
+  pthread_key_delete(self->resBatchKey);
+
   LOG(LEVEL_DEBUG, HDR "Command Handler released!", pthread_self());
-  // Do nothing
 }
 
 bool startProcessingCommands(CommandHandler* self, CommandQueue* cmdQueue)
@@ -140,13 +153,17 @@ bool startProcessingCommands(CommandHandler* self, CommandQueue* cmdQueue)
   self->queue = cmdQueue;
   LOG(LEVEL_DEBUG, HDR "Start Processing Commands...", pthread_self());
 
-  for (idx = 0; idx < NUM_COMMAND_HANDLER_THREADS; idx++)
+  for (idx = 0; idx < cmdQueue->noWorkers; idx++)
   {
     LOG (LEVEL_DEBUG, HDR "Create command handler Thread No %u", pthread_self(),
                       idx);
-    if (pthread_create(&self->threads[idx], NULL, handleCommands, self) > 0)
+    self->threads[idx].handler = self;
+    self->threads[idx].worker  = idx;
+    if (pthread_create(&self->threads[idx].thread, NULL, handleCommands, 
+                       &self->threads[idx]) > 0)
     {
-      // Continue with less threads
+      // Continue with less threads, the remaining worker queues are served
+      // by the other threads.
       if (idx > 0)
       {
         RAISE_ERROR("Failed to initiate a command handler thread "
@@ -198,7 +215,7 @@ void stopProcessingCommands(CommandHandler* self)
     // Wait until each thread terminated
     for (idx = 0; idx < self->numThreads; idx++)
     {
-      s = pthread_join(self->threads[idx], NULL);
+      s = pthread_join(self->threads[idx].thread, NULL);
       if (s != 0)
         handle_error_en(s, "pthread_join");
     }
@@ -284,7 +301,11 @@ static bool _processHandshake(CommandHandler* cmdHandler,
 
       clientThread->proxyID  = proxyID;
       clientThread->routerID = clientID;
-      if (sendHelloResponse(item->serverSocket, item->client, proxyID))
+      // Use only the capabilities both sides support, older proxies send 0.
+      clientThread->capabilities = ntohl(hdr->capabilities)
+                                   & SRX_PROXY_CAP_ALL;
+      if (sendHelloResponse(item->serverSocket, item->client, proxyID,
+                            clientThread->capabilities))
       {
         clientThread->initialized = true;
         if (cmdHandler->sysConfig->syncAfterConnEstablished)
@@ -572,8 +593,13 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
       return false;
     }
     
-    srxRes_mod.bgpsecResult = validateSignature(cmdHandler->bgpsecHandler, 
-                                                uData);
+    // Without all keys of at least one signature block the path is invalid,
+    // no need for signature validation.
+    srxRes_mod.bgpsecResult = ski_canValidate(getSKICache(), &item->dataID)
+                              ? validateSignature(cmdHandler->bgpsecHandler, 
+                                                  uData)
+                              : SRx_RESULT_INVALID;
+    releaseUpdateData(cmdHandler->updCache, uData);
   }
 
   // Only do origin validation if not already performed
@@ -630,7 +656,6 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
     // ----------------------------------------------------------------
     RPKIHandler* handler = (RPKIHandler*)cmdHandler->rpkiHandler;
     ASPA_DBManager* aspaDBManager = handler->aspaDBManager;
-    TrieNode *root = aspaDBManager->tableRoot;
 
 
     // -------------------------------------------------------------------
@@ -648,6 +673,9 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
       if (aspl->afi == 0 || aspl->afi > 2) // if more than 2 (AFI_IP6)
         afi = AFI_IP;                      // set default
 
+      // Read before validating, ASPA changes made afterwards are picked up by
+      // the next End of Data.
+      uint32_t valSeq = getAspaValidationSeq(aspaDBManager);
       uint8_t valResult = validateASPA (aspl->asPathList, 
           aspl->asPathLength, aspl->asType, aspl->asRelDir, afi, aspaDBManager);
 
@@ -658,8 +686,7 @@ static bool _processUpdateValidation(CommandHandler* cmdHandler,
       //
       if (valResult != aspl->aspaValResult)
       {
-        time_t cTime = time(NULL);
-        aspl->lastModified = cTime;
+        aspl->validationSeq = valSeq;
         modifyAspaValidationResultToAspathCache (cmdHandler->aspathCache, pathId, 
             valResult, aspl);
         aspl->aspaValResult = valResult;
@@ -744,7 +771,8 @@ static void _processDeleteUpdate(CommandHandler* cmdHandler,
                             &updateID, htons(duHdr->keepWindow)))
   {
     // Reduce the updates by one. BZ308
-    cmdHandler->svrConnHandler->proxyMap[clThread->routerID].updateCount--;
+    __sync_fetch_and_sub(
+      &cmdHandler->svrConnHandler->proxyMap[clThread->routerID].updateCount, 1);
   }
   else
   {
@@ -780,7 +808,8 @@ static void _processPeerChange(CommandHandler* cmdHandler,
  */
 static void* handleCommands(void* arg)
 {
-  CommandHandler* cmdHandler = (CommandHandler*)arg;
+  CommandHandlerThread* cmdThread = (CommandHandlerThread*)arg;
+  CommandHandler* cmdHandler = cmdThread->handler;
   CommandQueueItem* item;
   bool keepGoing = true;
   uint8_t clientID = 0; // only used in process handshake and goodbye
@@ -795,7 +824,12 @@ static void* handleCommands(void* arg)
     // Block until the next command is available for this thread
     LOG(LEVEL_DEBUG, HDR "recvLock request ...%s", pthread_self(),__FUNCTION__);
 
-    item = fetchNextCommand(cmdHandler->queue);
+    item = fetchNextCommand(cmdHandler->queue, cmdThread->worker);
+    if (item == NULL)
+    {
+      // The command queue was released.
+      break;
+    }
 
     switch (item->cmdType)
     {
@@ -843,9 +877,9 @@ static void* handleCommands(void* arg)
               break;
             case PDU_SRXPROXY_GOODBYE:
               gbhdr = (SRXPROXY_GOODBYE*)item->data;
+              clientID = ((ClientThread*)item->client)->routerID;
               closeClientConnection(&cmdHandler->svrConnHandler->svrSock,
                                     item->client);
-              clientID = ((ClientThread*)item->client)->routerID;
               //cmdHandler->svrConnHandler->proxyMap[clientID].isActive = false;
               // The deaktivation will also delete because it did not crash
               deactivateConnectionMapping(cmdHandler->svrConnHandler, clientID,
@@ -868,10 +902,10 @@ static void* handleCommands(void* arg)
               sendError(SRXERR_INVALID_PACKET, item->serverSocket,
                         item->client, false);
               sendGoodbye(item->serverSocket, item->client, false);
+              clientID = ((ClientThread*)item->client)->routerID;
               closeClientConnection(&cmdHandler->svrConnHandler->svrSock,
                                     item->client);
 
-              clientID = ((ClientThread*)item->client)->routerID;
               // The deaktivatio will also delete the mapping because it was NOT
               // a crash.
               deactivateConnectionMapping(cmdHandler->svrConnHandler, clientID,
@@ -889,14 +923,6 @@ static void* handleCommands(void* arg)
       // Still keep going.
     }
 
-    if (cmdHandler->queue->nextItemNode != NULL)
-    {
-      LOG(LEVEL_DEBUG, HDR "recv Unlock request ...%s", pthread_self(),
-                       __FUNCTION__);
-      //unlockMutex(&cmdHandler->queue->recvMutex);
-      //signalCond(&cmdHandler->queue->recvCond);
-    }
-
     // Now remove the item from command handler. it is processed.
     deleteCommand(cmdHandler->queue, item);
 
@@ -909,6 +935,219 @@ static void* handleCommands(void* arg)
 }
 
 
+/**
+ * Free the result batches of a thread. Results not flushed are dropped. This
+ * is the destructor of the result batch key.
+ *
+ * @param set The CommandResultBatchSet of the thread (can be NULL).
+ *
+ * @since 0.6.0
+ */
+static void _freeResultBatchSet(void* set)
+{
+  CommandResultBatchSet* batchSet = (CommandResultBatchSet*)set;
+  int idx;
+
+  if (batchSet != NULL)
+  {
+    for (idx = 0; idx < MAX_PROXY_CLIENT_ELEMENTS; idx++)
+    {
+      free(batchSet->batch[idx].pdu);
+    }
+    free(batchSet);
+  }
+}
+
+/**
+ * Send the results collected in the given batch to the given client. A batch
+ * with one result, or a batch for a client that did not announce support for
+ * verification notification batches, is send as regular verification
+ * notifications. The batch is empty afterwards. The batch is owned by the
+ * calling thread, no lock is held while sending.
+ *
+ * @param self Instance
+ * @param batch The batch to send.
+ * @param clientID The client whose batch is send.
+ *
+ * @return false if the batch could not be send.
+ *
+ * @since 0.6.0
+ */
+static bool _sendResultBatch(CommandHandler* self, CommandResultBatch* batch,
+                             uint8_t clientID)
+{
+  ProxyClientMapping* mapping = &self->svrConnHandler->proxyMap[clientID];
+  ClientThread*       client  = (ClientThread*)mapping->socket;
+  SRXPROXY_VERIFY_NOTIFICATION_BATCH* hdr = NULL;
+  SRXPROXY_VERIFY_RESULT*             res = NULL;
+  SRXPROXY_VERIFY_NOTIFICATION        single;
+  uint32_t pduLength = 0;
+  uint32_t idx       = 0;
+  bool     retVal    = true;
+
+  if (batch->noResults == 0)
+  {
+    return true;
+  }
+
+  // If the mapping is inactive the proxy might be in reboot.
+  if (!mapping->isActive || client == NULL)
+  {
+    retVal = false;
+  }
+  else if (   (batch->noResults == 1)
+           || !(client->capabilities & SRX_PROXY_CAP_VERI_NOTIFICATION_BATCH))
+  {
+    res = (SRXPROXY_VERIFY_RESULT*)(batch->pdu
+                                 + sizeof(SRXPROXY_VERIFY_NOTIFICATION_BATCH));
+    memset(&single, 0, sizeof(SRXPROXY_VERIFY_NOTIFICATION));
+    single.type   = PDU_SRXPROXY_VERI_NOTIFICATION;
+    single.length = htonl(sizeof(SRXPROXY_VERIFY_NOTIFICATION));
+    for (idx = 0; retVal && idx < batch->noResults; idx++, res++)
+    {
+      single.resultType   = res->resultType;
+      single.roaResult    = res->roaResult;
+      single.bgpsecResult = res->bgpsecResult;
+      single.aspaResult   = res->aspaResult;
+      single.updateID     = res->updateID;
+      retVal = sendPacketToClient(&self->svrConnHandler->svrSock, client,
+                                  &single,
+                                  sizeof(SRXPROXY_VERIFY_NOTIFICATION));
+    }
+  }
+  else
+  {
+    pduLength = sizeof(SRXPROXY_VERIFY_NOTIFICATION_BATCH)
+                + (batch->noResults * sizeof(SRXPROXY_VERIFY_RESULT));
+    hdr = (SRXPROXY_VERIFY_NOTIFICATION_BATCH*)batch->pdu;
+    memset(hdr, 0, sizeof(SRXPROXY_VERIFY_NOTIFICATION_BATCH));
+    hdr->type      = PDU_SRXPROXY_VERI_NOTIFICATION_BATCH;
+    hdr->noResults = htonl(batch->noResults);
+    hdr->length    = htonl(pduLength);
+    retVal = sendPacketToClient(&self->svrConnHandler->svrSock, client,
+                                batch->pdu, pduLength);
+  }
+
+  batch->noResults = 0;
+  return retVal;
+}
+
+/**
+ * Add the result to the batch of the given client. A full batch is send right
+ * away.
+ *
+ * @param self Instance
+ * @param batchSet The result batches of the calling thread.
+ * @param clientID The client the result is for.
+ * @param valResult The validation result.
+ *
+ * @return false if the result could not be stored or a full batch could not
+ *         be send.
+ *
+ * @since 0.6.0
+ */
+static bool _addToResultBatch(CommandHandler* self,
+                              CommandResultBatchSet* batchSet,
+                              uint8_t clientID, SRxValidationResult* valResult)
+{
+  CommandResultBatch*     batch = &batchSet->batch[clientID];
+  SRXPROXY_VERIFY_RESULT* res   = NULL;
+  bool retVal = true;
+
+  if (batch->pdu == NULL)
+  {
+    batch->pdu = malloc(sizeof(SRXPROXY_VERIFY_NOTIFICATION_BATCH)
+                   + (CMD_RESULT_BATCH_SIZE * sizeof(SRXPROXY_VERIFY_RESULT)));
+    if (batch->pdu == NULL)
+    {
+      RAISE_SYS_ERROR("Not enough memory to batch the validation result!");
+      return false;
+    }
+    batch->noResults = 0;
+  }
+  else if (batch->noResults == CMD_RESULT_BATCH_SIZE)
+  {
+    retVal = _sendResultBatch(self, batch, clientID);
+  }
+
+  res = (SRXPROXY_VERIFY_RESULT*)(batch->pdu
+                                  + sizeof(SRXPROXY_VERIFY_NOTIFICATION_BATCH))
+        + batch->noResults;
+  res->updateID     = htonl(valResult->updateID);
+  res->resultType   = (valResult->valType & SRX_FLAG_ROA_BGPSEC_ASPA);
+  res->roaResult    = valResult->valResult.roaResult;
+  res->bgpsecResult = valResult->valResult.bgpsecResult;
+  res->aspaResult   = valResult->valResult.aspaResult;
+  batch->noResults++;
+
+  return retVal;
+}
+
+/**
+ * Start collecting the results the calling thread passes to broadcastResult.
+ * Instead of one verification notification per result and client, each client
+ * receives the collected results in verification notification batches once
+ * the batch is flushed or the batch of the client is full. Clients that did
+ * not announce batch support receive single notifications at that time.
+ * Results of other threads are not delayed. Batches can be nested, they are
+ * send with the outermost flush.
+ *
+ * @param self Instance
+ *
+ * @since 0.6.0
+ */
+void beginResultBatch(CommandHandler* self)
+{
+  CommandResultBatchSet* batchSet = pthread_getspecific(self->resBatchKey);
+
+  if (batchSet == NULL)
+  {
+    batchSet = calloc(1, sizeof(CommandResultBatchSet));
+    if (batchSet == NULL)
+    {
+      RAISE_SYS_ERROR("Not enough memory for result batches, results are "
+                      "send one by one!");
+      return;
+    }
+    pthread_setspecific(self->resBatchKey, batchSet);
+  }
+  batchSet->depth++;
+}
+
+/**
+ * End a batch the calling thread started with beginResultBatch. If it is the
+ * outermost batch, all collected results are send to their clients.
+ *
+ * @param self Instance
+ *
+ * @return false if the results could not be send to at least one client.
+ *
+ * @since 0.6.0
+ */
+bool flushResultBatch(CommandHandler* self)
+{
+  CommandResultBatchSet* batchSet = pthread_getspecific(self->resBatchKey);
+  bool retVal = true;
+  int  idx;
+
+  if (batchSet == NULL || batchSet->depth == 0)
+  {
+    return true;
+  }
+  if (--batchSet->depth == 0)
+  {
+    for (idx = 0; idx < MAX_PROXY_CLIENT_ELEMENTS; idx++)
+    {
+      if (!_sendResultBatch(self, &batchSet->batch[idx], (uint8_t)idx))
+      {
+        retVal = false;
+      }
+    }
+  }
+
+  return retVal;
+}
+
 /**
  * Sends a (new) result to all connected clients of the provided update.
  * The UpdateID is embedded in the SRxValidationResult data.
@@ -944,6 +1183,22 @@ bool broadcastResult(CommandHandler* self, SRxValidationResult* valResult)
   // that have listeners / clients installed.
   if (clientCt > 0)
   {
+    CommandResultBatchSet* batchSet = pthread_getspecific(self->resBatchKey);
+    if (batchSet != NULL && batchSet->depth > 0)
+    {
+      // The result is send with the batch of each client.
+      retVal = false;
+      while  (clientCt-- > 0)
+      {
+        if (self->svrConnHandler->proxyMap[clients[clientCt]].isActive)
+        {
+          retVal |= _addToResultBatch(self, batchSet, clients[clientCt],
+                                      valResult);
+        }
+      }
+      return retVal;
+    }
+
     pdu = malloc(pduLength);
     memset(pdu,0,pduLength);
     pdu->type         = PDU_SRXPROXY_VERI_NOTIFICATION;
@@ -49,19 +49,55 @@
 #include "server/update_cache.h"
 #include "server/aspath_cache.h"
 #include "shared/srx_packets.h"
+#include "util/mutex.h"
 #include "util/packet.h"
 #include "util/server_socket.h"
 
+struct _CommandHandler;
+
+/** Maximum number of results of one verification notification batch. */
+#define CMD_RESULT_BATCH_SIZE 4096
+
 /**
- * Number of parallel threads.
+ * The verification notification batch of one client.
+ *
+ * @since 0.6.0
  */
-#define NUM_COMMAND_HANDLER_THREADS 1
-// #define NUM_COMMAND_HANDLER_THREADS 2
+typedef struct {
+  // The SRXPROXY_VERIFY_NOTIFICATION_BATCH, allocated on first use with room
+  // for CMD_RESULT_BATCH_SIZE results.
+  uint8_t*  pdu;
+  // The number of results stored in the PDU.
+  uint32_t  noResults;
+} CommandResultBatch;
 
 /**
- * A single Command Handler.
+ * The verification notification batches collected by one thread between its
+ * beginResultBatch and flushResultBatch.
+ *
+ * @since 0.6.0
+ */
+typedef struct {
+  // The nesting depth of beginResultBatch.
+  int                depth;
+  // The batch of each client.
+  CommandResultBatch batch[MAX_PROXY_CLIENT_ELEMENTS];
+} CommandResultBatchSet;
+
+/**
+ * A single command handler thread, it serves one worker queue of the command 
+ * queue.
  */
 typedef struct {
+  struct _CommandHandler* handler; // The command handler
+  int                     worker;  // The worker queue of this thread
+  pthread_t               thread;  // The thread
+} CommandHandlerThread;
+
+/**
+ * A single Command Handler.
+ */
+typedef struct _CommandHandler {
   // Arguments (create)
   ServerConnectionHandler*  svrConnHandler;
   BGPSecHandler*            bgpsecHandler;
@@ -76,8 +112,12 @@ typedef struct {
   CommandQueue*             queue;
 
   // Internal
-  pthread_t                 threads[NUM_COMMAND_HANDLER_THREADS];
+  CommandHandlerThread      threads[CMD_QUEUE_MAX_WORKERS];
   int                       numThreads;
+
+  // The CommandResultBatchSet of each thread that collects the results it
+  // broadcasts between beginResultBatch and flushResultBatch.
+  pthread_key_t             resBatchKey;
 } CommandHandler;
 
 /**
@@ -107,7 +147,7 @@ void releaseCommandHandler(CommandHandler* self);
 /**
  * Handles all commands in the given queue.
  * 
- * @note Spawns a threads, i.e. is non-blocking
+ * @note Spawns one thread per worker queue, i.e. is non-blocking
  *
  * @param self Instance
  * @param cmdQueue An existing Command Queue
@@ -136,6 +176,33 @@ void stopProcessingCommands(CommandHandler* self);
  */
 bool broadcastResult(CommandHandler* self, SRxValidationResult* valResult);
 
+/**
+ * Start collecting the results the calling thread passes to broadcastResult.
+ * Instead of one verification notification per result and client, each client
+ * receives the collected results in verification notification batches once
+ * the batch is flushed or the batch of the client is full. Clients that did
+ * not announce batch support receive single notifications at that time.
+ * Results of other threads are not delayed. Batches can be nested, they are
+ * send with the outermost flush.
+ *
+ * @param self Instance
+ *
+ * @since 0.6.0
+ */
+void beginResultBatch(CommandHandler* self);
+
+/**
+ * End a batch the calling thread started with beginResultBatch. If it is the
+ * outermost batch, all collected results are send to their clients.
+ *
+ * @param self Instance
+ *
+ * @return false if the results could not be send to at least one client.
+ *
+ * @since 0.6.0
+ */
+bool flushResultBatch(CommandHandler* self);
+
 
 // ASPA validation function declaration 
 //
@@ -34,6 +34,9 @@
  * -----------------------------------------------------------------------------
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "server/command_queue.h"
 #include "shared/srx_defs.h"
 #include "shared/srx_packets.h"
@@ -42,43 +45,281 @@
 
 #define HDR "([0x%08X] Command Queue): "
 
+/**
+ * Determine the hash of the client.
+ *
+ * @param client The server client.
+ *
+ * @return The hash value
+ *
+ * @since 0.6.0
+ */
+static uint32_t _clientHash(ServerClient* client)
+{
+  uint64_t value = (uint64_t)(uintptr_t)client;
+  
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  return (uint32_t)value;
+}
+
+/**
+ * Append the slot to the ready list of the worker queue. The worker queue 
+ * MUST be locked.
+ *
+ * @param wQueue The worker queue.
+ * @param slot The client slot.
+ *
+ * @since 0.6.0
+ */
+static void _appendReady(CommandWorkerQueue* wQueue, CommandClientSlot* slot)
+{
+  slot->readyNext = NULL;
+  if (wQueue->readyTail != NULL)
+  {
+    wQueue->readyTail->readyNext = slot;
+  }
+  else
+  {
+    wQueue->readyHead = slot;
+  }
+  wQueue->readyTail = slot;
+}
+
+/**
+ * Find the slot of the given client, if requested the slot will be created. 
+ * The worker queue MUST be locked.
+ *
+ * @param wQueue The worker queue.
+ * @param client The server client.
+ * @param create Create the slot if it does not exist.
+ *
+ * @return The slot or NULL.
+ *
+ * @since 0.6.0
+ */
+static CommandClientSlot* _getSlot(CommandWorkerQueue* wQueue, 
+                                   ServerClient* client, bool create)
+{
+  uint32_t bucket = _clientHash(client) % CMD_QUEUE_CLIENT_BUCKETS;
+  CommandClientSlot* slot = wQueue->slots[bucket];
+
+  while ((slot != NULL) && (slot->client != client))
+  {
+    slot = slot->hashNext;
+  }
+  if ((slot == NULL) && create)
+  {
+    slot = calloc(1, sizeof(CommandClientSlot));
+    if (slot != NULL)
+    {
+      slot->client   = client;
+      slot->hashNext = wQueue->slots[bucket];
+      wQueue->slots[bucket] = slot;
+    }
+  }
+
+  return slot;
+}
+
+/**
+ * Remove the slot from the worker queue and free it. The slot MUST NOT be in
+ * the ready list and the worker queue MUST be locked.
+ *
+ * @param wQueue The worker queue.
+ * @param slot The client slot.
+ *
+ * @since 0.6.0
+ */
+static void _freeSlot(CommandWorkerQueue* wQueue, CommandClientSlot* slot)
+{
+  CommandClientSlot** link = &wQueue->slots[_clientHash(slot->client) 
+                                            % CMD_QUEUE_CLIENT_BUCKETS];
+  while (*link != slot)
+  {
+    link = &(*link)->hashNext;
+  }
+  *link = slot->hashNext;
+  free(slot);
+}
+
+/**
+ * Free the command item including its data.
+ *
+ * @param item The command item.
+ *
+ * @since 0.6.0
+ */
+static void _freeItem(CommandQueueItem* item)
+{
+  if (item->pduBuffer != NULL)
+  {
+    // The data points into the PDU buffer.
+    releasePDUBuffer(item->pduBuffer);
+  }
+  else if (item->data != NULL)
+  {
+    free(item->data);
+  }
+  free(item);
+}
+
+/**
+ * Take the oldest command of the first ready client from the worker queue. 
+ * The worker queue MUST be locked.
+ *
+ * @param wQueue The worker queue.
+ * @param owner true if the caller is the worker that owns the queue. Only the
+ *              owner will receive SHUTDOWN commands.
+ *
+ * @return The command or NULL if no command is ready.
+ *
+ * @since 0.6.0
+ */
+static CommandQueueItem* _takeItem(CommandWorkerQueue* wQueue, bool owner)
+{
+  CommandQueueItem*  item = NULL;
+  CommandClientSlot* slot = wQueue->readyHead;
+
+  if (owner && (wQueue->shutdown != NULL))
+  {
+    item = wQueue->shutdown;
+    wQueue->shutdown = item->next;
+  }
+  else if (slot != NULL)
+  {
+    wQueue->readyHead = slot->readyNext;
+    if (wQueue->readyHead == NULL)
+    {
+      wQueue->readyTail = NULL;
+    }
+    slot->readyNext = NULL;
+    slot->busy      = true;
+
+    item = slot->head;
+    slot->head = item->next;
+    if (slot->head == NULL)
+    {
+      slot->tail = NULL;
+    }
+    wQueue->unprocessedItems--;
+  }
+
+  if (item != NULL)
+  {
+    item->next     = NULL;
+    item->consumed = true;
+    wQueue->inProcess++;
+    wQueue->processed++;
+  }
+
+  return item;
+}
+
+/**
+ * Wait on the worker queue until it is signaled or the steal wait time passed.
+ * The worker queue MUST be locked.
+ *
+ * @param wQueue The worker queue.
+ *
+ * @since 0.6.0
+ */
+static void _waitForCommands(CommandWorkerQueue* wQueue)
+{
+  struct timespec deadline;
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_nsec += (CMD_QUEUE_STEAL_WAIT % 1000) * 1000000L;
+  deadline.tv_sec  += (CMD_QUEUE_STEAL_WAIT / 1000) 
+                      + (deadline.tv_nsec / 1000000000L);
+  deadline.tv_nsec %= 1000000000L;
+
+  wQueue->waiting = true;
+  pthread_cond_timedwait(&wQueue->consumeCond, &wQueue->mutex, &deadline);
+  wQueue->waiting = false;
+}
+
+/**
+ * Wake up one waiting worker other than the given one, it will steal the 
+ * command that could not be processed right away by its busy owner.
+ *
+ * @param self The command queue.
+ * @param busyWorker The worker that is busy.
+ *
+ * @since 0.6.0
+ */
+static void _wakeIdleWorker(CommandQueue* self, int busyWorker)
+{
+  CommandWorkerQueue* wQueue = NULL;
+  bool woken = false;
+  int  idx;
+
+  for (idx = 1; !woken && (idx < self->noWorkers); idx++)
+  {
+    wQueue = &self->workers[(busyWorker + idx) % self->noWorkers];
+    lockMutex(&wQueue->mutex);
+    if (wQueue->waiting)
+    {
+      signalCond(&wQueue->consumeCond);
+      woken = true;
+    }
+    unlockMutex(&wQueue->mutex);
+  }
+}
+
 /** 
  * Initializes and setup the command queue.
  *
  * @param self Variable that should be initialized
+ * @param noWorkers The number of worker queues (1..CMD_QUEUE_MAX_WORKERS)
  * 
  * @return true if the queue could be initialized.
  */
-bool initializeCommandQueue(CommandQueue* self)
+bool initializeCommandQueue(CommandQueue* self, int noWorkers)
 {
+  CommandWorkerQueue* wQueue = NULL;
+  int idx;
+
   if (self->alive)
   {
     RAISE_ERROR("This command queue is already alive!!");  
     return false;
   }
-  
-  // Create read and write Mutex
-  if (!initMutex(&self->cmdQueueMutex))
+  if ((noWorkers < 1) || (noWorkers > CMD_QUEUE_MAX_WORKERS))
   {
+    RAISE_ERROR("Invalid number of command queue workers '%d' (1..%d)!",
+                noWorkers, CMD_QUEUE_MAX_WORKERS);
     return false;
   }
 
-  if(!initCond(&self->consumeCond))
+  memset(self, 0, sizeof(CommandQueue));
+  for (idx = 0; idx < noWorkers; idx++)
   {
-    releaseMutex(&self->cmdQueueMutex);
-    pthread_cond_destroy(&self->consumeCond);
+    wQueue = &self->workers[idx];
+    // Create read and write Mutex
+    if (!initMutex(&wQueue->mutex))
+    {
+      break;
+    }
+    if (!initCond(&wQueue->consumeCond))
+    {
+      releaseMutex(&wQueue->mutex);
+      break;
+    }
+  }
+  if (idx < noWorkers)
+  {
+    while (idx-- > 0)
+    {
+      destroyCond(&self->workers[idx].consumeCond);
+      releaseMutex(&self->workers[idx].mutex);
+    }
     return false;
   }
 
-  // An empty list
-  self->totalItems = 0;
-  self->unprocessedItems = 0;
-  initSList(&self->queue);
-
-  // No item is available, i.e. block fetch
-  self->nextItemNode = NULL;
-
-  self->alive = true;
+  self->noWorkers = noWorkers;
+  self->alive     = true;
   
   return true;
 }
@@ -90,50 +331,75 @@ bool initializeCommandQueue(CommandQueue* self)
  */
 void releaseCommandQueue(CommandQueue* self)
 {
-  if (self != NULL)
+  CommandWorkerQueue* wQueue = NULL;
+  CommandClientSlot*  slot   = NULL;
+  int idx, bucket;
+
+  if ((self != NULL) && (self->noWorkers > 0))
   {
     LOG(LEVEL_DEBUG, HDR "Release Command Queue", pthread_self());    
-    lockMutex(&self->cmdQueueMutex);
     LOG(LEVEL_DEBUG, HDR "Set alive = false", pthread_self());    
     self->alive = false;
-    LOG(LEVEL_DEBUG, HDR "Signal consumer (fetch thread)", pthread_self());        
-    signalCond(&self->consumeCond);    
-    
-    unlockMutex(&self->cmdQueueMutex);
+    LOG(LEVEL_DEBUG, HDR "Signal consumer (fetch thread)", pthread_self());
+    for (idx = 0; idx < self->noWorkers; idx++)
+    {
+      wQueue = &self->workers[idx];
+      lockMutex(&wQueue->mutex);
+      pthread_cond_broadcast(&wQueue->consumeCond);
+      unlockMutex(&wQueue->mutex);
+    }
     
     LOG(LEVEL_DEBUG, HDR "Now empty command queue", pthread_self());    
     removeAllCommands(self);
        
-    LOG(LEVEL_DEBUG, HDR "Release internal list and Mutex", pthread_self());    
-    // Release all items and the mutexes
-    releaseSList(&self->queue); 
-    releaseMutex(&self->cmdQueueMutex);
+    LOG(LEVEL_DEBUG, HDR "Release internal slots and Mutex", pthread_self());
+    for (idx = 0; idx < self->noWorkers; idx++)
+    {
+      wQueue = &self->workers[idx];
+      // Only slots with commands in process are left.
+      for (bucket = 0; bucket < CMD_QUEUE_CLIENT_BUCKETS; bucket++)
+      {
+        while (wQueue->slots[bucket] != NULL)
+        {
+          slot = wQueue->slots[bucket];
+          wQueue->slots[bucket] = slot->hashNext;
+          free(slot);
+        }
+      }
+      destroyCond(&wQueue->consumeCond);
+      releaseMutex(&wQueue->mutex);
+    }
+    self->noWorkers = 0;
   }
 }
 
 /**
- * Add a given command into the command queue. THe type of command is stored in 
- * the parameter cmdType.
+ * Add a given command into the command queue. The data is either copied or,
+ * if a PDU buffer is given, the command keeps a reference to the buffer.
  *
  * @param self The command queue where the command has to be added to
  * @param cmdType The type of the command.
  * @param svrSock The server socket
  * @param client The server client
- * @param dataID An identifier related to the data block. In case of SRX_PROXY
- *               this identifier contains either 0 or the update ID.
+ * @param dataID An identifier related to the data block.
  * @param dataLength The length of the data attached to this command queue.
  * @param data The data package attached.
+ * @param pduBuffer The PDU buffer containing data or NULL.
  *
  * @return true if the command could be added to the queue.
+ *
+ * @since 0.6.0
  */
-bool queueCommand(CommandQueue* self, CommandQueueType cmdType,
-                  ServerSocket* svrSock, ServerClient* client, uint32_t dataID,
-                  uint32_t dataLength, uint8_t* data)
+static bool _queueCommand(CommandQueue* self, CommandQueueType cmdType,
+                          ServerSocket* svrSock, ServerClient* client, 
+                          uint32_t dataID, uint32_t dataLength, uint8_t* data,
+                          PDU_Buffer* pduBuffer)
 {
-  // This method is changed in such that the wait mutex is synchronized with
-  // the fetchCommand method. The waitmutex is locked and a notify is called 
-  // once a command is placed and the counter is incresed. The mutex is released
-  // afterwards.
+  CommandWorkerQueue* wQueue  = NULL;
+  CommandClientSlot*  slot    = NULL;
+  CommandQueueItem*   newItem = NULL;
+  bool ownerBusy = false;
+  int  worker    = 0;
   
   if (!self->alive)
   {
@@ -143,59 +409,41 @@ bool queueCommand(CommandQueue* self, CommandQueueType cmdType,
   }
   
   LOG(LEVEL_DEBUG, HDR "queueComamnd type (%u)", pthread_self(), cmdType);
-  CommandQueueItem* newItem;    
 
-  // Try to add a new item - make sure no one modifies the queue
-  lockMutex(&self->cmdQueueMutex);  
-  newItem = (CommandQueueItem*)appendToSList(&self->queue, 
-                                             sizeof(CommandQueueItem));
-  newItem->consumed = false;
-  
-  // Set the new next node inside this mutex to make sure we -
-  // - get the new item
-  // - unlock only once
-  if (self->nextItemNode == NULL)
+  //TODO: BZ197 This might be revisited - Dirty BUG test
+  if ((data != NULL) && (dataLength >= 1000000)) // increased by factor 10
   {
-    self->nextItemNode = getLastNodeOfSList(&self->queue);
+    // SEGV due to dataLength : 50529027 (0x03030303)
+    RAISE_SYS_ERROR("Given datalength too big due to transmission error "
+      "- Inform developers with reference code BZ197!");
+    return false;
   }
 
-  // Failed to add an item
+  newItem = calloc(1, sizeof(CommandQueueItem));
   if (newItem == NULL)
   {
-    unlockMutex(&self->cmdQueueMutex);
+    RAISE_SYS_ERROR("Not enough memory to add the command to the queue");
     return false;
   }
-
-  // 'NULL' packet
-  if (data == NULL)
+  
+  if (pduBuffer != NULL)
   {
-    newItem->data = NULL;
-  } 
-  else
+    // Use the received PDU in place.
+    newItem->pduBuffer = retainPDUBuffer(pduBuffer);
+    newItem->data      = data;
+  }
+  // 'NULL' packet
+  else if (data != NULL)
   {
     // Try to copy the 'packet' into the command item
     newItem->data = malloc(dataLength);
     if (newItem->data == NULL)
     {
       RAISE_SYS_ERROR("Not enough memory to copy the data into the queue");
-      deleteFromSList(&self->queue, newItem);
-      
-      return false;
-    }
-    //TODO: BZ197 This might be revisited - Dirty BUG test
-    if (dataLength < 1000000) // dirty bug test - increased by factor 10
-    {
-      memcpy(newItem->data, data, dataLength); 
-      // SEGV due to dataLength : 50529027 (0x03030303)
-    }
-    else
-    {
-      RAISE_SYS_ERROR("Given datalength too big due to transmission error "
-        "- Inform developers with reference code BZ197!");
-      deleteFromSList(&self->queue, newItem);
-      unlockMutex(&self->cmdQueueMutex);
+      free(newItem);
       return false;
     }
+    memcpy(newItem->data, data, dataLength); 
   }
 
   // Set the other item members
@@ -204,165 +452,313 @@ bool queueCommand(CommandQueue* self, CommandQueueType cmdType,
   newItem->cmdType      = cmdType;
   newItem->dataID       = dataID;
   newItem->dataLength   = dataLength;
-    
-  self->totalItems++;
-  self->unprocessedItems++;
+  newItem->consumed     = false;
+
+  if (cmdType == COMMAND_TYPE_SHUTDOWN)
+  {
+    // Each worker receives one SHUTDOWN, they are never stolen. SHUTDOWN 
+    // commands are only queued by stopProcessingCommands.
+    worker = self->nextShutdown++ % self->noWorkers;
+    wQueue = &self->workers[worker];
+    newItem->worker = worker;
+    lockMutex(&wQueue->mutex);
+    newItem->next    = wQueue->shutdown;
+    wQueue->shutdown = newItem;
+    signalCond(&wQueue->consumeCond);
+    unlockMutex(&wQueue->mutex);
+    return true;
+  }
+
+  // All commands of a client go to the same worker to keep them in order.
+  worker = _clientHash(client) % self->noWorkers;
+  wQueue = &self->workers[worker];
+  newItem->worker = worker;
   
-  LOG(LEVEL_DEBUG, HDR "Signale new data to consume...%s", pthread_self(),
-                   __FUNCTION__);
-  signalCond(&self->consumeCond);
+  lockMutex(&wQueue->mutex);  
+  slot = _getSlot(wQueue, client, true);
+  if (slot == NULL)
+  {
+    unlockMutex(&wQueue->mutex);
+    RAISE_SYS_ERROR("Not enough memory to add the command to the queue");
+    _freeItem(newItem);
+    return false;
+  }
+  newItem->slot = slot;
+  if (slot->tail != NULL)
+  {
+    slot->tail->next = newItem;
+  }
+  else
+  {
+    slot->head = newItem;
+    if (!slot->busy)
+    {
+      _appendReady(wQueue, slot);
+    }
+  }
+  slot->tail = newItem;
+  wQueue->unprocessedItems++;
+  ownerBusy = !wQueue->waiting;
   
-  LOG(LEVEL_DEBUG, HDR "UNLOCK readWriteLock...%s", pthread_self(),
+  LOG(LEVEL_DEBUG, HDR "Signale new data to consume...%s", pthread_self(),
                    __FUNCTION__);
-  unlockMutex(&self->cmdQueueMutex);
+  signalCond(&wQueue->consumeCond);
+  unlockMutex(&wQueue->mutex);
+
+  // Let an idle worker steal the command if the owner is busy.
+  if (ownerBusy)
+  {
+    _wakeIdleWorker(self, worker);
+  }
 
   return true;
 }
 
 /**
- * Retrieves the next command. This method DOES NOT clear the memory. 
- * After a command is processed the method 'deleteCommand' will remove it from 
- * the queue and free up all associated memory.
+ * Add a given command into the command queue. THe type of command is stored in 
+ * the parameter cmdType. Commands of the same client are always added to the 
+ * same worker queue. SHUTDOWN commands are handed to the workers one by one.
+ *
+ * @param self The command queue where the command has to be added to
+ * @param cmdType The type of the command.
+ * @param svrSock The server socket
+ * @param client The server client
+ * @param dataID An identifier related to the data block. In case of SRX_PROXY
+ *               this identifier contains either 0 or the update ID.
+ * @param dataLength The length of the data attached to this command queue.
+ * @param data The data package attached.
+ *
+ * @return true if the command could be added to the queue.
+ */
+bool queueCommand(CommandQueue* self, CommandQueueType cmdType,
+                  ServerSocket* svrSock, ServerClient* client, uint32_t dataID,
+                  uint32_t dataLength, uint8_t* data)
+{
+  return _queueCommand(self, cmdType, svrSock, client, dataID, dataLength, 
+                       data, NULL);
+}
+
+/**
+ * Add a received PDU into the command queue without copying it. The command 
+ * keeps a reference to the PDU buffer until it is deleted.
+ *
+ * @param self The command queue where the command has to be added to
+ * @param cmdType The type of the command.
+ * @param svrSock The server socket
+ * @param client The server client
+ * @param dataID An identifier related to the data block. In case of SRX_PROXY
+ *               this identifier contains either 0 or the update ID.
+ * @param pduBuffer The PDU buffer.
+ * @param dataLength The length of the data block.
+ * @param data The data block, it MUST be located within the PDU buffer. This
+ *             allows to queue a single request of a batch PDU.
+ *
+ * @return true if the command could be added to the queue.
+ *
+ * @since 0.6.0
+ */
+bool queueCommandPDU(CommandQueue* self, CommandQueueType cmdType,
+                     ServerSocket* svrSock, ServerClient* client, 
+                     uint32_t dataID, PDU_Buffer* pduBuffer,
+                     uint32_t dataLength, uint8_t* data)
+{
+  return _queueCommand(self, cmdType, svrSock, client, dataID, dataLength,
+                       data, pduBuffer);
+}
+
+/**
+ * Retrieves the next command for the given worker. This method DOES NOT clear
+ * the memory. After a command is processed the method 'deleteCommand' will 
+ * remove it from the queue and free up all associated memory.
  * 
  * @param self The command queue
+ * @param worker The worker (0..noWorkers-1)
  * 
- * @return The command queue command.
- *  */
-CommandQueueItem* fetchNextCommand(CommandQueue* self)
+ * @return The command queue command or NULL if the queue was released.
+ */
+CommandQueueItem* fetchNextCommand(CommandQueue* self, int worker)
 {
-  // Changed the mutex management in this method. It will lock the wait mutex 
-  // and wait unti la command is in the queue. once a command is read from the 
-  // queue the wait mutesx will be unlocked and the command will be returned.
-  // This method plays the loc/unlock mutex game with queuecommand
-  
-  CommandQueueItem* item;
+  CommandWorkerQueue* wQueue = &self->workers[worker];
+  CommandWorkerQueue* victim = NULL;
+  CommandQueueItem*   item   = NULL;
+  int idx;
   
   LOG(LEVEL_DEBUG, HDR "Fetch next command from command queue...", 
                    pthread_self());
 
-  if (!self->alive)
+  while (item == NULL)
   {
-    RAISE_ERROR ("Command queue is not alive anymore, fetching commands is not"
-                 " possible!");
-    return NULL;
-  }
- 
-  LOG(LEVEL_DEBUG, HDR "Request access lock to cmd Queue", pthread_self());
-  lockMutex(&self->cmdQueueMutex);
+    if (!self->alive)
+    {
+      LOG(LEVEL_INFO, HDR "Command queue is terminated during fetching "
+                          "command, abort fetching!!!", pthread_self());
+      return NULL;
+    }
 
-  // Wait until a new item is in the queue
-  while (self->alive && self->unprocessedItems == 0)
-  {
-    LOG(LEVEL_DEBUG, HDR "No command in queue, wait until command arrives.", 
-                     pthread_self());
-    // Will be woken up by queueCommand
-    waitCond(&self->consumeCond, &self->cmdQueueMutex, 0);
-    LOG(LEVEL_DEBUG, HDR "Received notification of command arrival.", 
-                     pthread_self());
-  }
-  
-  if (!self->alive)
-  {
-    LOG(LEVEL_INFO, HDR "Command queue is terminated during fetching command, "
-                        "abort fetching!!!", pthread_self());
-    unlockMutex(&self->cmdQueueMutex);
-    return NULL;
-  }
-  
-  // Retrieve the item and set the fetcher to the next one.
-  item = (CommandQueueItem*)self->nextItemNode->data;
-  self->unprocessedItems--;				// SEE also ./util/slist.c:106    
-  if (item == NULL)
-  {
-    RAISE_ERROR("Fatal CommandQueue encountered an empty command.");
-  }
-  if (item->consumed)
-  {
-    RAISE_ERROR("Fetch an already consumed command!!");
+    // First the own queue
+    lockMutex(&wQueue->mutex);
+    item = _takeItem(wQueue, true);
+    unlockMutex(&wQueue->mutex);
+    
+    // Now try to steal from the other workers.
+    for (idx = 1; (item == NULL) && (idx < self->noWorkers); idx++)
+    {
+      victim = &self->workers[(worker + idx) % self->noWorkers];
+      lockMutex(&victim->mutex);
+      item = _takeItem(victim, false);
+      if (item != NULL)
+      {
+        victim->stolen++;
+      }
+      unlockMutex(&victim->mutex);
+      if (item != NULL)
+      {
+        lockMutex(&wQueue->mutex);
+        wQueue->steals++;
+        unlockMutex(&wQueue->mutex);
+      }
+    }
+
+    if (item == NULL)
+    {
+      lockMutex(&wQueue->mutex);
+      // Wait unless a command arrived while looking in the other queues.
+      if (   self->alive && (wQueue->readyHead == NULL) 
+          && (wQueue->shutdown == NULL))
+      {
+        LOG(LEVEL_COMM, HDR "No command in queue, wait until command "
+                            "arrives.", pthread_self());
+        _waitForCommands(wQueue);
+      }
+      unlockMutex(&wQueue->mutex);
+    }
   }
-  // Indicate this item is consumed and can be deleted.
-  item->consumed = true;
-  
-  //move to next item.
-  self->nextItemNode = getNextNodeOfSListNode(self->nextItemNode);
-  // TODO: Check what happens to the memory allocated to store the command!!!
-  // Unlock the write mutex
-  unlockMutex(&self->cmdQueueMutex);  
 
   return item;
 }
 
 /**
- * Remove the queue element that is already consumed from the list and frees 
- * up all allocated memory associated with this element.
+ * Remove the queue element that is already consumed from the queue and frees 
+ * up all allocated memory associated with this element. The next command of 
+ * the same client becomes ready for processing.
  * 
  * @param self The command queue
  * @param item The item. It also will be freed!
  */
 void deleteCommand(CommandQueue* self, CommandQueueItem* item)
 {
+  CommandWorkerQueue* wQueue = NULL;
+  CommandClientSlot*  slot   = NULL;
+
   LOG(LEVEL_DEBUG, HDR "Delete the given command queue item.", pthread_self());
-  lockMutex (&self->cmdQueueMutex);
-  // Free The packet data within the item
-  if(item != NULL) 
+  if (item == NULL)
   {
-    free(item->data);
+    return;
   }
-  self->totalItems--;
-  // The delete from list also frees the item.
-  deleteFromSList(&self->queue, item);
-  unlockMutex(&self->cmdQueueMutex);
+
+  wQueue = &self->workers[item->worker];
+  slot   = item->slot;
+  lockMutex(&wQueue->mutex);
+  wQueue->inProcess--;
+  if (slot != NULL)
+  {
+    slot->busy = false;
+    if (slot->head != NULL)
+    {
+      // The next command of this client can be processed now.
+      _appendReady(wQueue, slot);
+      signalCond(&wQueue->consumeCond);
+    }
+    else
+    {
+      _freeSlot(wQueue, slot);
+    }
+  }
+  unlockMutex(&wQueue->mutex);
+  _freeItem(item);
 }
 
 /**
- * Clears the complete queue.
+ * Clears the complete queue. Commands that are in process are not affected.
  * 
  * @param self The command queue.
  */
 void removeAllCommands(CommandQueue* self)
 {
+  CommandWorkerQueue* wQueue = NULL;
+  CommandClientSlot*  slot   = NULL;
+  CommandClientSlot** link   = NULL;
+  CommandQueueItem*   item   = NULL;
+  int idx, bucket;
+
   LOG(LEVEL_DEBUG, HDR "Remove all commands from the command queue.",
                    pthread_self());
-  SListNode* currNode;
-
-  // No adding or single removing allowed
-  lockMutex(&self->cmdQueueMutex);
 
-  // Release all packets stored in the items
-  FOREACH_SLIST(&self->queue, currNode)
+  for (idx = 0; idx < self->noWorkers; idx++)
   {
-    void* p = ((CommandQueueItem*)getDataOfSListNode(currNode))->data;
-    if (p)
+    wQueue = &self->workers[idx];
+    // No adding or single removing allowed
+    lockMutex(&wQueue->mutex);
+    for (bucket = 0; bucket < CMD_QUEUE_CLIENT_BUCKETS; bucket++)
+    {
+      link = &wQueue->slots[bucket];
+      while (*link != NULL)
+      {
+        slot = *link;
+        while (slot->head != NULL)
+        {
+          item = slot->head;
+          slot->head = item->next;
+          _freeItem(item);
+        }
+        slot->tail = NULL;
+        if (slot->busy)
+        {
+          // Will be freed once the command in process is deleted.
+          link = &slot->hashNext;
+        }
+        else
+        {
+          *link = slot->hashNext;
+          free(slot);
+        }
+      }
+    }
+    while (wQueue->shutdown != NULL)
     {
-      free(p);
+      item = wQueue->shutdown;
+      wQueue->shutdown = item->next;
+      _freeItem(item);
     }
+    wQueue->readyHead        = NULL;
+    wQueue->readyTail        = NULL;
+    wQueue->unprocessedItems = 0;
+    // Grant write access again
+    unlockMutex(&wQueue->mutex); 
   }
-  // Now delete the items.
-  emptySList(&self->queue);
-
-  if (self->nextItemNode != NULL)
-  {
-    RAISE_SYS_ERROR("Queue[0x%08X] Removing of all commands without success!", 
-                    self);
-  };
-  
-  self->totalItems       = self->queue.size;
-  self->unprocessedItems = self->nextItemNode == NULL ? 0 : self->totalItems;
-  
-  // Grant write access again
-  unlockMutex(&self->cmdQueueMutex); 
 }
 
 /**
- * Return the maximum number of commands in the queue
+ * Return the maximum number of commands in the queue. This is the number of 
+ * unprocessed commands and the commands in process.
  * 
  * @param self The command queue
  * 
  * @return the maximum number of items in the queue.
  */
-inline int getTotalQueueSize(CommandQueue* self)
+int getTotalQueueSize(CommandQueue* self)
 {
-  return self->totalItems;
+  int total = 0;
+  int idx;
+
+  for (idx = 0; idx < self->noWorkers; idx++)
+  {
+    lockMutex(&self->workers[idx].mutex);
+    total += self->workers[idx].unprocessedItems 
+             + self->workers[idx].inProcess;
+    unlockMutex(&self->workers[idx].mutex);
+  }
+  return total;
 }
 
 /**
@@ -372,7 +768,42 @@ inline int getTotalQueueSize(CommandQueue* self)
  * 
  * @return the number of unprocessed items in the queue.
  */
-inline int getUnprocessedQueueSize(CommandQueue* self)
+int getUnprocessedQueueSize(CommandQueue* self)
+{
+  int total = 0;
+  int idx;
+
+  for (idx = 0; idx < self->noWorkers; idx++)
+  {
+    lockMutex(&self->workers[idx].mutex);
+    total += self->workers[idx].unprocessedItems;
+    unlockMutex(&self->workers[idx].mutex);
+  }
+  return total;
+}
+
+/**
+ * Retrieve the statistics of the given worker queue.
+ * 
+ * @param self The command queue
+ * @param worker The worker (0..noWorkers-1)
+ * @param info OUT - Receives the statistics.
+ * 
+ * @since 0.6.0
+ */
+void getCommandWorkerInfo(CommandQueue* self, int worker, 
+                          CommandWorkerInfo* info)
 {
-  return self->unprocessedItems;
+  memset(info, 0, sizeof(CommandWorkerInfo));
+  if ((worker >= 0) && (worker < self->noWorkers))
+  {
+    CommandWorkerQueue* wQueue = &self->workers[worker];
+    lockMutex(&wQueue->mutex);
+    info->unprocessed = wQueue->unprocessedItems;
+    info->inProcess   = wQueue->inProcess;
+    info->processed   = wQueue->processed;
+    info->stolen      = wQueue->stolen;
+    info->steals      = wQueue->steals;
+    unlockMutex(&wQueue->mutex);
+  }
 }
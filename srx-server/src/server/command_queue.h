@@ -43,18 +43,33 @@
 #include "shared/srx_packets.h"
 #include "util/mutex.h"
 #include "util/packet.h"
+#include "util/pdu_pool.h"
 #include "util/server_socket.h"
 #include "util/slist.h"
 
+/** The default number of command handler workers, each worker has its own 
+ * queue. */
+#define CMD_QUEUE_DEF_WORKERS  2
+/** The maximum number of command handler workers. */
+#define CMD_QUEUE_MAX_WORKERS  16
+/** Number of hash buckets used to find the client slot of a worker queue. */
+#define CMD_QUEUE_CLIENT_BUCKETS 64
+/** Maximum time in milliseconds an idle worker waits before it looks for work
+ * in the queues of the other workers again. */
+#define CMD_QUEUE_STEAL_WAIT   100
+
 // Specifies the types of commands the queue can handle.
 typedef enum {
   COMMAND_TYPE_SRX_PROXY = 0,
   COMMAND_TYPE_SHUTDOWN  = 1
 } CommandQueueType;
+
+struct _CommandClientSlot;
+
 /** 
  * A Command Queue Item.
  */
-typedef struct {
+typedef struct _CommandQueueItem {
   ServerSocket*    serverSocket; // Server socket that received the packet
   ServerClient*    client;       // Client that sent the packet
   CommandQueueType cmdType;      // The type of the command
@@ -63,34 +78,79 @@ typedef struct {
   bool             consumed;     // Indicated if this element is already fetched
   uint32_t         dataLength;   // Length in Bytes of \c packet
   uint8_t*         data;         // The actual packet (= data)
+  PDU_Buffer*      pduBuffer;    // The PDU buffer data points into or NULL
+                                 // if data is a copy.
+  
+  // Internal
+  struct _CommandQueueItem*  next;   // The next item of the same client
+  struct _CommandClientSlot* slot;   // The client slot (NULL for SHUTDOWN)
+  int                        worker; // The worker queue the item belongs to
 } CommandQueueItem;
 
 /**
- * A single Command Queue.
+ * All commands of one client that are queued for a worker. The commands of a 
+ * client are processed strictly in order, only one at a time. A slot is in
+ * the ready list of its worker queue if it has commands and none of its 
+ * commands is in process.
+ */
+typedef struct _CommandClientSlot {
+  ServerClient*              client;    // The client
+  CommandQueueItem*          head;      // The oldest queued command
+  CommandQueueItem*          tail;      // The newest queued command
+  bool                       busy;      // A command of this client is processed
+  struct _CommandClientSlot* hashNext;  // Next slot in the same hash bucket
+  struct _CommandClientSlot* readyNext; // Next slot in the ready list
+} CommandClientSlot;
+
+/**
+ * The queue of a single command handler worker. 
  */
 typedef struct {
-  SList       queue;          // The list that actually represents the queue.
-  SListNode*  nextItemNode;   // The next node containing a CommandQueueItem to be 
-                              // fetched.
-  Mutex       cmdQueueMutex; // Used to safely access the queue in read and
-                              // write
-  Cond        consumeCond;    // The condition for consuming elements from the 
-                              // command queue
-
-  int         totalItems;     // Total number of Items in the queue, unprocessed 
-                              // and processed.
-  int         unprocessedItems; // THe number of unprocessed Items.
-  bool        alive;          // used to stop fetching commands
+  Mutex              mutex;        // Protects this worker queue
+  Cond               consumeCond;  // Signaled when commands arrive
+  CommandClientSlot* slots[CMD_QUEUE_CLIENT_BUCKETS]; // Slots per client
+  CommandClientSlot* readyHead;    // Clients with commands ready to process
+  CommandClientSlot* readyTail;
+  CommandQueueItem*  shutdown;     // Pending SHUTDOWN commands (never stolen)
+  bool               waiting;      // The worker waits for commands
+  int                unprocessedItems; // Commands waiting for processing
+  int                inProcess;    // Commands fetched but not deleted yet
+  uint64_t           processed;    // Commands fetched from this queue
+  uint64_t           stolen;       // Commands fetched by other workers
+  uint64_t           steals;       // Commands this worker took from others
+} CommandWorkerQueue;
+
+/**
+ * The Command Queue. It consists of one queue per worker. The commands of a 
+ * client are always added to the same worker queue which keeps the order of 
+ * the client's commands. Idle workers steal ready commands from the queues of
+ * busy workers.
+ */
+typedef struct {
+  CommandWorkerQueue workers[CMD_QUEUE_MAX_WORKERS]; // The worker queues
+  int                noWorkers;     // The number of worker queues
+  uint32_t           nextShutdown;  // Worker to receive the next SHUTDOWN
+  bool               alive;         // used to stop fetching commands
 } CommandQueue;
 
+/** Statistics of a single worker queue. */
+typedef struct {
+  int      unprocessed; // Commands waiting for processing
+  int      inProcess;   // Commands currently processed
+  uint64_t processed;   // Commands fetched from this queue
+  uint64_t stolen;      // Commands of this queue fetched by other workers
+  uint64_t steals;      // Commands this worker fetched from other queues
+} CommandWorkerInfo;
+
 /** 
  * Initializes and setup the command queue.
  *
  * @param self Variable that should be initialized.
+ * @param noWorkers The number of worker queues (1..CMD_QUEUE_MAX_WORKERS)
  * 
  * @return true if the queue could be initialized.
  */
-bool initializeCommandQueue(CommandQueue* self);
+bool initializeCommandQueue(CommandQueue* self, int noWorkers);
 
 /**
  * Frees the whole queue.
@@ -101,7 +161,8 @@ void releaseCommandQueue(CommandQueue* self);
 
 /**
  * Add a given command into the command queue. THe type of command is stored in 
- * the parameter cmdType.
+ * the parameter cmdType. Commands of the same client are always added to the 
+ * same worker queue. SHUTDOWN commands are handed to the workers one by one.
  *
  * @param self The command queue where the command has to be added to
  * @param cmdType The type of the command.
@@ -118,16 +179,44 @@ bool queueCommand(CommandQueue* self, CommandQueueType cmdType,
                   ServerSocket* svrSock, ServerClient* client, uint32_t dataID,
                   uint32_t dataLength, uint8_t* data);
 
+/**
+ * Add a received PDU into the command queue without copying it. The command 
+ * keeps a reference to the PDU buffer until it is deleted.
+ *
+ * @param self The command queue where the command has to be added to
+ * @param cmdType The type of the command.
+ * @param svrSock The server socket
+ * @param client The server client
+ * @param dataID An identifier related to the data block. In case of SRX_PROXY
+ *               this identifier contains either 0 or the update ID.
+ * @param pduBuffer The PDU buffer.
+ * @param dataLength The length of the data block.
+ * @param data The data block, it MUST be located within the PDU buffer. This
+ *             allows to queue a single request of a batch PDU.
+ *
+ * @return true if the command could be added to the queue.
+ *
+ * @since 0.6.0
+ */
+bool queueCommandPDU(CommandQueue* self, CommandQueueType cmdType,
+                     ServerSocket* svrSock, ServerClient* client, 
+                     uint32_t dataID, PDU_Buffer* pduBuffer,
+                     uint32_t dataLength, uint8_t* data);
+
 /** 
- * Returns the next item in the queue. The Item is NOT removed from the queue
- * until dequeueCommand is called. 
+ * Returns the next item for the given worker. The item is NOT removed from the
+ * queue until deleteCommand is called, until then no other command of the 
+ * same client will be returned. If the worker's own queue has no command 
+ * ready, a command is taken from the queue of another worker.
  *
  * @note Blocks until a command is available!
  *
  * @param self Queue instance
- * @return The next item
+ * @param worker The worker (0..noWorkers-1)
+ * 
+ * @return The next item or NULL if the queue was released.
  */
-CommandQueueItem* fetchNextCommand(CommandQueue* self);
+CommandQueueItem* fetchNextCommand(CommandQueue* self, int worker);
 
 /**
  * Removes a command from the queue.
@@ -161,5 +250,16 @@ int getTotalQueueSize(CommandQueue* self);
  * @return the number of unprocessed items in the queue.
  */
 int getUnprocessedQueueSize(CommandQueue* self);
-#endif // !__COMMAND_QUEUE_H__
 
+/**
+ * Retrieve the statistics of the given worker queue.
+ * 
+ * @param self The command queue
+ * @param worker The worker (0..noWorkers-1)
+ * @param info OUT - Receives the statistics.
+ * 
+ * @since 0.6.0
+ */
+void getCommandWorkerInfo(CommandQueue* self, int worker, 
+                          CommandWorkerInfo* info);
+#endif // !__COMMAND_QUEUE_H__
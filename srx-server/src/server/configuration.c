@@ -92,6 +92,9 @@
 #include "util/log.h"
 #include "util/prefix.h"
 #include "util/directory.h"
+#include "util/server_socket.h"
+#include "server/command_queue.h"
+#include "server/srx_packet_sender.h"
 
 /** Version 0 (Only ROA information) of the router to cache protocol */
 #define RPKI_2_RTR_6810 0
@@ -117,6 +120,10 @@
 
 #define CFG_PARAM_MODE_NO_SEND_QUEUE 10
 #define CFG_PARAM_MODE_NO_RCV_QUEUE  11
+#define CFG_PARAM_MODE_EPOLL         12
+#define CFG_PARAM_MODE_EPOLL_THREADS 13
+#define CFG_PARAM_MODE_CMD_THREADS   14
+#define CFG_PARAM_MODE_SENDQUEUE_RING 15
 
 #define HDR "([0x%08X] Configuration): "
 
@@ -168,6 +175,13 @@ static const struct option _LONG_OPTIONS[] = {
 
   { "mode.no-sendqueue", no_argument, NULL, CFG_PARAM_MODE_NO_SEND_QUEUE},
   { "mode.no-receivequeue", no_argument, NULL, CFG_PARAM_MODE_NO_RCV_QUEUE},
+  { "mode.epoll", no_argument, NULL, CFG_PARAM_MODE_EPOLL},
+  { "mode.epoll-threads", required_argument, NULL, 
+                                                CFG_PARAM_MODE_EPOLL_THREADS},
+  { "mode.command-threads", required_argument, NULL, 
+                                                CFG_PARAM_MODE_CMD_THREADS},
+  { "mode.sendqueue-ring", required_argument, NULL, 
+                                                CFG_PARAM_MODE_SENDQUEUE_RING},
 
   { NULL, 0, NULL, 0}
 };
@@ -207,6 +221,17 @@ static const char* _USAGE_TEXT =
   "      --mode.no-receivequeue   Disable the receive queue. This queue allows"
   "\n                               to push the processing of packets into\n"
   "                                its own thread. This is experimental.\n"
+  "      --mode.epoll             Use a fixed pool of epoll reactor threads\n"
+  "                               for all proxy connections instead of one\n"
+  "                               thread per connection.\n"
+  "      --mode.epoll-threads <no>\n"
+  "                               Number of epoll reactor threads (def.: 2)\n"
+  "      --mode.command-threads <no>\n"
+  "                               Number of command handler threads, each\n"
+  "                               with its own queue (def.: 2)\n"
+  "      --mode.sendqueue-ring <no>\n"
+  "                               Number of preallocated send queue slots\n"
+  "                               per proxy (def.: 256)\n"
 ;
 
 /**
@@ -237,6 +262,9 @@ void initConfiguration(Configuration* self)
   self->rpki_host = NULL;
   self->rpki_port = -1;
   self->rpki_router_protocol = RPKI_2_RTR_8210;
+  self->rpki_preference = 0;
+  self->rpki_no_caches  = 0;
+  memset(self->rpki_cache_host, 0, sizeof(self->rpki_cache_host));
 
   self->sca_configuration = NULL;
   self->sca_sync_logging  = true;
@@ -245,6 +273,10 @@ void initConfiguration(Configuration* self)
 
   self->mode_no_sendqueue = false;
   self->mode_no_receivequeue = false;
+  self->mode_epoll = false;
+  self->mode_epoll_threads = DEF_SERVER_REACTORS;
+  self->mode_command_threads = CMD_QUEUE_DEF_WORKERS;
+  self->mode_sendqueue_ring = SEND_QUEUE_DEF_RING_SIZE;
 
   self->defaultKeepWindow = SRX_DEFAULT_KEEP_WINDOW; // from srx_defs.h
   memset(&self->mapping_routerID, 0, MAX_PROXY_MAPPINGS);
@@ -272,6 +304,14 @@ void releaseConfiguration(Configuration* self)
     {
       free(self->rpki_host);
     }
+    int idx;
+    for (idx = 0; idx < self->rpki_no_caches; idx++)
+    {
+      if (self->rpki_cache_host[idx] != NULL)
+      {
+        free(self->rpki_cache_host[idx]);
+      }
+    }
     if (self->sca_configuration!= NULL)
     {
       free(self->sca_configuration);
@@ -386,6 +426,10 @@ int parseProgramArgs(Configuration* self, int argc, const char** argv,
         case CFG_PARAM_CREDITS:
         case CFG_PARAM_MODE_NO_SEND_QUEUE:
         case CFG_PARAM_MODE_NO_RCV_QUEUE:
+        case CFG_PARAM_MODE_EPOLL:
+        case CFG_PARAM_MODE_EPOLL_THREADS:
+        case CFG_PARAM_MODE_CMD_THREADS:
+        case CFG_PARAM_MODE_SENDQUEUE_RING:
           optc = -1;
         default:
           printf("Use '-h' for help!\n");
@@ -571,6 +615,34 @@ int parseProgramArgs(Configuration* self, int argc, const char** argv,
         self->mode_no_receivequeue = true;
         printf("Turn off receive queue!\n");
         break;
+      case CFG_PARAM_MODE_EPOLL:
+        self->mode_epoll = true;
+        printf("Turn on epoll reactor mode!\n");
+        break;
+      case CFG_PARAM_MODE_EPOLL_THREADS:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Number of epoll reactor threads missing!");
+          return 0;
+        }
+        self->mode_epoll_threads = strtol(optarg, NULL, 10);
+        break;
+      case CFG_PARAM_MODE_CMD_THREADS:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Number of command handler threads missing!");
+          return 0;
+        }
+        self->mode_command_threads = strtol(optarg, NULL, 10);
+        break;
+      case CFG_PARAM_MODE_SENDQUEUE_RING:
+        if (optarg == NULL)
+        {
+          RAISE_ERROR("Number of send queue slots missing!");
+          return 0;
+        }
+        self->mode_sendqueue_ring = strtol(optarg, NULL, 10);
+        break;
       default:
         RAISE_ERROR("Usage: %s %s", argv[0], _USAGE_TEXT);        
         return 0;
@@ -721,6 +793,50 @@ bool readConfigFile(Configuration* self, const char* filename)
     if ( config_setting_lookup_int(sett, "port", &intVal) == CONFIG_TRUE )
     { self->rpki_port = (int)intVal; }
 
+    if ( config_setting_lookup_int(sett, "preference", &intVal) 
+         == CONFIG_TRUE )
+    { self->rpki_preference = (int)intVal; }
+
+    // Additional validation caches, each one with its own session
+    config_setting_t* caches = config_setting_get_member(sett, "caches");
+    if (caches != NULL)
+    {
+      config_setting_t* cache = NULL;
+      int idx;
+      int noCaches = config_setting_length(caches);
+      if (noCaches > (MAX_RPKI_CACHES - 1))
+      {
+        LOG(LEVEL_ERROR, "Only %d additional rpki.caches are supported!",
+                         MAX_RPKI_CACHES - 1);
+        goto free_config;
+      }
+      for (idx = 0; idx < noCaches; idx++)
+      {
+        cache = config_setting_get_elem(caches, idx);
+        if (   !config_setting_lookup_string(cache, "host", &strtmp)
+            || (config_setting_lookup_int(cache, "port", &intVal) 
+                != CONFIG_TRUE))
+        {
+          LOG(LEVEL_ERROR, "Host and port are required for rpki.caches[%d]!",
+                           idx);
+          goto free_config;
+        }
+        self->rpki_cache_host[idx] = _duplicateString((char*)strtmp, 
+                                           &self->rpki_cache_host[idx],
+                                           "RPKI Validation Cache host name");
+        if (self->rpki_cache_host[idx] == NULL)
+        {
+          goto free_config;
+        }
+        self->rpki_no_caches             = idx + 1;
+        self->rpki_cache_port[idx]       = (int)intVal;
+        self->rpki_cache_preference[idx] = self->rpki_preference;
+        if ( config_setting_lookup_int(cache, "preference", &intVal) 
+             == CONFIG_TRUE )
+        { self->rpki_cache_preference[idx] = (int)intVal; }
+      }
+    }
+
     if ( config_setting_lookup_int(sett, "router_protocol", &intVal) 
           == CONFIG_TRUE )
     { 
@@ -784,6 +900,22 @@ bool readConfigFile(Configuration* self, const char* filename)
     if ( config_setting_lookup_bool(sett, "no-receivequeue", (int*)&boolVal) 
          == CONFIG_TRUE )
     { self->mode_no_receivequeue = (bool)boolVal; }
+
+    if ( config_setting_lookup_bool(sett, "epoll", (int*)&boolVal) 
+         == CONFIG_TRUE )
+    { self->mode_epoll = (bool)boolVal; }
+
+    if ( config_setting_lookup_int(sett, "epoll-threads", &intVal) 
+         == CONFIG_TRUE )
+    { self->mode_epoll_threads = (int)intVal; }
+
+    if ( config_setting_lookup_int(sett, "command-threads", &intVal) 
+         == CONFIG_TRUE )
+    { self->mode_command_threads = (int)intVal; }
+
+    if ( config_setting_lookup_int(sett, "sendqueue-ring", &intVal) 
+         == CONFIG_TRUE )
+    { self->mode_sendqueue_ring = (int)intVal; }
   }
 
   // optional mapping configuration
@@ -837,10 +969,30 @@ bool isCompleteConfiguration(Configuration* self)
                 "Host name of validation cache is not set!");
   ERROR_IF_TRUE(self->rpki_port <= 0,
                 "Port number of validation cache is not set or invalid!");
+  int idx;
+  for (idx = 0; idx < self->rpki_no_caches; idx++)
+  {
+    ERROR_IF_TRUE(self->rpki_cache_port[idx] <= 0,
+                  "Port number of validation cache %s is invalid!",
+                  self->rpki_cache_host[idx]);
+  }
   ERROR_IF_TRUE(self->defaultKeepWindow <= 0,
                 "The keep-window time can not be negative!");
   ERROR_IF_TRUE(self->defaultKeepWindow > 0xFFFF,
                 "The keep-window time more than 65535 seconds!");
+  ERROR_IF_TRUE(self->mode_epoll && (   (self->mode_epoll_threads < 1)
+                                     || (self->mode_epoll_threads 
+                                         > MAX_SERVER_REACTORS)),
+                "Invalid number of epoll reactor threads '%d' (1..%d)!",
+                self->mode_epoll_threads, MAX_SERVER_REACTORS);
+  ERROR_IF_TRUE(   (self->mode_command_threads < 1)
+                || (self->mode_command_threads > CMD_QUEUE_MAX_WORKERS),
+                "Invalid number of command handler threads '%d' (1..%d)!",
+                self->mode_command_threads, CMD_QUEUE_MAX_WORKERS);
+  ERROR_IF_TRUE(   (self->mode_sendqueue_ring < 1)
+                || (self->mode_sendqueue_ring > SEND_QUEUE_MAX_RING_SIZE),
+                "Invalid number of send queue slots '%d' (1..%d)!",
+                self->mode_sendqueue_ring, SEND_QUEUE_MAX_RING_SIZE);
 
   return true;
 }
@@ -54,6 +54,8 @@
 //static char* DEFAULT_CONSOLE_PASSWORD = "SRxSERVER";
 
 #define MAX_PROXY_MAPPINGS 256
+/** The maximum number of RPKI validation caches (rpki and rpki.caches) */
+#define MAX_RPKI_CACHES 8
 
 // CONFIG_INT will be set to int for 64 bit platform during configure. See
 // configuration.ac - used for libconfig
@@ -107,6 +109,17 @@ typedef struct {
   int                   rpki_port;
   /* rpki router server protocol version number */
   int                   rpki_router_protocol;
+  /** The preference of the RPKI/Router protocol server, lower values are 
+   * preferred. */
+  int                   rpki_preference;
+  /** The number of additional RPKI/Router protocol servers (rpki.caches) */
+  int                   rpki_no_caches;
+  /** Host names of the additional RPKI/Router protocol servers */
+  char*                 rpki_cache_host[MAX_RPKI_CACHES - 1];
+  /** Port numbers of the additional RPKI/Router protocol servers */
+  int                   rpki_cache_port[MAX_RPKI_CACHES - 1];
+  /** Preferences of the additional RPKI/Router protocol servers */
+  int                   rpki_cache_preference[MAX_RPKI_CACHES - 1];
 
   // BGPSec path validation
   /** Host name of the BGPSec protocol server */
@@ -124,6 +137,15 @@ typedef struct {
   bool                  mode_no_sendqueue;
   /** If set true, disable the receiver queue. */
   bool                  mode_no_receivequeue;
+  /** If set true, use a fixed pool of epoll reactor threads for all proxy 
+   * connections instead of one thread per connection. */
+  bool                  mode_epoll;
+  /** The number of epoll reactor threads. */
+  int                   mode_epoll_threads;
+  /** The number of command handler threads, each one serves its own queue.*/
+  int                   mode_command_threads;
+  /** The number of preallocated PDU slots of the send queue per proxy.*/
+  int                   mode_sendqueue_ring;
 
   /** The configured default keep window. Zero = deactivate.*/
   int                   defaultKeepWindow;
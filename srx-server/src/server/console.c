@@ -74,6 +74,8 @@
 #include <stdint.h>
 #include <string.h>
 #include <signal.h>
+#include <time.h>
+#include <arpa/inet.h>
 
 #include "server/command_queue.h"
 #include "server/configuration.h"
@@ -92,6 +94,7 @@
 #include "rpki_router_client.h"
 
 #include "util/log.h"
+#include "util/pdu_pool.h"
 #include "util/server_socket.h"
 #include "util/prefix.h"
 #include "util/slist.h"
@@ -143,6 +146,9 @@ static void doNumPrefixes(SRXConsole* self, char* cmd, char* param);
 static void doNumProxies(SRXConsole* self, char* cmd, char* param);
 
 static void doCommandQueue(SRXConsole* self, char* cmd, char* param);
+static void doBGPsecCache(SRXConsole* self, char* cmd, char* param);
+static void doSendQueue(SRXConsole* self, char* cmd, char* param);
+static void doRPKISession(SRXConsole* self, char* cmd, char* param);
 static void doDumpPCache(SRXConsole* self, char* cmd, char* param);
 static void doDumpUCache(SRXConsole* self, char* cmd, char* param);
 
@@ -208,12 +214,23 @@ char* CON_HELP_RESP= "\r\nAvailable commands are:\r\n"
 #endif
                  " num-updates           Display the number of updates "
                                              "stored in update cache!\r\n"
+                 "                       Includes the garbage collector "
+                                             "statistics.\r\n"
                  " num-prefixes          Display the number of prefixes stored"
                  "\r\n                       in the prefix cache!\r\n"
                  " num-proxies           Display the number of proxies "
                                              "attached\r\n"
                  " command-queue         Displays the content of the "
-                                             "command queue.\r\n"
+                                             "command queue\r\n"
+                 "                       per worker thread and the usage of"
+                 "\r\n                       the PDU buffer pool.\r\n"
+                 " bgpsec-cache          Display the statistics of the BGPsec"
+                 "\r\n                       verification result cache.\r\n"
+                 " send-queue            Display the statistics of the send"
+                 "\r\n                       queue.\r\n"
+                 " rpki-session          Display the session, serial, and "
+                 "refresh\r\n                       timing of each RPKI "
+                 "validation cache.\r\n"
 #ifdef SRX_ALL
                  " dump-pcache <file>    Dump the prefix cache into a file with"
                  "\r\n                       the given name.\r\n"
@@ -263,6 +280,9 @@ char* CON_NOPREFIX_CMD = "num-prefixes";
 char* CON_NOPROXY_CMD  = "num-proxies";
 
 char* CON_COMMAND_QUEUE   = "command-queue";
+char* CON_BGPSEC_CACHE_CMD = "bgpsec-cache";
+char* CON_SEND_QUEUE_CMD  = "send-queue";
+char* CON_RPKI_SESSION_CMD = "rpki-session";
 char* CON_DUMP_PCACHE_CMD = "dump-pcache";
 char* CON_DUMP_UCACHE_CMD = "dump-ucache";
 
@@ -817,6 +837,24 @@ static bool doProcessCommand(SRXConsole* self)
   {
     doCommandQueue(self, cmd, param);
   }
+  // statistics of the BGPsec verification cache
+  else if (    (cmdLen == strlen(CON_BGPSEC_CACHE_CMD))
+            && (strncmp(CON_BGPSEC_CACHE_CMD, cmd, cmdLen)==0))
+  {
+    doBGPsecCache(self, cmd, param);
+  }
+  // statistics of the send queue
+  else if (    (cmdLen == strlen(CON_SEND_QUEUE_CMD))
+            && (strncmp(CON_SEND_QUEUE_CMD, cmd, cmdLen)==0))
+  {
+    doSendQueue(self, cmd, param);
+  }
+  // session and refresh timing of the validation cache
+  else if (    (cmdLen == strlen(CON_RPKI_SESSION_CMD))
+            && (strncmp(CON_RPKI_SESSION_CMD, cmd, cmdLen)==0))
+  {
+    doRPKISession(self, cmd, param);
+  }
   // dump the prefix cache
   else if (    (cmdLen == strlen(CON_DUMP_PCACHE_CMD))
             && (strncmp(CON_DUMP_PCACHE_CMD, cmd, cmdLen)==0))
@@ -911,8 +949,7 @@ static void doShowASPA(SRXConsole* self, char* cmd, char* param)
 
   RPKIHandler* handler = self->rpkiHandler;
   ASPA_DBManager* aspaDBManager = handler->aspaDBManager;
-  TrieNode *root = aspaDBManager->tableRoot;
-  printAllLeafNode(root);
+  printAllAspaObjects(aspaDBManager);
 
   sendToConsoleClient(self, out, true);
 }
@@ -1060,13 +1097,22 @@ static void doValCacheReset(SRXConsole* self, char* cmd, char* param)
   {
     message = "Error: \'rpki-reset\' does not take parameters\r\n";
   }
-  else if (sendResetQuery(&self->rpkiHandler->rrclInstance))
-  {
-    message = "Reset query successfully send to RPKI validation cache!\r\n";
-  }
   else
   {
-    message = "ERROR: Could not send reset query to RPKI validation cache!\r\n";
+    // Reset all validation caches, each cache only replaces its own data.
+    int idx;
+    int noSent = 0;
+    for (idx = 0; idx < self->rpkiHandler->noCaches; idx++)
+    {
+      if (sendResetQuery(&self->rpkiHandler->caches[idx].rrclInstance))
+      {
+        noSent++;
+      }
+    }
+    message = (noSent == self->rpkiHandler->noCaches)
+              ? "Reset query successfully send to RPKI validation cache!\r\n"
+              : "ERROR: Could not send reset query to RPKI validation "
+                "cache!\r\n";
   }
   sendToConsoleClient(self, message, true);
 }
@@ -1678,10 +1724,10 @@ static void doShowSRX(SRXConsole* self, char* cmd, char* param)
 
   Configuration* cfg = self->commandHandler->sysConfig;
 
-  char  str[1024];
+  char  str[2048];
   char* strPtr = str;
   // produce a \0 terminated string
-  memset(str,'\0',1024);
+  memset(str,'\0',2048);
 
   strPtr += sprintf(strPtr, "\r\nConfiguration:\r\n==============\r\n");
   strPtr += sprintf(strPtr, "port.....................: %u\r\n", 
@@ -1693,6 +1739,17 @@ static void doShowSRX(SRXConsole* self, char* cmd, char* param)
                             cfg->rpki_host);
   strPtr += sprintf(strPtr, "rpki.port................: %u\r\n", 
                             cfg->rpki_port);
+  strPtr += sprintf(strPtr, "rpki.preference..........: %d\r\n", 
+                            cfg->rpki_preference);
+  int idx;
+  for (idx = 0; idx < cfg->rpki_no_caches; idx++)
+  {
+    strPtr += sprintf(strPtr, "rpki.caches[%d]...........: %s:%u "
+                              "(preference %d)\r\n", idx,
+                              cfg->rpki_cache_host[idx],
+                              cfg->rpki_cache_port[idx],
+                              cfg->rpki_cache_preference[idx]);
+  }
   strPtr += sprintf(strPtr, "bgpsec.srxcryptoapi_cfg..: %s\r\n", 
                             cfg->sca_configuration);
   strPtr += sprintf(strPtr, "console.port.............: %u\r\n",
@@ -1700,6 +1757,8 @@ static void doShowSRX(SRXConsole* self, char* cmd, char* param)
   strPtr += sprintf(strPtr, "mode.no-sendque..........: %s\r\n",
                        cfg->mode_no_sendqueue ? "true  (send queue turned off)"
                                               : "false (send queue turned on)");
+  strPtr += sprintf(strPtr, "mode.sendqueue-ring......: %d\r\n",
+                            cfg->mode_sendqueue_ring);
   strPtr += sprintf(strPtr, "mode.no-receivequeue.....: %s\r\n",
                  cfg->mode_no_receivequeue ? "true  (receive queue turned off)"
                                            : "false (receive queue turned on)");
@@ -1819,10 +1878,21 @@ static void doNumUpdates(SRXConsole* self, char* cmd, char* param)
   // produce a \0 terminated string
   memset(str,'\0',256);
 
-  elements = self->commandHandler->updCache->allItems.size;
+  UC_GCInfo    gcInfo;
+  PrefixCache* pCache = self->commandHandler->rpkiHandler->prefixCache;
+
+  elements = sizeOfUpdateCache(self->commandHandler->updCache);
   sprintf(str, "Update Cache: %u updates stored.\r\n", elements);
   sendToConsoleClient(self, str, false);
-  elements = self->commandHandler->rpkiHandler->prefixCache->updates.size;
+  getUpdateCacheGCInfo(self->commandHandler->updCache, &gcInfo);
+  sprintf(str, "Update Cache: %u updates scheduled for garbage collection.\r\n"
+               "Update Cache: %llu updates (%llu bytes) reclaimed, %u still in "
+               "use.\r\n", gcInfo.scheduled,
+               (unsigned long long)gcInfo.reclaimed,
+               (unsigned long long)gcInfo.reclaimedBytes, gcInfo.retired);
+  sendToConsoleClient(self, str, false);
+  // Removed updates are kept in the list until it is compacted.
+  elements = pCache->updates.size - pCache->removedUpdates;
   sprintf(str, "Prefix Cache: %u update shadows stored.\r\n", elements);
   sendToConsoleClient(self, str, true);
 }
@@ -1879,8 +1949,12 @@ static void doCommandQueue(SRXConsole* self, char* cmd, char* param)
 {
   LOG(LEVEL_DEBUG, CP1 CP2 "%s %s", self->clientSockFd, cmd, param);
   char str[256];
-  int total = getTotalQueueSize(self->commandHandler->queue);
-  int unprocessed = getUnprocessedQueueSize(self->commandHandler->queue);
+  CommandQueue* queue = self->commandHandler->queue;
+  CommandWorkerInfo info;
+  PDU_PoolInfo      poolInfo;
+  int total = getTotalQueueSize(queue);
+  int unprocessed = getUnprocessedQueueSize(queue);
+  int idx;
   // produce a \0 terminated string
   memset(str,'\0',256);
 
@@ -1890,7 +1964,184 @@ static void doCommandQueue(SRXConsole* self, char* cmd, char* param)
                "====================================\r\n"
                "Total commands........: %06u\r\n"
                "Unprocessed commands..: %06u\r\n"
-               "====================================\r\n", total, unprocessed);
+               "====================================\r\n"
+               "Worker  Depth   Active  Processed    Stolen       Steals\r\n",
+               total, unprocessed);
+  sendToConsoleClient(self, str, false);
+  for (idx = 0; idx < queue->noWorkers; idx++)
+  {
+    getCommandWorkerInfo(queue, idx, &info);
+    sprintf(str, "%6d  %06u  %06u  %-11llu  %-11llu  %-11llu\r\n", idx, 
+            info.unprocessed, info.inProcess, 
+            (unsigned long long)info.processed, 
+            (unsigned long long)info.stolen, (unsigned long long)info.steals);
+    sendToConsoleClient(self, str, false);
+  }
+  getPDUPoolInfo(&poolInfo);
+  sprintf(str, "====================================\r\n"
+               "PDU buffers in use....: %06u\r\n"
+               "PDU buffers idle......: %06u\r\n"
+               "PDU buffers allocated.: %llu\r\n"
+               "PDU buffers reused....: %llu\r\n",
+               poolInfo.inUse, poolInfo.idle, 
+               (unsigned long long)poolInfo.mallocs,
+               (unsigned long long)poolInfo.reuses);
+  sendToConsoleClient(self, str, false);
+  sendToConsoleClient(self, "====================================\r\n", true);
+}
+
+/**
+ * Display the statistics of the BGPsec verification result cache.
+ *
+ * @param self Pointer to the console
+ * @param cmd The command
+ * @param param the parameters (empty)
+ *
+ * @since 0.6.0
+ */
+static void doBGPsecCache(SRXConsole* self, char* cmd, char* param)
+{
+  LOG(LEVEL_DEBUG, CP1 CP2 "%s %s", self->clientSockFd, cmd, param);
+  char str[512];
+  BH_VerifyCacheInfo info;
+  u_int64_t lookups = 0;
+
+  getVerifyCacheInfo(self->commandHandler->bgpsecHandler, &info);
+  lookups = info.hits + info.misses;
+  // produce a \0 terminated string
+  memset(str,'\0',512);
+
+  sprintf(str, "BGPsec verification cache:\r\n"
+               "====================================\r\n"
+               "Entries...............: %u / %u\r\n"
+               "Hits..................: %llu (%llu%%)\r\n"
+               "Misses................: %llu\r\n"
+               "Invalidated...........: %llu\r\n"
+               "Evicted...............: %llu\r\n"
+               "Key changes...........: %llu\r\n"
+               "====================================\r\n", 
+               info.entries, info.maxEntries,
+               (unsigned long long)info.hits, 
+               (unsigned long long)((lookups > 0) 
+                                    ? (info.hits * 100) / lookups : 0),
+               (unsigned long long)info.misses,
+               (unsigned long long)info.invalidated, 
+               (unsigned long long)info.evicted,
+               (unsigned long long)info.keyChanges);
+  sendToConsoleClient(self, str, true);
+}
+
+/**
+ * Display the statistics of the send queue.
+ *
+ * @param self The console itself
+ * @param cmd The command
+ * @param param parameters - not used
+ *
+ * @since 0.6.0
+ */
+static void doSendQueue(SRXConsole* self, char* cmd, char* param)
+{
+  LOG(LEVEL_DEBUG, CP1 CP2 "%s %s", self->clientSockFd, cmd, param);
+  char str[768];
+  SendQueueInfo info;
+
+  // produce a \0 terminated string
+  memset(str,'\0',768);
+  if (!getSendQueueInfo(&info))
+  {
+    sprintf(str, "Send queue is turned off!\r\n");
+  }
+  else
+  {
+    sprintf(str, "Send queue:\r\n"
+                 "====================================\r\n"
+                 "Clients...............: %u\r\n"
+                 "Slots per client......: %u\r\n"
+                 "Pending...............: %u\r\n"
+                 "High water mark.......: %u\r\n"
+                 "Queued................: %llu\r\n"
+                 "Sent..................: %llu\r\n"
+                 "Failed................: %llu\r\n"
+                 "Dropped...............: %llu\r\n"
+                 "Writes................: %llu (%llu PDUs/write)\r\n"
+                 "Waits on full ring....: %llu\r\n"
+                 "====================================\r\n",
+                 info.clients, info.ringSize, info.pending, info.highWater,
+                 (unsigned long long)info.queued,
+                 (unsigned long long)info.sent,
+                 (unsigned long long)info.failed,
+                 (unsigned long long)info.dropped,
+                 (unsigned long long)info.writes,
+                 (unsigned long long)((info.writes > 0) 
+                                 ? (info.sent + info.failed) / info.writes : 0),
+                 (unsigned long long)info.fullWaits);
+  }
+  sendToConsoleClient(self, str, true);
+}
+
+/**
+ * Display the session ID, serial, and refresh timing of each RPKI validation
+ * cache as well as the number of reset and serial queries sent.
+ *
+ * @param self The console itself
+ * @param cmd The command
+ * @param param not used
+ *
+ * @since 0.6.0
+ */
+static void doRPKISession(SRXConsole* self, char* cmd, char* param)
+{
+  LOG(LEVEL_DEBUG, CP1 CP2 "%s %s", self->clientSockFd, cmd, param);
+  RPKIHandler*      handler = self->rpkiHandler;
+  RPKICacheSession* session = NULL;
+  RPKIRouterClient* client  = NULL;
+  char   str[4096];
+  char*  strPtr = str;
+  time_t now    = time(NULL);
+  int    idx;
+
+  // produce a \0 terminated string
+  memset(str,'\0',4096);
+  if (handler->noCaches == 0)
+  {
+    strPtr += sprintf(strPtr, "No RPKI validation cache configured!\r\n");
+  }
+  for (idx = 0; idx < handler->noCaches; idx++)
+  {
+    session = &handler->caches[idx];
+    client  = &session->rrclInstance;
+    if (idx > 0)
+    {
+      strPtr += sprintf(strPtr, "\r\n");
+    }
+    strPtr += sprintf(strPtr, "Validation cache.....: 0x%08X %s:%d "
+                              "(preference %d)\r\n",
+                      client->routerClientID, session->rrclParams.serverHost,
+                      session->rrclParams.serverPort, session->preference);
+    strPtr += sprintf(strPtr, "Session ID...........: 0x%04X\r\n",
+                      ntohs(client->sessionID));
+    strPtr += sprintf(strPtr, "Serial...............: %u (%s)\r\n",
+                      ntohl(client->serial),
+                      client->serialValid ? "complete" : "not complete");
+    strPtr += sprintf(strPtr, "Query pending........: %s\r\n",
+                      client->queryPending ? "yes" : "no");
+    strPtr += sprintf(strPtr, "Refresh/Retry/Expire.: %u/%u/%u seconds\r\n",
+                      client->refreshInterval, client->retryInterval,
+                      client->expireInterval);
+    if (client->serialValid)
+    {
+      strPtr += sprintf(strPtr, "Last end of data.....: %ld seconds ago\r\n",
+                        (long)(now - client->lastEndOfData));
+      strPtr += sprintf(strPtr, "Next serial query....: in %ld seconds\r\n",
+                        client->nextRefresh > now
+                        ? (long)(client->nextRefresh - now) : 0L);
+    }
+    strPtr += sprintf(strPtr, "Reset queries sent...: %u\r\n",
+                      client->noResetQueries);
+    strPtr += sprintf(strPtr, "Serial queries sent..: %u\r\n",
+                      client->noSerialQueries);
+  }
   sendToConsoleClient(self, str, true);
 }
 
@@ -1948,7 +2199,7 @@ static void doDumpUCache(SRXConsole* self, char* cmd, char* param)
   char* fileName = (ch == CON_STDOUT) ? "standard out" : param;
   // Get the number of elements from the command queue. Here is is for display
   // only, synchronizing is not necessary
-  elements = self->commandHandler->updCache->allItems.size;
+  elements = sizeOfUpdateCache(self->commandHandler->updCache);
   sprintf(str, "Update Cache has %u items. Start export into %s!\r\n",
           elements, fileName);
   sendToConsoleClient(self, str, true);
@@ -103,6 +103,7 @@
 #include "server/aspa_trie.h"
 #include "util/directory.h"
 #include "util/log.h"
+#include "util/pdu_pool.h"
 
 // Some defines needed for east
 #define SETUP_RPKI_HANDLER         1
@@ -143,7 +144,6 @@ static SKI_CACHE*    skiCache  = NULL;
 static RPKI_QUEUE*   rpkiQueue = NULL;
 
 static AspathCache  aspathCache;
-static TrieNode     aspaTrie;
 static ASPA_DBManager aspaDBManager;
 
 /** The cache that manages keys for bgpsec. 
@@ -313,10 +313,66 @@ static bool setupCaches()
   initializeAspaDBManager(&aspaDBManager, &config);    // ASPA: ASPA object DB
   createAspathCache(&aspathCache, &aspaDBManager); // ASPA: AS path DB 
 
+  // Reclaims updates no client references anymore from all caches.
+  if (!startUpdateCacheGC(&updCache, &prefixCache, &aspathCache))
+  {
+    LOG(LEVEL_WARNING, "Update cache garbage collector not started!");
+  }
+
   LOG(LEVEL_INFO, "- SRx Caches and RPKI Queue created");
   return true;
 }
 
+/**
+ * Connect the RPKI handler to all configured RPKI validation caches, ordered
+ * by their preference. Caches of the same preference keep the configured 
+ * order.
+ *
+ * @return true if all RPKI/Router clients could be created.
+ *
+ * @since 0.6.0
+ */
+static bool addRPKICaches()
+{
+  const char* hosts[MAX_RPKI_CACHES];
+  int         ports[MAX_RPKI_CACHES];
+  int         prefs[MAX_RPKI_CACHES];
+  int         noCaches = 0;
+  int         idx, pos;
+
+  // The rpki settings itself are the first cache followed by rpki.caches
+  for (idx = -1; idx < config.rpki_no_caches; idx++)
+  {
+    const char* host = idx < 0 ? config.rpki_host : config.rpki_cache_host[idx];
+    int         port = idx < 0 ? config.rpki_port : config.rpki_cache_port[idx];
+    int         pref = idx < 0 ? config.rpki_preference 
+                               : config.rpki_cache_preference[idx];
+    for (pos = noCaches; (pos > 0) && (prefs[pos-1] > pref); pos--)
+    {
+      hosts[pos] = hosts[pos-1];
+      ports[pos] = ports[pos-1];
+      prefs[pos] = prefs[pos-1];
+    }
+    hosts[pos] = host;
+    ports[pos] = port;
+    prefs[pos] = pref;
+    noCaches++;
+  }
+
+  for (idx = 0; idx < noCaches; idx++)
+  {
+    if (!addRPKICache(&rpkiHandler, hosts[idx], ports[idx],
+                      config.rpki_router_protocol, prefs[idx]))
+    {
+      RAISE_ERROR("Failed to connect to RPKI validation cache %s:%d.",
+                  hosts[idx], ports[idx]);
+      return false;
+    }
+  }
+
+  return true;
+}
+
 /**
  * Create the handlers for the different validation caches and server
  * connections.
@@ -327,9 +383,9 @@ static bool setupHandlers()
   uint8_t handlers = 0;
   bool retVal = true;
 
-  if (!createRPKIHandler (&rpkiHandler, &prefixCache, &aspathCache, &aspaDBManager,
-                          config.rpki_host, config.rpki_port, 
-                          config.rpki_router_protocol))
+  if (   !createRPKIHandler (&rpkiHandler, &prefixCache, &aspathCache, 
+                             &aspaDBManager)
+      || !addRPKICaches())
   {
     RAISE_ERROR("Failed to create RPKI Handler.");
   }
@@ -388,7 +444,7 @@ static bool setupQueues()
   if (!config.mode_no_sendqueue)
   {
     cont = false;
-    if (createSendQueue())
+    if (createSendQueue(config.mode_sendqueue_ring))
     {
       if (startSendQueue())
       {
@@ -405,7 +461,7 @@ static bool setupQueues()
 
   if (cont)
   {
-    if (!initializeCommandQueue(&cmdQueue))
+    if (!initializeCommandQueue(&cmdQueue, config.mode_command_threads))
     {
       stopSendQueue();
       releaseSendQueue();
@@ -503,6 +559,11 @@ static void doCleanupHandlers(int handler)
  */
 static void doCleanupCaches(int cache)
 {
+  if ((cache & SETUP_UPDATE_CACHE) > 0)
+  {
+    // The garbage collector accesses the other caches.
+    stopUpdateCacheGC(&updCache);
+  }
   if ((cache & SETUP_KEY_CACHE) > 0)
   {
     releaseKeyCache(&keyCache);
@@ -548,6 +609,8 @@ static void doCleanup()
 
   // Caches
   doCleanupCaches(SETUP_ALL_CACHES);
+  // All PDUs are released once the queues and caches are gone.
+  emptyPDUPool();
 
   // Configuration
   releaseConfiguration(&config);
@@ -638,6 +701,18 @@ BGPSecHandler* getBGPsecHandler()
   return &bgpsecHandler;
 }
 
+/**
+ * Return the CommandHandler instance
+ * 
+ * @return the CommandHandler instance
+ * 
+ * @since 0.6.0
+ */
+CommandHandler* getCommandHandler()
+{
+  return &cmdHandler;
+}
+
 /**
  * The main program entry point. This function starts the server program.
  *
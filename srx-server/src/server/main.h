@@ -45,6 +45,7 @@
 #include <srx/srxcryptoapi.h>
 #include "server/ski_cache.h"
 #include "server/bgpsec_handler.h"
+#include "server/command_handler.h"
 
 /**
  * Return the pointer to CAPI
@@ -82,5 +83,14 @@ RPKI_QUEUE* getRPKIQueue();
  */
 BGPSecHandler* getBGPsecHandler();
 
+/**
+ * Return the CommandHandler instance
+ * 
+ * @return the CommandHandler instance
+ * 
+ * @since 0.6.0
+ */
+CommandHandler* getCommandHandler();
+
 #endif /* MAIN_H */
 
@@ -216,6 +216,12 @@ bool initializePrefixCache(PrefixCache* self, UpdateCache* updateCache)
   // Misc.
   self->updateCache = updateCache;
   initSList(&self->updates);
+  self->removedUpdates = 0;
+  self->bulkROAs       = NULL;
+  self->bulkCount      = 0;
+  self->bulkSize       = 0;
+  self->bulkValCacheID = 0;
+  self->bulkActive     = false;
   return true;
 }
 
@@ -303,6 +309,12 @@ void releasePrefixCache(PrefixCache* self)
     }
     releaseSList(&self->updates);
     releaseMutex(&self->updatesMutex);
+
+    if (self->bulkROAs != NULL)
+    {
+      free(self->bulkROAs);
+      self->bulkROAs = NULL;
+    }
   }
 }
 
@@ -354,6 +366,7 @@ void emptyCache(PrefixCache* self)
       }
     }
     emptySList(&self->updates);
+    self->removedUpdates = 0;
     UNLOCK_MUTEX(&self->updatesMutex);
 
     UNLOCK_WRITE_LOCK(&self->asLock);
@@ -849,22 +862,175 @@ static bool _performUpdateValidationKnownPrefix(PrefixCache* self,
 ////////////////////////////////////////////////////////////////////////////////
 
 /**
- * This method will remove the given update from the prefix cache.
+ * Search the given prefix list for the update with the given ID.
+ *
+ * @param list The valid or other list of a prefix.
+ * @param updateID The id of the update.
  *
- * NOT IMPLEMENTED PRIOR VERSION 0.5.1
+ * @return The update or NULL if not found.
+ *
+ * @since 0.6.0
+ */
+static PC_Update* _findUpdateInList(SList* list, SRxUpdateID updateID)
+{
+  SListNode* listNode;
+  PC_Update* pcUpdate;
+
+  FOREACH_SLIST(list, listNode)
+  {
+    pcUpdate = (PC_Update*)listNode->data;
+    if (pcUpdate->updateID == updateID)
+    {
+      return pcUpdate;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Remove and free all updates of the update list that are removed from the
+ * prefix tree. The caller MUST hold the write lock of the tree.
+ *
+ * @param self The prefix cache.
+ *
+ * @since 0.6.0
+ */
+static void _compactUpdates(PrefixCache* self)
+{
+  SList      removed;
+  SListNode* currNode = self->updates.root;
+  SListNode* prevNode = NULL;
+  SListNode* nextNode = NULL;
+
+  initSList(&removed);
+  while (currNode != NULL)
+  {
+    nextNode = currNode->next;
+    if (((PC_Update*)currNode->data)->treeNode == NULL)
+    {
+      free(currNode->data);
+      currNode->data = NULL;
+      moveSListNode(&removed, &self->updates, currNode, prevNode);
+    }
+    else
+    {
+      prevNode = currNode;
+    }
+    currNode = nextNode;
+  }
+  releaseSList(&removed);
+  self->removedUpdates = 0;
+}
+
+/**
+ * This method will remove the given update from the prefix cache. The ROA and
+ * AS references of the update are released. The prefix itself remains in the
+ * tree. The update is only flagged within the update list of the cache, the
+ * list is compacted once more than half of its updates are removed.
  *
  * @param self The prefix cache.
  * @param updateID The id of the update that has to be removed.
  * @param prefix The prefix of the update.
  * @param as The AS number of the update.
  *
- * @return true if the update could be removed.
+ * @return true if the update could be removed, false if the update is not
+ *         stored in the prefix cache (e.g. it was never validated).
  */
 bool removeUpdate(PrefixCache* self, SRxUpdateID* updateID, IPPrefix* prefix,
                   uint32_t as)
 {
-  //TODO: Implement for 0.5.x
-  RAISE_ERROR("IMPLEMENTATION EXPECTED FOR VERSION 0.5.1");
+  prefix_t*        lookupPrefix = ipPrefixToPrefix_t(prefix);
+  patricia_node_t* treeNode = NULL;
+  PC_Prefix*       pcPrefix = NULL;
+  PC_Prefix*       pcParent = NULL;
+  PC_Update*       pcUpdate = NULL;
+  PC_AS*           pcAS     = NULL;
+  PC_ROA*          pcROA    = NULL;
+  SList*           list     = NULL;
+  SListNode*       asListNode;
+  SListNode*       roaListNode;
+  uint8_t          bitlen   = lookupPrefix->bitlen;
+
+  WRITE_LOCK(&self->treeLock);
+
+  treeNode = patricia_search_exact(self->prefixTree, lookupPrefix);
+  free(lookupPrefix);
+  if ((treeNode != NULL) && (treeNode->data != NULL))
+  {
+    pcPrefix = (PC_Prefix*)treeNode->data;
+    list     = &pcPrefix->valid;
+    pcUpdate = _findUpdateInList(list, *updateID);
+    if (pcUpdate == NULL)
+    {
+      list     = &pcPrefix->other;
+      pcUpdate = _findUpdateInList(list, *updateID);
+    }
+  }
+
+  if (pcUpdate == NULL)
+  {
+    UNLOCK_WRITE_LOCK(&self->treeLock);
+    return false;
+  }
+
+  // Release the ROAs covering the update, same walk as the validation.
+  pcParent = (pcUpdate->roa_match > 0) ? pcPrefix : NULL;
+  while ((pcParent != NULL)
+         && (pcParent->state_of_other == SRx_RESULT_INVALID))
+  {
+    FOREACH_SLIST(&pcParent->asn, asListNode)
+    {
+      pcAS = (PC_AS*)asListNode->data;
+      if (pcAS->asn == as)
+      {
+        FOREACH_SLIST(&pcAS->roas, roaListNode)
+        {
+          pcROA = (PC_ROA*)roaListNode->data;
+          if ((pcROA->max_len >= bitlen) && (pcROA->update_count > 0))
+          {
+            pcROA->update_count--;
+          }
+        }
+      }
+    }
+    pcParent = getParent(pcParent->treeNode);
+  }
+
+  deleteFromSList(list, pcUpdate);
+
+  // Release the AS of the prefix
+  pcAS = NULL;
+  FOREACH_SLIST(&pcPrefix->asn, asListNode)
+  {
+    if (((PC_AS*)asListNode->data)->asn == as)
+    {
+      pcAS = (PC_AS*)asListNode->data;
+      break;
+    }
+  }
+  if ((pcAS != NULL) && (pcAS->update_count > 0))
+  {
+    pcAS->update_count--;
+    if ((pcAS->update_count == 0) && (pcAS->roas.size == 0))
+    {
+      LOG(LEVEL_DEBUG, HDR "Remove AS from prefix!", pthread_self());
+      deleteFromSList(&pcPrefix->asn, pcAS);
+      free(pcAS);
+    }
+  }
+
+  // Flag the update, it is freed when the list gets compacted.
+  pcUpdate->treeNode = NULL;
+  self->removedUpdates++;
+  if (   (self->removedUpdates >= PC_COMPACT_MIN)
+      && (self->removedUpdates > (self->updates.size / 2)))
+  {
+    _compactUpdates(self);
+  }
+
+  UNLOCK_WRITE_LOCK(&self->treeLock);
+
   return true;
 }
 
@@ -1063,6 +1229,14 @@ bool addROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
     pcROA->update_count = 0;
     appendDataToSList(&pcAS->roas, pcROA);
   }
+  else if (pcROA->deferred_count > 0)
+  {
+    // Re-announced after a cache reset, the ROA was never removed therefore
+    // the validation state of the covered updates does not change.
+    pcROA->deferred_count--;
+    UNLOCK_WRITE_LOCK(&self->treeLock);
+    return true;
+  }
   else
   {
     pcROA->roa_count++;
@@ -1332,6 +1506,10 @@ static void _delROAwl_validateUpdates(PrefixCache* self, PC_Prefix* pcPrefix,
 static void _delROAwl_moveToOther(UpdateCache* updateCache, PC_Prefix* pcPrefix,
                                   PC_ROA* pcROA, bool suppressNotification);
 
+static void _delROAwl_remove(PrefixCache* self, patricia_node_t* treeNode,
+                             PC_Prefix* pcPrefix, PC_AS* pcAS, PC_ROA* pcROA,
+                             bool suppressNotification);
+
 /**
  * Delete the given ROA white-list entry provided by the specified validation
  * cache with the given session id.
@@ -1479,6 +1657,35 @@ bool delROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
     return false;
   }
 
+  _delROAwl_remove(self, treeNode, pcPrefix, pcAS, pcROA, 
+                   suppressNotification);
+  UNLOCK_WRITE_LOCK(&self->treeLock);
+
+  //printXML(self, "delROAwl");
+
+  return true;
+}
+
+/**
+ * Remove one instance of the given ROA white-list entry and re-validate the 
+ * affected updates. Once the last instance is removed the ROA is freed, as 
+ * well as the AS and the prefix in case they are not used anymore. The tree 
+ * lock must be held in write mode.
+ *
+ * @param self The prefix cache
+ * @param treeNode The tree node of the prefix
+ * @param pcPrefix The prefix the ROA is attached to.
+ * @param pcAS The AS the ROA is attached to.
+ * @param pcROA The ROA to be removed.
+ * @param suppressNotification Allows to suppress calling the update 
+ *                        modification callback function. 
+ *
+ * @since 0.6.0
+ */
+static void _delROAwl_remove(PrefixCache* self, patricia_node_t* treeNode,
+                             PC_Prefix* pcPrefix, PC_AS* pcAS, PC_ROA* pcROA,
+                             bool suppressNotification)
+{
   // Does less specific P' exist?
   PC_Prefix* pcParentPrefix = getParent(treeNode);
   if (pcParentPrefix != NULL)
@@ -1500,6 +1707,11 @@ bool delROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
   {
     RAISE_SYS_ERROR("BUG in code, ROA Count should not go below 0!");
   }
+  if (pcROA->deferred_count > pcROA->roa_count)
+  {
+    // A withdrawal during a reload removes a deferred instance.
+    pcROA->deferred_count = pcROA->roa_count;
+  }
 
   if (pcROA->roa_count == 0)
   {
@@ -1523,11 +1735,6 @@ bool delROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
       }
     }
   }
-  UNLOCK_WRITE_LOCK(&self->treeLock);
-
-  //printXML(self, "delROAwl");
-
-  return true;
 }
 
 /**
@@ -1694,9 +1901,10 @@ static void _delROAwl_moveToOther(UpdateCache* updateCache, PC_Prefix* pcPrefix,
 /**
  * Remove all ROA whitelist entries from the given validation cache with the
  * given session id value. Used for giving up a cache, executing a cache reset
- * or session id change.
- *
- * NOT IMPLEMENTED PRIOR VERSION 0.3
+ * or session id change. In case deferredOnly is set, only the instances that
+ * were flagged by flagAllROAwl and not re-announced since are removed (sweep).
+ * The validation state changes are not send to the clients directly, they are
+ * added to the RPKI queue which is processed with the next End of Data.
  *
  * @param self The prefix cache instance
  * @param session_id the session_id of this session
@@ -1708,17 +1916,61 @@ static void _delROAwl_moveToOther(UpdateCache* updateCache, PC_Prefix* pcPrefix,
 int cleanAllROAwl(PrefixCache* self, uint32_t session_id, uint32_t valCacheID,
                   bool deferredOnly)
 {
-  RAISE_ERROR("NOT IMPLEMENTED PRIOR VERSION 0.3");
-  // Go top down and remove all existing ROA.s
-  return true;
+  patricia_node_t* treeNode    = NULL;
+  PC_Prefix*       pcPrefix    = NULL;
+  PC_AS*           pcAS        = NULL;
+  PC_ROA*          pcROA       = NULL;
+  SListNode*       asListNode  = NULL;
+  SListNode*       roaListNode = NULL;
+  SListNode*       nextNode    = NULL;
+  uint16_t         count       = 0;
+  int              removed     = 0;
+
+  WRITE_LOCK(&self->treeLock);
+  PATRICIA_WALK(self->prefixTree->head, treeNode)
+  {
+    pcPrefix   = (PC_Prefix*)treeNode->data;
+    asListNode = (pcPrefix != NULL) ? pcPrefix->asn.root : NULL;
+    while (asListNode != NULL)
+    {
+      // The removal of the last ROA might free the AS and the prefix, in this
+      // case the AS was the last one in the list.
+      nextNode    = asListNode->next;
+      pcAS        = (PC_AS*)asListNode->data;
+      roaListNode = pcAS->roas.root;
+      asListNode  = nextNode;
+      while (roaListNode != NULL)
+      {
+        nextNode    = roaListNode->next;
+        pcROA       = (PC_ROA*)roaListNode->data;
+        roaListNode = nextNode;
+        if (pcROA->valCacheID == valCacheID)
+        {
+          count = deferredOnly ? pcROA->deferred_count : pcROA->roa_count;
+          removed += count;
+          while (count-- > 0)
+          {
+            _delROAwl_remove(self, treeNode, pcPrefix, pcAS, pcROA, 
+                             PC_DO_SUPPRESS);
+          }
+        }
+      }
+    }
+  } PATRICIA_WALK_END;
+  UNLOCK_WRITE_LOCK(&self->treeLock);
+
+  LOG(LEVEL_DEBUG, HDR "Removed %d ROA white-list entries of validation cache "
+                   "0x%08X", pthread_self(), removed, valCacheID);
+
+  return removed;
 }
 
 /**
  * Flag all ROA whitelist entries of the given validation cache with the given
  * session id value. This is used in case a session id value switch occurred and
- * the state of ROA white-list entries gets rebuild.
- *
- * NOT IMPLEMENTED PRIOR VERSION 0.4
+ * the state of ROA white-list entries gets rebuild. The flagged entries stay in
+ * place and keep the validation state of the updates until they are either
+ * re-announced (see addROAwl) or swept using cleanAllROAwl.
  *
  * @param self The validation cache
  * @param sessionID the session id whose values have to be flagged.
@@ -1728,11 +1980,733 @@ int cleanAllROAwl(PrefixCache* self, uint32_t session_id, uint32_t valCacheID,
  */
 int flagAllROAwl(PrefixCache* self, uint32_t sessionID, uint32_t valCacheID)
 {
-  RAISE_ERROR("NOT IMPLEMENTED PRIOR VERSION 0.4");
-  // Flag it by setting the defferedCount to ROA-count.
+  patricia_node_t* treeNode    = NULL;
+  PC_Prefix*       pcPrefix    = NULL;
+  PC_AS*           pcAS        = NULL;
+  PC_ROA*          pcROA       = NULL;
+  SListNode*       asListNode  = NULL;
+  SListNode*       roaListNode = NULL;
+  int              flagged     = 0;
+
+  WRITE_LOCK(&self->treeLock);
+  PATRICIA_WALK(self->prefixTree->head, treeNode)
+  {
+    pcPrefix = (PC_Prefix*)treeNode->data;
+    if (pcPrefix != NULL)
+    {
+      FOREACH_SLIST(&pcPrefix->asn, asListNode)
+      {
+        pcAS = (PC_AS*)asListNode->data;
+        FOREACH_SLIST(&pcAS->roas, roaListNode)
+        {
+          pcROA = (PC_ROA*)roaListNode->data;
+          if (pcROA->valCacheID == valCacheID)
+          {
+            // Flag it by setting the deferred count to ROA-count.
+            pcROA->deferred_count = pcROA->roa_count;
+            flagged += pcROA->roa_count;
+          }
+        }
+      }
+    }
+  } PATRICIA_WALK_END;
+  UNLOCK_WRITE_LOCK(&self->treeLock);
+
+  LOG(LEVEL_DEBUG, HDR "Flagged %d ROA white-list entries of validation cache "
+                   "0x%08X", pthread_self(), flagged, valCacheID);
+
+  return flagged;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// BULK ROA LOAD
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Start a bulk load of all ROA white-list entries of the given validation
+ * cache. Until finishBulkROALoad is called the entries are collected using
+ * bulkAddROAwl without touching the prefix tree. A bulk load in progress of
+ * the same validation cache is restarted.
+ *
+ * @param self The prefix cache
+ * @param valCacheID The validation cache ID.
+ *
+ * @return false if the bulk load buffer could not be allocated or another
+ *         validation cache performs a bulk load.
+ *
+ * @since 0.6.0
+ */
+bool startBulkROALoad(PrefixCache* self, uint32_t valCacheID)
+{
+  if (self->bulkActive && (self->bulkValCacheID != valCacheID))
+  {
+    // Only one bulk load at a time, the caller falls back to flagging.
+    LOG(LEVEL_INFO, HDR "Bulk load of validation cache 0x%08X in progress, "
+                    "validation cache 0x%08X can not be bulk loaded!",
+                    pthread_self(), self->bulkValCacheID, valCacheID);
+    return false;
+  }
+  if (self->bulkROAs == NULL)
+  {
+    self->bulkROAs = malloc(sizeof(PC_BulkROA) * PC_BULK_INIT_SIZE);
+    if (self->bulkROAs == NULL)
+    {
+      RAISE_SYS_ERROR(HDR "Could not allocate the bulk load buffer!",
+                      pthread_self());
+      self->bulkActive = false;
+      return false;
+    }
+    self->bulkSize = PC_BULK_INIT_SIZE;
+  }
+  if (self->bulkActive)
+  {
+    LOG(LEVEL_INFO, HDR "Restart bulk load, %u ROA white-list entries of "
+                    "validation cache 0x%08X discarded!", pthread_self(),
+                    self->bulkCount, self->bulkValCacheID);
+  }
+  self->bulkCount      = 0;
+  self->bulkValCacheID = valCacheID;
+  self->bulkActive     = true;
+
+  return true;
+}
+
+/**
+ * Free the bulk load buffer and end the bulk load.
+ *
+ * @param self The prefix cache
+ *
+ * @since 0.6.0
+ */
+static void _bulk_release(PrefixCache* self)
+{
+  free(self->bulkROAs);
+  self->bulkROAs   = NULL;
+  self->bulkCount  = 0;
+  self->bulkSize   = 0;
+  self->bulkActive = false;
+}
+
+/**
+ * Discard the bulk load of the given validation cache if in progress. This is
+ * used if the validation cache is dropped before its End of Data is received.
+ *
+ * @param self The prefix cache
+ * @param valCacheID The validation cache ID.
+ *
+ * @return the number of collected ROA white-list entries discarded or -1 if 
+ *         the validation cache has no bulk load in progress.
+ *
+ * @since 0.6.0
+ */
+int cancelBulkROALoad(PrefixCache* self, uint32_t valCacheID)
+{
+  int discarded = -1;
+  if (self->bulkActive && (self->bulkValCacheID == valCacheID))
+  {
+    discarded = (int)self->bulkCount;
+    _bulk_release(self);
+  }
+  return discarded;
+}
+
+/**
+ * Give up the bulk load and hand all collected entries to addROAwl after all
+ * ROA white-list entries of the validation cache are flagged. The flagged
+ * entries that are not re-announced have to be swept using cleanAllROAwl.
+ *
+ * @param self The prefix cache
+ *
+ * @since 0.6.0
+ */
+static void _bulk_replay(PrefixCache* self)
+{
+  PC_BulkROA* bulkROA = NULL;
+  uint32_t    idx;
+  uint16_t    count;
+
+  LOG(LEVEL_WARNING, "Bulk load of validation cache 0x%08X failed, add the "
+                     "%u collected ROA white-list entries one by one!",
+                     self->bulkValCacheID, self->bulkCount);
+  flagAllROAwl(self, 0, self->bulkValCacheID);
+  for (idx = 0; idx < self->bulkCount; idx++)
+  {
+    bulkROA = &self->bulkROAs[idx];
+    for (count = bulkROA->count; count > 0; count--)
+    {
+      addROAwl(self, bulkROA->as, &bulkROA->prefix, bulkROA->maxLen, 0,
+               self->bulkValCacheID, PC_DO_SUPPRESS);
+    }
+  }
+  _bulk_release(self);
+}
+
+/**
+ * Add the given ROA white-list entry to the bulk load in progress.
+ * ROA white-list entries for ASNs specified in rfc5398 are ignored!
+ * In case the buffer can not grow, the bulk load is given up (see 
+ * _bulk_replay).
+ *
+ * @param self The prefix cache
+ * @param originAS The origin AS of the ROA white-list entry.
+ * @param prefix The prefix of the ROA white-list entry to be added
+ * @param maxLen The max length of the ROA white-list entry
+ *
+ * @return true if the entry was added to the bulk load.
+ *
+ * @since 0.6.0
+ */
+bool bulkAddROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
+                  uint8_t maxLen)
+{
+  if (!self->bulkActive)
+  {
+    RAISE_ERROR("No bulk load in progress!");
+    return false;
+  }
+
+  if (belongsToRfc5398(originAS))
+  {
+    LOG(LEVEL_WARNING, "Ignore white-list entry for reserved ASV %u from "
+            "validation cache %u!", originAS, self->bulkValCacheID);
+    return false;
+  }
+
+  if (self->bulkCount == self->bulkSize)
+  {
+    PC_BulkROA* bulkROAs = realloc(self->bulkROAs,
+                                   sizeof(PC_BulkROA) * self->bulkSize * 2);
+    if (bulkROAs == NULL)
+    {
+      RAISE_SYS_ERROR(HDR "Could not grow the bulk load buffer!",
+                      pthread_self());
+      _bulk_replay(self);
+      addROAwl(self, originAS, prefix, maxLen, 0, self->bulkValCacheID,
+               PC_DO_SUPPRESS);
+      return false;
+    }
+    self->bulkROAs  = bulkROAs;
+    self->bulkSize *= 2;
+  }
+
+  PC_BulkROA* bulkROA = &self->bulkROAs[self->bulkCount++];
+  bulkROA->prefix = *prefix;
+  bulkROA->as     = originAS;
+  bulkROA->maxLen = maxLen;
+  bulkROA->count  = 1;
+
+  return true;
+}
+
+/**
+ * Sort order of the bulk load entries: IP version, address, prefix length,
+ * origin AS and max length. Less specific prefixes are sorted in front of 
+ * more specific prefixes with the same address.
+ *
+ * @param a The first PC_BulkROA
+ * @param b The second PC_BulkROA
+ *
+ * @return <0, 0, >0 as requested by qsort.
+ *
+ * @since 0.6.0
+ */
+static int _bulk_compare(const void* a, const void* b)
+{
+  const PC_BulkROA* roa1 = (const PC_BulkROA*)a;
+  const PC_BulkROA* roa2 = (const PC_BulkROA*)b;
+  int cmp;
+
+  if (roa1->prefix.ip.version != roa2->prefix.ip.version)
+  {
+    return roa1->prefix.ip.version < roa2->prefix.ip.version ? -1 : 1;
+  }
+  cmp = memcmp(&roa1->prefix.ip.addr, &roa2->prefix.ip.addr,
+               roa1->prefix.ip.version == 4 ? sizeof(IPv4Address)
+                                            : sizeof(IPv6Address));
+  if (cmp != 0)
+  {
+    return cmp;
+  }
+  if (roa1->prefix.length != roa2->prefix.length)
+  {
+    return roa1->prefix.length < roa2->prefix.length ? -1 : 1;
+  }
+  if (roa1->as != roa2->as)
+  {
+    return roa1->as < roa2->as ? -1 : 1;
+  }
+  if (roa1->maxLen != roa2->maxLen)
+  {
+    return roa1->maxLen < roa2->maxLen ? -1 : 1;
+  }
+  return 0;
+}
+
+/**
+ * Return the prefix cache prefix of the given prefix within the given tree.
+ * In case the prefix does not exist it will be created. The ROA coverage and
+ * state of other of a created prefix are calculated once the tree is complete.
+ *
+ * @param tree The prefix tree
+ * @param lookupPrefix The patricia prefix, it is consumed by this function.
+ *
+ * @return The prefix cache prefix or NULL in case of an error.
+ *
+ * @since 0.6.0
+ */
+static PC_Prefix* _bulk_getPrefix(patricia_tree_t* tree, prefix_t* lookupPrefix)
+{
+  patricia_node_t* treeNode = NULL;
+  PC_Prefix*       pcPrefix = NULL;
+
+  if (lookupPrefix == NULL)
+  {
+    return NULL;
+  }
+
+  treeNode = patricia_lookup(tree, lookupPrefix);
+  if (lookupPrefix->ref_count == 0)
+  { // patricia prefix already exists in tree, free unused helper
+    free(lookupPrefix);
+  }
+  if (treeNode == NULL)
+  {
+    RAISE_ERROR("Failed to append a prefix to the prefix tree");
+    return NULL;
+  }
+
+  pcPrefix = (PC_Prefix*)treeNode->data;
+  if (pcPrefix == NULL)
+  {
+    pcPrefix = malloc(sizeof(PC_Prefix));
+    if (pcPrefix != NULL)
+    {
+      pcPrefix->treeNode       = treeNode;
+      pcPrefix->roa_coverage   = 0;
+      pcPrefix->state_of_other = SRx_RESULT_NOTFOUND;
+      initSList(&pcPrefix->asn);
+      initSList(&pcPrefix->other);
+      initSList(&pcPrefix->valid);
+      treeNode->data = pcPrefix;
+    }
+  }
+
+  return pcPrefix;
+}
+
+/**
+ * Add the given ROA to the given tree without any validation.
+ *
+ * @param tree The prefix tree
+ * @param lookupPrefix The patricia prefix, it is consumed by this function.
+ * @param as The origin AS of the ROA
+ * @param maxLen The max length of the ROA
+ * @param valCacheID The validation cache ID
+ * @param roaCount The number of instances to add
+ * @param deferredCount The number of instances flagged (see flagAllROAwl)
+ *
+ * @return false in case of an error (memory)
+ *
+ * @since 0.6.0
+ */
+static bool _bulk_addROA(patricia_tree_t* tree, prefix_t* lookupPrefix,
+                         uint32_t as, uint8_t maxLen, uint32_t valCacheID,
+                         uint16_t roaCount, uint16_t deferredCount)
+{
+  PC_Prefix* pcPrefix = _bulk_getPrefix(tree, lookupPrefix);
+  PC_AS*     pcAS     = pcPrefix != NULL ? getASFromPrefix(pcPrefix, as) : NULL;
+  PC_ROA*    pcROA    = NULL;
+  SListNode* roaListNode;
+
+  if (pcAS == NULL)
+  {
+    return false;
+  }
+
+  FOREACH_SLIST(&pcAS->roas, roaListNode)
+  {
+    pcROA = (PC_ROA*)roaListNode->data;
+    if ((pcROA->valCacheID == valCacheID) && (pcROA->max_len == maxLen))
+    {
+      break;
+    }
+    pcROA = NULL;
+  }
+
+  if (pcROA == NULL)
+  {
+    pcROA = malloc(sizeof(PC_ROA));
+    if (pcROA == NULL)
+    {
+      return false;
+    }
+    pcROA->valCacheID     = valCacheID;
+    pcROA->as             = as;
+    pcROA->max_len        = maxLen;
+    pcROA->roa_count      = 0;
+    pcROA->deferred_count = 0;
+    pcROA->update_count   = 0;
+    if (!appendDataToSList(&pcAS->roas, pcROA))
+    {
+      free(pcROA);
+      return false;
+    }
+  }
+  pcROA->roa_count      += roaCount;
+  pcROA->deferred_count += deferredCount;
+
   return true;
 }
 
+/**
+ * Create a copy of the given patricia prefix that can be used for a lookup.
+ *
+ * @param from The patricia prefix to be copied
+ *
+ * @return The copy (ref_count = 0) or NULL.
+ *
+ * @since 0.6.0
+ */
+static prefix_t* _bulk_copyPrefix(prefix_t* from)
+{
+  prefix_t* to = (prefix_t*)malloc(sizeof(prefix_t));
+  if (to != NULL)
+  {
+    memcpy(to, from, sizeof(prefix_t));
+    to->ref_count = 0; // Will be 'Ref'ed by lookup
+  }
+  return to;
+}
+
+/**
+ * Free all prefix cache prefixes, ASes and ROAs of the given tree and the tree
+ * itself. The updates are not freed.
+ *
+ * @param tree The prefix tree to be released.
+ *
+ * @since 0.6.0
+ */
+static void _bulk_releaseTree(patricia_tree_t* tree)
+{
+  patricia_node_t* treeNode = NULL;
+
+  PATRICIA_WALK(tree->head, treeNode)
+  {
+    if (treeNode->data != NULL)
+    {
+      releasePrefix((PC_Prefix*)treeNode->data);
+      treeNode->data = NULL;
+    }
+  } PATRICIA_WALK_END;
+  Destroy_Patricia(tree, NULL);
+}
+
+/**
+ * Calculate the ROA coverage and the state of other of all prefixes of the
+ * given tree. The tree walk visits each parent prior to its children, 
+ * therefore the state of other of the parent is already final.
+ *
+ * @param tree The prefix tree
+ *
+ * @since 0.6.0
+ */
+static void _bulk_calcCoverage(patricia_tree_t* tree)
+{
+  patricia_node_t* treeNode = NULL;
+  PC_Prefix*       pcPrefix = NULL;
+  PC_Prefix*       pcParent = NULL;
+  PC_AS*           pcAS     = NULL;
+  PC_ROA*          pcROA    = NULL;
+  SListNode*       asListNode;
+  SListNode*       roaListNode;
+
+  PATRICIA_WALK(tree->head, treeNode)
+  {
+    pcPrefix = (PC_Prefix*)treeNode->data;
+    if (pcPrefix != NULL)
+    {
+      pcParent = getParent(treeNode);
+      pcPrefix->state_of_other = pcParent != NULL ? pcParent->state_of_other
+                                                  : SRx_RESULT_NOTFOUND;
+      pcPrefix->roa_coverage   = 0;
+      // Walk up as long as ROAs exist for this or less specific prefixes.
+      pcParent = pcPrefix;
+      while (pcParent != NULL)
+      {
+        FOREACH_SLIST(&pcParent->asn, asListNode)
+        {
+          pcAS = (PC_AS*)asListNode->data;
+          FOREACH_SLIST(&pcAS->roas, roaListNode)
+          {
+            pcROA = (PC_ROA*)roaListNode->data;
+            pcPrefix->state_of_other = SRx_RESULT_INVALID;
+            if (pcROA->max_len >= treeNode->prefix->bitlen)
+            {
+              pcPrefix->roa_coverage += pcROA->roa_count;
+            }
+          }
+        }
+        pcParent = getParent(pcParent->treeNode);
+        if ((pcParent != NULL)
+            && (pcParent->state_of_other == SRx_RESULT_NOTFOUND))
+        {
+          // No ROA for the parent or any less specific prefix.
+          break;
+        }
+      }
+    }
+  } PATRICIA_WALK_END;
+}
+
+/**
+ * Move the given update into the given (complete) tree and revalidate it. 
+ * The validation change is added to the RPKI queue.
+ *
+ * @param self The prefix cache
+ * @param tree The new prefix tree
+ * @param pcUpdate The update to be moved.
+ *
+ * @return false in case of an error (memory)
+ *
+ * @since 0.6.0
+ */
+static bool _bulk_moveUpdate(PrefixCache* self, patricia_tree_t* tree,
+                             PC_Update* pcUpdate)
+{
+  PC_Prefix* pcPrefix  = (PC_Prefix*)pcUpdate->treeNode->data;
+  PC_Prefix* pcParent  = NULL;
+  PC_AS*     pcAS      = NULL;
+  PC_ROA*    pcROA     = NULL;
+  SListNode* asListNode;
+  SListNode* roaListNode;
+  uint8_t    bitlen    = pcUpdate->treeNode->prefix->bitlen;
+  SRxValidationResultVal oldResult = pcUpdate->roa_match > 0
+                                     ? SRx_RESULT_VALID
+                                     : pcPrefix->state_of_other;
+  SRxValidationResultVal newResult;
+  patricia_node_t* treeNode = patricia_search_exact(tree,
+                                                   pcUpdate->treeNode->prefix);
+
+  if (treeNode == NULL)
+  {
+    return false;
+  }
+  // The prefix was added to the tree prior the coverage calculation.
+  pcUpdate->treeNode = treeNode;
+  pcPrefix = (PC_Prefix*)treeNode->data;
+  pcAS     = getASFromPrefix(pcPrefix, pcUpdate->as);
+  if (pcAS == NULL)
+  {
+    return false;
+  }
+  pcAS->update_count++;
+
+  pcUpdate->roa_match = 0;
+  pcParent = pcPrefix;
+  while ((pcParent != NULL)
+         && (pcParent->state_of_other == SRx_RESULT_INVALID))
+  {
+    FOREACH_SLIST(&pcParent->asn, asListNode)
+    {
+      pcAS = (PC_AS*)asListNode->data;
+      if (pcAS->asn == pcUpdate->as)
+      {
+        FOREACH_SLIST(&pcAS->roas, roaListNode)
+        {
+          pcROA = (PC_ROA*)roaListNode->data;
+          if (pcROA->max_len >= bitlen)
+          {
+            pcUpdate->roa_match += pcROA->roa_count;
+            pcROA->update_count++;
+          }
+        }
+      }
+    }
+    pcParent = getParent(pcParent->treeNode);
+  }
+
+  if (pcUpdate->roa_match > 0)
+  {
+    newResult = SRx_RESULT_VALID;
+    if (!appendDataToSList(&pcPrefix->valid, pcUpdate))
+    {
+      return false;
+    }
+  }
+  else
+  {
+    newResult = pcPrefix->state_of_other;
+    if (!appendDataToSList(&pcPrefix->other, pcUpdate))
+    {
+      return false;
+    }
+  }
+
+  if (newResult != oldResult)
+  {
+    notifyUpdateCacheForROAChange(self->updateCache, &pcUpdate->updateID,
+                                  newResult, PC_DO_SUPPRESS);
+  }
+
+  return true;
+}
+
+/**
+ * Finish the bulk load in progress. A new prefix tree is build from the
+ * sorted entries, the ROA white-list entries of all other validation caches
+ * are copied over. Then the ROA coverage of all prefixes is calculated in one
+ * pass, the updates are moved into the new tree and revalidated once and the
+ * new tree replaces the current one. Only the tree lock is held while the 
+ * current tree is accessed.
+ *
+ * @param self The prefix cache
+ *
+ * @return the number of ROA white-list entries loaded or -1 if no bulk load
+ *         was in progress.
+ *
+ * @since 0.6.0
+ */
+int finishBulkROALoad(PrefixCache* self)
+{
+  patricia_tree_t* newTree     = NULL;
+  patricia_tree_t* oldTree     = NULL;
+  patricia_node_t* treeNode    = NULL;
+  PC_Prefix*       pcPrefix    = NULL;
+  PC_AS*           pcAS        = NULL;
+  PC_ROA*          pcROA       = NULL;
+  PC_BulkROA*      bulkROA     = NULL;
+  SListNode*       asListNode  = NULL;
+  SListNode*       roaListNode = NULL;
+  SListNode*       listNode    = NULL;
+  uint32_t         valCacheID  = self->bulkValCacheID;
+  uint32_t         noEntries   = 0;
+  uint32_t         idx;
+  int              loaded      = 0;
+  bool             ok          = true;
+
+  if (!self->bulkActive)
+  {
+    return -1;
+  }
+
+  // Sort the entries and merge identical ones, this does not need any lock.
+  qsort(self->bulkROAs, self->bulkCount, sizeof(PC_BulkROA), _bulk_compare);
+  for (idx = 0; idx < self->bulkCount; idx++)
+  {
+    bulkROA = &self->bulkROAs[idx];
+    loaded += bulkROA->count;
+    if (   (noEntries > 0)
+        && (_bulk_compare(&self->bulkROAs[noEntries-1], bulkROA) == 0))
+    {
+      self->bulkROAs[noEntries-1].count += bulkROA->count;
+    }
+    else
+    {
+      self->bulkROAs[noEntries++] = *bulkROA;
+    }
+  }
+  self->bulkCount = noEntries;
+
+  // Build the new tree offline
+  newTree = New_Patricia(PATRICIA_MAXBITS); // 128 = IPv6
+  if (newTree == NULL)
+  {
+    RAISE_ERROR("Failed to initialize the prefix tree");
+    ok = false;
+  }
+  for (idx = 0; ok && (idx < self->bulkCount); idx++)
+  {
+    bulkROA = &self->bulkROAs[idx];
+    ok = _bulk_addROA(newTree, ipPrefixToPrefix_t(&bulkROA->prefix),
+                      bulkROA->as, bulkROA->maxLen, valCacheID, bulkROA->count,
+                      0);
+  }
+
+  WRITE_LOCK(&self->treeLock);
+  // Copy the ROA white-list entries of all other validation caches.
+  if (ok)
+  {
+    PATRICIA_WALK(self->prefixTree->head, treeNode)
+    {
+      pcPrefix = (PC_Prefix*)treeNode->data;
+      if (ok && (pcPrefix != NULL))
+      {
+        FOREACH_SLIST(&pcPrefix->asn, asListNode)
+        {
+          pcAS = (PC_AS*)asListNode->data;
+          FOREACH_SLIST(&pcAS->roas, roaListNode)
+          {
+            pcROA = (PC_ROA*)roaListNode->data;
+            if (ok && (pcROA->valCacheID != valCacheID))
+            {
+              ok = _bulk_addROA(newTree, _bulk_copyPrefix(treeNode->prefix),
+                                pcROA->as, pcROA->max_len, pcROA->valCacheID,
+                                pcROA->roa_count, pcROA->deferred_count);
+            }
+          }
+        }
+      }
+    } PATRICIA_WALK_END;
+  }
+  // Add the prefixes of all updates
+  if (ok)
+  {
+    FOREACH_SLIST(&self->updates, listNode)
+    {
+      PC_Update* pcUpdate = (PC_Update*)listNode->data;
+      if (ok && (pcUpdate->treeNode != NULL))
+      {
+        ok = _bulk_getPrefix(newTree,
+                             _bulk_copyPrefix(pcUpdate->treeNode->prefix))
+             != NULL;
+      }
+    }
+  }
+
+  if (!ok)
+  {
+    UNLOCK_WRITE_LOCK(&self->treeLock);
+    RAISE_SYS_ERROR(HDR "Could not build the prefix tree for the bulk load!",
+                    pthread_self());
+    if (newTree != NULL)
+    {
+      _bulk_releaseTree(newTree);
+    }
+    _bulk_replay(self);
+    cleanAllROAwl(self, 0, valCacheID, true);
+    return loaded;
+  }
+
+  _bulk_calcCoverage(newTree);
+  // Move all updates into the new tree, the tree is complete at this point,
+  // no further memory is required except for the update lists.
+  FOREACH_SLIST(&self->updates, listNode)
+  {
+    if (((PC_Update*)listNode->data)->treeNode == NULL)
+    {
+      // Removed update
+      continue;
+    }
+    if (!_bulk_moveUpdate(self, newTree, (PC_Update*)listNode->data))
+    {
+      RAISE_SYS_ERROR(HDR "Could not move update [0x%08X] into the new prefix "
+                      "tree!", pthread_self(),
+                      ((PC_Update*)listNode->data)->updateID);
+    }
+  }
+  oldTree = self->prefixTree;
+  self->prefixTree = newTree;
+  UNLOCK_WRITE_LOCK(&self->treeLock);
+
+  _bulk_releaseTree(oldTree);
+  _bulk_release(self);
+
+  LOG(LEVEL_DEBUG, HDR "Bulk loaded %d ROA white-list entries of validation "
+                   "cache 0x%08X", pthread_self(), loaded, valCacheID);
+
+  return loaded;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // OTHER HELPER FUNCTIONS
 ////////////////////////////////////////////////////////////////////////////////
@@ -1944,6 +2918,11 @@ void outputPrefixCacheAsXML(PrefixCache* self, FILE* stream)
     FOREACH_SLIST(&self->updates, updateListNode)
     {
       pcUpdate = (PC_Update*)getDataOfSListNode(updateListNode);
+      if (pcUpdate->treeNode == NULL)
+      {
+        // Removed update
+        continue;
+      }
       openTag(&out, "update");
         addH32Attrib(&out, "update-id", pcUpdate->updateID);
         addU32Attrib(&out, "origin-as", pcUpdate->as);
@@ -70,6 +70,29 @@
 /** Do not call the update change callback */
 #define PC_DO_SUPPRESS   true
 
+/** The initial number of entries of the bulk load buffer. */
+#define PC_BULK_INIT_SIZE 4096
+
+/** The minimum number of removed updates before the update list is
+ * compacted. */
+#define PC_COMPACT_MIN    1024
+
+/**
+ * A ROA white-list entry received during a bulk load. The entries are 
+ * collected unsorted and merged into the new prefix tree at the end of the
+ * load.
+ */
+typedef struct {
+  /** The prefix of the ROA white-list entry. */
+  IPPrefix prefix;
+  /** The origin AS. */
+  uint32_t as;
+  /** The max length. */
+  uint8_t  maxLen;
+  /** The number of identical entries (after merging). */
+  uint16_t count;
+} PC_BulkROA;
+
 /**
  * A single Prefix Cache.
  */
@@ -78,6 +101,9 @@ typedef struct {
   patricia_tree_t*  prefixTree;
   // This list is not really needed!
   SList             updates;
+  /** The number of updates in the list that are removed from the prefix tree
+   * (treeNode == NULL) and wait for the list to be compacted. */
+  uint32_t          removedUpdates;
  
   // Access control variables
   Mutex             updatesMutex;
@@ -85,6 +111,18 @@ typedef struct {
   RWLock            otherLock;
   RWLock            validLock;
   RWLock            asLock;
+
+  // Bulk ROA load (see startBulkROALoad)
+  /** The ROA white-list entries received since the bulk load started. */
+  PC_BulkROA*       bulkROAs;
+  /** The number of entries stored in bulkROAs. */
+  uint32_t          bulkCount;
+  /** The number of entries bulkROAs can hold. */
+  uint32_t          bulkSize;
+  /** The validation cache the bulk load is performed for. */
+  uint32_t          bulkValCacheID;
+  /** Indicates if a bulk load is in progress. */
+  bool              bulkActive;
 } PrefixCache;
 
 /**
@@ -188,16 +226,17 @@ bool requestUpdateValidation(PrefixCache* self, SRxUpdateID* updateID,
                              IPPrefix* prefix, uint32_t as);
 
 /**
- * This method will remove the given update from the prefix cache.
- * 
- * NOT IMPLEMENTED PRIOR VERSION 0.3
+ * This method will remove the given update from the prefix cache. The ROA and
+ * AS references of the update are released. The prefix itself remains in the
+ * tree.
  * 
  * @param self The prefix cache.
  * @param updateID The id of the update that has to be removed.
  * @param prefix The prefix of the update.
  * @param as The AS number of the update.
  * 
- * @return true if the update could be removed.
+ * @return true if the update could be removed, false if the update is not
+ *         stored in the prefix cache (e.g. it was never validated).
  */
 bool removeUpdate(PrefixCache* self, SRxUpdateID* updateID, IPPrefix* prefix,
                   uint32_t as);
@@ -247,9 +286,9 @@ bool delROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
 /**
  * Remove all ROA whitelist entries from the given validation cache with the 
  * given session id value. Used for giving up a cache, executing a cache reset
- * or session id change.
- * 
- * NOT IMPLEMENTED PRIOR VERSION 0.4
+ * or session id change. With deferredOnly set only the entries flagged by 
+ * flagAllROAwl that were not re-announced since are removed. Validation 
+ * changes are added to the RPKI queue.
  * 
  * @param self The prefix cache instance
  * @param session_id the session id of this session
@@ -264,9 +303,8 @@ int cleanAllROAwl(PrefixCache* self, uint32_t session_id, uint32_t valCacheID,
 /**
  * Flag all ROA white-list entries of the given validation cache with the given 
  * session id value. This is used in case a session id value switch occurred and
- * the state of ROA white-list entries gets rebuild.
- *
- * NOT IMPLEMENTED PRIOR VERSION 0.4.0
+ * the state of ROA white-list entries gets rebuild. Re-announced entries 
+ * (addROAwl) clear their flag without changing any validation state.
  * 
  * @param self The validation cache
  * @param sessionID the session id whose values have to be flagged.
@@ -276,6 +314,75 @@ int cleanAllROAwl(PrefixCache* self, uint32_t session_id, uint32_t valCacheID,
  */
 int flagAllROAwl(PrefixCache* self, uint32_t sessionID, uint32_t valCacheID);
 
+/**
+ * Start a bulk load of all ROA white-list entries of the given validation
+ * cache. This is used for a cache reset where the complete ROA table is 
+ * received again. Until finishBulkROALoad is called the entries are collected
+ * using bulkAddROAwl without touching the prefix tree. A bulk load in progress
+ * of the same validation cache is restarted. Only one validation cache can be
+ * bulk loaded at a time, the others have to flag their entries instead 
+ * (flagAllROAwl).
+ *
+ * @param self The prefix cache
+ * @param valCacheID The validation cache ID.
+ *
+ * @return false if the bulk load buffer could not be allocated or another
+ *         validation cache performs a bulk load.
+ *
+ * @since 0.6.0
+ */
+bool startBulkROALoad(PrefixCache* self, uint32_t valCacheID);
+
+/**
+ * Discard the bulk load of the given validation cache if in progress. This is
+ * used if the validation cache is dropped before its End of Data is received.
+ *
+ * @param self The prefix cache
+ * @param valCacheID The validation cache ID.
+ *
+ * @return the number of collected ROA white-list entries discarded or -1 if 
+ *         the validation cache has no bulk load in progress.
+ *
+ * @since 0.6.0
+ */
+int cancelBulkROALoad(PrefixCache* self, uint32_t valCacheID);
+
+/**
+ * Add the given ROA white-list entry to the bulk load in progress. 
+ * ROA white-list entries for ASNs specified in rfc5398 are ignored!
+ * In case the buffer can not grow, the bulk load is given up: All entries of 
+ * the validation cache are flagged (flagAllROAwl) and the collected entries
+ * are handed to addROAwl. The caller then has to sweep the flagged entries
+ * with the next End of Data (cleanAllROAwl).
+ *
+ * @param self The prefix cache
+ * @param originAS The origin AS of the ROA white-list entry.
+ * @param prefix The prefix of the ROA white-list entry to be added
+ * @param maxLen The max length of the ROA white-list entry
+ *
+ * @return true if the entry was added to the bulk load.
+ *
+ * @since 0.6.0
+ */
+bool bulkAddROAwl(PrefixCache* self, uint32_t originAS, IPPrefix* prefix,
+                  uint8_t maxLen);
+
+/**
+ * Finish the bulk load in progress. A new prefix tree is build from the 
+ * sorted entries and the ROA white-list entries of all other validation 
+ * caches. Then the ROA coverage of all prefixes is calculated in one pass, the
+ * updates are moved into the new tree and the new tree replaces the current 
+ * one. Validation changes are added to the RPKI queue.
+ *
+ * @param self The prefix cache
+ *
+ * @return the number of ROA white-list entries loaded or -1 if no bulk load
+ *         was in progress.
+ *
+ * @since 0.6.0
+ */
+int finishBulkROALoad(PrefixCache* self);
+
 
 /**
  * Empty the complete update cache. This method empties the prefix tree and the 
@@ -84,6 +84,8 @@
 #define DEFAULT_FLAGS   0x0
 /** Keep the connection upon an error */
 #define KEEP_CONNECTION true
+/** Maximum number of RPKI queue elements processed as one batch. */
+#define RQ_BATCH_SIZE   256
 
 #define HDR "([0x%08X] RPKI Handler): "
 
@@ -102,51 +104,96 @@ static void handleRouterKey (uint32_t valCacheID, uint16_t session_id,
                              const char* keyInfo, void* rpkiHandler);
 static void handleEndOfData (uint32_t valCacheID, uint16_t session_id,
                              void* rpkiHandler);
-int handleAspaPdu(void* rpkiHandler, uint32_t customerAsn, 
+static void handleCacheDropped (uint32_t valCacheID, void* rpkiHandler);
+int handleAspaPdu(void* rpkiHandler, uint32_t valCacheID, uint32_t customerAsn,
                     uint16_t providerAsCount, uint32_t* providerAsns, 
                     uint8_t addrFamilyType, uint8_t announce);
 
 /**
- * Configure the RPKI Handler and create an RPKIRouter client.
+ * Configure the RPKI Handler. The RPKIRouter clients are created with 
+ * addRPKICache.
  *
  * @param handler The RPKIHandler instance.
  * @param prefixCache The instance of the prefix cache
- * @param serverHost The RPKI/Router server (RPKI Validation Cache)
- * @param serverPort The port of the server to be connected to.
- * @return
+ * @param aspathCache The instance of the AS path cache
+ * @param aspaDBManager The instance of the ASPA database
+ * @return false if the handler could not be initialized.
  */
-
-
-
-
 bool createRPKIHandler (RPKIHandler* handler, PrefixCache* prefixCache, 
-                        AspathCache* aspathCache, ASPA_DBManager* aspaDBManager,
-                       const char* serverHost, int serverPort, int rpki_version)
+                        AspathCache* aspathCache, ASPA_DBManager* aspaDBManager)
 {
   // Attach the prefix cache
   handler->prefixCache   = prefixCache;
   handler->aspaDBManager = aspaDBManager;
   handler->aspathCache   = aspathCache;
+  handler->noCaches      = 0;
+  memset(handler->caches, 0, sizeof(handler->caches));
+
+  if (!initMutex(&handler->cacheMutex))
+  {
+    RAISE_ERROR("Failed to initialize the mutex of the RPKI handler");
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Create an RPKIRouter client for the given validation cache.
+ *
+ * @param handler The RPKIHandler instance.
+ * @param serverHost The RPKI/Router server (RPKI Validation Cache)
+ * @param serverPort The port of the server to be connected to.
+ * @param rpki_version The RPKI/Router protocol version.
+ * @param preference The preference of the cache, lower values are preferred.
+ *
+ * @return false if the client could not be created.
+ *
+ * @since 0.6.0
+ */
+bool addRPKICache(RPKIHandler* handler, const char* serverHost, int serverPort,
+                  int rpki_version, int preference)
+{
+  if (handler->noCaches == MAX_RPKI_CACHES)
+  {
+    RAISE_ERROR("Can not connect to more than %u RPKI validation caches!",
+                MAX_RPKI_CACHES);
+    return false;
+  }
+
+  RPKICacheSession* session = &handler->caches[handler->noCaches];
+  session->preference      = preference;
+  session->roaSweepPending = false;
 
   // Create the RPKI/Router protocol client instance
-  handler->rrclParams.prefixCallback     = handlePrefix;
-  handler->rrclParams.resetCallback      = handleReset;
-  handler->rrclParams.errorCallback      = handleError;
-  handler->rrclParams.routerKeyCallback  = handleRouterKey;
-  handler->rrclParams.connectionCallback = handleConnection;
-  handler->rrclParams.endOfDataCallback  = handleEndOfData;
-  handler->rrclParams.cbHandleAspaPdu    = handleAspaPdu;
-
-  handler->rrclParams.serverHost         = serverHost;
-  handler->rrclParams.serverPort         = serverPort;
-  handler->rrclParams.version            = rpki_version;
-
-  if (!createRPKIRouterClient(&handler->rrclInstance, &handler->rrclParams,
+  session->rrclParams.prefixCallback       = handlePrefix;
+  session->rrclParams.resetCallback        = handleReset;
+  session->rrclParams.errorCallback        = handleError;
+  session->rrclParams.routerKeyCallback    = handleRouterKey;
+  session->rrclParams.connectionCallback   = handleConnection;
+  session->rrclParams.endOfDataCallback    = handleEndOfData;
+  session->rrclParams.cacheDroppedCallback = handleCacheDropped;
+  session->rrclParams.cbHandleAspaPdu      = handleAspaPdu;
+
+  session->rrclParams.serverHost           = serverHost;
+  session->rrclParams.serverPort           = serverPort;
+  session->rrclParams.version              = rpki_version;
+
+  // The client thread might call back before the creation returns, therefore
+  // the session must be found already.
+  handler->noCaches++;
+  if (!createRPKIRouterClient(&session->rrclInstance, &session->rrclParams,
                                handler))
   {
+    handler->noCaches--;
+    memset(session, 0, sizeof(RPKICacheSession));
     return false;
   }
 
+  LOG(LEVEL_INFO, "RPKI validation cache %s:%d added as 0x%08X with "
+                  "preference %d", serverHost, serverPort,
+                  session->rrclInstance.routerClientID, preference);
+
   return true;
 }
 
@@ -159,10 +206,40 @@ void releaseRPKIHandler(RPKIHandler* handler)
 {
   if (handler != NULL)
   {
-    releaseRPKIRouterClient(&handler->rrclInstance);
+    int idx;
+    for (idx = 0; idx < handler->noCaches; idx++)
+    {
+      releaseRPKIRouterClient(&handler->caches[idx].rrclInstance);
+    }
+    handler->noCaches = 0;
+    releaseMutex(&handler->cacheMutex);
   }
 }
 
+/**
+ * Return the session of the given validation cache.
+ *
+ * @param handler The RPKIHandler instance.
+ * @param valCacheID The ID of the validation cache.
+ *
+ * @return The session or NULL if not found.
+ *
+ * @since 0.6.0
+ */
+static RPKICacheSession* _getCacheSession(RPKIHandler* handler,
+                                          uint32_t valCacheID)
+{
+  int idx;
+  for (idx = 0; idx < handler->noCaches; idx++)
+  {
+    if (handler->caches[idx].rrclInstance.routerClientID == valCacheID)
+    {
+      return &handler->caches[idx];
+    }
+  }
+  return NULL;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // RPKI/Router client callback
 ////////////////////////////////////////////////////////////////////////////////
@@ -196,16 +273,41 @@ static void handlePrefix (uint32_t valCacheID, uint16_t session_id,
 
   // This method takes care of the received white list prefix/origin entry.
   RPKIHandler* handler = (RPKIHandler*)rpkiHandler;
-  if (isAnn)
+  PrefixCache* pCache  = handler->prefixCache;
+  lockMutex(&handler->cacheMutex);
+  if (pCache->bulkActive && (pCache->bulkValCacheID == valCacheID))
+  {
+    // A cache reset is in progress, the prefix tree is build once the End of 
+    // Data is received.
+    if (isAnn)
+    {
+      if (!bulkAddROAwl(pCache, oas, prefix, maxLen) && !pCache->bulkActive)
+      {
+        // The bulk load was given up and the entries are flagged instead.
+        RPKICacheSession* session = _getCacheSession(handler, valCacheID);
+        if (session != NULL)
+        {
+          session->roaSweepPending = true;
+        }
+      }
+    }
+    else
+    {
+      LOG(LEVEL_WARNING, "Ignore ROA white-list withdrawal received during a "
+                         "cache reset of validation cache 0x%08X!", valCacheID);
+    }
+  }
+  else if (isAnn)
   {
-    addROAwl(handler->prefixCache, oas, prefix, maxLen, session_id, valCacheID,
+    addROAwl(pCache, oas, prefix, maxLen, session_id, valCacheID,
              PC_DO_SUPPRESS);
   }
   else
   {
-    delROAwl(handler->prefixCache, oas, prefix, maxLen, session_id, valCacheID,
+    delROAwl(pCache, oas, prefix, maxLen, session_id, valCacheID,
              PC_DO_SUPPRESS);
   }
+  unlockMutex(&handler->cacheMutex);
 }
 
 /**
@@ -217,15 +319,77 @@ static void handlePrefix (uint32_t valCacheID, uint16_t session_id,
 static void handleReset (uint32_t valCacheID, void* rpkiHandler)
 {
   LOG(LEVEL_DEBUG, HDR "Prefix: Reset", pthread_self());
-  RPKIHandler* handler = (RPKIHandler*)rpkiHandler;
-  RAISE_ERROR("Handle Reset not implemented yet! - doDo: remove or flag all "
-              "ROAS from the given validation Cache");
-  handler = NULL; // just to suppress the compiler warning. Must be removed later
-  // @TODO: Remove or flag all ROAS from the given validation Cache
-  // It makes sense to flag all ROAS from the given validation cache. Then 
-  // request a refresh and for each ROA that is received, remove the flag. Once
-  // done, parse through the prefix cache and remove all ROAS of the given 
-  // validation cache that were not reloaded.
+  RPKIHandler*      handler = (RPKIHandler*)rpkiHandler;
+  RPKICacheSession* session = NULL;
+
+  lockMutex(&handler->cacheMutex);
+  session = _getCacheSession(handler, valCacheID);
+  if (session == NULL)
+  {
+    RAISE_ERROR("Reset of unknown validation cache 0x%08X!", valCacheID);
+  }
+  // Collect all ROAs of the given validation cache without touching the prefix
+  // tree. Once the End of Data is received a new tree is build and replaces
+  // the current one, the updates are revalidated once. Only one cache can be
+  // bulk loaded at a time.
+  else if (startBulkROALoad(handler->prefixCache, valCacheID))
+  {
+    session->roaSweepPending = false;
+    LOG(LEVEL_INFO, "Cache reset: bulk load of validation cache 0x%08X "
+                    "started", valCacheID);
+  }
+  else
+  {
+    // Flag all ROAS from the given validation cache. Each ROA that is received
+    // again removes the flag. Once the End of Data is received all ROAs of the
+    // given validation cache that were not reloaded are removed. This way only
+    // the net changes are revalidated.
+    int flagged = flagAllROAwl(handler->prefixCache, 0, valCacheID);
+    session->roaSweepPending = true;
+    LOG(LEVEL_INFO, "Cache reset: %d ROA white-list entries of validation "
+                    "cache 0x%08X flagged as stale", flagged, valCacheID);
+  }
+  unlockMutex(&handler->cacheMutex);
+}
+
+/**
+ * Remove all data of the given validation cache. The ROA white-list entries
+ * and ASPA objects also provided by other validation caches remain, therefore
+ * only the updates that lose their last covering ROA or whose ASPA objects 
+ * changed are revalidated.
+ *
+ * @param valCacheID The ID of the validation cache.
+ * @param rpkiHandler The RPKIHandler that contains the cache.
+ *
+ * @since 0.6.0
+ */
+static void handleCacheDropped (uint32_t valCacheID, void* rpkiHandler)
+{
+  RPKIHandler*      handler = (RPKIHandler*)rpkiHandler;
+  RPKICacheSession* session = NULL;
+  int               flagged = 0;
+  uint32_t          removed = 0;
+
+  lockMutex(&handler->cacheMutex);
+  session = _getCacheSession(handler, valCacheID);
+  if (session != NULL)
+  {
+    // A reset interrupted by the connection loss does not finish anymore.
+    cancelBulkROALoad(handler->prefixCache, valCacheID);
+    flagged = flagAllROAwl(handler->prefixCache, 0, valCacheID);
+    session->roaSweepPending = true;
+    removed = removeAspaObjsOfCache(handler->aspaDBManager, valCacheID);
+    LOG(LEVEL_NOTICE, "Validation cache 0x%08X dropped, remove its %d ROA "
+                      "white-list entries and %u ASPA objects", valCacheID, 
+                      flagged, removed);
+  }
+  unlockMutex(&handler->cacheMutex);
+
+  // The sweep and revalidation are the same as for an End of Data.
+  if (session != NULL)
+  {
+    handleEndOfData(valCacheID, 0, rpkiHandler);
+  }
 }
 
 /**
@@ -242,8 +406,18 @@ static void handleEndOfData (uint32_t valCacheID, uint16_t session_id,
                              void* rpkiHandler)
 {
   RPKIHandler*     handler = (RPKIHandler*)rpkiHandler;
+  RPKICacheSession* session = NULL;
   RPKI_QUEUE*      rQueue = getRPKIQueue();
-  RPKI_QUEUE_ELEM  queueElem;
+  RPKI_QUEUE_ELEM  queueElems[RQ_BATCH_SIZE];
+  int              noElems   = 0;
+  // The updates of the current batch that require BGPsec path validation
+  UC_UpdateData*   updates[RQ_BATCH_SIZE];
+  int              updateIdx[RQ_BATCH_SIZE];
+  uint8_t          updateRes[RQ_BATCH_SIZE];
+  int              noUpdates = 0;
+  uint8_t          bgpsecRes[RQ_BATCH_SIZE];
+  bool             keepGoing = true;
+  int              idx;
   SRxResult        srxRes;
   SRxDefaultResult defaultRes;
   
@@ -254,87 +428,200 @@ static void handleEndOfData (uint32_t valCacheID, uint16_t session_id,
     
   LOG(LEVEL_INFO, "Received an end of data, process RPKI Queue:\n");
 
-  process_ASPA_EndOfData(uCache, handler->aspaDBManager->cbProcessEndOfData, handler);
+  lockMutex(&handler->cacheMutex);
+  session = _getCacheSession(handler, valCacheID);
+
+  // The validation changes of this end of data are send to the proxies in
+  // verification notification batches.
+  beginResultBatch(getCommandHandler());
 
-  while (rq_dequeue(rQueue, &queueElem))
+  // Swap in the prefix tree of the cache reset. The resulting validation
+  // changes are processed with the RPKI queue below.
+  if (   handler->prefixCache->bulkActive
+      && (handler->prefixCache->bulkValCacheID == valCacheID))
   {
-    uID = &queueElem.updateID;
-    valRes.updateID = queueElem.updateID;
-    valRes.valType  = VRT_NONE;
-    valRes.valResult.roaResult    = SRx_RESULT_DONOTUSE;
-    valRes.valResult.bgpsecResult = SRx_RESULT_DONOTUSE;
-    valRes.valResult.aspaResult   = SRx_RESULT_DONOTUSE;
-    
-    if ((queueElem.reason & RQ_ROA) == RQ_ROA)
+    int loaded = finishBulkROALoad(handler->prefixCache);
+    LOG(LEVEL_INFO, "Cache reset: %d ROA white-list entries of validation "
+                    "cache 0x%08X loaded", loaded, valCacheID);
+  }
+
+  // Remove all ROAs not re-announced since the last reset. The resulting 
+  // validation changes are processed with the RPKI queue below.
+  if ((session != NULL) && session->roaSweepPending)
+  {
+    session->roaSweepPending = false;
+    int removed = cleanAllROAwl(handler->prefixCache, session_id, valCacheID,
+                                true);
+    LOG(LEVEL_INFO, "Cache reset: %d stale ROA white-list entries of "
+                    "validation cache 0x%08X removed", removed, valCacheID);
+  }
+
+  // Only revalidate the AS paths (and their updates) that contain a customer
+  // ASN whose ASPA object changed since the last end of data.
+  bool      aspaAll     = false;
+  uint32_t* aspaAsns    = NULL;
+  uint32_t  noAspaAsns  = takeChangedCustomerAsns(handler->aspaDBManager,
+                                                  &aspaAsns, &aspaAll);
+
+  // The data of this cache is complete. The revalidation below only uses the
+  // update, AS path, and ASPA caches which synchronize themselves, the RTR 
+  // threads of the other caches continue meanwhile.
+  unlockMutex(&handler->cacheMutex);
+
+  if (aspaAll)
+  {
+    process_ASPA_EndOfData(uCache, handler->aspaDBManager->cbProcessEndOfData,
+                           handler, 
+                           nextAspaValidationSeq(handler->aspaDBManager));
+  }
+  else if (noAspaAsns > 0)
+  {
+    uint32_t* pathIds   = NULL;
+    uint32_t  noPathIds = getPathIdsOfAsns(handler->aspathCache, aspaAsns,
+                                           noAspaAsns, &pathIds);
+    LOG(LEVEL_INFO, "ASPA: %u customer ASN(s) changed, %u AS path(s) "
+                    "affected", noAspaAsns, noPathIds);
+    if (noPathIds > 0)
+    {
+      process_ASPA_EndOfData_paths(uCache, pathIds, noPathIds,
+                                 handler->aspaDBManager->cbProcessEndOfData,
+                                 handler, 
+                                 nextAspaValidationSeq(handler->aspaDBManager));
+      free(pathIds);
+    }
+  }
+  if (aspaAsns != NULL)
+  {
+    free(aspaAsns);
+  }
+
+  while (keepGoing)
+  {
+    // Take a batch of elements from the queue.
+    noElems = rq_dequeueBatch(rQueue, queueElems, RQ_BATCH_SIZE);
+    if (noElems == 0)
+    {
+      break;
+    }
+
+    // Validate the BGPsec path of all updates with key changes at once.
+    noUpdates = 0;
+    for (idx = 0; idx < noElems; idx++)
+    {
+      bgpsecRes[idx] = SRx_RESULT_DONOTUSE;
+      if ((queueElems[idx].reason & RQ_KEY) == RQ_KEY)
+      {
+        uID = &queueElems[idx].updateID;
+        UC_UpdateData* updateData = getUpdateData(uCache, uID);
+        if (!ski_canValidate(getSKICache(), uID))
+        {
+          // A key was withdrawn and each signature block misses a key now, 
+          // the path is invalid without any signature validation.
+          bgpsecRes[idx] = SRx_RESULT_INVALID;
+          releaseUpdateData(uCache, updateData);
+        }
+        else if (updateData != NULL && updateData->bgpsec_path != NULL)
+        {
+          updates[noUpdates]   = updateData;
+          updateIdx[noUpdates] = idx;
+          noUpdates++;
+        }
+        else
+        {
+          LOG(LEVEL_ERROR, "Update 0x%08X is registered for BGPsec but the "
+                           "BGPsec_PATH attribute is not stored!", *uID);
+          releaseUpdateData(uCache, updateData);
+        }
+      }
+    }
+    if (noUpdates > 0)
     {
-      if (getUpdateResult(uCache, uID, 0, NULL, &srxRes, &defaultRes, NULL))
+      BGPSecHandler* bgpsecHandler = getBGPsecHandler();
+      if (bgpsecHandler != NULL)
       {
-        valRes.valType |= VRT_ROA;
-        valRes.valResult.roaResult = srxRes.roaResult;
+        validateSignatures(bgpsecHandler, noUpdates, updates, updateRes);
+        for (idx = 0; idx < noUpdates; idx++)
+        {
+          bgpsecRes[updateIdx[idx]] = updateRes[idx];
+        }
       }
       else
       {
-        LOG(LEVEL_WARNING, "Update 0x%08X not found during de-queuing of RPKI "
-                           "QUEUE!", queueElem.updateID);
+        RAISE_ERROR("BGPSecHAndler could not be retrieved!!");
+      }
+      // The update data is referenced until the batch is validated.
+      for (idx = 0; idx < noUpdates; idx++)
+      {
+        releaseUpdateData(uCache, updates[idx]);
       }
     }
-    // Now check for BGPSEC path Validation
-    if ((queueElem.reason & RQ_KEY) == RQ_KEY)
+
+    for (idx = 0; idx < noElems; idx++)
     {
-      UC_UpdateData* updateData = getUpdateData(uCache, uID);
-      SCA_BGP_PathAttribute* bgpsec_path = updateData->bgpsec_path;
-      if (bgpsec_path != NULL)
+      uID = &queueElems[idx].updateID;
+      valRes.updateID = queueElems[idx].updateID;
+      valRes.valType  = VRT_NONE;
+      valRes.valResult.roaResult    = SRx_RESULT_DONOTUSE;
+      valRes.valResult.bgpsecResult = SRx_RESULT_DONOTUSE;
+      valRes.valResult.aspaResult   = SRx_RESULT_DONOTUSE;
+
+      if ((queueElems[idx].reason & RQ_ROA) == RQ_ROA)
       {
-        BGPSecHandler* bgpsecHandler = getBGPsecHandler();
-        if (bgpsecHandler != NULL)
+        if (getUpdateResult(uCache, uID, 0, NULL, &srxRes, &defaultRes, NULL))
         {
-          valRes.valType |= VRT_BGPSEC;
-          valRes.valResult.bgpsecResult = validateSignature(bgpsecHandler, 
-                                                            updateData);
+          valRes.valType |= VRT_ROA;
+          valRes.valResult.roaResult = srxRes.roaResult;
         }
         else
         {
-          RAISE_ERROR("BGPSecHAndler could not be retrieved!!");
+          LOG(LEVEL_WARNING, "Update 0x%08X not found during de-queuing of "
+                             "RPKI QUEUE!", queueElems[idx].updateID);
         }
       }
-      else
+      // The BGPsec path validation was done for the complete batch
+      if (bgpsecRes[idx] != SRx_RESULT_DONOTUSE)
       {
-        LOG(LEVEL_ERROR, "Update 0x%08X is registered for BGPsec but the "
-                         "BGPsec_PATH attribute is not stored!", *uID);
+        valRes.valType |= VRT_BGPSEC;
+        valRes.valResult.bgpsecResult = bgpsecRes[idx];
       }
-    }
 
-    // Here check for ASPA Validation which was registered 
-    if ((queueElem.reason & RQ_ASPA) == RQ_ASPA)
-    {
-      LOG(LEVEL_INFO, FILE_LINE_INFO " called for ASPA dequeue [uID: %08X] ", *uID);
-      uint32_t pathId= 0;
-      if (getUpdateResult(uCache, uID, 0, NULL, &srxRes, &defaultRes, &pathId))
+      // Here check for ASPA Validation which was registered 
+      if ((queueElems[idx].reason & RQ_ASPA) == RQ_ASPA)
+      {
+        LOG(LEVEL_INFO, FILE_LINE_INFO " called for ASPA dequeue [uID: %08X] ",
+            *uID);
+        uint32_t pathId= 0;
+        if (getUpdateResult(uCache, uID, 0, NULL, &srxRes, &defaultRes, 
+                            &pathId))
+        {
+          valRes.valType |= VRT_ASPA;
+          valRes.valResult.aspaResult = srxRes.aspaResult;
+        }
+        else
+        {
+          LOG(LEVEL_WARNING, "Update 0x%08X not found during de-queuing of "
+                             "RPKI QUEUE!", queueElems[idx].updateID);
+        }
+      }
+
+      if (uCache->resChangedCallback != NULL)
       {
-        valRes.valType |= VRT_ASPA;
-        valRes.valResult.aspaResult = srxRes.aspaResult;
+        // Notify of the change of validation result. 
+        // (call handleUpdateResultChange)
+        uCache->resChangedCallback(&valRes);     
       }
       else
       {
-        LOG(LEVEL_WARNING, "Update 0x%08X not found during de-queuing of RPKI "
-            "QUEUE!", queueElem.updateID);
+        RAISE_ERROR("No resChangedCallback function registered!\n"
+                    "Cannot propagate the changes of the validation result!\n"
+                    "Abort operation!");
+        rq_empty(rQueue);
+        keepGoing = false;
+        break;
       }
     }
-    
-    if (uCache->resChangedCallback != NULL)
-    {
-      // Notify of the change of validation result. (call handleUpdateResultChange)
-      uCache->resChangedCallback(&valRes);     
-    }
-    else
-    {
-      RAISE_ERROR("No resChangedCallback function registered!\n"
-                  "Cannot propagate the changes of the validation result!\n"
-                  "Abort operation!");
-      rq_empty(rQueue);
-      break;
-    }
   }
+  flushResultBatch(getCommandHandler());
 }
 
 /**
@@ -402,6 +689,7 @@ static void handleRouterKey (uint32_t valCacheID, uint16_t session_id,
                              const char* keyInfo, void* rpkiHandler)
 {
 
+  RPKIHandler*  handler  = (RPKIHandler*)rpkiHandler;
   SRxCryptoAPI* srxCAPI  = getSrxCAPI();
   SKI_CACHE* sCache      = getSKICache();
   sca_status_t status = API_STATUS_OK;
@@ -422,6 +710,7 @@ static void handleRouterKey (uint32_t valCacheID, uint16_t session_id,
     bsKey.keyData = (u_int8_t*)calloc(1, ECDSA_PUB_KEY_DER_LENGTH);
     memcpy(bsKey.keyData, keyInfo, ECDSA_PUB_KEY_DER_LENGTH);
 
+    lockMutex(&handler->cacheMutex);
     if (isAnn)
     {
       // A new key is announced
@@ -458,6 +747,7 @@ static void handleRouterKey (uint32_t valCacheID, uint16_t session_id,
                            "with status:%i [0x%04X]", status, status);
       }
     }
+    unlockMutex(&handler->cacheMutex);
   }
   else
   {
@@ -468,11 +758,12 @@ static void handleRouterKey (uint32_t valCacheID, uint16_t session_id,
 
 // 
 // ASPA validation (called from params -> cbHandleAspaPdu in handleReceiveAspaPdu function)
-// work1. parsing ASPA objects into AS number in forms of string
-// work2. call DB to store
+// work1. create the ASPA object (sorted provider set)
+// work2. call DB to store it for the given validation cache
 //
-int handleAspaPdu(void* rpkiHandler, uint32_t customerAsn, uint16_t providerAsCount, 
-                  uint32_t* providerAsns, uint8_t addrFamilyType, uint8_t announce)
+int handleAspaPdu(void* rpkiHandler, uint32_t valCacheID, uint32_t customerAsn,
+                  uint16_t providerAsCount, uint32_t* providerAsns, 
+                  uint8_t addrFamilyType, uint8_t announce)
 {
   LOG(LEVEL_INFO, FILE_LINE_INFO " ASPA handler called for registering ASPA object(s) into DB");
   RPKIHandler* handler = (RPKIHandler*)rpkiHandler;
@@ -494,29 +785,33 @@ int handleAspaPdu(void* rpkiHandler, uint32_t customerAsn, uint16_t providerAsCo
     return retVal;
   }
 
-  TrieNode *node = NULL;
   ASPA_Object *aspaObj = NULL;
   aspaObj = newASPAObject(customerAsn, providerAsCount, providerAsns, afi);
+  if (!aspaObj)
+  {
+    RAISE_SYS_ERROR("Not enough memory to create the ASPA object");
+    return retVal;
+  }
 
-  char strWord[6];
-  sprintf(strWord, "%d", customerAsn);
-    
-
+  lockMutex(&handler->cacheMutex);
   if (announce == 1) // 1 == announce, 0 == withdraw
   {
-    LOG(LEVEL_INFO, "[Announce] ASPA object, search key in DB: %s", strWord);
-    node = insertAspaObj(aspaDBManager, strWord, strWord, aspaObj);
-    if (node)
+    LOG(LEVEL_INFO, "[Announce] ASPA object, search key in DB: %u", customerAsn);
+    if (insertAspaObj(aspaDBManager, aspaObj, valCacheID))
     {
       retVal = 1; // success
     }
+    else
+    {
+      deleteASPAObject(aspaDBManager, aspaObj);
+    }
   }
   else if (announce == 0) // withdraw
   {
     // XXX: Draft didn't mention about withdraw clearly
     //
-    LOG(LEVEL_INFO, "[Withdraw] ASPA object, search key in DB: %s", strWord);
-    bool resWithdraw = delete_TrieNode_AspaObj (aspaDBManager, strWord, aspaObj);
+    LOG(LEVEL_INFO, "[Withdraw] ASPA object, search key in DB: %u", customerAsn);
+    bool resWithdraw = deleteAspaObj (aspaDBManager, aspaObj, valCacheID);
 
     if (resWithdraw)
     {
@@ -537,6 +832,7 @@ int handleAspaPdu(void* rpkiHandler, uint32_t customerAsn, uint16_t providerAsCo
     if (aspaObj) // release memory unless used for inserting db
       deleteASPAObject(aspaDBManager, aspaObj);
   }
+  unlockMutex(&handler->cacheMutex);
 
   return retVal;
 
@@ -49,31 +49,75 @@
 #include "server/aspath_cache.h"
 #include "util/prefix.h"
 #include "server/aspa_trie.h"
+#include "util/mutex.h"
+#include "server/configuration.h"
 
 /**
- * A single RPKI/Router Handler.
+ * The session to one RPKI validation cache. All data received is stored 
+ * tagged with the ID of the RPKI/Router client (valCacheID), the entries of
+ * all caches together form the validation data. 
+ *
+ * @since 0.6.0
  */
 typedef struct {
-  PrefixCache*            prefixCache;
   RPKIRouterClientParams  rrclParams;
   RPKIRouterClient        rrclInstance;
+  /** The preference of the cache, lower values are preferred. */
+  int                     preference;
+  /** Set once a reset query flagged all ROAs of this cache because no bulk 
+   * load could be used, the ROAs not re-announced until the next End of Data 
+   * will be removed. */
+  bool                    roaSweepPending;
+} RPKICacheSession;
+
+/**
+ * A single RPKI/Router Handler.
+ */
+typedef struct {
+  PrefixCache*            prefixCache;
   ASPA_DBManager*         aspaDBManager;
   AspathCache*            aspathCache;
+  /** The sessions to the validation caches ordered by preference. 
+   * @since 0.6.0 */
+  RPKICacheSession        caches[MAX_RPKI_CACHES];
+  /** The number of validation caches.
+   * @since 0.6.0 */
+  uint8_t                 noCaches;
+  /** Serializes the processing of the data received from all caches.
+   * @since 0.6.0 */
+  Mutex                   cacheMutex;
 } RPKIHandler;
 
 /**
- * Initializes the instance, registers an existing Prefix Cache and creates
- * a RPKI/Router Client instance.
+ * Initializes the instance and registers an existing Prefix Cache. The 
+ * validation caches are added using addRPKICache.
  *
  * @param self Variable that should be initialized
  * @param prefixCache Existing cache that should be registered
+ * @param aspathCache Existing AS path cache that should be registered
+ * @param aspaDBManager Existing ASPA database that should be registered
+ * @return \c true = all went through, \c false = an error occurred
+ */
+bool createRPKIHandler(RPKIHandler* self, PrefixCache* prefixCache,
+                       AspathCache* aspathCache, ASPA_DBManager* aspaDBManager);
+
+/**
+ * Create a RPKI/Router Client instance for the given validation cache. Each
+ * client runs its own thread, the data of a cache is removed only if no other
+ * cache provides the same entries.
+ *
+ * @param self The handler instance
  * @param serverHost RPKI/Router protocol server host name
  * @param serverPort RPKI/Router protocol server port number
+ * @param version The RPKI/Router protocol version
+ * @param preference The preference of the cache, lower values are preferred.
+ *
  * @return \c true = all went through, \c false = an error occurred
+ *
+ * @since 0.6.0
  */
-bool createRPKIHandler(RPKIHandler* self, PrefixCache* prefixCache,
-                       AspathCache* aspathCache, ASPA_DBManager* aspaDBManager,
-                       const char* serverHost, int serverPort, int version);
+bool addRPKICache(RPKIHandler* self, const char* serverHost, int serverPort,
+                  int version, int preference);
 
 /**
  * Frees all resources.
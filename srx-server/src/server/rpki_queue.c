@@ -28,10 +28,14 @@
  * file. Therefore no additional checking is needed is some provided values
  * are NULL. entry functions specified in the header file do take cate of that.
  * 
- * @version 0.5.0.1
+ * @version 0.6.0
  *
  * Changelog:
  * -----------------------------------------------------------------------------
+ * 0.6.0    - Keep the queue as an insertion ordered set. The elements are
+ *            indexed by update ID which allows to merge a reason into an 
+ *            already queued update without walking the queue. Added
+ *            rq_dequeueBatch.
  * 0.5.0.1  - 2017/08/25 - oborchert
  *            * BZ1224: Function __rq_createQueueElem did not return the 
  *              generated object. (fixed)
@@ -41,9 +45,9 @@
 #include <malloc.h>
 #include <string.h>
 #include <semaphore.h>
+#include <uthash.h>
 #include "srx/srxcryptoapi.h"
 #include "server/rpki_queue.h"
-#include "shared/srx_identifier.h"
 #include "util/log.h"
 
 /** The Queue element */
@@ -52,6 +56,8 @@ typedef struct _rpki_queue_list_elem {
   struct _rpki_queue_list_elem* next;
   /** The element to be queued. */
   RPKI_QUEUE_ELEM elem;
+  /** The index of the queue, the key is elem.updateID */
+  UT_hash_handle hh;
 } _RPKI_QUEUE_LIST_ELEM;
 
 /** The RPKI queue - This queue will have each element only once. Each new 
@@ -59,6 +65,10 @@ typedef struct _rpki_queue_list_elem {
 typedef struct {
   /** The queues head element */
   _RPKI_QUEUE_LIST_ELEM* head;
+  /** The queues tail element */
+  _RPKI_QUEUE_LIST_ELEM* tail;
+  /** The queued elements indexed by their update ID */
+  _RPKI_QUEUE_LIST_ELEM* index;
   /** Count the number of elements in the queue. */
   u_int32_t size;
   /** For thread safety */
@@ -157,20 +167,24 @@ static bool _rq_dequeue(_RPKI_QUEUE* rQueue, RPKI_QUEUE_ELEM* elem)
   
   // The caller assures that rQueue is not NULL
   
-  int size = sizeof(RPKI_QUEUE_ELEM);
   if (rQueue->size != 0)
   {
     // remove the list element from the top of the queue
     _RPKI_QUEUE_LIST_ELEM* listElem = rQueue->head;
     rQueue->head = listElem->next;
+    if (rQueue->head == NULL)
+    {
+      rQueue->tail = NULL;
+    }
+    HASH_DEL(rQueue->index, listElem);
     rQueue->size--;
 
     // copy the queue element into the return value
-    memcpy(elem, &listElem->elem, size);
+    memcpy(elem, &listElem->elem, sizeof(RPKI_QUEUE_ELEM));
     retVal = true;
 
     // clean up the list elements
-    memset(listElem, 0, size);
+    memset(listElem, 0, sizeof(_RPKI_QUEUE_LIST_ELEM));
     free(listElem);
   }
   
@@ -236,55 +250,36 @@ void rq_releaseQueue(RPKI_QUEUE* queue)
 void rq_queue(RPKI_QUEUE* queue, 
               e_RPKI_QUEUE_REASON reason, SRxUpdateID* updateID)
 {
-  // Each update id is listed only once. New elements will be added to the end 
-  // of the list. While walking through the list to the end, each element will 
-  // be compared to the new element and possibly updated. 
-  // this means if none is found the end will be reached and the update will be 
-  // added.
+  // Each update id is listed only once. The index is used to find an already
+  // queued update whose reason will be merged with the new reason, otherwise
+  // the update is added to the end of the list.
   if (queue != NULL)
   {
-    _RPKI_QUEUE* rQueue = (RPKI_QUEUE*)queue;
+    _RPKI_QUEUE* rQueue = (_RPKI_QUEUE*)queue;
     
     if (_rq_lock(rQueue))
     {
-      _RPKI_QUEUE_LIST_ELEM* listElem = rQueue->head;
-      bool added = false;
+      _RPKI_QUEUE_LIST_ELEM* listElem = NULL;
+      HASH_FIND(hh, rQueue->index, updateID, LEN_SRxUpdateID, listElem);
 
       if (listElem != NULL)
-      {    
-        while (!added)
-        {
-          if (compareSrxUpdateID(&listElem->elem.updateID, updateID, SRX_UID_BOTH) 
-              != 0)
-          {
-            // Not the same, move on
-            if (listElem->next != NULL)
-            {
-              listElem = listElem->next;
-            }
-            else
-            {
-              listElem->next = __rq_createQueueElem(reason, updateID);
-              added = true;
-              rQueue->size++;
-            }
-          }
-          else
-          {
-            // already added, maybe the reason myst be updated
-            added = true;
-            if (listElem->elem.reason != reason)
-            {
-              // Set it to both if the reason is different. If in the future more
-              // reasons are added then this needs to be modified.
-              listElem->elem.reason = RQ_ALL;
-            }
-          }
-        }
+      {
+        // already added, the reasons are bit encoded and can be combined.
+        listElem->elem.reason |= reason;
       }
       else
       {
-        rQueue->head = __rq_createQueueElem(reason, updateID);
+        listElem = __rq_createQueueElem(reason, updateID);
+        HASH_ADD(hh, rQueue->index, elem.updateID, LEN_SRxUpdateID, listElem);
+        if (rQueue->tail != NULL)
+        {
+          rQueue->tail->next = listElem;
+        }
+        else
+        {
+          rQueue->head = listElem;
+        }
+        rQueue->tail = listElem;
         rQueue->size++;
       }
 
@@ -332,6 +327,42 @@ bool rq_dequeue(RPKI_QUEUE* queue, RPKI_QUEUE_ELEM* elem)
   return retVal;
 }
 
+/**
+ * Fills the given array with up to max elements taken from the front of the 
+ * queue. The elements are removed from the queue.
+ * 
+ * @param queue The RPKI queue.
+ * @param elems The array to be filled, it must be able to hold max elements.
+ * @param max The maximum number of elements to be dequeued.
+ * 
+ * @return the number of elements filled into the array.
+ * 
+ * @since 0.6.0
+ */
+int rq_dequeueBatch(RPKI_QUEUE* queue, RPKI_QUEUE_ELEM* elems, int max)
+{
+  int noElems = 0;
+  
+  if (queue != NULL && elems != NULL)
+  {
+    _RPKI_QUEUE* rQueue = (_RPKI_QUEUE*)queue;
+    if (_rq_lock(rQueue))
+    {
+      while ((noElems < max) && _rq_dequeue(rQueue, &elems[noElems]))
+      {
+        noElems++;
+      }
+      _rq_unlock(rQueue);
+    }
+    else
+    {
+      LOG(LEVEL_ERROR, "Could not aquire lock for RPKI QUEUE");
+    }
+  }
+  
+  return noElems;
+}
+
 /**
  * Empty the RPKI queue
  * 
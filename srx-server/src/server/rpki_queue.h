@@ -23,10 +23,11 @@
  * This Header file specifies RPKI queuing structures. A queue implementation 
  * might follow later on.
  *
- * @version 0.5.0.0
+ * @version 0.6.0
  *
  * Changelog:
  * -----------------------------------------------------------------------------
+ * 0.6.0   - Added rq_dequeueBatch.
  * 0.5.0.0 - 2017/07/08 - oborchert
  *            * Added values to enumeration e_RPKI_QUEUE_REASON to allow 
  *              bit encoding.
@@ -112,6 +113,20 @@ void rq_queue(RPKI_QUEUE* queue,
  */
 bool rq_dequeue(RPKI_QUEUE* queue, RPKI_QUEUE_ELEM* elem);
 
+/**
+ * Fills the given array with up to max elements taken from the front of the 
+ * queue. The elements are removed from the queue.
+ * 
+ * @param queue The RPKI queue.
+ * @param elems The array to be filled, it must be able to hold max elements.
+ * @param max The maximum number of elements to be dequeued.
+ * 
+ * @return the number of elements filled into the array.
+ * 
+ * @since 0.6.0
+ */
+int rq_dequeueBatch(RPKI_QUEUE* queue, RPKI_QUEUE_ELEM* elems, int max);
+
 /**
  * Empty the RPKI queue
  * 
@@ -96,6 +96,9 @@
  */
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
 #include <arpa/inet.h>
 #include <signal.h>
 #include "server/rpki_queue.h"
@@ -118,6 +121,8 @@
 #define RRC_MAX_STRING 255
 // Maximum errors during PDU processing
 #define RRC_MAX_ERRCT  10
+// Initial size of the receive buffer, it grows for larger PDUs.
+#define RRC_RCV_BUFFER_SIZE (64 * 1024)
 
 /**
  * Handle received IPv4 Prefixes.
@@ -311,6 +316,31 @@ static bool handlePDUASPA(RPKIRouterClient* client,
 */
 
 
+/**
+ * Return the given interval if it is within the allowed range, otherwise the 
+ * default value.
+ * 
+ * @param value The interval received in host format
+ * @param min The minimum allowed value
+ * @param max The maximum allowed value
+ * @param def The default value
+ * 
+ * @return The interval to be used.
+ * 
+ * @since 0.6.0
+ */
+static uint32_t _checkInterval(uint32_t value, uint32_t min, uint32_t max, 
+                               uint32_t def)
+{
+  if ((value < min) || (value > max))
+  {
+    LOG(LEVEL_WARNING, "Invalid timing parameter %u received, use %u "
+                       "seconds instead!", value, def);
+    return def;
+  }
+  return value;
+}
+
 /**
  * Process the End Of Data PDU
  * 
@@ -324,9 +354,38 @@ static void handleEndOfData(RPKIRouterClient* client,
 {
   uint32_t  clientID;
   uint16_t  sessionID;
+  RPKIEndOfDataHeaderV1* hdrV1 = (RPKIEndOfDataHeaderV1*)hdr;
 
   clientID  = client->routerClientID;
   sessionID = client->sessionID;
+
+  // Version 0 caches do not provide timing parameters, some version 1 caches
+  // still send the short PDU.
+  if (   (hdr->version > 0)
+      && (ntohl(hdr->length) >= sizeof(RPKIEndOfDataHeaderV1)))
+  {
+    client->refreshInterval = _checkInterval(ntohl(hdrV1->refresh),
+                                             RPKI_MIN_REFRESH_INTERVAL,
+                                             RPKI_MAX_REFRESH_INTERVAL,
+                                             RPKI_DEFAULT_REFRESH_INTERVAL);
+    client->retryInterval   = _checkInterval(ntohl(hdrV1->retry),
+                                             RPKI_MIN_RETRY_INTERVAL,
+                                             RPKI_MAX_RETRY_INTERVAL,
+                                             RPKI_DEFAULT_RETRY_INTERVAL);
+    client->expireInterval  = _checkInterval(ntohl(hdrV1->expire),
+                                             RPKI_MIN_EXPIRE_INTERVAL,
+                                             RPKI_MAX_EXPIRE_INTERVAL,
+                                             RPKI_DEFAULT_EXPIRE_INTERVAL);
+  }
+
+  // The data set is complete, from now on serial queries can be used.
+  client->serialValid   = true;
+  client->queryPending  = false;
+  client->lastEndOfData = time(NULL);
+  client->nextRefresh   = client->lastEndOfData + client->refreshInterval;
+  LOG(LEVEL_INFO, HDR "End of data for session 0x%04X serial %u, next serial "
+                  "query in %u seconds.", pthread_self(), ntohs(sessionID),
+                  ntohl(client->serial), client->refreshInterval);
   
   client->params->endOfDataCallback(clientID, sessionID, client->user);
 }
@@ -399,106 +458,231 @@ static bool checkSessionID(RPKIRouterClient* client, uint32_t sessionID)
 }
 
 /**
- * Read the next packet from the socket into the provided buffer. In case the 
- * buffer is not of sufficient size, the buffer will be extended.
+ * Wait until data is available on the socket. As long as the client holds a
+ * complete data set and no query is outstanding, a serial query is sent each
+ * time the refresh interval elapses. In case the serial query could not be 
+ * answered the next one is sent after the retry interval.
+ * 
+ * @param client The client session
  * 
- * In case of an internal error receiving the PDU the returned length can be 
- * less then the length field of the PDU indicates. In this case the errCode
- * contains an error.
+ * @since 0.6.0
+ */
+static void _waitForPDU(RPKIRouterClient* client)
+{
+  struct pollfd pfd;
+  time_t        now;
+  int           ret;
+
+  while (!client->stop && client->serialValid && !client->queryPending)
+  {
+    pfd.fd      = client->clSock.clientFD;
+    pfd.events  = POLLIN;
+    pfd.revents = 0;
+    if (pfd.fd == -1)
+    {
+      // The socket is closed, let the receiver detect it.
+      break;
+    }
+
+    now = time(NULL);
+    if (now >= client->nextRefresh)
+    {
+      LOG(LEVEL_DEBUG, HDR "Refresh interval elapsed, send serial query.",
+                       pthread_self());
+      client->nextRefresh = now + client->retryInterval;
+      // In case sending fails the receiver detects the lost connection.
+      sendSerialQuery(client);
+      break;
+    }
+
+    ret = poll(&pfd, 1, (int)(client->nextRefresh - now) * 1000);
+    if ((ret == -1) && (errno == EINTR))
+    {
+      continue;
+    }
+    if (ret != 0)
+    {
+      // Data, hangup, or error - all handled by the receiver.
+      break;
+    }
+  }
+}
+
+/**
+ * Determine if the receive buffer contains the next PDU completely. 
+ * 
+ * @param client The client session
+ * 
+ * @return true if the next PDU can be processed without reading the socket.
+ * 
+ * @since 0.6.0
+ */
+static bool _isPDUBuffered(RPKIRouterClient* client)
+{
+  uint32_t available = client->rcvBufferFill - client->rcvBufferPos;
+  uint32_t pduLen    = 0;
+
+  if (available >= sizeof(RPKICommonHeader))
+  {
+    pduLen = ntohl(((RPKICommonHeader*)(client->rcvBuffer 
+                                        + client->rcvBufferPos))->length);
+    // A corrupted length is reported without reading more data.
+    return (pduLen <= available) || (pduLen < sizeof(RPKICommonHeader));
+  }
+
+  return false;
+}
+
+/**
+ * Free the receive buffer. This is called when the receiver thread ends.
+ * 
+ * @param clientPtr a pointer to the RPKIRouterClient*
+ * 
+ * @since 0.6.0
+ */
+static void _releaseReceiveBuffer(void* clientPtr)
+{
+  RPKIRouterClient* client = (RPKIRouterClient*)clientPtr;
+  free(client->rcvBuffer);
+  client->rcvBuffer     = NULL;
+  client->rcvBufferSize = 0;
+  client->rcvBufferFill = 0;
+  client->rcvBufferPos  = 0;
+}
+
+/**
+ * Drop all data of the receive buffer. This is used when a connection is 
+ * (re)established, the data of a previous connection must not be processed.
+ * 
+ * @param client The client session
+ * 
+ * @since 0.6.0
+ */
+static void _resetReceiveBuffer(RPKIRouterClient* client)
+{
+  client->rcvBufferFill = 0;
+  client->rcvBufferPos  = 0;
+}
+
+/**
+ * Return the next packet. The receive buffer is filled with all data available
+ * on the socket and the PDUs are returned in place one after another. Only if
+ * the buffer does not contain the next PDU completely the socket is read 
+ * again. In case the buffer is not of sufficient size for the PDU, the buffer
+ * will be extended.
+ * 
+ * The returned PDU stays valid until the next call.
  * 
  * The following errors can be reported:
  * 
  *     RRC_RCV_PDU_NO_ERROR:       No error
  *     RRC_RCV_PDU_SOCKET_ERROR:   Somehow not all data could be loaded.
+ *     RPKI_EC_CORRUPT_DATA:       The PDU length is invalid.
  * 
  * @param client The client session
  * @param errCode Returns the error code.
- * @param buffer The buffer to be filled.
- * @param buffSize The max size of the buffer.
+ * @param pdu Returns the PDU within the receive buffer.
  * 
- * @return 0 or the number of bytes received (can be less then the PDU length).
+ * @return 0 or the number of bytes of the PDU (only the common header in case
+ *         of a corrupted PDU).
  */
 static u_int32_t _getPacket(RPKIRouterClient* client, int* errCode, 
-                            uint8_t** buffer, uint32_t* buffSize)
+                            uint8_t** pdu)
 {
-  uint32_t pduLen       = 0;
-  uint32_t bytesMissing = 0;
-  uint8_t* bufferPtr    = *buffer + sizeof(RPKICommonHeader);
-  RPKICommonHeader* hdr = (RPKICommonHeader*)*buffer;
-  
-  // Initialize the values.
-  memset (*buffer, 0, *buffSize);
+  RPKICommonHeader* hdr       = NULL;
+  uint32_t          available = 0;
+  uint32_t          pduLen    = 0;
+  uint32_t          needed    = 0;
+  ssize_t           rbytes    = 0;
+
   *errCode = RRC_RCV_PDU_NO_ERROR;
-  
-  // Read the common data for the Common header. This method fails in case the
-  // connection is lost.
-  if (!recvNum(getClientFDPtr(&client->clSock), *buffer,
-                              sizeof(RPKICommonHeader)))
-  {
-    LOG(LEVEL_DEBUG, HDR "Connection lost!", pthread_self());
-    *errCode  = RRC_RCV_PDU_SOCKET_ERROR;
-  }
-  else
+  *pdu     = NULL;
+
+  while (*errCode == RRC_RCV_PDU_NO_ERROR)
   {
-    // retrieve the actual size of the message. In case more needs to be loaded
-    // it will be done.
-    pduLen = ntohl(hdr->length);
-    if (pduLen < sizeof(RPKICommonHeader))
+    available = client->rcvBufferFill - client->rcvBufferPos;
+    needed    = sizeof(RPKICommonHeader);
+    if (available >= sizeof(RPKICommonHeader))
     {
-      LOG(LEVEL_DEBUG, HDR "Corrupted RPKI-RTR PDU: Size!", pthread_self());
-      *errCode  = RPKI_EC_CORRUPT_DATA;
-    }    
-  }
-  
-  if (*errCode == RRC_RCV_PDU_NO_ERROR)
-  {      
-    // Determine how much data is still missing
-    bytesMissing = pduLen - sizeof(RPKICommonHeader);
+      hdr    = (RPKICommonHeader*)(client->rcvBuffer + client->rcvBufferPos);
+      pduLen = ntohl(hdr->length);
+      if (pduLen < sizeof(RPKICommonHeader))
+      {
+        LOG(LEVEL_DEBUG, HDR "Corrupted RPKI-RTR PDU: Size!", pthread_self());
+        *errCode = RPKI_EC_CORRUPT_DATA;
+        *pdu     = (uint8_t*)hdr;
+        // The framing is lost, the remaining data can not be used.
+        _resetReceiveBuffer(client);
+        return sizeof(RPKICommonHeader);
+      }
+      if (pduLen <= available)
+      {
+        // The PDU is completely received.
+        *pdu = (uint8_t*)hdr;
+        client->rcvBufferPos += pduLen;
+        return pduLen;
+      }
+      needed = pduLen;
+    }
 
-    // Read the rest of the PDU
-    if (bytesMissing > 0)
+    // Move the incomplete PDU to the beginning of the buffer.
+    if (client->rcvBufferPos > 0)
     {
-      // Check if the current buffer is big enough
-      if (pduLen > *buffSize)
-      {
-        // The current buffer is to small -> try to increase it.
-        uint8_t* newBuffer = realloc(*buffer, pduLen);
-        if (newBuffer)
-        {
-          *buffer   = newBuffer; // reset to the bigger space
-          *buffSize = pduLen;
-          bufferPtr = (*buffer + sizeof(RPKICommonHeader));
-        }
-        else
-        {
-          // can only happen in case it is an error packet that contains an
-          // erroneous PDU or extreme large error text.
-          LOG(LEVEL_ERROR, "Invalid PDU length : type=%d, length=%u, "
-                           "data-size=%u", hdr->type, pduLen, bytesMissing);
+      memmove(client->rcvBuffer, client->rcvBuffer + client->rcvBufferPos,
+              available);
+      client->rcvBufferFill = available;
+      client->rcvBufferPos  = 0;
+    }
 
-          // Try to skip over the data
-          if (!skipBytes(&client->clSock, bytesMissing))
-          {
-            LOG(LEVEL_ERROR, "While reading a corrupted PDU, could not skip "
-                             "over the remainig data");
-          }
-          *errCode = RPKI_EC_CORRUPT_DATA;
-        }
+    // Check if the current buffer is big enough
+    if (needed > client->rcvBufferSize)
+    {
+      // The current buffer is to small -> try to increase it.
+      uint8_t* newBuffer = realloc(client->rcvBuffer, needed);
+      if (newBuffer)
+      {
+        client->rcvBuffer     = newBuffer;
+        client->rcvBufferSize = needed;
       }
-
-      // Now load the remaining data
-      if (*errCode == RRC_RCV_PDU_NO_ERROR)
+      else
       {
-        if (!recvNum(getClientFDPtr(&client->clSock), bufferPtr, bytesMissing))
+        hdr = (RPKICommonHeader*)client->rcvBuffer;
+        // can only happen in case it is an error packet that contains an
+        // erroneous PDU or extreme large error text.
+        LOG(LEVEL_ERROR, "Invalid PDU length : type=%d, length=%u, "
+                         "data-size=%u", hdr->type, needed, 
+                         needed - sizeof(RPKICommonHeader));
+
+        // Try to skip over the data
+        if (!skipBytes(&client->clSock, needed - available))
         {
-          *errCode = RRC_RCV_PDU_SOCKET_ERROR; 
-          pduLen -= bytesMissing;
+          LOG(LEVEL_ERROR, "While reading a corrupted PDU, could not skip "
+                           "over the remainig data");
         }
+        *errCode = RPKI_EC_CORRUPT_DATA;
+        *pdu     = (uint8_t*)hdr;
+        _resetReceiveBuffer(client);
+        return sizeof(RPKICommonHeader);
       }
     }
+
+    // Read as much as is available. This method fails in case the 
+    // connection is lost.
+    rbytes = recvAvailable(getClientFDPtr(&client->clSock), 
+                           client->rcvBuffer + client->rcvBufferFill,
+                           client->rcvBufferSize - client->rcvBufferFill);
+    if (rbytes == -1)
+    {
+      LOG(LEVEL_DEBUG, HDR "Connection lost!", pthread_self());
+      *errCode = RRC_RCV_PDU_SOCKET_ERROR;
+    }
+    else
+    {
+      client->rcvBufferFill += (uint32_t)rbytes;
+    }
   }
-  
-  return pduLen;
+
+  return 0;
 }
 
 /**
@@ -528,18 +712,16 @@ static bool receivePDUs(RPKIRouterClient* client, bool returnAterEndOfData,
 {
   RPKICommonHeader* hdr        = NULL;  // A pointer to the Common header.
   uint32_t          pduLen     = 0;
-  // Use the "maximum" header. It can grow in case an error pdu is received
-  // with a large error message or an ASPA PDU with a large number of 
-  // providerASs. In this case the memory will be extended to the space needed. 
-  // In case the space can not be extended as needed, the PDU will be loaded as 
-  // much as possible and the remainder will be skipped.
-  uint32_t         bytesAllocated = sizeof(RPKIRouterKeyHeader);
-  uint8_t*         byteBuffer = malloc(bytesAllocated);
+  // The PDU is processed within the receive buffer of the client. The buffer
+  // grows in case an error pdu is received with a large error message or an 
+  // ASPA PDU with a large number of providerASs. In case the space can not be 
+  // extended as needed, the remainder of the PDU will be skipped.
+  uint8_t*         byteBuffer = NULL;
   // Keep going is used to keep the received thread up and running. It will be
   // set false once the connection is shut down.
   bool             keepGoing   = !client->stop;
   
-  if (byteBuffer != NULL)
+  if (client->rcvBuffer != NULL)
   {
     // Reset the error code to NO ERROR
     *errCode = RRC_RCV_PDU_NO_ERROR;
@@ -558,13 +740,18 @@ static bool receivePDUs(RPKIRouterClient* client, bool returnAterEndOfData,
     // If singlePoll is selected, stop after this poll.
     keepGoing = !singlePoll;
     
-    pduLen = _getPacket(client, errCode, &byteBuffer, &bytesAllocated);
-    if (!pduLen)
+    // Sends the serial queries while the connection is idle.
+    if (!_isPDUBuffered(client))
+    {
+      _waitForPDU(client);
+    }
+    pduLen = _getPacket(client, errCode, &byteBuffer);
+    hdr    = (RPKICommonHeader*)byteBuffer;
+    if (!pduLen || (*errCode != RRC_RCV_PDU_NO_ERROR))
     {
       keepGoing = false;
       continue;
     }
-    hdr = (RPKICommonHeader*)byteBuffer;
     
     LOG(LEVEL_DEBUG, HDR "Received RPKI-RTR PDU[%u] length=%u\n",
                      pthread_self(), hdr->type, ntohl(hdr->length));
@@ -636,7 +823,12 @@ static bool receivePDUs(RPKIRouterClient* client, bool returnAterEndOfData,
         sessionID = ((RPKISerialNotifyHeader*)hdr)->sessionID;
         if (checkSessionID(client, sessionID))
         {
-          sendSerialQuery(client);
+          // A query in progress delivers the new data as well, without a 
+          // complete data set the serial is of no use.
+          if (client->serialValid && !client->queryPending)
+          {
+            sendSerialQuery(client);
+          }
         }
         else
         {
@@ -651,8 +843,11 @@ static bool receivePDUs(RPKIRouterClient* client, bool returnAterEndOfData,
         {
           client->sessionIDChanged = true;
           // Mark the clients cache DB as stale.
-          client->params->sessionIDChangedCallback(client->routerClientID, 
-                                                   sessionID);
+          if (client->params->sessionIDChangedCallback != NULL)
+          {
+            client->params->sessionIDChangedCallback(client->routerClientID, 
+                                                     sessionID);
+          }
           // @TODO: Fix Session ID. 
           // Only in case the previous message was a "Request Query" the session
           // ID is allowed to change. RFC8210 5.5 2nd paragraph
@@ -699,12 +894,14 @@ static bool receivePDUs(RPKIRouterClient* client, bool returnAterEndOfData,
         }
         break;
       case PDU_TYPE_CACHE_RESET :
-        // Reset our cache
-        client->params->resetCallback(client->routerClientID, client->user);
-        // Respond with a cache reset
+        // Respond with a reset query, this also resets our cache.
         sendResetQuery(client);
         break;
       case PDU_TYPE_ERROR_REPORT :
+        // The query is answered, in case the connection is kept, try again
+        // once the retry interval elapsed.
+        client->queryPending = false;
+        client->nextRefresh  = time(NULL) + client->retryInterval;
         // Switched from client-stop to keepGoing
         keepGoing = !handleErrorReport(client, 
                                        (RPKIErrorReportHeader*)byteBuffer);
@@ -826,10 +1023,6 @@ static bool receivePDUs(RPKIRouterClient* client, bool returnAterEndOfData,
                     errStr, strlen(errStr));
   }
   
-  // Release the buffer again.
-  free(byteBuffer);
-  byteBuffer = NULL;
-  
   return *errCode == RRC_RCV_PDU_NO_ERROR;
 }
 
@@ -842,6 +1035,72 @@ void sigusr_rpki_pipe_handler(int signo)
   close(g_rpki_single_thread_client_fd);
 }
 
+/**
+ * Drop the data of the cache once it is older than the expire interval. This 
+ * is checked while the connection is down, the data of a cache that can not
+ * be reached is only kept until it expires.
+ * 
+ * @param client The client connection
+ * 
+ * @return true if the data was dropped.
+ * 
+ * @since 0.6.0
+ */
+static bool _checkExpired(RPKIRouterClient* client)
+{
+  if (   (client->lastEndOfData == 0)
+      || ((time(NULL) - client->lastEndOfData) < client->expireInterval))
+  {
+    return false;
+  }
+
+  LOG(LEVEL_NOTICE, "Data of validation cache 0x%08X expired, drop all data!",
+                    client->routerClientID);
+  client->serialValid   = false;
+  client->lastEndOfData = 0;
+  if (client->params->cacheDroppedCallback != NULL)
+  {
+    client->params->cacheDroppedCallback(client->routerClientID, client->user);
+  }
+
+  return true;
+}
+
+/**
+ * Send the first query of a (re)established connection. In case the client 
+ * still holds a complete data set that is not expired, the session is resumed
+ * with a serial query, otherwise all data is requested with a reset query.
+ * In case the cache can not serve the serial it responds with a cache reset.
+ * 
+ * @param client The client connection
+ * 
+ * @return true if the query could be sent.
+ * 
+ * @since 0.6.0
+ */
+static bool _sendInitialQuery(RPKIRouterClient* client)
+{
+  // A query of the previous connection will not be answered anymore.
+  client->queryPending = false;
+
+  if (client->serialValid && !client->sessionIDChanged)
+  {
+    if ((time(NULL) - client->lastEndOfData) < client->expireInterval)
+    {
+      LOG(LEVEL_INFO, HDR "Resume session 0x%04X with serial %u.", 
+                      pthread_self(), ntohs(client->sessionID), 
+                      ntohl(client->serial));
+      return sendSerialQuery(client);
+    }
+    LOG(LEVEL_NOTICE, "Data of session 0x%04X expired, reload all data!",
+                      ntohs(client->sessionID));
+    client->serialValid = false;
+  }
+
+  // This also restarts a reset that was interrupted by the connection loss.
+  return sendResetQuery(client);
+}
+
 /**
  * Tries to keep the connection up - and starts the loop that receives
  * and processes all PDUs.
@@ -871,17 +1130,36 @@ static void* manageConnection (void* clientPtr)
 
   LOG (LEVEL_DEBUG, "([0x%08X]) > RPKI Router Client Thread started!",
                     pthread_self());
+
+  // The receive buffer lives as long as this thread, also if it is canceled.
+  client->rcvBuffer     = malloc(RRC_RCV_BUFFER_SIZE);
+  client->rcvBufferSize = (client->rcvBuffer != NULL) ? RRC_RCV_BUFFER_SIZE : 0;
+  _resetReceiveBuffer(client);
+  pthread_cleanup_push(_releaseReceiveBuffer, client);
+  if (client->rcvBuffer == NULL)
+  {
+    RAISE_ERROR("Could not allocate enough memory to read from socket!");
+    client->stop = true;
+  }
     
   while (!client->stop)
   {
-    // Start off every new connection with a reset
-    if (sendResetQuery(client))
+    // Start off every new connection with a serial query or a reset
+    if (_sendInitialQuery(client))
     {
       // Receive and process all PDUs - This is a loop until the connection
       // is either lost, closed, or the end of data is received (single request)
       // Modified call with 0.5.0.0 to use variable as second parameter rather
       // than false
       receivePDUs(client, client->stopAfterEndOfData, &errCode, true);      
+      if (client->lastRecv == PDU_TYPE_CACHE_RESET)
+      {
+        // The cache could not serve the serial, the reset query is sent 
+        // already. Wait for its cache response.
+        LOG(LEVEL_INFO, HDR "Cache can not resume the session, reload all "
+                        "data.", pthread_self());
+        receivePDUs(client, client->stopAfterEndOfData, &errCode, true);
+      }
       // Check the expected response, 
       switch (client->lastRecv)
       {
@@ -944,6 +1222,10 @@ static void* manageConnection (void* clientPtr)
       pthread_exit((void*)1);
     }
 
+    // The data of this cache can only be used until the expire interval
+    // elapsed, after that it has to be dropped.
+    _checkExpired(client);
+
     if (client->sessionIDChanged)
     {
       // prepare some settings to allow a fresh start
@@ -953,6 +1235,7 @@ static void* manageConnection (void* clientPtr)
     // Now try to reconnect if not stopped.
     client->clSock.reconnect = !client->stop;
     reconnectToServer(&client->clSock, sec, MAX_RECONNECTION_ATTEMPTS);
+    _resetReceiveBuffer(client);
 
     // See if the session_id changed!
     if (client->sessionIDChanged)
@@ -994,24 +1277,26 @@ static void* manageConnection (void* clientPtr)
   LOG (LEVEL_DEBUG, "([0x%08X]) < RPKI Router Client Thread stopped!",
                     pthread_self());
 
+  pthread_cleanup_pop(1);
   pthread_exit(0);
 }
 
+/** The number of router client IDs handed out so far. */
+static uint32_t _noRouterClientIDs = 0;
+
 /**
- * Creates an ID for this RouterClient.
+ * Creates an ID for this RouterClient. The IDs are handed out in sequence 
+ * starting with 1.
  *
  * @param self the client instance
  *
- * @todo add some implementation
- *
- * @return currently only 0
+ * @return the ID within 1..255
  */
 uint32_t createRouterClientID(RPKIRouterClient* self)
 {
-  // TODO: Add implementation for a unique ID. Maybe an initial hash over self.
-  // BZ1239: For now use hard coded value 1. This ID is used for registering 
-  // keys and 0 is reserved within SCA.
-  return 1;
+  // BZ1239: This ID is used as key source for registering keys with SCA. The 
+  // key source is one octet and 0 is reserved within SCA.
+  return (__sync_fetch_and_add(&_noRouterClientIDs, 1) % 255) + 1;
 }
 
 /**
@@ -1071,6 +1356,23 @@ bool createRPKIRouterClient (RPKIRouterClient* self,
   self->routerClientID   = createRouterClientID(self);
   self->version          = params->version;
 
+  // Use the default timing until the cache provides its own.
+  self->serialValid      = false;
+  self->queryPending     = false;
+  self->refreshInterval  = RPKI_DEFAULT_REFRESH_INTERVAL;
+  self->retryInterval    = RPKI_DEFAULT_RETRY_INTERVAL;
+  self->expireInterval   = RPKI_DEFAULT_EXPIRE_INTERVAL;
+  self->lastEndOfData    = 0;
+  self->nextRefresh      = 0;
+  self->noResetQueries   = 0;
+  self->noSerialQueries  = 0;
+
+  // The receiver thread allocates its buffer.
+  self->rcvBuffer        = NULL;
+  self->rcvBufferSize    = 0;
+  self->rcvBufferFill    = 0;
+  self->rcvBufferPos     = 0;
+
   ret = pthread_create (&self->thread, NULL, manageConnection, self);
   if (ret)
   {
@@ -1145,7 +1447,8 @@ static bool _sendPDU(RPKIRouterClient* client, RPKICommonHeader* hdr)
 
 /**
  * Send a RESET QUERY to the validation cache to re-request the complete
- * data
+ * data. Prior sending, the reset callback is called to allow the data of this
+ * cache to be flagged as stale.
  *
  * @param self The instance of the rpki router client
  *
@@ -1165,10 +1468,21 @@ bool sendResetQuery (RPKIRouterClient* self)
     hdr.reserved = 0x0000;
     hdr.length   = htonl(sizeof(RPKIResetQueryHeader));
 
+    // The cache will resend all its data. This is done prior to sending to
+    // be sure the flags are set before the first data arrives.
+    self->params->resetCallback(self->routerClientID, self->user);
+    // Until the end of data is received the serial can not be used anymore.
+    self->serialValid = false;
+
     lockMutex(&self->writeMutex);
 
     succ = _sendPDU (self, (RPKICommonHeader*)&hdr);
-    if (!succ)
+    if (succ)
+    {
+      self->queryPending = true;
+      self->noResetQueries++;
+    }
+    else
     {
       // TODO: Maybe just close the old socket and set both to -1
       // The socket was not closed but the FD was set to -1. reset it to allow
@@ -1270,6 +1584,11 @@ bool sendSerialQuery (RPKIRouterClient* self)
     LOG(LEVEL_DEBUG, HDR "Sending Serial Query...\n", pthread_self());
 
     succ  = _sendPDU(self, (RPKICommonHeader*)&hdr);
+    if (succ)
+    {
+      self->queryPending = true;
+      self->noSerialQueries++;
+    }
     unlockMutex(&self->writeMutex);
   }
 
@@ -1337,8 +1656,9 @@ bool handleReceiveAspaPdu(RPKIRouterClient* client, RPKIAspaHeader* hdr, uint32_
                               (announce == 0 ? "Withdraw": "None"));
 
   // this calls 'handleAspaPdu()' in rpki_handler module
-  client->params->cbHandleAspaPdu(client->user, customerAsn, providerAsCount, 
-                                    providerAsns, addrFamilyType, announce); 
+  client->params->cbHandleAspaPdu(client->user, client->routerClientID, 
+                                  customerAsn, providerAsCount, providerAsns, 
+                                  addrFamilyType, announce); 
   return true;
 }
 
@@ -81,6 +81,7 @@
 #define __RPKI_ROUTER_CLIENT_H__
 
 #include <pthread.h>
+#include <time.h>
 #include "shared/rpki_router.h"
 #include "util/client_socket.h"
 #include "util/mutex.h"
@@ -177,13 +178,15 @@ typedef struct {
                             void* user);
 
   /**
-   * The cache/server sent a reset response. Usually, the client should reset
-   * his own cache.
+   * A reset query is about to be send to the cache, either during connection
+   * setup, after a cache reset PDU, or after a cache session id change. The
+   * cache will resend all its data followed by an end of data. The client 
+   * should flag its own data of this cache as stale and remove what was not
+   * received again once the end of data arrives.
    *
-   * @note There is no need to send a reset query - this was done already
-   * The cache though can reestablish the connection similar to a cache session
-   * id change.
+   * @note There is no need to send a reset query - this is done already
    *
+   * @param valCacheID The id of the cache.
    * @param user User data
    */
   void (*resetCallback)(uint32_t valCacheID,  void* user);
@@ -257,6 +260,20 @@ typedef struct {
    *      reconnect to the server
    */
   int (*connectionCallback)(void* user);
+
+  /**
+   * The connection is lost and the data received from the cache is older than
+   * the expire interval. All data of this cache has to be removed, the next
+   * connection starts with a reset query.
+   *
+   * @note Optional - can be NULL
+   *
+   * @param valCacheID The id of the cache.
+   * @param user User data
+   *
+   * @since 0.6.0
+   */
+  void (*cacheDroppedCallback)(uint32_t valCacheID, void* user);
   // Server connection
   
   /**
@@ -298,8 +315,9 @@ typedef struct {
    * @since 0.5.0.3 */
   bool        allowDowngrade;
 
-  int (*cbHandleAspaPdu)(void* user, uint32_t cusAsn, uint16_t provAsCount, 
-                         uint32_t* provAsns, uint8_t addrFamilyType, uint8_t announce);
+  int (*cbHandleAspaPdu)(void* user, uint32_t valCacheID, uint32_t cusAsn, 
+                         uint16_t provAsCount, uint32_t* provAsns, 
+                         uint8_t addrFamilyType, uint8_t announce);
 
 } RPKIRouterClientParams;
 
@@ -352,6 +370,53 @@ typedef struct {
   bool                    stopAfterEndOfData;
   /** RTR-to-Cache protocol version info */
   int8_t                  version;
+
+  // The following attributes are used to keep the data of the cache up to 
+  // date using serial queries, also across reconnects.
+  /** Indicates that the session ID and serial belong to a completely received
+   * data set and can be used for a serial query. 
+   * @since 0.6.0 */
+  bool                    serialValid;
+  /** Indicates that a reset or serial query is sent but the end of data not 
+   * received yet. 
+   * @since 0.6.0 */
+  bool                    queryPending;
+  /** The refresh interval in seconds as advertised by the cache.
+   * @since 0.6.0 */
+  uint32_t                refreshInterval;
+  /** The retry interval in seconds as advertised by the cache.
+   * @since 0.6.0 */
+  uint32_t                retryInterval;
+  /** The expire interval in seconds as advertised by the cache.
+   * @since 0.6.0 */
+  uint32_t                expireInterval;
+  /** The time the last end of data was received.
+   * @since 0.6.0 */
+  time_t                  lastEndOfData;
+  /** The time the next serial query is due.
+   * @since 0.6.0 */
+  time_t                  nextRefresh;
+  /** The number of reset queries sent.
+   * @since 0.6.0 */
+  uint32_t                noResetQueries;
+  /** The number of serial queries sent.
+   * @since 0.6.0 */
+  uint32_t                noSerialQueries;
+
+  // The receive buffer is filled with as much data as available and all 
+  // complete PDUs are processed in place.
+  /** The receive buffer, owned by the receiver thread.
+   * @since 0.6.0 */
+  uint8_t*                rcvBuffer;
+  /** The size of the receive buffer.
+   * @since 0.6.0 */
+  uint32_t                rcvBufferSize;
+  /** The number of bytes currently stored in the receive buffer.
+   * @since 0.6.0 */
+  uint32_t                rcvBufferFill;
+  /** The position of the next PDU in the receive buffer.
+   * @since 0.6.0 */
+  uint32_t                rcvBufferPos;
 } RPKIRouterClient;
 
 /**
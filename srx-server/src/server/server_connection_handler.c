@@ -58,6 +58,7 @@
 #include <stdint.h>
 
 #include "util/log.h"
+#include "util/pdu_pool.h"
 #include "server/server_connection_handler.h"
 #include "server/srx_packet_sender.h"
 #include "server/aspath_cache.h"
@@ -75,8 +76,7 @@
 typedef struct {
   ServerSocket* svrSock;
   ServerClient* client;
-  uint8_t* pdu;
-  uint32_t size;
+  PDU_Buffer*   pdu;
   bool     consumed;
   void* next;
 } SCH_ReceiverQueueElement;
@@ -96,18 +96,24 @@ typedef struct {
   // Mutex and Condition for thread handling
   Mutex       mutex;
   Cond        condition;
+  // Processed elements kept for reuse
+  SCH_ReceiverQueueElement* unused;
+  // the number of unused elements
+  int         noUnused;
 
   ServerConnectionHandler* svrConnHandler;
 } SCH_ReceiverQueue;
 
 // wait until notify or 1 s timeout - this is just to allow a wakeup
 #define SCH_RECEIVE_QUEUE_WAIT_MS 1000
+// The maximum number of processed elements kept for reuse
+#define SCH_RECEIVE_QUEUE_MAX_UNUSED 1024
 
 // Forward declaration
 SCH_ReceiverQueueElement* fetchSCHReceiverPacket(SCH_ReceiverQueue* queue);
 void stopSCHReceiverQueue(SCH_ReceiverQueue* queue);
 void _handlePacket(ServerSocket* svrSock, ServerClient* client,
-                   void* packet, PacketLength length, void* srvConHandler);
+                   PDU_Buffer* pdu, void* srvConHandler);
 
 /**
  * Create the sender queue including the thread that manages the queue.
@@ -143,6 +149,8 @@ SCH_ReceiverQueue* createSCHReceiverQueue(ServerConnectionHandler*
       queue->tail    = NULL;
       queue->size    = 0;
       queue->running = false;
+      queue->unused   = NULL;
+      queue->noUnused = 0;
       queue->svrConnHandler = srvConnHandler;
     }
   }
@@ -178,6 +186,14 @@ void releaseSCHReceiverQueue(SCH_ReceiverQueue* queue)
     {
       RAISE_SYS_ERROR("Queue should be already empty!");
     }
+    SCH_ReceiverQueueElement* packet = NULL;
+    while (queue->unused != NULL)
+    {
+      packet = queue->unused;
+      queue->unused = (SCH_ReceiverQueueElement*)packet->next;
+      free(packet);
+    }
+    queue->noUnused = 0;
     releaseMutex(&queue->mutex);
     destroyCond(&queue->condition);
     queue->svrConnHandler = NULL;
@@ -214,9 +230,23 @@ void* schReceiverQueueThreadLoop(void* thisQueue)
       if (packet != NULL)
       {
         _handlePacket(packet->svrSock, packet->client, packet->pdu,
-                      packet->size, queue->svrConnHandler);
-        free(packet->pdu);
-        free(packet);
+                      queue->svrConnHandler);
+        // Other consumers might still hold a reference to the PDU.
+        releasePDUBuffer(packet->pdu);
+        packet->pdu = NULL;
+        lockMutex(&queue->mutex);
+        if (queue->noUnused < SCH_RECEIVE_QUEUE_MAX_UNUSED)
+        {
+          packet->next  = queue->unused;
+          queue->unused = packet;
+          queue->noUnused++;
+          packet = NULL;
+        }
+        unlockMutex(&queue->mutex);
+        if (packet != NULL)
+        {
+          free(packet);
+        }
       }
     }
     LOG(LEVEL_DEBUG, "Exit loop of Server Connection Handler REceiver Queue!");
@@ -304,7 +334,7 @@ void stopSCHReceiverQueue(SCH_ReceiverQueue* queue)
       packet = queue->head;
       queue->head = (SCH_ReceiverQueueElement*)packet->next;
       // Free the allocated memory
-      free(packet->pdu);
+      releasePDUBuffer(packet->pdu);
       free(packet);
       queue->size--;
     }
@@ -353,8 +383,9 @@ SCH_ReceiverQueueElement* fetchSCHReceiverPacket(SCH_ReceiverQueue* queue)
 }
 
 /**
- * Queue a copy of the the packet and return the size of the queue. The copy of
- * the packet will be freed by the queue handler thread itself.
+ * Queue a copy of the the packet and return the size of the queue. The packet
+ * is copied into a PDU buffer which is handed to all further consumers. The
+ * queue handler thread releases its reference once the packet is processed.
  *
  * @param pdu The received PDU to be added to the queue. ( A copy will be
  *            created and stored)
@@ -371,15 +402,26 @@ bool addToSCHReceiverQueue(uint8_t* pdu, ServerSocket* svrSoc,
                            ServerClient* client, size_t size,
                            SCH_ReceiverQueue* queue)
 {
-  SCH_ReceiverQueueElement* packet = malloc(sizeof(SCH_ReceiverQueueElement));
+  SCH_ReceiverQueueElement* packet = NULL;
+  PDU_Buffer* buffer = copyToPDUBuffer(pdu, size);
   bool retVal = false;
 
   lockMutex(&queue->mutex);
+  // Reuse a processed element if possible
+  packet = queue->unused;
+  if (packet != NULL)
+  {
+    queue->unused = (SCH_ReceiverQueueElement*)packet->next;
+    queue->noUnused--;
+  }
+  else
+  {
+    packet = malloc(sizeof(SCH_ReceiverQueueElement));
+  }
   if (packet != NULL)
   {
     memset(packet, 0, sizeof(SCH_ReceiverQueueElement));
-    packet->pdu = malloc(size);
-    if (packet->pdu == NULL)
+    if (buffer == NULL)
     {
       free(packet);
     }
@@ -389,8 +431,7 @@ bool addToSCHReceiverQueue(uint8_t* pdu, ServerSocket* svrSoc,
       packet->svrSock  = svrSoc;
       packet->client   = client;
       packet->next     = NULL;
-      packet->size     = size;
-      memcpy(packet->pdu, pdu, size);
+      packet->pdu      = buffer;
       if (queue->size == 0)
       {
         queue->head = packet;
@@ -410,6 +451,7 @@ bool addToSCHReceiverQueue(uint8_t* pdu, ServerSocket* svrSoc,
 
   if (!retVal)
   {
+    releasePDUBuffer(buffer);
     RAISE_SYS_ERROR("Not enough memory to queue packets in send queue!");
   }
 
@@ -458,6 +500,11 @@ bool createServerConnectionHandler(ServerConnectionHandler* self,
     if (createServerSocket(&self->svrSock, sysConfig->server_port,
                            sysConfig->verbose))
     {
+      if (sysConfig->mode_epoll)
+      {
+        setServerSocketReactors(&self->svrSock, sysConfig->mode_epoll_threads);
+      }
+
       // initialize and configure the proxyMap
       memset(self->proxyMap, 0, (sizeof(ProxyClientMapping)*256));
       if (!configureProxyMap(self, sysConfig->mapping_routerID))
@@ -530,14 +577,17 @@ void releaseServerConnectionHandler(ServerConnectionHandler* self)
  * @param svrSock The server socket used to send a possible validation request
  *                receipt
  * @param client The client instance where the packet was received on
- * @param updateCache The instance of the update cache
- * @param hdr The validation request header
+ * @param hdr The validation request. It is either the PDU itself or one of
+ *            the requests of a verify batch PDU.
+ * @param pdu The PDU buffer containing the validation request. The update 
+ *            cache and command queue keep references to it instead of copies.
  *
  * @return false if an internal (fatal) error occurred, otherwise true.
  */
 bool processValidationRequest(ServerConnectionHandler* self,
                               ServerSocket* svrSock, ClientThread* client,
-                              SRXRPOXY_BasicHeader_VerifyRequest* hdr)
+                              SRXRPOXY_BasicHeader_VerifyRequest* hdr,
+                              PDU_Buffer* pdu)
 {
   LOG(LEVEL_DEBUG, HDR "Enter processValidationRequest", pthread_self());
 
@@ -568,12 +618,12 @@ bool processValidationRequest(ServerConnectionHandler* self,
   SRxUpdateID updateID = 0;
 
   bool doStoreUpdate = false;
-  IPPrefix* prefix = NULL;
+  IPPrefix  ipPrefix;
+  IPPrefix* prefix = &ipPrefix;
   // Specify the client id as a receiver only when validation is requested.
   uint8_t clientID = (doOriginVal || doPathVal) ? client->routerID : 0;
 
   // 1. Prepare for and generate the ID of the update
-  prefix = malloc(sizeof(IPPrefix));
   memset(prefix, 0, sizeof(IPPrefix));
   prefix->length     = hdr->prefixLen;
   BGPSecData bgpData;
@@ -768,13 +818,13 @@ bool processValidationRequest(ServerConnectionHandler* self,
     defResInfo.resSourceBGPSEC     = hdr->bgpsecResSrc;
 
 
+    // The update cache keeps the paths within the PDU.
     if (!storeUpdate(self->updateCache, clientID, clientMapping, 
-              &updateID, prefix, originAS, &defResInfo, &bgpData, pathId))
+              &updateID, prefix, originAS, &defResInfo, &bgpData, pathId, pdu))
     {
       RAISE_SYS_ERROR("Could not store update [0x%08X]!!", updateID);
       // Maybe check for ID conflict, if not then get result again - or just
       // quit here!
-      free(prefix);
       return false;
     }
 
@@ -782,7 +832,6 @@ bool processValidationRequest(ServerConnectionHandler* self,
     srxRes.roaResult    = defResInfo.result.roaResult;
     srxRes.bgpsecResult = defResInfo.result.bgpsecResult;
   }
-  free(prefix);
   prefix = NULL;
 
   if (modifyUpdateCacheWithAspaValue)
@@ -842,9 +891,10 @@ bool processValidationRequest(ServerConnectionHandler* self,
     // Only keep the validation flags.
     hdr->flags = sendFlags & SRX_FLAG_ROA_BGPSEC_ASPA;
 
-    // create the validation command!
-    if (!queueCommand(self->cmdQueue, COMMAND_TYPE_SRX_PROXY, svrSock, client,
-                      updateID, ntohl(hdr->length), (uint8_t*)hdr))
+    // create the validation command! It shares the PDU with the update cache.
+    if (!queueCommandPDU(self->cmdQueue, COMMAND_TYPE_SRX_PROXY, svrSock, 
+                         client, updateID, pdu, ntohl(hdr->length),
+                         (uint8_t*)hdr))
     {
       RAISE_ERROR("Could not add validation request to command queue!");
       retVal = false;
@@ -865,15 +915,15 @@ bool processValidationRequest(ServerConnectionHandler* self,
  *                receipt
  * @param client The client instance where the packet was received on
  * @param updateCache The instance of the update cache
- * @param hdr The signature request header
+ * @param pdu The PDU buffer containing the signature request
  *
  * @return false if an internal (fatal) error occurred, otherwise true.
  */
 static bool processSignatureRequest(ServerConnectionHandler* self,
                                     ServerSocket* svrSock, ServerClient* client,
-                                    SRxUpdateID updateID,
-                                    SRXPROXY_SIGN_REQUEST* hdr)
+                                    SRxUpdateID updateID, PDU_Buffer* pdu)
 {
+  SRXPROXY_SIGN_REQUEST* hdr = (SRXPROXY_SIGN_REQUEST*)pdu->data;
   LOG(LEVEL_DEBUG, HDR "Enter processSignatureRequest", pthread_self());
   UpdSigResult* signResult = malloc(sizeof(UpdSigResult));
   bool complete = (hdr->blockType & SRX_PROXY_BLOCK_TYPE_LATEST_SIGNATURE) == 0;
@@ -908,9 +958,8 @@ static bool processSignatureRequest(ServerConnectionHandler* self,
   }
   else // No data was available, add request to command handler for signing
   {
-    if (!queueCommand(self->cmdQueue, COMMAND_TYPE_SRX_PROXY, svrSock, client,
-                                      updateID, ntohl(hdr->length),
-                                      (uint8_t*)hdr))
+    if (!queueCommandPDU(self->cmdQueue, COMMAND_TYPE_SRX_PROXY, svrSock, 
+                         client, updateID, pdu, pdu->length, pdu->data))
     {
       RAISE_ERROR("Could not add validation request to command queue!");
       retVal = false;
@@ -922,6 +971,122 @@ static bool processSignatureRequest(ServerConnectionHandler* self,
   return retVal;
 }
 
+/**
+ * Verify that the given verify batch PDU is well formed. Each contained request
+ * MUST be a complete IPv4 or IPv6 verify request and all requests together
+ * MUST fill the batch exactly.
+ *
+ * @param batch The verify batch PDU
+ * @param length The number of bytes received.
+ *
+ * @return true if the batch can be processed.
+ *
+ * @since 0.6.0
+ */
+static bool _isValidVerifyBatch(SRXPROXY_VERIFY_BATCH* batch,
+                                PacketLength length)
+{
+  SRXRPOXY_BasicHeader_VerifyRequest* hdr = NULL;
+  SRXPROXY_VERIFY_V4_REQUEST* v4Hdr = NULL;
+  SRXPROXY_VERIFY_V6_REQUEST* v6Hdr = NULL;
+  BGPSECValReqData* valReqData = NULL;
+  uint8_t*  ptr       = (uint8_t*)batch + sizeof(SRXPROXY_VERIFY_BATCH);
+  uint32_t  remaining = 0;
+  uint32_t  reqLength = 0;
+  uint32_t  minLength = 0;
+  uint32_t  noRequests;
+  uint32_t  idx;
+
+  if (   (length < sizeof(SRXPROXY_VERIFY_BATCH))
+      || (ntohl(batch->length) != length))
+  {
+    return false;
+  }
+
+  remaining  = length - sizeof(SRXPROXY_VERIFY_BATCH);
+  noRequests = ntohl(batch->noRequests);
+  for (idx = 0; idx < noRequests; idx++)
+  {
+    if (remaining < sizeof(SRXRPOXY_BasicHeader_VerifyRequest))
+    {
+      return false;
+    }
+    hdr = (SRXRPOXY_BasicHeader_VerifyRequest*)ptr;
+    switch (hdr->type)
+    {
+      case PDU_SRXPROXY_VERIFY_V4_REQUEST:
+        v4Hdr      = (SRXPROXY_VERIFY_V4_REQUEST*)ptr;
+        valReqData = &v4Hdr->bgpsecValReqData;
+        minLength  = sizeof(SRXPROXY_VERIFY_V4_REQUEST);
+        break;
+      case PDU_SRXPROXY_VERIFY_V6_REQUEST:
+        v6Hdr      = (SRXPROXY_VERIFY_V6_REQUEST*)ptr;
+        valReqData = &v6Hdr->bgpsecValReqData;
+        minLength  = sizeof(SRXPROXY_VERIFY_V6_REQUEST);
+        break;
+      default:
+        return false;
+    }
+    reqLength = ntohl(hdr->length);
+    if ((reqLength < minLength) || (reqLength > remaining))
+    {
+      return false;
+    }
+    // The AS path and BGPsec attribute MUST be part of the request.
+    if (  minLength + (ntohs(valReqData->numHops) * 4)
+        + ntohs(valReqData->attrLen) > reqLength)
+    {
+      return false;
+    }
+    ptr       += reqLength;
+    remaining -= reqLength;
+  }
+
+  return remaining == 0;
+}
+
+/**
+ * Process all validation requests contained in the verify batch PDU. Each
+ * request is handled as if it were received on its own, the update cache and
+ * command queue reference the batch PDU for each of them.
+ *
+ * @param self The server connection handler.
+ * @param svrSock The server socket used to send possible validation request
+ *                receipts
+ * @param client The client instance where the packet was received on
+ * @param pdu The PDU buffer containing the verify batch. It MUST be validated
+ *            already.
+ *
+ * @return false if an internal (fatal) error occurred, otherwise true.
+ *
+ * @since 0.6.0
+ */
+static bool processValidationBatch(ServerConnectionHandler* self,
+                                   ServerSocket* svrSock, ClientThread* client,
+                                   PDU_Buffer* pdu)
+{
+  SRXPROXY_VERIFY_BATCH* batch = (SRXPROXY_VERIFY_BATCH*)pdu->data;
+  SRXRPOXY_BasicHeader_VerifyRequest* hdr = NULL;
+  uint8_t* ptr = pdu->data + sizeof(SRXPROXY_VERIFY_BATCH);
+  uint32_t noRequests = ntohl(batch->noRequests);
+  uint32_t idx;
+
+  LOG(LEVEL_DEBUG, HDR "Received verify batch with %u requests", pthread_self(),
+                   noRequests);
+  for (idx = 0; idx < noRequests; idx++)
+  {
+    hdr  = (SRXRPOXY_BasicHeader_VerifyRequest*)ptr;
+    // Determine the next request before the flags get modified.
+    ptr += ntohl(hdr->length);
+    if (!processValidationRequest(self, svrSock, client, hdr, pdu))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 /**
  * SRx receives a packet from one of the proxy clients. This method is called
  * before the command handler will see the request. This will be decided in this
@@ -937,14 +1102,14 @@ static bool processSignatureRequest(ServerConnectionHandler* self,
  *
  * @param svrSock The server socket
  * @param client  The client thread where the packet was received on
- * @param packet  The packet itself
- * @param length  length The length of the packet received
+ * @param pdu     The PDU buffer containing the packet
  * @param srvConHandler The pointer to the sever connection handler.
  */
 void _handlePacket(ServerSocket* svrSock, ServerClient* client,
-                         void* packet, PacketLength length,
-                         void* srvConHandler)
+                   PDU_Buffer* pdu, void* srvConHandler)
 {
+  void*        packet = pdu->data;
+  PacketLength length = pdu->length;
   LOG(LEVEL_DEBUG, HDR "Enter handlePacket", pthread_self());
   ServerConnectionHandler* self  = (ServerConnectionHandler*)srvConHandler;
   SRXPROXY_BasicHeader*    bhdr  = NULL;
@@ -995,7 +1160,7 @@ void _handlePacket(ServerSocket* svrSock, ServerClient* client,
           // This is done because within this process SRx calculates already the
           // UpdateID and adds it to the command item.
           if (!processValidationRequest(self, svrSock, clientThread,
-                                   (SRXRPOXY_BasicHeader_VerifyRequest*)packet))
+                               (SRXRPOXY_BasicHeader_VerifyRequest*)packet, pdu))
           {
             sendError(SRXERR_INTERNAL_ERROR, svrSock, client, false);
             sendGoodbye(svrSock, client, false);
@@ -1005,6 +1170,29 @@ void _handlePacket(ServerSocket* svrSock, ServerClient* client,
         }
 //#endif
         break;
+      case PDU_SRXPROXY_VERIFY_BATCH:
+        if (!clientThread->initialized)
+        {
+          // A handshake was not performed, otherwise the clientThread would be
+          // initialized!!!
+          RAISE_SYS_ERROR("Connection not initialized yet - "
+                          "Handshake missing!!!");
+          sendError(SRXERR_INTERNAL_ERROR, svrSock, client, false);
+          sendGoodbye(svrSock, client, false);
+        }
+        else if (!_isValidVerifyBatch((SRXPROXY_VERIFY_BATCH*)packet, length))
+        {
+          RAISE_ERROR("Invalid verify batch received from proxy [0x%08X]",
+                      clientThread->proxyID);
+          sendError(SRXERR_INVALID_PACKET, svrSock, client, false);
+          sendGoodbye(svrSock, client, false);
+        }
+        else if (!processValidationBatch(self, svrSock, clientThread, pdu))
+        {
+          sendError(SRXERR_INTERNAL_ERROR, svrSock, client, false);
+          sendGoodbye(svrSock, client, false);
+        }
+        break;
       case PDU_SRXPROXY_SIGN_REQUEST:
         if (!clientThread->initialized)
         {
@@ -1025,7 +1213,7 @@ void _handlePacket(ServerSocket* svrSock, ServerClient* client,
           LOG(LEVEL_DEBUG, HDR "Received signature request fore update [0x%08X]",
                            pthread_self(), ntohl(srHdr->updateIdentifier));
           if (!processSignatureRequest(self, svrSock, client,
-                                       ntohl(srHdr->updateIdentifier), srHdr))
+                                       ntohl(srHdr->updateIdentifier), pdu))
           {
             sendError(SRXERR_INTERNAL_ERROR, svrSock, client, false);
             sendGoodbye(svrSock, client, false);
@@ -1105,8 +1293,8 @@ void _handlePacket(ServerSocket* svrSock, ServerClient* client,
     {
       // Whatever SRX packet except validation and signature request. It will
       // be added to the command queue for further processing.
-      queueCommand(self->cmdQueue, COMMAND_TYPE_SRX_PROXY, svrSock, client,
-                   dataID, length, (uint8_t*)packet);
+      queueCommandPDU(self->cmdQueue, COMMAND_TYPE_SRX_PROXY, svrSock, client,
+                      dataID, pdu, pdu->length, pdu->data);
     }
   }
   LOG(LEVEL_DEBUG, HDR "Exit handlePacket", pthread_self());
@@ -1137,9 +1325,21 @@ void handlePacket(ServerSocket* svrSock, ServerClient* client,
   // Preparation for receiver queue
   ServerConnectionHandler* handler = (ServerConnectionHandler*)srvConHandler;
   SCH_ReceiverQueue* queue = (SCH_ReceiverQueue*)handler->receiverQueue;
+  PDU_Buffer* pdu = NULL;
   if (queue == NULL)
   {
-    _handlePacket(svrSock, client, packet, length, srvConHandler);
+    // The socket reuses its receive buffer, keep the packet in a PDU buffer
+    // which can be referenced by the update cache and command queue.
+    pdu = copyToPDUBuffer(packet, length);
+    if (pdu == NULL)
+    {
+      RAISE_SYS_ERROR("Not enough memory to process the received packet!");
+    }
+    else
+    {
+      _handlePacket(svrSock, client, pdu, srvConHandler);
+      releasePDUBuffer(pdu);
+    }
   }
   else
   {
@@ -1190,6 +1390,8 @@ static bool handleStatusChange(ServerSocket* svrSock, ServerClient* client,
           "from client list!", self->proxyMap[clientThread->routerID].proxyID);
     }
 
+    // Drop all PDUs still queued for this client before it is released.
+    removeClientFromSendQueue(client);
     deleteFromSList(&self->clients, client);
 
     bool crashed = !(self->inShutdown || clientThread->goodByeReceived);
@@ -1217,8 +1419,9 @@ void startProcessingRequests(ServerConnectionHandler* self,
 {
   LOG(LEVEL_DEBUG, HDR "Enter startProcessingRequests", pthread_self());
   self->cmdQueue = cmdQueue;
-  runServerLoop(&self->svrSock, MODE_SINGLE_CLIENT, handlePacket,
-                handleStatusChange, self);
+  runServerLoop(&self->svrSock, self->sysConfig->mode_epoll 
+                                ? MODE_REACTOR_CLIENTS : MODE_SINGLE_CLIENT, 
+                handlePacket, handleStatusChange, self);
   LOG(LEVEL_DEBUG, HDR "Exit startProcessingRequests", pthread_self());
 }
 
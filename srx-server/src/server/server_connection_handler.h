@@ -84,7 +84,8 @@ typedef struct {
    * connection was reported lost (crashed).*/
   __time_t crashed;
   /** Number of updates assigned to this client. This allows a more efficient
-   * cleanup. */
+   * cleanup. Modified with atomic operations only, the update cache shards
+   * do not share a lock. */
   uint32_t updateCount;  
 } ProxyClientMapping;
 
@@ -25,36 +25,24 @@
  * are NULL. entry functions specified in the header file do take cate of that.
  * 
  * 
- * The internal Cache structure is build along the AS number
+ * The internal Cache structure is a hash table of <ASN, SKI, AlgoID> triplets.
  * 
- * The AS number is split into 2 word buckets.
- *             +--------+--------+--------+--------+
- * 4 Byte ASN  |      upper      |       AS2       |
- *             +--------+--------+--------+--------+
- * 
- * Most ASN's currently are in the AS2 bucket only 0x0000[0000] - 0x0000[FFFF]
- * The upper (left) bucket is relatively un-used. For each bit in the upper 
- * bucket, the cache reserves a 64K array for AS2. To keep the memory usage 
- * minimal but still have a speed access the upper uses a single linked list
- * and the AS2 portion a pointer array of 64K elements -> 256K/512K bytes 
- * depending on the pointer size (4 or 8 bytes)
+ * The table is split into _SKI_NO_SHARDS shards, each with its own hash table
+ * and its own lock. The shard is selected by the first bytes of the SKI (a 
+ * SHA-1 hash and therefore well distributed) mixed with the ASN and the 
+ * algorithm ID. Registering a key or an update only locks the shards of the 
+ * triplets involved, one at a time.
  * 
  * The Cache list looks as follows:
  * 
  * [Cache]
  *   |
- * [upper]--->[upper]-->
- *   |      
- * +---+   
- * |AS2|---[AlgoID]--->[AlgoID]--->
- * +---+      |
- * |AS2|  [SKI;ASN;AlgoID]---[UID]--->[UID]--->
- * +---+      |>
- * .   .  [SKI;ASN;AlgoID]---[UID]--->[UID]--->
- * .   .      |>
- * +---+
- * |AS2|
- * +---+
+ * +-----+
+ * |Shard|---[SKI;ASN;AlgoID]--(UID set)
+ * +-----+      |>
+ * |Shard|  [SKI;ASN;AlgoID]--(UID set)
+ * +-----+
+ * .     .
  * 
  * Legend:
  * ===============================
@@ -63,21 +51,28 @@
  * -------------------------------------------------------------------------
  * Cache          | single | _SKI_CACHE
  * -------------------------------------------------------------------------
- * upper          | list   | _SKI_CACHE_NODE, _ski_cache_node (next)
- * -------------------------------------------------------------------------
- * AS2            | array  | _SKI_CACHE_ALGO_ID* [65535] with AS2 as index
- * -------------------------------------------------------------------------
- * AlgoID         | list   | _SKI_CACHE_ALGO_ID, _ski_cache_algo_id (next)
+ * Shard          | array  | _SKI_CACHE_SHARD [_SKI_NO_SHARDS]
  * -------------------------------------------------------------------------
- * SKI;ASN;ALgoID | list   | _SKI_CACHE_DATA, _ski_cache_data (next)
+ * SKI;ASN;ALgoID | hash   | _SKI_CACHE_DATA, hashed by _SKI_CACHE_KEY
  * -------------------------------------------------------------------------
- * UID            | list   | _SKI_CACHE_UPDATEID, _ski_cache_updateid (next)
+ * UID set        | array  | _SKI_UID_SET, open addressing of _SKI_UID_SLOT
  * -------------------------------------------------------------------------
  * 
+ * The update IDs of a triplet are kept in an open addressing hash set which 
+ * grows with the number of updates. Adding and removing an update takes 
+ * constant time regardless how many updates share the same key.
  * 
- * +---+
- * |   |       Array (element)
- * +---+
+ * In addition each registered update keeps the number of keys still missing 
+ * per signature block (_SKI_UPDATE_DATA, hashed by update ID into its own 
+ * shards). A new key only queues the updates whose signature block became
+ * complete, a removed key only queues the updates whose complete signature 
+ * block lost a key. Updates still waiting for other keys are not queued for a
+ * validation that can only fail. The update shards are always locked after 
+ * the shard of a triplet, never the other way around.
+ * 
+ * +-----+
+ * |     |     Array (element)
+ * +-----+
  * 
  * ---  or |   Regular Pointer 
  * 
@@ -108,95 +103,111 @@
 #include <string.h>
 #include <srx/srxcryptoapi.h>
 #include <semaphore.h>
+#include <uthash.h>
 #include "util/log.h"
 #include "shared/srx_identifier.h"
 #include "server/ski_cache.h"
 
-/** The SKI center value. */
-#define _SKI_AS2_ARRAY_SIZE 65536
 /** Max number of algorithm id's per BGPsec update (RFC8205) */
 #define _SKI_MAX_ALGOIDS 2
-/** The size of the SRxUpdateID*/
-#define _SRX_UPDATE_ID_SIZE 4
+/** The number of shards the cache is split into (MUST be a power of 2). */
+#define _SKI_NO_SHARDS   64
+/** The initial number of slots of an update ID set (MUST be a power of 2). */
+#define _SKI_UID_SET_INIT 8
 
 #define _SKI_ERR_CACHE_NULL "RPKI Cache is not initialized (NULL)"
 #define _SKI_ERR_NO_LOCK    "Could not aquire cache lock!"
 #define _SKI_ERR_BGPSEC     "Error during parsing the BGPsec_PATH attribute!"
 
-/** This structure is a single linked list of update id's */
-typedef struct _ski_cache_updateid
+/** A single slot of the update ID set. An unused slot has the update ID 0 
+ * (which is never registered), a slot of a removed update keeps its update ID
+ * with a counter of 0 to not break the probing sequence. */
+typedef struct
 {
-  /** Pointer to the next update id. */
-  struct _ski_cache_updateid* next;
   /** The update id. */
   SRxUpdateID updateID;  
-  /** A counter allowing multiple registrations. */
+  /** A counter allowing multiple registrations (BZ1166). */
   u_int16_t   counter;
-} _SKI_CACHE_UPDATEID;
+} _SKI_UID_SLOT;
+
+/** The set of update id's registered with one cache data element. */
+typedef struct
+{
+  /** The slots (NULL if empty). */
+  _SKI_UID_SLOT* slots;
+  /** The number of slots, always a power of 2 or 0. */
+  u_int32_t      size;
+  /** The number of update id's stored. */
+  u_int32_t      count;
+  /** The number of slots used including slots of removed update id's. */
+  u_int32_t      used;
+} _SKI_UID_SET;
+
+/** The key of a cache data element. Unused bytes MUST be zero because the 
+ * complete structure is hashed. */
+typedef struct
+{
+  /** The ASN in host format */
+  u_int32_t asn;
+  /** The SKI */
+  u_int8_t  ski[SKI_LENGTH];
+  /** The algorithm ID */
+  u_int8_t  algoID;
+  /** Padding, MUST be zero. */
+  u_int8_t  reserved[3];
+} _SKI_CACHE_KEY;
 
 /** This struct represents a single ski cache data element. One for each triplet
  * <SKI/asn/algoid> */
 typedef struct _ski_cache_data
 {
-  /** in case other SKI's are stored as well */
-  struct _ski_cache_data* next;
+  /** The <SKI/asn/algoid> triplet */
+  _SKI_CACHE_KEY key;
   /** number of keys received that use this particular ski and algo and asn 
    * combination (should be very rare). */
-  u_int8_t    counter;
-  /** The ASN of this cache data element */
-  u_int32_t   asn;
-  /** The SKI of this element */
-  u_int8_t    ski[SKI_LENGTH];
-  /** The algorithm ID */
-  u_int8_t    algoID;
-  /** List of updates assigned to this data element */
-  _SKI_CACHE_UPDATEID* cacheUID;  
-} _SKI_CACHE_DATA ;
-
-/** This struct is a simple linked list for algorithm ID*/
-typedef struct _ski_cache_algo_id {
-  /** Next algorithm ID */
-  struct _ski_cache_algo_id* next;
-  /** The algorithm ID*/
-  u_int8_t         algoID;  
-  /** The ski cache data */
-  _SKI_CACHE_DATA* cacheData;
-} _SKI_CACHE_ALGO_ID;
-
-/** The cache node if an ordered list of the first 2 bytes. It is expected to 
- * not have many elements. */
-typedef struct _ski_cache_node {
-  /** The next node. The value of next is larger than the value if this. */
-  struct _ski_cache_node* next;  
-  /** The left most 2 bytes of the AN number must match this node. */
-  u_int16_t upper;
-  /** */
-  _SKI_CACHE_ALGO_ID* as2[_SKI_AS2_ARRAY_SIZE];
-} _SKI_CACHE_NODE;
-
-/** This struct is a helper struct that allows to store all elements down 
- * to the leaf. They are the elements used to walk the structure back and
- * can be understood as the "parent" of each element. This structure is 
- * only intended to be used for temporary usage. It will be filled during 
- * the _ski_getCacheData walk and initialized back to all pointers = NULL
- * before _ski_getCacheData returns. 
- * In other words this structure must not be used outside of an
- * ski_lock / ski_unlock block. */
+  u_int8_t       counter;
+  /** Set of updates assigned to this data element */
+  _SKI_UID_SET   updates;
+  /** The hash handle */
+  UT_hash_handle hh;
+} _SKI_CACHE_DATA;
+
+/** A shard of the cache. */
 typedef struct {
-  /** The Cache Node  - contains the upper value */
-  _SKI_CACHE_NODE*    cNode;
-  /** as an additional helper, the position in the as2 array that points to the
-   * first cAlgo instance. */
-  u_int32_t           as2;
-  /** The AlgoID node - contains the algorithm ID */
-  _SKI_CACHE_ALGO_ID* cAlgoID;
-  /** The Data Node   - This is the leaf and contains all information */
-  _SKI_CACHE_DATA*    cData;
-} _SKI_TMP_HELPER;
-
-/** This structure has the same function as the tmp helper, it is used to 
- * store the data gathered while parsing the update. This data is used during 
- * registering and unregistering an update
+  /** The cache data elements of this shard. */
+  _SKI_CACHE_DATA* table;
+  /** The semaphore for access control of this shard. */
+  sem_t            semaphore;
+} _SKI_CACHE_SHARD;
+
+/** The key state of a registered update. The signature blocks are identified
+ * by their algorithm ID. */
+typedef struct _ski_update_data
+{
+  /** The update id. */
+  SRxUpdateID    updateID;
+  /** Number of registrations of the update (BZ1166). */
+  u_int16_t      counter;
+  /** Number of signature blocks with distinct algorithm ID's. */
+  u_int8_t       nrSigBlocks;
+  /** The algorithm ID of each signature block. */
+  u_int8_t       algoID[_SKI_MAX_ALGOIDS];
+  /** The number of keys missing for each signature block. */
+  u_int32_t      missing[_SKI_MAX_ALGOIDS];
+  /** The hash handle */
+  UT_hash_handle hh;
+} _SKI_UPDATE_DATA;
+
+/** A shard of the update key states. */
+typedef struct {
+  /** The update key states of this shard. */
+  _SKI_UPDATE_DATA* table;
+  /** The semaphore for access control of this shard. */
+  sem_t             semaphore;
+} _SKI_UPDATE_SHARD;
+
+/** This structure is used to store the data gathered while parsing the update.
+ * This data is used during registering and unregistering an update
  */
 typedef struct {
   /** The parsing result */
@@ -217,767 +228,716 @@ typedef struct {
 typedef struct {  
   /** The RPKI queue that is used to queue change notifications. */
   RPKI_QUEUE*        rpki_queue;
-  /** The SKI cache root node. */
-  _SKI_CACHE_NODE*   cacheNode;
-  /** The tmpHelper is ONLY be used during walking the data structure. 
-   * It is mainly needed to allow a cleanup of data and MUST be NULL during 
-   * all times outside of the semaphore lock. */
-  _SKI_TMP_HELPER    tmpHelper;
-  /** The tmpBGPsecInfo structure is used to store all information gathered 
-   * during the parsing of the BGPsec+PATH attribute. Here as well the data
-   * must be cleaned prior releasing the semaphore lock. */
-  _SKI_TMP_UPD_INFO  tmpBGPsecInfo;
-  /** The semaphore for access control. */
-  sem_t semaphore;
+  /** The shards of the cache. Multiple shards are always locked in ascending
+   * order. */
+  _SKI_CACHE_SHARD   shards[_SKI_NO_SHARDS];
+  /** The shards of the update key states. They are locked after the shards
+   * above. */
+  _SKI_UPDATE_SHARD  updShards[_SKI_NO_SHARDS];
+  /** The listener informed about key changes (can be NULL). Only modified 
+   * while all shards are locked. */
+  SKI_KEY_LISTENER   keyListener;
+  /** The user data handed to the key listener. */
+  void*              keyListenerUser;
 } _SKI_CACHE;
 
 ////////////////////////////////////////////////////////////////////////////////
-// Data Structure creation and Release
+// Update ID set
 ////////////////////////////////////////////////////////////////////////////////
-static _SKI_CACHE_DATA* ___ski_freeCacheData(_SKI_CACHE_DATA* cData);
 
 /**
- * Frees all memory allocated during creation of this element. It also will 
- * free the memory of uid if not shared!
+ * Return the position the probing for the given update ID starts at.
  * 
- * @param cUID The cache Update data.
+ * @param updateID The update ID
+ * @param size The size of the set (power of 2)
  * 
- * @return Value of the internal next pointer
+ * @return The start position
  */
-static _SKI_CACHE_UPDATEID* ___ski_freeCacheUID(_SKI_CACHE_UPDATEID* cUID)
+static inline u_int32_t ___ski_uidSetStart(SRxUpdateID updateID, u_int32_t size)
 {
-  _SKI_CACHE_UPDATEID* next = NULL;
-  if (cUID != NULL)
-  {
-    next = cUID->next;
-    memset(cUID, 0, sizeof(_SKI_CACHE_UPDATEID));
-    free (cUID);
-  }  
-  
-  return next;          
+  // Fibonacci hashing, update ID's are CRC32 values but might be sequential.
+  return (u_int32_t)(updateID * 2654435761U) & (size - 1);
 }
 
 /**
- * Create a new Update Data list element only if upateID is not NULL and the 
- * value is not zero
+ * Resize the set to the given number of slots and drop the slots of removed
+ * update ID's.
  * 
- * @param updateID The SRx update id to be stored.
+ * @param set The update ID set
+ * @param newSize The new number of slots (power of 2)
  * 
- * @return The ski cache update id or NULL if updateID is NULL or zero
+ * @return false if not enough memory was available.
  */
-static _SKI_CACHE_UPDATEID* ___ski_createCacheUID(SRxUpdateID* updateID)
+static bool ___ski_uidSetResize(_SKI_UID_SET* set, u_int32_t newSize)
 {
-  _SKI_CACHE_UPDATEID* cUID = NULL;
-  if ((updateID != NULL) && (*updateID != 0))
+  _SKI_UID_SLOT* slots = calloc(newSize, sizeof(_SKI_UID_SLOT));
+  u_int32_t      idx, pos;
+  
+  if (slots == NULL)
+  {
+    return false;
+  }
+  
+  for (idx = 0; idx < set->size; idx++)
   {
-    cUID = malloc(sizeof(_SKI_CACHE_UPDATEID));
-    cUID->next = NULL;
-    // Set to the initial value. (BZ 1166)
-    cUID->counter = 1;
-    memcpy(&(cUID->updateID), updateID, LEN_SRxUpdateID);
+    if (set->slots[idx].counter != 0)
+    {
+      pos = ___ski_uidSetStart(set->slots[idx].updateID, newSize);
+      while (slots[pos].updateID != 0)
+      {
+        pos = (pos + 1) & (newSize - 1);
+      }
+      slots[pos] = set->slots[idx];
+    }
   }
+  free(set->slots);
+  set->slots = slots;
+  set->size  = newSize;
+  set->used  = set->count;
   
-  return cUID;          
+  return true;
 }
 
 /**
- * Free all memory allocated with the algorithmID. This includes the complete
- * data tree. This function returns the next algorithmID is it exists.
+ * Find the slot of the given update ID.
  * 
- * @param cAlgoID The algorithm ID tree to be removed.
+ * @param set The update ID set
+ * @param updateID The update ID
  * 
- * @return The value of the next pointer
+ * @return The slot or NULL if the update ID is not registered.
  */
-static _SKI_CACHE_ALGO_ID* ___ski_freeCacheAlgoID(_SKI_CACHE_ALGO_ID* cAlgoID)
+static _SKI_UID_SLOT* ___ski_uidSetFind(_SKI_UID_SET* set, SRxUpdateID updateID)
 {
-  _SKI_CACHE_ALGO_ID* next = NULL;
-  if (cAlgoID != NULL)
+  _SKI_UID_SLOT* slot = NULL;
+  u_int32_t      pos;
+  
+  if (set->count != 0)
   {
-    next = cAlgoID->next;
-    while (cAlgoID->cacheData != NULL)
+    pos = ___ski_uidSetStart(updateID, set->size);
+    while (set->slots[pos].updateID != 0)
     {
-      cAlgoID->cacheData = ___ski_freeCacheData(cAlgoID->cacheData);
+      if (set->slots[pos].updateID == updateID)
+      {
+        // A removed update ID is stored only once as well.
+        slot = (set->slots[pos].counter != 0) ? &set->slots[pos] : NULL;
+        break;
+      }
+      pos = (pos + 1) & (set->size - 1);
     }
-    
-    memset (cAlgoID, 0, sizeof(_SKI_CACHE_ALGO_ID));
-    free (cAlgoID);
   }
-  return next;
+  
+  return slot;
 }
 
 /**
- * Create a cache algorithm id list
+ * Add the given update identifier to the set. If the update ID is already 
+ * registered its counter is incremented (BZ1166).
  * 
- * @param algoID the algorithm identifier of the data node
- *
- * @return the algorithm ID
+ * @param set The update ID set
+ * @param updateID The update identifier (not 0)
+ * 
+ * @return false if not enough memory was available.
  */
-static _SKI_CACHE_ALGO_ID* ___ski_createCacheAlgoID(u_int8_t algoID)
+static bool ___ski_uidSetAdd(_SKI_UID_SET* set, SRxUpdateID updateID)
 {
-  _SKI_CACHE_ALGO_ID* cAlgoID = malloc(sizeof(_SKI_CACHE_ALGO_ID));
+  u_int32_t      pos;
   
-  memset (cAlgoID, 0, sizeof(_SKI_CACHE_ALGO_ID));  
-  cAlgoID->algoID = algoID;
+  // Keep the load factor (including removed slots) below 3/4.
+  if (((set->used + 1) * 4) > (set->size * 3))
+  {
+    // Double only if the set is really filled, otherwise just clean up.
+    u_int32_t newSize = (set->size == 0) ? _SKI_UID_SET_INIT : set->size;
+    if (((set->count + 1) * 2) > newSize)
+    {
+      newSize *= 2;
+    }
+    if (!___ski_uidSetResize(set, newSize))
+    {
+      return false;
+    }
+  }
+  
+  pos = ___ski_uidSetStart(updateID, set->size);
+  while (set->slots[pos].updateID != 0)
+  {
+    if (set->slots[pos].updateID == updateID)
+    {
+      if (set->slots[pos].counter == 0)
+      {
+        // Re-use the slot of the removed registration.
+        set->count++;
+      }
+      set->slots[pos].counter++;
+      return true;
+    }
+    pos = (pos + 1) & (set->size - 1);
+  }
   
-  return cAlgoID;
+  set->slots[pos].updateID = updateID;
+  set->slots[pos].counter  = 1;
+  set->count++;
+  set->used++;
+  
+  return true;
 }
 
 /**
- * Free this given cache data object including all assigned update id's
+ * Remove one registration of the update ID from the set.
  * 
- * @param data The cache data to be removed
+ * @param set The update ID set
+ * @param updateID The update identifier
  * 
- * @return The value of the next pointer.
+ * @return false if the update ID was not registered.
  */
-static _SKI_CACHE_DATA* ___ski_freeCacheData(_SKI_CACHE_DATA* cData)
+static bool ___ski_uidSetRemove(_SKI_UID_SET* set, SRxUpdateID updateID)
 {
-  _SKI_CACHE_DATA* next = NULL;
+  _SKI_UID_SLOT* slot = ___ski_uidSetFind(set, updateID);
   
-  if (cData != NULL)
+  if (slot != NULL)
   {
-    // Store the next pointer
-    next = cData->next;
-    // Remove all update ids.
-    while (cData->cacheUID != NULL)
+    slot->counter--;
+    if (slot->counter == 0)
     {
-      cData->cacheUID = ___ski_freeCacheUID(cData->cacheUID);
+      set->count--;
+      if (set->count == 0)
+      {
+        // Release the memory, most keys are used by a few updates only.
+        free(set->slots);
+        memset(set, 0, sizeof(_SKI_UID_SET));
+      }
     }
-    memset (cData, 0, sizeof(_SKI_CACHE_DATA));
-    free (cData);
   }
   
-  return next;
+  return slot != NULL;
+}
+
+/**
+ * Remove all update ID's from the set and release its memory.
+ * 
+ * @param set The update ID set
+ */
+static void ___ski_uidSetClear(_SKI_UID_SET* set)
+{
+  free(set->slots);
+  memset(set, 0, sizeof(_SKI_UID_SET));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Data Structure creation and Release
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Free this given cache data object including all assigned update id's
+ * 
+ * @param cData The cache data to be removed
+ */
+static void ___ski_freeCacheData(_SKI_CACHE_DATA* cData)
+{
+  ___ski_uidSetClear(&cData->updates);
+  memset (cData, 0, sizeof(_SKI_CACHE_DATA));
+  free (cData);
 }
 
 /**
  * Create a cache dataNode
  * 
- * @param asn the ASN of the data node
- * @param ski the ski of the data node
- * @param algoID the algorithm identifier of the data node
- * @param updateID The update identifier (can be NULL)
+ * @param key the <asn, ski, algoID> triplet of the data node
  *
- * @return the SKI cache data
+ * @return the SKI cache data or NULL if not enough memory was available.
  */
-static _SKI_CACHE_DATA* ___ski_createCacheData(u_int32_t asn, 
-                                               u_int8_t* ski, u_int8_t algoID, 
-                                               SRxUpdateID* updateID)
+static _SKI_CACHE_DATA* ___ski_createCacheData(_SKI_CACHE_KEY* key)
 {
   _SKI_CACHE_DATA* cData = malloc(sizeof(_SKI_CACHE_DATA));
-  memset (cData, 0, sizeof(_SKI_CACHE_DATA));
-  
-  cData->asn    = asn;
-  cData->algoID = algoID;
-  memcpy(cData->ski, ski, SKI_LENGTH);
-  if (updateID != NULL)
+  if (cData != NULL)
   {
-    cData->cacheUID = ___ski_createCacheUID(updateID);
+    memset (cData, 0, sizeof(_SKI_CACHE_DATA));
+    memcpy(&cData->key, key, sizeof(_SKI_CACHE_KEY));
   }
    
   return cData;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Cleanup functions
+////////////////////////////////////////////////////////////////////////////////
 /**
- * Free the memory allocated with this cache node and its underlying data 
- * structure. This function returns the value of the next pointer.
- * This function is very expensive.
- * 
- * @param cNode The cache node to be removed/
+ * Clean the given node and return true of it can be removed without loosing 
+ * any other data.
  * 
- * @return the next pointer
+ * @param cData The data object to be cleaned.
+ * @param type The cleanup type
  */
-static _SKI_CACHE_NODE* ___ski_freeCacheNode(_SKI_CACHE_NODE* cNode)
+static bool ___ski_clean_cData(_SKI_CACHE_DATA* cData, e_SKI_clean type)
 {
-  _SKI_CACHE_NODE* next = NULL;
-  
-  if (cNode != NULL)
+  switch (type)
   {
-    next = cNode->next;
-    int idx = 0;
-    for (idx = 0; idx < _SKI_AS2_ARRAY_SIZE; idx ++)
-    {
-      while (cNode->as2[idx] != NULL)
-      {
-        cNode->as2[idx] = ___ski_freeCacheAlgoID(cNode->as2[idx]);
-      }
-    }
+    case SKI_CLEAN_ALL:
+      cData->counter = 0;
+      ___ski_uidSetClear(&cData->updates);
+      break;
+    case SKI_CLEAN_KEYS:
+      cData->counter = 0;
+      break;
+    case SKI_CLEAN_UPDATES:
+      ___ski_uidSetClear(&cData->updates);
+      break;
+    case SKI_CLEAN_NONE:
+      // Garbage collection only
+      break;
+    default:
+      LOG(LEVEL_ERROR, "Unknown Cleaning Type [%i]", type);
+      break;
   }
-  // wipe memory
-  memset(cNode, 0, sizeof(_SKI_CACHE_NODE));
-  free(cNode);
   
-  return next;
+  // If no further data exist, report as can be freed.
+  return (cData->counter == 0) && (cData->updates.count == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Data Retrieval and Data Storing
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Fill the key of the given <asn,ski,algoid> triplet.
+ * 
+ * @param key The key to be filled.
+ * @param asn The ASN in host format.
+ * @param ski The SKI
+ * @param algoID The algorithm identifier
+ */
+static void _ski_setKey(_SKI_CACHE_KEY* key, u_int32_t asn, u_int8_t* ski, 
+                        u_int8_t algoID)
+{
+  memset(key, 0, sizeof(_SKI_CACHE_KEY));
+  key->asn    = asn;
+  key->algoID = algoID;
+  memcpy(key->ski, ski, SKI_LENGTH);
 }
 
 /**
- * Generate a new cache node.
+ * Return the shard the given key is stored in.
  * 
- * @param upper the upper value of the ASN if the cache node
+ * @param sCache The SKI cache
+ * @param key The key
  * 
- * @return The cache node.
+ * @return The shard
  */
-static _SKI_CACHE_NODE* ___ski_createCacheNode(u_int16_t upper)
+static _SKI_CACHE_SHARD* _ski_getShard(_SKI_CACHE* sCache, _SKI_CACHE_KEY* key)
 {
-  _SKI_CACHE_NODE* cNode = malloc(sizeof(_SKI_CACHE_NODE));
+  u_int32_t hash;
   
-  memset (cNode, 0, sizeof(_SKI_CACHE_NODE));
-  cNode->upper = upper;
+  // The SKI is a SHA-1 hash, its first bytes are sufficiently distributed.
+  memcpy(&hash, key->ski, sizeof(u_int32_t));
+  hash ^= key->asn ^ key->algoID;
+  hash *= 2654435761U;
   
-  return cNode;
+  return &sCache->shards[(hash >> 16) & (_SKI_NO_SHARDS - 1)];
 }
 
-////////////////////////////////////////////////////////////////////////////////
-// Cleanup functions
-////////////////////////////////////////////////////////////////////////////////
 /**
- * Clean the given node and return true of it can be removed without loosing 
- * any other data.
+ * Set the Semaphore lock of the shard
  * 
- * @param cData The data object to be cleaned.
- * @param type The cleanup type
+ * @param shard the shard whose access is locked.
+ * 
+ * @return false if an error occurred
  */
-bool ___ski_clean_cData(_SKI_CACHE_DATA* cData, e_SKI_clean type)
+static bool _ski_lock(_SKI_CACHE_SHARD* shard)
 {
-  bool canFree = false;
-  
-  if (cData != NULL)
-  {
-    switch (type)
-    {
-      case SKI_CLEAN_ALL:
-        cData->counter = 0;
-        while (cData->cacheUID != NULL)
-        {
-          cData->cacheUID = ___ski_freeCacheUID(cData->cacheUID);
-        }
-        break;
-      case SKI_CLEAN_KEYS:
-        cData->counter = 0;
-        break;
-      case SKI_CLEAN_UPDATES:
-        while (cData->cacheUID != NULL)
-        {
-          cData->cacheUID = ___ski_freeCacheUID(cData->cacheUID);
-        }
-      default:
-        LOG(LEVEL_ERROR, "Unknown Cleaning Type [%i]", type);
-        break;
-    }
-    // If no further data exist, report as can be freed.
-    canFree = (cData->counter == 0) && (cData->cacheUID == NULL);
-  }
-          
-  return canFree;
+  // Maybe use the sem_wait_wrapper which expires after some time
+  return sem_wait(&shard->semaphore) == 0;
 }
 
 /**
- * Clean all elements connected to this algorithm ID if possible.
+ * Release the Semaphore lock of the shard
  * 
- * @param cAlgoID the algorithm ID object to be cleaned.
- * @param type The type of cleaning.
+ * @param shard the shard whose access will be unlocked.
  * 
- * @return true if this element can be freed and false if still some data is 
- *         attached.
+ * @return false if an error occurred
  */
-bool ___ski_clean_cAlgoID(_SKI_CACHE_ALGO_ID* cAlgoID, e_SKI_clean type)
+static bool _ski_unlock(_SKI_CACHE_SHARD* shard)
 {
-  bool canFree = false;
+  return sem_post(&shard->semaphore) == 0;
+}
 
-  // if we want to clean something, give it the first element to clean
-  _SKI_CACHE_DATA* cData = type == SKI_CLEAN_NONE ? NULL : cAlgoID->cacheData;
-  _SKI_CACHE_DATA* prev = NULL;
-  
-  while (cData != NULL)
+/**
+ * Lock all shards in ascending order, followed by all update shards.
+ * 
+ * @param sCache The SKI cache
+ */
+static void _ski_lockAll(_SKI_CACHE* sCache)
+{
+  int idx;
+  for (idx = 0; idx < _SKI_NO_SHARDS; idx++)
   {
-    if (!___ski_clean_cData(cData, type))
-    {
-      prev  = cData;
-      cData = cData->next;
-    }
-    else
-    {
-      // can be freed.
-      cData = ___ski_freeCacheData(cData);
-      if (prev != NULL)
-      {
-        prev->next = cData;
-      }
-      else
-      {
-        cAlgoID->cacheData = cData;
-      }
-    }  
+    _ski_lock(&sCache->shards[idx]);
   }
-  
-  if (cAlgoID->cacheData == NULL)
+  for (idx = 0; idx < _SKI_NO_SHARDS; idx++)
   {
-    canFree = true;
+    sem_wait(&sCache->updShards[idx].semaphore);
   }
-  
-  return canFree;
 }
 
 /**
- * Clean all elements connected to this Data Node if possible.
- * 
- * @param cNode The Cache node to be examined.
- * @param type The cleaning type
+ * Unlock all update shards and all shards.
  * 
- * @return true if no other data is stored and this element can be freed
+ * @param sCache The SKI cache
  */
-bool ___ski_clean_cNode(_SKI_CACHE_NODE* cNode, e_SKI_clean type)
+static void _ski_unlockAll(_SKI_CACHE* sCache)
 {
-  bool canFree = true;
-  
-  _SKI_CACHE_ALGO_ID* prev    = NULL;
-  _SKI_CACHE_ALGO_ID* cAlgoID = NULL;
-  
-  int idx = 0;
-  for (; idx < _SKI_AS2_ARRAY_SIZE; idx++)
-  {    
-    prev    = NULL;
-    cAlgoID = cNode->as2[idx];
-    while (cAlgoID != NULL)
-    {
-      if (___ski_clean_cAlgoID(cAlgoID, type))
-      {
-        cAlgoID = ___ski_freeCacheAlgoID(cAlgoID);
-        if (prev == NULL)
-        {
-          // This is the head
-          cNode->as2[idx] = cAlgoID;
-        }
-        else
-        {
-          // repoint the previous next pointer.
-          prev->next = cAlgoID;
-        }
-        continue;
-      }
-      
-      prev = cAlgoID;
-      cAlgoID = cAlgoID->next;
-    }
-    if (cNode->as2[idx] != NULL)
-    {
-      canFree = false;
-    }
+  int idx;
+  for (idx = _SKI_NO_SHARDS - 1; idx >= 0; idx--)
+  {
+    sem_post(&sCache->updShards[idx].semaphore);
+  }
+  for (idx = _SKI_NO_SHARDS - 1; idx >= 0; idx--)
+  {
+    _ski_unlock(&sCache->shards[idx]);
   }
-  
-  
-  
-  return canFree;
 }
-////////////////////////////////////////////////////////////////////////////////
-// Data Retrieval and Data Storing
-////////////////////////////////////////////////////////////////////////////////
 
 /**
- * Return the correct Cache Node or NULL if none is found. If create is set to 
- * true then a new one is created if none exists.
+ * Return the cache data that matches this given key. This function also 
+ * generates the cache data element if not existing and the parameter 'create' 
+ * is set to true. The caller holds the lock of the shard.
  * 
- * @param sCache The cache where the cache node is located in 
- * @param upper The upper two bytes of the as number.
- * @param create If true create a new one if it does not exist.
+ * @param shard The shard of the key.
+ * @param key The <asn, ski, algoID> triplet
+ * @param create if true the object will be created if it does not exist 
+ *        already.
  * 
- * @return The cache node or NULL if none is found.
+ * @return the cache data object or NULL.
  */
-static _SKI_CACHE_NODE* __ski_getCacheNode(_SKI_CACHE* sCache, u_int16_t upper, 
-                                           bool create)
+static _SKI_CACHE_DATA* _ski_getCacheData(_SKI_CACHE_SHARD* shard, 
+                                          _SKI_CACHE_KEY* key, bool create)
 {
-  /** The cache node. */
-  _SKI_CACHE_NODE* cNode = NULL;
-  _SKI_CACHE_NODE* prev = NULL;
-  bool found = false;
+  _SKI_CACHE_DATA* cData = NULL;
   
-  if (sCache->cacheNode != NULL)
-  {
-    cNode = sCache->cacheNode;
-  }
-  else if (create)
+  HASH_FIND(hh, shard->table, key, sizeof(_SKI_CACHE_KEY), cData);
+  if ((cData == NULL) && create)
   {
-    sCache->cacheNode = ___ski_createCacheNode(upper);
-    cNode             = sCache->cacheNode;
-    found             = true;
-  }
-
-  while (!found && (cNode != NULL))
-  {      
-    if (upper < cNode->upper)
+    cData = ___ski_createCacheData(key);
+    if (cData != NULL)
     {
-      // OK we need to insert a new node
-      if (create)
-      {
-        cNode = ___ski_createCacheNode(upper);
-        if (prev != NULL)
-        {
-          cNode->next = prev->next;            
-          prev->next  = cNode;
-        }
-        else
-        {
-          cNode->next       = sCache->cacheNode;
-          sCache->cacheNode = cNode;
-        }
-        found = true;
-      }
-      else
-      {
-        cNode = NULL;
-      }
-      continue;
-    }
-    if (upper == cNode->upper)
-    {
-      found = true;
-      continue;
-    }
-    prev = cNode;
-    if (cNode->next == NULL)
-    {
-      if (create)
-      {
-        cNode->next = ___ski_createCacheNode(upper);
-        found = true;
-      }
+      HASH_ADD(hh, shard->table, key, sizeof(_SKI_CACHE_KEY), cData);
     }
-    cNode = cNode->next;
-  }    
+  }
   
-  if (!found)
+  return cData;
+}
+
+/**
+ * Remove the cache data element from the shard if neither keys nor updates are
+ * registered with it. The caller holds the lock of the shard.
+ * 
+ * @param shard The shard of the cache data element.
+ * @param cData The cache data element.
+ */
+static void _ski_removeIfEmpty(_SKI_CACHE_SHARD* shard, _SKI_CACHE_DATA* cData)
+{
+  if ((cData->counter == 0) && (cData->updates.count == 0))
   {
-    // cNode should be NULL if not found, so this line is not really necessary
-    // but left it just in case.
-    cNode = NULL;
+    HASH_DEL(shard->table, cData);
+    ___ski_freeCacheData(cData);
   }
-  
-  return cNode;
 }
 
 /**
- * Add the given update udentifier to the cache data object
+ * Return the shard the key state of the given update is stored in.
+ * 
+ * @param sCache The SKI cache
+ * @param updateID The update ID
+ * 
+ * @return The shard
+ */
+static _SKI_UPDATE_SHARD* _ski_getUpdShard(_SKI_CACHE* sCache, 
+                                           SRxUpdateID updateID)
+{
+  return &sCache->updShards[((updateID * 2654435761U) >> 16) 
+                            & (_SKI_NO_SHARDS - 1)];
+}
+
+/**
+ * Set the Semaphore lock of the update shard
+ * 
+ * @param shard the shard whose access is locked.
  * 
- * @param cacheData The cache data object
- * @param updateID the update identifier
- * @param shared specifies if this identifier is shared.
+ * @return false if an error occurred
  */
-static void __ski_addUpdateCacheUID(_SKI_CACHE_DATA* cacheData, 
-                                    SRxUpdateID* updateID)
+static bool _ski_lockUpd(_SKI_UPDATE_SHARD* shard)
 {
-  _SKI_CACHE_UPDATEID* cUID = NULL;
-  _SKI_CACHE_UPDATEID* prev = NULL;
-  bool added = false;
-  int cmp = 0;
+  return sem_wait(&shard->semaphore) == 0;
+}
 
-  if (cacheData != NULL)
+/**
+ * Release the Semaphore lock of the update shard
+ * 
+ * @param shard the shard whose access will be unlocked.
+ * 
+ * @return false if an error occurred
+ */
+static bool _ski_unlockUpd(_SKI_UPDATE_SHARD* shard)
+{
+  return sem_post(&shard->semaphore) == 0;
+}
+
+/**
+ * Return the index of the signature block with the given algorithm ID.
+ * 
+ * @param uData The update key state
+ * @param algoID The algorithm ID
+ * 
+ * @return The index or -1 if the update has no such signature block.
+ */
+static int ___ski_updBlock(_SKI_UPDATE_DATA* uData, u_int8_t algoID)
+{
+  int idx;
+  
+  for (idx = 0; idx < uData->nrSigBlocks; idx++)
   {
-    if (cacheData->cacheUID == NULL)
-    {
-      cacheData->cacheUID = ___ski_createCacheUID(updateID);
-      added = true;
-    }    
-    cUID = cacheData->cacheUID;
-    // Compare only the path validation section.
-    while (!added)
+    if (uData->algoID[idx] == algoID)
     {
-      cmp = compareSrxUpdateID(updateID, &cUID->updateID, SRX_UID_PV);
-      if (cmp != 0)
-      {
-        if (cmp < 0)
-        {
-          // we need to insert the update ID
-          cUID = ___ski_createCacheUID(updateID);
-          if (prev != NULL)
-          {
-            // Insert before this one
-            cUID->next = prev->next;
-            prev->next = cUID;
-          }
-          else
-          {
-            cUID->next = cacheData->cacheUID;
-            cacheData->cacheUID = cUID;
-          }
-          added = true;
-        }
-        else
-        {
-          if (cUID->next == NULL)
-          {
-            cUID->next = ___ski_createCacheUID(updateID);
-            added = true;                    
-          }
-          prev = cUID;
-          cUID = cUID->next;                    
-        }
-      }
-      else
-      {
-        // already added
-        cUID->counter++; // BZ1166
-        added = true;  
-      }
+      return idx;
     }
   }
+  
+  return -1;
 }
 
 /**
- * Find the algorithm id for te given cache node. If create is set to true and
- * no algorithm identifier exists this function will create a new one.
+ * Determine if all keys of at least one signature block are registered.
  * 
- * @param cacheNode the cache node the algorithm identifier belongs too.
- * @param as2 the lower 2 bytes of the asn (old AS2 value).
- * @param algoID the algorithm identifier
- * @param create if true a new one will be generated if none exists.
+ * @param uData The update key state
  * 
- * @return The algorithm identifier or NULL is none is found.
+ * @return true if the update can be validated.
  */
-static _SKI_CACHE_ALGO_ID* __ski_getCacheAlgoID(_SKI_CACHE_NODE* cacheNode, 
-                                                 u_int16_t as2, u_int8_t algoID, 
-                                                 bool create)
+static bool ___ski_updComplete(_SKI_UPDATE_DATA* uData)
 {
-  /** The Cache algorithm identifier */
-  _SKI_CACHE_ALGO_ID* cAlgoID = NULL;
-  _SKI_CACHE_ALGO_ID* prev;
-  bool found = false;
+  int idx;
   
-  if (cacheNode != NULL)
+  for (idx = 0; idx < uData->nrSigBlocks; idx++)
   {
-    if (cacheNode->as2[as2] != NULL)
+    if (uData->missing[idx] == 0)
     {
-      cAlgoID = cacheNode->as2[as2];
+      return true;
     }
-    else if (create)
+  }
+  
+  return false;
+}
+
+/**
+ * Change the number of missing keys of the update's signature block with the 
+ * given algorithm ID.
+ * 
+ * @param sCache The SKI cache
+ * @param updateID The update ID
+ * @param algoID The algorithm ID of the signature block
+ * @param delta The change of missing keys (negative for keys that arrived)
+ * @param wasComplete OUT - true if no key of the signature block was missing 
+ *                    before the change (can be NULL). 
+ * 
+ * @return true if no key of the signature block is missing after the change.
+ *         Unknown updates are reported as complete.
+ */
+static bool _ski_changeMissing(_SKI_CACHE* sCache, SRxUpdateID updateID,
+                               u_int8_t algoID, int delta, bool* wasComplete)
+{
+  _SKI_UPDATE_SHARD* uShard = _ski_getUpdShard(sCache, updateID);
+  _SKI_UPDATE_DATA*  uData  = NULL;
+  bool               before = true;
+  bool               after  = true;
+  int                block;
+  
+  _ski_lockUpd(uShard);
+  HASH_FIND(hh, uShard->table, &updateID, sizeof(SRxUpdateID), uData);
+  block = (uData != NULL) ? ___ski_updBlock(uData, algoID) : -1;
+  if (block >= 0)
+  {
+    before = uData->missing[block] == 0;
+    if ((delta < 0) && (uData->missing[block] < (u_int32_t)-delta))
     {
-      cacheNode->as2[as2] = ___ski_createCacheAlgoID(algoID);
-      found = true;
-      cAlgoID = cacheNode->as2[as2];
-    }            
-    
-    // Now we found an algorithm ID bin, go to the correct one.
-    while (!found && (cAlgoID != NULL))
+      LOG(LEVEL_WARNING, "Inconsistent key state of update 0x%08X!", 
+                         updateID);
+      uData->missing[block] = 0;
+    }
+    else
     {
-      // Most likely the first one is the correct one - especially now where we 
-      // only have one official algorithm identifier.
-      if (cAlgoID->algoID == algoID)
-      {
-        found = true;
-        continue;
-      }
-      if (algoID < cAlgoID->algoID)
-      {
-        // Ok we need to insert one.
-        if (create)
-        {
-          cAlgoID = ___ski_createCacheAlgoID(algoID);
-          if (prev != NULL)
-          {
-            cAlgoID->next = prev->next;
-            prev->next    = cAlgoID;
-          }
-          else
-          {
-            cAlgoID->next       = cacheNode->as2[as2];
-            cacheNode->as2[as2] = cAlgoID;
-          }
-          found = true;
-        }
-        else
-        {
-          cAlgoID = NULL;
-        }
-        continue;
-      }
-      if (cAlgoID->next != NULL)
-      {
-        prev    = cAlgoID;
-      }
-      else
-      {
-        if (create)
-        {
-          cAlgoID->next = ___ski_createCacheAlgoID(algoID);
-          found = true;
-        }
-      }
-      cAlgoID = cAlgoID->next;
-    }    
+      uData->missing[block] += delta;
+    }
+    after = uData->missing[block] == 0;
   }
+  _ski_unlockUpd(uShard);
   
-  if (!found)
+  if (wasComplete != NULL)
   {
-    cAlgoID = NULL;
+    *wasComplete = before;
   }
-          
-  return cAlgoID;
+  
+  return after;
 }
 
 /**
- * Set the Semaphore lock
+ * Add a registration of the update to its key state. All keys of the update 
+ * are counted as missing until they are found while the update is registered
+ * with each SKI.
  * 
- * @param queue the queue whose access is locked.
+ * @param sCache The SKI cache
+ * @param updateID The update ID
+ * @param updInfo The parsed BGPsec_PATH attribute of the update.
  * 
- * @return false if an error occurred
+ * @return false if not enough memory was available.
  */
-static bool _ski_lock(_SKI_CACHE* sCache)
+static bool _ski_addUpdateData(_SKI_CACHE* sCache, SRxUpdateID updateID,
+                               _SKI_TMP_UPD_INFO* updInfo)
 {
-  if (sCache != NULL)
+  _SKI_UPDATE_SHARD* uShard = _ski_getUpdShard(sCache, updateID);
+  _SKI_UPDATE_DATA*  uData  = NULL;
+  int                sbIdx, block;
+  
+  _ski_lockUpd(uShard);
+  HASH_FIND(hh, uShard->table, &updateID, sizeof(SRxUpdateID), uData);
+  if (uData == NULL)
+  {
+    uData = calloc(1, sizeof(_SKI_UPDATE_DATA));
+    if (uData != NULL)
+    {
+      uData->updateID = updateID;
+      // Signature blocks MUST use different algorithms (RFC8205), blocks of
+      // a malformed update with the same algorithm ID are counted as one.
+      for (sbIdx = 0; sbIdx < updInfo->nrSigBlocks; sbIdx++)
+      {
+        if (   (___ski_updBlock(uData, updInfo->algoID[sbIdx]) < 0)
+            && (uData->nrSigBlocks < _SKI_MAX_ALGOIDS))
+        {
+          uData->algoID[uData->nrSigBlocks++] = updInfo->algoID[sbIdx];
+        }
+      }
+      HASH_ADD(hh, uShard->table, updateID, sizeof(SRxUpdateID), uData);
+    }
+  }
+  if (uData != NULL)
   {
-    // Maybe use the sem_wait_wrapper which expires after some time
-    sem_wait(&sCache->semaphore);
-    // or sem_timedwait(...)
+    uData->counter++;
+    for (sbIdx = 0; sbIdx < updInfo->nrSigBlocks; sbIdx++)
+    {
+      block = ___ski_updBlock(uData, updInfo->algoID[sbIdx]);
+      if (block >= 0)
+      {
+        uData->missing[block] += updInfo->nrSegments;
+      }
+    }
   }
+  _ski_unlockUpd(uShard);
   
-  return sCache != NULL;
+  return uData != NULL;
 }
 
 /**
- * Set the Semaphore lock
- * 
- * @param rQueue the queue whose access will be unlocked.
+ * Remove a registration of the update from its key state. The key state is 
+ * removed with the last registration.
  * 
- * @return false if an error occurred
+ * @param sCache The SKI cache
+ * @param updateID The update ID
  */
-static bool _ski_unlock(_SKI_CACHE* sCache)
+static void _ski_removeUpdateData(_SKI_CACHE* sCache, SRxUpdateID updateID)
 {
-  bool retVal = false;
+  _SKI_UPDATE_SHARD* uShard = _ski_getUpdShard(sCache, updateID);
+  _SKI_UPDATE_DATA*  uData  = NULL;
   
-  // The caller assures that rQueue is not NULL  
-  int lockVal;
-  sem_getvalue(&sCache->semaphore, &lockVal);
-  // This checks the binary semaphore (0|1)
-  if (lockVal == 0)
-  {
-    // Maybe use the sem_wait_wrapper which expires after some time
-    sem_post(&sCache->semaphore);
-    retVal = true;
-  }
-  else 
+  _ski_lockUpd(uShard);
+  HASH_FIND(hh, uShard->table, &updateID, sizeof(SRxUpdateID), uData);
+  if ((uData != NULL) && (--uData->counter == 0))
   {
-    LOG(LEVEL_ERROR, "%s called without a previously aquired lock.", 
-                     __func__);
+    HASH_DEL(uShard->table, uData);
+    free(uData);
   }
-  
-  return retVal;
+  _ski_unlockUpd(uShard);
 }
 
 /**
- * Return the cache data that matches this given <asn,ski,algoid> triplet.
- * This function also generates all required cache structure data and cache data 
- * element if not existing and the parameter 'create' is set to true.
- * 
- * In addition this function sets the temporary helper attribute within the 
- * for later usage.
- * 
- * @param cache The cache where to look in.
- * @param asn The ASN of the cache object in host format.
- * @param ski The SKI of the cache object
- * @param algoID The algorithm identifier of the cache object
- * @param uid The SRx UpdateID (can be NULL)
- * @param create if true the object will be created if it does not exist 
- *        already.
- * 
- * @return the cache data object or NULL.
+ * Apply the key change of the cache data element to all updates registered 
+ * with it and queue those updates whose validation result might change. Only 
+ * updates with all keys of the affected signature block registered (before or
+ * after the change) are queued. The caller holds the lock of the element's 
+ * shard.
+ * 
+ * @param sCache The SKI cache
+ * @param cData The cache data element whose key counter changed.
+ * @param status The type of change.
  */
-static _SKI_CACHE_DATA* _ski_getCacheData(_SKI_CACHE* sCache, u_int32_t asn,
-                                          u_int8_t* ski, u_int8_t algoID, 
-                                          bool create)
+static void _ski_keyChanged(_SKI_CACHE* sCache, _SKI_CACHE_DATA* cData,
+                            e_SKI_status status)
 {
-  /** The left most 2 bytes as unsigned word value. */
-  u_int16_t upper = asn >> 16;
-  /** The right most 2 bytes as unsigned word value (former AS2 number). */
-  u_int16_t as2  = asn & 0xFFFF;
-  
-  /** Initialize the helper memory */
-  _SKI_TMP_HELPER* tHlp = &sCache->tmpHelper;
-  memset(tHlp, 0, sizeof(_SKI_TMP_HELPER));  
-  tHlp->cNode   = NULL;
-  tHlp->cAlgoID  = NULL;
-  tHlp->cData    = NULL;
-  _SKI_CACHE_DATA*    prev  = NULL;
-  bool found = false;
-  int  cmp   = 0;
+  _SKI_UID_SLOT* slot;
+  bool           wasComplete = false;
+  bool           queue       = false;
+  u_int32_t      idx;
   
-  // Retrieve the correct CacheNode from the cache. If the node does not exist
-  // yet and create is false, the cacheNODE will be NULL
-  tHlp->cNode = __ski_getCacheNode(sCache, upper, create);
-
-  if (tHlp->cNode != NULL)
-  {
-    // Retrieve the correct algoID list head from the cache. If the node does 
-    // not exist yet and create is false, the cacheAlgoID will be NULL      
-    tHlp->cAlgoID = __ski_getCacheAlgoID(tHlp->cNode, as2, algoID, create);
-  }    
-  
-  if (tHlp->cAlgoID != NULL)
+  for (idx = 0; idx < cData->updates.size; idx++)
   {
-    // Now where we have the entrance point, find the data
-    if (tHlp->cAlgoID->cacheData != NULL)
+    slot = &cData->updates.slots[idx];
+    if (slot->counter == 0)
     {
-      tHlp->cData = tHlp->cAlgoID->cacheData;
+      continue;
     }
-    else
+    switch (status)
     {
-      if (create)
-      {
-        tHlp->cData = ___ski_createCacheData(asn, ski, algoID, NULL);
-        tHlp->cAlgoID->cacheData = tHlp->cData;
-        found = true;
-      }
+      case SKI_NEW:
+        // The signature block can be validated now.
+        queue = _ski_changeMissing(sCache, slot->updateID, cData->key.algoID,
+                                   -slot->counter, NULL);
+        break;
+      case SKI_REMOVED:
+        // The signature block cannot be validated anymore.
+        _ski_changeMissing(sCache, slot->updateID, cData->key.algoID, 
+                           slot->counter, &wasComplete);
+        queue = wasComplete;
+        break;
+      default:
+        // A colliding key was added or removed, this can change the result
+        // of a signature block with all keys registered.
+        queue = _ski_changeMissing(sCache, slot->updateID, cData->key.algoID, 
+                                   0, NULL);
+        break;
     }
-    
-    while (!found && (tHlp->cData != NULL))
+    if (queue)
     {
-      cmp = memcmp(ski, tHlp->cData->ski, SKI_LENGTH);
-      if (cmp < 0)
-      {
-        // We need to insert
-        if (create)
-        {
-          tHlp->cData = ___ski_createCacheData(asn, ski, algoID, NULL);
-          if (prev != NULL)
-          {
-            tHlp->cData->next = prev->next;
-            prev->next  = tHlp->cData;            
-          }
-          else
-          {
-            tHlp->cData->next        = tHlp->cAlgoID->cacheData;
-            tHlp->cAlgoID->cacheData = tHlp->cData;
-          }
-          found = true;
-        }
-        else
-        {
-          tHlp->cData = NULL;
-        }
-        continue;
-      }
-      if (cmp == 0)
-      {
-        found = true;
-        continue;
-      }
-      prev  = tHlp->cData;      
-      tHlp->cData = tHlp->cData->next;
-      if (tHlp->cData == NULL)
-      {
-        if (create)
-        {
-          tHlp->cData = ___ski_createCacheData(asn, ski, algoID, NULL);
-          prev->next  = tHlp->cData;
-          found = true;
-        }
-      }
+      rq_queue(sCache->rpki_queue, RQ_KEY, &slot->updateID);
     }
   }
+}
 
-  if (!found)
+/**
+ * Apply a cleaning of keys to all updates registered with the cache data 
+ * element. The caller holds the locks of all shards.
+ * 
+ * @param sCache The SKI cache
+ * @param cData The cache data element whose keys are removed.
+ */
+static void _ski_keysCleaned(_SKI_CACHE* sCache, _SKI_CACHE_DATA* cData)
+{
+  _SKI_UPDATE_SHARD* uShard;
+  _SKI_UPDATE_DATA*  uData;
+  _SKI_UID_SLOT*     slot;
+  u_int32_t          idx;
+  int                block;
+  
+  for (idx = 0; idx < cData->updates.size; idx++)
   {
-    memset(tHlp, 0, sizeof(_SKI_TMP_HELPER));
+    slot = &cData->updates.slots[idx];
+    if (slot->counter != 0)
+    {
+      uShard = _ski_getUpdShard(sCache, slot->updateID);
+      HASH_FIND(hh, uShard->table, &slot->updateID, sizeof(SRxUpdateID), 
+                uData);
+      block = (uData != NULL) ? ___ski_updBlock(uData, cData->key.algoID) 
+                              : -1;
+      if (block >= 0)
+      {
+        uData->missing[block] += slot->counter;
+      }
+    }
   }
-  
-  return tHlp->cData;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1148,7 +1108,7 @@ static void _ski_parseBGPsec_PATH (_SKI_TMP_UPD_INFO* updInfo,
     
     // Do this for each signature block
     int blockIdx = 0;
-    while (sigBlocks[blockIdx] != NULL)
+    while (blockIdx < updInfo->nrSigBlocks)
     {
       updInfo->algoID[blockIdx] = sigBlocks[blockIdx]->algoID;
       // Move the stream to the signature block
@@ -1194,17 +1154,43 @@ SKI_CACHE* ski_createCache(RPKI_QUEUE* rpki_queue)
 {
   _SKI_CACHE* sCache = NULL;  
   char* errMSG = NULL;
+  int   idx    = 0;
   
   if ( rpki_queue != NULL )
   {
     sCache = malloc(sizeof(_SKI_CACHE));
-    memset (sCache, 0, sizeof(_SKI_CACHE));
-    sCache->rpki_queue = rpki_queue;
-    // Initialize the semaphore, not shared value 1 (binary)
-    if (sem_init(&sCache->semaphore, 0, 1) != 0)
+    if (sCache != NULL)
+    {
+      memset (sCache, 0, sizeof(_SKI_CACHE));
+      sCache->rpki_queue = rpki_queue;
+      // Initialize the semaphores, not shared value 1 (binary)
+      for (; idx < _SKI_NO_SHARDS; idx++)
+      {
+        if (sem_init(&sCache->shards[idx].semaphore, 0, 1) != 0)
+        {
+          break;
+        }
+        if (sem_init(&sCache->updShards[idx].semaphore, 0, 1) != 0)
+        {
+          sem_destroy(&sCache->shards[idx].semaphore);
+          break;
+        }
+      }
+      if (idx < _SKI_NO_SHARDS)
+      {
+        while (--idx >= 0)
+        {
+          sem_destroy(&sCache->shards[idx].semaphore);
+          sem_destroy(&sCache->updShards[idx].semaphore);
+        }
+        free(sCache);
+        sCache = NULL;
+        errMSG = "Could not initialize SKI Cache Lock!";
+      }
+    }
+    else
     {
-      free(sCache);
-      errMSG = "Could not initialize SKI Cache Lock!";
+      errMSG = "Not enough memory to create the SKI Cache!";
     }
   }
   else
@@ -1230,17 +1216,25 @@ SKI_CACHE* ski_createCache(RPKI_QUEUE* rpki_queue)
 bool ski_releaseCache(SKI_CACHE* cache)
 {
   char* errMSG = NULL;
+  int   idx    = 0;
   // first call clean.
   if (cache != NULL)
   {    
     if (ski_clean(cache, SKI_CLEAN_ALL))
     {
       _SKI_CACHE* sCache = (_SKI_CACHE*)cache;    
-      sem_destroy(&sCache->semaphore);
+      for (; idx < _SKI_NO_SHARDS; idx++)
+      {
+        sem_destroy(&sCache->shards[idx].semaphore);
+        sem_destroy(&sCache->updShards[idx].semaphore);
+      }
       memset(sCache, 0, sizeof(_SKI_CACHE));
       free (sCache);
     }
-    errMSG = "Could not clean SKI CACHE during release.";
+    else
+    {
+      errMSG = "Could not clean SKI CACHE during release.";
+    }
   }
   else
   {
@@ -1252,7 +1246,7 @@ bool ski_releaseCache(SKI_CACHE* cache)
     LOG(LEVEL_ERROR, "%s: %s", __func__, errMSG);
   }
   
-  return errMSG != NULL;
+  return errMSG == NULL;
 }
 
 /**
@@ -1284,71 +1278,94 @@ bool ski_releaseCache(SKI_CACHE* cache)
 e_Upd_RegRes ski_registerUpdate(SKI_CACHE* cache, SRxUpdateID* updateID, 
                                 SCA_BGP_PathAttribute* bgpsec)
 {
-  #define _BGPSEC_MAX_SIG_BLOCKS 2
   e_Upd_RegRes retVal = REGVAL_ERROR;
-  
-  LOG(LEVEL_DEBUG, "ski_register %i", *updateID);
-  
   char* errMSG = NULL;
 
   if (cache != NULL)
   {
     _SKI_CACHE* sCache = (_SKI_CACHE*)cache;
-    if (_ski_lock(sCache))
+    if (bgpsec != NULL)
     {
-      _SKI_CACHE_DATA* cData  = NULL;
+      _SKI_TMP_UPD_INFO updInfo;
+      memset(&updInfo, 0, sizeof(_SKI_TMP_UPD_INFO));
+      // Parse the BGPsec+PATH attribute
+      _ski_parseBGPsec_PATH(&updInfo, bgpsec, updateID);
+      retVal = updInfo.status;
 
-      u_int32_t asn;
-      u_int8_t* ski;
-      u_int8_t  algoID;
-
-      if (bgpsec != NULL)
+      if (retVal != REGVAL_ERROR)
       {
-        // Parse the BGPsec+PATH attribute
-        _ski_parseBGPsec_PATH(&sCache->tmpBGPsecInfo, bgpsec, updateID);
-        retVal = sCache->tmpBGPsecInfo.status;
-
-        if (retVal != REGVAL_ERROR)
+        // Update ID 0 is not a valid ID and is never stored.
+        bool              store = (updateID != NULL) && (*updateID != 0);
+        _SKI_CACHE_KEY    key;
+        _SKI_CACHE_SHARD* shard;
+        _SKI_CACHE_DATA*  cData;
+        // The number of keys missing per signature block
+        u_int32_t         missing[_SKI_MAX_ALGOIDS] = { 0, 0 };
+        int sbIdx, segIdx, skiOffset = 0;
+        
+        if (store && !_ski_addUpdateData(sCache, *updateID, &updInfo))
         {
-          // Now where we have the BGPsec_PATH attribute successfully parsed,
-          // register the update with each SKI
-          int sbIdx, segIdx, skiOffset;
-          // Now do this for each signature block:
-          for (sbIdx = 0; sbIdx < sCache->tmpBGPsecInfo.nrSigBlocks; sbIdx++)
-          {            
-            algoID = sCache->tmpBGPsecInfo.algoID[sbIdx];
-            // Now run through the signature segments and in parallel through 
-            // the path segments.
-            for (segIdx = 0; segIdx < sCache->tmpBGPsecInfo.nrSegments; segIdx++)
+          errMSG = "Not enough memory to register the update!";
+          store  = false;
+        }
+        
+        // Now where we have the BGPsec_PATH attribute successfully parsed,
+        // register the update with each SKI
+        for (sbIdx = 0; sbIdx < updInfo.nrSigBlocks; sbIdx++)
+        {            
+          // Now run through the signature segments and in parallel through 
+          // the path segments. The SKIs are stored in sequence.
+          for (segIdx = 0; segIdx < updInfo.nrSegments; segIdx++)
+          {
+            _ski_setKey(&key, updInfo.asn[segIdx], updInfo.ski + skiOffset,
+                        updInfo.algoID[sbIdx]);
+            skiOffset += SKI_LENGTH;
+            shard = _ski_getShard(sCache, &key);
+            if (!_ski_lock(shard))
+            {
+              errMSG = _SKI_ERR_NO_LOCK;
+              continue;
+            }
+            cData = _ski_getCacheData(shard, &key, store);
+            // Now register the UpdateID with this cData
+            if (store && (   (cData == NULL) 
+                          || !___ski_uidSetAdd(&cData->updates, *updateID)))
+            {
+              errMSG = "Not enough memory to register the update!";
+              if (cData != NULL)
+              {
+                _ski_removeIfEmpty(shard, cData);
+                cData = NULL;
+              }
+            }
+            if ((cData == NULL) || (cData->counter == 0))
+            {
+              missing[sbIdx]++;
+            }
+            else if (store)
             {
-              // Now the ski's are stored in sequence, we need to calculate the 
-              // current position.
-              //        current sig block pos  add previous sig block
-              skiOffset = (segIdx * SKI_LENGTH) + (segIdx * SKI_LENGTH * sbIdx);
-              asn = sCache->tmpBGPsecInfo.asn[segIdx];
-              ski = sCache->tmpBGPsecInfo.ski + skiOffset;
-              cData = _ski_getCacheData(sCache, asn, ski, algoID, true);
-              // Now register the UpdateID with this cData
-              __ski_addUpdateCacheUID(cData, updateID);        
-            }            
+              // The key is already there, a later key change sees the update.
+              _ski_changeMissing(sCache, *updateID, key.algoID, -1, NULL);
+            }
+            _ski_unlock(shard);
+          }
+          if (missing[sbIdx] == 0)
+          {
+            // All keys of this signature block are available.
+            retVal = REGVAL_UNKNOWN;
           }
         }
-        else
-        {
-          errMSG = _SKI_ERR_BGPSEC;
-        }
-        // cleanup
-        _ski_initializeUpdInfo(&sCache->tmpBGPsecInfo);
       }
       else
       {
-        errMSG = "Provided BGPsec_PATH is not initialized (NULL)";
+        errMSG = _SKI_ERR_BGPSEC;
       }
-      _ski_unlock(sCache);
+      // cleanup
+      _ski_initializeUpdInfo(&updInfo);
     }
     else
     {
-      errMSG = _SKI_ERR_NO_LOCK;    
+      errMSG = "Provided BGPsec_PATH is not initialized (NULL)";
     }
   }
   else
@@ -1378,132 +1395,71 @@ bool ski_unregisterUpdate(SKI_CACHE* cache, SRxUpdateID* updateID,
 {
   char* errMSG = NULL;
  
-  LOG(LEVEL_DEBUG, "ski_unregisterUpdate %i", *updateID);  
-  
   if (cache != NULL)
   {
-    _SKI_CACHE* sCache     = (_SKI_CACHE*)cache;
-    if (_ski_lock(sCache))
+    _SKI_CACHE* sCache = (_SKI_CACHE*)cache;
+    if (bgpsec != NULL)
     {
-      if (bgpsec != NULL)
-      {
-        _ski_parseBGPsec_PATH(&sCache->tmpBGPsecInfo, bgpsec, updateID);
-        if (sCache->tmpBGPsecInfo.status != REGVAL_ERROR)
-        {      
-          // Signature Block Index
-          int       sbIdx  = 0;
-          // Path Segment Index
-          int       psIdx  = 0;
-          // The ski position offset
-          int       skiOffset = 0;
-          // SKI
-          u_int8_t* ski    = NULL;
-          u_int32_t asn    = 0;
-          u_int8_t  algoID = 0;
-          _SKI_CACHE_DATA* cData = NULL;
-          for (sbIdx = 0; sbIdx < sCache->tmpBGPsecInfo.nrSigBlocks; sbIdx++)
+      _SKI_TMP_UPD_INFO updInfo;
+      memset(&updInfo, 0, sizeof(_SKI_TMP_UPD_INFO));
+      _ski_parseBGPsec_PATH(&updInfo, bgpsec, updateID);
+      if (updInfo.status != REGVAL_ERROR)
+      {      
+        _SKI_CACHE_KEY    key;
+        _SKI_CACHE_SHARD* shard;
+        _SKI_CACHE_DATA*  cData;
+        // Signature Block Index, Path Segment Index, and the SKI offset
+        int sbIdx, psIdx, skiOffset = 0;
+        
+        for (sbIdx = 0; sbIdx < updInfo.nrSigBlocks; sbIdx++)
+        {
+          for (psIdx = 0; psIdx < updInfo.nrSegments; psIdx++)
           {
-            algoID = sCache->tmpBGPsecInfo.algoID[sbIdx];
-            for (psIdx = 0; psIdx < sCache->tmpBGPsecInfo.nrSegments; psIdx++)
+            _ski_setKey(&key, updInfo.asn[psIdx], updInfo.ski + skiOffset,
+                        updInfo.algoID[sbIdx]);
+            skiOffset += SKI_LENGTH;
+            shard = _ski_getShard(sCache, &key);
+            if (!_ski_lock(shard))
             {
-              asn = sCache->tmpBGPsecInfo.asn[psIdx];
-              ski = sCache->tmpBGPsecInfo.ski + skiOffset;            
-              skiOffset += SKI_LENGTH;
-              // Only look for it, do NOT create
-              cData = _ski_getCacheData(sCache, asn, ski, algoID, false);
-              // It should not be NULL but could if an unregister is called more
-              // than once with the same input data.
-              if (cData != NULL)
+              errMSG = _SKI_ERR_NO_LOCK;
+              continue;
+            }
+            // Only look for it, do NOT create
+            cData = _ski_getCacheData(shard, &key, false);
+            // It should not be NULL but could if an unregister is called more
+            // than once with the same input data.
+            if (cData != NULL)
+            {
+              // Unregister the instance. BZ1166 (counter)
+              if (!___ski_uidSetRemove(&cData->updates, *updateID))
               {
-                _SKI_CACHE_UPDATEID* cUID = cData->cacheUID;
-                _SKI_CACHE_UPDATEID* prev = NULL;
-                while (cUID != NULL)
-                {
-                  int cmp = compareSrxUpdateID(updateID, &cUID->updateID, 
-                                               SRX_UID_PV);
-                  if (cmp != 0)
-                  {                  
-                    if (cmp > 0)
-                    {
-                      prev = cUID;
-                      cUID = cUID->next;                 
-                    }
-                    else
-                    {
-                      // Update not registered!
-                      cUID = NULL;
-                      LOG(LEVEL_WARNING, "Could not find any update registration "
-                          "%u for the particular cache data element", *updateID);
-                    }
-                  }
-                  else
-                  {
-                    // Update found - unregister the instance. BZ1166 (counter)
-                    cUID->counter--;
-                    if (cUID->counter == 0)
-                    {
-                      if (prev != NULL)
-                      {
-                        prev->next = ___ski_freeCacheUID(cUID);;                    
-                      }
-                      else
-                      {
-                        cData->cacheUID = ___ski_freeCacheUID(cUID);;
-                      }
-                    }
-                    // Set it to NULL to stop the loop.
-                    cUID = NULL;
-                  }
-                }
-
-                // Now check if cData can be removed as well
-                if ((cData->cacheUID == NULL) && (cData->counter == 0))
-                {
-                  // Remove this cData instance
-                  // 1st Check if it is the head
-                  if (sCache->tmpHelper.cAlgoID->cacheData == cData)
-                  {
-                    // remove the head
-                    sCache->tmpHelper.cAlgoID->cacheData = 
-                                                      ___ski_freeCacheData(cData);
-                  }
-                  else
-                  {                  
-                    // find the previous element - go to th ehead
-                    _SKI_CACHE_DATA* prev_cData = 
-                                             sCache->tmpHelper.cAlgoID->cacheData;
-                    // Now walk until it is found
-                    while (prev_cData->next != cData)
-                    {
-                      prev_cData = prev_cData->next;
-                    }
-                    // Now take it out
-                    prev_cData->next = ___ski_freeCacheData(cData);
-                    cData = NULL;
-                  }
-                  sCache->tmpHelper.cData = NULL;
-                }
+                LOG(LEVEL_WARNING, "Could not find any update registration "
+                    "%u for the particular cache data element", *updateID);
               }
-              else
+              else if (cData->counter == 0)
               {
-                LOG(LEVEL_WARNING, "No registration found for the given update %u",
-                                   *updateID);
+                // This key was counted as missing.
+                _ski_changeMissing(sCache, *updateID, key.algoID, -1, NULL);
               }
+              // Now check if cData can be removed as well
+              _ski_removeIfEmpty(shard, cData);
             }
-          }        
-        }
-        else
-        {
-          errMSG = _SKI_ERR_BGPSEC;
+            else
+            {
+              LOG(LEVEL_WARNING, "No registration found for the given update %u",
+                                 *updateID);
+            }
+            _ski_unlock(shard);
+          }
         }
-        // cleanup
-        _ski_initializeUpdInfo(&sCache->tmpBGPsecInfo);
+        _ski_removeUpdateData(sCache, *updateID);
       }
-      _ski_unlock(sCache);
-    }
-    else
-    {
-      errMSG = _SKI_ERR_NO_LOCK;
+      else
+      {
+        errMSG = _SKI_ERR_BGPSEC;
+      }
+      // cleanup
+      _ski_initializeUpdInfo(&updInfo);
     }
   }
   
@@ -1517,7 +1473,8 @@ bool ski_unregisterUpdate(SKI_CACHE* cache, SRxUpdateID* updateID,
 
 /**
  * Register the <SKI, algo-id> tuple in the SKI cache. This might trigger 
- * notifications for possible kick-starting of update validation.
+ * notifications for possible kick-starting of update validation. Updates are
+ * only notified if all keys of the signature block are registered.
  * 
  * @param cache The SKI cache.
  * @param asn The ASN the key is assigned to in host format.
@@ -1535,31 +1492,38 @@ bool ski_registerKey(SKI_CACHE* cache, u_int32_t asn,
   
   if (cache != NULL)
   {
-    _SKI_CACHE* sCache = (_SKI_CACHE*)cache;
-    if (_ski_lock(sCache))
+    _SKI_CACHE*       sCache = (_SKI_CACHE*)cache;
+    _SKI_CACHE_KEY    key;
+    _SKI_CACHE_SHARD* shard;
+    
+    _ski_setKey(&key, asn, ski, algoID);
+    shard = _ski_getShard(sCache, &key);
+    if (_ski_lock(shard))
     {        
-      _SKI_CACHE_DATA* cData = _ski_getCacheData(sCache, asn, ski, algoID, true);
-      // Clean the helper structure.
-      memset(&sCache->tmpHelper, 0, sizeof(_SKI_TMP_HELPER));
-      
-      cData->counter++;
-      // After some discussion we decided to always add a notification, not only
-      // in the case from 0 to 1 or 1 to 0 but also from 1 to 2.
-      // The reason is that in SCA we check all colliding keys (which is the 
-      // case for > 1) and new new one could switch the validation state from 
-      // invalid to valid.
-      if (cData->cacheUID != NULL)
+      _SKI_CACHE_DATA* cData = _ski_getCacheData(shard, &key, true);
+      if (cData != NULL)
       {
-        // Yeah a new key was registered and we had already updates asking for it.
-        // Now notify these updates
-        _SKI_CACHE_UPDATEID* cUID = cData->cacheUID;
-        while (cUID != NULL)
-        {      
-          rq_queue(sCache->rpki_queue, RQ_KEY, &cUID->updateID);
-          cUID = cUID->next;
+        cData->counter++;
+        if (sCache->keyListener != NULL)
+        {
+          sCache->keyListener(sCache->keyListenerUser, asn, ski, algoID, 
+                              (cData->counter == 1) ? SKI_NEW : SKI_ADD);
         }
+        // After some discussion we decided to always add a notification, not 
+        // only in the case from 0 to 1 or 1 to 0 but also from 1 to 2.
+        // The reason is that in SCA we check all colliding keys (which is the 
+        // case for > 1) and new new one could switch the validation state from 
+        // invalid to valid.
+        // Only updates that do not wait for other keys are notified, all 
+        // others would be validated as invalid anyway.
+        _ski_keyChanged(sCache, cData, (cData->counter == 1) ? SKI_NEW 
+                                                              : SKI_ADD);
+      }
+      else
+      {
+        errMSG = "Not enough memory to register the key!";
       }
-      _ski_unlock(sCache);
+      _ski_unlock(shard);
     }
     else
     {
@@ -1580,10 +1544,9 @@ bool ski_registerKey(SKI_CACHE* cache, u_int32_t asn,
 
 /** 
  * Remove the key counter from the <SKI, algo-id> tuple. This might trigger 
- * notifications for possible kick-starting of update validation. This method
- * DOES not perform a "deep-clean". It removes the data element if necessary but
- * not the internal data structure that leads to the data. for "deep-clean"
- * call ski_gc.
+ * notifications for possible kick-starting of update validation. Updates are
+ * only notified if all keys of the signature block were registered. The data
+ * element is removed once neither keys nor updates are registered with it.
  * 
  * @param cache The SKI cache.
  * @param asn The ASN the key is assigned to in host format.
@@ -1601,71 +1564,43 @@ bool ski_unregisterKey(SKI_CACHE* cache, u_int32_t asn,
   
   if (cache != NULL)
   {
-    _SKI_CACHE* sCache = (_SKI_CACHE*)cache;
-    _ski_lock(sCache);
+    _SKI_CACHE*       sCache = (_SKI_CACHE*)cache;
+    _SKI_CACHE_KEY    key;
+    _SKI_CACHE_SHARD* shard;
+    
+    _ski_setKey(&key, asn, ski, algoID);
+    shard = _ski_getShard(sCache, &key);
+    _ski_lock(shard);
 
     // first find the SKI data object
-    _SKI_CACHE_DATA* cData = _ski_getCacheData(sCache, asn, ski, algoID, false);
-    bool canUnregister = cData != NULL;
+    _SKI_CACHE_DATA* cData = _ski_getCacheData(shard, &key, false);
+    // Now check if this data object has keys installed (counter > 1)
+    bool canUnregister = (cData != NULL) && (cData->counter > 0);
     
     if (canUnregister)
     {
-      // Now check if this data object has keys installed (counter > 1)
-      canUnregister = cData->counter > 0;
-      if (canUnregister)
+      // Now we can actually decrease the key counter (unregister).
+      cData->counter--;
+      if (sCache->keyListener != NULL)
       {
-        // Now we can actually decrease the key counter (unregister).
-        cData->counter--;
-        
-        // Now determine if we can either delete this element altogether or
-        // if we need to notify updates of the change
-        if (cData->cacheUID != NULL)
-        {
-          // Notify the attached updates
-          _SKI_CACHE_UPDATEID* cUID = cData->cacheUID;
-          while (cUID != NULL)
-          {
-            rq_queue(sCache->rpki_queue, RQ_KEY, &cUID->updateID);
-            cUID = cUID->next;
-          }
-        }
-        else
-        {
-          // We can remove it.
-          // we need to check if this data element is in between two elements.
-          _SKI_TMP_HELPER* tmpHelper = &sCache->tmpHelper;
-          _SKI_CACHE_DATA* head = tmpHelper->cAlgoID->cacheData;
-          if (head == cData)
-          {
-            // This is the first element, take it out and put the next one in 
-            // its place.
-            tmpHelper->cAlgoID->cacheData = cData->next;
-          }
-          else
-          {
-            // its in the middle, find its previous one.
-            _SKI_CACHE_DATA* prev = head;
-            while (prev->next != cData)
-            {
-              prev = prev->next;              
-            }
-            // Now we are there
-            prev->next = cData->next;
-          }
-          // Now remove the element.
-          ___ski_freeCacheData(cData);
-          cData = NULL;            
-        }
+        sCache->keyListener(sCache->keyListenerUser, asn, ski, algoID, 
+                            (cData->counter == 0) ? SKI_REMOVED : SKI_DEL);
       }
+      
+      // Now notify the attached updates of the change and remove the element
+      // if no updates are attached. Updates that already missed another key
+      // of the signature block are not affected.
+      _ski_keyChanged(sCache, cData, (cData->counter == 0) ? SKI_REMOVED 
+                                                            : SKI_DEL);
+      _ski_removeIfEmpty(shard, cData);
     }
-    
-    if (!canUnregister)
+    else
     {
       LOG(LEVEL_WARNING, "Attempt to unregister a key for ASN %u that is not"
                          "previously registered!", asn);
     }
     
-    _ski_unlock(sCache);
+    _ski_unlock(shard);
   }
   
   return (errMSG != NULL) ? false : true;
@@ -1693,52 +1628,127 @@ bool ski_clean(SKI_CACHE* cache, e_SKI_clean type)
   
   if (cache != NULL)
   {
-    _SKI_CACHE* sCache = (_SKI_CACHE*)cache;
+    _SKI_CACHE*       sCache = (_SKI_CACHE*)cache;
+    _SKI_CACHE_SHARD* shard;
+    _SKI_CACHE_DATA*  cData;
+    _SKI_CACHE_DATA*  tmp;
+    _SKI_UPDATE_DATA* uData;
+    _SKI_UPDATE_DATA* uTmp;
+    int               idx;
     
-    if (_ski_lock(sCache))
+    _ski_lockAll(sCache);
+    if (   (sCache->keyListener != NULL) 
+        && ((type == SKI_CLEAN_ALL) || (type == SKI_CLEAN_KEYS)))
+    {
+      // All keys are gone.
+      sCache->keyListener(sCache->keyListenerUser, 0, NULL, 0, SKI_REMOVED);
+    }
+    for (idx = 0; idx < _SKI_NO_SHARDS; idx++)
     {
-      if (type == SKI_CLEAN_ALL)
+      shard = &sCache->shards[idx];
+      HASH_ITER(hh, shard->table, cData, tmp)
       {
-        while (sCache->cacheNode != NULL)
+        if ((type == SKI_CLEAN_KEYS) && (cData->counter != 0))
         {
-          // Simple and easy delete all.
-          sCache->cacheNode = ___ski_freeCacheNode(sCache->cacheNode);
-        }        
+          // The updates miss these keys from now on.
+          _ski_keysCleaned(sCache, cData);
+        }
+        if (___ski_clean_cData(cData, type))
+        {
+          HASH_DEL(shard->table, cData);
+          ___ski_freeCacheData(cData);
+        }
       }
-      else
+      if ((type == SKI_CLEAN_ALL) || (type == SKI_CLEAN_UPDATES))
       {
-        _SKI_CACHE_NODE* prev  = NULL;
-        _SKI_CACHE_NODE* cNode = sCache->cacheNode;
-        // Don't clean all but selectively.
-        while (cNode != NULL)
+        HASH_ITER(hh, sCache->updShards[idx].table, uData, uTmp)
         {
-          if (___ski_clean_cNode(cNode, type))
-          {
-            // We can clean this node
-            cNode = ___ski_freeCacheNode(cNode);            
-            if (prev == NULL) // head
-            {
-              sCache->cacheNode = cNode;
-            }
-            else
-            {
-              prev->next = cNode;
-            }
-            continue; //             
-          }
-          prev  = cNode;
-          cNode = cNode->next;
+          HASH_DEL(sCache->updShards[idx].table, uData);
+          free(uData);
         }
       }
-      _ski_unlock(sCache);
     }
-    else
+    _ski_unlockAll(sCache);
+  }
+  else
+  {
+    errMSG = _SKI_ERR_CACHE_NULL;
+  }
+  
+  return (errMSG != NULL) ? false : true;
+}
+
+/**
+ * Set the listener that will be informed about each key change. Only one 
+ * listener can be registered, a new listener replaces the previous one.
+ * 
+ * @param cache The SKI cache.
+ * @param listener The listener or NULL to remove it.
+ * @param user The user data handed to the listener.
+ * 
+ * @return false if an error occurred, otherwise true
+ * 
+ * @since 0.6.0
+ */
+bool ski_setKeyListener(SKI_CACHE* cache, SKI_KEY_LISTENER listener, 
+                        void* user)
+{
+  char* errMSG = NULL;
+  
+  if (cache != NULL)
+  {
+    _SKI_CACHE* sCache = (_SKI_CACHE*)cache;
+    _ski_lockAll(sCache);
+    sCache->keyListener     = listener;
+    sCache->keyListenerUser = user;
+    _ski_unlockAll(sCache);
+  }
+  else
+  {
+    errMSG = _SKI_ERR_CACHE_NULL;
+  }
+  if (errMSG != NULL)
+  {
+    LOG(LEVEL_ERROR, "%s: %s", __func__, errMSG);
+  }
+  
+  return (errMSG != NULL) ? false : true;
+}
+
+/**
+ * Determine if the signatures of the update can be validated. This requires 
+ * all keys of at least one signature block of the update to be registered.
+ * Otherwise the BGPsec path validation result is invalid without performing 
+ * any signature validation.
+ * 
+ * @param cache The SKI cache.
+ * @param updateID The ID of the BGPsec update.
+ * 
+ * @return false if at least one key of each signature block is missing. Updates
+ *         not registered with the cache are reported as true.
+ * 
+ * @since 0.6.0
+ */
+bool ski_canValidate(SKI_CACHE* cache, SRxUpdateID* updateID)
+{
+  bool retVal = true;
+  
+  if ((cache != NULL) && (updateID != NULL))
+  {
+    _SKI_CACHE*        sCache = (_SKI_CACHE*)cache;
+    _SKI_UPDATE_SHARD* uShard = _ski_getUpdShard(sCache, *updateID);
+    _SKI_UPDATE_DATA*  uData  = NULL;
+    
+    _ski_lockUpd(uShard);
+    HASH_FIND(hh, uShard->table, updateID, sizeof(SRxUpdateID), uData);
+    if (uData != NULL)
     {
-      errMSG = _SKI_ERR_NO_LOCK;
+      retVal = ___ski_updComplete(uData);
     }
+    _ski_unlockUpd(uShard);
   }
   
-  return (errMSG != NULL) ? false : true;
+  return retVal;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1749,6 +1759,22 @@ bool ski_clean(SKI_CACHE* cache, e_SKI_clean type)
 int __ski_printf(const char *__restrict __format, ...)
 { return 0; }
 
+/**
+ * Compare two <asn, algoID> values for sorting.
+ * 
+ * @param a The first value
+ * @param b The second value
+ * 
+ * @return <0, 0, >0
+ */
+static int __ski_cmpAsnAlgo(const void* a, const void* b)
+{
+  u_int64_t va = *(u_int64_t*)a;
+  u_int64_t vb = *(u_int64_t*)b;
+  
+  return (va < vb) ? -1 : (va > vb) ? 1 : 0;
+}
+
 /**
  * Examine given SKI Cache. This function also allows to print the cache in 
  * XML format if verbose is enabled..
@@ -1756,14 +1782,9 @@ int __ski_printf(const char *__restrict __format, ...)
  * @param cache The cache to be examined
  * @param info The cache info object.
  * @param verbose Do an XML print of the cache while examining it.
- * @param gc Allows to perform garbage collection during examination.
  */
 void ski_examineCache(SKI_CACHE * cache, SKI_CACHE_INFO* info, bool verbose)
 {
-  #define _SKI_PRINT_OPEN  false
-  #define _SKI_PRINT_CLOSE true
-  #define _SKI_USE_XML     true
-
   int (*_ski_printf)(const char *__restrict __format, ...);
   _ski_printf = verbose ? &printf : &__ski_printf;
   
@@ -1775,93 +1796,121 @@ void ski_examineCache(SKI_CACHE * cache, SKI_CACHE_INFO* info, bool verbose)
   }
   memset (info, 0, sizeof(SKI_CACHE_INFO));
   
-  _SKI_CACHE*          sCache  = (_SKI_CACHE*)cache;
-  _SKI_CACHE_NODE*     cNode   = NULL;
-  _SKI_CACHE_ALGO_ID*  cAlgoID = NULL;
-  _SKI_CACHE_DATA*     cData   = NULL;
-  _SKI_CACHE_UPDATEID* cUID    = NULL;
-  int as2    = 0;
-  int skiIdx = 0;
+  _SKI_CACHE*       sCache   = (_SKI_CACHE*)cache;
+  _SKI_CACHE_SHARD* shard    = NULL;
+  _SKI_CACHE_DATA*  cData    = NULL;
+  _SKI_CACHE_DATA*  tmp      = NULL;
+  _SKI_UID_SLOT*    slot     = NULL;
+  _SKI_UPDATE_DATA* uData    = NULL;
+  _SKI_UPDATE_DATA* uTmp     = NULL;
+  u_int64_t*        asnAlgo  = NULL;
+  u_int32_t         noData   = 0;
+  u_int32_t         idx      = 0;
+  int               shardIdx = 0;
+  int               skiIdx   = 0;
   
   if (sCache != NULL)
   {
-    if (_ski_lock(sCache))
+    _ski_lockAll(sCache);
+    for (shardIdx = 0; shardIdx < _SKI_NO_SHARDS; shardIdx++)
+    {
+      noData += HASH_COUNT(sCache->shards[shardIdx].table);
+    }
+    // Collect the <asn, algoID> pairs to count the distinct values.
+    asnAlgo = (noData > 0) ? malloc(noData * sizeof(u_int64_t)) : NULL;
+    
+    _ski_printf ("<SKI_CACHE>\n");
+    for (shardIdx = 0; shardIdx < _SKI_NO_SHARDS; shardIdx++)
     {
-      _ski_printf ("<SKI_CACHE>\n");
-      cNode = sCache->cacheNode;
-      while (cNode != NULL)
+      shard = &sCache->shards[shardIdx];
+      if (shard->table == NULL)
       {
-        info->count_cNode++;
-        _ski_printf ("  <CACHE_NODE upper=[0x%04X....]>\n", cNode->upper);
-        
-        for (as2 = 0; as2 < _SKI_AS2_ARRAY_SIZE; as2++)
+        continue;
+      }
+      _ski_printf ("  <SHARD idx=%i>\n", shardIdx);
+      HASH_ITER(hh, shard->table, cData, tmp)
+      {
+        if (asnAlgo != NULL)
+        {
+          asnAlgo[info->count_cData] = ((u_int64_t)cData->key.asn << 8) 
+                                       | cData->key.algoID;
+        }
+        info->count_cData++;
+        info->count_keys += cData->counter;
+        _ski_printf ("    <CACHE_DATA algoID=%u, counter %u>\n",
+                     cData->key.algoID, cData->counter);
+        _ski_printf ("      <ASN asn=[0x%08X], asn_int=%u, "
+                     "asn_dot=%u.%u />\n", 
+                     cData->key.asn, cData->key.asn, cData->key.asn >> 16, 
+                     (cData->key.asn & 0xFFFF));
+        _ski_printf ("      <SKI>");
+        for (skiIdx = 0 ; skiIdx < SKI_LENGTH; skiIdx++)
+        {
+          _ski_printf ("%02X", cData->key.ski[skiIdx]);
+        }
+        _ski_printf ("</SKI>\n");
+        for (idx = 0; idx < cData->updates.size; idx++)
         {
-          if (cNode->as2[as2] != NULL)
+          slot = &cData->updates.slots[idx];
+          if (slot->counter != 0)
           {
-            info->count_AS2++;
-            cAlgoID = cNode->as2[as2];
-            _ski_printf ("    <AS2 as2=[0x....%04X]>\n", as2);
-            while (cAlgoID != NULL)
-            {
-              info->count_cAlgoID++;
-              _ski_printf ("      <CACHE_ALGO_ID algoid=%u>\n", cAlgoID->algoID);
-              cData = cAlgoID->cacheData;
-              while (cData != NULL)
-              {
-                info->count_cData++;
-                info->count_keys += cData->counter;
-                _ski_printf ("        <CACHE_DATA algoID=%u, counter %u>\n",
-                        cData->algoID, cData->counter);
-                _ski_printf ("          <ASN asn=[0x%08X], asn_int=%u, "
-                             "asn_dot=%u.%u />\n", 
-                             cData->asn, cData->asn, cNode->upper, 
-                             (cData->asn & 0xFFFF));
-                _ski_printf ("          <SKI>");
-                for (skiIdx = 0 ; skiIdx < SKI_LENGTH; skiIdx++)
-                {
-                  _ski_printf ("%02X", cData->ski[skiIdx]);
-                }
-                _ski_printf ("</SKI>\n");
-                cUID = cData->cacheUID;
-                while (cUID != NULL)
-                {
-                  info->count_cUID++;
-                  info->count_updates += cUID->counter;
-                  _ski_printf ("          <UID id=0x%X counter=%u/>\n", 
-                               cUID->updateID, cUID->counter);
-                  cUID = cUID->next;
-                }
-                
-                _ski_printf ("        </CACHE_DATA>\n");
-                cData = cData->next;
-              }
-              _ski_printf ("      </CACHE_ALGO_ID>\n");
-              cAlgoID = cAlgoID->next;
-            }
-            _ski_printf ("    </AS2>\n");
+            info->count_cUID++;
+            info->count_updates += slot->counter;
+            _ski_printf ("      <UID id=0x%X counter=%u/>\n", 
+                         slot->updateID, slot->counter);
           }
         }
-        
-        _ski_printf ("  </CACHE_NODE>\n");
-        cNode = cNode->next;
+        _ski_printf ("    </CACHE_DATA>\n");
       }
-      
-      _ski_printf ("</SKI_CACHE>\n");
-      
-      if (verbose)
-      { // Just some simple speedup in case verbose is turned off
-        _ski_printf ("Summary:\n");
-        _ski_printf ("================================\n");
-        _ski_printf ("  count cNode   = %i\n", info->count_cNode);
-        _ski_printf ("  count_AS2     = %i\n", info->count_AS2);
-        _ski_printf ("  count_cAlgoID = %i\n", info->count_cAlgoID);
-        _ski_printf ("  count_cData   = %i\n", info->count_cData);
-        _ski_printf ("  count_cUID    = %i\n", info->count_cUID);
-        _ski_printf ("  count_keys    = %i\n", info->count_keys);
-        _ski_printf ("  count_updates = %i\n", info->count_updates);
+      _ski_printf ("  </SHARD>\n");
+    }
+    _ski_printf ("</SKI_CACHE>\n");
+    for (shardIdx = 0; shardIdx < _SKI_NO_SHARDS; shardIdx++)
+    {
+      HASH_ITER(hh, sCache->updShards[shardIdx].table, uData, uTmp)
+      {
+        if (!___ski_updComplete(uData))
+        {
+          info->count_waiting++;
+        }
       }
-      
-      _ski_unlock(sCache);
+    }
+    _ski_unlockAll(sCache);
+    
+    if (asnAlgo != NULL)
+    {
+      // Sorted by ASN first, then by algorithm ID.
+      qsort(asnAlgo, noData, sizeof(u_int64_t), __ski_cmpAsnAlgo);
+      for (idx = 0; idx < noData; idx++)
+      {
+        if ((idx == 0) || (asnAlgo[idx] != asnAlgo[idx-1]))
+        {
+          info->count_cAlgoID++;
+        }
+        if ((idx == 0) || ((asnAlgo[idx] >> 8) != (asnAlgo[idx-1] >> 8)))
+        {
+          info->count_AS2++;
+        }
+        if ((idx == 0) || ((asnAlgo[idx] >> 24) != (asnAlgo[idx-1] >> 24)))
+        {
+          info->count_cNode++;
+        }
+      }
+      free(asnAlgo);
+    }
+    
+    if (verbose)
+    { // Just some simple speedup in case verbose is turned off
+      _ski_printf ("Summary:\n");
+      _ski_printf ("================================\n");
+      _ski_printf ("  count cNode   = %i\n", info->count_cNode);
+      _ski_printf ("  count_AS2     = %i\n", info->count_AS2);
+      _ski_printf ("  count_cAlgoID = %i\n", info->count_cAlgoID);
+      _ski_printf ("  count_cData   = %i\n", info->count_cData);
+      _ski_printf ("  count_cUID    = %i\n", info->count_cUID);
+      _ski_printf ("  count_keys    = %i\n", info->count_keys);
+      _ski_printf ("  count_updates = %i\n", info->count_updates);
+      _ski_printf ("  count_waiting = %i\n", info->count_waiting);
     }
   }    
-}
\ No newline at end of file
+}
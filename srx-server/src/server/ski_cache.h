@@ -90,12 +90,11 @@ typedef enum {
 /** This struct allows to get some statistics information about the internal 
  * SKI Cache. */
 typedef struct {
-  /** Number of CACHE Nodes, each CACHE Node represents the upper two bytes of
-   * an ASN */
+  /** Number of distinct upper two bytes of the ASNs stored. */
   u_int32_t count_cNode;
-  /** Number of 2 byte AS numbers. */
+  /** Number of distinct AS numbers. */
   u_int32_t count_AS2;
-  /** Number of Algorithm ID nodes, Min 1 per ASN*/
+  /** Number of distinct <ASN, algorithm ID> pairs, Min 1 per ASN*/
   u_int32_t count_cAlgoID;
   /** Number of SKI data leafs (same as counter of SKIs) */
   u_int32_t count_cData;
@@ -105,11 +104,29 @@ typedef struct {
   u_int32_t count_keys;
   /** Numbers of updates registered (count of cUID->counter.)*/
   u_int32_t count_updates;
+  /** Number of updates that miss at least one key in each signature block. */
+  u_int32_t count_waiting;
 } SKI_CACHE_INFO;
 
 /** The SKI_CACHE type */
 typedef void SKI_CACHE;
 
+/**
+ * Listener that will be called each time a key is registered or unregistered.
+ * The listener is called while the SKI cache is locked and MUST NOT call back 
+ * into the SKI cache.
+ * 
+ * @param user The user data handed over during ski_setKeyListener.
+ * @param asn The ASN the key is assigned to in host format.
+ * @param ski The 20 byte SKI of the key or NULL if all keys were removed.
+ * @param algoID The algorithm ID of the key.
+ * @param status The type of change (SKI_NEW, SKI_ADD, SKI_DEL, SKI_REMOVED).
+ * 
+ * @since 0.6.0
+ */
+typedef void (*SKI_KEY_LISTENER)(void* user, u_int32_t asn, u_int8_t* ski, 
+                                 u_int8_t algoID, e_SKI_status status);
+
 /**
  * Create and initialize as SKI cache. The SKI Cache uses the RPKI queue to 
  * signal changes in the ski cache. Wither the queue or a queue manager will 
@@ -192,7 +209,8 @@ bool ski_unregisterUpdate(SKI_CACHE* cache, SRxUpdateID* updateID,
 
 /**
  * Register the <SKI, algo-id> tuple in the SKI cache. This might trigger 
- * notifications for possible kick-starting of update validation.
+ * notifications for possible kick-starting of update validation. Updates are
+ * only notified if all keys of the signature block are registered.
  * 
  * @param cache The SKI cache.
  * @param asn The ASN the key is assigned to in host format.
@@ -206,7 +224,8 @@ bool ski_registerKey(SKI_CACHE* cache, u_int32_t asn,
 
 /** 
  * Remove the key counter from the <SKI, algo-id> tuple. This might trigger 
- * notifications for possible kick-starting of update validation.
+ * notifications for possible kick-starting of update validation. Updates are
+ * only notified if all keys of the signature block were registered.
  * 
  * @param cache The SKI cache.
  * @param asn The ASN the key is assigned to in host format.
@@ -218,6 +237,37 @@ bool ski_registerKey(SKI_CACHE* cache, u_int32_t asn,
 bool ski_unregisterKey(SKI_CACHE* cache, u_int32_t asn, 
                        u_int8_t* ski, u_int8_t algoID);
 
+/**
+ * Determine if the signatures of the update can be validated. This requires 
+ * all keys of at least one signature block of the update to be registered.
+ * Otherwise the BGPsec path validation result is invalid without performing 
+ * any signature validation.
+ * 
+ * @param cache The SKI cache.
+ * @param updateID The ID of the BGPsec update.
+ * 
+ * @return false if at least one key of each signature block is missing. Updates
+ *         not registered with the cache are reported as true.
+ * 
+ * @since 0.6.0
+ */
+bool ski_canValidate(SKI_CACHE* cache, SRxUpdateID* updateID);
+
+/**
+ * Set the listener that will be informed about each key change. Only one 
+ * listener can be registered, a new listener replaces the previous one.
+ * 
+ * @param cache The SKI cache.
+ * @param listener The listener or NULL to remove it.
+ * @param user The user data handed to the listener.
+ * 
+ * @return false if an error occurred, otherwise true
+ * 
+ * @since 0.6.0
+ */
+bool ski_setKeyListener(SKI_CACHE* cache, SKI_KEY_LISTENER listener, 
+                        void* user);
+
 /**
  * Examine given SKI Cache. This function also allows to print the cache in 
  * XML format if verbose is enabled..
@@ -41,32 +41,63 @@
  */
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <sys/uio.h>
 #include "server/srx_packet_sender.h"
 #include "shared/srx_packets.h"
 #include "util/log.h"
 #include "util/mutex.h"
 #include "util/server_socket.h"
 
+/** A preallocated slot of a client send ring. */
 typedef struct {
-  // The pdu to be send
-  uint8_t*      pdu;    
-  // The size of the pdu
-  size_t        size;
+  // The size of the PDU stored in this slot
+  uint32_t      size;
+  // The size of the overflow buffer
+  uint32_t      extSize;
+  // Overflow buffer for PDUs that do not fit into data. It is kept for reuse
+  // until the ring is released.
+  uint8_t*      ext;
+  // The inline storage for small PDUs
+  uint8_t       data[SEND_QUEUE_SLOT_SIZE];
+} SendSlot;
+
+/** The send ring of one client. */
+typedef struct _SendRing {
   // The server socket to send from
-  ServerSocket* srcSock;
+  ServerSocket*     srvSock;
   // The client to send to
-  ServerClient* client;
-  // The next packet in the queue
-  void*         next; 
-} SendPacket;
+  ServerClient*     client;
+  // The slots of the ring
+  SendSlot*         slots;
+  // The first slot to be send
+  uint32_t          head;
+  // The number of occupied slots
+  uint32_t          count;
+  // The number of slots currently written by the queue thread
+  uint32_t          inFlight;
+  // The number of producers blocked on this ring because it is full
+  uint32_t          waiters;
+  // Indicates if the ring is listed in the ready list
+  bool              ready;
+  // Indicates that the client is removed and the ring waits to be released,
+  // the ring stays in the hash table until then to drop further PDUs.
+  bool              removed;
+  // The next ring in the same hash bucket
+  struct _SendRing* hashNext;
+  // The next ring in the ready list
+  struct _SendRing* readyNext;
+} SendRing;
 
 typedef struct {
-  // the head element of the queue
-  SendPacket* head;
-  // the tail element of the queue
-  SendPacket* tail;
-  // the size of the queue
-  int        size;
+  // The rings of all clients, hashed by the client pointer
+  SendRing* buckets[SEND_QUEUE_CLIENT_BUCKETS];
+  // The rings that have packets to be send and are not in flight
+  SendRing* readyHead;
+  SendRing* readyTail;
+  // the number of slots per client ring
+  uint32_t  ringSize;
   // the queue handler itself
   pthread_t handler;
   // indicates if the queue is running.
@@ -74,7 +105,11 @@ typedef struct {
   // Mutex and Condition for thread handling
   Mutex       mutex;
   Cond        condition;
-  
+  // Signaled each time slots are freed, a write is finished or a blocked
+  // producer left its ring
+  Cond        spaceCond;
+  // The statistics of the queue
+  SendQueueInfo info;
 } SendPacketQueue;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -88,24 +123,205 @@ typedef struct {
 static SendPacketQueue* SEND_QUEUE = NULL;
 
 // Forward declaration
-SendPacket* fetchSendPacket();
+static SendRing* fetchSendRing(SendPacketQueue* queue, struct iovec* iov, 
+                               int* count);
+
+/**
+ * Wait on the given condition for the given time in milliseconds. The mutex 
+ * of the queue must be locked.
+ * 
+ * @param queue The send queue
+ * @param cond The condition to wait on
+ * @param ms The maximum time to wait in milliseconds.
+ * 
+ * @since 0.6.0
+ */
+static void _waitQueue(SendPacketQueue* queue, Cond* cond, long ms)
+{
+  struct timespec deadline;
+  
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec  += ms / 1000;
+  deadline.tv_nsec += (ms % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L)
+  {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+  pthread_cond_timedwait(cond, &queue->mutex, &deadline);
+}
+
+/**
+ * Return the hash bucket of the given client.
+ * 
+ * @param client The client
+ * 
+ * @return the bucket index.
+ * 
+ * @since 0.6.0
+ */
+static inline uint32_t _clientBucket(ServerClient* client)
+{
+  uintptr_t val = (uintptr_t)client;
+  return (uint32_t)((val >> 4) ^ (val >> 12)) 
+         & (SEND_QUEUE_CLIENT_BUCKETS - 1);
+}
+
+/**
+ * Append the ring to the list of rings ready to be send. The queue mutex must
+ * be locked.
+ * 
+ * @param queue The send queue
+ * @param ring The ring to be added.
+ * 
+ * @since 0.6.0
+ */
+static void _appendReady(SendPacketQueue* queue, SendRing* ring)
+{
+  ring->ready     = true;
+  ring->readyNext = NULL;
+  if (queue->readyTail == NULL)
+  {
+    queue->readyHead = ring;
+  }
+  else
+  {
+    queue->readyTail->readyNext = ring;
+  }
+  queue->readyTail = ring;
+}
+
+/**
+ * Remove the ring from the ready list. The queue mutex must be locked.
+ * 
+ * @param queue The send queue
+ * @param ring The ring to be removed.
+ * 
+ * @since 0.6.0
+ */
+static void _removeReady(SendPacketQueue* queue, SendRing* ring)
+{
+  SendRing* prev = NULL;
+  SendRing* curr = queue->readyHead;
+  
+  while (curr != NULL && curr != ring)
+  {
+    prev = curr;
+    curr = curr->readyNext;
+  }
+  if (curr != NULL)
+  {
+    if (prev == NULL)
+    {
+      queue->readyHead = curr->readyNext;
+    }
+    else
+    {
+      prev->readyNext = curr->readyNext;
+    }
+    if (queue->readyTail == curr)
+    {
+      queue->readyTail = prev;
+    }
+    curr->readyNext = NULL;
+  }
+  ring->ready = false;
+}
+
+/**
+ * Free the ring including all slots. The ring must not be referenced by the 
+ * queue anymore.
+ * 
+ * @param queue The send queue.
+ * @param ring The ring to be freed.
+ * 
+ * @since 0.6.0
+ */
+static void _freeRing(SendPacketQueue* queue, SendRing* ring)
+{
+  uint32_t idx;
+  
+  for (idx = 0; idx < queue->ringSize; idx++)
+  {
+    if (ring->slots[idx].ext != NULL)
+    {
+      free(ring->slots[idx].ext);
+    }
+  }
+  queue->info.pending -= ring->count;
+  queue->info.clients--;
+  free(ring->slots);
+  free(ring);
+}
+
+/**
+ * Find the ring of the given client, if not found and create is set a new one
+ * will be generated. The queue mutex must be locked.
+ * 
+ * @param queue The send queue.
+ * @param srvSoc The server socket.
+ * @param client The client.
+ * @param create If true a new ring will be created if none exists.
+ * 
+ * @return The ring of the client or NULL.
+ * 
+ * @since 0.6.0
+ */
+static SendRing* _getRing(SendPacketQueue* queue, ServerSocket* srvSoc,
+                          ServerClient* client, bool create)
+{
+  uint32_t  bucket = _clientBucket(client);
+  SendRing* ring   = queue->buckets[bucket];
+  
+  while (ring != NULL && ring->client != client)
+  {
+    ring = ring->hashNext;
+  }
+  
+  if (ring == NULL && create)
+  {
+    ring = malloc(sizeof(SendRing));
+    if (ring != NULL)
+    {
+      memset(ring, 0, sizeof(SendRing));
+      ring->slots = calloc(queue->ringSize, sizeof(SendSlot));
+      if (ring->slots == NULL)
+      {
+        free(ring);
+        ring = NULL;
+      }
+      else
+      {
+        ring->srvSock  = srvSoc;
+        ring->client   = client;
+        ring->hashNext = queue->buckets[bucket];
+        queue->buckets[bucket] = ring;
+        queue->info.clients++;
+      }
+    }
+  }
+  
+  return ring;
+}
 
 /**
  * Create the sender queue including the thread that manages the queue.
  * 
+ * @param ringSize The number of preallocated PDU slots per client.
+ * 
  * @return true if the queue cold be created otherwise false. 
  * 
  * @since 0.3.0
  */
-bool createSendQueue()
+bool createSendQueue(uint32_t ringSize)
 {
   SendPacketQueue* queue = malloc(sizeof(SendPacketQueue));
   if (queue != NULL)
   {
-    queue->head    = NULL;
-    queue->tail    = NULL;
-    queue->size    = 0;
-    queue->running = false;
+    memset(queue, 0, sizeof(SendPacketQueue));
+    queue->running  = false;
+    queue->ringSize = ringSize > 0 ? ringSize : SEND_QUEUE_DEF_RING_SIZE;
+    queue->info.ringSize = queue->ringSize;
     
     if (initMutex(&queue->mutex))
     {
@@ -115,6 +331,13 @@ bool createSendQueue()
         free(queue);
         queue = NULL;
       }
+      else if (!initCond(&queue->spaceCond))
+      {
+        destroyCond(&queue->condition);
+        releaseMutex(&queue->mutex);
+        free(queue);
+        queue = NULL;
+      }
     }
     else
     {
@@ -144,12 +367,13 @@ void releaseSendQueue()
       // Stops and cleans the queue
       stopSendQueue(SEND_QUEUE);
     }
-    if (SEND_QUEUE->head != NULL)
+    if (SEND_QUEUE->info.clients != 0)
     {
       RAISE_SYS_ERROR("Queue should be already empty!");
     }
     releaseMutex(&SEND_QUEUE->mutex);
     destroyCond(&SEND_QUEUE->condition);
+    destroyCond(&SEND_QUEUE->spaceCond);
     free (SEND_QUEUE);
     SEND_QUEUE = NULL;
     
@@ -158,7 +382,9 @@ void releaseSendQueue()
 }
 
 /** 
- * The thread loop of the queue. To stop the queue call stopSendQueue()
+ * The thread loop of the queue. To stop the queue call stopSendQueue(). Each
+ * round takes all pending PDUs of one client (up to SEND_QUEUE_MAX_BATCH) and
+ * writes them with a single gathered write.
  * 
  * @param notused - Not Used
  * 
@@ -175,21 +401,42 @@ void* sendQueueThreadLoop(void* notused)
   }
   else
   {
-    SendPacket* packet = NULL;
+    struct iovec iov[SEND_QUEUE_MAX_BATCH];
+    SendRing*    ring  = NULL;
+    int          count = 0;
+    bool         sent  = false;
+    
     LOG(LEVEL_DEBUG, "Enter sendqueue loop.");
     while (queue->running)
     {
-      packet = fetchSendPacket(queue);
-      if (packet != NULL)
+      ring = fetchSendRing(queue, iov, &count);
+      if (ring != NULL)
       {
-        if (!sendPacketToClient(packet->srcSock, packet->client, packet->pdu, 
-                                packet->size))
+        // The slots in flight are not touched by the producers, the ring 
+        // itself is not released as long as inFlight is set.
+        sent = sendPacketsToClient(ring->srvSock, ring->client, iov, count);
+        
+        lockMutex(&queue->mutex);
+        if (!sent)
+        {
+          RAISE_ERROR("Could not send %d packet(s) to client!", count);
+          queue->info.failed += count;
+        }
+        else
+        {
+          queue->info.sent += count;
+        }
+        queue->info.writes++;
+        queue->info.pending -= count;
+        ring->head      = (ring->head + count) % queue->ringSize;
+        ring->count    -= count;
+        ring->inFlight  = 0;
+        if (ring->count > 0 && !ring->removed)
         {
-          SRXPROXY_BasicHeader* bhdr = (SRXPROXY_BasicHeader*)packet->pdu;
-          RAISE_ERROR("Could not send packet of type [%u]!", bhdr->type);
+          _appendReady(queue, ring);
         }
-        free(packet->pdu);
-        free(packet);
+        pthread_cond_broadcast(&queue->spaceCond);
+        unlockMutex(&queue->mutex);
       }
     }
     LOG(LEVEL_DEBUG, "Exit send queue loop!");
@@ -250,86 +497,138 @@ void stopSendQueue()
   }
   else
   {
+    bool wasRunning = false;
     lockMutex(&queue->mutex);
     if (queue->running)
     {
+      wasRunning = true;
       queue->running = false;
-      // Stop the queue by waking it up
+      // Stop the queue by waking it up, also release all blocked producers.
       LOG(LEVEL_INFO, "StopSendQueue: send notification...");
       signalCond(&queue->condition);
+      pthread_cond_broadcast(&queue->spaceCond);
     }
     unlockMutex(&queue->mutex);
-    // Give the queue thread a chance to process the notify or run into a
-    // wait timeout.   
-    LOG(LEVEL_INFO, "StopSendQueue: sleep for %u ms", SEND_QUEUE_WAIT_MS * 2);
-    usleep(SEND_QUEUE_WAIT_MS * 2);
+    
+    if (wasRunning)
+    {
+      // The queue thread needs the mutex to leave its loop, do not hold it 
+      // while joining.
+      LOG(LEVEL_INFO, "StopSendQueue: wait for queue thread to join...");
+      pthread_join(queue->handler, NULL);
+    }
     
     lockMutex(&queue->mutex);
     // Free the remainder of the queue.
-    LOG(LEVEL_INFO, "StopSendQueue: wait for queue thread to join...");
-    pthread_join(queue->handler, NULL);
     LOG(LEVEL_INFO, "SendQueueThrealLoop STOPPED. Empty remainder of queue!");
-    SendPacket* packet = NULL;
-    while (queue->head != NULL)
+    SendRing* ring = NULL;
+    int idx;
+    // Producers that were blocked on a full ring and concurrent client 
+    // removals still reference their rings, wait until they are done.
+    idx = 0;
+    while (idx < SEND_QUEUE_CLIENT_BUCKETS)
+    {
+      ring = queue->buckets[idx];
+      while (ring != NULL && ring->waiters == 0 && !ring->removed)
+      {
+        ring = ring->hashNext;
+      }
+      if (ring != NULL)
+      {
+        _waitQueue(queue, &queue->spaceCond, SEND_QUEUE_WAIT_MS);
+      }
+      else
+      {
+        idx++;
+      }
+    }
+    for (idx = 0; idx < SEND_QUEUE_CLIENT_BUCKETS; idx++)
     {
-      packet = queue->head;
-      queue->head = (SendPacket*)packet->next;
-      // Free the allocated memory
-      free(packet->pdu);
-      free(packet);
-      queue->size--;
+      while (queue->buckets[idx] != NULL)
+      {
+        ring = queue->buckets[idx];
+        queue->buckets[idx] = ring->hashNext;
+        _freeRing(queue, ring);
+      }
     }
-    queue->tail = NULL;
+    queue->readyHead = NULL;
+    queue->readyTail = NULL;
     unlockMutex(&queue->mutex);
   }
 }
 
 /**
- * Retrieve the next packet from the queue as long as the queue is running. 
- * in case the queue is not running this method returns NULL.
+ * Retrieve the next client ring with pending packets from the queue as long as
+ * the queue is running and fill the I/O vector with its pending PDUs. The 
+ * slots handed out are marked as in flight until the caller returns them.
+ * In case the queue is not running this method returns NULL.
+ * 
+ * @param queue The send queue.
+ * @param iov The I/O vector to be filled (SEND_QUEUE_MAX_BATCH elements).
+ * @param count OUT - The number of PDUs filled in.
  * 
- * @return  the next packet of NULL if the queue is empty.
+ * @return the ring or NULL if the queue is empty.
  * 
  * @since 0.3.0
  */
-SendPacket* fetchSendPacket() 
+static SendRing* fetchSendRing(SendPacketQueue* queue, struct iovec* iov, 
+                               int* count)
 {
-  SendPacketQueue* queue = SEND_QUEUE;
-  SendPacket* packet = NULL;
+  SendRing* ring = NULL;
+  SendSlot* slot = NULL;
+  uint32_t  pos;
+  int       idx;
   
-  if (queue != NULL)
+  *count = 0;
+  lockMutex(&queue->mutex);
+  while (queue->readyHead == NULL && queue->running)
   {
-    lockMutex(&queue->mutex);
-    while (queue->size == 0 && queue->running)
+    // wait until notify is called or after a timeout.      
+    _waitQueue(queue, &queue->condition, SEND_QUEUE_WAIT_MS);
+    if(!queue->running)
     {
-      // wait until notify is called or after a timeout.      
-      waitCond(&queue->condition, &queue->mutex, SEND_QUEUE_WAIT_MS);
-      if(!queue->running)
-      {
-        LOG(LEVEL_INFO, "Sending queue received shutdown!");
-      }
+      LOG(LEVEL_INFO, "Sending queue received shutdown!");
     }
+  }
 
-    // If queue is still running and a packet is available take it
-    if (queue->running && queue->head != NULL)
+  // If queue is still running and a ring is available take it
+  if (queue->running && queue->readyHead != NULL)
+  {
+    ring = queue->readyHead;
+    queue->readyHead = ring->readyNext;
+    if (queue->readyHead == NULL)
     {
-      packet = queue->head;
-      queue->size--;
-      queue->head = (SendPacket*)packet->next;
-      packet->next = NULL;   
+      queue->readyTail = NULL;
     }
-    unlockMutex(&queue->mutex);
+    ring->readyNext = NULL;
+    ring->ready     = false;
+    
+    ring->inFlight = ring->count < SEND_QUEUE_MAX_BATCH 
+                     ? ring->count : SEND_QUEUE_MAX_BATCH;
+    for (idx = 0; idx < ring->inFlight; idx++)
+    {
+      pos  = (ring->head + idx) % queue->ringSize;
+      slot = &ring->slots[pos];
+      iov[idx].iov_base = slot->size > SEND_QUEUE_SLOT_SIZE ? slot->ext 
+                                                            : slot->data;
+      iov[idx].iov_len  = slot->size;
+    }
+    *count = ring->inFlight;
   }
-  return packet;
+  unlockMutex(&queue->mutex);
+  
+  return ring;
 }
 
 /**
- * Queue a copy of the the packet and return the size of the queue. The copy of 
- * the packet will be free'd by the queue handler thread itself.
+ * Queue a copy of the the packet into the send ring of the client. In case the
+ * ring of the client is full the caller blocks until the queue thread freed 
+ * space (back-pressure).
  * 
  * @param pdu The PDU to be added to the queue.
  * @param srvSoc The server socket to be used for sending
  * @param client The client to send to
+ * @param size The size of the PDU.
  * 
  * @return true if the packet was queued, otherwise false.
  * 
@@ -339,52 +638,189 @@ bool addToSendQueue(uint8_t* pdu, ServerSocket* srvSoc, ServerClient* client,
                     size_t size)
 {
   SendPacketQueue* queue = SEND_QUEUE;
-  
-  SendPacket* packet = malloc(sizeof(SendPacket));
+  SendRing* ring = NULL;
+  SendSlot* slot = NULL;
   bool retVal = false;
+  bool waited = false;
   
   lockMutex(&queue->mutex);
-  if (packet != NULL)
+  ring = _getRing(queue, srvSoc, client, true);
+  if (ring != NULL)
   {
-    memset(packet, 0, sizeof(SendPacket));
-    packet->pdu = malloc(size);
-    if (packet->pdu == NULL)
+    while (   ring->count == queue->ringSize && queue->running 
+           && !ring->removed)
     {
-      free(packet);
+      if (!waited)
+      {
+        waited = true;
+        queue->info.fullWaits++;
+        // The ring is not released as long as waiters is set.
+        ring->waiters++;
+      }
+      _waitQueue(queue, &queue->spaceCond, SEND_QUEUE_WAIT_MS);
     }
-    else
+    if (waited)
+    {
+      ring->waiters--;
+      if (ring->waiters == 0 && (ring->removed || !queue->running))
+      {
+        // Wake up the thread waiting to release the ring.
+        pthread_cond_broadcast(&queue->spaceCond);
+      }
+    }
+    
+    if (queue->running && !ring->removed)
     {
+      slot = &ring->slots[(ring->head + ring->count) % queue->ringSize];
       retVal = true;
-      packet->srcSock  = srvSoc;
-      packet->client   = client;
-      packet->next     = NULL;
-      packet->size     = size;
-      memcpy(packet->pdu, pdu, size);  
-      if (queue->size == 0)
+      if (size > SEND_QUEUE_SLOT_SIZE && slot->extSize < size)
       {
-        queue->head = packet;
-        queue->tail = packet;
+        // Only grows, the buffer is reused by later PDUs of this slot.
+        uint8_t* ext = realloc(slot->ext, size);
+        if (ext != NULL)
+        {
+          slot->ext     = ext;
+          slot->extSize = size;
+        }
+        else
+        {
+          retVal = false;
+        }
       }
-      else
+      if (retVal)
       {
-        queue->tail->next = packet;
-        queue->tail = packet;
+        memcpy(size > SEND_QUEUE_SLOT_SIZE ? slot->ext : slot->data, pdu, 
+               size);
+        slot->size = size;
+        ring->count++;
+        queue->info.queued++;
+        queue->info.pending++;
+        if (ring->count > queue->info.highWater)
+        {
+          queue->info.highWater = ring->count;
+        }
+        if (!ring->ready && ring->inFlight == 0)
+        {
+          _appendReady(queue, ring);
+          // Signal a new packet is in the queue
+          signalCond(&queue->condition);
+        }
       }
-      queue->size++;
-      // Signal a new packet is in the queue
-      signalCond(&queue->condition);
     }
   }
   unlockMutex(&queue->mutex);
   
   if (!retVal)
   {
-    RAISE_SYS_ERROR("Not enough memory to queue packets in send queue!");
+    if (ring == NULL || slot != NULL)
+    {
+      RAISE_SYS_ERROR("Not enough memory to queue packets in send queue!");
+    }
+    else
+    {
+      LOG(LEVEL_WARNING, "Send queue stopped or client removed, packet is "
+                         "dropped!");
+    }
   }
   
   return retVal;
 }
 
+/**
+ * Remove the client from the send queue. All PDUs still pending for this 
+ * client are dropped. In case the queue thread currently writes to the client
+ * or producers are blocked on the full ring of the client this method waits 
+ * until the write is finished and all blocked producers left the ring.
+ * 
+ * @param client The client to be removed.
+ * 
+ * @since 0.6.0
+ */
+void removeClientFromSendQueue(ServerClient* client)
+{
+  SendPacketQueue* queue = SEND_QUEUE;
+  SendRing* ring = NULL;
+  SendRing* prev = NULL;
+  SendRing* curr = NULL;
+  uint32_t  bucket;
+  
+  if (queue != NULL)
+  {
+    lockMutex(&queue->mutex);
+    bucket = _clientBucket(client);
+    ring   = queue->buckets[bucket];
+    while (ring != NULL && ring->client != client)
+    {
+      ring = ring->hashNext;
+    }
+    if (ring != NULL && !ring->removed)
+    {
+      // The ring stays in the hash table while waiting, this way producers
+      // find the removed ring and drop their PDUs instead of creating a new
+      // ring for this client. The queue thread does not pick it up anymore.
+      ring->removed = true;
+      if (ring->ready)
+      {
+        _removeReady(queue, ring);
+      }
+      // Release producers blocked on this ring.
+      pthread_cond_broadcast(&queue->spaceCond);
+      while (ring->inFlight > 0 || ring->waiters > 0)
+      {
+        _waitQueue(queue, &queue->spaceCond, SEND_QUEUE_WAIT_MS);
+      }
+      // Other rings might have been added to the bucket while waiting.
+      prev = NULL;
+      curr = queue->buckets[bucket];
+      while (curr != ring)
+      {
+        prev = curr;
+        curr = curr->hashNext;
+      }
+      if (prev == NULL)
+      {
+        queue->buckets[bucket] = ring->hashNext;
+      }
+      else
+      {
+        prev->hashNext = ring->hashNext;
+      }
+      if (ring->count > 0)
+      {
+        queue->info.dropped += ring->count;
+      }
+      _freeRing(queue, ring);
+      // A stopping queue might wait for this ring to be released.
+      pthread_cond_broadcast(&queue->spaceCond);
+    }
+    unlockMutex(&queue->mutex);
+  }
+}
+
+/**
+ * Retrieve the statistics of the send queue.
+ * 
+ * @param info OUT - The statistics, zeroed if the queue is not initialized.
+ * 
+ * @return true if the send queue is initialized.
+ * 
+ * @since 0.6.0
+ */
+bool getSendQueueInfo(SendQueueInfo* info)
+{
+  SendPacketQueue* queue = SEND_QUEUE;
+  
+  memset(info, 0, sizeof(SendQueueInfo));
+  if (queue != NULL)
+  {
+    lockMutex(&queue->mutex);
+    memcpy(info, &queue->info, sizeof(SendQueueInfo));
+    unlockMutex(&queue->mutex);
+  }
+  
+  return queue != NULL;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Packet Sending methods
 ////////////////////////////////////////////////////////////////////////////////
@@ -415,6 +851,7 @@ bool __sendPacketToClient(ServerSocket* srvSoc, ServerClient* client,
     {
       LOG(LEVEL_WARNING, "The sender queue is not initialized, send PDU directly "
                          "without queue!");
+      retVal = sendPacketToClient(srvSoc, client, pdu, size);
     }
     else
     {
@@ -432,21 +869,25 @@ bool __sendPacketToClient(ServerSocket* srvSoc, ServerClient* client,
  * @param proxyID The id of the proxy
  * @param srvSoc The server socket
  * @param client The client who received the original message
+ * @param capabilities The capabilities used on this connection
+ *                     (SRX_PROXY_CAP_...). Since 0.6.0
  *
  * @return true if the packet could be send, otherwise false.
  */
 bool sendHelloResponse(ServerSocket* srvSoc, ServerClient* client,
-                       uint32_t proxyID)
+                       uint32_t proxyID, uint32_t capabilities)
 {
   bool retVal = true;
   uint32_t length = sizeof(SRXPROXY_HELLO_RESPONSE);
-  SRXPROXY_HELLO_RESPONSE* pdu = malloc(length);
+  SRXPROXY_HELLO_RESPONSE buffer;
+  SRXPROXY_HELLO_RESPONSE* pdu = &buffer;
   memset(pdu, 0, length);
 
   pdu->type    = PDU_SRXPROXY_HELLO_RESPONSE;
   pdu->version = htons(SRX_PROTOCOL_VER);
   pdu->length  = htonl(length);
   pdu->proxyIdentifier = htonl(proxyID);
+  pdu->capabilities    = htonl(capabilities);
   
   if (!sendPacketToClient(srvSoc, client, pdu, length))
   {
@@ -454,7 +895,6 @@ bool sendHelloResponse(ServerSocket* srvSoc, ServerClient* client,
     retVal = false;
   }
 
-  free(pdu);
   return retVal;
 }
 
@@ -471,7 +911,8 @@ bool sendGoodbye(ServerSocket* srvSoc, ServerClient* client, bool useQueue)
 {
   bool retVal = true;
   uint32_t length = sizeof(SRXPROXY_GOODBYE);
-  SRXPROXY_GOODBYE* pdu = malloc(length);
+  SRXPROXY_GOODBYE buffer;
+  SRXPROXY_GOODBYE* pdu = &buffer;
   memset(pdu, 0, length);
 
   pdu->type       = PDU_SRXPROXY_GOODBYE;
@@ -484,7 +925,6 @@ bool sendGoodbye(ServerSocket* srvSoc, ServerClient* client, bool useQueue)
     retVal = false;
   }
 
-  free(pdu);
   return retVal;
 }
 
@@ -511,7 +951,8 @@ bool sendVerifyNotification(ServerSocket* srvSoc, ServerClient* client,
 {
   bool retVal = true;
   uint32_t length = sizeof(SRXPROXY_VERIFY_NOTIFICATION);
-  SRXPROXY_VERIFY_NOTIFICATION* pdu = malloc(length);
+  SRXPROXY_VERIFY_NOTIFICATION buffer;
+  SRXPROXY_VERIFY_NOTIFICATION* pdu = &buffer;
   memset(pdu, 0, length);
 
   pdu->type         = PDU_SRXPROXY_VERI_NOTIFICATION;
@@ -543,7 +984,6 @@ bool sendVerifyNotification(ServerSocket* srvSoc, ServerClient* client,
     LOG(LEVEL_DEBUG, "Notification send for update [0x%08X]", updateID);    
   }
 
-  free(pdu);
   return retVal;
 }
 
@@ -602,7 +1042,8 @@ bool sendSynchRequest(ServerSocket* srvSoc, ServerClient* client, bool useQueue)
 {
   bool retVal = true;
   uint32_t length = sizeof(SRXPROXY_SYNCH_REQUEST);
-  SRXPROXY_SYNCH_REQUEST* pdu = malloc(length);
+  SRXPROXY_SYNCH_REQUEST buffer;
+  SRXPROXY_SYNCH_REQUEST* pdu = &buffer;
   memset(pdu, 0, length);
 
   pdu->type      = PDU_SRXPROXY_SYNC_REQUEST;
@@ -614,7 +1055,6 @@ bool sendSynchRequest(ServerSocket* srvSoc, ServerClient* client, bool useQueue)
     RAISE_SYS_ERROR("Could not send the synchonization request");
     retVal = false;
   }
-  free(pdu);
 
   return retVal;
 }
@@ -635,7 +1075,8 @@ bool sendError(uint16_t errorCode, ServerSocket* srvSoc, ServerClient* client,
 {
   bool retVal = true;
   uint32_t length = sizeof(SRXPROXY_ERROR);
-  SRXPROXY_ERROR* pdu = malloc(length);
+  SRXPROXY_ERROR buffer;
+  SRXPROXY_ERROR* pdu = &buffer;
   memset(pdu, 0, length);
 
   pdu->type      = PDU_SRXPROXY_ERROR;
@@ -648,7 +1089,6 @@ bool sendError(uint16_t errorCode, ServerSocket* srvSoc, ServerClient* client,
     RAISE_SYS_ERROR("Could not send the error report type [%0x04X]", errorCode);
     retVal = false;
   }
-  free(pdu);
 
   return retVal;
 }
@@ -41,14 +41,52 @@
 #include <stdbool.h>
 #include "util/server_socket.h"
 
+/** The default number of preallocated PDU slots per client. */
+#define SEND_QUEUE_DEF_RING_SIZE  256
+/** The maximum number of preallocated PDU slots per client. */
+#define SEND_QUEUE_MAX_RING_SIZE  65536
+/** PDUs up to this size are stored inline in the slot, larger ones use a
+ * per slot overflow buffer that is kept for reuse. */
+#define SEND_QUEUE_SLOT_SIZE      64
+/** The maximum number of PDUs written with one gathered write. */
+#define SEND_QUEUE_MAX_BATCH      64
+/** Number of hash buckets used to find the ring of a client. */
+#define SEND_QUEUE_CLIENT_BUCKETS 64
+
+/** The statistics of the send queue. */
+typedef struct {
+  /** The number of slots per client ring */
+  uint32_t ringSize;
+  /** The number of clients that currently own a ring */
+  uint32_t clients;
+  /** The number of PDUs waiting to be send */
+  uint32_t pending;
+  /** The highest fill level of a single ring */
+  uint32_t highWater;
+  /** The number of PDUs queued */
+  uint64_t queued;
+  /** The number of PDUs send */
+  uint64_t sent;
+  /** The number of PDUs that could not be send */
+  uint64_t failed;
+  /** The number of PDUs dropped due to the removal of the client */
+  uint64_t dropped;
+  /** The number of gathered writes */
+  uint64_t writes;
+  /** The number of times a producer had to wait for a full ring */
+  uint64_t fullWaits;
+} SendQueueInfo;
+
 /**
  * Create the sender queue including the thread that manages the queue.
  * 
+ * @param ringSize The number of preallocated PDU slots per client.
+ * 
  * @return true if the queue cold be created otherwise false. 
  * 
  * @since 0.3.0
  */
-bool createSendQueue();
+bool createSendQueue(uint32_t ringSize);
 
 /**
  * Start the send queue. In case the queue is already started this method does 
@@ -75,17 +113,40 @@ void stopSendQueue();
  */
 void releaseSendQueue();
 
+/**
+ * Remove the client from the send queue and drop all its pending PDUs. Must 
+ * be called before the client connection is released.
+ * 
+ * @param client The client to be removed.
+ * 
+ * @since 0.6.0
+ */
+void removeClientFromSendQueue(ServerClient* client);
+
+/**
+ * Retrieve the statistics of the send queue.
+ * 
+ * @param info OUT - The statistics, zeroed if the queue is not initialized.
+ * 
+ * @return true if the send queue is initialized.
+ * 
+ * @since 0.6.0
+ */
+bool getSendQueueInfo(SendQueueInfo* info);
+
 /**
  * Send a hello response to the client. This method does not use the send queue
  *
  * @param proxyID The id of the proxy
  * @param srcSock The server socket
  * @param client The client who received the original message
+ * @param capabilities The capabilities used on this connection
+ *                     (SRX_PROXY_CAP_...). Since 0.6.0
  *
  * @return true if the packet could be send, otherwise false.
  */
 bool sendHelloResponse(ServerSocket* srcSock, ServerClient* client,
-                       uint32_t proxyID);
+                       uint32_t proxyID, uint32_t capabilities);
 
 /**
  * Send a goodbye packet to the proxy. The proxy does not use the keepWindow,
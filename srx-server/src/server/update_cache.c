@@ -75,11 +75,14 @@
 
 #include <uthash.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <malloc.h>
+#include <pthread.h>
 #include <time.h>
 #include <srx/srxcryptoapi.h>
 #include "server/update_cache.h"
+#include "server/aspath_cache.h"
 #include "server/server_connection_handler.h"
 #include "server/prefix_cache.h"
 #include "server/ski_cache.h"
@@ -89,12 +92,9 @@
 #include "util/prefix.h"
 #include "util/xml_out.h"
 #include "util/mutex.h"
+#include "util/timing_wheel.h"
 #include "main.h"
 
-/* Number of preallocated result slots */
-//#define NUM_PREALLOC  20
-#define NUM_PREALLOC  1
-
 #define HDR "([0x%08X] UpdateCache): "
 
 /**
@@ -116,17 +116,70 @@ typedef struct {
                                   // request.
   uint32_t         roaRefCount;   // the number of ROA's that cover this update
 
-  uint16_t         gcFlag;        // Indicates when this entry can be deleted
-                                  // by the garbage collector.
+  time_t           gcFlag;        // The time this entry can be deleted by the
+                                  // garbage collector, 0 if not scheduled.
+  bool             reclaimed;     // Set by the garbage collector once the
+                                  // entry is removed from the hash table.
+  uint32_t         refCount;      // Number of readers using the entry outside
+                                  // of the shard lock (see getUpdateData).
 
   UC_UpdateData    pathData;      // This element replaces the blob.
+  PDU_Buffer*      pduBuffer;     // The PDU pathData points into or NULL if
+                                  // pathData uses own copies.
   uint32_t         aspathCacheID; // aspath cache key ID
 } CacheEntry;
 
+/**
+ * Lists the updates of one shard that share the same AS path (path ID).
+ */
+typedef struct {
+  UT_hash_handle hh;          // The hash table of the shard's path index
+  uint32_t       pathID;      // The aspath cache key ID
+  SRxUpdateID*   updateIDs;   // The updates using this path
+  uint32_t       noUpdateIDs; // Number of updates in the array
+  uint32_t       size;        // Size of the array
+} UC_PathIndex;
+
+/**
+ * A single shard of the update cache. The table lock guards the structure of
+ * the hash table, the path index, and the item list, the item mutex guards 
+ * the modifiable fields of the cache entries stored in this shard (results 
+ * and clients). Lock order is tableLock before itemMutex.
+ */
+typedef struct {
+  RWLock        tableLock;  // Guards table, pathIndex, and allItems
+  Mutex         itemMutex;  // Guards the mutable fields of the entries
+  CacheEntry*   table;      // The hash table for quick lookup
+  UC_PathIndex* pathIndex;  // path ID -> updates of this shard
+  SList         allItems;   // All updates of this shard in an SList.
+} UC_Shard;
+
+/**
+ * The garbage collector of the update cache. Each update without clients is
+ * scheduled in the timing wheel with the end of its keep window. The wheel
+ * mutex is acquired after the locks of a shard.
+ */
+typedef struct {
+  Mutex        wheelMutex;  // Guards the wheel
+  TimingWheel  wheel;       // The scheduled updates
+  TW_TimerList expired;     // The updates expired during one run
+  CacheEntry** retired;     // The reclaimed updates still referenced
+  uint32_t     noRetired;   // Number of reclaimed updates in the array
+  uint32_t     sizeRetired; // Size of the array
+  PrefixCache* prefixCache; // The prefix cache or NULL
+  AspathCache* aspathCache; // The AS path cache or NULL
+  Mutex        runMutex;    // Guards running
+  Cond         runCond;     // Wakes the thread up to stop it
+  pthread_t    thread;      // The garbage collector thread
+  bool         running;     // Indicates if the thread is running
+  uint64_t     reclaimed;      // Number of updates reclaimed
+  uint64_t     reclaimedBytes; // Number of bytes reclaimed
+} UC_GC;
+
 // Forward declarations
 bool _addClientReference(UpdateCache* self, CacheEntry* cEntry,
                          uint8_t clientID, ProxyClientMapping* clientMapping);
-uint16_t getGCTime(uint16_t keepTime);
+void setGCFlag(UpdateCache* self, CacheEntry* cEntry, uint16_t keepTime);
 
 /**
  * Clean up the cache data element.
@@ -139,13 +192,22 @@ static void _cleanCachPathData(CacheEntry* cEntry)
 {
   UC_UpdateData* data = &cEntry->pathData;
 
-  if (data->asn_path != NULL)
+  if (cEntry->pduBuffer != NULL)
   {
-    free(data->asn_path);
+    // The path data points into the PDU, only release the reference.
+    releasePDUBuffer(cEntry->pduBuffer);
+    cEntry->pduBuffer = NULL;
   }
-  if (data->bgpsec_path != NULL)
+  else
   {
-    free(data->bgpsec_path);
+    if (data->asn_path != NULL)
+    {
+      free(data->asn_path);
+    }
+    if (data->bgpsec_path != NULL)
+    {
+      free(data->bgpsec_path);
+    }
   }
   memset(data, 0, sizeof(UC_UpdateData));
 }
@@ -155,13 +217,16 @@ static void _cleanCachPathData(CacheEntry* cEntry)
  * - see srx_identifier::generateIdentifier and stores it in the cache entry.
  * It is important that both data blobs are same otherwise problems with the
  * ID finding are given.
- * This method copies the data from bgpsecData into the cache entry. Therefore
+ * If the AS path and BGPsec path of bgpsecData are located within the given
+ * PDU buffer, the cache entry points into the buffer and keeps a reference
+ * to it. Otherwise the data is copied into the cache entry. In both cases
  * the memory allocated in bgpsecData can safely be deallocated.
  *
  * @param cEntry The cache entry where the blob data will be stored in.
  * @param bgpData The BGPsec / BGP4 data that has to be stored.
  * @param prefix The prefix of the update (in network order)
  *               (MUST NOT BE NULL FOR BGPSEC)
+ * @param pduBuffer The PDU buffer bgpData points into (CAN BE NULL).
  *
  * @return false if the cache entry already contains data,otherwise true.
  *
@@ -170,10 +235,11 @@ static void _cleanCachPathData(CacheEntry* cEntry)
  * @see srx_identifier.h::generateIdentifier
  */
 bool storeCacheEntryBlob(CacheEntry* cEntry, BGPSecData* bgpData,
-                         IPPrefix* prefix)
+                         IPPrefix* prefix, PDU_Buffer* pduBuffer)
 {
   bool retVal  = false;
-  int  dataLen = 0;
+  int  dataLen = bgpData->numberHops * 4;
+  bool inPDU   = false;
   if (cEntry != NULL)
   {
     UC_UpdateData* data = &cEntry->pathData;
@@ -201,22 +267,47 @@ bool storeCacheEntryBlob(CacheEntry* cEntry, BGPSecData* bgpData,
         }
       }
 
-      // Copy AS path (list of AS numbers)
+      // Both paths are used in place if the PDU contains them.
+      inPDU =    ((dataLen == 0)
+                  || isInPDUBuffer(pduBuffer, bgpData->asPath, dataLen))
+              && ((bgpData->attr_length == 0)
+                  || isInPDUBuffer(pduBuffer, bgpData->bgpsec_path_attr,
+                                   bgpData->attr_length))
+              && (pduBuffer != NULL);
+      if (inPDU)
+      {
+        cEntry->pduBuffer = retainPDUBuffer(pduBuffer);
+      }
+
+      // AS path (list of AS numbers)
       if (bgpData->numberHops > 0)
       {
         data->hops = bgpData->numberHops;
-        dataLen = bgpData->numberHops * 4;
-        data->asn_path = malloc(dataLen);
-        memcpy(data->asn_path, bgpData->asPath, dataLen);
+        if (inPDU)
+        {
+          data->asn_path = bgpData->asPath;
+        }
+        else
+        {
+          data->asn_path = malloc(dataLen);
+          memcpy(data->asn_path, bgpData->asPath, dataLen);
+        }
       }
 
-      // Copy BGPsec path (BGPsec_PATH attribute)
+      // BGPsec path (BGPsec_PATH attribute)
       if (bgpData->attr_length != 0)
       {
-        data->length      = bgpData->attr_length;
-        data->bgpsec_path = malloc(bgpData->attr_length);
-        memcpy(data->bgpsec_path, bgpData->bgpsec_path_attr,
-               bgpData->attr_length);
+        data->length = bgpData->attr_length;
+        if (inPDU)
+        {
+          data->bgpsec_path = (SCA_BGP_PathAttribute*)bgpData->bgpsec_path_attr;
+        }
+        else
+        {
+          data->bgpsec_path = malloc(bgpData->attr_length);
+          memcpy(data->bgpsec_path, bgpData->bgpsec_path_attr,
+                 bgpData->attr_length);
+        }
       }
     }
   }
@@ -227,11 +318,70 @@ bool storeCacheEntryBlob(CacheEntry* cEntry, BGPSecData* bgpData,
 /*---------------------
  * Hash-table functions
  *
- * @note Uses R/W lock
+ * @note Uses the R/W lock of the shard
+ */
+
+/**
+ * Return the index of the shard the given update ID belongs to. The update ID
+ * is mixed before it is masked to spread sequential or otherwise similar IDs
+ * over all shards.
+ *
+ * @param updateID The update ID
+ *
+ * @return The index of the shard.
+ *
+ * @since 0.6.0
+ */
+static inline uint32_t _getShardIdx(SRxUpdateID updateID)
+{
+  uint32_t hash = (uint32_t)updateID;
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6B;
+  hash ^= hash >> 13;
+  hash *= 0xC2B2AE35;
+  hash ^= hash >> 16;
+
+  return hash & (UC_NUM_SHARDS - 1);
+}
+
+/**
+ * Return the shard the given update ID belongs to.
+ *
+ * @param self The reference for the update cache
+ * @param updateID The update ID
+ *
+ * @return The shard of the update.
+ *
+ * @since 0.6.0
  */
+static inline UC_Shard* _getShard(UpdateCache* self, SRxUpdateID updateID)
+{
+  return &((UC_Shard*)self->shards)[_getShardIdx(updateID)];
+}
+
+/**
+ * Search the shard for the update with the given update id. The caller MUST
+ * hold at least the read lock of the shard.
+ *
+ * @param shard The shard of the update
+ * @param updateID The update ID to search for.
+ *
+ * @return The cache entry or NULL if not found.
+ *
+ * @since 0.6.0
+ */
+static inline CacheEntry* _shardFind(UC_Shard* shard, SRxUpdateID updateID)
+{
+  CacheEntry* cEntry = NULL;
+  HASH_FIND(hh, shard->table, &updateID, sizeof(SRxUpdateID), cEntry);
+  return cEntry;
+}
+
 /**
  * This method searches the cache for the update with the given update id.
- * if found the result is written into the out pointer.
+ * if found the result is written into the out pointer. The entry MUST NOT be
+ * accessed once this function returns, use _shardFind while holding the read
+ * lock of the shard instead.
  *
  * @param self The reference for the update cache
  * @param updateID The update ID to search for.
@@ -241,42 +391,233 @@ bool storeCacheEntryBlob(CacheEntry* cEntry, BGPSecData* bgpData,
  */
 static bool tableFind(UpdateCache* self, SRxUpdateID updateID, CacheEntry** out)
 {
-  acquireReadLock(&self->tableLock);
-  HASH_FIND(hh, (CacheEntry*)self->table, &updateID, sizeof(SRxUpdateID),
-            (*out));
-  unlockReadLock(&self->tableLock);
+  UC_Shard* shard = _getShard(self, updateID);
+  acquireReadLock(&shard->tableLock);
+  *out = _shardFind(shard, updateID);
+  unlockReadLock(&shard->tableLock);
 
   return (*out != NULL);
 }
 
 /**
- * Add the update encapsulated in the cache entry element into the cache. The
- * key is the updateID and the value is the cache entry containing the update
- * information.
+ * Add the update to the path index of its shard. The caller MUST hold the
+ * write lock of the shard.
+ *
+ * @param shard The shard of the update
+ * @param cEntry The update
+ *
+ * @return false if not enough memory was available.
+ *
+ * @since 0.6.0
+ */
+static bool _pathIndexAdd(UC_Shard* shard, CacheEntry* cEntry)
+{
+  UC_PathIndex* index = NULL;
+  uint32_t      pathID = cEntry->aspathCacheID;
+
+  HASH_FIND(hh, shard->pathIndex, &pathID, sizeof(uint32_t), index);
+  if (index == NULL)
+  {
+    index = calloc(1, sizeof(UC_PathIndex));
+    if (index == NULL)
+    {
+      return false;
+    }
+    index->pathID = pathID;
+    HASH_ADD(hh, shard->pathIndex, pathID, sizeof(uint32_t), index);
+  }
+
+  if (index->noUpdateIDs == index->size)
+  {
+    uint32_t     newSize = (index->size == 0) ? 2 : index->size * 2;
+    SRxUpdateID* newIDs  = realloc(index->updateIDs,
+                                   newSize * sizeof(SRxUpdateID));
+    if (newIDs == NULL)
+    {
+      return false;
+    }
+    index->updateIDs = newIDs;
+    index->size      = newSize;
+  }
+  index->updateIDs[index->noUpdateIDs++] = cEntry->updateID;
+
+  return true;
+}
+
+/**
+ * Remove the update from the path index of its shard. The caller MUST hold the
+ * write lock of the shard.
+ *
+ * @param shard The shard of the update
+ * @param cEntry The update
+ *
+ * @return true if no other update of the shard uses the path.
+ *
+ * @since 0.6.0
+ */
+static bool _pathIndexDel(UC_Shard* shard, CacheEntry* cEntry)
+{
+  UC_PathIndex* index = NULL;
+  uint32_t      pathID = cEntry->aspathCacheID;
+  uint32_t      idx;
+
+  HASH_FIND(hh, shard->pathIndex, &pathID, sizeof(uint32_t), index);
+  if (index != NULL)
+  {
+    for (idx = 0; idx < index->noUpdateIDs; idx++)
+    {
+      if (index->updateIDs[idx] == cEntry->updateID)
+      {
+        index->updateIDs[idx] = index->updateIDs[--index->noUpdateIDs];
+        break;
+      }
+    }
+    if (index->noUpdateIDs == 0)
+    {
+      HASH_DEL(shard->pathIndex, index);
+      free(index->updateIDs);
+      free(index);
+      return true;
+    }
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Release the complete path index of the shard. The caller MUST hold the
+ * write lock of the shard.
+ *
+ * @param shard The shard
+ *
+ * @since 0.6.0
+ */
+static void _pathIndexEmpty(UC_Shard* shard)
+{
+  UC_PathIndex *index, *tmp;
+
+  HASH_ITER(hh, shard->pathIndex, index, tmp)
+  {
+    HASH_DEL(shard->pathIndex, index);
+    free(index->updateIDs);
+    free(index);
+  }
+  shard->pathIndex = NULL;
+}
+
+/*-------------------
+ * Garbage collection
+ */
+
+/**
+ * Create the garbage collector of the update cache. The thread is started by
+ * startUpdateCacheGC.
+ *
+ * @param self The update cache
+ *
+ * @return false if the garbage collector could not be created.
+ *
+ * @since 0.6.0
+ */
+static bool _gcCreate(UpdateCache* self)
+{
+  UC_GC* gc = calloc(1, sizeof(UC_GC));
+
+  if (gc == NULL)
+  {
+    RAISE_ERROR("Not enough memory for the garbage collector");
+    return false;
+  }
+  if (!initMutex(&gc->wheelMutex))
+  {
+    RAISE_ERROR("Unable to setup the garbage collector Mutex");
+    free(gc);
+    return false;
+  }
+  if (!initMutex(&gc->runMutex) || !initCond(&gc->runCond))
+  {
+    RAISE_ERROR("Unable to setup the garbage collector thread control");
+    releaseMutex(&gc->wheelMutex);
+    free(gc);
+    return false;
+  }
+  initTimingWheel(&gc->wheel, time(NULL));
+  self->gc = gc;
+
+  return true;
+}
+
+/**
+ * Free the memory of the given update.
+ *
+ * @param cEntry The update, already removed from its shard.
+ *
+ * @since 0.6.0
+ */
+static void _gcFreeEntry(CacheEntry* cEntry)
+{
+  _cleanCachPathData(cEntry);
+  free(cEntry->clients);
+  free(cEntry);
+}
+
+/**
+ * Free the memory of the reclaimed updates no reader references anymore.
+ * Reclaimed updates are not in the hash table, their reference count can only
+ * decrease.
+ *
+ * @param gc The garbage collector
+ * @param all Free all reclaimed updates regardless of their references.
  *
- * @param self the update cache.
- * @param cEntry the update to be stored.
+ * @since 0.6.0
  */
-static void tableAdd(UpdateCache* self, CacheEntry* cEntry)
+static void _gcFreeRetired(UC_GC* gc, bool all)
 {
-  acquireWriteLock(&self->tableLock);
-  HASH_ADD(hh, *((CacheEntry**)&self->table), updateID, sizeof(SRxUpdateID),
-           cEntry);
-  unlockWriteLock(&self->tableLock);
+  CacheEntry* cEntry = NULL;
+  uint32_t    idx;
+  uint32_t    kept = 0;
+
+  for (idx = 0; idx < gc->noRetired; idx++)
+  {
+    cEntry = gc->retired[idx];
+    // Pairs with the release in releaseUpdateData.
+    if (all || (__sync_fetch_and_add(&cEntry->refCount, 0) == 0))
+    {
+      _gcFreeEntry(cEntry);
+    }
+    else
+    {
+      gc->retired[kept++] = cEntry;
+    }
+  }
+  gc->noRetired = kept;
 }
 
 /**
- * Remove the update entry from the update cache. This method does NOT release
- * the memory attached to the cache entry!!!
+ * Release the garbage collector including all reclaimed updates. The thread
+ * MUST be stopped.
  *
- * @param self The update cache.
- * @param cEntry the entry containing the update information.
+ * @param self The update cache
+ *
+ * @since 0.6.0
  */
-static void tableDel(UpdateCache* self, CacheEntry* cEntry)
+static void _gcRelease(UpdateCache* self)
 {
-  acquireWriteLock(&self->tableLock);
-  HASH_DEL(*((CacheEntry**)&self->table), cEntry);
-  unlockWriteLock(&self->tableLock);
+  UC_GC* gc = (UC_GC*)self->gc;
+
+  if (gc != NULL)
+  {
+    _gcFreeRetired(gc, true);
+    free(gc->retired);
+    releaseTimingWheel(&gc->wheel);
+    releaseTimerList(&gc->expired);
+    destroyCond(&gc->runCond);
+    releaseMutex(&gc->runMutex);
+    releaseMutex(&gc->wheelMutex);
+    free(gc);
+    self->gc = NULL;
+  }
 }
 
 /*--------
@@ -297,47 +638,108 @@ static void tableDel(UpdateCache* self, CacheEntry* cEntry)
 bool createUpdateCache(UpdateCache* self, UpdateResultChanged chCallback,
                        uint8_t minNumberOfClients, Configuration* sysConfig)
 {
-  if (!initMutex(&self->itemMutex))
+  UC_Shard* shard;
+  int idx;
+
+  if (!initMutex(&self->clientMutex))
+  {
+    RAISE_ERROR("Unable to setup the client Mutex");
+    return false;
+  }
+
+  self->gc = NULL;
+  if (!_gcCreate(self))
   {
-    RAISE_ERROR("Unable to setup the item Mutex");
+    releaseMutex(&self->clientMutex);
     return false;
   }
-  if (!createRWLock(&self->tableLock))
+
+  self->shards = calloc(UC_NUM_SHARDS, sizeof(UC_Shard));
+  if (self->shards == NULL)
   {
-    RAISE_ERROR("Unable to setup the hash table r/w lock");
-    releaseMutex(&self->itemMutex);
+    RAISE_ERROR("Not enough memory for the update cache shards");
+    _gcRelease(self);
+    releaseMutex(&self->clientMutex);
+    return false;
+  }
+
+  for (idx = 0; idx < UC_NUM_SHARDS; idx++)
+  {
+    shard = &((UC_Shard*)self->shards)[idx];
+    if (!initMutex(&shard->itemMutex))
+    {
+      RAISE_ERROR("Unable to setup the item Mutex");
+      break;
+    }
+    if (!createRWLock(&shard->tableLock))
+    {
+      RAISE_ERROR("Unable to setup the hash table r/w lock");
+      releaseMutex(&shard->itemMutex);
+      break;
+    }
+    // By default keep the hashtable null, it will be initialized with the
+    // first element that will be added.
+    shard->table     = NULL;
+    shard->pathIndex = NULL;
+    initSList(&shard->allItems);
+  }
+
+  if (idx < UC_NUM_SHARDS)
+  {
+    // Roll back the shards already initialized
+    while (--idx >= 0)
+    {
+      shard = &((UC_Shard*)self->shards)[idx];
+      releaseRWLock(&shard->tableLock);
+      releaseMutex(&shard->itemMutex);
+    }
+    free(self->shards);
+    self->shards = NULL;
+    _gcRelease(self);
+    releaseMutex(&self->clientMutex);
     return false;
   }
 
   self->resChangedCallback = chCallback;
-  // By default keep the hashtable null, it will be initialized with the first
-  // element that will be added.
-  self->table = NULL;
-  self->itemsUsed = NUM_PREALLOC;
   self->minNumberOfClients = minNumberOfClients;
   self->lockedClients = malloc(MAX_PROXY_CLIENT_ELEMENTS);
   memset(self->lockedClients, false, MAX_PROXY_CLIENT_ELEMENTS);
 
   self->sysConfig = sysConfig;
 
-  initSList(&self->allItems);
-
   return true;
 }
 
-//TODO: Documentation
+/**
+ * Frees all allocated resources.
+ *
+ * @param self Instance that should be released
+ */
 void releaseUpdateCache(UpdateCache* self)
 {
-  RAISE_ERROR("Release Update Cache also should empty the cache first!");
-  if (self != NULL)
-  {
-    releaseRWLock(&self->tableLock);
-    releaseMutex(&self->itemMutex);
+  UC_Shard* shard;
+  int idx;
 
+  if (self != NULL && self->shards != NULL)
+  {
+    // The garbage collector must not run on the released cache.
+    stopUpdateCacheGC(self);
     // Empty cache first
     emptyUpdateCache(self);
+    _gcRelease(self);
+
+    for (idx = 0; idx < UC_NUM_SHARDS; idx++)
+    {
+      shard = &((UC_Shard*)self->shards)[idx];
+      releaseSList(&shard->allItems);
+      releaseRWLock(&shard->tableLock);
+      releaseMutex(&shard->itemMutex);
+    }
+    free(self->shards);
+    self->shards = NULL;
     free(self->lockedClients);
-    releaseSList(&self->allItems);
+    self->lockedClients = NULL;
+    releaseMutex(&self->clientMutex);
   }
 }
 
@@ -347,6 +749,8 @@ void releaseUpdateCache(UpdateCache* self)
  * NOT change the update cache in any means. If already stored updates contain
  * SRx_RESULT_UNDEFINED as roa or bgpsec result, this result will be exchanged
  * with the default value.
+ * The result values are read under the shard's read lock only, the item mutex
+ * is only acquired if the client needs to be registered with the update.
  *
  * @param self The instance of the update cache
  * @param updId The update ID whose result is queried
@@ -374,9 +778,13 @@ bool getUpdateResult(UpdateCache* self, SRxUpdateID* updateID,
   // become MD5 or even more. For this we accept a pointer to the structure
   // but store it as value only. See documentation for SRxUpdateID for more info
   SRxUpdateID updID = *updateID;
+  UC_Shard*   shard = _getShard(self, updID);
+
+  acquireReadLock(&shard->tableLock);
+  cEntry = _shardFind(shard, updID);
 
   // Look for the update
-  if (tableFind(self, updID, &cEntry))
+  if (cEntry != NULL)
   {
     // Prefix Origin values
     srxRes->roaResult               = cEntry->srxResult.roaResult;
@@ -399,8 +807,10 @@ bool getUpdateResult(UpdateCache* self, SRxUpdateID* updateID,
     if (clientID > 0)
     {
       // Register the update with the client!
+      lockMutex(&shard->itemMutex);
       _addClientReference(self, cEntry, clientID,
                           (ProxyClientMapping*)clientMapping);
+      unlockMutex(&shard->itemMutex);
     }
 
     retVal = true;
@@ -421,13 +831,14 @@ bool getUpdateResult(UpdateCache* self, SRxUpdateID* updateID,
     defaultRes->resSourceASPA     = SRxRS_DONOTUSE;
     defaultRes->result.aspaResult = SRx_RESULT_DONOTUSE;
   }
+  unlockReadLock(&shard->tableLock);
 
   return retVal;
 }
 
 /**
  * Assign the given client to the cache entry. This method extends the memory
- * if needed.
+ * if needed. The caller MUST hold the item mutex of the entry's shard.
  *
  * @param cEntry The cache entry containing the update
  * @param clientID The client assigned to the update.
@@ -452,10 +863,9 @@ bool _addClientReference(UpdateCache* self, CacheEntry* cEntry,
     if (cEntry->clients[idx]==0)
     {
       cEntry->clients[idx] = clientID;
-      //TODO: depending on the final GC implementation if the GC uses a delete
-      //      list, remove this cEntry from there in case gcFlag > 0
-      // Increase the update count of this client
-      clientMapping->updateCount++;
+      // Increase the update count of this client. The shards use different
+      // locks, the count is shared by all of them.
+      __sync_fetch_and_add(&clientMapping->updateCount, 1);
       added = true;
       break;
     }
@@ -468,7 +878,8 @@ bool _addClientReference(UpdateCache* self, CacheEntry* cEntry,
 
   if (added)
   {
-    cEntry->gcFlag       = 0; // Reset the GC flag
+    // Reset the GC flag, the garbage collector skips the update from now on.
+    cEntry->gcFlag       = 0;
   }
   else
   { // run out of memory, increase the array list
@@ -489,6 +900,7 @@ bool _addClientReference(UpdateCache* self, CacheEntry* cEntry,
       // Now add the new client
       cEntry->clients[cEntry->noPossibleClients] = clientID;
       cEntry->noPossibleClients = (uint8_t)newSize;
+      cEntry->gcFlag = 0;
       added = true;
     }
     else
@@ -534,16 +946,21 @@ bool _addClientReference(UpdateCache* self, CacheEntry* cEntry,
  *               storage, the internal UNDEFINED and UNKNOWN will be used.
  * @param bgpData Contains BGP / BGPsec data. This parameter as well as defRes
  *               is only used during initial storing of an update. (CAN BE NULL)
- *
+ * @param pathId The AS path cache ID of the update.
+ * @param pduBuffer The received PDU bgpData points into. If given, the update
+ *               keeps a reference to the PDU instead of copying the paths.
+ *               (CAN BE NULL)
  *
  * @return 1 the result stored, 0 the update is already stored,
  *         -1 indicates an internal error
  */
 int storeUpdate(UpdateCache* self, uint8_t clientID, void* clientMapping,
                 SRxUpdateID* updateID, IPPrefix* prefix, uint32_t asn,
-                SRxDefaultResult* defRes, BGPSecData* bgpData, uint32_t pathId)
+                SRxDefaultResult* defRes, BGPSecData* bgpData, uint32_t pathId,
+                PDU_Buffer* pduBuffer)
 {
   CacheEntry* cEntry;
+  bool        registerSKI = false;
 
   int retVal = 1; // by default report it worked
 
@@ -551,139 +968,113 @@ int storeUpdate(UpdateCache* self, uint8_t clientID, void* clientMapping,
   // become MD5 or even more. For this we accept a pointer to the structure
   // but store it as value only. See documentation for SRxUpdateID for more info
   SRxUpdateID updID = *updateID;
+  UC_Shard*   shard = _getShard(self, updID);
 
   LOG(LEVEL_DEBUG, HDR "Store update [ID:0x%08X] in update cache.",
                    pthread_self(), updID);
 
+  // The lookup and the insertion are done under the same write lock, this
+  // way two clients storing the same update at the same time cannot both
+  // succeed.
+  acquireWriteLock(&shard->tableLock);
+
   // Existing entry then only update the result values.
-  if (tableFind(self, updID, &cEntry))
+  if (_shardFind(shard, updID) != NULL)
   {
+    unlockWriteLock(&shard->tableLock);
     LOG(LEVEL_WARNING, "Attempt to store an update that already exists in "
                        "update cache!");
-    retVal = 0;
+    return 0;
   }
-  else
-  {
-    // The update will be stored in two phases, first it will be stored in the
-    // update list that is accessible from outside. The the update information
-    // will be stored in the hash table.
 
-    // Store a brand new update in the list
-    // New entry
-    lockMutex(&self->itemMutex);
-
-    if (self->itemsUsed == NUM_PREALLOC)
-    {
-      // In case the pre-allocated empty space is used up, create more.
-      self->availItems = appendToSList(&self->allItems,
-                                       sizeof(CacheEntry) * NUM_PREALLOC);
-      if (self->availItems == NULL)
-      {
-        return -1;
-      }
-      self->itemsUsed = 0;
-    }
+  // The update will be stored in two phases, first it will be stored in the
+  // update list of the shard that is accessible from outside. The the update
+  // information will be stored in the hash table.
+  cEntry = (CacheEntry*)appendToSList(&shard->allItems, sizeof(CacheEntry));
+  if (cEntry == NULL)
+  {
+    unlockWriteLock(&shard->tableLock);
+    return -1;
+  }
+  memset(cEntry, 0, sizeof(CacheEntry));
 
-    // now get the new accessible space.
-    cEntry = (CacheEntry*)(self->availItems
-                           + (self->itemsUsed * sizeof(CacheEntry)));
-    // mark the entry as used for now.
-    self->itemsUsed++;
+  cEntry->updateID      = updID;
+  cEntry->asn           = asn;
+  cEntry->aspathCacheID = pathId;
+  cpyPrefix(&cEntry->prefix, prefix);
+  cEntry->srxResult.bgpsecResult = SRx_RESULT_UNDEFINED;
+  cEntry->srxResult.roaResult    = SRx_RESULT_UNDEFINED;
+  cEntry->srxResult.aspaResult   = SRx_RESULT_UNDEFINED;
 
-  //    unlockMutex(&self->itemMutex);
+  if (defRes != NULL)
+  {
+    cEntry->defaultResult.result.roaResult    = defRes->result.roaResult;
+    cEntry->defaultResult.result.bgpsecResult = defRes->result.bgpsecResult;
+    cEntry->defaultResult.result.aspaResult   = defRes->result.aspaResult;
+    cEntry->defaultResult.resSourceROA        = defRes->resSourceROA;
+    cEntry->defaultResult.resSourceBGPSEC     = defRes->resSourceBGPSEC;
+    cEntry->defaultResult.resSourceASPA       = defRes->resSourceASPA;
+  }
+  else
+  {
+    cEntry->defaultResult.result.roaResult    = SRx_RESULT_UNDEFINED;
+    cEntry->defaultResult.result.bgpsecResult = SRx_RESULT_UNDEFINED;
+    cEntry->defaultResult.result.aspaResult   = SRx_RESULT_UNDEFINED;
+    cEntry->defaultResult.resSourceROA        = SRxRS_UNKNOWN;
+    cEntry->defaultResult.resSourceBGPSEC     = SRxRS_UNKNOWN;
+    cEntry->defaultResult.resSourceASPA       = SRxRS_UNKNOWN;
+  }
+  // Other Update relates data
+  // BGPSEC
+  if (bgpData != NULL)
+  {
+    // The SKI cache registration is done once the entry is in the table.
+    registerSKI = storeCacheEntryBlob(cEntry, bgpData, prefix, pduBuffer);
+  }
 
-    cEntry->updateID      = updID;
-    cEntry->asn           = asn;
-    cEntry->aspathCacheID = pathId;
-    cpyPrefix(&cEntry->prefix, prefix);
-    cEntry->srxResult.bgpsecResult = SRx_RESULT_UNDEFINED;
-    cEntry->srxResult.roaResult    = SRx_RESULT_UNDEFINED;
-    cEntry->srxResult.aspaResult   = SRx_RESULT_UNDEFINED;
+  // Add the client ID to the update
+  int memsize = sizeof(uint8_t) * self->minNumberOfClients;
+  cEntry->clients = malloc(memsize);
+  memset(cEntry->clients, 0, memsize);
+  cEntry->noPossibleClients = self->minNumberOfClients;
 
-    if (defRes != NULL)
-    {
-      cEntry->defaultResult.result.roaResult    = defRes->result.roaResult;
-      cEntry->defaultResult.result.bgpsecResult = defRes->result.bgpsecResult;
-      cEntry->defaultResult.result.aspaResult   = defRes->result.aspaResult;
-      cEntry->defaultResult.resSourceROA        = defRes->resSourceROA;
-      cEntry->defaultResult.resSourceBGPSEC     = defRes->resSourceBGPSEC;
-      cEntry->defaultResult.resSourceASPA       = defRes->resSourceASPA;
-    }
-    else
-    {
-      cEntry->defaultResult.result.roaResult    = SRx_RESULT_UNDEFINED;
-      cEntry->defaultResult.result.bgpsecResult = SRx_RESULT_UNDEFINED;
-      cEntry->defaultResult.result.aspaResult   = SRx_RESULT_UNDEFINED;
-      cEntry->defaultResult.resSourceROA        = SRxRS_UNKNOWN;
-      cEntry->defaultResult.resSourceBGPSEC     = SRxRS_UNKNOWN;
-      cEntry->defaultResult.resSourceASPA       = SRxRS_UNKNOWN;
-    }
-    // Other Update relates data
-    // BGPSEC
-    if (bgpData != NULL)
-    {
-      memset(&cEntry->pathData, 0x00,  sizeof(UC_UpdateData));
-      //TODO: see BZ197 - this causes once a while a SEGDEV
-      // Maybe not anymore, completely rewritten in 0.5.0.0
-      if (storeCacheEntryBlob(cEntry, bgpData, prefix))
-      {
-        // Now register the update and SKIs with the SKI CACHE
-        SKI_CACHE* sCache = getSKICache();
-        ski_registerUpdate(sCache, &cEntry->updateID,
-                           (SCA_BGP_PathAttribute*)bgpData->bgpsec_path_attr);
-      }
-      // else the element exists already in the cache.
-      // It is not an error. BZ 1010
-      // in this case we do not need to register the update with the ski cache.
-      // it is already in
-    }
-    else
+  // ClientID might be zero "0" is the request is store only - This should not
+  // be the norm. updates with zero clients will be subject to garbage
+  // collection after a while.
+  if (clientID > 0)
+  {
+    // No item mutex needed, the entry is not visible to others yet.
+    if (!_addClientReference(self, cEntry,
+                             clientID, (ProxyClientMapping*)clientMapping))
     {
-      // If this here throws a SEGDEV then it is time to replace the SList
-      // implementation
-      UC_UpdateData* data = &cEntry->pathData;
-      if (data->bgpsec_path != NULL)
-      {
-        free(data->bgpsec_path);
-      }
-      if (data->asn_path != NULL)
-      {
-        free(data->asn_path);
-      }
-      memset(data, 0, sizeof(UC_UpdateData));
+      retVal = -1;
+      RAISE_SYS_ERROR("ERROR assigning client to update!!!");
+      // TODO: maybe remove the entry from the list!!!
     }
+  }
+  else
+  {
+    // Mark for GC
+    setGCFlag(self, cEntry, (uint16_t)self->sysConfig->defaultKeepWindow);
+  }
 
-    // Add the client ID to the update
-    int memsize = sizeof(uint8_t) * self->minNumberOfClients;
-    cEntry->clients = malloc(memsize);
-    memset(cEntry->clients, 0, memsize);
-    cEntry->noPossibleClients = self->minNumberOfClients;
-
-    // ClientID might be zero "0" is the request is store only - This should not
-    // be the norm. updates with zero clients will be subject to garbage
-    // collection after a while.
-    if (clientID > 0)
-    {
-      if (!_addClientReference(self, cEntry,
-                               clientID, (ProxyClientMapping*)clientMapping))
-      {
-        retVal = -1;
-        RAISE_SYS_ERROR("ERROR assigning client to update!!!");
-        // TODO: maybe remove the entry from the list!!!
-      }
-    }
-    else
-    {
-      // Mark for GC
-      uint16_t keepWindow = (uint16_t)self->sysConfig->defaultKeepWindow;
-      cEntry->gcFlag = getGCTime(keepWindow);
-    }
+  // Finally add the entry to cache.
+  HASH_ADD(hh, shard->table, updateID, sizeof(SRxUpdateID), cEntry);
+  if ((pathId != 0) && !_pathIndexAdd(shard, cEntry))
+  {
+    RAISE_SYS_ERROR("Could not add update [0x%08X] to the path index!", updID);
+  }
 
-    // Finally add the entry to cache.
-    tableAdd(self, cEntry);
+  unlockWriteLock(&shard->tableLock);
 
-    unlockMutex(&self->itemMutex);
+  if (registerSKI)
+  {
+    // Now register the update and SKIs with the SKI CACHE
+    SKI_CACHE* sCache = getSKICache();
+    ski_registerUpdate(sCache, &updID,
+                       (SCA_BGP_PathAttribute*)bgpData->bgpsec_path_attr);
   }
+
   return retVal;
 }
 
@@ -722,18 +1113,25 @@ bool modifyUpdateResult(UpdateCache* self, SRxUpdateID* updateID,
   // become MD5 or even more. For this we accept a pointer to the structure
   // but store it as value only. See documentation for SRxUpdateID for more info
   SRxUpdateID updID = *updateID;
+  UC_Shard*   shard = _getShard(self, updID);
+  SRxValidationResult valRes;
+
+  valRes.valType = VRT_NONE;
+  acquireReadLock(&shard->tableLock);
+  cEntry = _shardFind(shard, updID);
 
   // Existing entry then only update the result values.
-  if (!tableFind(self, updID, &cEntry))
+  if (cEntry == NULL)
   {
     RAISE_SYS_ERROR("Does not exist in update cache, can not modify it!");
     retVal = false;
   }
   else
   {
-    lockMutex(&self->itemMutex);
+    // Only updates of the same shard are serialized here. The result is
+    // copied under the mutex, the notification is send without any lock.
+    lockMutex(&shard->itemMutex);
 
-    SRxValidationResult valRes;
     valRes.updateID = updID;
     valRes.valType  = VRT_NONE;
     valRes.valResult.roaResult    = cEntry->srxResult.roaResult;
@@ -775,140 +1173,521 @@ bool modifyUpdateResult(UpdateCache* self, SRxUpdateID* updateID,
       }
     }
 
+    unlockMutex(&shard->itemMutex);
+  }
+  unlockReadLock(&shard->tableLock);
+
+  // check if a validation result changed. The callback sends to the clients,
+  // it MUST NOT be called while holding the locks of the shard.
+  if (!suppressNotification && (valRes.valType != VRT_NONE))
+  {
+    if (self->resChangedCallback != NULL)
+    {
+      // Notify of the change of validation result.(call handleUpdateResultChange)
+      self->resChangedCallback(&valRes); 
+    }
+    else
+    {
+      RAISE_ERROR("No resChangedCallback function registered! "
+                  "Cannot propagate the changes in the validation result!");
+      retVal = false;
+    }
+  }
+
+  return retVal;
+}
+    
+bool modifyUpdateCacheResultWithAspaVal(UpdateCache* self, SRxUpdateID* updateID,
+                        SRxResult* srxResult_aspa)
+{
+
+  CacheEntry* cEntry;
+  bool retVal = false;
+  SRxUpdateID updID = *updateID;
+  UC_Shard*   shard = _getShard(self, updID);
+
+  acquireReadLock(&shard->tableLock);
+  cEntry = _shardFind(shard, updID);
+
+  if (cEntry == NULL)
+  {
+    RAISE_SYS_ERROR("Does not exist in update cache, can not modify aspa result!");
+    retVal = false;
+  }
+  else
+  {
+    lockMutex(&shard->itemMutex);
+
+    // Check if ASPA srxResult_aspas can be used.
+    if (srxResult_aspa->aspaResult != SRx_RESULT_DONOTUSE)
+    { // Check for changes in bgpsec srxResult_aspa
+      if (srxResult_aspa->aspaResult != cEntry->srxResult.aspaResult)
+      {
+        cEntry->srxResult.aspaResult = srxResult_aspa->aspaResult;
+        LOG(LEVEL_INFO, "\033[92m""cEntry(UpdateCache) updated with uID: %08X, ASPA result:%d ""\033[0m", 
+            *updateID, srxResult_aspa->aspaResult);
+        retVal = true;
+      }
+    }
+
+    unlockMutex(&shard->itemMutex);
+  }
+  unlockReadLock(&shard->tableLock);
+
+  return retVal;
+}
+
+/**
+ * Schedule the update for the garbage collector. The update will be deleted
+ * once the keep time passed unless a client references it again in the
+ * meantime. The caller MUST hold the item mutex of the entry's shard or the
+ * write lock if the entry is not yet visible to others.
+ *
+ * @param self The update cache
+ * @param cEntry The cache entry - update
+ * @param keepTime The time in seconds the update is kept.
+ */
+void setGCFlag(UpdateCache* self, CacheEntry* cEntry, uint16_t keepTime)
+{
+  UC_GC* gc      = (UC_GC*)self->gc;
+  time_t expires = time(NULL) + keepTime;
+
+  lockMutex(&gc->wheelMutex);
+  // The time slot the wheel is advanced to is already collected.
+  if (expires <= gc->wheel.current)
+  {
+    expires = gc->wheel.current + 1;
+  }
+  // Only the most recent timer of the update matches the flag. Older timers
+  // are ignored by the garbage collector.
+  if (addToTimingWheel(&gc->wheel, cEntry->updateID, expires))
+  {
+    cEntry->gcFlag = expires;
+  }
+  unlockMutex(&gc->wheelMutex);
+}
+
+/**
+ * Determine if the update is referenced by a client. The caller MUST hold
+ * the item mutex of the entry's shard.
+ *
+ * @param cEntry The cache entry - update
+ *
+ * @return true if at least one client references the update.
+ *
+ * @since 0.6.0
+ */
+static bool _hasClients(CacheEntry* cEntry)
+{
+  int idx;
+
+  for (idx = 0; idx < cEntry->noPossibleClients; idx++)
+  {
+    if (cEntry->clients[idx] != 0)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Determine if any update of the cache uses the given AS path.
+ *
+ * @param self The update cache
+ * @param pathID The aspath cache key ID
+ *
+ * @return true if the path is in use.
+ *
+ * @since 0.6.0
+ */
+static bool _isPathInUse(UpdateCache* self, uint32_t pathID)
+{
+  UC_Shard*     shard;
+  UC_PathIndex* index = NULL;
+  int idx;
+
+  for (idx = 0; (idx < UC_NUM_SHARDS) && (index == NULL); idx++)
+  {
+    shard = &((UC_Shard*)self->shards)[idx];
+    acquireReadLock(&shard->tableLock);
+    HASH_FIND(hh, shard->pathIndex, &pathID, sizeof(uint32_t), index);
+    unlockReadLock(&shard->tableLock);
+  }
+
+  return index != NULL;
+}
+
+/**
+ * Return the number of bytes the update occupies.
+ *
+ * @param cEntry The cache entry - update
+ *
+ * @return The size in bytes.
+ *
+ * @since 0.6.0
+ */
+static uint32_t _gcSizeOfEntry(CacheEntry* cEntry)
+{
+  uint32_t size = sizeof(CacheEntry) + cEntry->noPossibleClients;
+
+  if (cEntry->pduBuffer != NULL)
+  {
+    // Other updates or packets might still share the PDU.
+    if (cEntry->pduBuffer->refCount == 1)
+    {
+      size += sizeof(PDU_Buffer) + cEntry->pduBuffer->size;
+    }
+  }
+  else
+  {
+    if (cEntry->pathData.asn_path != NULL)
+    {
+      size += cEntry->pathData.hops * sizeof(uint32_t);
+    }
+    if (cEntry->pathData.bgpsec_path != NULL)
+    {
+      size += cEntry->pathData.length;
+    }
+  }
+
+  return size;
+}
+
+/**
+ * Remove the marked updates of the batch from the item list of the shard. The
+ * caller MUST hold the write lock of the shard.
+ *
+ * @param shard The shard
+ * @param noBatch The number of marked updates.
+ *
+ * @since 0.6.0
+ */
+static void _gcUnlinkBatch(UC_Shard* shard, uint32_t noBatch)
+{
+  SList      removed;
+  SListNode* currNode = shard->allItems.root;
+  SListNode* prevNode = NULL;
+  SListNode* nextNode = NULL;
+
+  // One pass per batch, the oldest updates are found at the front.
+  initSList(&removed);
+  while ((currNode != NULL) && (removed.size < noBatch))
+  {
+    nextNode = currNode->next;
+    if (((CacheEntry*)currNode->data)->reclaimed)
+    {
+      // The memory of the update is released by the garbage collector.
+      currNode->allocSize = 0;
+      moveSListNode(&removed, &shard->allItems, currNode, prevNode);
+    }
+    else
+    {
+      prevNode = currNode;
+    }
+    currNode = nextNode;
+  }
+  releaseSList(&removed);
+}
+
+/**
+ * Remove the references other caches hold for the reclaimed update. The
+ * update is freed right away unless a reader still references it, in this
+ * case it is kept until the reader released it.
+ *
+ * @param self The update cache
+ * @param cEntry The update, already removed from its shard.
+ * @param lastOfShard The update was the last one of its shard using its path.
+ * @param now The current time
+ *
+ * @since 0.6.0
+ */
+static void _gcReclaim(UpdateCache* self, CacheEntry* cEntry, bool lastOfShard,
+                       time_t now)
+{
+  UC_GC*      gc = (UC_GC*)self->gc;
+  CacheEntry** retired;
+  uint32_t     newSize;
 
-    // check if a validation result changed.
-    if (!suppressNotification && (valRes.valType != VRT_NONE))
+  if (cEntry->pathData.bgpsec_path != NULL)
+  {
+    if (!ski_unregisterUpdate(getSKICache(), &cEntry->updateID,
+                              cEntry->pathData.bgpsec_path))
     {
-      if (self->resChangedCallback != NULL)
-      {
-        // Notify of the change of validation result.(call handleUpdateResultChange)
-        self->resChangedCallback(&valRes); 
-      }
-      else
-      {
-        RAISE_ERROR("No resChangedCallback function registered! "
-                    "Cannot propagate the changes in the validation result!");
-        retVal = false;
-      }
+      LOG(LEVEL_WARNING, "Could not unregister update [0x%08X] from the ski "
+                         "cache!", cEntry->updateID);
     }
+  }
+  // The update is only known to the prefix cache if it was validated.
+  if (gc->prefixCache != NULL)
+  {
+    removeUpdate(gc->prefixCache, &cEntry->updateID, &cEntry->prefix,
+                 cEntry->asn);
+  }
+  if (   lastOfShard && (gc->aspathCache != NULL)
+      && !_isPathInUse(self, cEntry->aspathCacheID))
+  {
+    // Paths used recently are about to be referenced by a new update.
+    deleteAspathListFromAspathCache(gc->aspathCache, cEntry->aspathCacheID,
+                                    now - UC_GC_PATH_IDLE);
+  }
+
+  gc->reclaimed++;
+  gc->reclaimedBytes += _gcSizeOfEntry(cEntry);
 
-    unlockMutex(&self->itemMutex);
+  if (__sync_fetch_and_add(&cEntry->refCount, 0) == 0)
+  {
+    _gcFreeEntry(cEntry);
+    return;
   }
 
-  return retVal;
+  if (gc->noRetired == gc->sizeRetired)
+  {
+    newSize = (gc->sizeRetired == 0) ? UC_GC_BATCH : gc->sizeRetired * 2;
+    retired = realloc(gc->retired, newSize * sizeof(CacheEntry*));
+    if (retired == NULL)
+    {
+      // Leaking the update is better than pulling it away from the reader.
+      RAISE_SYS_ERROR("Not enough memory to retire update [0x%08X]!",
+                      cEntry->updateID);
+      return;
+    }
+    gc->retired     = retired;
+    gc->sizeRetired = newSize;
+  }
+  gc->retired[gc->noRetired++] = cEntry;
 }
-    
-bool modifyUpdateCacheResultWithAspaVal(UpdateCache* self, SRxUpdateID* updateID,
-                        SRxResult* srxResult_aspa)
+
+/**
+ * Compare the shards of two timers, used to group the expired updates by
+ * their shard.
+ *
+ * @param a The first timer
+ * @param b The second timer
+ *
+ * @return <0, 0, >0 as required by qsort.
+ *
+ * @since 0.6.0
+ */
+static int _gcCmpShard(const void* a, const void* b)
 {
+  uint32_t shardA = _getShardIdx(((const TW_Timer*)a)->id);
+  uint32_t shardB = _getShardIdx(((const TW_Timer*)b)->id);
+
+  return (shardA > shardB) - (shardA < shardB);
+}
 
+/**
+ * Perform one run of the garbage collector. All updates whose keep window
+ * passed at the given time are reclaimed in batches of UC_GC_BATCH updates.
+ * This is called by the garbage collector thread and MUST NOT be called while
+ * the thread is running.
+ *
+ * @param self The update cache
+ * @param now The current time
+ *
+ * @return The number of updates reclaimed.
+ *
+ * @since 0.6.0
+ */
+uint32_t runUpdateCacheGC(UpdateCache* self, time_t now)
+{
+  UC_GC*      gc = (UC_GC*)self->gc;
+  UC_Shard*   shard;
   CacheEntry* cEntry;
-  bool retVal = false;
-  SRxUpdateID updID = *updateID;
+  TW_Timer*   timer;
+  CacheEntry* batch[UC_GC_BATCH];
+  bool        lastOfShard[UC_GC_BATCH];
+  uint32_t    noBatch, bIdx, shardIdx;
+  uint32_t    idx       = 0;
+  uint32_t    reclaimed = 0;
 
-  if (!tableFind(self, updID, &cEntry))
+  _gcFreeRetired(gc, false);
+
+  lockMutex(&gc->wheelMutex);
+  gc->expired.count = 0;
+  advanceTimingWheel(&gc->wheel, now, &gc->expired);
+  unlockMutex(&gc->wheelMutex);
+
+  if (gc->expired.count > 1)
   {
-    RAISE_SYS_ERROR("Does not exist in update cache, can not modify aspa result!");
-    retVal = false;
+    qsort(gc->expired.timers, gc->expired.count, sizeof(TW_Timer),
+          _gcCmpShard);
   }
-  else
-  {
-    lockMutex(&self->itemMutex);
 
-    // Check if ASPA srxResult_aspas can be used.
-    if (srxResult_aspa->aspaResult != SRx_RESULT_DONOTUSE)
-    { // Check for changes in bgpsec srxResult_aspa
-      if (srxResult_aspa->aspaResult != cEntry->srxResult.aspaResult)
+  while (idx < gc->expired.count)
+  {
+    shardIdx = _getShardIdx(gc->expired.timers[idx].id);
+    shard    = &((UC_Shard*)self->shards)[shardIdx];
+    noBatch  = 0;
+
+    // Hold the write lock for one batch only, the other updates of the shard
+    // are processed with the next lock.
+    acquireWriteLock(&shard->tableLock);
+    lockMutex(&shard->itemMutex);
+    for (; (idx < gc->expired.count) && (noBatch < UC_GC_BATCH); idx++)
+    {
+      timer = &gc->expired.timers[idx];
+      if (_getShardIdx(timer->id) != shardIdx)
       {
-        cEntry->srxResult.aspaResult = srxResult_aspa->aspaResult;
-        LOG(LEVEL_INFO, "\033[92m""cEntry(UpdateCache) updated with uID: %08X, ASPA result:%d ""\033[0m", 
-            *updateID, srxResult_aspa->aspaResult);
-        retVal = true;
+        break;
+      }
+      cEntry = _shardFind(shard, timer->id);
+      // The update is gone, referenced again, or rescheduled.
+      if (   (cEntry == NULL) || (cEntry->gcFlag != timer->expires)
+          || _hasClients(cEntry))
+      {
+        continue;
       }
+      HASH_DEL(shard->table, cEntry);
+      lastOfShard[noBatch] =    (cEntry->aspathCacheID != 0)
+                             && _pathIndexDel(shard, cEntry);
+      cEntry->reclaimed = true;
+      batch[noBatch++]  = cEntry;
     }
+    _gcUnlinkBatch(shard, noBatch);
+    unlockMutex(&shard->itemMutex);
+    unlockWriteLock(&shard->tableLock);
 
-    unlockMutex(&self->itemMutex);
+    for (bIdx = 0; bIdx < noBatch; bIdx++)
+    {
+      _gcReclaim(self, batch[bIdx], lastOfShard[bIdx], now);
+    }
+    reclaimed += noBatch;
   }
-  return retVal;
+
+  if (reclaimed > 0)
+  {
+    LOG(LEVEL_DEBUG, HDR "Garbage collector reclaimed %u updates.",
+        pthread_self(), reclaimed);
+  }
+
+  return reclaimed;
 }
 
 /**
- * Try to finally delete the update.
+ * The garbage collector thread. Runs the garbage collector every
+ * UC_GC_INTERVAL seconds until it is stopped.
  *
- * @param self The Update cache
- * @param cEntry The cache entry (update)
- * @param pCache The prefix cache.
- * @param force  Force the deletion of the update. This ignores if the update is
- *               still referenced by clients.
+ * @param cache The update cache
  *
- * @return true if the update was deleted, otherwise false/
+ * @return NULL
  *
- * @since 0.3.0
+ * @since 0.6.0
  */
-bool gcTestAndDeleteUpdate(UpdateCache* self, CacheEntry* cEntry,
-                           void* pCache, bool force)
+static void* _gcThreadLoop(void* cache)
 {
-  //TODO: Test one last time if the update can be deleted. If so then delete it.
-  // This method MUST be called by the garbage collector.
-  LOG(LEVEL_INFO,"IMPLEMENTATION CAN BE EXPECTED WITH VERSION 0.4");
-  bool delete = !force;
+  UpdateCache* self = (UpdateCache*)cache;
+  UC_GC*       gc   = (UC_GC*)self->gc;
 
-  if (!force)
+  LOG(LEVEL_DEBUG, "Enter loop of the Update Cache garbage collector.");
+  lockMutex(&gc->runMutex);
+  while (gc->running)
   {
-    // 1. CHECK IF GC TIME IS READY
-
-    // 2. CHECK ONE MORE TIME IF NO REFERENCE EXISTS
+    waitCond(&gc->runCond, &gc->runMutex, UC_GC_INTERVAL * 1000);
+    if (gc->running)
+    {
+      unlockMutex(&gc->runMutex);
+      runUpdateCacheGC(self, time(NULL));
+      lockMutex(&gc->runMutex);
+    }
   }
+  unlockMutex(&gc->runMutex);
+  LOG(LEVEL_DEBUG, "Exit loop of the Update Cache garbage collector.");
+
+  return NULL;
+}
+
+/**
+ * Start the garbage collector thread of the update cache. Updates without
+ * clients are reclaimed once their keep window passed. Reclaimed updates are
+ * also removed from the given prefix cache, the SKI cache, and if no other
+ * update uses their AS path, from the AS path cache.
+ *
+ * @param self The update cache
+ * @param prefixCache The prefix cache (PrefixCache*) or NULL.
+ * @param aspathCache The AS path cache (AspathCache*) or NULL.
+ *
+ * @return false if the thread could not be started.
+ *
+ * @since 0.6.0
+ */
+bool startUpdateCacheGC(UpdateCache* self, void* prefixCache,
+                        void* aspathCache)
+{
+  UC_GC* gc = (UC_GC*)self->gc;
+  bool   retVal;
 
-  if (delete)
+  lockMutex(&gc->runMutex);
+  if (!gc->running)
   {
-    if (!removeUpdate((PrefixCache*)pCache, &cEntry->updateID, &cEntry->prefix,
-                      cEntry->asn))
+    gc->prefixCache = (PrefixCache*)prefixCache;
+    gc->aspathCache = (AspathCache*)aspathCache;
+    gc->running     = true;
+    if (pthread_create(&gc->thread, NULL, _gcThreadLoop, self) != 0)
     {
-      // The reason might be that the update was not validated. (stored only)
-      LOG(LEVEL_WARNING, "Could not delete the update 0x08X from the prefix "
-                         "cache!");
+      gc->running = false;
+      RAISE_SYS_ERROR("Could not start the Update Cache garbage collector!");
     }
-
-    // now remove it from the update cache
-    // Does not release the memory but only removes the hash table entry
-    tableDel(self, cEntry);
-    // Now remove it from the allItems list of the cache
-    deleteFromSList(&self->allItems, cEntry);
-
-    // Free the memory of the bgpsec blob;
-    _cleanCachPathData(cEntry);
-    // Free the cache entry.
-    free(cEntry);
   }
+  retVal = gc->running;
+  unlockMutex(&gc->runMutex);
 
-  return delete;
+  return retVal;
 }
 
 /**
- * Set the flag when the update can be garbage collected.
+ * Stop the garbage collector thread. This MUST be called before the caches
+ * given to startUpdateCacheGC are released.
  *
- * @param cEntry The cache entry - update
- * @param timeOfDeletion The GC time when the update can be deleted.
+ * @param self The update cache
+ *
+ * @since 0.6.0
  */
-void setGCFlag(CacheEntry* cEntry, uint16_t timeOfDeletion)
+void stopUpdateCacheGC(UpdateCache* self)
 {
-  cEntry->gcFlag = timeOfDeletion;
+  UC_GC* gc = (UC_GC*)self->gc;
+  bool   wasRunning;
+
+  if (gc == NULL)
+  {
+    return;
+  }
+
+  lockMutex(&gc->runMutex);
+  wasRunning  = gc->running;
+  gc->running = false;
+  signalCond(&gc->runCond);
+  unlockMutex(&gc->runMutex);
+
+  if (wasRunning)
+  {
+    pthread_join(gc->thread, NULL);
+  }
+  gc->prefixCache = NULL;
+  gc->aspathCache = NULL;
 }
 
 /**
- * Calculates a new GC time when to run.
+ * Fill the statistics of the garbage collector.
  *
- * @param keepTime The proposed time to wait
+ * @param self The update cache
+ * @param info The statistics to be filled.
  *
- * @return the next time the GC can run. Notice that this timestamp is a 16 bit,
- *         NOT 32 bit number. The Garbage collector knows how to deal with
- *         overflows
+ * @since 0.6.0
  */
-uint16_t getGCTime(uint16_t keepTime)
+void getUpdateCacheGCInfo(UpdateCache* self, UC_GCInfo* info)
 {
-  time_t nextRealTime = time(NULL) + keepTime;
-  return (uint16_t)(nextRealTime);
+  UC_GC* gc = (UC_GC*)self->gc;
+
+  // For display only, the counters are not synchronized.
+  info->reclaimed      = gc->reclaimed;
+  info->reclaimedBytes = gc->reclaimedBytes;
+  info->retired        = gc->noRetired;
+  lockMutex(&gc->wheelMutex);
+  info->scheduled      = gc->wheel.count;
+  unlockMutex(&gc->wheelMutex);
 }
 
 /**
@@ -972,16 +1751,16 @@ int _deleteUpdateFromCache_clientMgmt(CacheEntry* entry, uint8_t clientID)
  *                 If this id is zero all mappings and the update itself will be
  *                 removed!
  * @param cEntry   The update itself.
- * @param timeOfDeletion A proposed real-time in seconds until the update should
- *                 be kept before final deletion. The cache might remove the
- *                 update at any other time though.
+ * @param keepTime A proposed time in seconds the update should still be kept
+ *                 before final deletion. The cache might remove the update at
+ *                 any other time though.
  *
  * @return true If the update / association could be removed, false if the
  *              update was not either found in the cache or no association to
  *              the client was found.
  */
 int _deleteUpdateFromCache(UpdateCache* self, uint8_t clientID,
-                           CacheEntry*  cEntry, uint16_t timeOfDeletion)
+                           CacheEntry*  cEntry, uint16_t keepTime)
 {
   bool retVal = false;
 
@@ -995,7 +1774,7 @@ int _deleteUpdateFromCache(UpdateCache* self, uint8_t clientID,
       retVal = false;
       break;
     case 0 : // no reference left
-      setGCFlag(cEntry, timeOfDeletion);
+      setGCFlag(self, cEntry, keepTime);
     case 1 : // still some left, don't delete
     default:
       retVal = true;
@@ -1006,8 +1785,8 @@ int _deleteUpdateFromCache(UpdateCache* self, uint8_t clientID,
 
 /**
  * Removes the update data from the list and releases all memory associated to
- * it. Also, if this update contains bgpsec blob, it will remove this
- * update from the SKI Cache.
+ * it. Once no client references the update anymore it is scheduled for the
+ * garbage collector which also removes it from the SKI Cache.
  *
  * @note This method ONLY deletes the update from the update cache. It is
  *       important to assure that other references such as the prefix_cache
@@ -1040,25 +1819,20 @@ bool deleteUpdateFromCache(UpdateCache* self, uint8_t clientID,
   {
     keepTime = self->sysConfig->defaultKeepWindow;
   }
-  uint16_t timeToBeDeleted = getGCTime(keepTime);
+  UC_Shard* shard = _getShard(self, updID);
 
   // Get the update cache entry from the update cache.
-  if (tableFind(self, updID, &cEntry))
+  acquireReadLock(&shard->tableLock);
+  cEntry = _shardFind(shard, updID);
+  if (cEntry != NULL)
   {
-    retVal = _deleteUpdateFromCache(self, clientID, cEntry, timeToBeDeleted);
-    if (retVal && (cEntry->pathData.bgpsec_path != NULL))
-    {
-      // Unregister the update from the SKI CACHE.
-      SKI_CACHE* sCache = getSKICache();
-      UC_UpdateData* data = &cEntry->pathData;
-      if (!ski_unregisterUpdate(sCache, updateID, data->bgpsec_path))
-      {
-        LOG(LEVEL_WARNING, "Could not unregister update [0x%08X] from the ski "
-                           "cache!", updID);
-      }
-    }
+    lockMutex(&shard->itemMutex);
+    retVal = _deleteUpdateFromCache(self, clientID, cEntry, keepTime);
+    unlockMutex(&shard->itemMutex);
   }
-  else
+  unlockReadLock(&shard->tableLock);
+
+  if (cEntry == NULL)
   {
     LOG(LEVEL_INFO, "Delete aborted, update [0x%08X] not found!", updID);
   }
@@ -1127,6 +1901,7 @@ UpdSigResult* getUpdateSignature(UpdateCache* self, UpdSigResult* result,
 bool getUpdateStats(UpdateCache* self, UC_UpdateStatistics* statistics)
 {
   CacheEntry* cEntry;
+  UC_Shard*   shard;
   bool retVal = false;
 
   if (statistics == NULL)
@@ -1137,55 +1912,89 @@ bool getUpdateStats(UpdateCache* self, UC_UpdateStatistics* statistics)
   {
     RAISE_SYS_ERROR("The given updaetID is 0 (INVALID ID)!");
   }
-  // Look for the update
-  else if (tableFind(self, *statistics->updateID, &cEntry))
+  else
   {
-    retVal = true;
-    statistics->asn                           = cEntry->asn;
-    cpyPrefix(&statistics->prefix, &cEntry->prefix);
-    statistics->bgpsecResult.containsError    = false;
-    statistics->bgpsecResult.errorCode        = 0;
-    statistics->bgpsecResult.signatureBlock   = NULL;
-    statistics->bgpsecResult.signatureLength  = 0;
-    statistics->defResult.resSourceROA   =cEntry->defaultResult.resSourceROA;
-    statistics->defResult.resSourceBGPSEC=cEntry->defaultResult.resSourceBGPSEC;
-    statistics->defResult.result.roaResult =
-                                         cEntry->defaultResult.result.roaResult;
-    statistics->defResult.result.bgpsecResult =
-                                      cEntry->defaultResult.result.bgpsecResult;
-    statistics->result.roaResult    = cEntry->srxResult.roaResult;
-    statistics->result.bgpsecResult = cEntry->srxResult.bgpsecResult;
-    statistics->roa_count           = cEntry->roaRefCount;
+    shard = _getShard(self, *statistics->updateID);
+    acquireReadLock(&shard->tableLock);
+    // Look for the update
+    cEntry = _shardFind(shard, *statistics->updateID);
+    if (cEntry != NULL)
+    {
+      retVal = true;
+      statistics->asn                           = cEntry->asn;
+      cpyPrefix(&statistics->prefix, &cEntry->prefix);
+      statistics->bgpsecResult.containsError    = false;
+      statistics->bgpsecResult.errorCode        = 0;
+      statistics->bgpsecResult.signatureBlock   = NULL;
+      statistics->bgpsecResult.signatureLength  = 0;
+      statistics->defResult.resSourceROA =
+                                          cEntry->defaultResult.resSourceROA;
+      statistics->defResult.resSourceBGPSEC =
+                                       cEntry->defaultResult.resSourceBGPSEC;
+      statistics->defResult.result.roaResult =
+                                      cEntry->defaultResult.result.roaResult;
+      statistics->defResult.result.bgpsecResult =
+                                   cEntry->defaultResult.result.bgpsecResult;
+      statistics->result.roaResult    = cEntry->srxResult.roaResult;
+      statistics->result.bgpsecResult = cEntry->srxResult.bgpsecResult;
+      statistics->roa_count           = cEntry->roaRefCount;
+    }
+    unlockReadLock(&shard->tableLock);
   }
   return retVal;
 }
 
 /**
- * Return the cache internal copy of the update data.
+ * Return the cache internal copy of the update data. The update is referenced
+ * until the data is returned using releaseUpdateData, the garbage collector
+ * does not free it in the meantime.
  *
  * @param self The update cache
  * @param updateID The ID of the update
  *
- * @return the pointer to the internal stored bgp update data
+ * @return the pointer to the internal stored bgp update data or NULL.
  *
  * @since 0.5.0.0
  */
 UC_UpdateData* getUpdateData(UpdateCache* self, SRxUpdateID* updateID)
 {
-  CacheEntry* cEntry = NULL;
-  UC_UpdateData* data = NULL;
-  SCA_BGP_PathAttribute* bgpsec_path = NULL;
-
-  // Look for the update
-  if (tableFind(self, *updateID, &cEntry))
+  CacheEntry*    cEntry = NULL;
+  UC_UpdateData* data   = NULL;
+  UC_Shard*      shard  = _getShard(self, *updateID);
+
+  // The garbage collector removes updates under the write lock only, no
+  // reference can be added to an update already reclaimed.
+  acquireReadLock(&shard->tableLock);
+  cEntry = _shardFind(shard, *updateID);
+  if (cEntry != NULL)
   {
+    __sync_fetch_and_add(&cEntry->refCount, 1);
     data = &cEntry->pathData;
-    bgpsec_path = data->bgpsec_path;
   }
+  unlockReadLock(&shard->tableLock);
 
   return data;
 }
 
+/**
+ * Release the update data received by getUpdateData. The data MUST NOT be
+ * used anymore.
+ *
+ * @param self The update cache
+ * @param data The update data, can be NULL.
+ *
+ * @since 0.6.0
+ */
+void releaseUpdateData(UpdateCache* self, UC_UpdateData* data)
+{
+  if (data != NULL)
+  {
+    CacheEntry* cEntry = (CacheEntry*)((uint8_t*)data
+                                       - offsetof(CacheEntry, pathData));
+    __sync_sub_and_fetch(&cEntry->refCount, 1);
+  }
+}
+
 /**
  * Empties a cache and releases all memory attached to each of the elements.
  *
@@ -1195,22 +2004,38 @@ UC_UpdateData* getUpdateData(UpdateCache* self, SRxUpdateID* updateID)
  */
 void emptyUpdateCache(UpdateCache* self)
 {
-  ////////////////////////////////////////////////////////////////////////////// TOUCHED(X); OK ( ); NOT YET ( ); Tested ( )
-  acquireWriteLock(&self->tableLock);
-  lockMutex(&self->itemMutex);
-  emptySList(&self->allItems);
+  UC_Shard*   shard;
+  SListNode*  lNode;
+  CacheEntry* cEntry;
+  int idx;
+
+  for (idx = 0; idx < UC_NUM_SHARDS; idx++)
+  {
+    shard = &((UC_Shard*)self->shards)[idx];
+    acquireWriteLock(&shard->tableLock);
+    lockMutex(&shard->itemMutex);
+    FOREACH_SLIST(&shard->allItems, lNode)
+    {
+      cEntry = (CacheEntry*)lNode->data;
+      if (cEntry != NULL)
+      {
+        _cleanCachPathData(cEntry);
+        free(cEntry->clients);
+        cEntry->clients = NULL;
+      }
+    }
+    emptySList(&shard->allItems);
+    shard->table = NULL;
+    _pathIndexEmpty(shard);
+    unlockMutex(&shard->itemMutex);
+    unlockWriteLock(&shard->tableLock);
+  }
+
   SKI_CACHE* sCache = getSKICache();
   // clean all updates from the update cache.
   ski_clean(sCache, SKI_CLEAN_UPDATES);
-  unlockMutex(&self->itemMutex);
-
-  self->table     = NULL;
-  self->itemsUsed = NUM_PREALLOC;
-
-  unlockWriteLock(&self->tableLock);
 }
 
-
 /**
  * This method is used to configure the update cache in such that the minimum
  * number of clients expected per update can be configured. the value MUST not
@@ -1247,11 +2072,15 @@ int getClientIDsOfUpdate(UpdateCache* self, SRxUpdateID* updateID,
 {
   // The cache entry also need the addition of source and predefined result.
   CacheEntry* cEntry = NULL;
+  UC_Shard*   shard  = _getShard(self, *updateID);
   int retVal = 0;
   int idx = 0;
 
-  // Look for the update
-  if (tableFind(self, *updateID, &cEntry))
+  // Look for the update, the item mutex guards the clients.
+  acquireReadLock(&shard->tableLock);
+  lockMutex(&shard->itemMutex);
+  cEntry = _shardFind(shard, *updateID);
+  if (cEntry != NULL)
   {
     if (cEntry->noPossibleClients <= size)
     {
@@ -1270,6 +2099,8 @@ int getClientIDsOfUpdate(UpdateCache* self, SRxUpdateID* updateID,
       retVal = -1;
     }
   }
+  unlockMutex(&shard->itemMutex);
+  unlockReadLock(&shard->tableLock);
 
   return retVal;
 }
@@ -1290,42 +2121,67 @@ int unregisterClientID(UpdateCache* self, uint8_t clientID, void* clientMapping,
                        uint32_t keepTime)
 {
   int idsRemoved = -1;
+  int idx;
+  UC_Shard*   shard;
   SListNode*  lNode;
   CacheEntry* cEntry;
   ProxyClientMapping* mapping = (ProxyClientMapping*)clientMapping;
 
-  acquireWriteLock(&self->tableLock);
-  lockMutex(&self->itemMutex);
+  if (keepTime < self->sysConfig->defaultKeepWindow)
+  {
+    keepTime = self->sysConfig->defaultKeepWindow;
+  }
+  if (keepTime > UINT16_MAX)
+  {
+    keepTime = UINT16_MAX;
+  }
+
+  lockMutex(&self->clientMutex);
   if (!self->lockedClients[clientID])
   {
-    idsRemoved = 0;
     self->lockedClients[clientID]=true;
-    FOREACH_SLIST(&self->allItems, lNode)
+  }
+  else
+  {
+    unlockMutex(&self->clientMutex);
+    LOG(LEVEL_ERROR, "Attempt to unregister clocked client[0x%02X] from update "
+                     "cache!", clientID);
+    return idsRemoved;
+  }
+  unlockMutex(&self->clientMutex);
+
+  // Only one shard at a time is locked, all other shards remain accessible.
+  idsRemoved = 0;
+  for (idx = 0; (idx < UC_NUM_SHARDS)
+                && (__sync_fetch_and_add(&mapping->updateCount, 0) != 0); idx++)
+  {
+    shard = &((UC_Shard*)self->shards)[idx];
+    acquireReadLock(&shard->tableLock);
+    lockMutex(&shard->itemMutex);
+    FOREACH_SLIST(&shard->allItems, lNode)
     {
       cEntry = (CacheEntry*)lNode->data;
       if (cEntry != NULL)
       {
-        if (_deleteUpdateFromCache(self, clientID, cEntry, keepTime))
+        if (_deleteUpdateFromCache(self, clientID, cEntry,
+                                   (uint16_t)keepTime))
         {
           idsRemoved++;
-          mapping->updateCount--;
+          __sync_fetch_and_sub(&mapping->updateCount, 1);
         }
       }
-      if (mapping->updateCount == 0)
+      if (__sync_fetch_and_add(&mapping->updateCount, 0) == 0)
       {
         break;
       }
     }
-    self->lockedClients[clientID]=false;
+    unlockMutex(&shard->itemMutex);
+    unlockReadLock(&shard->tableLock);
   }
-  else
-  {
-    LOG(LEVEL_ERROR, "Attempt to unregister clocked client[0x%02X] from update "
-                     "cache!", clientID);
 
-  }
-  unlockMutex(&self->itemMutex);
-  unlockWriteLock(&self->tableLock);
+  lockMutex(&self->clientMutex);
+  self->lockedClients[clientID]=false;
+  unlockMutex(&self->clientMutex);
 
   return idsRemoved;
 }
@@ -1349,13 +2205,16 @@ bool detectCollision(UpdateCache* self, SRxUpdateID* updateID, IPPrefix* prefix,
 {
   CacheEntry* cEntry;
   UC_UpdateData* data;
+  UC_Shard* shard = _getShard(self, *updateID);
   bool collision = false;
 
   // Generic usage for all data buffers
   int length = 0;
 
   // Try to find the update itself.
-  if (tableFind(self, *updateID, &cEntry))
+  acquireReadLock(&shard->tableLock);
+  cEntry = _shardFind(shard, *updateID);
+  if (cEntry != NULL)
   {
     data = &cEntry->pathData;
 
@@ -1396,6 +2255,7 @@ bool detectCollision(UpdateCache* self, SRxUpdateID* updateID, IPPrefix* prefix,
       }
     }
   }
+  unlockReadLock(&shard->tableLock);
 
   return collision;
 }
@@ -1487,6 +2347,8 @@ void outputUpdateCacheAsXML(UpdateCache* self, FILE* stream, int maxBlob)
 {
 #define CLIENT_LIST_STRING_LEN 1024
   XMLOut      out;
+  UC_Shard*   shard;
+  int         shIdx;
   SListNode*  updateListNode;
   CacheEntry* update;
   uint8_t     clIdx;
@@ -1498,78 +2360,86 @@ void outputUpdateCacheAsXML(UpdateCache* self, FILE* stream, int maxBlob)
   openTag(&out, "update-cache");
 
   // Add the current gc time
-  addU32Attrib(&out, "current-gc-time", getGCTime(0));
+  addU32Attrib(&out, "current-gc-time", (uint16_t)time(NULL));
 
   // Updates
-  if (sizeOfSList(&self->allItems))
+  if (sizeOfUpdateCache(self) > 0)
   {
     openTag(&out, "updates");
-    FOREACH_SLIST(&self->allItems, updateListNode)
+    for (shIdx = 0; shIdx < UC_NUM_SHARDS; shIdx++)
     {
-      update = (CacheEntry*)getDataOfSListNode(updateListNode);
-      openTag(&out, "update");
-        addH32Attrib(&out, "update-id", update->updateID);
-        // noClients contains the number of clients used during the last run.
-        // the multiplicator "4" is used for the maximum space used for any
-        // client ID (3 char + comma)
-        memset(clientString, '\0', noClients*4);
-        noClients = 0;
-        strPtr = clientString;
-        for(clIdx = 0; clIdx < update->noPossibleClients; clIdx++)
-        {
-          if (update->clients[clIdx] != 0)
+      shard = &((UC_Shard*)self->shards)[shIdx];
+      acquireReadLock(&shard->tableLock);
+      FOREACH_SLIST(&shard->allItems, updateListNode)
+      {
+        update = (CacheEntry*)getDataOfSListNode(updateListNode);
+        openTag(&out, "update");
+          addH32Attrib(&out, "update-id", update->updateID);
+          // noClients contains the number of clients used during the last run.
+          // the multiplicator "4" is used for the maximum space used for any
+          // client ID (3 char + comma)
+          memset(clientString, '\0', noClients*4);
+          noClients = 0;
+          strPtr = clientString;
+          for(clIdx = 0; clIdx < update->noPossibleClients; clIdx++)
           {
-            noClients++;
-            if (noClients == 1)
+            if (update->clients[clIdx] != 0)
             {
-              strPtr += sprintf(strPtr, "%u", update->clients[clIdx]);
-            }
-            else
-            {
-              strPtr += sprintf(strPtr, ",%u", update->clients[clIdx]);
+              noClients++;
+              if (noClients == 1)
+              {
+                strPtr += sprintf(strPtr, "%u", update->clients[clIdx]);
+              }
+              else
+              {
+                strPtr += sprintf(strPtr, ",%u", update->clients[clIdx]);
+              }
             }
           }
-        }
-        addU32Attrib(&out, "no-clients", noClients);
-        if (noClients > 0)
-        {
-          addStrAttrib(&out, "client-list", clientString);
-        }
-        addU32Attrib(&out, "gc", update->gcFlag);
-        addU32Attrib(&out, "origin-as", update->asn);
-        addAttrib(&out, "prefix", "%s/%u",
-                  ipToStr(&update->prefix.ip),
-                  update->prefix.length);
-        addIntAttrib(&out, "roa-count", update->roaRefCount);
-        if (!printXMLValResult(&out, "origin-val",
-                               update->srxResult.roaResult, true))
-        {
-          RAISE_ERROR("Update[0%x08X] with invalid origin validation state %d",
-                      update->updateID, update->srxResult.roaResult);
-        }
-        if (!printXMLValResult(&out, "path-val", update->srxResult.bgpsecResult,
-                               false))
-        {
-          RAISE_ERROR("Update[0%x08X] with invalid path validation state %d",
-                      update->updateID, update->srxResult.bgpsecResult);
-        }
-        if (!printXMLValResult(&out, "def-origin-val",
-                               update->defaultResult.result.roaResult, true))
-        {
-          RAISE_ERROR("Update[0%x08X] with invalid default origin validation "
-                      "state %d", update->updateID,
-                      update->defaultResult.result.roaResult);
-        }
-        if (!printXMLValResult(&out, "def-path-val",
-                               update->defaultResult.result.bgpsecResult, true))
-        {
-          RAISE_ERROR("Update[0%x08X] with invalid default path validation "
-                      "state %d", update->updateID,
-                      update->defaultResult.result.bgpsecResult);
-        }
-        addIntAttrib(&out, "hops", update->pathData.hops);
-        addIntAttrib(&out, "bgpsec-len", update->pathData.length);
-      closeTag(&out);
+          addU32Attrib(&out, "no-clients", noClients);
+          if (noClients > 0)
+          {
+            addStrAttrib(&out, "client-list", clientString);
+          }
+          addAttrib(&out, "gc", "%lld", (long long)update->gcFlag);
+          addU32Attrib(&out, "origin-as", update->asn);
+          addAttrib(&out, "prefix", "%s/%u",
+                    ipToStr(&update->prefix.ip),
+                    update->prefix.length);
+          addIntAttrib(&out, "roa-count", update->roaRefCount);
+          if (!printXMLValResult(&out, "origin-val",
+                                 update->srxResult.roaResult, true))
+          {
+            RAISE_ERROR("Update[0%x08X] with invalid origin validation "
+                        "state %d", update->updateID,
+                        update->srxResult.roaResult);
+          }
+          if (!printXMLValResult(&out, "path-val",
+                                 update->srxResult.bgpsecResult, false))
+          {
+            RAISE_ERROR("Update[0%x08X] with invalid path validation "
+                        "state %d", update->updateID,
+                        update->srxResult.bgpsecResult);
+          }
+          if (!printXMLValResult(&out, "def-origin-val",
+                                 update->defaultResult.result.roaResult, true))
+          {
+            RAISE_ERROR("Update[0%x08X] with invalid default origin validation "
+                        "state %d", update->updateID,
+                        update->defaultResult.result.roaResult);
+          }
+          if (!printXMLValResult(&out, "def-path-val",
+                              update->defaultResult.result.bgpsecResult, true))
+          {
+            RAISE_ERROR("Update[0%x08X] with invalid default path validation "
+                        "state %d", update->updateID,
+                        update->defaultResult.result.bgpsecResult);
+          }
+          addIntAttrib(&out, "hops", update->pathData.hops);
+          addIntAttrib(&out, "bgpsec-len", update->pathData.length);
+        closeTag(&out);
+      }
+      unlockReadLock(&shard->tableLock);
     }
     closeTag(&out);
   }
@@ -1580,22 +2450,175 @@ void outputUpdateCacheAsXML(UpdateCache* self, FILE* stream, int maxBlob)
 
 
 
+/**
+ * Return the number of updates currently stored in the update cache. The
+ * shards are counted one after the other, therefore the number is a snapshot
+ * only.
+ *
+ * @param self The update cache
+ *
+ * @return The number of updates stored.
+ *
+ * @since 0.6.0
+ */
+uint32_t sizeOfUpdateCache(UpdateCache* self)
+{
+  UC_Shard* shard;
+  uint32_t  size = 0;
+  int idx;
+
+  for (idx = 0; idx < UC_NUM_SHARDS; idx++)
+  {
+    shard = &((UC_Shard*)self->shards)[idx];
+    acquireReadLock(&shard->tableLock);
+    size += sizeOfSList(&shard->allItems);
+    unlockReadLock(&shard->tableLock);
+  }
+
+  return size;
+}
+
+/**
+ * Call the given function for each update stored in the update cache. The
+ * update and path ids of a shard are collected first and the callback is
+ * called after the shard lock is released, this allows the callback to 
+ * access the update cache.
+ *
+ * @param self The update cache
+ * @param cb The function to be called for each update
+ * @param rpkiHandler The rpki handler passed to the callback.
+ * @param seq The ASPA validation sequence number passed to the callback.
+ */
 void process_ASPA_EndOfData(UpdateCache* self, 
-                            int (*cb)(void* uCache, void* hldr, uint32_t uid, uint32_t pid, time_t ct), 
-                            void* rpkiHandler)
+                            int (*cb)(void* uCache, void* hldr, uint32_t uid, uint32_t pid, uint32_t seq), 
+                            void* rpkiHandler, uint32_t seq)
 {
-  time_t lastEndOfDataTime = time(NULL);
   int count=0;
   CacheEntry* cEntry, *tmp;
+  UC_Shard*   shard;
+  uint32_t*   ids     = NULL;
+  uint32_t    idsSize = 0;
+  uint32_t    noIds;
+  uint32_t    idIdx;
+  int         shIdx;
     
-  LOG(LEVEL_DEBUG, "Last end of Data Time: %u", lastEndOfDataTime);
-  HASH_ITER(hh, (CacheEntry*)self->table, cEntry, tmp) 
+  LOG(LEVEL_DEBUG, "End of Data validation sequence: %u", seq);
+  for (shIdx = 0; shIdx < UC_NUM_SHARDS; shIdx++)
+  {
+    shard = &((UC_Shard*)self->shards)[shIdx];
+    acquireReadLock(&shard->tableLock);
+    noIds = HASH_COUNT(shard->table);
+    if (noIds > idsSize)
+    {
+      // two values per update, the update id and the path id
+      uint32_t* newIds = realloc(ids, noIds * 2 * sizeof(uint32_t));
+      if (newIds == NULL)
+      {
+        unlockReadLock(&shard->tableLock);
+        RAISE_SYS_ERROR("Not enough memory to process the ASPA EndOfData!");
+        break;
+      }
+      ids     = newIds;
+      idsSize = noIds;
+    }
+    idIdx = 0;
+    HASH_ITER(hh, shard->table, cEntry, tmp) 
+    {
+      ids[idIdx++] = cEntry->updateID;
+      ids[idIdx++] = cEntry->aspathCacheID;
+    }
+    unlockReadLock(&shard->tableLock);
+
+    for (idIdx = 0; idIdx < noIds * 2; idIdx += 2)
+    {
+      LOG(LEVEL_DEBUG, "[%d] updateID: 0x%08X  pathID: 0x%08X", 
+          count++, ids[idIdx], ids[idIdx+1]);
+
+      cb((void*)self, (void*)rpkiHandler, ids[idIdx], ids[idIdx+1], 
+          seq); // call process_ASPA_EndOfData_main
+    }
+  }
+
+  if (ids != NULL)
+  {
+    free(ids);
+  }
+}
+
+/**
+ * Call the given function for each update that uses one of the given AS paths.
+ * This is the incremental version of process_ASPA_EndOfData, only updates
+ * affected by changed ASPA objects are processed. As with 
+ * process_ASPA_EndOfData the callback is called outside of the shard lock.
+ *
+ * @param self The update cache
+ * @param pathIDs The IDs of the affected AS paths.
+ * @param noPathIDs The number of path IDs.
+ * @param cb The function to be called for each update
+ * @param rpkiHandler The rpki handler passed to the callback.
+ * @param seq The ASPA validation sequence number passed to the callback.
+ *
+ * @return The number of updates processed.
+ *
+ * @since 0.6.0
+ */
+int process_ASPA_EndOfData_paths(UpdateCache* self, uint32_t* pathIDs,
+                     uint32_t noPathIDs,
+                     int (*cb)(void* uCache, void* hldr, uint32_t uid,
+                               uint32_t pid, uint32_t seq),
+                     void* rpkiHandler, uint32_t seq)
+{
+  UC_Shard*     shard;
+  UC_PathIndex* index;
+  SRxUpdateID*  ids     = NULL;
+  uint32_t      idsSize = 0;
+  uint32_t      noIds;
+  uint32_t      pIdx, idx;
+  int           shIdx;
+  int           count = 0;
+
+  for (shIdx = 0; shIdx < UC_NUM_SHARDS; shIdx++)
   {
-    LOG(LEVEL_DEBUG, "[%d] updateID: 0x%08X  pathID: 0x%08X", 
-        count++, cEntry->updateID, cEntry->aspathCacheID);
+    shard = &((UC_Shard*)self->shards)[shIdx];
+    for (pIdx = 0; pIdx < noPathIDs; pIdx++)
+    {
+      acquireReadLock(&shard->tableLock);
+      HASH_FIND(hh, shard->pathIndex, &pathIDs[pIdx], sizeof(uint32_t), index);
+      noIds = (index != NULL) ? index->noUpdateIDs : 0;
+      if (noIds > idsSize)
+      {
+        SRxUpdateID* newIds = realloc(ids, noIds * sizeof(SRxUpdateID));
+        if (newIds == NULL)
+        {
+          unlockReadLock(&shard->tableLock);
+          RAISE_SYS_ERROR("Not enough memory to process the ASPA EndOfData!");
+          free(ids);
+          return count;
+        }
+        ids     = newIds;
+        idsSize = noIds;
+      }
+      if (noIds > 0)
+      {
+        memcpy(ids, index->updateIDs, noIds * sizeof(SRxUpdateID));
+      }
+      unlockReadLock(&shard->tableLock);
+
+      for (idx = 0; idx < noIds; idx++)
+      {
+        LOG(LEVEL_DEBUG, "[%d] updateID: 0x%08X  pathID: 0x%08X",
+            count, ids[idx], pathIDs[pIdx]);
+        cb((void*)self, (void*)rpkiHandler, ids[idx], pathIDs[pIdx],
+           seq); // call process_ASPA_EndOfData_main
+        count++;
+      }
+    }
+  }
 
-    cb((void*)self, (void*)rpkiHandler, cEntry->updateID, cEntry->aspathCacheID, 
-        lastEndOfDataTime); // call process_ASPA_EndOfData_main
+  if (ids != NULL)
+  {
+    free(ids);
   }
 
+  return count;
 }
@@ -24,6 +24,9 @@
  * update cache, a hash table with the update id as key and the update as 
  * value. The other is a list, that allows to scan through all updates. Both 
  * MUST be maintained the same.
+ * Since 0.6.0 both structures are split into UC_NUM_SHARDS shards. The shard
+ * of an update is selected by its update ID and each shard has its own locks,
+ * this way updates of different shards never contend with each other.
  * 
  * @version 0.5.0.0
  * 
@@ -63,10 +66,12 @@
 #define __UPDATE_CACHE_H__
 
 #include <stdio.h>
+#include <time.h>
 #include "server/configuration.h"
 #include "shared/srx_defs.h"
 #include "shared/srx_packets.h"
 #include "util/mutex.h"
+#include "util/pdu_pool.h"
 #include "util/rwlock.h"
 #include "util/slist.h"
 
@@ -78,19 +83,40 @@
  */
 typedef void (*UpdateResultChanged)(SRxValidationResult* result);
 
+/** The number of shards of the update cache, MUST be a power of 2. */
+#define UC_NUM_SHARDS 64
+
+/** Interval in seconds the garbage collector runs in. */
+#define UC_GC_INTERVAL 1
+/** Maximum number of updates reclaimed per hold of a shard's write lock. */
+#define UC_GC_BATCH    32
+/** Seconds an AS path must be unused before the garbage collector removes it
+ * from the AS path cache, a new update might be about to reference it. */
+#define UC_GC_PATH_IDLE 5
+
+/**
+ * Statistics of the garbage collector of the update cache.
+ */
+typedef struct {
+  /** Number of updates reclaimed. */
+  uint64_t reclaimed;
+  /** Number of bytes reclaimed. */
+  uint64_t reclaimedBytes;
+  /** Number of updates scheduled for garbage collection. */
+  uint32_t scheduled;
+  /** Number of reclaimed updates still referenced by readers. */
+  uint32_t retired;
+} UC_GCInfo;
+
 /**
  * A single Update Cache.
  */
 typedef struct {  
   Configuration*      sysConfig;  // The system configuration
   UpdateResultChanged resChangedCallback;
-  Mutex               itemMutex;
-  // TODO Check if allItems can be removed!
-  SList               allItems;   // All updates in an SList.
-  void*               availItems; // pointer to the next available cEntry
-  int                 itemsUsed;  // number of cEntries used
-  RWLock              tableLock;
-  void*               table;      // The hash table for quick lookup
+  Mutex               clientMutex;// Guards the lockedClients array.
+  void*               shards;     // UC_NUM_SHARDS shards, each containing its
+                                  // own hash table, item list, and locks.
   // The is also the maximum number of clients currently installed. It is
   // called minNumberOfclients because it is the minimum expected and therefore
   // the initial number of array elements needed per update. This number might
@@ -101,6 +127,8 @@ typedef struct {
   // cache works on cleaning updates from this client. During this phase no 
   // updates can be assigned to this client.
   uint32_t*           lockedClients;
+  // The garbage collector, see startUpdateCacheGC.
+  void*               gc;
 } UpdateCache;
 
 /** Return value for method getUpdateSignature the memory of this instance
@@ -171,6 +199,58 @@ bool createUpdateCache(UpdateCache* self, UpdateResultChanged chCallback,
  */
 void releaseUpdateCache(UpdateCache* self);
 
+/**
+ * Start the garbage collector thread of the update cache. Updates without
+ * clients are reclaimed once their keep window passed. Reclaimed updates are
+ * also removed from the given prefix cache, the SKI cache, and if no other
+ * update uses their AS path, from the AS path cache.
+ *
+ * @param self The update cache
+ * @param prefixCache The prefix cache (PrefixCache*) or NULL.
+ * @param aspathCache The AS path cache (AspathCache*) or NULL.
+ *
+ * @return false if the thread could not be started.
+ *
+ * @since 0.6.0
+ */
+bool startUpdateCacheGC(UpdateCache* self, void* prefixCache, 
+                        void* aspathCache);
+
+/**
+ * Stop the garbage collector thread. This MUST be called before the caches
+ * given to startUpdateCacheGC are released.
+ *
+ * @param self The update cache
+ *
+ * @since 0.6.0
+ */
+void stopUpdateCacheGC(UpdateCache* self);
+
+/**
+ * Perform one run of the garbage collector. All updates whose keep window
+ * passed at the given time are reclaimed in batches of UC_GC_BATCH updates.
+ * This is called by the garbage collector thread and MUST NOT be called while
+ * the thread is running.
+ *
+ * @param self The update cache
+ * @param now The current time
+ *
+ * @return The number of updates reclaimed.
+ *
+ * @since 0.6.0
+ */
+uint32_t runUpdateCacheGC(UpdateCache* self, time_t now);
+
+/**
+ * Fill the statistics of the garbage collector.
+ *
+ * @param self The update cache
+ * @param info The statistics to be filled.
+ *
+ * @since 0.6.0
+ */
+void getUpdateCacheGCInfo(UpdateCache* self, UC_GCInfo* info);
+
 /**
  * Queries the update cache for the result associated with the update. This
  * method DOES NOT create a cache entry if no update was found. This method DOES
@@ -226,17 +306,30 @@ UpdSigResult* getUpdateSignature(UpdateCache* self, UpdSigResult* result,
 bool getUpdateStats(UpdateCache* self, UC_UpdateStatistics* statistics);
 
 /**
- * Return the cache internal copy of the update data.
+ * Return the cache internal copy of the update data. The update is referenced
+ * until the data is returned using releaseUpdateData, the garbage collector
+ * does not free it in the meantime.
  * 
  * @param self The update cache
  * @param updateID The ID of the update
  * 
- * @return the pointer to the internal stored bgp update data
+ * @return the pointer to the internal stored bgp update data or NULL.
  * 
  * @since 0.5.0.0
  */
 UC_UpdateData* getUpdateData(UpdateCache* self, SRxUpdateID* updateID);
 
+/**
+ * Release the update data received by getUpdateData. The data MUST NOT be
+ * used anymore.
+ * 
+ * @param self The update cache
+ * @param data The update data, can be NULL.
+ * 
+ * @since 0.6.0
+ */
+void releaseUpdateData(UpdateCache* self, UC_UpdateData* data);
+
 /**
  * Stores an update in the update cache. This method returns 0 in case the 
  * update already exists in the update cache. In this case depending on the 
@@ -270,7 +363,10 @@ UC_UpdateData* getUpdateData(UpdateCache* self, SRxUpdateID* updateID);
  *               storage, the internal UNDEFINED and UNKNOWN will be used.
  * @param bgpData Contains BGP / BGPsec data. This parameter as well as defRes 
  *               is only used during initial storing of an update. (CAN BE NULL)
- * 
+ * @param pathID The AS path cache ID of the update.
+ * @param pduBuffer The received PDU bgpData points into. If given, the update
+ *               keeps a reference to the PDU instead of copying the paths.
+ *               (CAN BE NULL)
  *
  * @return 1 the result stored, 0 the update is already stored, 
  *         -1 indicates an internal error
@@ -278,7 +374,7 @@ UC_UpdateData* getUpdateData(UpdateCache* self, SRxUpdateID* updateID);
 int storeUpdate(UpdateCache* self, uint8_t clientID, void* clientMapping,
                 SRxUpdateID* updateID, IPPrefix* prefix, 
                 uint32_t asn, SRxDefaultResult* defRes,
-                BGPSecData* bgpData, uint32_t pathID);
+                BGPSecData* bgpData, uint32_t pathID, PDU_Buffer* pduBuffer);
 
 /**
  * Removes the update data from the list and releases all memory associated to 
@@ -436,12 +532,47 @@ bool detectCollision(UpdateCache* self, SRxUpdateID* updateID, IPPrefix* prefix,
  */
 void outputUpdateCacheAsXML(UpdateCache* self, FILE* stream, int maxBlob);
 
+/**
+ * Return the number of updates currently stored in the update cache. The 
+ * shards are counted one after the other, therefore the number is a snapshot
+ * only.
+ * 
+ * @param self The update cache
+ * 
+ * @return The number of updates stored.
+ * 
+ * @since 0.6.0
+ */
+uint32_t sizeOfUpdateCache(UpdateCache* self);
+
 bool modifyUpdateCacheResultWithAspaVal(UpdateCache* self, SRxUpdateID* updateID,
                         SRxResult* srxResult_aspa);
 
 void process_ASPA_EndOfData(UpdateCache* self, 
-                            int (*cb)(void* uCache, void* hldr, uint32_t uid, uint32_t pid, time_t), 
-                            void* rpkiHandler);
+                            int (*cb)(void* uCache, void* hldr, uint32_t uid, uint32_t pid, uint32_t), 
+                            void* rpkiHandler, uint32_t seq);
+
+/**
+ * Call the given function for each update that uses one of the given AS paths.
+ * This is the incremental version of process_ASPA_EndOfData, only updates
+ * affected by changed ASPA objects are processed.
+ *
+ * @param self The update cache
+ * @param pathIDs The IDs of the affected AS paths.
+ * @param noPathIDs The number of path IDs.
+ * @param cb The function to be called for each update
+ * @param rpkiHandler The rpki handler passed to the callback.
+ * @param seq The ASPA validation sequence number passed to the callback.
+ *
+ * @return The number of updates processed.
+ *
+ * @since 0.6.0
+ */
+int process_ASPA_EndOfData_paths(UpdateCache* self, uint32_t* pathIDs,
+                     uint32_t noPathIDs,
+                     int (*cb)(void* uCache, void* hldr, uint32_t uid,
+                               uint32_t pid, uint32_t seq),
+                     void* rpkiHandler, uint32_t seq);
 #endif // !__UPDATE_CACHE_H__
 
 
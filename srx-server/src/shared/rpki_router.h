@@ -88,6 +88,23 @@
 /** The default connection attempt timeout after 10 seconds. */
 #define RPKI_CONNECTION_TIMEOUT 10
 
+/** Default refresh interval in seconds (RFC 8210 Section 6). Version 0 caches
+ * do not advertise timing parameters. */
+#define RPKI_DEFAULT_REFRESH_INTERVAL 3600
+/** Default retry interval in seconds (RFC 8210 Section 6) */
+#define RPKI_DEFAULT_RETRY_INTERVAL   600
+/** Default expire interval in seconds (RFC 8210 Section 6) */
+#define RPKI_DEFAULT_EXPIRE_INTERVAL  7200
+/** Allowed range of the refresh interval */
+#define RPKI_MIN_REFRESH_INTERVAL     1
+#define RPKI_MAX_REFRESH_INTERVAL     86400
+/** Allowed range of the retry interval */
+#define RPKI_MIN_RETRY_INTERVAL       1
+#define RPKI_MAX_RETRY_INTERVAL       7200
+/** Allowed range of the expire interval */
+#define RPKI_MIN_EXPIRE_INTERVAL      600
+#define RPKI_MAX_EXPIRE_INTERVAL      172800
+
 #ifndef SRX_SERVER_PACKAGE
 // Is provided by Makefile as CFLAGS -I
 #define SRX_SERVER_PACKAGE  "NA"
@@ -252,6 +269,23 @@ typedef struct {
   uint32_t    serial;      // Serial number
 } __attribute__((packed)) RPKIEndOfDataHeader;
 
+/**
+ * PDU EndOfData for protocol version 1 and later. It adds the timing
+ * parameters of the cache (RFC 8210 Section 5.8).
+ * 
+ * @since 0.6.0
+ */
+typedef struct {
+  uint8_t     version;     // Version - 1 or greater
+  uint8_t     type;        // TYPE_END_OF_DATA
+  uint16_t    sessionID;   // Session ID
+  uint32_t    length;      // 24 Bytes
+  uint32_t    serial;      // Serial number
+  uint32_t    refresh;     // Refresh Interval in seconds
+  uint32_t    retry;       // Retry Interval in seconds
+  uint32_t    expire;      // Expire Interval in seconds
+} __attribute__((packed)) RPKIEndOfDataHeaderV1;
+
 /**
  * PDU Cache Reset
  */
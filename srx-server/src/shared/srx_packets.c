@@ -46,18 +46,21 @@
 #include "util/prefix.h"
 
 static const char* PACKET_TYPES[PDU_SRXPROXY_UNKNOWN + 1] = {
-  "Hello",
-  "Hello_Response",
-  "Goodbye",
-  "Verify_IPv4",
-  "Verify_IPv6",
-  "Request_Receipt",
-  "Delete_Update",
-  "Synch_Request",
-  "Verification_Notification",
-  "Signature_Notification",
-  "Error",
-  "Unknown"
+  [PDU_SRXPROXY_HELLO]                   = "Hello",
+  [PDU_SRXPROXY_HELLO_RESPONSE]          = "Hello_Response",
+  [PDU_SRXPROXY_GOODBYE]                 = "Goodbye",
+  [PDU_SRXPROXY_VERIFY_V4_REQUEST]       = "Verify_IPv4",
+  [PDU_SRXPROXY_VERIFY_V6_REQUEST]       = "Verify_IPv6",
+  [PDU_SRXPROXY_SIGN_REQUEST]            = "Sign_Request",
+  [PDU_SRXPROXY_VERI_NOTIFICATION]       = "Verification_Notification",
+  [PDU_SRXPROXY_SIGN_NOTIFICATION]       = "Signature_Notification",
+  [PDU_SRXPROXY_DELTE_UPDATE]            = "Delete_Update",
+  [PDU_SRXPROXY_PEER_CHANGE]             = "Peer_Change",
+  [PDU_SRXPROXY_SYNC_REQUEST]            = "Synch_Request",
+  [PDU_SRXPROXY_ERROR]                   = "Error",
+  [PDU_SRXPROXY_VERIFY_BATCH]            = "Verify_Batch",
+  [PDU_SRXPROXY_VERI_NOTIFICATION_BATCH] = "Verification_Notification_Batch",
+  [PDU_SRXPROXY_UNKNOWN]                 = "Unknown"
 };
 
 /**
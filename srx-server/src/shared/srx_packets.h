@@ -63,6 +63,16 @@
 #define SRX_PROXY_FLAGS_VERIFY_ASPA            4
 #define SRX_PROXY_FLAGS_VERIFY_RECEIPT       128
 
+/** Capability Bits (NOT IN SPEC). They are exchanged in the Hello and Hello
+ * Response using the field that is padding in the specification. The proxy
+ * lists the capabilities it supports, the server answers with the ones used
+ * on this connection. Implementations not knowing them send zero. */
+#define SRX_PROXY_CAP_VERIFY_BATCH             1
+#define SRX_PROXY_CAP_VERI_NOTIFICATION_BATCH  2
+/** The capabilities implemented by this proxy and server. */
+#define SRX_PROXY_CAP_ALL                      (SRX_PROXY_CAP_VERIFY_BATCH \
+                                      | SRX_PROXY_CAP_VERI_NOTIFICATION_BATCH)
+
 /** Block Type Bits */
 #define SRX_PROXY_BLOCK_TYPE_LATEST_SIGNATURE  1
 
@@ -101,7 +111,9 @@ typedef enum {
   PDU_SRXPROXY_PEER_CHANGE       =  9,
   PDU_SRXPROXY_SYNC_REQUEST      = 10,
   PDU_SRXPROXY_ERROR             = 11,
-  PDU_SRXPROXY_UNKNOWN           = 12    // NOT IN SPEC
+  PDU_SRXPROXY_VERIFY_BATCH      = 12,   // NOT IN SPEC
+  PDU_SRXPROXY_VERI_NOTIFICATION_BATCH = 13, // NOT IN SPEC
+  PDU_SRXPROXY_UNKNOWN           = 14    // NOT IN SPEC
 } SRxProxyPDUType;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -134,7 +146,7 @@ typedef struct {
   uint8_t    type;              // 0
   uint16_t   version;
   uint8_t    zero;
-  uint32_t   padding32;
+  uint32_t   capabilities;      // SRX_PROXY_CAP_... (padding in the spec)
   uint32_t   length;            // Variable 20(+) Bytes
   uint32_t   proxyIdentifier;
   uint32_t   asn;
@@ -149,7 +161,7 @@ typedef struct {
   uint8_t   type;              // 1
   uint16_t  version;
   uint8_t   zero;
-  uint32_t  padding32;
+  uint32_t  capabilities;      // SRX_PROXY_CAP_... (padding in the spec)
   uint32_t  length;            // 12 Bytes
   uint32_t  proxyIdentifier;
 } __attribute__((packed)) SRXPROXY_HELLO_RESPONSE;
@@ -247,6 +259,20 @@ typedef struct {
   BGPSECValReqData bgpsecValReqData;
 } __attribute__((packed)) SRXPROXY_VERIFY_V6_REQUEST;
 
+/**
+ * This struct specifies the verify batch packet. It is followed by noRequests
+ * complete verify requests (IPv4 and/or IPv6), each with its own length.
+ *
+ * @since 0.6.0
+ */
+typedef struct {
+  uint8_t     type;            // 12
+  uint16_t    reserved;
+  uint8_t     zero;
+  uint32_t    noRequests;
+  uint32_t    length;          // 12(+) Bytes
+} __attribute__((packed)) SRXPROXY_VERIFY_BATCH;
+
 /**
  * This struct specifies the sign request packet
  */
@@ -277,6 +303,34 @@ typedef struct {
   SRxUpdateID updateID;
 } __attribute__((packed)) SRXPROXY_VERIFY_NOTIFICATION;
 
+/**
+ * This struct specifies one result of the verification notification batch
+ * packet.
+ *
+ * @since 0.6.0
+ */
+typedef struct {
+  SRxUpdateID updateID;
+  uint8_t     resultType;
+  uint8_t     roaResult;
+  uint8_t     bgpsecResult;
+  uint8_t     aspaResult;      // 8 Bytes
+} __attribute__((packed)) SRXPROXY_VERIFY_RESULT;
+
+/**
+ * This struct specifies the verification notification batch packet. It is
+ * followed by noResults SRXPROXY_VERIFY_RESULT entries.
+ *
+ * @since 0.6.0
+ */
+typedef struct {
+  uint8_t     type;            // 13
+  uint16_t    reserved;
+  uint8_t     zero;
+  uint32_t    noResults;
+  uint32_t    length;          // 12(+) Bytes
+} __attribute__((packed)) SRXPROXY_VERIFY_NOTIFICATION_BATCH;
+
 /**
  * This struct specifies the signature notification packet
  */
@@ -22,10 +22,11 @@
  *  
  * This files is used for testing the RPKI Queue functions.
  *
- * @version 0.5.0.0
+ * @version 0.6.0
  *
  * Changelog:
  * -----------------------------------------------------------------------------
+ * 0.6.0    - Added scaling test #5 using rq_dequeueBatch.
  * 0.5.0.0  - 2017/06/22 - oborchert
  *            * File created
  */
@@ -33,10 +34,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <malloc.h>
+#include <time.h>
 #include <srx/srxcryptoapi.h>
 #include "server/rpki_queue.h"
 
 #define NO_ELEMENTS 12
+/** Number of elements used for the scaling test. */
+#define NO_SCALE_ELEMENTS 1000000
+/** Number of elements dequeued at once during the scaling test. */
+#define SCALE_BATCH_SIZE  256
 
 /**
  * check the value against expected, if not match then exit.
@@ -198,6 +204,79 @@ static void _test4(RPKI_QUEUE* queue)
   printf ("         passed.\n");
 }
 
+/**
+ * Return the seconds elapsed since the given start time.
+ *
+ * @param start The start time
+ *
+ * @return the elapsed seconds
+ */
+static double _elapsed(struct timespec* start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) 
+         + (now.tv_nsec - start->tv_nsec) / 1000000000.0;
+}
+
+/**
+ * Queue noElements elements with RQ_ROA, queue all of them again with RQ_KEY
+ * and RQ_ASPA and drain the queue in batches. Each element must be stored only
+ * once, in the order it was added first and with all reasons combined.
+ * 
+ * @param queue The queue to be tested
+ * @param noElements The number of elements to be added
+ */
+static void _test5(RPKI_QUEUE* queue, int noElements)
+{
+  RPKI_QUEUE_ELEM elems[SCALE_BATCH_SIZE];
+  struct timespec start;
+  SRxUpdateID     updateID = 0;
+  int noElems = 0;
+  int idx     = 0;
+  int expectedID = 0;
+  
+  printf ("Test #5: Queue %i elements three times and drain in batches of "
+          "%i!\n", noElements, SCALE_BATCH_SIZE);
+  
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (updateID = 0; updateID < noElements; updateID++)
+  {
+    rq_queue(queue, RQ_ROA, &updateID);
+  }
+  printf ("         queued %i new elements in %.3f seconds\n", 
+          noElements, _elapsed(&start));
+  assert_int (queue, rq_size(queue), noElements, "After Queue was filled");     
+  
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (updateID = noElements; updateID > 0; updateID--)
+  {
+    SRxUpdateID dupID = updateID - 1;
+    rq_queue(queue, RQ_KEY, &dupID);
+    rq_queue(queue, RQ_ASPA, &dupID);
+  }
+  printf ("         merged %i duplicate elements in %.3f seconds\n", 
+          noElements * 2, _elapsed(&start));
+  assert_int (queue, rq_size(queue), noElements, "After duplicates were added");
+  
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while ((noElems = rq_dequeueBatch(queue, elems, SCALE_BATCH_SIZE)) > 0)
+  {
+    for (idx = 0; idx < noElems; idx++)
+    {
+      assert_int(queue, elems[idx].updateID, expectedID, "Insertion order");
+      assert_int(queue, elems[idx].reason, RQ_ALL, "Merged reason");
+      expectedID++;
+    }
+  }
+  printf ("         dequeued %i elements in %.3f seconds\n", 
+          expectedID, _elapsed(&start));
+  assert_int(queue, expectedID, noElements, "Number of dequeued elements");
+  assert_int(queue, rq_size(queue), 0, "Queue should be empty");
+  
+  printf ("         passed.\n");
+}
+
 /**
  * This is the main function
  */
@@ -236,6 +315,9 @@ int main(int argc, char** argv)
   // Clean
   _test4(queue);
 
+  printf("\nRun test #5 to store %i elements and check for order and "
+         "RQ_ALL\n", NO_SCALE_ELEMENTS);    
+  _test5(queue, NO_SCALE_ELEMENTS);
   
   rq_releaseQueue(queue);
   
@@ -37,6 +37,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <malloc.h>
+#include <pthread.h>
+#include <time.h>
 #include <srx/srxcryptoapi.h>
 #include "client/srx_api.h"
 #include "server/ski_cache.h"
@@ -700,6 +702,8 @@ static void test_2b()
 ////////////////////////////////////////////////////////////////////////////////
 static void test_3a();
 static void test_3b();
+static void test_3c();
+static void test_3d();
 
 
 /** run test suite 3 - Test Update registration */
@@ -715,14 +719,18 @@ static void test_3()
   assert_int(data, 0, "Framework not cleaned for test 3!");
   
   printf ("--------------------------------------------------------------\n");
-  printf ("Test 3: Using one key and one update that requires the key,\n"
+  printf ("Test 3: Using two keys and one update that requires the keys,\n"
           "        this test tests the notification mechanism using the\n"
           "        RPKI Queue\n");
 
   // Install the update
   test_3a();
-  // Install the key
+  // Install the first key
   test_3b(); 
+  // Install the second key
+  test_3c(); 
+  // Remove both keys
+  test_3d(); 
   
   cleanTest(3);
   verbose = oldVerbose;  
@@ -771,10 +779,72 @@ static void test_3b()
   }
   ski_registerKey(cache, data->asn, data->ski, data->algoID);
   
-  assert_int(rq_size(rpki_queue), 1, "RPKI QUEUE should contain 1 element.");
+  // The update still waits for the second key.
+  assert_int(rq_size(rpki_queue), 0, "RPKI QUEUE should be empty.");
   ski_examineCache(cache, &info, verbose);
   assert_int(info.count_cNode, 2, "Expect to have 2 CACHE NODES provided by 3a");
   assert_int(info.count_keys, 1, "Expect to have 1 Key registered");
+  assert_int(info.count_waiting, 1, "Expect the update to wait for a key");
+
+  verbose = oldVerbose;  
+  printPassed();
+}
+
+/**
+ * Install the 2nd key
+ */
+static void test_3c()
+{
+  bool oldVerbose = verbose;
+  verbose = verbose || checkVerbose(__func__);
+  
+  printf ("Test #3c: Register the second key.\n");
+  
+  SKI_CACHE_INFO info;
+  TEST_SKI_DATA* data = testData[1];
+  if (verbose)
+  {
+    printDataElement(data, " Register key SKI");
+  }
+  ski_registerKey(cache, data->asn, data->ski, data->algoID);
+  
+  assert_int(rq_size(rpki_queue), 1, "RPKI QUEUE should contain 1 element.");
+  ski_examineCache(cache, &info, verbose);
+  assert_int(info.count_keys, 2, "Expect to have 2 Keys registered");
+  assert_int(info.count_waiting, 0, "Expect the update to have all keys");
+  assert_int(ski_canValidate(cache, &arrUpdateID[0][0]), true, 
+             "Expect the update to be validated");
+  rq_empty(rpki_queue);
+
+  verbose = oldVerbose;  
+  printPassed();
+}
+
+/**
+ * Remove both keys
+ */
+static void test_3d()
+{
+  bool oldVerbose = verbose;
+  verbose = verbose || checkVerbose(__func__);
+  
+  printf ("Test #3d: Unregister both keys.\n");
+  
+  SKI_CACHE_INFO info;
+  TEST_SKI_DATA* data = testData[0];
+  ski_unregisterKey(cache, data->asn, data->ski, data->algoID);
+  assert_int(rq_size(rpki_queue), 1, "RPKI QUEUE should contain 1 element.");
+  assert_int(ski_canValidate(cache, &arrUpdateID[0][0]), false, 
+             "Expect the update to miss a key");
+  rq_empty(rpki_queue);
+  
+  // The update already misses a key, no further notification.
+  data = testData[1];
+  ski_unregisterKey(cache, data->asn, data->ski, data->algoID);
+  assert_int(rq_size(rpki_queue), 0, "RPKI QUEUE should be empty.");
+  ski_examineCache(cache, &info, verbose);
+  assert_int(info.count_keys, 0, "Expect to have no Keys registered");
+  assert_int(info.count_waiting, 1, "Expect the update to wait for a key");
 
   verbose = oldVerbose;  
   printPassed();
@@ -1557,6 +1627,256 @@ static void test_8e(SKI_CACHE_INFO* keyInfo, SKI_CACHE_INFO* updInfo)
   printPassed();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Test Suite 9
+////////////////////////////////////////////////////////////////////////////////
+
+/** Number of threads used for the throughput tests. */
+#define NO_BENCH_THREADS 4
+/** Default number of updates used for the throughput tests. */
+#define NO_BENCH_UPDATES 100000
+/** Number of keys each thread registers and unregisters in test 9c. */
+#define NO_BENCH_KEYS    10000
+
+/** Number of updates used for the throughput tests. */
+int noBenchUpdates = NO_BENCH_UPDATES;
+
+/** The work of a single benchmark thread. */
+typedef struct {
+  /** The index of the thread */
+  int  thread;
+  /** true to register, false to unregister */
+  bool doRegister;
+} TEST_BENCH_JOB;
+
+/**
+ * Return the seconds elapsed since the given start time.
+ *
+ * @param start The start time
+ *
+ * @return the elapsed seconds
+ */
+static double _elapsed(struct timespec* start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) 
+         + (now.tv_nsec - start->tv_nsec) / 1000000000.0;
+}
+
+/**
+ * Register or unregister the thread's share of the updates. All updates use 
+ * the same AS path and therefore share the same two keys.
+ * 
+ * @param arg The TEST_BENCH_JOB
+ * 
+ * @return NULL
+ */
+static void* _benchUpdates(void* arg)
+{
+  TEST_BENCH_JOB* job = (TEST_BENCH_JOB*)arg;
+  SRxUpdateID     updateID;
+  
+  for (updateID = job->thread + 1; updateID <= noBenchUpdates; 
+       updateID += NO_BENCH_THREADS)
+  {
+    if (job->doRegister)
+    {
+      ski_registerUpdate(cache, &updateID, bgp_BGPsec_PATH[0]);
+    }
+    else
+    {
+      ski_unregisterUpdate(cache, &updateID, bgp_BGPsec_PATH[0]);
+    }
+  }
+  
+  return NULL;
+}
+
+/**
+ * Register and unregister keys that are not used by any update. Each thread 
+ * uses its own ASNs.
+ * 
+ * @param arg The TEST_BENCH_JOB
+ * 
+ * @return NULL
+ */
+static void* _benchKeys(void* arg)
+{
+  TEST_BENCH_JOB* job = (TEST_BENCH_JOB*)arg;
+  u_int8_t        ski[SKI_LENGTH];
+  u_int32_t       asn;
+  int             idx;
+  
+  memset(ski, 0, SKI_LENGTH);
+  for (idx = 0; idx < NO_BENCH_KEYS; idx++)
+  {
+    asn = (0x00100000 * (job->thread + 1)) + idx;
+    memcpy(ski, &asn, sizeof(u_int32_t));
+    ski[SKI_LENGTH-1] = (u_int8_t)idx;
+    ski_registerKey(cache, asn, ski, 1);
+  }
+  for (idx = 0; idx < NO_BENCH_KEYS; idx++)
+  {
+    asn = (0x00100000 * (job->thread + 1)) + idx;
+    memcpy(ski, &asn, sizeof(u_int32_t));
+    ski[SKI_LENGTH-1] = (u_int8_t)idx;
+    ski_unregisterKey(cache, asn, ski, 1);
+  }
+  
+  return NULL;
+}
+
+/**
+ * Run the given function in NO_BENCH_THREADS threads and wait until all are
+ * done.
+ * 
+ * @param func The function to run.
+ * @param doRegister Register or unregister.
+ * 
+ * @return the elapsed seconds.
+ */
+static double _runBenchmark(void* (*func)(void*), bool doRegister)
+{
+  pthread_t       threads[NO_BENCH_THREADS];
+  TEST_BENCH_JOB  jobs[NO_BENCH_THREADS];
+  struct timespec start;
+  int             idx;
+  
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (idx = 0; idx < NO_BENCH_THREADS; idx++)
+  {
+    jobs[idx].thread     = idx;
+    jobs[idx].doRegister = doRegister;
+    pthread_create(&threads[idx], NULL, func, &jobs[idx]);
+  }
+  for (idx = 0; idx < NO_BENCH_THREADS; idx++)
+  {
+    pthread_join(threads[idx], NULL);
+  }
+  
+  return _elapsed(&start);
+}
+
+static void test_9a();
+static void test_9b();
+static void test_9c();
+static void test_9d();
+
+/** run test suite 9 */
+static void test_9()
+{
+  bool oldVerbose = verbose;
+  verbose = verbose || checkVerbose(__func__);
+
+  SKI_CACHE_INFO info;
+  ski_examineCache(cache, &info, verbose_init);
+  int data = info.count_cAlgoID + info.count_cData + info.count_cNode
+             + info.count_cUID + rq_size(rpki_queue);
+  assert_int(data, 0, "Framework not cleaned for test 9!");
+  
+  printf ("--------------------------------------------------------------\n");
+  printf ("Test 9: Throughput of the SKI cache using %i threads and %i\n"
+          "        updates that share the same keys.\n", NO_BENCH_THREADS, 
+          noBenchUpdates);
+
+  test_9a(); // Register all updates
+  test_9b(); // Register the keys of the updates
+  test_9c(); // Register and unregister keys not used by updates
+  test_9d(); // Unregister all updates
+  
+  cleanTest(9);  
+  verbose = oldVerbose;
+}
+
+/**
+ * Register all updates in parallel.
+ */
+static void test_9a()
+{
+  printf ("Test #9a: Register %i updates.\n", noBenchUpdates);
+  
+  double seconds = _runBenchmark(_benchUpdates, true);
+  printf ("         registered %i updates in %.3f seconds (%.0f/s)\n", 
+          noBenchUpdates, seconds, noBenchUpdates / seconds);
+  
+  SKI_CACHE_INFO info;
+  ski_examineCache(cache, &info, false);
+  assert_int(info.count_cData, 2, "Expected all updates to share two SKIs!");
+  assert_int(info.count_cUID, noBenchUpdates * 2, "Expected each update to be "
+             "registered with each SKI!");
+  assert_int(rq_size(rpki_queue), 0, "RPKI QUEUE should be empty.");
+  
+  printPassed();
+}
+
+/**
+ * Register the two keys the updates are waiting for.
+ */
+static void test_9b()
+{
+  printf ("Test #9b: Register the two keys used by all updates.\n");
+  
+  struct timespec start;
+  int idx;
+  
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (idx = 0; idx < 2; idx++)
+  {
+    ski_registerKey(cache, testData[idx]->asn, testData[idx]->ski, 
+                    testData[idx]->algoID);
+  }
+  printf ("         notified %i updates in %.3f seconds\n", noBenchUpdates, 
+          _elapsed(&start));
+  assert_int(rq_size(rpki_queue), noBenchUpdates, "Expected each update to be "
+             "queued once!");
+  rq_empty(rpki_queue);
+  
+  printPassed();
+}
+
+/**
+ * Register and unregister keys in parallel.
+ */
+static void test_9c()
+{
+  printf ("Test #9c: Register and unregister %i keys.\n", 
+          NO_BENCH_THREADS * NO_BENCH_KEYS);
+  
+  double seconds = _runBenchmark(_benchKeys, true);
+  printf ("         registered and unregistered %i keys in %.3f seconds "
+          "(%.0f/s)\n", NO_BENCH_THREADS * NO_BENCH_KEYS, seconds, 
+          (NO_BENCH_THREADS * NO_BENCH_KEYS * 2) / seconds);
+  
+  SKI_CACHE_INFO info;
+  ski_examineCache(cache, &info, false);
+  assert_int(info.count_cData, 2, "Expected only the SKIs of the updates!");
+  assert_int(info.count_keys, 2, "Expected only the keys of the updates!");
+  assert_int(rq_size(rpki_queue), 0, "RPKI QUEUE should be empty.");
+  
+  printPassed();
+}
+
+/**
+ * Unregister all updates in parallel.
+ */
+static void test_9d()
+{
+  printf ("Test #9d: Unregister %i updates.\n", noBenchUpdates);
+  
+  double seconds = _runBenchmark(_benchUpdates, false);
+  printf ("         unregistered %i updates in %.3f seconds (%.0f/s)\n", 
+          noBenchUpdates, seconds, noBenchUpdates / seconds);
+  
+  SKI_CACHE_INFO info;
+  ski_examineCache(cache, &info, false);
+  assert_int(info.count_cUID, 0, "Expect no remaining update id "
+                                 "registrations!");  
+  assert_int(info.count_keys, 2, "Expected the keys to remain!");
+  
+  printPassed();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // MAIN METHOD
 ////////////////////////////////////////////////////////////////////////////////
@@ -1566,11 +1886,13 @@ static void test_8e(SKI_CACHE_INFO* keyInfo, SKI_CACHE_INFO* updInfo)
  */
 void syntax()
 {
-  printf ("Syntax: test_ski_cache [-v] [-noExit]\n\n");
+  printf ("Syntax: test_ski_cache [-v] [-noExit] [-updates <num>]\n\n");
   
   printf ("  Options:\n");
   printf ("     -v        Verbose output\n");
-  printf ("     -noExit   Prevent tester to exit when a test failed!\n\n");
+  printf ("     -noExit   Prevent tester to exit when a test failed!\n");
+  printf ("     -updates  Number of updates for the throughput test 9 "
+          "(default %i)\n\n", NO_BENCH_UPDATES);
   printf ("2017 by Oliver Borchert (borchert@nist.gov)\n");
           
   exit (EXIT_SUCCESS);
@@ -1596,6 +1918,14 @@ void parseArguments(int argc, char** argv)
     {
       exitOnAssertFailure = false;
     }
+    else if ((strcasecmp(argv[idx], "-updates") == 0) && (idx + 1 < argc))
+    {
+      noBenchUpdates = atoi(argv[++idx]);
+      if (noBenchUpdates <= 0)
+      {
+        noBenchUpdates = NO_BENCH_UPDATES;
+      }
+    }
     else
     {
       noElements = atoi(argv[idx]);
@@ -1653,6 +1983,8 @@ int main(int argc, char** argv)
   test_7();
   // Test the clean methods
   test_8();
+  // Test the throughput of the SKI cache
+  test_9();
   
   printf ("Release test vectors for SKI - Key and Update testing!\n");
   // Clean up Test Data
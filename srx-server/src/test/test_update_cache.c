@@ -0,0 +1,584 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ *
+ * This files is used for testing the Update Cache functions including the
+ * garbage collector and to measure the store / lookup throughput of the
+ * sharded update cache with 1, 4, 16, and 64 concurrent threads.
+ *
+ * @version 0.6.0
+ *
+ * Changelog:
+ * -----------------------------------------------------------------------------
+ * 0.6.0    - File created
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <time.h>
+#include <srx/srxcryptoapi.h>
+#include "server/aspath_cache.h"
+#include "server/configuration.h"
+#include "server/prefix_cache.h"
+#include "server/rpki_queue.h"
+#include "server/server_connection_handler.h"
+#include "server/ski_cache.h"
+#include "server/update_cache.h"
+
+/** The default number of updates stored per benchmark run. */
+#define DEF_NO_UPDATES  200000
+/** The number of lookups each stored update receives per run. */
+#define LOOKUPS_PER_UPDATE 4
+/** The number of different thread counts to be measured. */
+#define NO_RUNS 4
+
+/** The thread counts measured. */
+static int threadCount[NO_RUNS] = { 1, 4, 16, 64 };
+
+/** The RPKI Queue */
+static RPKI_QUEUE* rpki_queue = NULL;
+/** The SKI cache */
+static SKI_CACHE*  ski_cache  = NULL;
+/** The system configuration (only the keep window is used) */
+static Configuration config;
+/** Number of notifications received from the update cache. */
+static int noNotifications = 0;
+
+/** The data of a single benchmark thread. */
+typedef struct {
+  UpdateCache* cache;
+  uint32_t     firstID;
+  uint32_t     noUpdates;
+  uint32_t     totalUpdates;
+  uint32_t     errors;
+} BenchData;
+
+/**
+ * Required by the update cache, return the SKI cache of this test.
+ *
+ * @return The SKI cache.
+ */
+SKI_CACHE* getSKICache()
+{
+  return ski_cache;
+}
+
+/**
+ * Required by the update cache, the prefix cache is not part of this test.
+ *
+ * @return false
+ */
+bool removeUpdate(PrefixCache* self, SRxUpdateID* updateID, IPPrefix* prefix,
+                  uint32_t as)
+{
+  return false;
+}
+
+/**
+ * Required by the update cache, the AS path cache is not part of this test.
+ *
+ * @return false
+ */
+bool deleteAspathListFromAspathCache(AspathCache* self, uint32_t pathId,
+                                     time_t usedBefore)
+{
+  return false;
+}
+
+/**
+ * Count the notifications of the update cache.
+ *
+ * @param result The changed result.
+ */
+static void handleResultChange(SRxValidationResult* result)
+{
+  noNotifications++;
+}
+
+/**
+ * check the value against expected, if not match then exit.
+ *
+ * @param val the value to be checked
+ * @param expected the value to be checked against (expected value)
+ * @param error the error string in case of exit
+ */
+static void assert_int(int val, int expected, char* error)
+{
+  if (val != expected)
+  {
+    if (error == NULL)
+    {
+      error = "";
+    }
+    printf ("Error: %s; Expected %i but received %i\n", error, expected, val);
+    exit (EXIT_FAILURE);
+  }
+}
+
+/**
+ * Generate the update ID for the given index. The IDs are spread over the
+ * whole 32 bit space.
+ *
+ * @param idx The index of the update
+ *
+ * @return The update id.
+ */
+static SRxUpdateID _getUpdateID(uint32_t idx)
+{
+  return (SRxUpdateID)((idx + 1) * 2654435761U);
+}
+
+/**
+ * Generate the prefix for the given index.
+ *
+ * @param prefix The prefix to be filled.
+ * @param idx The index of the update.
+ */
+static void _getPrefix(IPPrefix* prefix, uint32_t idx)
+{
+  memset(prefix, 0, sizeof(IPPrefix));
+  prefix->ip.version         = 4;
+  prefix->ip.addr.v4.u32     = htonl(0x0A000000 | ((idx & 0xFFFF) << 8));
+  prefix->length             = 24;
+}
+
+/**
+ * Return the current time in seconds.
+ *
+ * @return the time in seconds
+ */
+static double _now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+/**
+ * Store the updates of this thread.
+ *
+ * @param arg The benchmark data
+ *
+ * @return NULL
+ */
+static void* _storeThread(void* arg)
+{
+  BenchData*  data = (BenchData*)arg;
+  SRxUpdateID updateID;
+  IPPrefix    prefix;
+  uint32_t    idx;
+
+  for (idx = data->firstID; idx < data->firstID + data->noUpdates; idx++)
+  {
+    updateID = _getUpdateID(idx);
+    _getPrefix(&prefix, idx);
+    if (storeUpdate(data->cache, 0, NULL, &updateID, &prefix, 65000 + idx,
+                    NULL, NULL, 0, NULL) != 1)
+    {
+      data->errors++;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Lookup updates of the complete cache, every 8th lookup also modifies the
+ * result.
+ *
+ * @param arg The benchmark data
+ *
+ * @return NULL
+ */
+static void* _lookupThread(void* arg)
+{
+  BenchData*       data = (BenchData*)arg;
+  SRxUpdateID      updateID;
+  SRxResult        srxRes;
+  SRxDefaultResult defRes;
+  uint32_t         idx;
+  uint32_t         rnd = data->firstID + 1;
+
+  for (idx = 0; idx < data->noUpdates * LOOKUPS_PER_UPDATE; idx++)
+  {
+    rnd = rnd * 1103515245 + 12345;
+    updateID = _getUpdateID(rnd % data->totalUpdates);
+    if (!getUpdateResult(data->cache, &updateID, 0, NULL, &srxRes, &defRes,
+                         NULL))
+    {
+      data->errors++;
+    }
+    else if ((idx & 0x7) == 0)
+    {
+      srxRes.roaResult    = SRx_RESULT_VALID;
+      srxRes.bgpsecResult = SRx_RESULT_DONOTUSE;
+      srxRes.aspaResult   = SRx_RESULT_DONOTUSE;
+      modifyUpdateResult(data->cache, &updateID, &srxRes, true);
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Run the given function with the given number of threads and return the
+ * time needed.
+ *
+ * @param cache The update cache
+ * @param func The thread function
+ * @param noThreads The number of threads
+ * @param noUpdates The total number of updates
+ *
+ * @return the time in seconds.
+ */
+static double _runThreads(UpdateCache* cache, void* (*func)(void*),
+                          int noThreads, uint32_t noUpdates)
+{
+  pthread_t* threads = malloc(sizeof(pthread_t) * noThreads);
+  BenchData* data    = calloc(noThreads, sizeof(BenchData));
+  uint32_t   slice   = noUpdates / noThreads;
+  uint32_t   errors  = 0;
+  double     start;
+  int        idx;
+
+  for (idx = 0; idx < noThreads; idx++)
+  {
+    data[idx].cache        = cache;
+    data[idx].firstID      = idx * slice;
+    data[idx].noUpdates    = (idx == noThreads - 1) ? noUpdates - (idx * slice)
+                                                    : slice;
+    data[idx].totalUpdates = noUpdates;
+  }
+
+  start = _now();
+  for (idx = 0; idx < noThreads; idx++)
+  {
+    pthread_create(&threads[idx], NULL, func, &data[idx]);
+  }
+  for (idx = 0; idx < noThreads; idx++)
+  {
+    pthread_join(threads[idx], NULL);
+    errors += data[idx].errors;
+  }
+  start = _now() - start;
+
+  assert_int(errors, 0, "Errors during benchmark run");
+
+  free(data);
+  free(threads);
+
+  return start;
+}
+
+/**
+ * Test the basic functions of the update cache.
+ */
+static void test_1()
+{
+  UpdateCache      cache;
+  SRxUpdateID      updateID = _getUpdateID(1);
+  SRxResult        srxRes;
+  SRxDefaultResult defRes;
+  IPPrefix         prefix;
+
+  printf ("Test #1: Store, find, and modify an update\n");
+  assert_int(createUpdateCache(&cache, handleResultChange, 2, &config), true,
+             "Create the update cache");
+  _getPrefix(&prefix, 1);
+
+  assert_int(getUpdateResult(&cache, &updateID, 0, NULL, &srxRes, &defRes,
+                             NULL), false, "Find update in empty cache");
+  assert_int(storeUpdate(&cache, 0, NULL, &updateID, &prefix, 65001, NULL,
+                         NULL, 0, NULL), 1, "Store new update");
+  assert_int(storeUpdate(&cache, 0, NULL, &updateID, &prefix, 65001, NULL,
+                         NULL, 0, NULL), 0, "Store existing update");
+  assert_int(sizeOfUpdateCache(&cache), 1, "Update Cache size");
+  assert_int(getUpdateResult(&cache, &updateID, 0, NULL, &srxRes, &defRes,
+                             NULL), true, "Find stored update");
+  assert_int(srxRes.roaResult, SRx_RESULT_UNDEFINED, "Initial ROA result");
+
+  srxRes.roaResult    = SRx_RESULT_INVALID;
+  srxRes.bgpsecResult = SRx_RESULT_DONOTUSE;
+  srxRes.aspaResult   = SRx_RESULT_DONOTUSE;
+  assert_int(modifyUpdateResult(&cache, &updateID, &srxRes, false), true,
+             "Modify update result");
+  assert_int(noNotifications, 1, "Number of notifications");
+  assert_int(getUpdateResult(&cache, &updateID, 0, NULL, &srxRes, &defRes,
+                             NULL), true, "Find modified update");
+  assert_int(srxRes.roaResult, SRx_RESULT_INVALID, "Modified ROA result");
+
+  releaseUpdateCache(&cache);
+  printf ("         passed.\n");
+}
+
+/** Number of callbacks received by _countPathCallback */
+static int noPathCallbacks = 0;
+
+/**
+ * Count the updates reported by process_ASPA_EndOfData_paths.
+ *
+ * @return 1
+ */
+static int _countPathCallback(void* uCache, void* hldr, uint32_t uid,
+                              uint32_t pid, uint32_t seq)
+{
+  noPathCallbacks++;
+  assert_int(pid == 0x100 + (uid % 4), true, "Path ID of update");
+  return 1;
+}
+
+/**
+ * Test the path index used for the incremental ASPA revalidation.
+ */
+static void test_2()
+{
+  UpdateCache cache;
+  SRxUpdateID updateID;
+  IPPrefix    prefix;
+  uint32_t    pathIDs[2] = { 0x101, 0x103 };
+  int         idx;
+
+  printf ("Test #2: Find updates by path ID\n");
+  assert_int(createUpdateCache(&cache, handleResultChange, 2, &config), true,
+             "Create the update cache");
+  // 100 updates distributed over 4 paths
+  for (idx = 0; idx < 100; idx++)
+  {
+    updateID = idx;
+    _getPrefix(&prefix, idx);
+    assert_int(storeUpdate(&cache, 0, NULL, &updateID, &prefix, 65000, NULL,
+                           NULL, 0x100 + (idx % 4), NULL), 1,
+               "Store new update");
+  }
+
+  assert_int(process_ASPA_EndOfData_paths(&cache, pathIDs, 2,
+                                          _countPathCallback, NULL, 1), 50,
+             "Number of updates of two paths");
+  assert_int(noPathCallbacks, 50, "Number of callbacks");
+
+  releaseUpdateCache(&cache);
+  printf ("         passed.\n");
+}
+
+/**
+ * Test that an update keeps the AS path within the received PDU instead of 
+ * copying it.
+ */
+static void test_3()
+{
+  UpdateCache    cache;
+  SRxUpdateID    updateID = _getUpdateID(3);
+  IPPrefix       prefix;
+  BGPSecData     bgpData;
+  PDU_Buffer*    pdu = NULL;
+  UC_UpdateData* data = NULL;
+  PDU_PoolInfo   poolInfo;
+  uint32_t       inUse = 0;
+
+  printf ("Test #3: Store the AS path of an update within its PDU\n");
+  assert_int(createUpdateCache(&cache, handleResultChange, 2, &config), true,
+             "Create the update cache");
+  _getPrefix(&prefix, 3);
+  getPDUPoolInfo(&poolInfo);
+  inUse = poolInfo.inUse;
+
+  // A PDU with a header of 8 bytes followed by an AS path of 3 hops.
+  pdu = getPDUBuffer(20);
+  memset(&bgpData, 0, sizeof(BGPSecData));
+  bgpData.numberHops = 3;
+  bgpData.asPath     = (uint32_t*)(pdu->data + 8);
+  bgpData.asPath[0]  = htonl(65001);
+  bgpData.asPath[1]  = htonl(65002);
+  bgpData.asPath[2]  = htonl(65003);
+
+  assert_int(storeUpdate(&cache, 0, NULL, &updateID, &prefix, 65003, NULL,
+                         &bgpData, 0, pdu), 1, "Store new update");
+  assert_int(pdu->refCount, 2, "References of the PDU");
+  releasePDUBuffer(pdu);
+
+  data = getUpdateData(&cache, &updateID);
+  assert_int(data != NULL, true, "Find update data");
+  assert_int(data->asn_path == bgpData.asPath, true, "AS path within PDU");
+  assert_int(ntohl(data->asn_path[2]), 65003, "Origin AS of the AS path");
+  releaseUpdateData(&cache, data);
+
+  releaseUpdateCache(&cache);
+  getPDUPoolInfo(&poolInfo);
+  assert_int(poolInfo.inUse, inUse, "PDU buffers in use");
+  printf ("         passed.\n");
+}
+
+/**
+ * Measure the store and lookup throughput for 1, 4, 16, and 64 threads.
+ *
+ * @param noUpdates The number of updates stored per run.
+ */
+static void test_4(uint32_t noUpdates)
+{
+  UpdateCache cache;
+  double      storeTime, lookupTime;
+  int         idx;
+
+  printf ("Test #4: Throughput using %u updates (%u shards)\n", noUpdates,
+          UC_NUM_SHARDS);
+  printf ("         threads     store ops/s    lookup ops/s\n");
+  for (idx = 0; idx < NO_RUNS; idx++)
+  {
+    assert_int(createUpdateCache(&cache, handleResultChange, 2, &config),
+               true, "Create the update cache");
+
+    storeTime  = _runThreads(&cache, _storeThread, threadCount[idx],
+                             noUpdates);
+    assert_int(sizeOfUpdateCache(&cache), noUpdates, "Update Cache size");
+    lookupTime = _runThreads(&cache, _lookupThread, threadCount[idx],
+                             noUpdates);
+
+    printf ("         %7i %15.0f %15.0f\n", threadCount[idx],
+            noUpdates / storeTime,
+            (noUpdates * (double)LOOKUPS_PER_UPDATE) / lookupTime);
+
+    releaseUpdateCache(&cache);
+  }
+  printf ("         passed.\n");
+}
+
+/**
+ * Test the garbage collector. Updates without clients are reclaimed once their
+ * keep window passed, their memory is released once no reader references them.
+ */
+static void test_5()
+{
+  UpdateCache        cache;
+  ProxyClientMapping mapping;
+  SRxUpdateID        updateID;
+  SRxResult          srxRes;
+  SRxDefaultResult   defRes;
+  IPPrefix           prefix;
+  UC_GCInfo          gcInfo;
+  UC_UpdateData*     data;
+  time_t             now = time(NULL);
+  int                idx;
+
+  printf ("Test #5: Garbage collection of unreferenced updates\n");
+  assert_int(createUpdateCache(&cache, handleResultChange, 2, &config), true,
+             "Create the update cache");
+  memset(&mapping, 0, sizeof(ProxyClientMapping));
+
+  // 1000 updates without client, 10 updates of client 1
+  for (idx = 0; idx < 1010; idx++)
+  {
+    updateID = _getUpdateID(idx);
+    _getPrefix(&prefix, idx);
+    assert_int(storeUpdate(&cache, idx < 1000 ? 0 : 1, &mapping, &updateID,
+                           &prefix, 65000, NULL, NULL, 0x200 + (idx % 8),
+                           NULL), 1, "Store new update");
+  }
+  // Client 1 drops 5 of its updates
+  for (idx = 1000; idx < 1005; idx++)
+  {
+    updateID = _getUpdateID(idx);
+    assert_int(deleteUpdateFromCache(&cache, 1, &updateID, 0), true,
+               "Delete client reference");
+  }
+  // Client 1 references one of the unreferenced updates
+  updateID = _getUpdateID(0);
+  assert_int(getUpdateResult(&cache, &updateID, 1, &mapping, &srxRes, &defRes,
+                             NULL), true, "Reference stored update");
+
+  // A reader holds the data of an unreferenced update
+  updateID = _getUpdateID(1);
+  data = getUpdateData(&cache, &updateID);
+  assert_int(data != NULL, true, "Find update data");
+
+  getUpdateCacheGCInfo(&cache, &gcInfo);
+  assert_int(gcInfo.scheduled, 1005, "Scheduled updates");
+  assert_int(runUpdateCacheGC(&cache, now + 10), 0,
+             "Reclaimed within the keep window");
+  assert_int(sizeOfUpdateCache(&cache), 1010, "Update Cache size");
+
+  assert_int(runUpdateCacheGC(&cache, now + config.defaultKeepWindow + 2),
+             1004, "Reclaimed after the keep window");
+  assert_int(sizeOfUpdateCache(&cache), 6, "Update Cache size");
+  updateID = _getUpdateID(0);
+  assert_int(getUpdateResult(&cache, &updateID, 0, NULL, &srxRes, &defRes,
+                             NULL), true, "Find referenced update");
+  updateID = _getUpdateID(1);
+  assert_int(getUpdateResult(&cache, &updateID, 0, NULL, &srxRes, &defRes,
+                             NULL), false, "Find reclaimed update");
+  updateID = _getUpdateID(1005);
+  assert_int(getUpdateResult(&cache, &updateID, 0, NULL, &srxRes, &defRes,
+                             NULL), true, "Find update of client");
+
+  getUpdateCacheGCInfo(&cache, &gcInfo);
+  assert_int(gcInfo.scheduled, 0, "Scheduled updates");
+  assert_int(gcInfo.reclaimed, 1004, "Reclaimed updates");
+  assert_int(gcInfo.retired, 1, "Reclaimed updates still in use");
+  assert_int(gcInfo.reclaimedBytes >= 1004 * 64, true, "Reclaimed bytes");
+
+  // The data stays valid until the reader releases it.
+  runUpdateCacheGC(&cache, now + config.defaultKeepWindow + 3);
+  getUpdateCacheGCInfo(&cache, &gcInfo);
+  assert_int(gcInfo.retired, 1, "Reclaimed updates still in use");
+  assert_int(data->hops, 0, "Access reclaimed update data");
+  releaseUpdateData(&cache, data);
+  runUpdateCacheGC(&cache, now + config.defaultKeepWindow + 4);
+  getUpdateCacheGCInfo(&cache, &gcInfo);
+  assert_int(gcInfo.retired, 0, "Reclaimed updates still in use");
+
+  releaseUpdateCache(&cache);
+  printf ("         passed.\n");
+}
+
+/**
+ * The main test method. An optional parameter specifies the number of updates
+ * used for the throughput measurement.
+ */
+int main(int argc, char** argv)
+{
+  uint32_t noUpdates = DEF_NO_UPDATES;
+
+  if (argc > 1)
+  {
+    noUpdates = (uint32_t)atoi(argv[1]);
+    if (noUpdates < threadCount[NO_RUNS-1])
+    {
+      noUpdates = threadCount[NO_RUNS-1];
+    }
+  }
+
+  memset(&config, 0, sizeof(Configuration));
+  config.defaultKeepWindow = 900;
+  rpki_queue = rq_createQueue();
+  ski_cache  = ski_createCache(rpki_queue);
+
+  test_1();
+  test_2();
+  test_3();
+  test_4(noUpdates);
+  test_5();
+
+  ski_releaseCache(ski_cache);
+  rq_releaseQueue(rpki_queue);
+
+  return (EXIT_SUCCESS);
+}
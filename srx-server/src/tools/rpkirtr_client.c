@@ -174,7 +174,7 @@ void handlePrefix(uint32_t valCacheID, uint16_t sessionID,
  */
 void handleReset()
 {
-  LOG(LEVEL_INFO, "Received a Cache Reset");
+  LOG(LEVEL_INFO, "Send a Reset Query");
 }
 
 /**
@@ -0,0 +1,307 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * Pool of reference counted PDU buffers. Each size class keeps a list of idle
+ * buffers guarded by its own mutex. Reference counts and statistics are
+ * maintained using atomic operations.
+ *
+ * @version 0.6.0
+ *
+ * Changelog:
+ * -----------------------------------------------------------------------------
+ * 0.6.0    - File created
+ * -----------------------------------------------------------------------------
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "util/pdu_pool.h"
+#include "util/log.h"
+
+/** The idle buffers of one size class. */
+typedef struct {
+  pthread_mutex_t mutex; // Guards the list
+  PDU_Buffer*     head;  // The idle buffers
+  uint32_t        idle;  // Number of idle buffers
+} PDU_SizeClass;
+
+/** The size classes of the pool. */
+static PDU_SizeClass _pduClasses[PDU_POOL_NO_CLASSES] = {
+  { PTHREAD_MUTEX_INITIALIZER, NULL, 0 },
+  { PTHREAD_MUTEX_INITIALIZER, NULL, 0 },
+  { PTHREAD_MUTEX_INITIALIZER, NULL, 0 },
+  { PTHREAD_MUTEX_INITIALIZER, NULL, 0 },
+  { PTHREAD_MUTEX_INITIALIZER, NULL, 0 },
+  { PTHREAD_MUTEX_INITIALIZER, NULL, 0 },
+  { PTHREAD_MUTEX_INITIALIZER, NULL, 0 },
+  { PTHREAD_MUTEX_INITIALIZER, NULL, 0 },
+  { PTHREAD_MUTEX_INITIALIZER, NULL, 0 },
+  { PTHREAD_MUTEX_INITIALIZER, NULL, 0 }
+};
+
+/** Statistics of the pool. */
+static uint64_t _pduMallocs  = 0;
+static uint64_t _pduReuses   = 0;
+static uint64_t _pduReleases = 0;
+static uint32_t _pduInUse    = 0;
+
+/**
+ * Determine the size class of the given length.
+ *
+ * @param length The number of bytes needed.
+ * @param size Returns the capacity of the size class or the length itself if
+ *             it is too large for the pool.
+ *
+ * @return The size class or -1 if the length is too large for the pool.
+ *
+ * @since 0.6.0
+ */
+static int _getSizeClass(uint32_t length, uint32_t* size)
+{
+  uint32_t classSize = PDU_POOL_MIN_SIZE;
+  int      sizeClass = 0;
+
+  while (sizeClass < PDU_POOL_NO_CLASSES)
+  {
+    if (length <= classSize)
+    {
+      *size = classSize;
+      return sizeClass;
+    }
+    classSize <<= 1;
+    sizeClass++;
+  }
+
+  *size = length;
+  return -1;
+}
+
+/**
+ * Return a buffer that can hold at least length bytes. The buffer is returned
+ * with one reference held by the caller.
+ *
+ * @param length The number of bytes needed.
+ *
+ * @return The buffer with its length set or NULL if not enough memory is
+ *         available.
+ *
+ * @since 0.6.0
+ */
+PDU_Buffer* getPDUBuffer(uint32_t length)
+{
+  PDU_Buffer*    buffer = NULL;
+  PDU_SizeClass* sClass = NULL;
+  uint32_t       size   = 0;
+  int sizeClass = _getSizeClass(length, &size);
+
+  if (sizeClass >= 0)
+  {
+    sClass = &_pduClasses[sizeClass];
+    pthread_mutex_lock(&sClass->mutex);
+    buffer = sClass->head;
+    if (buffer != NULL)
+    {
+      sClass->head = buffer->next;
+      sClass->idle--;
+    }
+    pthread_mutex_unlock(&sClass->mutex);
+  }
+
+  if (buffer != NULL)
+  {
+    __sync_fetch_and_add(&_pduReuses, 1);
+  }
+  else
+  {
+    buffer = malloc(sizeof(PDU_Buffer) + size);
+    if (buffer == NULL)
+    {
+      RAISE_SYS_ERROR("Not enough memory to allocate a PDU buffer of %u bytes!",
+                      size);
+      return NULL;
+    }
+    buffer->size      = size;
+    buffer->sizeClass = sizeClass;
+    __sync_fetch_and_add(&_pduMallocs, 1);
+  }
+
+  buffer->refCount = 1;
+  buffer->length   = length;
+  buffer->next     = NULL;
+  __sync_fetch_and_add(&_pduInUse, 1);
+
+  return buffer;
+}
+
+/**
+ * Return a buffer containing a copy of the given PDU. The buffer is returned
+ * with one reference held by the caller.
+ *
+ * @param pdu The PDU to be copied.
+ * @param length The length of the PDU in bytes.
+ *
+ * @return The buffer or NULL if not enough memory is available.
+ *
+ * @since 0.6.0
+ */
+PDU_Buffer* copyToPDUBuffer(const uint8_t* pdu, uint32_t length)
+{
+  PDU_Buffer* buffer = getPDUBuffer(length);
+  if (buffer != NULL)
+  {
+    memcpy(buffer->data, pdu, length);
+  }
+  return buffer;
+}
+
+/**
+ * Add a reference to the buffer.
+ *
+ * @param buffer The buffer.
+ *
+ * @return The buffer itself.
+ *
+ * @since 0.6.0
+ */
+PDU_Buffer* retainPDUBuffer(PDU_Buffer* buffer)
+{
+  __sync_fetch_and_add(&buffer->refCount, 1);
+  return buffer;
+}
+
+/**
+ * Release a reference of the buffer. The buffer MUST NOT be accessed by the
+ * caller afterwards. Releasing the last reference returns the buffer into the
+ * pool.
+ *
+ * @param buffer The buffer (can be NULL).
+ *
+ * @since 0.6.0
+ */
+void releasePDUBuffer(PDU_Buffer* buffer)
+{
+  PDU_SizeClass* sClass = NULL;
+
+  if (buffer == NULL)
+  {
+    return;
+  }
+  if (__sync_sub_and_fetch(&buffer->refCount, 1) != 0)
+  {
+    return;
+  }
+
+  __sync_fetch_and_sub(&_pduInUse, 1);
+  __sync_fetch_and_add(&_pduReleases, 1);
+  if (buffer->sizeClass >= 0)
+  {
+    sClass = &_pduClasses[buffer->sizeClass];
+    pthread_mutex_lock(&sClass->mutex);
+    if (sClass->idle < PDU_POOL_MAX_IDLE)
+    {
+      buffer->next = sClass->head;
+      sClass->head = buffer;
+      sClass->idle++;
+      buffer = NULL;
+    }
+    pthread_mutex_unlock(&sClass->mutex);
+  }
+
+  if (buffer != NULL)
+  {
+    free(buffer);
+  }
+}
+
+/**
+ * Determine if the given memory area lies completely within the buffer's
+ * data.
+ *
+ * @param buffer The buffer (can be NULL).
+ * @param ptr Start of the memory area.
+ * @param length Length of the memory area in bytes.
+ *
+ * @return true if the area is part of the buffer's data.
+ *
+ * @since 0.6.0
+ */
+bool isInPDUBuffer(PDU_Buffer* buffer, const void* ptr, uint32_t length)
+{
+  const uint8_t* start = (const uint8_t*)ptr;
+
+  if ((buffer == NULL) || (start == NULL))
+  {
+    return false;
+  }
+
+  return    (start >= buffer->data)
+         && (start + length <= buffer->data + buffer->length);
+}
+
+/**
+ * Fill the statistics of the pool.
+ *
+ * @param info The statistics to be filled.
+ *
+ * @since 0.6.0
+ */
+void getPDUPoolInfo(PDU_PoolInfo* info)
+{
+  int idx;
+
+  info->mallocs  = _pduMallocs;
+  info->reuses   = _pduReuses;
+  info->releases = _pduReleases;
+  info->inUse    = _pduInUse;
+  info->idle     = 0;
+  for (idx = 0; idx < PDU_POOL_NO_CLASSES; idx++)
+  {
+    info->idle += _pduClasses[idx].idle;
+  }
+}
+
+/**
+ * Free all idle buffers of the pool. Buffers still in use are not affected
+ * and will be freed once their last reference is released.
+ *
+ * @since 0.6.0
+ */
+void emptyPDUPool()
+{
+  PDU_SizeClass* sClass = NULL;
+  PDU_Buffer*    buffer = NULL;
+  int idx;
+
+  for (idx = 0; idx < PDU_POOL_NO_CLASSES; idx++)
+  {
+    sClass = &_pduClasses[idx];
+    pthread_mutex_lock(&sClass->mutex);
+    while (sClass->head != NULL)
+    {
+      buffer = sClass->head;
+      sClass->head = buffer->next;
+      free(buffer);
+    }
+    sClass->idle = 0;
+    pthread_mutex_unlock(&sClass->mutex);
+  }
+}
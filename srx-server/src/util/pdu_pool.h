@@ -0,0 +1,151 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * Pool of reference counted PDU buffers. A received PDU is copied once into a
+ * pool buffer, all further consumers (receiver queue, command queue, update
+ * cache) keep a reference to the same buffer instead of creating their own
+ * copy. The last released reference returns the buffer into the pool.
+ *
+ * @version 0.6.0
+ *
+ * Changelog:
+ * -----------------------------------------------------------------------------
+ * 0.6.0    - File created
+ * -----------------------------------------------------------------------------
+ *
+ */
+#ifndef __PDU_POOL_H__
+#define __PDU_POOL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Number of buffer size classes maintained by the pool. */
+#define PDU_POOL_NO_CLASSES  10
+/** The size of the smallest size class in bytes. Each further class is twice
+ * the size of the previous one (128 bytes to 64K). Larger PDUs are allocated
+ * and freed without pooling. */
+#define PDU_POOL_MIN_SIZE    128
+/** Maximum number of idle buffers kept per size class. */
+#define PDU_POOL_MAX_IDLE    1024
+
+/**
+ * A reference counted PDU buffer. The data is stored directly behind the
+ * header.
+ */
+typedef struct _PDU_Buffer {
+  uint32_t            refCount; // Number of references held (atomic)
+  uint32_t            size;     // Capacity of data in bytes
+  uint32_t            length;   // Number of bytes of data in use
+  int                 sizeClass;// The size class or -1 if not pooled
+  struct _PDU_Buffer* next;     // Next idle buffer of the same size class
+  uint8_t             data[];   // The PDU itself
+} PDU_Buffer;
+
+/** Statistics of the PDU pool. */
+typedef struct {
+  uint64_t mallocs;  // Buffers allocated from the heap
+  uint64_t reuses;   // Buffers taken from the pool
+  uint64_t releases; // Buffers returned (to the pool or the heap)
+  uint32_t inUse;    // Buffers currently referenced
+  uint32_t idle;     // Buffers currently idle in the pool
+} PDU_PoolInfo;
+
+/**
+ * Return a buffer that can hold at least length bytes. The buffer is returned
+ * with one reference held by the caller.
+ *
+ * @param length The number of bytes needed.
+ *
+ * @return The buffer with its length set or NULL if not enough memory is
+ *         available.
+ *
+ * @since 0.6.0
+ */
+extern PDU_Buffer* getPDUBuffer(uint32_t length);
+
+/**
+ * Return a buffer containing a copy of the given PDU. The buffer is returned
+ * with one reference held by the caller.
+ *
+ * @param pdu The PDU to be copied.
+ * @param length The length of the PDU in bytes.
+ *
+ * @return The buffer or NULL if not enough memory is available.
+ *
+ * @since 0.6.0
+ */
+extern PDU_Buffer* copyToPDUBuffer(const uint8_t* pdu, uint32_t length);
+
+/**
+ * Add a reference to the buffer.
+ *
+ * @param buffer The buffer.
+ *
+ * @return The buffer itself.
+ *
+ * @since 0.6.0
+ */
+extern PDU_Buffer* retainPDUBuffer(PDU_Buffer* buffer);
+
+/**
+ * Release a reference of the buffer. The buffer MUST NOT be accessed by the
+ * caller afterwards. Releasing the last reference returns the buffer into the
+ * pool.
+ *
+ * @param buffer The buffer (can be NULL).
+ *
+ * @since 0.6.0
+ */
+extern void releasePDUBuffer(PDU_Buffer* buffer);
+
+/**
+ * Determine if the given memory area lies completely within the buffer's
+ * data.
+ *
+ * @param buffer The buffer (can be NULL).
+ * @param ptr Start of the memory area.
+ * @param length Length of the memory area in bytes.
+ *
+ * @return true if the area is part of the buffer's data.
+ *
+ * @since 0.6.0
+ */
+extern bool isInPDUBuffer(PDU_Buffer* buffer, const void* ptr, uint32_t length);
+
+/**
+ * Fill the statistics of the pool.
+ *
+ * @param info The statistics to be filled.
+ *
+ * @since 0.6.0
+ */
+extern void getPDUPoolInfo(PDU_PoolInfo* info);
+
+/**
+ * Free all idle buffers of the pool. Buffers still in use are not affected
+ * and will be freed once their last reference is released.
+ *
+ * @since 0.6.0
+ */
+extern void emptyPDUPool();
+
+#endif // !__PDU_POOL_H__
@@ -60,6 +60,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <pthread.h>
+#include <sys/epoll.h>
 #include "util/log.h"
 #include "util/mutex.h"
 #include "util/packet.h"
@@ -127,26 +128,31 @@ static bool initWriteMutex(ClientThread* cthread)
  */
 static void clientThreadCleanup(ClientMode mode, ClientThread* ct)
 {
-  // Let the user know about the client loss
-  if (ct->svrSock->statusCallback != NULL)
-  {
-    ct->svrSock->statusCallback(ct->svrSock,
-                                (mode == MODE_SINGLE_CLIENT) ? ct : NULL,
-                                ct->clientFD, false, ct->svrSock->user);
-  }
-
+  ServerSocket* svrSock = ct->svrSock;
+  int           fd      = ct->clientFD;
+  
   // Information
-  if (ct->svrSock->verbose)
+  if (svrSock->verbose)
   {
     char buf[MAX_SOCKET_STRING_LEN];
 
     LOG(LEVEL_INFO, "Client disconnected: %s",
-        socketToStr(ct->clientFD, true, buf, MAX_SOCKET_STRING_LEN));
+        socketToStr(fd, true, buf, MAX_SOCKET_STRING_LEN));
   }
 
-  // The instance can be reused
+  // The instance can be reused. This is done prior to the callback because
+  // the callback might remove the client from the server socket.
   releaseMutex(&ct->writeMutex);
   ct->active = false;
+
+  // Let the user know about the client loss
+  if (svrSock->statusCallback != NULL)
+  {
+    svrSock->statusCallback(svrSock,
+                            (   (mode == MODE_SINGLE_CLIENT) 
+                             || (mode == MODE_REACTOR_CLIENTS)) ? ct : NULL,
+                            fd, false, svrSock->user);
+  }
 }
 
 /*----------------------------
@@ -525,6 +531,504 @@ static void* custom_handleClient(void* data)
   pthread_exit(0);
 }
 
+/*---------------------
+ * MODE_REACTOR_CLIENTS
+ */
+
+/** Initial size of the per client receive buffer. */
+#define REACTOR_BUFFER_SIZE 32768
+/** Maximum number of events processed per epoll_wait call. */
+#define REACTOR_MAX_EVENTS  64
+/** Wait at most 1 s in epoll_wait - this is just to allow a shutdown. */
+#define REACTOR_WAIT_MS     1000
+
+/**
+ * A single reactor thread. Each reactor multiplexes the client connections 
+ * assigned to it using epoll and performs non-blocking framed reads.
+ *
+ * @note MODE_REACTOR_CLIENTS
+ */
+typedef struct
+{
+  /** The epoll instance of this reactor. */
+  int            epollFD;
+  /** The thread that runs the reactor loop. */
+  pthread_t      thread;
+  /** Indicates if the reactor loop is running. */
+  bool           running;
+  /** Guards the connection table and the epoll registrations. */
+  Mutex          mutex;
+  /** The registered connections, indexed by their file descriptor. */
+  ClientThread** conns;
+  /** The number of elements in conns. */
+  int            connsSize;
+  /** The number of currently registered connections. */
+  int            noConns;
+  /** The server socket this reactor belongs to. */
+  ServerSocket*  svrSock;
+} SocketReactor;
+
+/**
+ * Remove the client from the reactor and close the client connection. The 
+ * caller MUST hold the reactor mutex.
+ *
+ * @note MODE_REACTOR_CLIENTS
+ *
+ * @param reactor The reactor the client is registered with.
+ * @param ct The client to be removed.
+ * @param closeFD If false the connection is not closed, the caller closes it
+ *                once done with it.
+ */
+static void reactor_removeClient(SocketReactor* reactor, ClientThread* ct,
+                                 bool closeFD)
+{
+  int fd = ct->clientFD;
+  
+  if ((fd >= 0) && (fd < reactor->connsSize) && (reactor->conns[fd] == ct))
+  {
+    epoll_ctl(reactor->epollFD, EPOLL_CTL_DEL, fd, NULL);
+    reactor->conns[fd] = NULL;
+    reactor->noConns--;
+    if (closeFD)
+    {
+      close(fd);
+    }
+  }
+  
+  safeFree(ct->rcvBuffer);
+  ct->rcvBuffer     = NULL;
+  ct->rcvBufferSize = 0;
+  ct->rcvBufferFill = 0;
+}
+
+/**
+ * Read all available data of the given client without blocking and pass each
+ * complete SRx-proxy PDU to the callback of the server socket. Incomplete PDUs
+ * remain in the receive buffer of the client until the remainder arrives.
+ *
+ * @note MODE_REACTOR_CLIENTS
+ *
+ * @param ct The client that has data available.
+ *
+ * @return false if the connection is lost or broken, otherwise true.
+ */
+static bool reactor_receive(ClientThread* ct)
+{
+  ServerSocket*         svrSock = ct->svrSock;
+  SRXPROXY_BasicHeader* hdr     = NULL;
+  uint32_t              offset  = 0;
+  uint32_t              pduLength;
+  ssize_t               rbytes;
+  
+  // The previous receive compacted the buffer, only enlarge if it is full
+  if (ct->rcvBufferFill == ct->rcvBufferSize)
+  {
+    uint8_t* newBuf = realloc(ct->rcvBuffer, ct->rcvBufferSize * 2);
+    if (newBuf == NULL)
+    {
+      RAISE_SYS_ERROR("Not enough memory for the packet data");
+      return false;
+    }
+    ct->rcvBuffer      = newBuf;
+    ct->rcvBufferSize *= 2;
+  }
+  
+  rbytes = recv(ct->clientFD, ct->rcvBuffer + ct->rcvBufferFill, 
+                ct->rcvBufferSize - ct->rcvBufferFill, 
+                MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (rbytes == 0)
+  {
+    LOG(LEVEL_INFO, "Connection reset by peer.");
+    return false;
+  }
+  if (rbytes < 0)
+  {
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+    {
+      return true;
+    }
+    if ((errno != EBADF) && (errno != ECONNRESET))
+    {
+      RAISE_SYS_ERROR("Socket error 0x%X (%u) while receiving data!", 
+                      errno, errno);
+    }
+    return false;
+  }
+  ct->rcvBufferFill += (uint32_t)rbytes;
+  
+  // Dispatch all complete PDUs
+  while ((ct->rcvBufferFill - offset) >= sizeof(SRXPROXY_BasicHeader))
+  {
+    hdr       = (SRXPROXY_BasicHeader*)(ct->rcvBuffer + offset);
+    pduLength = ntohl(hdr->length);
+    if (pduLength < sizeof(SRXPROXY_BasicHeader))
+    {
+      RAISE_ERROR(HDR "Received PDU is invalid!", pthread_self());
+      return false;
+    }
+    if ((ct->rcvBufferFill - offset) < pduLength)
+    {
+      // Incomplete, wait for the remainder
+      break;
+    }
+    ((ServerPacketReceived)svrSock->modeCallback)(svrSock, ct, hdr, pduLength,
+                                                  svrSock->user);
+    offset += pduLength;
+  }
+  
+  // Move the incomplete remainder to the front of the buffer
+  if (offset > 0)
+  {
+    ct->rcvBufferFill -= offset;
+    memmove(ct->rcvBuffer, ct->rcvBuffer + offset, ct->rcvBufferFill);
+  }
+  
+  // Make sure the next PDU fits into the buffer
+  if (ct->rcvBufferFill >= sizeof(SRXPROXY_BasicHeader))
+  {
+    pduLength = ntohl(((SRXPROXY_BasicHeader*)ct->rcvBuffer)->length);
+    if (pduLength > ct->rcvBufferSize)
+    {
+      uint8_t* newBuf = realloc(ct->rcvBuffer, pduLength);
+      if (newBuf == NULL)
+      {
+        RAISE_SYS_ERROR("Not enough memory for the packet data");
+        return false;
+      }
+      ct->rcvBuffer     = newBuf;
+      ct->rcvBufferSize = pduLength;
+    }
+  }
+  
+  return true;
+}
+
+/**
+ * The reactor loop. It waits for any of its connections to become readable
+ * and processes the received data. Lost connections are removed and reported
+ * to the status callback. The PDUs are dispatched without holding the reactor
+ * mutex, clients closed in the meantime are closed by the reactor once their
+ * dispatch is finished (see closeClientConnection).
+ *
+ * @note MODE_REACTOR_CLIENTS
+ * @note PThread syntax
+ *
+ * @param data SocketReactor instance
+ * @return Always \c 0
+ */
+static void* reactor_handleClients(void* data)
+{
+  SocketReactor*     reactor = (SocketReactor*)data;
+  struct epoll_event events[REACTOR_MAX_EVENTS];
+  ClientThread*      ready[REACTOR_MAX_EVENTS];
+  ClientThread*      ct;
+  bool               connected;
+  bool               closed;
+  int                noEvents;
+  int                noReady;
+  int                idx;
+  int                fd;
+  
+  LOG(LEVEL_DEBUG, "([0x%08X]) > Proxy Client Reactor Thread started "
+                   "(ServerSocket::reactor_handleClients)", pthread_self());
+  
+  while (reactor->running)
+  {
+    noEvents = epoll_wait(reactor->epollFD, events, REACTOR_MAX_EVENTS, 
+                          REACTOR_WAIT_MS);
+    if (noEvents < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      RAISE_SYS_ERROR("An error occurred while waiting for client data");
+      break;
+    }
+    
+    // Collect the ready clients under the mutex. The command handler threads
+    // close clients using the same mutex, therefore it is not held during
+    // the dispatch.
+    noReady = 0;
+    lockMutex(&reactor->mutex);
+    for (idx = 0; idx < noEvents; idx++)
+    {
+      // The connection might have been closed after epoll_wait returned, 
+      // therefore look it up by its file descriptor.
+      fd = events[idx].data.fd;
+      ct = (fd < reactor->connsSize) ? reactor->conns[fd] : NULL;
+      if (ct != NULL)
+      {
+        ct->dispatching  = true;
+        ready[noReady++] = ct;
+      }
+    }
+    unlockMutex(&reactor->mutex);
+    
+    for (idx = 0; idx < noReady; idx++)
+    {
+      ct        = ready[idx];
+      connected = reactor_receive(ct);
+      
+      lockMutex(&reactor->mutex);
+      ct->dispatching = false;
+      closed          = ct->closePending;
+      if (closed)
+      {
+        reactor_removeClient(reactor, ct, true);
+        ct->clientFD = -1;
+      }
+      else if (!connected)
+      {
+        // The connection stays open until the clean-up reported the client 
+        // loss, the log and the status callback still need its fd.
+        reactor_removeClient(reactor, ct, false);
+      }
+      unlockMutex(&reactor->mutex);
+      
+      if (closed)
+      {
+        // Complete closeClientConnection, the client was already handled.
+        releaseMutex(&ct->writeMutex);
+        ct->active = false;
+        LOG(LEVEL_DEBUG, HDR "Client connection [ID:%u] closed by reactor", 
+                         pthread_self(), ct->proxyID);
+        deleteFromSList(&reactor->svrSock->cthreads, ct);
+      }
+      else if (!connected)
+      {
+        LOG(LEVEL_DEBUG, HDR "Connection to client closed", pthread_self());
+        // The callback might release the client, keep the fd to close it.
+        fd = ct->clientFD;
+        clientThreadCleanup(MODE_REACTOR_CLIENTS, ct);
+        close(fd);
+      }
+    }
+  }
+  
+  LOG(LEVEL_DEBUG, "([0x%08X]) < Proxy Client Reactor Thread stopped "
+                   "(ServerSocket::reactor_handleClients)", pthread_self());
+  
+  pthread_exit(0);
+}
+
+/**
+ * Register the client with the reactor that currently has the least number of
+ * connections.
+ *
+ * @note MODE_REACTOR_CLIENTS
+ *
+ * @param self The server socket
+ * @param cthread The client to be registered.
+ *
+ * @return \c true = registered, \c false = an error occurred
+ */
+static bool reactor_addClient(ServerSocket* self, ClientThread* cthread)
+{
+  SocketReactor*     reactor = (SocketReactor*)self->reactors;
+  struct epoll_event event;
+  bool               retVal  = false;
+  int                fd      = cthread->clientFD;
+  int                idx;
+  
+  for (idx = 1; idx < self->noReactors; idx++)
+  {
+    if (((SocketReactor*)self->reactors)[idx].noConns < reactor->noConns)
+    {
+      reactor = &((SocketReactor*)self->reactors)[idx];
+    }
+  }
+  
+  cthread->rcvBuffer     = malloc(REACTOR_BUFFER_SIZE);
+  cthread->rcvBufferSize = REACTOR_BUFFER_SIZE;
+  cthread->rcvBufferFill = 0;
+  if (cthread->rcvBuffer == NULL)
+  {
+    RAISE_SYS_ERROR("Not enough memory for the client receive buffer");
+    return false;
+  }
+  if (!initWriteMutex(cthread))
+  {
+    free(cthread->rcvBuffer);
+    cthread->rcvBuffer = NULL;
+    return false;
+  }
+  
+  cthread->reactor = reactor;
+  cthread->thread  = reactor->thread;
+  
+  lockMutex(&reactor->mutex);
+  if (fd >= reactor->connsSize)
+  {
+    int newSize = fd + 64;
+    ClientThread** newConns = realloc(reactor->conns, 
+                                      newSize * sizeof(ClientThread*));
+    if (newConns != NULL)
+    {
+      memset(newConns + reactor->connsSize, 0, 
+             (newSize - reactor->connsSize) * sizeof(ClientThread*));
+      reactor->conns     = newConns;
+      reactor->connsSize = newSize;
+    }
+  }
+  if (fd < reactor->connsSize)
+  {
+    memset(&event, 0, sizeof(struct epoll_event));
+    event.events  = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = fd;
+    reactor->conns[fd] = cthread;
+    if (epoll_ctl(reactor->epollFD, EPOLL_CTL_ADD, fd, &event) == 0)
+    {
+      reactor->noConns++;
+      retVal = true;
+    }
+    else
+    {
+      reactor->conns[fd] = NULL;
+      RAISE_SYS_ERROR("Could not register the client with the reactor");
+    }
+  }
+  else
+  {
+    RAISE_SYS_ERROR("Not enough memory to register the client");
+  }
+  unlockMutex(&reactor->mutex);
+  
+  if (!retVal)
+  {
+    releaseMutex(&cthread->writeMutex);
+    free(cthread->rcvBuffer);
+    cthread->rcvBuffer = NULL;
+    cthread->reactor   = NULL;
+  }
+  
+  return retVal;
+}
+
+/**
+ * Stop all reactor threads and free the reactors. Connections still 
+ * registered are NOT closed here, this is done by _killClientThread.
+ *
+ * @note MODE_REACTOR_CLIENTS
+ *
+ * @param self The server socket
+ * @param join Wait for the reactor threads to end.
+ */
+static void reactor_stopAll(ServerSocket* self, bool join)
+{
+  SocketReactor* reactor;
+  int idx;
+  
+  for (idx = 0; idx < self->noReactors; idx++)
+  {
+    reactor = &((SocketReactor*)self->reactors)[idx];
+    if (reactor->running)
+    {
+      reactor->running = false;
+      if (join)
+      {
+        pthread_join(reactor->thread, NULL);
+      }
+    }
+  }
+}
+
+/**
+ * Release the memory of all reactors. The reactor threads MUST be stopped.
+ *
+ * @note MODE_REACTOR_CLIENTS
+ *
+ * @param self The server socket
+ */
+static void reactor_releaseAll(ServerSocket* self)
+{
+  SocketReactor* reactor;
+  int idx;
+  
+  if (self->reactors != NULL)
+  {
+    for (idx = 0; idx < self->noReactors; idx++)
+    {
+      reactor = &((SocketReactor*)self->reactors)[idx];
+      if (reactor->epollFD >= 0)
+      {
+        close(reactor->epollFD);
+        releaseMutex(&reactor->mutex);
+      }
+      safeFree(reactor->conns);
+    }
+    free(self->reactors);
+    self->reactors = NULL;
+  }
+}
+
+/**
+ * Create the reactors and start their threads.
+ *
+ * @note MODE_REACTOR_CLIENTS
+ *
+ * @param self The server socket
+ *
+ * @return \c true = all reactors are running, \c false = an error occurred
+ */
+static bool reactor_startAll(ServerSocket* self)
+{
+  SocketReactor* reactor;
+  bool retVal = true;
+  int idx;
+  
+  self->reactors = calloc(self->noReactors, sizeof(SocketReactor));
+  if (self->reactors == NULL)
+  {
+    RAISE_SYS_ERROR("Not enough memory to create the socket reactors");
+    return false;
+  }
+  
+  for (idx = 0; (idx < self->noReactors) && retVal; idx++)
+  {
+    reactor = &((SocketReactor*)self->reactors)[idx];
+    reactor->svrSock = self;
+    reactor->epollFD = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor->epollFD < 0)
+    {
+      RAISE_SYS_ERROR("Failed to create an epoll instance");
+      retVal = false;
+    }
+    else if (!initMutex(&reactor->mutex))
+    {
+      RAISE_ERROR("Failed to create a mutex for the socket reactor");
+      close(reactor->epollFD);
+      reactor->epollFD = -1;
+      retVal = false;
+    }
+    else
+    {
+      reactor->running = true;
+      if (pthread_create(&reactor->thread, NULL, reactor_handleClients, 
+                         reactor) != 0)
+      {
+        RAISE_ERROR("Failed to create a socket reactor thread");
+        reactor->running = false;
+        retVal = false;
+      }
+    }
+  }
+  
+  // Mark the remaining reactors as not initialized
+  for (; idx < self->noReactors; idx++)
+  {
+    ((SocketReactor*)self->reactors)[idx].epollFD = -1;
+  }
+  
+  if (!retVal)
+  {
+    reactor_stopAll(self, true);
+    reactor_releaseAll(self);
+  }
+  
+  return retVal;
+}
+
 /*--------
  * Exports
  */
@@ -658,10 +1162,32 @@ bool createServerSocket(ServerSocket* self, int port, bool verbose)
   // Misc. variables
   self->stopping = 0;
   self->verbose = verbose;
+  self->noReactors = DEF_SERVER_REACTORS;
+  self->reactors = NULL;
 
   return true;
 }
 
+/**
+ * Set the number of reactor threads used to multiplex all client connections
+ * in MODE_REACTOR_CLIENTS. This must be called prior to runServerLoop.
+ *
+ * @param self Existing server-socket instance
+ * @param noReactors The number of reactor threads (1..MAX_SERVER_REACTORS)
+ *
+ * @return \c true = the value was accepted, \c false = invalid number
+ */
+bool setServerSocketReactors(ServerSocket* self, int noReactors)
+{
+  if ((noReactors < 1) || (noReactors > MAX_SERVER_REACTORS))
+  {
+    RAISE_ERROR("Invalid number of socket reactors [%d]!", noReactors);
+    return false;
+  }
+  self->noReactors = (uint8_t)noReactors;
+  return true;
+}
+
 /**
  * This is the server loop for the SRx - Proxy server connection.
  * 
@@ -678,7 +1204,8 @@ void runServerLoop(ServerSocket* self, ClientMode clMode,
   static void* (*CL_THREAD_ROUTINES[NUM_CLIENT_MODES])(void*) = {
                                single_handleClient,
                                multi_handleClient,
-                               custom_handleClient
+                               custom_handleClient,
+                               NULL // MODE_REACTOR_CLIENTS uses the reactors
   };
 
   int cliendFD;
@@ -701,6 +1228,24 @@ void runServerLoop(ServerSocket* self, ClientMode clMode,
   // No active threads
   initSList(&self->cthreads);
 
+  // Start the reactor threads, if not possible fall back to one thread per
+  // client connection.
+  if (clMode == MODE_REACTOR_CLIENTS)
+  {
+    if (reactor_startAll(self))
+    {
+      LOG(LEVEL_INFO, "Use %u socket reactor threads for client connections.",
+                      self->noReactors);
+    }
+    else
+    {
+      LOG(LEVEL_ERROR, "Could not start the socket reactors, use one thread "
+                       "per client connection instead!");
+      clMode = MODE_SINGLE_CLIENT;
+      self->mode = clMode;
+    }
+  }
+
   // Prepare socket to accept connections
   listen(self->serverFD, MAX_PENDING_CONNECTIONS);
   
@@ -753,8 +1298,9 @@ void runServerLoop(ServerSocket* self, ClientMode clMode,
 ////////////////////////////////////////////////////////////////////////////////
         //TODO: the mode might not be needed anymore
         accepted = self->statusCallback(self,
-                                        (clMode == MODE_SINGLE_CLIENT) ? cthread
-                                                                       : NULL,
+                                        (   (clMode == MODE_SINGLE_CLIENT)
+                                         || (clMode == MODE_REACTOR_CLIENTS))
+                                        ? cthread : NULL,
                                         cliendFD, true, self->user);
       }
 
@@ -768,17 +1314,33 @@ void runServerLoop(ServerSocket* self, ClientMode clMode,
         cthread->proxyID  = 0; // will be changed for srx-proxy during handshake
         cthread->routerID = 0; // Indicates that it is currently not usable, 
                                // must be set during handshake
+        cthread->capabilities = 0; // negotiated during handshake
         cthread->clientFD = cliendFD;
         cthread->svrSock  = self;
         cthread->caddr	  = caddr;
+        cthread->reactor  = NULL;
+        cthread->rcvBuffer = NULL;
+        cthread->dispatching  = false;
+        cthread->closePending = false;
 
-        ret = pthread_create(&(cthread->thread), &attr,
-                             CL_THREAD_ROUTINES[clMode],
-                             (void*)cthread);
-        if (ret != 0)
+        if (clMode == MODE_REACTOR_CLIENTS)
         {
-          accepted = false;
-          RAISE_ERROR("Failed to create a client thread");
+          if (!reactor_addClient(self, cthread))
+          {
+            accepted = false;
+            RAISE_ERROR("Failed to register the client with a reactor");
+          }
+        }
+        else
+        {
+          ret = pthread_create(&(cthread->thread), &attr,
+                               CL_THREAD_ROUTINES[clMode],
+                               (void*)cthread);
+          if (ret != 0)
+          {
+            accepted = false;
+            RAISE_ERROR("Failed to create a client thread");
+          }
         }
       }
 
@@ -794,22 +1356,42 @@ void runServerLoop(ServerSocket* self, ClientMode clMode,
 
 /**
  * Stops the particular client thread by closing the connection, ending the 
- * thread and releasing the mutex.
+ * thread and releasing the mutex. A reactor client whose PDUs are dispatched
+ * right now is only marked, its reactor completes the close and releases the
+ * client once the dispatch is finished.
  *
- * @param clt A ClientThread instance
+ * @param clientThread A ClientThread instance
+ *
+ * @return false if the close is completed by the reactor.
  */
-static void _killClientThread(void* clt)
+static bool _stopClientThread(ClientThread* clientThread)
 {
-  ClientThread* clientThread = (ClientThread*)clt;
-
   if (clientThread->active)
   {
-    // Close the client connection
-    close(clientThread->clientFD);
+    if (clientThread->reactor != NULL)
+    {
+      // The reactor thread is shared, only remove the client from it. This 
+      // also closes the client connection.
+      SocketReactor* reactor = (SocketReactor*)clientThread->reactor;
+      lockMutex(&reactor->mutex);
+      if (clientThread->dispatching)
+      {
+        clientThread->closePending = true;
+        unlockMutex(&reactor->mutex);
+        return false;
+      }
+      reactor_removeClient(reactor, clientThread, true);
+      unlockMutex(&reactor->mutex);
+    }
+    else
+    {
+      // Close the client connection
+      close(clientThread->clientFD);
 
-    // Wait until the thread terminated - if necessary
-    //pthread_join(clientThread->thread, NULL);
-    pthread_cancel(clientThread->thread);
+      // Wait until the thread terminated - if necessary
+      //pthread_join(clientThread->thread, NULL);
+      pthread_cancel(clientThread->thread);
+    }
 
     // Release the write-mutex
     releaseMutex(&clientThread->writeMutex);
@@ -817,6 +1399,18 @@ static void _killClientThread(void* clt)
     // Set it inactive
     clientThread->active = false;
   }
+  
+  return true;
+}
+
+/**
+ * Stops the particular client thread, see _stopClientThread.
+ *
+ * @param clt A ClientThread instance
+ */
+static void _killClientThread(void* clt)
+{
+  _stopClientThread((ClientThread*)clt);
 }
 
 /**
@@ -831,9 +1425,17 @@ void stopServerLoop(ServerSocket* self)
     // Stop accepting connections 
     close(self->serverFD);
 
+    // Stop the reactors prior to removing their clients
+    if (self->reactors != NULL)
+    {
+      reactor_stopAll(self, true);
+    }
+
     // Kill all threads
     foreachInSList(&self->cthreads, _killClientThread);
     releaseSList(&self->cthreads);
+    
+    reactor_releaseAll(self);
   }
 }
 
@@ -848,7 +1450,8 @@ bool sendPacketToClient(ServerSocket* self, ServerClient* client,
     return false;
   }
 
-  if (self->mode == MODE_SINGLE_CLIENT)
+  if (   (self->mode == MODE_SINGLE_CLIENT) 
+      || (self->mode == MODE_REACTOR_CLIENTS))
   {
     return single_sendResult(client, data, size);
   }
@@ -861,7 +1464,67 @@ bool sendPacketToClient(ServerSocket* self, ServerClient* client,
 }
 
 /**
- * Closes the connection associated with the given client.
+ * Sends a batch of packets to a client. For single and reactor clients the 
+ * packets are written with one gathered write while holding the write mutex
+ * of the client, otherwise each packet is send on its own.
+ *
+ * @param self Server-socket instance
+ * @param client The client to send to.
+ * @param iov One vector element per packet. The content will be modified.
+ * @param count The number of packets.
+ *
+ * @return true if all packets could be send.
+ *
+ * @since 0.6.0
+ */
+bool sendPacketsToClient(ServerSocket* self, ServerClient* client,
+                         struct iovec* iov, int count)
+{
+  ClientThread* clt = (ClientThread*)client;
+  bool retVal = true;
+  int  idx;
+
+  if (self == NULL)
+  {
+    RAISE_ERROR("Server Socket instance is NULL");
+    return false;
+  }
+
+  if (   (self->mode == MODE_SINGLE_CLIENT) 
+      || (self->mode == MODE_REACTOR_CLIENTS))
+  {
+    if (clt->active)
+    {
+      lockMutex(&clt->writeMutex);
+      retVal = sendNumV(&clt->clientFD, iov, count);
+      unlockMutex(&clt->writeMutex);
+      if (!retVal)
+      {
+        RAISE_ERROR("Data could not be send!");
+      }
+    }
+    else
+    {
+      RAISE_ERROR("Trying to send a packet over an inactive connection");
+      retVal = false;
+    }
+  }
+  else
+  {
+    for (idx = 0; (idx < count) && retVal; idx++)
+    {
+      retVal = sendPacketToClient(self, client, iov[idx].iov_base, 
+                                  iov[idx].iov_len);
+    }
+  }
+
+  return retVal;
+}
+
+/**
+ * Closes the connection associated with the given client. If the reactor of
+ * the client dispatches its PDUs right now, the reactor completes the close.
+ * In both cases the client MUST NOT be accessed once this function returns.
  * 
  * @param self The server socket whose client has to be handled,
  * @param client The client connection object to be closed.
@@ -877,7 +1540,13 @@ int closeClientConnection(ServerSocket* self, ServerClient* client)
                        clientThread->proxyID, clientThread->clientFD);
   
   //deleteMapping(self, clientThread);
-  _killClientThread(clientThread);
+  if (!_stopClientThread(clientThread))
+  {
+    // The reactor dispatches PDUs of the client, it releases the client.
+    LOG(LEVEL_DEBUG, HDR "Client connection [ID:%u] is closed by its reactor!",
+                     pthread_self(), clientThread->proxyID);
+    return true;
+  }
   LOG(LEVEL_DEBUG, HDR "Client connection [ID:%u] closed!", pthread_self(),
                   clientThread->proxyID);
   LOG(LEVEL_INFO, "Client connection [ID:%u] closed!", clientThread->proxyID);
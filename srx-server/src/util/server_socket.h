@@ -71,12 +71,19 @@
  *   <td>ClientConnectionAccepted</td>
  *   <td>no</td>
  * </tr>
+ * <tr>
+ *   <td>MODE_REACTOR_CLIENTS</td>
+ *   <td>N clients, M epoll reactor threads</td>
+ *   <td>ServerPacketReceived</td>
+ *   <td>yes</td>
+ * </tr>
  * </table>
  *
  */
 #ifndef __SERVER_SOCKET_H__
 #define __SERVER_SOCKET_H__
 
+#include <sys/uio.h>
 #include "util/mutex.h"
 #include "util/packet.h"
 #include "util/slist.h"
@@ -84,6 +91,11 @@
 /** Maximum number of clients waiting to be accepted for connection. */
 #define MAX_PENDING_CONNECTIONS 5
 
+/** Default number of reactor threads used in MODE_REACTOR_CLIENTS. */
+#define DEF_SERVER_REACTORS 2
+/** Maximum number of reactor threads used in MODE_REACTOR_CLIENTS. */
+#define MAX_SERVER_REACTORS 64
+
 ////////////////////////////////////////////////////////////////////////////////
 // ERROR STRINGS - Moved from code to here with version 0.5.0.0
 ////////////////////////////////////////////////////////////////////////////////
@@ -132,6 +144,7 @@ typedef enum
   MODE_SINGLE_CLIENT = 0, // 1 client  : 1 connection, ServerPacketReceived
   MODE_MULTIPLE_CLIENTS, // N clients : 1 connection, ServerPacketReceived
   MODE_CUSTOM_CALLBACK, // Custom, ClientConnectionAccepted
+  MODE_REACTOR_CLIENTS, // N clients : M epoll threads, ServerPacketReceived
 
   NUM_CLIENT_MODES ///< Number of different modes (needs to be the last item)
 } ClientMode;
@@ -224,6 +237,12 @@ struct _ServerSocket
   int stopping;
   SList cthreads;
   bool verbose;
+  
+  // MODE_REACTOR_CLIENTS only
+  /** The number of reactor threads to be started. */
+  uint8_t noReactors;
+  /** The reactor threads (internal SocketReactor array). */
+  void* reactors;
 } ;
 
 /**
@@ -256,6 +275,10 @@ typedef struct
    * attached routers / proxies, max 255 therefore a one byte id is more than
    * sufficient. This ID will be mapped to the updates. */
   uint8_t  routerID;
+
+  /** The capabilities negotiated during the handshake (SRX_PROXY_CAP_...).
+   * @since 0.6.0 */
+  uint32_t capabilities;
   
   Mutex writeMutex;
 
@@ -263,6 +286,22 @@ typedef struct
   ServerSocket* svrSock;
   /* The socket address. */
   struct sockaddr caddr;  
+  
+  /** The reactor this client is registered with (MODE_REACTOR_CLIENTS only). 
+   * In this mode the field thread contains the reactor thread. */
+  void*    reactor;
+  /** The receive buffer of the non-blocking framed reads. */
+  uint8_t* rcvBuffer;
+  /** The size of the receive buffer. */
+  uint32_t rcvBufferSize;
+  /** The number of bytes currently stored in the receive buffer. */
+  uint32_t rcvBufferFill;
+  /** Set while the reactor dispatches the PDUs of this client without holding
+   * the reactor mutex. Guarded by the reactor mutex. */
+  bool     dispatching;
+  /** The client was closed during a dispatch, the reactor completes the close
+   * once the dispatch is finished. Guarded by the reactor mutex. */
+  bool     closePending;
 } ClientThread;
 
 /**
@@ -275,6 +314,17 @@ typedef struct
  */
 bool createServerSocket(ServerSocket* self, int port, bool verbose);
 
+/**
+ * Set the number of reactor threads used to multiplex all client connections
+ * in MODE_REACTOR_CLIENTS. This must be called prior to runServerLoop.
+ *
+ * @param self Existing server-socket instance
+ * @param noReactors The number of reactor threads (1..MAX_SERVER_REACTORS)
+ *
+ * @return \c true = the value was accepted, \c false = invalid number
+ */
+bool setServerSocketReactors(ServerSocket* self, int noReactors);
+
 /**
  * Starts the runloop which processes all client connections, and depending 
  * on the mode even the receipt of the packets.
@@ -318,6 +368,21 @@ void stopServerLoop(ServerSocket* self);
 bool sendPacketToClient(ServerSocket* self, ServerClient* client,
                         void* data, size_t size);
 
+/**
+ * Sends a batch of packets to a client using one gathered write where the 
+ * mode allows it.
+ *
+ * @param self Server-socket instance
+ * @param client Client
+ * @param iov One vector element per packet, the content will be modified.
+ * @param count Number of packets within \c iov (max. IOV_MAX)
+ * @return \c true = sent, \c false = an error occurred (e.g. inactive client)
+ *
+ * @since 0.6.0
+ */
+bool sendPacketsToClient(ServerSocket* self, ServerClient* client,
+                         struct iovec* iov, int count);
+
 /**
  * Closes the connection associated with the given client.
  * 
@@ -505,6 +505,10 @@ void moveSListNode(SList* to, SList* from, SListNode* node,
   {
     prevNode->next = node->next;
   }
+  if (from->last == node)
+  {
+    from->last = prevNode;
+  }
   node->next = NULL;
   from->size--;
 }
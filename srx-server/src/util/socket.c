@@ -51,6 +51,7 @@
 
 #include <fcntl.h>
 #include <pthread.h>
+#include <sys/uio.h>
 
 #define HDR "([0x%08X] Socket {%u}): "
 
@@ -139,6 +140,68 @@ bool recvNum(int* fd, void* buffer, size_t num)
   return true;
 }
 
+/**
+ * Reads the data available on the socket but at most \c num bytes. In case no
+ * data is available the call blocks until at least one byte is received.
+ * In case of an error, \c fd is set to \c -1.
+ *
+ * @param fd File-descriptor pointer
+ * @param buffer (out) Destination for the read data
+ * @param num The size of the buffer
+ *
+ * @return the number of bytes received or -1 if the connection is lost.
+ *
+ * @since 0.6.0
+ */
+ssize_t recvAvailable(int* fd, void* buffer, size_t num)
+{
+  ssize_t rbytes = -1;
+  _setLastError(0, SOCK_OP_RCV);
+
+  if (*fd == -1)
+  {
+    _setLastError(EBADF, SOCK_OP_RCV);
+    return -1;
+  }
+
+  while (rbytes == -1)
+  {
+    rbytes = recv(*fd, buffer, num, MSG_NOSIGNAL);
+    if (rbytes == -1)
+    {
+      int ioError = errno;
+      _setLastError(ioError, false);
+      if ((ioError == EINTR) || (ioError == EAGAIN))
+      {
+        continue;
+      }
+      if ((ioError != EBADF) && (ioError != ECONNRESET))
+      {
+        RAISE_SYS_ERROR("Socket error 0x%X (%u) while receiving data!",
+                        ioError, ioError);
+      }
+      else
+      {
+        LOG(LEVEL_WARNING, HDR "Socket error 0x%X (%u) while receiving data - "
+                         "Close socket!", pthread_self(), *fd, ioError, 
+                         ioError);
+      }
+      *fd = -1;
+      return -1;
+    }
+  }
+
+  if (rbytes == 0)
+  {
+    // Connection lost
+    LOG(LEVEL_INFO, "Connection reset by peer.");
+    *fd = -1;
+    return -1;
+  }
+
+  return rbytes;
+}
+
 /**
  * Send the data stored in the buffer. this method closes the socket in case of
  * an error.
@@ -205,6 +268,82 @@ bool sendNum(int* fd, void* buffer, size_t num)
   return retVal;
 }
 
+/**
+ * Send all data described by the given I/O vector using as few system calls 
+ * as possible. Partially written vectors are resumed where the previous call
+ * stopped. The vector itself is modified during the write.
+ *
+ * @param fd the file descriptor of the socket to write into.
+ * @param iov The I/O vector to be written.
+ * @param iovcnt The number of elements within the vector.
+ *
+ * @return true if the data could be send, otherwise false.
+ *
+ * @since 0.6.0
+ */
+bool sendNumV(int* fd, struct iovec* iov, int iovcnt)
+{
+  struct msghdr msg;
+  ssize_t sbytes;
+
+  // Reset the error code
+  _setLastError(0, SOCK_OP_SEND);
+
+  if (*fd == -1)
+  {
+    LOG(LEVEL_WARNING, FILE_LINE_INFO " File descriptor is invalid!");
+    _setLastError(EBADF, SOCK_OP_SEND);
+    return false;
+  }
+
+  memset(&msg, 0, sizeof(struct msghdr));
+  while (iovcnt > 0)
+  {
+    // Skip all vectors that are completely written.
+    if (iov->iov_len == 0)
+    {
+      iov++;
+      iovcnt--;
+      continue;
+    }
+
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = iovcnt;
+    sbytes = sendmsg(*fd, &msg, MSG_NOSIGNAL);
+
+    if (sbytes <= 0)
+    {
+      _setLastError(errno, SOCK_OP_SEND);
+      if (errno == EWOULDBLOCK || errno == EAGAIN || errno == EINTR)
+      {
+        continue;
+      }
+      *fd = -1;
+      return false;
+    }
+
+    // Advance the vector by the number of bytes written.
+    while (sbytes > 0)
+    {
+      if ((size_t)sbytes >= iov->iov_len)
+      {
+        sbytes -= iov->iov_len;
+        iov->iov_len = 0;
+        iov++;
+        iovcnt--;
+      }
+      else
+      {
+        iov->iov_base = (uint8_t*)iov->iov_base + sbytes;
+        iov->iov_len -= sbytes;
+        sbytes = 0;
+      }
+    }
+  }
+
+  return true;
+}
+
 /**
  * Generate the address string of the socket.
  *
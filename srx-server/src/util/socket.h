@@ -41,6 +41,7 @@
 #define __SOCKET_H__
 
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include "util/prefix.h"
 
 /** 
@@ -65,6 +66,23 @@
  */
 bool recvNum(int* fd, void* buffer, size_t num);
 
+/**
+ * Reads the data available on a socket but at most \c num Bytes. Other than
+ * recvNum this returns as soon as some data is received.
+ * In case of an error, \c fd is set to \c -1.
+ *
+ * @note Blocking call
+ *
+ * @param fd File-descriptor pointer
+ * @param buffer (out) Destination for the read data
+ * @param num Size of the buffer
+ * @return The number of Bytes read or \c -1 if the connection is lost
+ * @see recvNum
+ *
+ * @since 0.6.0
+ */
+ssize_t recvAvailable(int* fd, void* buffer, size_t num);
+
 /** 
  * Writes \c num Bytes to a socket.
  * In case of an error, \c fd is closed and set to \c -1.
@@ -76,6 +94,20 @@ bool recvNum(int* fd, void* buffer, size_t num);
  */
 bool sendNum(int* fd, void* buffer, size_t num);
 
+/** 
+ * Writes all Bytes described by the I/O vector to a socket using gathered 
+ * writes. The content of \c iov is modified during the call.
+ * In case of an error, \c fd is set to \c -1.
+ *
+ * @param fd File-descriptor pointer
+ * @param iov The I/O vector
+ * @param iovcnt Number of elements in \c iov
+ * @return \c true = successful, \c = failed
+ *
+ * @since 0.6.0
+ */
+bool sendNumV(int* fd, struct iovec* iov, int iovcnt);
+
 /**
  * Returns a textual representation of a \c sockaddr.
  *
@@ -31,247 +31,461 @@
  * 0.1.0    - 2009/12/32 -pgleichm
  *            * Code created. 
  */
-#include <stdio.h>
-#include <signal.h>
-#include <sys/time.h>
-#include "util/slist.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "util/log.h"
 #include "util/timer.h"
-// @TODO: Check if still used of if already replaced by stock functions.
+
+/** The initial number of timers the timer table can hold. */
+#define TIMER_INIT_SIZE 16
+
 /**
  * A single timer
  */
 typedef struct {
   int           id;
   bool          active;
-  time_t        future; 
-  int           interval;
-  TimerExpired  callback;
+  uint64_t      due;      // Monotonic time in milliseconds
+  int           interval; // Seconds, -1 = only once
+  uint32_t      heapIdx;  // Position within the heap if active
+  int           nextFree; // Next unused timer if not in use
+  TimerExpired  callback; // NULL if the timer is not in use
 } Timer;
 
-/** Prevents that the timer-list gets reset */
-static bool   _initialized = false;
-/** List of all timers */
-static SList  _timerList;
-/** Id of the active timer */
-static int    _activeId; 
-
+/** Protects all timers, the heap, and the state of the timer thread */
+static pthread_mutex_t _timerMutex = PTHREAD_MUTEX_INITIALIZER;
+/** Wakes up the timer thread if the earliest timer changed */
+static pthread_cond_t  _timerCond;
+/** The thread that fires the timers */
+static pthread_t       _timerThread;
+/** Indicates if the timer thread is running */
+static bool            _running  = false;
+/** All timers, indexed by their identifier */
+static Timer**         _timers   = NULL;
+/** Number of slots in the timer table (and the heap) */
+static uint32_t        _size     = 0;
+/** Number of slots in the timer table used so far */
+static uint32_t        _used     = 0;
+/** First unused timer or -1 */
+static int             _freeId   = -1;
+/** Binary min-heap of the active timers, ordered by their due time */
+static Timer**         _heap     = NULL;
+/** Number of timers in the heap */
+static uint32_t        _heapSize = 0;
 
-static void setTimer(int sec) 
+/**
+ * Return the monotonic time in milliseconds.
+ *
+ * @return The current monotonic time.
+ */
+static uint64_t _now()
 {
-  struct itimerval  tv;
+  struct timespec ts;
 
-  timerclear(&tv.it_interval);
-  tv.it_value.tv_usec = 0;
-  tv.it_value.tv_sec  = sec;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
 
-  setitimer(ITIMER_REAL, &tv, NULL);
+  return ((uint64_t)ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
 }
 
 /**
- * Sets the alarm to the earliest timer.
+ * Return the timer with the given identifier.
+ *
+ * @param id Timer identifier
+ * @return The timer or NULL if the identifier is not in use.
  */
-static void selectTimer() 
+static Timer* _getTimer(int id)
 {
-  time_t            min = 0;
-  SListNode*        cnode;
-  Timer*            tcurr, *tsel = NULL;
-
-  // Search for the earliest time - a sorted list would be an alternative
-  FOREACH_SLIST(&_timerList, cnode) 
+  if ((id < 0) || ((uint32_t)id >= _used) || (_timers[id]->callback == NULL))
   {
-    tcurr = (Timer*)cnode->data;
+    return NULL;
+  }
+  return _timers[id];
+}
+
+/**
+ * Store the timer at the given position of the heap.
+ *
+ * @param idx The position within the heap.
+ * @param t The timer.
+ */
+static void _heapSet(uint32_t idx, Timer* t)
+{
+  _heap[idx] = t;
+  t->heapIdx = idx;
+}
 
-    // Not an active timer - skip
-    if (!tcurr->active) 
+/**
+ * Move the timer up the heap until its parent is due earlier.
+ *
+ * @param t The timer
+ */
+static void _heapUp(Timer* t)
+{
+  uint32_t idx = t->heapIdx;
+  uint32_t parent;
+
+  while (idx > 0)
+  {
+    parent = (idx - 1) / 2;
+    if (_heap[parent]->due <= t->due)
     {
-      continue;
+      break;
     }
+    _heapSet(idx, _heap[parent]);
+    idx = parent;
+  }
+  _heapSet(idx, t);
+}
+
+/**
+ * Move the timer down the heap until its children are due later.
+ *
+ * @param t The timer
+ */
+static void _heapDown(Timer* t)
+{
+  uint32_t idx = t->heapIdx;
+  uint32_t child;
 
-    // Earlier than the previous timer(s)
-    if ((tcurr->future < min) || (min == 0)) 
+  while ((child = (idx * 2) + 1) < _heapSize)
+  {
+    if (   ((child + 1) < _heapSize)
+        && (_heap[child + 1]->due < _heap[child]->due))
     {
-      tsel = tcurr;
-      min = tcurr->future;
+      child++;
     }
+    if (t->due <= _heap[child]->due)
+    {
+      break;
+    }
+    _heapSet(idx, _heap[child]);
+    idx = child;
   }
+  _heapSet(idx, t);
+}
 
-  // A timer has been selected
-  if (tsel != NULL) 
-  {
-    _activeId = tsel->id;
-    setTimer(tsel->future - time(NULL));
+/**
+ * Remove the timer from the heap.
+ *
+ * @param t The active timer
+ */
+static void _heapRemove(Timer* t)
+{
+  Timer* last = _heap[--_heapSize];
 
-  // No active timer
-  } 
-  else 
+  t->active = false;
+  if (last != t)
   {
-    _activeId = -1;
+    // Fill the gap with the last timer and restore the order
+    last->heapIdx = t->heapIdx;
+    if ((last->heapIdx > 0) && (last->due < _heap[(last->heapIdx-1)/2]->due))
+    {
+      _heapUp(last);
+    }
+    else
+    {
+      _heapDown(last);
+    }
   }
 }
 
-/** 
- * \c alarm function.
+/**
+ * Fires the timers once they are due. The callbacks are called without
+ * holding the timer lock, they are allowed to start and stop timers.
  *
- * @param _sig (unused) Signal
+ * @param arg (unused)
+ * @return NULL
  */
-static void alarmSignal(int sig) 
+static void* _timerLoop(void* arg)
 {
-  if (_activeId > -1) 
+  struct timespec to;
+  Timer*          t;
+  TimerExpired    callback;
+  uint64_t        now;
+  int             id;
+
+  pthread_mutex_lock(&_timerMutex);
+  while (_running)
   {
-    Timer* t = getFromSList(&_timerList, _activeId);
-
-    // Other signal was fired - restart the timer 
-    if (sig != SIGALRM) 
-    {
-      setTimer(t->future - time(NULL));
-    } 
-    else 
+    if (_heapSize == 0)
     {
-      // One shot timer - disable it
-      if (t->interval == -1) 
-      {
-        t->active = false;
-      } 
-      else 
-      {
-        t->future += t->interval;
-      }
+      pthread_cond_wait(&_timerCond, &_timerMutex);
+      continue;
+    }
 
-      // Select a new timer
-      selectTimer();
+    t   = _heap[0];
+    now = _now();
+    if (t->due > now)
+    {
+      to.tv_sec  = t->due / 1000;
+      to.tv_nsec = (t->due % 1000) * 1000000;
+      pthread_cond_timedwait(&_timerCond, &_timerMutex, &to);
+      continue;
+    }
 
-      // Call the handler
-      t->callback(t->id, time(NULL));
+    // One shot timer - disable it, otherwise schedule the next round
+    if (t->interval == -1)
+    {
+      _heapRemove(t);
+    }
+    else
+    {
+      t->due += (uint64_t)t->interval * 1000;
+      _heapDown(t);
     }
+
+    id       = t->id;
+    callback = t->callback;
+    pthread_mutex_unlock(&_timerMutex);
+    callback(id, time(NULL));
+    pthread_mutex_lock(&_timerMutex);
   }
+  pthread_mutex_unlock(&_timerMutex);
+
+  pthread_exit(0);
 }
 
-/** 
- * Clears the \c alarm.
+/**
+ * Start the timer thread. The caller holds the timer lock.
+ *
+ * @return false if the thread could not be started.
  */
-static void clearAlarm() 
+static bool _startTimerThread()
 {
-  struct itimerval tv;
+  pthread_condattr_t attr;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&_timerCond, &attr);
+  pthread_condattr_destroy(&attr);
 
-  timerclear(&tv.it_value);
-  setitimer(ITIMER_REAL, &tv, NULL);
+  _running = true;
+  if (pthread_create(&_timerThread, NULL, _timerLoop, NULL) != 0)
+  {
+    RAISE_SYS_ERROR("Could not start the timer thread!");
+    _running = false;
+    pthread_cond_destroy(&_timerCond);
+  }
+
+  return _running;
 }
 
-int setupTimer(TimerExpired callback) 
+/**
+ * Make room for more timers in the timer table and the heap. The caller
+ * holds the timer lock.
+ *
+ * @return false if not enough memory was available.
+ */
+static bool _growTimers()
 {
-  Timer*  t; 
- 
-  // No timer yet
-  if (!_initialized) 
+  uint32_t newSize = (_size == 0) ? TIMER_INIT_SIZE : _size * 2;
+  Timer**  timers  = realloc(_timers, newSize * sizeof(Timer*));
+  Timer**  heap;
+
+  if (timers == NULL)
+  {
+    return false;
+  }
+  _timers = timers;
+
+  heap = realloc(_heap, newSize * sizeof(Timer*));
+  if (heap == NULL)
   {
-    initSList(&_timerList);
-    _initialized = true;
-    _activeId    = -1;
-    signal(SIGALRM, alarmSignal);
+    return false;
   }
+  _heap = heap;
+  _size = newSize;
+
+  return true;
+}
+
+int setupTimer(TimerExpired callback)
+{
+  Timer*  t  = NULL;
+  int     id = -1;
+
+  pthread_mutex_lock(&_timerMutex);
 
-  // Append the new timer structure
-  t = appendToSList(&_timerList, sizeof(Timer));
-  if (t == NULL) 
+  // No timer yet
+  if (_running || _startTimerThread())
   {
-    return -1;
+    if (_freeId != -1)
+    {
+      // Reuse a deleted timer
+      t       = _timers[_freeId];
+      _freeId = t->nextFree;
+    }
+    else if ((_used < _size) || _growTimers())
+    {
+      t = malloc(sizeof(Timer));
+      if (t != NULL)
+      {
+        t->id = _used;
+        _timers[_used++] = t;
+      }
+    }
+
+    if (t != NULL)
+    {
+      t->active   = false;
+      t->nextFree = -1;
+      t->callback = callback;
+      id          = t->id;
+    }
+    else
+    {
+      RAISE_SYS_ERROR("Not enough memory to create a timer!");
+    }
   }
 
-  t->id       = sizeOfSList(&_timerList) - 1;
-  t->active   = false;
-  t->callback = callback;
+  pthread_mutex_unlock(&_timerMutex);
 
-  return t->id;
+  return id;
 }
 
-void deleteTimer(int id) 
+void deleteTimer(int id)
 {
-  Timer* t = getFromSList(&_timerList, id);
-  if (t != NULL) 
+  Timer* t;
+
+  pthread_mutex_lock(&_timerMutex);
+  t = _getTimer(id);
+  if (t != NULL)
   {
-    stopTimer(id);
-    deleteFromSList(&_timerList, t);
+    if (t->active)
+    {
+      _heapRemove(t);
+    }
+    t->callback = NULL;
+    t->nextFree = _freeId;
+    _freeId     = id;
   }
+  pthread_mutex_unlock(&_timerMutex);
 }
 
-void deleteAllTimers() 
+void deleteAllTimers()
 {
-  clearAlarm();
-  releaseSList(&_timerList);
-  _initialized = false;
+  bool     joinThread;
+  uint32_t idx;
+
+  pthread_mutex_lock(&_timerMutex);
+  joinThread = _running;
+  _running   = false;
+  if (joinThread)
+  {
+    pthread_cond_signal(&_timerCond);
+  }
+  pthread_mutex_unlock(&_timerMutex);
+
+  if (joinThread)
+  {
+    if (pthread_equal(pthread_self(), _timerThread))
+    {
+      // Called within a callback - the loop ends once the callback returns
+      pthread_detach(_timerThread);
+    }
+    else
+    {
+      pthread_join(_timerThread, NULL);
+      pthread_cond_destroy(&_timerCond);
+    }
+  }
+
+  pthread_mutex_lock(&_timerMutex);
+  for (idx = 0; idx < _used; idx++)
+  {
+    free(_timers[idx]);
+  }
+  free(_timers);
+  free(_heap);
+  _timers   = NULL;
+  _heap     = NULL;
+  _size     = 0;
+  _used     = 0;
+  _heapSize = 0;
+  _freeId   = -1;
+  pthread_mutex_unlock(&_timerMutex);
 }
 
-bool isActiveTimer(int id) 
+bool isActiveTimer(int id)
 {
-  Timer* t = getFromSList(&_timerList, id);
-  return (t == NULL) ? false : t->active;
+  Timer* t;
+  bool   active;
+
+  pthread_mutex_lock(&_timerMutex);
+  t      = _getTimer(id);
+  active = (t == NULL) ? false : t->active;
+  pthread_mutex_unlock(&_timerMutex);
+
+  return active;
 }
 
 /**
  * Starts the timer, to fire in the a specific time.
  *
  * @param id Timer identifier
- * @param future When to fire (UNIX timestamp)
+ * @param delay Milliseconds until the timer fires the first time
  * @param interval Fire again afer \c internval seconds, \c -1 = only once
  */
-static void startTimer(int id, time_t future, int interval) 
+static void startTimer(int id, uint64_t delay, int interval)
 {
   Timer* t;
 
-  // Active timer - then deactivate it first
-  if (_activeId == id) 
-  {
-    clearAlarm();
-  }
-
-  // Store the parameters
-  t = getFromSList(&_timerList, id);
-  if (t != NULL) 
+  pthread_mutex_lock(&_timerMutex);
+  t = _getTimer(id);
+  if (t != NULL)
   {
-    t->future   = future;
+    t->due      = _now() + delay;
     t->interval = interval;
-    t->active   = true;
+    if (!t->active)
+    {
+      t->active = true;
+      _heapSet(_heapSize++, t);
+      _heapUp(t);
+    }
+    else if ((t->heapIdx > 0) && (t->due < _heap[(t->heapIdx-1)/2]->due))
+    {
+      _heapUp(t);
+    }
+    else
+    {
+      _heapDown(t);
+    }
 
-    selectTimer();  
+    // The earliest timer changed - wake up the timer thread
+    if (t->heapIdx == 0)
+    {
+      pthread_cond_signal(&_timerCond);
+    }
   }
+  pthread_mutex_unlock(&_timerMutex);
 }
 
-void startIntervalTimer(int id, int sec, bool oneShot) 
+void startIntervalTimer(int id, int sec, bool oneShot)
 {
-  startTimer(id, time(NULL) + sec, oneShot ? -1 : sec);
+  startTimer(id, (uint64_t)sec * 1000, oneShot ? -1 : sec);
 }
 
-void startAbsoluteTimer(int id, time_t future) 
+void startAbsoluteTimer(int id, time_t future)
 {
-  if (future > time(NULL)) 
+  time_t now = time(NULL);
+
+  if (future > now)
   {
-    startTimer(id, future, -1);
+    startTimer(id, (uint64_t)(future - now) * 1000, -1);
   }
 }
 
-void stopTimer(int id) 
+void stopTimer(int id)
 {
   Timer* t;
 
-  // The given timer is the active timer
-  if (_activeId == id) 
-  {
-    // Deactivate first
-    clearAlarm();
-
-    // Set to inactive and select a new timer
-    t = getFromSList(&_timerList, id);
-    t->active = false;
-    selectTimer();
-
-  // Not the active timer
-  } 
-  else 
+  pthread_mutex_lock(&_timerMutex);
+  t = _getTimer(id);
+  if ((t != NULL) && t->active)
   {
-    t = getFromSList(&_timerList, id);
-    if (t != NULL) 
-    {
-      t->active = false;
-    }
+    _heapRemove(t);
   }
-}
\ No newline at end of file
+  pthread_mutex_unlock(&_timerMutex);
+}
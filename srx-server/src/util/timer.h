@@ -20,8 +20,10 @@
  * by this software.
  *
  *
- * Managed timers.
- * 
+ * Managed timers. All timers are kept in a binary heap ordered by the time
+ * they fire next and are fired by a dedicated timer thread. Starting and
+ * stopping a timer takes O(log n).
+ *
  * @version 0.3.0.10
  *
  * Changelog:
@@ -41,7 +43,8 @@
 
 /**
  * Definition of the function that should be called upon the firing of a
- * alarm.
+ * alarm. The function is called by the timer thread without holding any lock
+ * of the timer subsystem, it might start and stop timers itself.
  *
  * @param now Current time (UNIX timestamp)
  * @see createTimer
@@ -68,7 +71,7 @@ extern void deleteTimer(int id);
 /**
  * Deletes all timers.
  *
- * @note Stops all timers
+ * @note Stops all timers and the timer thread
  */
 extern void deleteAllTimers();
 
@@ -0,0 +1,287 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * Hierarchical timing wheel. Level 0 holds the timers expiring within the
+ * next TW_SLOTS seconds, one slot per second. Each slot of level n covers
+ * TW_SLOTS^n seconds. When the wheel reaches the start of the time span of
+ * an upper level slot, the timers of this slot are moved into the lower
+ * levels (cascading).
+ *
+ * @version 0.6.0
+ *
+ * Changelog:
+ * -----------------------------------------------------------------------------
+ * 0.6.0    - File created
+ * -----------------------------------------------------------------------------
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "util/timing_wheel.h"
+#include "util/log.h"
+
+/** The initial number of timers a list can hold. */
+#define TW_INIT_SIZE 16
+/** The time span covered by the complete wheel. */
+#define TW_SPAN      ((time_t)1 << (TW_SLOT_BITS * TW_LEVELS))
+
+/**
+ * Append the timer to the list.
+ *
+ * @param list The timer list.
+ * @param timer The timer to be appended.
+ *
+ * @return false if not enough memory was available.
+ *
+ * @since 0.6.0
+ */
+static bool _tw_append(TW_TimerList* list, TW_Timer* timer)
+{
+  if (list->count == list->size)
+  {
+    uint32_t  newSize = (list->size == 0) ? TW_INIT_SIZE : list->size * 2;
+    TW_Timer* timers  = realloc(list->timers, newSize * sizeof(TW_Timer));
+    if (timers == NULL)
+    {
+      RAISE_SYS_ERROR("Not enough memory to add a timer to the timing wheel!");
+      return false;
+    }
+    list->timers = timers;
+    list->size   = newSize;
+  }
+  list->timers[list->count++] = *timer;
+
+  return true;
+}
+
+/**
+ * Insert the timer into the slot of the level that covers its expiration
+ * time. Timers that expire at the current time are inserted into the current
+ * slot of level 0.
+ *
+ * @param self The timing wheel.
+ * @param timer The timer.
+ *
+ * @return false if not enough memory was available.
+ *
+ * @since 0.6.0
+ */
+static bool _tw_insert(TimingWheel* self, TW_Timer* timer)
+{
+  time_t pos   = timer->expires;
+  time_t delta = timer->expires - self->current;
+  int    level = 0;
+
+  if (delta < 0)
+  {
+    pos   = self->current;
+    delta = 0;
+  }
+  else if (delta >= TW_SPAN)
+  {
+    // Park it in the furthest slot, it moves on once this slot is reached.
+    pos   = self->current + TW_SPAN - 1;
+    delta = TW_SPAN - 1;
+  }
+  while (   (level < TW_LEVELS - 1)
+         && (delta >= ((time_t)1 << (TW_SLOT_BITS * (level + 1)))))
+  {
+    level++;
+  }
+
+  return _tw_append(&self->slots[level]
+                                [(pos >> (TW_SLOT_BITS * level))
+                                 & (TW_SLOTS - 1)], timer);
+}
+
+/**
+ * Move all timers of the given slot into the lower levels.
+ *
+ * @param self The timing wheel.
+ * @param level The level of the slot (> 0).
+ * @param idx The index of the slot.
+ *
+ * @since 0.6.0
+ */
+static void _tw_cascade(TimingWheel* self, int level, int idx)
+{
+  TW_TimerList list = self->slots[level][idx];
+  uint32_t     tIdx;
+
+  // Detach the list, a parked timer might return into the same slot.
+  memset(&self->slots[level][idx], 0, sizeof(TW_TimerList));
+  for (tIdx = 0; tIdx < list.count; tIdx++)
+  {
+    if (!_tw_insert(self, &list.timers[tIdx]))
+    {
+      self->count--;
+    }
+  }
+
+  if (self->slots[level][idx].timers == NULL)
+  {
+    // Keep the memory for the next round.
+    list.count = 0;
+    self->slots[level][idx] = list;
+  }
+  else
+  {
+    free(list.timers);
+  }
+}
+
+/**
+ * Initialize the timing wheel.
+ *
+ * @param self The timing wheel.
+ * @param now The current time.
+ *
+ * @since 0.6.0
+ */
+void initTimingWheel(TimingWheel* self, time_t now)
+{
+  memset(self, 0, sizeof(TimingWheel));
+  self->current = now;
+}
+
+/**
+ * Release all memory allocated by the timing wheel. The wheel can be used
+ * again after it is initialized.
+ *
+ * @param self The timing wheel.
+ *
+ * @since 0.6.0
+ */
+void releaseTimingWheel(TimingWheel* self)
+{
+  int level, idx;
+
+  for (level = 0; level < TW_LEVELS; level++)
+  {
+    for (idx = 0; idx < TW_SLOTS; idx++)
+    {
+      releaseTimerList(&self->slots[level][idx]);
+    }
+  }
+  self->count = 0;
+}
+
+/**
+ * Add a timer to the wheel. A timer that already expired will be collected
+ * with the next advance of the wheel. The same ID can be added multiple
+ * times.
+ *
+ * @param self The timing wheel.
+ * @param id The ID of the timer.
+ * @param expires The time the timer expires.
+ *
+ * @return false if not enough memory was available.
+ *
+ * @since 0.6.0
+ */
+bool addToTimingWheel(TimingWheel* self, uint32_t id, time_t expires)
+{
+  TW_Timer timer;
+
+  // The current slot of level 0 is already collected.
+  timer.expires = (expires > self->current) ? expires : self->current + 1;
+  timer.id      = id;
+  if (!_tw_insert(self, &timer))
+  {
+    return false;
+  }
+  self->count++;
+
+  return true;
+}
+
+/**
+ * Advance the wheel to the given time and move all timers that expired on the
+ * way into the given list.
+ *
+ * @param self The timing wheel.
+ * @param now The current time.
+ * @param expired The list the expired timers are appended to. The list must
+ *                be initialized (zeroed) and released using
+ *                releaseTimerList.
+ *
+ * @return The number of timers appended to the list.
+ *
+ * @since 0.6.0
+ */
+uint32_t advanceTimingWheel(TimingWheel* self, time_t now,
+                            TW_TimerList* expired)
+{
+  TW_TimerList* slot      = NULL;
+  uint32_t      noExpired = 0;
+  uint32_t      tIdx;
+  int           level;
+
+  while (self->current < now)
+  {
+    if (self->count == 0)
+    {
+      // Nothing to collect on the way.
+      self->current = now;
+      break;
+    }
+    self->current++;
+
+    // Cascade top down, a timer might move through several levels at once.
+    for (level = TW_LEVELS - 1; level > 0; level--)
+    {
+      if ((self->current & (((time_t)1 << (TW_SLOT_BITS * level)) - 1)) == 0)
+      {
+        _tw_cascade(self, level, (self->current >> (TW_SLOT_BITS * level))
+                                 & (TW_SLOTS - 1));
+      }
+    }
+
+    slot = &self->slots[0][self->current & (TW_SLOTS - 1)];
+    for (tIdx = 0; tIdx < slot->count; tIdx++)
+    {
+      if (_tw_append(expired, &slot->timers[tIdx]))
+      {
+        noExpired++;
+      }
+    }
+    self->count -= slot->count;
+    slot->count  = 0;
+  }
+
+  return noExpired;
+}
+
+/**
+ * Release the memory of the timer list.
+ *
+ * @param list The timer list.
+ *
+ * @since 0.6.0
+ */
+void releaseTimerList(TW_TimerList* list)
+{
+  if (list->timers != NULL)
+  {
+    free(list->timers);
+  }
+  memset(list, 0, sizeof(TW_TimerList));
+}
@@ -0,0 +1,133 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology by employees of the Federal Government in the course of
+ * their official duties. Pursuant to title 17 Section 105 of the United
+ * States Code this software is not subject to copyright protection and
+ * is in the public domain.
+ *
+ * NIST assumes no responsibility whatsoever for its use by other parties,
+ * and makes no guarantees, expressed or implied, about its quality,
+ * reliability, or any other characteristic.
+ *
+ * We would appreciate acknowledgment if the software is used.
+ *
+ * NIST ALLOWS FREE USE OF THIS SOFTWARE IN ITS "AS IS" CONDITION AND
+ * DISCLAIM ANY LIABILITY OF ANY KIND FOR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM THE USE OF THIS SOFTWARE.
+ *
+ * This software might use libraries that are under GNU public license or
+ * other licenses. Please refer to the licenses of all libraries required
+ * by this software.
+ *
+ * Hierarchical timing wheel with a resolution of one second. Each timer
+ * consists of an ID and the time it expires. Timers are added in constant
+ * time and collected once they expired. Timers far in the future are kept in
+ * the coarse levels and moved down level by level as their time approaches.
+ * The wheel is not synchronized.
+ *
+ * @version 0.6.0
+ *
+ * Changelog:
+ * -----------------------------------------------------------------------------
+ * 0.6.0    - File created
+ * -----------------------------------------------------------------------------
+ *
+ */
+#ifndef __TIMING_WHEEL_H__
+#define __TIMING_WHEEL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/** Number of levels of the wheel. */
+#define TW_LEVELS     3
+/** Number of bits used for the slots of one level. */
+#define TW_SLOT_BITS  6
+/** Number of slots per level. The wheel covers TW_SLOTS^TW_LEVELS seconds
+ * (more than 3 days), timers further in the future are kept in the last slot
+ * of the top level until their time is within reach. */
+#define TW_SLOTS      (1 << TW_SLOT_BITS)
+
+/** A single timer. */
+typedef struct {
+  time_t   expires; // The time the timer expires
+  uint32_t id;      // The ID of the timer
+} TW_Timer;
+
+/** A list of timers. */
+typedef struct {
+  TW_Timer* timers; // The timers
+  uint32_t  count;  // Number of timers in the list
+  uint32_t  size;   // Number of timers the list can hold
+} TW_TimerList;
+
+/** The timing wheel. */
+typedef struct {
+  TW_TimerList slots[TW_LEVELS][TW_SLOTS]; // The slots of all levels
+  time_t       current; // The time the wheel is advanced to
+  uint32_t     count;   // Number of timers in the wheel
+} TimingWheel;
+
+/**
+ * Initialize the timing wheel.
+ *
+ * @param self The timing wheel.
+ * @param now The current time.
+ *
+ * @since 0.6.0
+ */
+extern void initTimingWheel(TimingWheel* self, time_t now);
+
+/**
+ * Release all memory allocated by the timing wheel. The wheel can be used
+ * again after it is initialized.
+ *
+ * @param self The timing wheel.
+ *
+ * @since 0.6.0
+ */
+extern void releaseTimingWheel(TimingWheel* self);
+
+/**
+ * Add a timer to the wheel. A timer that already expired will be collected
+ * with the next advance of the wheel. The same ID can be added multiple
+ * times.
+ *
+ * @param self The timing wheel.
+ * @param id The ID of the timer.
+ * @param expires The time the timer expires.
+ *
+ * @return false if not enough memory was available.
+ *
+ * @since 0.6.0
+ */
+extern bool addToTimingWheel(TimingWheel* self, uint32_t id, time_t expires);
+
+/**
+ * Advance the wheel to the given time and move all timers that expired on the
+ * way into the given list.
+ *
+ * @param self The timing wheel.
+ * @param now The current time.
+ * @param expired The list the expired timers are appended to. The list must
+ *                be initialized (zeroed) and released using
+ *                releaseTimerList.
+ *
+ * @return The number of timers appended to the list.
+ *
+ * @since 0.6.0
+ */
+extern uint32_t advanceTimingWheel(TimingWheel* self, time_t now,
+                                   TW_TimerList* expired);
+
+/**
+ * Release the memory of the timer list.
+ *
+ * @param list The timer list.
+ *
+ * @since 0.6.0
+ */
+extern void releaseTimerList(TW_TimerList* list);
+
+#endif // !__TIMING_WHEEL_H__